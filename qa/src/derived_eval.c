@@ -0,0 +1,213 @@
+/*
+ * Evaluate derived metrics over an archive, once with compiled and
+ * shared expressions (the default) and once with the expression tree
+ * walk (PCP_DERIVED_COMPILE and PCP_DERIVED_SHARE set to 0), and check
+ * the values agree.
+ * With -v the fetch rate for each is reported on stderr, and with -p
+ * the values of every sample (not only the first) are reported.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+
+static int	nfetch = 10;
+static int	niter = 1;
+static int	verbose;
+static int	allsamples;
+static int	nmetric;
+static char	**names;
+static pmID	*pmids;
+static pmDesc	*descs;
+
+/*
+ * Fetch every sample from the start of the archive (niter times over),
+ * and append the values of the first pass to a memory stream.
+ */
+static char *
+run(const char *archive, int optimise, size_t *lenp)
+{
+    FILE		*f;
+    char		*buf = NULL;
+    pmResult		*rp;
+    pmLogLabel		label;
+    struct timeval	start, end;
+    double		elapsed;
+    int			ctx;
+    int			iter;
+    int			n, i, j, sts;
+    long		count = 0;
+
+    if ((sts = pmSetDerivedControl(PCP_DERIVED_COMPILE, optimise)) < 0 ||
+	(sts = pmSetDerivedControl(PCP_DERIVED_SHARE, optimise)) < 0) {
+	fprintf(stderr, "%s: pmSetDerivedControl: %s\n", pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+    if ((ctx = pmNewContext(PM_CONTEXT_ARCHIVE, archive)) < 0) {
+	fprintf(stderr, "%s: pmNewContext(%s): %s\n", pmGetProgname(), archive, pmErrStr(ctx));
+	exit(1);
+    }
+    if ((sts = pmLookupName(nmetric, (const char **)names, pmids)) < 0) {
+	fprintf(stderr, "%s: pmLookupName: %s\n", pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+    for (i = 0; i < nmetric; i++) {
+	if (pmids[i] == PM_ID_NULL) {
+	    fprintf(stderr, "%s: %s: unknown metric\n", pmGetProgname(), names[i]);
+	    exit(1);
+	}
+	if ((sts = pmLookupDesc(pmids[i], &descs[i])) < 0) {
+	    fprintf(stderr, "%s: %s: pmLookupDesc: %s\n", pmGetProgname(), names[i], pmErrStr(sts));
+	    exit(1);
+	}
+    }
+    if ((sts = pmGetArchiveLabel(&label)) < 0) {
+	fprintf(stderr, "%s: pmGetArchiveLabel: %s\n", pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+    if ((f = open_memstream(&buf, lenp)) == NULL) {
+	fprintf(stderr, "%s: open_memstream: %s\n", pmGetProgname(), osstrerror());
+	exit(1);
+    }
+
+    pmtimevalNow(&start);
+    for (iter = 0; iter < niter; iter++) {
+	if ((sts = pmSetMode(PM_MODE_FORW, &label.ll_start, 0)) < 0) {
+	    fprintf(stderr, "%s: pmSetMode: %s\n", pmGetProgname(), pmErrStr(sts));
+	    exit(1);
+	}
+	for (n = 0; n < nfetch; n++) {
+	    if ((sts = pmFetch(nmetric, pmids, &rp)) < 0) {
+		if (sts == PM_ERR_EOL)
+		    break;
+		fprintf(stderr, "%s: pmFetch: %s\n", pmGetProgname(), pmErrStr(sts));
+		exit(1);
+	    }
+	    count++;
+	    if (iter == 0) {
+		for (i = 0; i < rp->numpmid; i++) {
+		    pmValueSet	*vsp = rp->vset[i];
+
+		    fprintf(f, "[%d] %s:", n, names[i]);
+		    if (vsp->numval < 0)
+			fprintf(f, " %s", pmErrStr(vsp->numval));
+		    for (j = 0; j < vsp->numval; j++) {
+			fprintf(f, " %d=", vsp->vlist[j].inst);
+			pmPrintValue(f, vsp->valfmt, descs[i].type, &vsp->vlist[j], 1);
+		    }
+		    fputc('\n', f);
+		}
+	    }
+	    pmFreeResult(rp);
+	}
+    }
+    pmtimevalNow(&end);
+    elapsed = pmtimevalSub(&end, &start);
+    if (verbose)
+	fprintf(stderr, "%s: %ld fetches, %.0f fetches/sec\n",
+		optimise ? "compiled" : "tree walk", count,
+		elapsed > 0 ? count / elapsed : 0);
+
+    fclose(f);
+    pmDestroyContext(ctx);
+    return buf;
+}
+
+int
+main(int argc, char **argv)
+{
+    char	*archive = NULL;
+    char	*name, *expr;
+    char	*errmsg;
+    char	*compiled, *walked;
+    char	*p, *q;
+    size_t	clen, wlen;
+    int		c, sts;
+    int		errflag = 0;
+    static char	*usage = "[-pv] [-D debug] [-i iterations] [-n samples] -a archive name=expr ...";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "a:D:i:n:pv")) != EOF) {
+	switch (c) {
+
+	case 'a':	/* archive */
+	    archive = optarg;
+	    break;
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'i':
+	    niter = atoi(optarg);
+	    break;
+
+	case 'n':
+	    nfetch = atoi(optarg);
+	    break;
+
+	case 'p':	/* report values of every sample */
+	    allsamples = 1;
+	    break;
+
+	case 'v':	/* report fetch rate */
+	    verbose = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || archive == NULL || optind == argc || niter < 1 || nfetch < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    nmetric = argc - optind;
+    names = (char **)malloc(nmetric * sizeof(char *));
+    pmids = (pmID *)malloc(nmetric * sizeof(pmID));
+    descs = (pmDesc *)malloc(nmetric * sizeof(pmDesc));
+    if (names == NULL || pmids == NULL || descs == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+    for (c = 0; c < nmetric; c++) {
+	name = expr = argv[optind + c];
+	if ((name = strsep(&expr, "=")) == NULL || expr == NULL) {
+	    fprintf(stderr, "%s: invalid name=expr \"%s\"\n", pmGetProgname(), argv[optind + c]);
+	    exit(1);
+	}
+	if (pmRegisterDerivedMetric(name, expr, &errmsg) < 0) {
+	    fprintf(stderr, "%s: %s", pmGetProgname(), errmsg);
+	    free(errmsg);
+	    exit(1);
+	}
+	names[c] = name;
+    }
+
+    compiled = run(archive, 1, &clen);
+    walked = run(archive, 0, &wlen);
+
+    /* the first (or every) sample's values, then the comparison */
+    if (!allsamples && (p = strstr(compiled, "\n[1] ")) != NULL)
+	fwrite(compiled, 1, p - compiled + 1, stdout);
+    else
+	fputs(compiled, stdout);
+    for (p = compiled, q = walked; *p && *p == *q; p++, q++)
+	;
+    if (clen != wlen || *p != *q) {
+	printf("values differ at offset %d\n", (int)(p - compiled));
+	exit(1);
+    }
+    printf("%d bytes of values ok\n", (int)clen);
+    free(compiled);
+    free(walked);
+    exit(0);
+}
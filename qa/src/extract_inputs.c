@@ -0,0 +1,110 @@
+/*
+ * Create a set of archives for pmlogextract merge checks and timing,
+ * as if one pmlogger per input had been logging the same host with
+ * its own sampling phase.  Each archive has metrics with an instance
+ * domain; sample s of archive a is at 1600000000 + s*interval seconds
+ * plus an offset of a*interval/count (so records from different
+ * inputs interleave), and every third archive also has samples at the
+ * same times as archive 0 so there are ties to break.
+ *
+ * The archives are called prefix-0, prefix-1, ... prefix-(count-1).
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include <pcp/import.h>
+#include <inttypes.h>
+
+static void
+check(int sts, const char *name)
+{
+    if (sts < 0) {
+	fprintf(stderr, "%s: %s: %s\n", pmGetProgname(), name, pmiErrStr(sts));
+	exit(1);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    int		c, a, s, m, i;
+    int		count;
+    int		nsample = 100;
+    int		ninst = 4;
+    int		nmetric = 4;
+    int		interval = 10;
+    int		errflag = 0;
+    __int64_t	usec;
+    char	name[MAXPATHLEN];
+    char	inst[64];
+    char	buf[64];
+    static char	*usage = "[-i instances] [-m metrics] [-n samples] [-t interval] count prefix";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "i:m:n:t:")) != EOF) {
+	switch (c) {
+
+	case 'i':	/* instances per metric */
+	    ninst = atoi(optarg);
+	    break;
+
+	case 'm':	/* metrics per archive */
+	    nmetric = atoi(optarg);
+	    break;
+
+	case 'n':	/* samples per archive */
+	    nsample = atoi(optarg);
+	    break;
+
+	case 't':	/* seconds between samples */
+	    interval = atoi(optarg);
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc-2 || ninst < 1 || nmetric < 1 ||
+	nsample < 1 || interval < 1 || (count = atoi(argv[optind])) < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    for (a = 0; a < count; a++) {
+	pmsprintf(name, sizeof(name), "%s-%d", argv[optind+1], a);
+	check(pmiStart(name, 0), "pmiStart");
+	check(pmiSetHostname("extract.host"), "pmiSetHostname");
+	check(pmiSetTimezone("UTC"), "pmiSetTimezone");
+	for (m = 0; m < nmetric; m++) {
+	    pmsprintf(buf, sizeof(buf), "extract.m%d", m);
+	    check(pmiAddMetric(buf, pmiID(245, 1, m), PM_TYPE_U64,
+				pmInDom_build(245, 1), PM_SEM_COUNTER,
+				pmiUnits(0,0,1,0,0,PM_COUNT_ONE)), "pmiAddMetric");
+	}
+	for (i = 0; i < ninst; i++) {
+	    pmsprintf(buf, sizeof(buf), "inst%d", i);
+	    check(pmiAddInstance(pmInDom_build(245, 1), buf, i), "pmiAddInstance");
+	}
+	for (s = 0; s < nsample; s++) {
+	    for (m = 0; m < nmetric; m++) {
+		pmsprintf(name, sizeof(name), "extract.m%d", m);
+		for (i = 0; i < ninst; i++) {
+		    pmsprintf(inst, sizeof(inst), "inst%d", i);
+		    pmsprintf(buf, sizeof(buf), "%d",
+				((a * nsample + s) * nmetric + m) * ninst + i);
+		    check(pmiPutValue(name, inst, buf), "pmiPutValue");
+		}
+	    }
+	    usec = (__int64_t)s * interval * 1000000;
+	    if (a % 3 != 0)
+		usec += (__int64_t)a * interval * 1000000 / count;
+	    check(pmiWrite(1600000000 + usec / 1000000, usec % 1000000), "pmiWrite");
+	}
+	check(pmiEnd(), "pmiEnd");
+    }
+
+    exit(0);
+}
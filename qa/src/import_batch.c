@@ -0,0 +1,286 @@
+/*
+ * Create the same archive twice with libpcp_import, once a value at a
+ * time with pmiPutValueHandle() and pmiWrite(), and once with
+ * pmiPutBatch(), so the two can be compared.  There is one metric of
+ * each type with an instance domain, plus singular metrics, and the
+ * handles are passed to pmiPutBatch() in a different order to the
+ * metrics and instances.
+ *
+ * With -v the time taken and values written per second are reported
+ * on stderr for each method.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include <pcp/import.h>
+#include <inttypes.h>
+
+static int	types[] = {
+    PM_TYPE_32, PM_TYPE_U32, PM_TYPE_64, PM_TYPE_U64,
+    PM_TYPE_FLOAT, PM_TYPE_DOUBLE, PM_TYPE_STRING
+};
+static char	*typename[] = {
+    "i32", "u32", "i64", "u64", "float", "double", "string"
+};
+#define NTYPES	(sizeof(types) / sizeof(types[0]))
+#define STRLEN	64	/* longest value as a string */
+
+static int	nsample = 100;
+static int	ninst = 4;
+static int	batch = 10;
+static int	verbose;
+static int	nhandle;
+static int	*handles;
+static int	*htype;		/* metric type for each handle */
+
+static void
+check(int sts, const char *name)
+{
+    if (sts < 0) {
+	fprintf(stderr, "%s: %s: %s\n", pmGetProgname(), name, pmiErrStr(sts));
+	exit(1);
+    }
+}
+
+/*
+ * Value for one handle at one sample, the same for both methods - as
+ * a string in buf for pmiPutValueHandle(), or for pmiPutBatch() in
+ * *avp when buf is NULL (strings then go in strbuf).
+ */
+static void
+value(int s, int h, pmAtomValue *avp, char *buf, size_t buflen)
+{
+    __int64_t	v = (__int64_t)s * 1000 + h;
+    char	*strbuf = buf;
+
+    if (buf == NULL) {
+	strbuf = avp->cp;
+	buflen = STRLEN;
+    }
+
+    switch (htype[h]) {
+	case PM_TYPE_32:
+	    avp->l = (__int32_t)(s % 2 ? -v : v);
+	    if (buf)
+		pmsprintf(buf, buflen, "%d", avp->l);
+	    break;
+	case PM_TYPE_U32:
+	    avp->ul = (__uint32_t)v;
+	    if (buf)
+		pmsprintf(buf, buflen, "%u", avp->ul);
+	    break;
+	case PM_TYPE_64:
+	    avp->ll = -v * 1000000000LL;
+	    if (buf)
+		pmsprintf(buf, buflen, "%" PRId64, avp->ll);
+	    break;
+	case PM_TYPE_U64:
+	    avp->ull = (__uint64_t)v * 1000000000ULL;
+	    if (buf)
+		pmsprintf(buf, buflen, "%" PRIu64, avp->ull);
+	    break;
+	case PM_TYPE_FLOAT:
+	    avp->f = (float)v / 4;
+	    if (buf)
+		pmsprintf(buf, buflen, "%.2f", (double)avp->f);
+	    break;
+	case PM_TYPE_DOUBLE:
+	    avp->d = (double)v / 8;
+	    if (buf)
+		pmsprintf(buf, buflen, "%.3f", avp->d);
+	    break;
+	case PM_TYPE_STRING:
+	    /* vary the length, so value blocks are grown and reused */
+	    pmsprintf(strbuf, buflen, "%.*s%d", (int)(v % 11), "xxxxxxxxxx", (int)v);
+	    avp->cp = strbuf;
+	    break;
+    }
+}
+
+static void
+setup(const char *archive)
+{
+    char	name[32];
+    char	inst[32];
+    pmInDom	indom = pmiInDom(245, 1);
+    int		t, i;
+
+    check(pmiStart(archive, 0), "pmiStart");
+    check(pmiSetHostname("batch.host"), "pmiSetHostname");
+    check(pmiSetTimezone("UTC"), "pmiSetTimezone");
+    for (i = 0; i < ninst; i++) {
+	pmsprintf(inst, sizeof(inst), "inst-%d", i);
+	check(pmiAddInstance(indom, inst, i * 10), "pmiAddInstance");
+    }
+    for (t = 0; t < NTYPES; t++) {
+	pmsprintf(name, sizeof(name), "batch.indom.%s", typename[t]);
+	check(pmiAddMetric(name, pmiID(245, 0, t), types[t], indom,
+			PM_SEM_INSTANT, pmiUnits(0,0,0,0,0,0)), "pmiAddMetric");
+	pmsprintf(name, sizeof(name), "batch.single.%s", typename[t]);
+	check(pmiAddMetric(name, pmiID(245, 1, t), types[t], PM_INDOM_NULL,
+			PM_SEM_INSTANT, pmiUnits(0,0,0,0,0,0)), "pmiAddMetric");
+    }
+
+    /* handles in reverse, so pmiPutBatch() has to reorder them */
+    nhandle = 0;
+    for (t = NTYPES-1; t >= 0; t--) {
+	pmsprintf(name, sizeof(name), "batch.indom.%s", typename[t]);
+	for (i = ninst-1; i >= 0; i--) {
+	    pmsprintf(inst, sizeof(inst), "inst-%d", i);
+	    htype[nhandle] = types[t];
+	    check(handles[nhandle++] = pmiGetHandle(name, inst), "pmiGetHandle");
+	}
+	pmsprintf(name, sizeof(name), "batch.single.%s", typename[t]);
+	htype[nhandle] = types[t];
+	check(handles[nhandle++] = pmiGetHandle(name, NULL), "pmiGetHandle");
+    }
+}
+
+static void
+report(const char *method, struct timeval *start)
+{
+    struct timeval	end;
+    double		elapsed;
+
+    pmtimevalNow(&end);
+    elapsed = pmtimevalSub(&end, start);
+    if (verbose)
+	fprintf(stderr, "%s: %.3f sec, %.0f values/sec\n", method, elapsed,
+		(double)nsample * nhandle / elapsed);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct timeval	start;
+    struct timeval	*stamps;
+    pmAtomValue		*values;
+    pmAtomValue		av;
+    pmAtomValue		ev[2];
+    struct timeval	es[2];
+    char		*strings;
+    char		buf[STRLEN];
+    int			c, h, s, k, n;
+    int			sts;
+    int			errflag = 0;
+    static char		*usage = "[-v] [-b batch] [-D debug] [-i instances] [-n samples] archive1 archive2";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "b:D:i:n:v")) != EOF) {
+	switch (c) {
+
+	case 'b':	/* timestamps per pmiPutBatch */
+	    batch = atoi(optarg);
+	    break;
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'i':	/* instances per metric */
+	    ninst = atoi(optarg);
+	    break;
+
+	case 'n':	/* samples */
+	    nsample = atoi(optarg);
+	    break;
+
+	case 'v':	/* report timing */
+	    verbose = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc-2 || batch < 1 || ninst < 1 || nsample < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    n = NTYPES * (ninst + 1);
+    handles = (int *)malloc(n * sizeof(int));
+    htype = (int *)malloc(n * sizeof(int));
+    stamps = (struct timeval *)malloc(batch * sizeof(struct timeval));
+    values = (pmAtomValue *)malloc((size_t)batch * n * sizeof(pmAtomValue));
+    strings = (char *)malloc((size_t)batch * n * STRLEN);
+    if (handles == NULL || htype == NULL || stamps == NULL ||
+	values == NULL || strings == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+
+    /* one value at a time */
+    setup(argv[optind]);
+    pmtimevalNow(&start);
+    for (s = 0; s < nsample; s++) {
+	for (h = 0; h < nhandle; h++) {
+	    value(s, h, &av, buf, sizeof(buf));
+	    check(pmiPutValueHandle(handles[h], buf), "pmiPutValueHandle");
+	}
+	check(pmiWrite(1600000000 + s, (s % 10) * 100000), "pmiWrite");
+    }
+    check(pmiEnd(), "pmiEnd");
+    report("pmiPutValueHandle", &start);
+
+    /* batches of timestamps */
+    setup(argv[optind+1]);
+    pmtimevalNow(&start);
+    for (s = 0; s < nsample; s += k) {
+	for (k = 0; k < batch && s + k < nsample; k++) {
+	    stamps[k].tv_sec = 1600000000 + s + k;
+	    stamps[k].tv_usec = ((s + k) % 10) * 100000;
+	    for (h = 0; h < nhandle; h++) {
+		values[k * nhandle + h].cp = &strings[(k * nhandle + h) * STRLEN];
+		value(s + k, h, &values[k * nhandle + h], NULL, 0);
+	    }
+	}
+	check(pmiPutBatch(k, stamps, nhandle, handles, values), "pmiPutBatch");
+    }
+    check(pmiEnd(), "pmiEnd");
+    report("pmiPutBatch", &start);
+
+    /* error cases */
+    check(pmiStart("/dev/null/nowhere", 0), "pmiStart");
+    h = 12345;
+    sts = pmiPutBatch(1, stamps, 1, &h, values);
+    printf("bad handle: %s\n", pmiErrStr(sts));
+    check(pmiAddMetric("batch.single", pmiID(245, 2, 0), PM_TYPE_32, PM_INDOM_NULL,
+			PM_SEM_INSTANT, pmiUnits(0,0,0,0,0,0)), "pmiAddMetric");
+    check(handles[0] = pmiGetHandle("batch.single", NULL), "pmiGetHandle");
+    handles[1] = handles[0];
+    sts = pmiPutBatch(1, stamps, 2, handles, values);
+    printf("same handle twice: %s\n", pmiErrStr(sts));
+    sts = pmiPutBatch(0, stamps, 1, handles, values);
+    printf("no timestamps: %s\n", pmiErrStr(sts));
+
+    /* a bad value late in a batch must not leave earlier records written */
+    pmsprintf(buf, sizeof(buf), "%s.err", argv[optind+1]);
+    check(pmiStart(buf, 0), "pmiStart");
+    check(pmiAddMetric("batch.string", pmiID(245, 3, 0), PM_TYPE_STRING,
+			PM_INDOM_NULL, PM_SEM_INSTANT, pmiUnits(0,0,0,0,0,0)),
+			"pmiAddMetric");
+    check(h = pmiGetHandle("batch.string", NULL), "pmiGetHandle");
+    es[0].tv_sec = 1600000001;
+    es[1].tv_sec = 1600000002;
+    es[0].tv_usec = es[1].tv_usec = 0;
+    ev[0].cp = "first";
+    ev[1].cp = NULL;
+    sts = pmiPutBatch(2, es, 1, &h, ev);
+    printf("NULL string: %s\n", pmiErrStr(sts));
+    es[0].tv_sec = 1600000000;
+    ev[1].cp = "second";
+    sts = pmiPutBatch(2, es, 1, &h, ev);
+    printf("earlier batch after NULL string: %s\n", pmiErrStr(sts));
+    check(pmiEnd(), "pmiEnd");
+
+    exit(0);
+}
@@ -0,0 +1,289 @@
+/*
+ * Record samples in an MMV histogram from several threads, then check
+ * the sample count, sum, bucket counts and percentiles reported by the
+ * mmv PMDA (loaded as a DSO) against the samples recorded.
+ * With -v the sample rate is reported on stderr.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include "libpcp.h"
+#include <pcp/pmda.h>
+#include <pcp/mmv_stats.h>
+#include <pcp/mmv_dev.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <dlfcn.h>
+
+#define CLUSTER	323
+#define DOMAIN	70
+#define RANGE	10000	/* samples are uniform over 0 .. RANGE-1 */
+#define OUTLIER	123456789
+
+static int		nthreads = 4;
+static long		nsamples = 100000;
+static void		*addr;
+static mmv_handle_t	*handle;
+
+static __uint64_t
+sample(long thread, long i)
+{
+    return (__uint64_t)((i * 7919 + thread) % RANGE);
+}
+
+static void *
+record(void *arg)
+{
+    long		thread = (long)arg;
+    long		i;
+
+    for (i = 0; i < nsamples; i++)
+	mmv_handle_observe(handle, sample(thread, i));
+    return NULL;
+}
+
+static pmdaInterface	dispatch;
+
+static pmResult *
+fetch(const char *name, pmDesc *desc)
+{
+    pmResult		*rp;
+    pmID		pmid;
+    int			sts;
+
+    if ((sts = dispatch.version.seven.pmid((char *)name, &pmid,
+				dispatch.version.seven.ext)) < 0 ||
+	(sts = dispatch.version.seven.desc(pmid, desc,
+				dispatch.version.seven.ext)) < 0 ||
+	(sts = dispatch.version.seven.fetch(1, &pmid, &rp,
+				dispatch.version.seven.ext)) < 0) {
+	fprintf(stderr, "%s: %s: %s\n", pmGetProgname(), name, pmErrStr(sts));
+	exit(1);
+    }
+    return rp;
+}
+
+/* derived metric indoms are per-cluster, like client indoms */
+static int
+check_indom(const char *kind, pmDesc *desc)
+{
+    if (desc->indom == PM_INDOM_NULL ||
+	(pmInDom_serial(desc->indom) >> 11) != CLUSTER) {
+	printf("%s indom %s not in cluster %d\n", kind,
+		pmInDomStr(desc->indom), CLUSTER);
+	return 1;
+    }
+    return 0;
+}
+
+static int
+verify(const char *dso)
+{
+    void		(*init)(pmdaInterface *);
+    void		*dl;
+    pmResult		*rp;
+    pmValueSet		*vsp;
+    pmAtomValue		atom;
+    pmDesc		desc;
+    __uint64_t		expect[MMV_HISTOGRAM_BUCKETS] = { 0 };
+    __uint64_t		count = 0, sum = 0, rank, seen;
+    long		t, i;
+    int			b, j, nbad = 0;
+
+    if ((dl = dlopen(dso, RTLD_NOW)) == NULL) {
+	fprintf(stderr, "%s: dlopen: %s\n", pmGetProgname(), dlerror());
+	exit(1);
+    }
+    if ((init = (void (*)(pmdaInterface *))dlsym(dl, "mmv_init")) == NULL) {
+	fprintf(stderr, "%s: dlsym: %s\n", pmGetProgname(), dlerror());
+	exit(1);
+    }
+    dispatch.domain = DOMAIN;
+    init(&dispatch);
+    if (dispatch.status < 0) {
+	fprintf(stderr, "%s: mmv_init: %s\n", pmGetProgname(), pmErrStr(dispatch.status));
+	exit(1);
+    }
+
+    for (t = 0; t < nthreads; t++) {
+	for (i = 0; i < nsamples; i++) {
+	    expect[mmv_histogram_bucket(sample(t, i))]++;
+	    sum += sample(t, i);
+	    count++;
+	}
+    }
+    expect[mmv_histogram_bucket(OUTLIER)]++;
+    sum += OUTLIER;
+    count++;
+
+    rp = fetch("mmv.histogram.latency.count", &desc);
+    pmExtractValue(rp->vset[0]->valfmt, &rp->vset[0]->vlist[0],
+			PM_TYPE_U64, &atom, PM_TYPE_U64);
+    printf("count %" PRIu64 "\n", atom.ull);
+    if (atom.ull != count) {
+	printf("expected count %" PRIu64 "\n", count);
+	nbad++;
+    }
+    __pmFreeResultValues(rp);
+
+    rp = fetch("mmv.histogram.latency.sum", &desc);
+    pmExtractValue(rp->vset[0]->valfmt, &rp->vset[0]->vlist[0],
+			PM_TYPE_U64, &atom, PM_TYPE_U64);
+    printf("sum %" PRIu64 "\n", atom.ull);
+    if (atom.ull != sum) {
+	printf("expected sum %" PRIu64 "\n", sum);
+	nbad++;
+    }
+    __pmFreeResultValues(rp);
+
+    rp = fetch("mmv.histogram.latency.bucket", &desc);
+    nbad += check_indom("bucket", &desc);
+    vsp = rp->vset[0];
+    for (b = j = 0; b < MMV_HISTOGRAM_BUCKETS; b++)
+	if (expect[b])
+	    j++;
+    printf("%d buckets\n", vsp->numval);
+    if (vsp->numval != j) {
+	printf("expected %d buckets\n", j);
+	nbad++;
+    }
+    for (j = 0; j < vsp->numval; j++) {
+	b = vsp->vlist[j].inst;
+	pmExtractValue(vsp->valfmt, &vsp->vlist[j], PM_TYPE_U64, &atom, PM_TYPE_U64);
+	if (b < 0 || b >= MMV_HISTOGRAM_BUCKETS || atom.ull != expect[b]) {
+	    printf("bucket %d: %" PRIu64 "\n", b, atom.ull);
+	    nbad++;
+	}
+    }
+    __pmFreeResultValues(rp);
+
+    rp = fetch("mmv.histogram.latency.percentile", &desc);
+    nbad += check_indom("percentile", &desc);
+    vsp = rp->vset[0];
+    for (j = 0; j < vsp->numval; j++) {
+	pmExtractValue(vsp->valfmt, &vsp->vlist[j], PM_TYPE_DOUBLE, &atom, PM_TYPE_DOUBLE);
+	/* the exact sample value of this rank, from the expected buckets */
+	rank = (count * vsp->vlist[j].inst + 999) / 1000;
+	for (b = 0, seen = 0; b < MMV_HISTOGRAM_BUCKETS; b++) {
+	    if ((seen += expect[b]) >= rank)
+		break;
+	}
+	printf("%.1f%%: %.1f\n", vsp->vlist[j].inst / 10.0, atom.d);
+	if (b == MMV_HISTOGRAM_BUCKETS ||
+	    atom.d < mmv_histogram_lower(b) || atom.d > mmv_histogram_upper(b)) {
+	    printf("percentile not in bucket %d\n", b);
+	    nbad++;
+	}
+    }
+    __pmFreeResultValues(rp);
+    return nbad;
+}
+
+int
+main(int argc, char **argv)
+{
+    mmv_registry_t	*registry;
+    mmv_stats_flags_t	flags = 0;
+    pmUnits		units = MMV_UNITS(0,1,0,0,PM_TIME_USEC,0);
+    pthread_t		*threads;
+    struct timeval	start, end;
+    double		elapsed;
+    long		t;
+    int			c, sts;
+    int			nshards = 0;
+    int			errflag = 0;
+    int			verbose = 0;
+    static char		*usage = "[-v] [-D debug] [-n samples] [-s shards] [-t threads] pmda_mmv.so";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "D:n:s:t:v")) != EOF) {
+	switch (c) {
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'n':
+	    nsamples = atol(optarg);
+	    break;
+
+	case 's':
+	    nshards = atoi(optarg);
+	    break;
+
+	case 't':
+	    nthreads = atoi(optarg);
+	    break;
+
+	case 'v':	/* report sample rate */
+	    verbose = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc - 1 || nsamples < 1 || nthreads < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    if ((registry = mmv_stats_registry("histogram", CLUSTER, flags)) == NULL) {
+	fprintf(stderr, "mmv_stats_registry: %s\n", osstrerror());
+	exit(1);
+    }
+    if (nshards > 0 && mmv_stats_set_shards(registry, nshards) < 0) {
+	fprintf(stderr, "mmv_stats_set_shards: %s\n", osstrerror());
+	exit(1);
+    }
+    mmv_stats_add_metric(registry, "latency", 1, MMV_TYPE_HISTOGRAM,
+		MMV_SEM_COUNTER, units, 0, "Request latency", NULL);
+    if ((addr = mmv_stats_start(registry)) == NULL) {
+	fprintf(stderr, "mmv_stats_start: %s\n", osstrerror());
+	exit(1);
+    }
+    if ((handle = mmv_lookup_handle(addr, "latency", NULL)) == NULL) {
+	fprintf(stderr, "mmv_lookup_handle: %s\n", osstrerror());
+	exit(1);
+    }
+    if ((threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t))) == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+
+    pmtimevalNow(&start);
+    for (t = 0; t < nthreads; t++) {
+	if ((sts = pthread_create(&threads[t], NULL, record, (void *)t)) != 0) {
+	    fprintf(stderr, "pthread_create: %s\n", pmErrStr(-sts));
+	    exit(1);
+	}
+    }
+    for (t = 0; t < nthreads; t++)
+	pthread_join(threads[t], NULL);
+    pmtimevalNow(&end);
+    elapsed = pmtimevalSub(&end, &start);
+
+    /* one more sample, by name rather than through the handle */
+    mmv_stats_add(addr, "latency", NULL, OUTLIER);
+
+    printf("%d threads, %ld samples each\n", nthreads, nsamples);
+    if (verbose)
+	fprintf(stderr, "%.0f samples/sec\n",
+		elapsed > 0 ? nthreads * nsamples / elapsed : 0);
+
+    if (verify(argv[optind]) != 0)
+	exit(1);
+    printf("values ok\n");
+
+    mmv_handle_free(handle);
+    mmv_stats_free(registry);
+    exit(0);
+}
@@ -0,0 +1,227 @@
+/*
+ * Fetch every value from a large synthetic MMV file through the mmv
+ * PMDA (loaded as a DSO), checking each value matches what was set.
+ * With -v the fetch rate is reported on stderr.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include "libpcp.h"
+#include <pcp/pmda.h>
+#include <pcp/mmv_stats.h>
+#include <pcp/mmv_dev.h>
+#include <inttypes.h>
+#include <dlfcn.h>
+
+#define CLUSTER	321
+#define DOMAIN	70
+
+static int	nmetrics = 500;
+static int	ninst = 20;
+static int	niter = 10;
+static int	longnames;
+
+static __uint64_t
+expect(unsigned int item, unsigned int inst)
+{
+    return (__uint64_t)item * 1000000 + inst;
+}
+
+/*
+ * Every even-numbered item is singular, odd items have instances.
+ * Long metric names force version 2 of the on-disk format.
+ */
+static void *
+create(void)
+{
+    mmv_registry_t	*registry;
+    mmv_disk_header_t	*hdr;
+    mmv_disk_toc_t	*toc;
+    mmv_disk_value_t	*v;
+    mmv_disk_metric_t	*m1;
+    mmv_disk_metric2_t	*m2;
+    mmv_disk_instance_t	*i1;
+    mmv_disk_instance2_t *i2;
+    pmUnits		units = MMV_UNITS(0,0,1,0,0,PM_COUNT_ONE);
+    char		name[MMV_NAMEMAX * 2];
+    void		*addr;
+    __uint32_t		item, indom, inst;
+    int			i, j;
+
+    if ((registry = mmv_stats_registry("index", CLUSTER, 0)) == NULL) {
+	fprintf(stderr, "mmv_stats_registry: %s\n", osstrerror());
+	exit(1);
+    }
+    mmv_stats_add_indom(registry, 1, "instances", NULL);
+    for (i = 0; i < ninst; i++) {
+	pmsprintf(name, sizeof(name), "inst%05d", i);
+	mmv_stats_add_instance(registry, 1, i, strdup(name));
+    }
+    for (i = 1; i <= nmetrics; i++) {
+	pmsprintf(name, sizeof(name), "metric%05d%s", i, longnames ?
+		".with_a_long_name_that_does_not_fit_in_a_version_one_file" : "");
+	mmv_stats_add_metric(registry, strdup(name), i, MMV_TYPE_U64,
+		MMV_SEM_COUNTER, units, (i % 2) ? 1 : 0, NULL, NULL);
+    }
+    if ((addr = mmv_stats_start(registry)) == NULL) {
+	fprintf(stderr, "mmv_stats_start: %s\n", osstrerror());
+	exit(1);
+    }
+
+    /* registry names are not copied, so are not freed here either */
+
+    /* walk the values on disk, rather than O(N^2) name lookups */
+    hdr = (mmv_disk_header_t *)addr;
+    toc = (mmv_disk_toc_t *)((char *)addr + sizeof(mmv_disk_header_t));
+    for (i = 0; i < hdr->tocs; i++) {
+	if (toc[i].type != MMV_TOC_VALUES)
+	    continue;
+	v = (mmv_disk_value_t *)((char *)addr + toc[i].offset);
+	for (j = 0; j < toc[i].count; j++) {
+	    if (hdr->version == MMV_VERSION1) {
+		m1 = (mmv_disk_metric_t *)((char *)addr + v[j].metric);
+		i1 = (mmv_disk_instance_t *)((char *)addr + v[j].instance);
+		item = m1->item;
+		indom = m1->indom;
+		inst = (indom == 0 || indom == PM_INDOM_NULL) ? 0 : i1->internal;
+	    } else {
+		m2 = (mmv_disk_metric2_t *)((char *)addr + v[j].metric);
+		i2 = (mmv_disk_instance2_t *)((char *)addr + v[j].instance);
+		item = m2->item;
+		indom = m2->indom;
+		inst = (indom == 0 || indom == PM_INDOM_NULL) ? 0 : i2->internal;
+	    }
+	    v[j].value.ull = expect(item, inst);
+	}
+    }
+    return addr;
+}
+
+int
+main(int argc, char **argv)
+{
+    pmdaInterface	dispatch = { 0 };
+    void		(*init)(pmdaInterface *);
+    void		*handle;
+    pmResult		*rp;
+    pmValueSet		*vsp;
+    pmAtomValue		atom;
+    pmID		*pmidlist;
+    struct timeval	start, end;
+    unsigned int	item, inst;
+    long		nvalues = 0, nbad = 0;
+    double		elapsed;
+    int			c, i, j, k, sts;
+    int			errflag = 0;
+    int			verbose = 0;
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "D:i:lm:n:v")) != EOF) {
+	switch (c) {
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'i':
+	    ninst = atoi(optarg);
+	    break;
+
+	case 'l':	/* long metric names */
+	    longnames = 1;
+	    break;
+
+	case 'm':
+	    nmetrics = atoi(optarg);
+	    break;
+
+	case 'n':
+	    niter = atoi(optarg);
+	    break;
+
+	case 'v':	/* report fetch rate */
+	    verbose = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc - 1 || ninst < 1 || nmetrics < 1 || niter < 1) {
+	fprintf(stderr, "Usage: %s [-lv] [-D debug] [-i instances] [-m metrics] [-n iterations] pmda_mmv.so\n",
+		pmGetProgname());
+	exit(1);
+    }
+
+    create();
+
+    if ((handle = dlopen(argv[optind], RTLD_NOW)) == NULL) {
+	fprintf(stderr, "%s: dlopen: %s\n", pmGetProgname(), dlerror());
+	exit(1);
+    }
+    if ((init = (void (*)(pmdaInterface *))dlsym(handle, "mmv_init")) == NULL) {
+	fprintf(stderr, "%s: dlsym: %s\n", pmGetProgname(), dlerror());
+	exit(1);
+    }
+    dispatch.domain = DOMAIN;
+    init(&dispatch);
+    if (dispatch.status < 0) {
+	fprintf(stderr, "%s: mmv_init: %s\n", pmGetProgname(), pmErrStr(dispatch.status));
+	exit(1);
+    }
+
+    if ((pmidlist = (pmID *)malloc(nmetrics * sizeof(pmID))) == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+    for (i = 0; i < nmetrics; i++)
+	pmidlist[i] = pmID_build(DOMAIN, CLUSTER, i + 1);
+
+    pmtimevalNow(&start);
+    for (i = 0; i < niter; i++) {
+	sts = dispatch.version.seven.fetch(nmetrics, pmidlist, &rp, dispatch.version.seven.ext);
+	if (sts < 0) {
+	    fprintf(stderr, "%s: fetch: %s\n", pmGetProgname(), pmErrStr(sts));
+	    exit(1);
+	}
+	for (j = 0; j < rp->numpmid; j++) {
+	    vsp = rp->vset[j];
+	    item = pmID_item(vsp->pmid);
+	    if (vsp->numval != ((item % 2) ? ninst : 1)) {
+		if (nbad++ < 10)
+		    printf("item %u: numval %d\n", item, vsp->numval);
+		continue;
+	    }
+	    for (k = 0; k < vsp->numval; k++) {
+		inst = (item % 2) ? vsp->vlist[k].inst : 0;
+		pmExtractValue(vsp->valfmt, &vsp->vlist[k], PM_TYPE_U64,
+				&atom, PM_TYPE_U64);
+		if (atom.ull != expect(item, inst) && nbad++ < 10)
+		    printf("item %u inst %u: value %" PRIu64 "\n",
+				item, inst, atom.ull);
+	    }
+	    nvalues += vsp->numval;
+	}
+	__pmFreeResultValues(rp);
+    }
+    pmtimevalNow(&end);
+    elapsed = pmtimevalSub(&end, &start);
+
+    printf("%d metrics, %ld values\n", nmetrics, nvalues / niter);
+    if (verbose)
+	fprintf(stderr, "%.0f values/sec\n", elapsed > 0 ? nvalues / elapsed : 0);
+    if (nbad) {
+	printf("%ld bad values\n", nbad);
+	exit(1);
+    }
+    printf("values ok\n");
+    exit(0);
+}
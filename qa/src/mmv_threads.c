@@ -0,0 +1,271 @@
+/*
+ * Multi-threaded MMV counter updates - by name, through handles, and
+ * through handles to padded per-thread shards.  Totals are checked by
+ * fetching through the mmv PMDA (loaded as a DSO), which sums shards.
+ * With shards, counters are then set by name and checked again, as
+ * the other shards of a value set that way must be cleared.
+ * With -v the update rate is reported on stderr.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include "libpcp.h"
+#include <pcp/pmda.h>
+#include <pcp/mmv_stats.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <dlfcn.h>
+
+#define CLUSTER	322
+#define DOMAIN	70
+
+static int		nthreads = 4;
+static int		ncounters = 16;
+static long		nupdates = 100000;
+static void		*addr;
+static mmv_handle_t	**handles;
+static char		**names;
+static enum { BYNAME, HANDLE, SHARDED } mode;
+static int		byname_set;	/* counters set by name to c */
+static pmdaInterface	dispatch;
+
+static void *
+update(void *arg)
+{
+    long		thread = (long)arg;
+    long		i;
+    int			c;
+
+    for (i = 0; i < nupdates; i++) {
+	c = (thread + i) % ncounters;
+	if (mode == BYNAME)
+	    mmv_stats_inc(addr, names[c], NULL);
+	else
+	    mmv_handle_add(handles[c], 1);
+    }
+    return NULL;
+}
+
+/*
+ * Counter c is updated once for each (thread, i) pair with
+ * (thread + i) % ncounters == c.
+ */
+static __uint64_t
+expect(int c)
+{
+    __uint64_t		count = 0;
+    long		t;
+
+    if (byname_set)
+	return c;
+    for (t = 0; t < nthreads; t++)
+	count += nupdates / ncounters +
+		 ((c - t % ncounters + ncounters) % ncounters < nupdates % ncounters);
+    return count;
+}
+
+static void
+load(const char *dso)
+{
+    void		(*init)(pmdaInterface *);
+    void		*handle;
+
+    if ((handle = dlopen(dso, RTLD_NOW)) == NULL) {
+	fprintf(stderr, "%s: dlopen: %s\n", pmGetProgname(), dlerror());
+	exit(1);
+    }
+    if ((init = (void (*)(pmdaInterface *))dlsym(handle, "mmv_init")) == NULL) {
+	fprintf(stderr, "%s: dlsym: %s\n", pmGetProgname(), dlerror());
+	exit(1);
+    }
+    dispatch.domain = DOMAIN;
+    init(&dispatch);
+    if (dispatch.status < 0) {
+	fprintf(stderr, "%s: mmv_init: %s\n", pmGetProgname(), pmErrStr(dispatch.status));
+	exit(1);
+    }
+}
+
+static int
+verify(void)
+{
+    pmResult		*rp;
+    pmValueSet		*vsp;
+    pmAtomValue		atom;
+    pmID		*pmidlist;
+    __uint64_t		total = 0;
+    int			i, sts, nbad = 0;
+
+    if ((pmidlist = (pmID *)malloc(ncounters * sizeof(pmID))) == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+    for (i = 0; i < ncounters; i++)
+	pmidlist[i] = pmID_build(DOMAIN, CLUSTER, i + 1);
+    sts = dispatch.version.seven.fetch(ncounters, pmidlist, &rp, dispatch.version.seven.ext);
+    if (sts < 0) {
+	fprintf(stderr, "%s: fetch: %s\n", pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+    for (i = 0; i < rp->numpmid; i++) {
+	vsp = rp->vset[i];
+	if (vsp->numval != 1) {
+	    printf("counter%d: numval %d\n", i, vsp->numval);
+	    nbad++;
+	    continue;
+	}
+	pmExtractValue(vsp->valfmt, &vsp->vlist[0], PM_TYPE_U64, &atom, PM_TYPE_U64);
+	if (atom.ull != expect(i)) {
+	    printf("counter%d: %" PRIu64 ", expected %" PRIu64 "\n",
+			i, atom.ull, expect(i));
+	    nbad++;
+	}
+	total += atom.ull;
+    }
+    __pmFreeResultValues(rp);
+    free(pmidlist);
+
+    printf("total %" PRIu64 "\n", total);
+    return nbad;
+}
+
+int
+main(int argc, char **argv)
+{
+    mmv_registry_t	*registry;
+    mmv_stats_flags_t	flags = 0;
+    pmUnits		units = MMV_UNITS(0,0,1,0,0,PM_COUNT_ONE);
+    pthread_t		*threads;
+    struct timeval	start, end;
+    char		name[64];
+    double		elapsed;
+    long		t;
+    int			c, i, sts;
+    int			errflag = 0;
+    int			verbose = 0;
+    static char		*usage = "[-v] [-D debug] [-c counters] [-m byname|handle|sharded] [-n updates] [-t threads] pmda_mmv.so";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "c:D:m:n:t:v")) != EOF) {
+	switch (c) {
+
+	case 'c':
+	    ncounters = atoi(optarg);
+	    break;
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'm':
+	    if (strcmp(optarg, "byname") == 0)
+		mode = BYNAME;
+	    else if (strcmp(optarg, "handle") == 0)
+		mode = HANDLE;
+	    else if (strcmp(optarg, "sharded") == 0)
+		mode = SHARDED;
+	    else
+		errflag++;
+	    break;
+
+	case 'n':
+	    nupdates = atol(optarg);
+	    break;
+
+	case 't':
+	    nthreads = atoi(optarg);
+	    break;
+
+	case 'v':	/* report update rate */
+	    verbose = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc - 1 ||
+	ncounters < 1 || nupdates < 1 || nthreads < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    if (mode != BYNAME)
+	flags |= MMV_FLAG_PADDED;
+    if ((registry = mmv_stats_registry("threads", CLUSTER, flags)) == NULL) {
+	fprintf(stderr, "mmv_stats_registry: %s\n", osstrerror());
+	exit(1);
+    }
+    if (mode == SHARDED && mmv_stats_set_shards(registry, nthreads) < 0) {
+	fprintf(stderr, "mmv_stats_set_shards: %s\n", osstrerror());
+	exit(1);
+    }
+    names = (char **)malloc(ncounters * sizeof(char *));
+    handles = (mmv_handle_t **)malloc(ncounters * sizeof(mmv_handle_t *));
+    threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+    if (names == NULL || handles == NULL || threads == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+    for (i = 0; i < ncounters; i++) {
+	pmsprintf(name, sizeof(name), "counter%d", i);
+	names[i] = strdup(name);
+	mmv_stats_add_metric(registry, names[i], i + 1, MMV_TYPE_U64,
+		MMV_SEM_COUNTER, units, 0, NULL, NULL);
+    }
+    if ((addr = mmv_stats_start(registry)) == NULL) {
+	fprintf(stderr, "mmv_stats_start: %s\n", osstrerror());
+	exit(1);
+    }
+    for (i = 0; i < ncounters; i++) {
+	if ((handles[i] = mmv_lookup_handle(addr, names[i], NULL)) == NULL) {
+	    fprintf(stderr, "mmv_lookup_handle(%s): %s\n", names[i], osstrerror());
+	    exit(1);
+	}
+    }
+
+    pmtimevalNow(&start);
+    for (t = 0; t < nthreads; t++) {
+	if ((sts = pthread_create(&threads[t], NULL, update, (void *)t)) != 0) {
+	    fprintf(stderr, "pthread_create: %s\n", pmErrStr(-sts));
+	    exit(1);
+	}
+    }
+    for (t = 0; t < nthreads; t++)
+	pthread_join(threads[t], NULL);
+    pmtimevalNow(&end);
+    elapsed = pmtimevalSub(&end, &start);
+
+    printf("%d threads, %d counters, %ld updates each\n",
+		nthreads, ncounters, nupdates);
+    if (verbose)
+	fprintf(stderr, "%.0f updates/sec\n",
+		elapsed > 0 ? nthreads * nupdates / elapsed : 0);
+
+    load(argv[optind]);
+    if (verify() != 0)
+	exit(1);
+    printf("values ok\n");
+
+    if (mode == SHARDED) {
+	byname_set = 1;
+	for (i = 0; i < ncounters; i++)
+	    mmv_stats_set(addr, names[i], NULL, i);
+	if (verify() != 0)
+	    exit(1);
+	printf("values set by name ok\n");
+    }
+
+    for (i = 0; i < ncounters; i++)
+	mmv_handle_free(handles[i]);
+    mmv_stats_free(registry);
+    exit(0);
+}
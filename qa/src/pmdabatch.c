@@ -0,0 +1,270 @@
+/*
+ * Compare pmdaFetch throughput using a per-value pmdaFetchCallBack
+ * and a pmdaFetchBatchCallBack, checking both produce the same values.
+ * With -r the PMDA replaces the result callback with one that frees
+ * each value set separately.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include "libpcp.h"
+#include <pcp/pmda.h>
+
+static int		nmetrics = 100;
+static int		ninst = 100;
+static int		niter = 100;
+
+static pmdaInstid	*insttab;
+static pmdaIndom	indomtab[1];
+static pmdaMetric	*metrictab;
+
+static const int	types[] = {
+    PM_TYPE_U64, PM_TYPE_32, PM_TYPE_DOUBLE, PM_TYPE_STRING
+};
+
+static void
+value(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
+{
+    unsigned int	item = pmID_item(mdesc->m_desc.pmid);
+    unsigned int	v = item * 1000 + inst;
+
+    switch (mdesc->m_desc.type) {
+	case PM_TYPE_U64:
+	    atom->ull = (__uint64_t)v << 32;
+	    break;
+	case PM_TYPE_32:
+	    atom->l = -(int)v;
+	    break;
+	case PM_TYPE_DOUBLE:
+	    atom->d = v / 4.0;
+	    break;
+	case PM_TYPE_STRING:
+	    atom->cp = insttab[inst].i_name;
+	    break;
+	default:	/* singular metric */
+	    atom->ul = ninst;
+	    break;
+    }
+}
+
+static int
+fetch_callback(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
+{
+    value(mdesc, inst, atom);
+    return PMDA_FETCH_STATIC;
+}
+
+static int
+batch_callback(pmdaFetchBatch *batch)
+{
+    pmdaMetric		*mdesc;
+    int			i, k;
+
+    for (i = 0; i < batch->numpmid; i++) {
+	if ((mdesc = batch->metrics[i]) == NULL)
+	    continue;
+	for (k = batch->offset[i]; k < batch->offset[i] + batch->numinst[i]; k++) {
+	    value(mdesc, batch->instlist[k], &batch->values[k]);
+	    batch->status[k] = PMDA_FETCH_STATIC;
+	}
+    }
+    return 0;
+}
+
+/* result callback releasing value sets one at a time, not in one unpin */
+static void
+free_result(pmResult *rp)
+{
+    pmValueSet		*vsp;
+    int			i, j;
+
+    for (i = 0; i < rp->numpmid; i++) {
+	vsp = rp->vset[i];
+	if (vsp->valfmt == PM_VAL_DPTR) {
+	    for (j = 0; j < vsp->numval; j++)
+		free(vsp->vlist[j].value.pval);
+	}
+	free(vsp);
+    }
+}
+
+/*
+ * Order-sensitive checksum of everything in the result.
+ */
+static unsigned int
+checksum(pmResult *rp, unsigned int sum)
+{
+    pmValueSet		*vsp;
+    pmValue		*vp;
+    unsigned char	*p;
+    int			i, j, n;
+
+    for (i = 0; i < rp->numpmid; i++) {
+	vsp = rp->vset[i];
+	sum = sum * 31 + vsp->pmid;
+	sum = sum * 31 + vsp->numval;
+	for (j = 0; j < vsp->numval; j++) {
+	    vp = &vsp->vlist[j];
+	    sum = sum * 31 + vp->inst;
+	    if (vsp->valfmt == PM_VAL_INSITU) {
+		sum = sum * 31 + vp->value.lval;
+		continue;
+	    }
+	    p = (unsigned char *)vp->value.pval;
+	    for (n = 0; n < vp->value.pval->vlen; n++)
+		sum = sum * 31 + p[n];
+	}
+    }
+    return sum;
+}
+
+static unsigned int
+run(const char *mode, pmdaInterface *dispatch, int numpmid, pmID *pmidlist)
+{
+    pmdaExt		*pmda = dispatch->version.any.ext;
+    pmResult		*rp;
+    struct timeval	start, end;
+    unsigned int	sum = 0;
+    double		elapsed;
+    long		nvalues = 0;
+    int			i, j, sts;
+
+    pmtimevalNow(&start);
+    for (i = 0; i < niter; i++) {
+	sts = dispatch->version.any.fetch(numpmid, pmidlist, &rp, pmda);
+	if (sts < 0) {
+	    fprintf(stderr, "%s: fetch failed: %s\n", mode, pmErrStr(sts));
+	    exit(1);
+	}
+	for (j = 0; j < rp->numpmid; j++)
+	    if (rp->vset[j]->numval > 0)
+		nvalues += rp->vset[j]->numval;
+	sum = checksum(rp, sum);
+	pmda->e_resultCallBack(rp);
+    }
+    pmtimevalNow(&end);
+    elapsed = pmtimevalSub(&end, &start);
+
+    printf("%s: %ld values\n", mode, nvalues / niter);
+    if (pmDebugOptions.appl0)
+	fprintf(stderr, "%s: %.0f values/sec\n", mode,
+		elapsed > 0 ? nvalues / elapsed : 0);
+    return sum;
+}
+
+int
+main(int argc, char **argv)
+{
+    pmdaInterface	dispatch = { 0 };
+    pmID		*pmidlist;
+    char		name[32];
+    int			dso = 0;
+    int			own = 0;
+    int			errflag = 0;
+    unsigned int	sum;
+    int			c, i, sts;
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "dD:i:m:n:r")) != EOF) {
+	switch (c) {
+
+	case 'd':	/* DSO rather than daemon PMDA */
+	    dso = 1;
+	    break;
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'i':
+	    ninst = atoi(optarg);
+	    break;
+
+	case 'm':
+	    nmetrics = atoi(optarg);
+	    break;
+
+	case 'n':
+	    niter = atoi(optarg);
+	    break;
+
+	case 'r':	/* PMDA frees results itself */
+	    own = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc || ninst < 1 || nmetrics < 1 || niter < 1) {
+	fprintf(stderr, "Usage: %s [-d] [-D debug] [-i instances] [-m metrics] [-n iterations] [-r]\n",
+		pmGetProgname());
+	exit(1);
+    }
+
+    insttab = (pmdaInstid *)malloc(ninst * sizeof(pmdaInstid));
+    metrictab = (pmdaMetric *)calloc(nmetrics, sizeof(pmdaMetric));
+    /* one more pmid than metrics, to include one that is unknown */
+    pmidlist = (pmID *)malloc((nmetrics + 1) * sizeof(pmID));
+    if (insttab == NULL || metrictab == NULL || pmidlist == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+    for (i = 0; i < ninst; i++) {
+	pmsprintf(name, sizeof(name), "inst-%d", i);
+	insttab[i].i_inst = i;
+	insttab[i].i_name = strdup(name);
+    }
+    indomtab[0].it_indom = 0;
+    indomtab[0].it_numinst = ninst;
+    indomtab[0].it_set = insttab;
+    for (i = 0; i < nmetrics; i++) {
+	metrictab[i].m_desc.pmid = pmID_build(0, 0, i);
+	if (i == 0) {
+	    metrictab[i].m_desc.type = PM_TYPE_U32;
+	    metrictab[i].m_desc.indom = PM_INDOM_NULL;
+	}
+	else {
+	    metrictab[i].m_desc.type = types[i % 4];
+	    metrictab[i].m_desc.indom = 0;
+	}
+	metrictab[i].m_desc.sem = PM_SEM_INSTANT;
+	pmidlist[i] = pmID_build(242, 0, i);
+    }
+    pmidlist[nmetrics] = pmID_build(242, 0, nmetrics);
+
+    if (dso)
+	pmdaDSO(&dispatch, PMDA_INTERFACE_7, "pmdabatch DSO", NULL);
+    else
+	pmdaDaemon(&dispatch, PMDA_INTERFACE_7, pmGetProgname(), 242, NULL, NULL);
+    if (dispatch.status < 0) {
+	fprintf(stderr, "%s: PMDA setup failed: %s\n", pmGetProgname(), pmErrStr(dispatch.status));
+	exit(1);
+    }
+    dispatch.domain = 242;
+    pmdaSetFetchCallBack(&dispatch, fetch_callback);
+    if (own)
+	pmdaSetResultCallBack(&dispatch, free_result);
+    pmdaInit(&dispatch, indomtab, 1, metrictab, nmetrics);
+    if (dispatch.status < 0) {
+	fprintf(stderr, "%s: pmdaInit failed: %s\n", pmGetProgname(), pmErrStr(dispatch.status));
+	exit(1);
+    }
+
+    sum = run("per-value", &dispatch, nmetrics + 1, pmidlist);
+    pmdaSetFetchBatchCallBack(&dispatch, batch_callback);
+    if (run("batch", &dispatch, nmetrics + 1, pmidlist) != sum) {
+	printf("values differ\n");
+	return 1;
+    }
+    printf("values match\n");
+    return 0;
+}
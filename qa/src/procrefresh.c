@@ -0,0 +1,172 @@
+/*
+ * Fetch and report all values of one metric from a local context PMDA
+ * after each of a sequence of files is copied (in place) over a target
+ * file, e.g. a /proc file below $LINUX_STATSPATH.  Successive fetches
+ * use the one PMDA instance, so any state it keeps between refreshes
+ * is exercised.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+
+static int
+copyfile(const char *source, const char *target)
+{
+    FILE	*in, *out;
+    char	buf[BUFSIZ];
+    size_t	bytes;
+    int		sts = 0;
+
+    if ((in = fopen(source, "r")) == NULL) {
+	fprintf(stderr, "%s: %s\n", source, strerror(errno));
+	return -1;
+    }
+    if ((out = fopen(target, "w")) == NULL) {
+	fprintf(stderr, "%s: %s\n", target, strerror(errno));
+	fclose(in);
+	return -1;
+    }
+    while ((bytes = fread(buf, 1, sizeof(buf), in)) > 0) {
+	if (fwrite(buf, 1, bytes, out) != bytes) {
+	    fprintf(stderr, "%s: %s\n", target, strerror(errno));
+	    sts = -1;
+	    break;
+	}
+    }
+    fclose(in);
+    if (fclose(out) != 0)
+	sts = -1;
+    return sts;
+}
+
+typedef struct {
+    int		inst;
+    char	*name;
+} instance_t;
+
+static int
+compare(const void *a, const void *b)
+{
+    const instance_t	*ia = (const instance_t *)a;
+    const instance_t	*ib = (const instance_t *)b;
+
+    return ia->inst < ib->inst ? -1 : ia->inst > ib->inst;
+}
+
+static void
+report(pmID pmid, pmDesc *desc)
+{
+    pmResult	*rp;
+    pmValueSet	*vsp;
+    pmAtomValue	atom;
+    instance_t	key, *instances = NULL, *ip;
+    char	**namelist = NULL;
+    int		*instlist = NULL;
+    int		i, sts, ninst = 0;
+
+    if ((sts = pmFetch(1, &pmid, &rp)) < 0) {
+	printf("pmFetch: %s\n", pmErrStr(sts));
+	return;
+    }
+    /*
+     * one instance domain lookup per fetch, rather than one per value,
+     * as some test files have more than a million instances
+     */
+    if (desc->indom != PM_INDOM_NULL &&
+	(ninst = pmGetInDom(desc->indom, &instlist, &namelist)) > 0) {
+	if ((instances = malloc(ninst * sizeof(instance_t))) == NULL) {
+	    fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	    exit(1);
+	}
+	for (i = 0; i < ninst; i++) {
+	    instances[i].inst = instlist[i];
+	    instances[i].name = namelist[i];
+	}
+	qsort(instances, ninst, sizeof(instance_t), compare);
+    }
+    vsp = rp->vset[0];
+    if (vsp->numval < 0)
+	printf("%s\n", pmErrStr(vsp->numval));
+    for (i = 0; i < vsp->numval; i++) {
+	if ((sts = pmExtractValue(vsp->valfmt, &vsp->vlist[i], desc->type,
+				  &atom, PM_TYPE_U64)) < 0) {
+	    printf("pmExtractValue: %s\n", pmErrStr(sts));
+	    continue;
+	}
+	key.inst = vsp->vlist[i].inst;
+	if (desc->indom == PM_INDOM_NULL)
+	    printf("%llu\n", (unsigned long long)atom.ull);
+	else if ((ip = bsearch(&key, instances, ninst, sizeof(instance_t), compare)) == NULL)
+	    printf("[%d] %llu\n", key.inst, (unsigned long long)atom.ull);
+	else
+	    printf("%s %llu\n", ip->name, (unsigned long long)atom.ull);
+    }
+    pmFreeResult(rp);
+    free(instances);
+    free(instlist);
+    free(namelist);
+}
+
+int
+main(int argc, char **argv)
+{
+    const char	*metric;
+    char	*target = NULL;
+    char	*errmsg;
+    pmDesc	desc;
+    pmID	pmid;
+    int		c, sts, errflag = 0;
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "D:f:K:")) != EOF) {
+	switch (c) {
+	case 'D':
+	    if ((sts = pmSetDebug(optarg)) < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+			pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+	case 'f':
+	    target = optarg;
+	    break;
+	case 'K':
+	    if ((errmsg = pmSpecLocalPMDA(optarg)) != NULL) {
+		fprintf(stderr, "%s: -K %s: %s\n", pmGetProgname(), optarg, errmsg);
+		errflag++;
+	    }
+	    break;
+	default:
+	    errflag++;
+	}
+    }
+    if (errflag || target == NULL || argc - optind < 2) {
+	fprintf(stderr, "Usage: %s [-D debug] [-K spec] -f target metric file ...\n",
+		pmGetProgname());
+	exit(1);
+    }
+
+    if ((sts = pmNewContext(PM_CONTEXT_LOCAL, NULL)) < 0) {
+	fprintf(stderr, "pmNewContext(LOCAL): %s\n", pmErrStr(sts));
+	exit(1);
+    }
+    metric = argv[optind++];
+    if ((sts = pmLookupName(1, &metric, &pmid)) < 0) {
+	fprintf(stderr, "pmLookupName(%s): %s\n", metric, pmErrStr(sts));
+	exit(1);
+    }
+    if ((sts = pmLookupDesc(pmid, &desc)) < 0) {
+	fprintf(stderr, "pmLookupDesc(%s): %s\n", metric, pmErrStr(sts));
+	exit(1);
+    }
+
+    for (; optind < argc; optind++) {
+	if (copyfile(argv[optind], target) < 0)
+	    exit(1);
+	printf("== %s\n", argv[optind]);
+	report(pmid, &desc);
+    }
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Compare pmFetch and pmFreeResult for a default host context and one
+ * with PM_CTXFLAG_ARENA - results must have the same structure, and
+ * with -v the fetch rate and (for glibc) memory allocations per fetch
+ * are reported on stderr.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+
+#ifdef __GLIBC__
+/*
+ * Count allocations by interposing on the glibc allocator.
+ */
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+static long	nalloc;
+
+void *
+malloc(size_t size)
+{
+    nalloc++;
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+    nalloc++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+	nalloc++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+static int	numpmid;
+static int	maxpmid;
+static pmID	*pmidlist;
+
+static void
+dometric(const char *name)
+{
+    pmID	pmid;
+    int		sts;
+
+    if ((sts = pmLookupName(1, &name, &pmid)) < 0) {
+	fprintf(stderr, "%s: pmLookupName(%s): %s\n", pmGetProgname(), name, pmErrStr(sts));
+	return;
+    }
+    if (numpmid == maxpmid) {
+	maxpmid = maxpmid ? maxpmid * 2 : 64;
+	if ((pmidlist = realloc(pmidlist, maxpmid * sizeof(pmID))) == NULL) {
+	    fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	    exit(1);
+	}
+    }
+    pmidlist[numpmid++] = pmid;
+}
+
+/*
+ * Checksum of the structure (not the values) of a result.
+ */
+static unsigned int
+checksum(pmResult *rp)
+{
+    pmValueSet	*vsp;
+    pmValue	*vp;
+    unsigned	sum = rp->numpmid;
+    int		i, j;
+
+    for (i = 0; i < rp->numpmid; i++) {
+	vsp = rp->vset[i];
+	sum = sum * 31 + vsp->pmid;
+	sum = sum * 31 + vsp->numval;
+	for (j = 0; j < vsp->numval; j++) {
+	    vp = &vsp->vlist[j];
+	    sum = sum * 31 + vp->inst;
+	    sum = sum * 31 + (vsp->valfmt == PM_VAL_INSITU);
+	    if (vsp->valfmt != PM_VAL_INSITU) {
+		sum = sum * 31 + vp->value.pval->vtype;
+		sum = sum * 31 + vp->value.pval->vlen;
+	    }
+	}
+    }
+    return sum;
+}
+
+static unsigned int
+run(const char *mode, const char *host, int flags, int iterations, int verbose)
+{
+    pmResult		*rp;
+    struct timespec	before, after;
+    unsigned int	sum = 0;
+    long		nvalues = 0;
+    long		allocs = 0;
+    double		delta;
+    int			ctx, i, j, sts;
+
+    if ((ctx = pmNewContext(PM_CONTEXT_HOST | flags, host)) < 0) {
+	fprintf(stderr, "%s: %s: cannot connect to %s: %s\n",
+		pmGetProgname(), mode, host, pmErrStr(ctx));
+	exit(1);
+    }
+
+    pmtimespecNow(&before);
+    for (i = 0; i < iterations; i++) {
+#ifdef __GLIBC__
+	allocs -= nalloc;
+#endif
+	if ((sts = pmFetch(numpmid, pmidlist, &rp)) < 0) {
+	    fprintf(stderr, "%s: %s: pmFetch: %s\n", pmGetProgname(), mode, pmErrStr(sts));
+	    exit(1);
+	}
+	if (i == 0) {
+	    sum = checksum(rp);
+	    for (j = 0; j < rp->numpmid; j++)
+		if (rp->vset[j]->numval > 0)
+		    nvalues += rp->vset[j]->numval;
+	}
+	pmFreeResult(rp);
+#ifdef __GLIBC__
+	allocs += nalloc;
+#endif
+    }
+    pmtimespecNow(&after);
+    delta = pmtimespecSub(&after, &before);
+    pmDestroyContext(ctx);
+
+    printf("%s: %d metrics, %ld values\n", mode, numpmid, nvalues);
+    if (verbose) {
+	fprintf(stderr, "%s: %.2f fetches/second", mode, iterations / delta);
+#ifdef __GLIBC__
+	fprintf(stderr, ", %.1f allocations/fetch", (double)allocs / iterations);
+#endif
+	fputc('\n', stderr);
+    }
+    return sum;
+}
+
+int
+main(int argc, char **argv)
+{
+    int		c;
+    int		sts;
+    int		errflag = 0;
+    int		verbose = 0;
+    int		iterations = 1000;
+    char	*host = "local:";
+    unsigned	sum;
+    static char	*usage = "[-h hostspec] [-i iterations] [-v] metric ...";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "D:h:i:v")) != EOF) {
+	switch (c) {
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'h':	/* hostname for PMCD to contact */
+	    host = optarg;
+	    break;
+
+	case 'i':	/* iterations */
+	    iterations = atoi(optarg);
+	    break;
+
+	case 'v':	/* report rates and allocations */
+	    verbose = 1;
+	    break;
+
+	case '?':
+	default:
+	    errflag++;
+	    break;
+	}
+    }
+
+    if (errflag || optind >= argc || iterations < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    if ((sts = pmNewContext(PM_CONTEXT_HOST, host)) < 0) {
+	fprintf(stderr, "%s: cannot connect to %s: %s\n",
+		pmGetProgname(), host, pmErrStr(sts));
+	exit(1);
+    }
+    for (; optind < argc; optind++) {
+	if ((sts = pmTraversePMNS(argv[optind], dometric)) < 0)
+	    fprintf(stderr, "%s: pmTraversePMNS(%s): %s\n",
+		    pmGetProgname(), argv[optind], pmErrStr(sts));
+    }
+    if (numpmid == 0) {
+	fprintf(stderr, "%s: no metrics\n", pmGetProgname());
+	exit(1);
+    }
+
+    sum = run("default", host, 0, iterations, verbose);
+    if (run("arena", host, PM_CTXFLAG_ARENA, iterations, verbose) != sum) {
+	printf("results differ\n");
+	exit(1);
+    }
+    printf("results match\n");
+    exit(0);
+}
@@ -0,0 +1,134 @@
+/*
+ * Position an archive context at pseudo-random times between the start
+ * and end of the archive (the same times on every run), and report the
+ * first record found forwards (or backwards with -b) from each one.
+ *
+ * With -t report instead the mean time per seek and the mean number of
+ * bytes read per seek (from rchar in /proc/self/io, where available),
+ * to compare temporal indexes of different density.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include <sys/time.h>
+
+static long long
+rchar(void)
+{
+    FILE	*f;
+    char	buf[128];
+    long long	n = -1;
+
+    if ((f = fopen("/proc/self/io", "r")) == NULL)
+	return -1;
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+	if (sscanf(buf, "rchar: %lld", &n) == 1)
+	    break;
+    }
+    fclose(f);
+    return n;
+}
+
+int
+main(int argc, char **argv)
+{
+    int		c, i, sts;
+    int		ctx;
+    int		mode = PM_MODE_FORW;
+    int		nseek = 20;
+    int		tflag = 0;
+    int		errflag = 0;
+    unsigned int seed = 12345;
+    double	span;
+    double	elapsed = 0;
+    long long	nbytes = 0;
+    long long	before;
+    pmLogLabel	label;
+    struct timeval	end;
+    struct timeval	when;
+    struct timeval	t0, t1;
+    pmResult	*rp;
+    static char	*usage = "[-b] [-n seeks] [-t] archive";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "bn:t")) != EOF) {
+	switch (c) {
+
+	case 'b':	/* search backwards */
+	    mode = PM_MODE_BACK;
+	    break;
+
+	case 'n':	/* number of seeks */
+	    nseek = atoi(optarg);
+	    break;
+
+	case 't':	/* timing, not values */
+	    tflag = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc-1 || nseek < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    if ((ctx = pmNewContext(PM_CONTEXT_ARCHIVE, argv[optind])) < 0) {
+	fprintf(stderr, "%s: pmNewContext(%s): %s\n",
+		pmGetProgname(), argv[optind], pmErrStr(ctx));
+	exit(1);
+    }
+    if ((sts = pmGetArchiveLabel(&label)) < 0) {
+	fprintf(stderr, "%s: pmGetArchiveLabel: %s\n", pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+    if ((sts = pmGetArchiveEnd(&end)) < 0) {
+	fprintf(stderr, "%s: pmGetArchiveEnd: %s\n", pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+    span = pmtimevalSub(&end, &label.ll_start);
+
+    for (i = 0; i < nseek; i++) {
+	seed = seed * 1103515245 + 12345;
+	when = label.ll_start;
+	when.tv_sec += (time_t)(span * ((seed >> 8) & 0xffff) / 0x10000);
+	when.tv_usec = (seed >> 4) % 1000000;
+
+	before = rchar();
+	gettimeofday(&t0, NULL);
+	if ((sts = pmSetMode(mode, &when, 0)) < 0) {
+	    fprintf(stderr, "%s: pmSetMode: %s\n", pmGetProgname(), pmErrStr(sts));
+	    exit(1);
+	}
+	sts = pmFetchArchive(&rp);
+	gettimeofday(&t1, NULL);
+	elapsed += pmtimevalSub(&t1, &t0);
+	if (before >= 0)
+	    nbytes += rchar() - before;
+
+	if (tflag) {
+	    if (sts >= 0)
+		pmFreeResult(rp);
+	    continue;
+	}
+	printf("%lld.%06d ->", (long long)when.tv_sec, (int)when.tv_usec);
+	if (sts < 0)
+	    printf(" %s\n", pmErrStr(sts));
+	else {
+	    printf(" %lld.%06d %d metrics\n", (long long)rp->timestamp.tv_sec,
+		    (int)rp->timestamp.tv_usec, rp->numpmid);
+	    pmFreeResult(rp);
+	}
+    }
+
+    if (tflag)
+	printf("%d seeks: %.1f usec and %lld bytes read per seek\n",
+		nseek, 1000000 * elapsed / nseek, nbytes / nseek);
+
+    exit(0);
+}
@@ -0,0 +1,272 @@
+/*
+ * Host contexts created with PM_CTXFLAG_SHARED - several contexts
+ * for the same pmcd use one connection (observed via pmcd.numclients
+ * from an unshared context), yet keep their own instance profiles,
+ * including across a reconnect of the shared connection.
+ *
+ * With -S pid, pmcd (that pid) is stopped while one shared context
+ * fetches, so the request times out and the reply arrives late - the
+ * next request from another sharing context must not see that reply.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+
+static char	*host = "local:";
+static pmID	clients;
+static pmID	colour;
+static pmInDom	indom;
+
+static int
+numclients(int ctx)
+{
+    pmResult	*rp;
+    int		sts;
+
+    if ((sts = pmUseContext(ctx)) < 0) {
+	fprintf(stderr, "pmUseContext(%d): %s\n", ctx, pmErrStr(sts));
+	exit(1);
+    }
+    if ((sts = pmFetch(1, &clients, &rp)) < 0) {
+	fprintf(stderr, "pmFetch(pmcd.numclients): %s\n", pmErrStr(sts));
+	exit(1);
+    }
+    sts = rp->vset[0]->numval > 0 ? rp->vset[0]->vlist[0].value.lval : -1;
+    pmFreeResult(rp);
+    return sts;
+}
+
+/*
+ * pmcd notices a closed connection asynchronously, so allow it some
+ * time to catch up when the count is expected to change
+ */
+static int
+waitclients(int ctx, int expect)
+{
+    int		i, n = -1;
+
+    for (i = 0; i < 50; i++) {
+	if ((n = numclients(ctx)) == expect)
+	    break;
+	usleep(100000);
+    }
+    return n;
+}
+
+static void
+fetchcolour(int ctx, const char *tag)
+{
+    pmResult	*rp;
+    char	*name;
+    int		i, sts;
+
+    if ((sts = pmUseContext(ctx)) < 0) {
+	fprintf(stderr, "pmUseContext(%d): %s\n", ctx, pmErrStr(sts));
+	exit(1);
+    }
+    if ((sts = pmFetch(1, &colour, &rp)) < 0) {
+	printf("%s: pmFetch: %s\n", tag, pmErrStr(sts));
+	return;
+    }
+    printf("%s:", tag);
+    for (i = 0; i < rp->vset[0]->numval; i++) {
+	if (pmNameInDom(indom, rp->vset[0]->vlist[i].inst, &name) < 0)
+	    printf(" [%d]", rp->vset[0]->vlist[i].inst);
+	else {
+	    printf(" %s", name);
+	    free(name);
+	}
+    }
+    putchar('\n');
+    pmFreeResult(rp);
+}
+
+/*
+ * Two shared contexts with different profiles; a fetch on the first
+ * times out while pmcd is stopped, then pmcd continues and sends its
+ * (late) reply, and the second context fetches - it must fail rather
+ * than see the first context's result, then recover on reconnect.
+ */
+static void
+stalled(pid_t pid, int *instlist)
+{
+    pmResult	*rp;
+    int		ctx[2];
+    int		i, sts;
+
+    for (i = 0; i < 2; i++) {
+	if ((ctx[i] = pmNewContext(PM_CONTEXT_HOST | PM_CTXFLAG_SHARED, host)) < 0) {
+	    fprintf(stderr, "pmNewContext(%s, SHARED): %s\n", host, pmErrStr(ctx[i]));
+	    exit(1);
+	}
+	pmDelProfile(indom, 0, NULL);
+	pmAddProfile(indom, 1, &instlist[i]);
+	fetchcolour(ctx[i], i == 0 ? "first" : "second");
+    }
+
+    if (kill(pid, SIGSTOP) < 0) {
+	fprintf(stderr, "kill(%d, SIGSTOP): %s\n", (int)pid, strerror(errno));
+	exit(1);
+    }
+    pmUseContext(ctx[0]);
+    sts = pmFetch(1, &colour, &rp);
+    printf("first, pmcd stopped: %s\n", sts < 0 ? pmErrStr(sts) : "no timeout");
+    if (sts >= 0)
+	pmFreeResult(rp);
+    kill(pid, SIGCONT);
+    usleep(500000);	/* pmcd sends the late reply */
+
+    fetchcolour(ctx[1], "second, pmcd continued");
+    if ((sts = pmReconnectContext(ctx[1])) < 0) {
+	fprintf(stderr, "pmReconnectContext: %s\n", pmErrStr(sts));
+	exit(1);
+    }
+    fetchcolour(ctx[1], "second, reconnected");
+    fetchcolour(ctx[0], "first, reconnected");
+    pmDestroyContext(ctx[0]);
+    pmDestroyContext(ctx[1]);
+}
+
+int
+main(int argc, char **argv)
+{
+    const char	*names[] = { "pmcd.numclients", "sample.colour" };
+    pmID	pmids[2];
+    pmDesc	desc;
+    char	tag[32];
+    int		*instlist, ninst;
+    char	**namelist;
+    int		*ctxlist;
+    int		ctx, base, n = 4;
+    pid_t	stallpid = 0;
+    int		c, i, sts, errflag = 0;
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "D:h:n:S:")) != EOF) {
+	switch (c) {
+	case 'D':
+	    if ((sts = pmSetDebug(optarg)) < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+			pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+	case 'h':
+	    host = optarg;
+	    break;
+	case 'n':
+	    if ((n = atoi(optarg)) < 2) {
+		fprintf(stderr, "%s: need at least two contexts\n", pmGetProgname());
+		errflag++;
+	    }
+	    break;
+	case 'S':
+	    if ((stallpid = atoi(optarg)) <= 0) {
+		fprintf(stderr, "%s: bad pmcd pid (%s)\n", pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+	default:
+	    errflag++;
+	}
+    }
+    if (errflag || optind != argc) {
+	fprintf(stderr, "Usage: %s [-D debug] [-h host] [-n contexts] [-S pmcdpid]\n",
+		pmGetProgname());
+	exit(1);
+    }
+
+    /* an unshared context, for observing pmcd's client count */
+    if ((ctx = pmNewContext(PM_CONTEXT_HOST, host)) < 0) {
+	fprintf(stderr, "pmNewContext(%s): %s\n", host, pmErrStr(ctx));
+	exit(1);
+    }
+    if ((sts = pmLookupName(2, names, pmids)) < 0) {
+	fprintf(stderr, "pmLookupName: %s\n", pmErrStr(sts));
+	exit(1);
+    }
+    clients = pmids[0];
+    colour = pmids[1];
+    if ((sts = pmLookupDesc(colour, &desc)) < 0) {
+	fprintf(stderr, "pmLookupDesc: %s\n", pmErrStr(sts));
+	exit(1);
+    }
+    indom = desc.indom;
+    if ((ninst = pmGetInDom(indom, &instlist, &namelist)) < 1) {
+	fprintf(stderr, "pmGetInDom: %s\n", pmErrStr(ninst));
+	exit(1);
+    }
+    if (stallpid > 0) {
+	stalled(stallpid, instlist);
+	free(instlist);
+	free(namelist);
+	return 0;
+    }
+    base = numclients(ctx);
+
+    /* shared contexts, each with a profile of one sample.colour instance */
+    if ((ctxlist = calloc(n, sizeof(int))) == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+    for (i = 0; i < n; i++) {
+	if ((ctxlist[i] = pmNewContext(PM_CONTEXT_HOST | PM_CTXFLAG_SHARED, host)) < 0) {
+	    fprintf(stderr, "pmNewContext(%s, SHARED): %s\n", host, pmErrStr(ctxlist[i]));
+	    exit(1);
+	}
+	pmDelProfile(indom, 0, NULL);
+	pmAddProfile(indom, 1, &instlist[i % ninst]);
+    }
+    printf("%d shared contexts, pmcd clients added: %d\n",
+	    n, numclients(ctx) - base);
+
+    /* interleave the fetches, each context sees only its own profile */
+    for (i = 0; i < n; i++) {
+	pmsprintf(tag, sizeof(tag), "context %d", i);
+	fetchcolour(ctxlist[i], tag);
+    }
+    pmUseContext(ctxlist[1]);
+    pmAddProfile(indom, 1, &instlist[0]);
+    for (i = n - 1; i >= 0; i--) {
+	pmsprintf(tag, sizeof(tag), "context %d", i);
+	fetchcolour(ctxlist[i], tag);
+    }
+
+    /* reconnect via one context, profiles of the others are resent */
+    if ((sts = pmReconnectContext(ctxlist[0])) < 0) {
+	fprintf(stderr, "pmReconnectContext: %s\n", pmErrStr(sts));
+	exit(1);
+    }
+    printf("after reconnect, pmcd clients added: %d\n",
+	    waitclients(ctx, base + 1) - base);
+    for (i = n - 1; i >= 0; i--) {
+	pmsprintf(tag, sizeof(tag), "context %d", i);
+	fetchcolour(ctxlist[i], tag);
+    }
+
+    /* connection remains until the last sharing context is destroyed */
+    for (i = 0; i < n - 1; i++)
+	pmDestroyContext(ctxlist[i]);
+    printf("%d contexts destroyed, pmcd clients added: %d\n",
+	    n - 1, numclients(ctx) - base);
+    pmsprintf(tag, sizeof(tag), "context %d", n - 1);
+    fetchcolour(ctxlist[n - 1], tag);
+    pmDestroyContext(ctxlist[n - 1]);
+    printf("all contexts destroyed, pmcd clients added: %d\n",
+	    waitclients(ctx, base) - base);
+
+    /* an unshared context still gets a connection of its own */
+    if ((sts = pmNewContext(PM_CONTEXT_HOST, host)) < 0) {
+	fprintf(stderr, "pmNewContext(%s): %s\n", host, pmErrStr(sts));
+	exit(1);
+    }
+    printf("unshared context, pmcd clients added: %d\n",
+	    numclients(ctx) - base);
+
+    free(instlist);
+    free(namelist);
+    free(ctxlist);
+    return 0;
+}
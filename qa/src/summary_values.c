@@ -0,0 +1,147 @@
+/*
+ * Create an archive for pmlogsummary percentile and binning checks,
+ * with a skewed (exponential) distribution of pseudo-random values in
+ * an instantaneous metric, summary.exp, and a counter, summary.count,
+ * whose rates follow the same distribution.  Samples are one second
+ * apart.
+ *
+ * With -p the exact 50th, 95th and 99th percentiles of the values and
+ * of the counter rates are reported, interpolating between the closest
+ * ranks.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include <pcp/import.h>
+#include <math.h>
+#include <inttypes.h>
+
+static double	percentiles[] = { 50, 95, 99 };
+#define NPERCENTILES	(sizeof(percentiles) / sizeof(percentiles[0]))
+
+static __uint32_t	seed = 1;
+
+static double
+expvalue(double mean)
+{
+    double	u;
+
+    seed = seed * 1103515245 + 12345;
+    u = ((seed >> 8) + 0.5) / 16777216.0;
+    return -mean * log(u);
+}
+
+static int
+doublecmp(const void *a, const void *b)
+{
+    double	va = *(const double *)a;
+    double	vb = *(const double *)b;
+
+    return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+static void
+report(const char *name, double *values, int n)
+{
+    double	pos;
+    int		i, lo;
+
+    qsort(values, n, sizeof(double), doublecmp);
+    printf("%s", name);
+    for (i = 0; i < NPERCENTILES; i++) {
+	pos = percentiles[i] / 100 * (n - 1);
+	lo = (int)pos;
+	if (lo >= n - 1)
+	    printf(" %.3f", values[n-1]);
+	else
+	    printf(" %.3f", values[lo] + (pos - lo) * (values[lo+1] - values[lo]));
+    }
+    putchar('\n');
+}
+
+static void
+check(int sts, const char *name)
+{
+    if (sts < 0) {
+	fprintf(stderr, "%s: %s: %s\n", pmGetProgname(), name, pmiErrStr(sts));
+	exit(1);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    double	*values, *rates;
+    double	v, r;
+    __uint64_t	count = 1000;
+    char	buf[64];
+    int		c, s;
+    int		nsample = 100;
+    int		pflag = 0;
+    int		errflag = 0;
+    static char	*usage = "[-p] [-n samples] archive";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "n:p")) != EOF) {
+	switch (c) {
+
+	case 'n':	/* samples */
+	    nsample = atoi(optarg);
+	    break;
+
+	case 'p':	/* report exact percentiles */
+	    pflag = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc-1 || nsample < 2) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+
+    values = (double *)malloc(nsample * sizeof(double));
+    rates = (double *)malloc(nsample * sizeof(double));
+    if (values == NULL || rates == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+
+    check(pmiStart(argv[optind], 0), "pmiStart");
+    check(pmiSetHostname("summary.host"), "pmiSetHostname");
+    check(pmiSetTimezone("UTC"), "pmiSetTimezone");
+    check(pmiAddMetric("summary.exp", pmiID(245, 0, 0), PM_TYPE_DOUBLE,
+			PM_INDOM_NULL, PM_SEM_INSTANT,
+			pmiUnits(0,0,0,0,0,0)), "pmiAddMetric");
+    check(pmiAddMetric("summary.count", pmiID(245, 0, 1), PM_TYPE_U64,
+			PM_INDOM_NULL, PM_SEM_COUNTER,
+			pmiUnits(0,0,1,0,0,PM_COUNT_ONE)), "pmiAddMetric");
+
+    for (s = 0; s < nsample; s++) {
+	v = expvalue(100);
+	values[s] = v;
+	pmsprintf(buf, sizeof(buf), "%.17g", v);
+	check(pmiPutValue("summary.exp", NULL, buf), "pmiPutValue");
+	if (s > 0) {
+	    r = floor(expvalue(1000));
+	    rates[s-1] = r;
+	    count += (__uint64_t)r;
+	}
+	pmsprintf(buf, sizeof(buf), "%" PRIu64, count);
+	check(pmiPutValue("summary.count", NULL, buf), "pmiPutValue");
+	check(pmiWrite(1600000000 + s, 0), "pmiWrite");
+    }
+    check(pmiEnd(), "pmiEnd");
+
+    if (pflag) {
+	report("summary.exp", values, nsample);
+	report("summary.count", rates, nsample - 1);
+    }
+
+    exit(0);
+}
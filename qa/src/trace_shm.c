@@ -0,0 +1,244 @@
+/*
+ * Multi-threaded pmtrace clients using the shared memory transport
+ * ($PCP_TRACE_SHM), with the ring buffer read back here rather than
+ * by pmdatrace.  Each thread traces observations of 0, 1, 2, ... so
+ * the events read for a thread must be strictly increasing, and every
+ * event is either read or counted as lost.
+ *
+ * With -r the ring is read concurrently with the writers, otherwise
+ * after they have all finished.  With -o a child process also attaches
+ * the ring, and checks that this process is reported as its owner.
+ * With -v the event rate of each thread is reported on stderr.
+ *
+ * Copyright (c) 2021 Red Hat.
+ */
+
+#include <pcp/pmapi.h>
+#include "libpcp.h"
+#include <pcp/trace.h>
+#include <pcp/trace_dev.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <sys/wait.h>
+
+static int		nthreads = 4;
+static long		nevents = 100000;
+static int		verbose;
+static double		*rates;
+static double		*last;
+static __uint64_t	nread, nbad;
+
+static void *
+writer(void *arg)
+{
+    long		thread = (long)arg;
+    struct timeval	start, end;
+    char		tag[32];
+    long		i;
+    int			sts;
+
+    pmsprintf(tag, sizeof(tag), "thread-%ld", thread);
+    pmtimevalNow(&start);
+    for (i = 0; i < nevents; i++) {
+	if ((sts = pmtraceobs(tag, (double)i)) < 0) {
+	    fprintf(stderr, "%s: pmtraceobs: %s\n", pmGetProgname(), pmtraceerrstr(sts));
+	    exit(1);
+	}
+    }
+    pmtimevalNow(&end);
+    rates[thread] = nevents / pmtimevalSub(&end, &start);
+    return NULL;
+}
+
+/*
+ * Read and check events until the ring is empty.  At the end a slot
+ * claimed but never published (the event was dropped) is only counted
+ * as lost on the next read, so keep reading until the tail catches up.
+ */
+static void
+readall(__pmTraceShmReader *rp, int final)
+{
+    __pmTraceShmSlot	slot;
+    long		t;
+    int			sts;
+
+    for ( ; ; ) {
+	if ((sts = __pmtraceshmread(rp, &slot)) == 0) {
+	    if (!final || rp->tail >= rp->hdr->head)
+		break;
+	    continue;
+	}
+	nread++;
+	if (sscanf(slot.tag, "thread-%ld", &t) != 1 || t < 0 || t >= nthreads ||
+	    slot.type != TRACE_TYPE_OBSERVE || slot.value <= last[t]) {
+	    if (nbad++ < 10)
+		printf("bad event: tag '%s' type %d value %.0f\n",
+			slot.tag, slot.type, slot.value);
+	}
+	else
+	    last[t] = slot.value;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    __pmTraceShmReader	reader;
+    __pmTraceShmSlot	slot;
+    pthread_t		*threads;
+    char		dir[MAXPATHLEN];
+    char		path[MAXPATHLEN];
+    long		t;
+    int			c, sts;
+    int			done = 0;
+    int			errflag = 0;
+    int			concurrent = 0;
+    int			owner = 0;
+    pid_t		pid;
+    static char		*usage = "[-orv] [-D debug] [-n events] [-t threads]";
+
+    pmSetProgname(argv[0]);
+
+    while ((c = getopt(argc, argv, "D:n:ort:v")) != EOF) {
+	switch (c) {
+
+	case 'D':	/* debug options */
+	    sts = pmSetDebug(optarg);
+	    if (sts < 0) {
+		fprintf(stderr, "%s: unrecognized debug options specification (%s)\n",
+		    pmGetProgname(), optarg);
+		errflag++;
+	    }
+	    break;
+
+	case 'n':
+	    nevents = atol(optarg);
+	    break;
+
+	case 'o':	/* check ring owner from another process */
+	    owner = 1;
+	    break;
+
+	case 'r':	/* read concurrently */
+	    concurrent = 1;
+	    break;
+
+	case 't':
+	    nthreads = atoi(optarg);
+	    break;
+
+	case 'v':	/* report event rates */
+	    verbose = 1;
+	    break;
+
+	default:
+	    errflag++;
+	}
+    }
+
+    if (errflag || optind != argc || nthreads < 1 || nevents < 1) {
+	fprintf(stderr, "Usage: %s %s\n", pmGetProgname(), usage);
+	exit(1);
+    }
+    if (getenv(TRACE_ENV_SHM) == NULL) {
+	fprintf(stderr, "%s: %s is not set\n", pmGetProgname(), TRACE_ENV_SHM);
+	exit(1);
+    }
+
+    threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+    rates = (double *)calloc(nthreads, sizeof(double));
+    last = (double *)malloc(nthreads * sizeof(double));
+    if (threads == NULL || rates == NULL || last == NULL) {
+	fprintf(stderr, "%s: out of memory\n", pmGetProgname());
+	exit(1);
+    }
+    for (t = 0; t < nthreads; t++)
+	last[t] = -1;
+
+    /* first event creates the ring buffer, so it can be attached */
+    if ((sts = pmtracepoint("start")) < 0) {
+	fprintf(stderr, "%s: pmtracepoint: %s\n", pmGetProgname(), pmtraceerrstr(sts));
+	exit(1);
+    }
+    pmsprintf(path, sizeof(path), "%s%c%" FMT_PID,
+		__pmtraceshmdir(dir, sizeof(dir)), pmPathSeparator(), (pid_t)getpid());
+
+    if (owner) {
+	/*
+	 * a process never conflicts with its own lock, so ask a child -
+	 * before this process opens the ring, as any close would drop
+	 * the lock
+	 */
+	fflush(stdout);
+	if ((pid = fork()) == 0) {
+	    __pmTraceShmReader	other;
+
+	    if ((sts = __pmtraceshmattach(path, &other)) < 0) {
+		fprintf(stderr, "%s: child attach %s: %s\n", pmGetProgname(),
+			path, pmtraceerrstr(sts));
+		exit(1);
+	    }
+	    if (other.owner == (__int32_t)getppid())
+		printf("ring owned by the writing process\n");
+	    else
+		printf("ring owner %d, expected %d\n", (int)other.owner, (int)getppid());
+	    __pmtraceshmdetach(&other);
+	    exit(0);
+	}
+	else if (pid < 0) {
+	    fprintf(stderr, "%s: fork: %s\n", pmGetProgname(), strerror(errno));
+	    exit(1);
+	}
+	waitpid(pid, &sts, 0);
+    }
+    if ((sts = __pmtraceshmattach(path, &reader)) < 0) {
+	fprintf(stderr, "%s: attach %s: %s\n", pmGetProgname(), path, pmtraceerrstr(sts));
+	exit(1);
+    }
+    if (__pmtraceshmread(&reader, &slot) != 1 || strcmp(slot.tag, "start") != 0 ||
+	slot.type != TRACE_TYPE_POINT) {
+	fprintf(stderr, "%s: start event not found\n", pmGetProgname());
+	exit(1);
+    }
+
+    for (t = 0; t < nthreads; t++) {
+	if ((sts = pthread_create(&threads[t], NULL, writer, (void *)t)) != 0) {
+	    fprintf(stderr, "%s: pthread_create: %s\n", pmGetProgname(), strerror(sts));
+	    exit(1);
+	}
+    }
+
+    if (concurrent) {
+	while (!done) {
+	    readall(&reader, 0);
+	    for (t = 0; t < nthreads; t++) {
+		if (rates[t] == 0)
+		    break;
+	    }
+	    done = (t == nthreads);
+	}
+    }
+    for (t = 0; t < nthreads; t++)
+	pthread_join(threads[t], NULL);
+    readall(&reader, 1);
+
+    printf("%" PRIu64 " events written\n", (__uint64_t)nthreads * nevents);
+    if (nread + reader.lost == (__uint64_t)nthreads * nevents)
+	printf("events read + lost ok\n");
+    else
+	printf("%" PRIu64 " read + %" PRIu64 " lost, expected %" PRIu64 "\n",
+		nread, reader.lost, (__uint64_t)nthreads * nevents);
+    if (!concurrent)
+	printf("%" PRIu64 " read, %" PRIu64 " lost\n", nread, reader.lost);
+    if (nbad)
+	printf("%" PRIu64 " bad events\n", nbad);
+    if (verbose) {
+	for (t = 0; t < nthreads; t++)
+	    fprintf(stderr, "thread %ld: %.0f events/sec\n", t, rates[t]);
+	fprintf(stderr, "read %" PRIu64 ", lost %" PRIu64 "\n", nread, reader.lost);
+    }
+
+    __pmtraceshmdetach(&reader);
+    unlink(path);
+    exit(nbad != 0);
+}
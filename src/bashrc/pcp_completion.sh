@@ -92,17 +92,21 @@ _pcp_complete()
         all_args="lmnSTvwZz"
         arg_regex="-[nSTZ]"
     ;;
+    pmlogcolumn)
+        all_args="ilqsSTvZz"
+        arg_regex="-[iSTZ]"
+    ;;
     pmlogctl)
         all_args="acfiNpV"
         arg_regex="-[cip]"
     ;;
     pmlogextract)
-        all_args="cdfmSsTvwxZz"
-        arg_regex="-[cSsTvZ]"
+        all_args="cdfjmSsTvwxZz"
+        arg_regex="-[cjSsTvZ]"
     ;;
     pmlogger)
-        all_args="CcHhKLlmNnoPprsTtUuVvxy"
-        arg_regex="-[cHhKlmnpsTtUVvx]"
+        all_args="CceHhIKLlmNnoPprsTtUuVvxy"
+        arg_regex="-[cHhIKlmnpsTtUVvx]"
     ;;
     pmloglabel)
         all_args="hLlpsVvZ"
@@ -113,16 +117,16 @@ _pcp_complete()
         arg_regex="-[fhlmot]"
     ;;
     pmlogreduce)
-        all_args="ASsTtvZz"
-        arg_regex="-[ASsTtZ]"
+        all_args="AjSsTtvZz"
+        arg_regex="-[AjSsTtZ]"
     ;;
     pmlogsize)
         all_args="drvx"
         arg_regex="-[x]"
     ;;
     pmlogsummary)
-        all_args="aBbFfHIilMmNnpSsTVvxyZz"
-        arg_regex="-[BnpSTZ]"
+        all_args="1AaBbFfHIijlMmNnPpSsTVvxyZz"
+        arg_regex="-[ABjnpSTZ]"
     ;;
     pmprobe)
         all_args="abdfFhIiKLnOVvZz"
@@ -206,4 +210,4 @@ _pcp_complete()
         fi
     fi
 }
-complete -F _pcp_complete -o default pcp2elasticsearch pcp2graphite pcp2influxdb pcp2json pcp2spark pcp2xlsx pcp2xml pcp2zabbix pmclient pmdumplog pmdumptext pmevent pmfind pmie pmie2col pmiectl pminfo pmjson pmlc pmlogcheck pmlogctl pmlogextract pmlogger pmloglabel pmlogpaste pmlogreduce pmlogsize pmlogsummary pmprobe pmrep pmseries pmstat pmstore pmval
+complete -F _pcp_complete -o default pcp2elasticsearch pcp2graphite pcp2influxdb pcp2json pcp2spark pcp2xlsx pcp2xml pcp2zabbix pmclient pmdumplog pmdumptext pmevent pmfind pmie pmie2col pmiectl pminfo pmjson pmlc pmlogcheck pmlogcolumn pmlogctl pmlogextract pmlogger pmloglabel pmlogpaste pmlogreduce pmlogsize pmlogsummary pmprobe pmrep pmseries pmstat pmstore pmval
@@ -616,6 +616,9 @@ typedef struct {
     int			pc_timeout;	/* set if connect times out */
     int			pc_tout_sec;	/* timeout for __pmGetPDU */
     time_t		pc_again;	/* time to try again */
+    int			pc_refcnt;	/* contexts sharing this connection */
+    int			pc_gen;		/* bumped on each reconnect */
+    __pmMutex		pc_lock;	/* serialises PDU exchanges */
 } __pmPMCDCtl;
 PCP_CALL extern int __pmAuxConnectPMCDPort(const char *, int);
 
@@ -756,6 +759,17 @@ typedef struct {
     char		*zoneinfo;	/* detailed $TZ at collection host */
 } __pmLogLabel;
 
+/*
+ * Archive feature bits in the v3 label
+ */
+#define PM_LOG_FEATURE_DELTA	0x1	/* data records may be delta encoded */
+
+/*
+ * numpmid in a delta encoded data record ... values are encoded relative
+ * to an earlier (reference) record in the same volume, see logdelta.c
+ */
+#define PM_LOG_DELTA_MARK	-1
+
 /*
  * Internal Temporal Index Record
  */
@@ -797,6 +811,8 @@ typedef struct {
     __pmLogTI	*ti;		/* (when reading) temporal index */
     struct __pmnsTree *pmns;	/* namespace from meta data */
     int		multi;		/* part of a multi-archive context */
+    int		tisorted;	/* (when reading) ti[] in time order, so */
+				/* __pmLogSetTime() may binary search */
 } __pmLogCtl;
 
 /* state values */
@@ -840,6 +856,8 @@ typedef struct {
     int			ac_num_logs;	/* The number of archives */
     int			ac_cur_log;	/* The currently open archive */
     __pmMultiLogCtl	**ac_log_list;	/* Current set of archives */
+    void		*ac_delta;	/* reference records for delta */
+					/*   encoded data records */
 } __pmArchCtl;
 
 /*
@@ -883,6 +901,7 @@ typedef struct {
     __pmTimestamp	c_origin;	/* pmFetch time origin / current time */
     int			c_delta;	/* for updating origin */
     int			c_sent;		/* profile has been sent to pmcd */
+    int			c_sentgen;	/* c_pmcd->pc_gen when profile sent */
     pmProfile		*c_instprof;	/* instance profile */
     void		*c_dm;		/* derived metrics, if any */
     int			c_flags;	/* ctx flags (set via type/env/attrs) */
@@ -925,6 +944,48 @@ PCP_CALL extern int __pmLogAddVolume(__pmArchCtl *, unsigned int);
 PCP_CALL extern int __pmLogRead(__pmArchCtl *, int, __pmFILE *, pmResult **, int);
 PCP_CALL extern int __pmLogRead_ctx(__pmContext *, int, __pmFILE *, pmResult **, int);
 PCP_CALL extern int __pmLogChangeVol(__pmArchCtl *, int);
+
+/*
+ * pipelined forward reading of archive data records, with an optional
+ * per-record transform run by worker threads, results in archive order
+ */
+typedef struct {
+    int		sts;		/* from __pmLogRead_ctx() or the transform */
+    int		vol;		/* input volume holding the record */
+    long	offset;		/* of the record in that volume */
+    pmResult	*rp;
+    void	*data;		/* set by the transform, if any */
+} __pmLogPipeRec;
+typedef int (*__pmLogPipeFn)(__pmLogPipeRec *, void *);
+typedef struct __pmLogPipe __pmLogPipe;
+PCP_CALL extern int __pmLogPipeStart(__pmContext *, int, int, __pmLogPipeFn, void *, __pmLogPipe **);
+PCP_CALL extern int __pmLogPipeNext(__pmLogPipe *, __pmLogPipeRec *);
+PCP_CALL extern void __pmLogPipeStop(__pmLogPipe *);
+
+/*
+ * columnar (per metric-instance) export of numeric archive values, for
+ * long range queries of a few metrics, see logcolumn.c
+ */
+typedef struct {
+    char		*name;		/* metric name */
+    char		*iname;		/* instance name, NULL if singular */
+    int			inst;		/* PM_IN_NULL if singular */
+    pmDesc		desc;
+    int			count;		/* number of values */
+    __pmTimestamp	first;		/* time of first value */
+    __pmTimestamp	last;		/* time of last value */
+} __pmLogColumnDesc;
+typedef struct __pmLogColumns __pmLogColumns;
+PCP_CALL extern int __pmLogColumnsCreate(const char *, const char *, const char *, __pmLogColumns **);
+PCP_CALL extern int __pmLogColumnsAdd(__pmLogColumns *, const char *, const pmDesc *, int, const char *);
+PCP_CALL extern int __pmLogColumnsPut(__pmLogColumns *, int, const __pmTimestamp *, const pmAtomValue *);
+PCP_CALL extern int __pmLogColumnsOpen(const char *, __pmLogColumns **);
+PCP_CALL extern int __pmLogColumnsInfo(__pmLogColumns *, const char **, const char **);
+PCP_CALL extern const __pmLogColumnDesc *__pmLogColumnsDesc(__pmLogColumns *, int);
+PCP_CALL extern int __pmLogColumnsLookup(__pmLogColumns *, const char *, const char *);
+PCP_CALL extern int __pmLogColumnsRead(__pmLogColumns *, int, const __pmTimestamp *, const __pmTimestamp *, double **, double **);
+PCP_CALL extern int __pmLogColumnsClose(__pmLogColumns *);
+
 PCP_CALL extern int __pmLogFetch(__pmContext *, int, pmID *, pmResult **);
 PCP_CALL extern int __pmLogGetInDom(__pmArchCtl *, pmInDom, __pmTimestamp *, int **, char ***);
 PCP_CALL extern int __pmGetArchiveEnd(__pmArchCtl *, __pmTimestamp *);
@@ -956,6 +1017,7 @@ PCP_CALL extern int __pmFinishResult(__pmContext *, int, pmResult **);
 PCP_CALL extern int __pmFinishHighResResult(__pmContext *, int, pmHighResResult **);
 PCP_CALL extern int __pmFetchLocal(__pmContext *, int, pmID *, pmResult **);
 PCP_CALL extern int __pmHighResFetchLocal(__pmContext *, int, pmID *, pmHighResResult **);
+PCP_CALL extern int __pmDecodeResult_ctx(__pmContext *, __pmPDU *, pmResult **);
 
 /* safely insert an atom value into a pmValue */
 PCP_CALL extern int __pmStuffValue(const pmAtomValue *, pmValue *, int);
@@ -19,7 +19,9 @@
 #define MMV_VERSION1	1	/* original on-disk format */
 #define MMV_VERSION2	2	/* + mmv_disk_{metric2,instance2}_t */
 #define MMV_VERSION3	3	/* + labels support */
-#define MMV_VERSION     1	/* default, upgrading to v3 only if needed */
+#define MMV_VERSION4	4	/* + histogram metrics */
+#define MMV_VERSION5	5	/* + sharded values */
+#define MMV_VERSION     1	/* default, upgrading to v5 only if needed */
 
 typedef enum mmv_toc_type {
     MMV_TOC_INDOMS	= 1,	/* mmv_disk_indom_t */
@@ -28,6 +30,7 @@ typedef enum mmv_toc_type {
     MMV_TOC_VALUES	= 4,	/* mmv_disk_value_t */
     MMV_TOC_STRINGS	= 5,	/* mmv_disk_string_t */
     MMV_TOC_LABELS	= 6,	/* mmv_disk_label_t */
+    MMV_TOC_HISTOGRAMS	= 7,	/* mmv_disk_histogram_t */
 } mmv_toc_type_t;
 
 /* The way the Table Of Contents is written into the file */
@@ -101,6 +104,52 @@ typedef struct mmv_disk_value {
     __uint64_t		instance;	/* Offset into the instance section */
 } mmv_disk_value_t;
 
+/*
+ * Histogram buckets are log-linear: values below 8 have a bucket each,
+ * then every power of two is split into 8 equal width buckets, so the
+ * relative error of a bucket bound is at most 12.5% over the full range
+ * of 64-bit values.  A histogram value record holds the sample count,
+ * and its extra field holds the offset of the histogram buckets.
+ */
+#define MMV_HISTOGRAM_BUCKETS	496
+
+typedef struct mmv_disk_histogram {
+    __uint64_t		sum;		/* Sum of all sample values */
+    __uint64_t		padding[7];	/* zero filled, cache line alignment */
+    __uint64_t		buckets[MMV_HISTOGRAM_BUCKETS];	/* Sample counts */
+} mmv_disk_histogram_t;
+
+/* Histogram bucket for a sample value */
+static inline int
+mmv_histogram_bucket(__uint64_t value)
+{
+    int		msb = 3;
+
+    if (value < 8)
+	return (int)value;
+    while (msb < 63 && (value >> (msb + 1)) != 0)
+	msb++;
+    return (msb - 2) * 8 + (int)((value >> (msb - 3)) & 7);
+}
+
+/* Smallest sample value counted in a histogram bucket */
+static inline __uint64_t
+mmv_histogram_lower(int bucket)
+{
+    if (bucket < 8)
+	return (__uint64_t)bucket;
+    return (__uint64_t)(8 + bucket % 8) << (bucket / 8 - 1);
+}
+
+/* Largest sample value counted in a histogram bucket */
+static inline __uint64_t
+mmv_histogram_upper(int bucket)
+{
+    if (bucket < 8)
+	return (__uint64_t)bucket;
+    return mmv_histogram_lower(bucket) + ((__uint64_t)1 << (bucket / 8 - 1)) - 1;
+}
+
 typedef struct mmv_disk_header {
     char		magic[4];	/* MMV\0 */
     __int32_t		version;	/* version */
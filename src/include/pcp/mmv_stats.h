@@ -34,6 +34,7 @@ typedef enum mmv_metric_type {
     MMV_TYPE_DOUBLE    = PM_TYPE_DOUBLE,/* 64-bit floating point */
     MMV_TYPE_STRING    = PM_TYPE_STRING,/* NULL-terminate string */
     MMV_TYPE_ELAPSED   = 9,		/* 64-bit elapsed time */
+    MMV_TYPE_HISTOGRAM = 10,		/* 64-bit samples, bucketed */
 } mmv_metric_type_t;
 
 typedef enum mmv_metric_sem {
@@ -105,6 +106,8 @@ typedef enum mmv_stats_flags {
     MMV_FLAG_NOPREFIX  = 0x1,  /* Don't prefix metric names by filename */ 
     MMV_FLAG_PROCESS   = 0x2,  /* Indicates process check on PID needed */ 
     MMV_FLAG_SENTINEL  = 0x4,  /* Sentinel values == no-value-available */ 
+    MMV_FLAG_SHARDED   = 0x8,  /* Per-thread value shards, summed by PMDA */
+    MMV_FLAG_PADDED    = 0x10, /* One value per cache line, no false sharing */
 } mmv_stats_flags_t;
 
 typedef enum mmv_value_type {
@@ -125,6 +128,9 @@ typedef enum mmv_value_type {
 struct mmv_registry;
 typedef struct mmv_registry mmv_registry_t;
 
+struct mmv_handle;
+typedef struct mmv_handle mmv_handle_t;
+
 extern mmv_registry_t * mmv_stats_registry(const char *, int,
 		mmv_stats_flags_t);
 extern int mmv_stats_add_indom(mmv_registry_t *, int, const char *,
@@ -133,6 +139,7 @@ extern int mmv_stats_add_metric(mmv_registry_t *, const char *, int,
 		mmv_metric_type_t, mmv_metric_sem_t, pmUnits,
 		int, const char *, const char *);
 extern int mmv_stats_add_instance(mmv_registry_t *, int, int, const char *);
+extern int mmv_stats_set_shards(mmv_registry_t *, int);
 
 extern int mmv_stats_add_registry_label(mmv_registry_t *,
 		const char *, const char *, mmv_value_type_t, int);
@@ -151,6 +158,12 @@ extern void mmv_inc_value(void *, pmAtomValue *, double);
 extern void mmv_set_value(void *, pmAtomValue *, double);
 extern void mmv_set_string(void *, pmAtomValue *, const char *, int);
 
+extern mmv_handle_t * mmv_lookup_handle(void *, const char *, const char *);
+extern void mmv_handle_add(mmv_handle_t *, __int64_t);
+extern void mmv_handle_set(mmv_handle_t *, __int64_t);
+extern void mmv_handle_observe(mmv_handle_t *, __uint64_t);
+extern void mmv_handle_free(mmv_handle_t *);
+
 extern void mmv_stats_add(void *, const char *, const char *, double);
 extern void mmv_stats_inc(void *, const char *, const char *);
 extern void mmv_stats_set(void *, const char *, const char *, double);
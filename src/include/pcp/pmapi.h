@@ -355,6 +355,8 @@ PCP_CALL extern int pmNewContext(int, const char *);
 #define PM_CTXFLAG_RELAXED	(1U<<12)/* encrypted if possible else not */
 #define PM_CTXFLAG_AUTH		(1U<<13)/* make authenticated connection */
 #define PM_CTXFLAG_CONTAINER	(1U<<14)/* container connection attribute */
+#define PM_CTXFLAG_ARENA	(1U<<15)/* pmResults allocated as one block */
+#define PM_CTXFLAG_SHARED	(1U<<16)/* share pmcd socket among ctxts */
 
 /*
  * Duplicate current context -- returns handle to new one for pmUseContext()
@@ -1053,6 +1055,8 @@ PCP_CALL extern int pmSetDerivedControl(int, int);
 #define PCP_DERIVED_DEBUG_SYNTAX	3
 #define PCP_DERIVED_DEBUG_SEMANTICS	4
 #define PCP_DERIVED_DEBUG_EVAL		5
+#define PCP_DERIVED_COMPILE		6
+#define PCP_DERIVED_SHARE		7
 
 /*
  * Event Record support
@@ -1149,12 +1153,16 @@ PCP_CALL extern int pmExtendFetchGroup_item(pmFG, const char *, const char *,
 PCP_CALL extern int pmExtendFetchGroup_indom(pmFG, const char *, const char *,
 			int[], char *[], pmAtomValue[], int, int[],
 			unsigned int, unsigned int *, int *);
+PCP_CALL extern int pmExtendFetchGroup_vector(pmFG, const char *, const char *,
+			int[], char *[], double[], int[],
+			unsigned int, unsigned int *, int *);
 PCP_CALL extern int pmExtendFetchGroup_event(pmFG, const char *, const char *,
 			const char *, const char *,
 			struct timespec[], pmAtomValue[], int, int[],
 			unsigned int, unsigned int *, int *);
 PCP_CALL extern int pmExtendFetchGroup_timestamp(pmFG, struct timeval *);
 PCP_CALL extern int pmFetchGroup(pmFG);
+PCP_CALL extern int pmFetchGroups(int, pmFG[], int[], int);
 PCP_CALL extern int pmDestroyFetchGroup(pmFG);
 
 /* libpcp debug/tracing */
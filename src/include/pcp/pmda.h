@@ -83,6 +83,32 @@ typedef int (*pmdaFetchCallBack)(pmdaMetric *, unsigned int, pmAtomValue *);
 #define PMDA_FETCH_STATIC	1
 #define PMDA_FETCH_DYNAMIC	2	/* free avp->vp after __pmStuffValue */
 
+/*
+ * Type of optional function call back used by pmdaFetch to fill in the
+ * values for all requested instances of a metric in a single call.
+ */
+typedef int (*pmdaFetchInDomCallBack)(pmdaMetric *, int, unsigned int *, pmAtomValue *, int *);
+
+/*
+ * Batched fetch, for PMDAs exporting many values.  All requested metrics
+ * and the instances in the profile are resolved by pmdaFetch, then the
+ * values for all of them are filled in by one function call back.  The
+ * entries for metric i are instlist[], values[] and status[] elements
+ * offset[i] through offset[i] + numinst[i] - 1.
+ */
+typedef struct pmdaFetchBatch {
+    int			numpmid;	/* number of metrics requested */
+    pmID		*pmidlist;	/* requested metrics */
+    pmdaMetric		**metrics;	/* metric table entries, NULL if unknown */
+    int			*offset;	/* first value index for each metric */
+    int			*numinst;	/* number of values for each metric */
+    unsigned int	*instlist;	/* instances, PM_IN_NULL for singular */
+    pmAtomValue		*values;	/* values, filled in by the callback */
+    int			*status;	/* as returned from a pmdaFetchCallBack */
+} pmdaFetchBatch;
+
+typedef int (*pmdaFetchBatchCallBack)(pmdaFetchBatch *);
+
 /*
  * Type of function call back used by pmdaMain to clean up a pmResult structure
  * after a fetch.
@@ -456,6 +482,17 @@ typedef struct pmdaOptions {
  *      pmAtom structure with a metrics value. This must be set if pmdaFetch is
  *      used as the fetch callback.
  *
+ * pmdaSetFetchInDomCallBack
+ *      Allows an application specific routine to be specified for completing
+ *      the pmAtom structures for all requested instances of a metric with
+ *      an instance domain in one call.  Optional, and used in preference to
+ *      the fetch callback for metrics it handles.
+ *
+ * pmdaSetFetchBatchCallBack
+ *      Allows an application specific routine to be specified for completing
+ *      the pmAtom structures for all requested metrics and instances in one
+ *      call.  Optional, and used in preference to both callbacks above.
+ *
  * pmdaSetCheckCallBack
  *      Allows an application specific routine to be called upon receipt of any
  *      PDU. For all PDUs except PDU_PROFILE, a result less than zero
@@ -499,6 +536,8 @@ PMDA_CALL extern void pmdaSendError(pmdaInterface *, int);
 
 PMDA_CALL extern void pmdaSetResultCallBack(pmdaInterface *, pmdaResultCallBack);
 PMDA_CALL extern void pmdaSetFetchCallBack(pmdaInterface *, pmdaFetchCallBack);
+PMDA_CALL extern void pmdaSetFetchInDomCallBack(pmdaInterface *, pmdaFetchInDomCallBack);
+PMDA_CALL extern void pmdaSetFetchBatchCallBack(pmdaInterface *, pmdaFetchBatchCallBack);
 PMDA_CALL extern void pmdaSetCheckCallBack(pmdaInterface *, pmdaCheckCallBack);
 PMDA_CALL extern void pmdaSetDoneCallBack(pmdaInterface *, pmdaDoneCallBack);
 PMDA_CALL extern void pmdaSetEndContextCallBack(pmdaInterface *, pmdaEndContextCallBack);
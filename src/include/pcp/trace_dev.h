@@ -85,6 +85,55 @@ extern int __pmtracedecodedata(__pmTracePDU *, char **, int *, int *, int *, dou
 
 extern int __pmtraceprotocol(int);
 
+/*
+ * Shared memory transport, one ring buffer file per traced process
+ * in $PCP_TMP_DIR/trace, written by libpcp_trace and drained by
+ * pmdatrace, see shm.c in libpcp_trace
+ */
+#define TRACE_ENV_SHM		"PCP_TRACE_SHM"
+#define TRACE_SHM_MAGIC		0x54524143	/* "TRAC" */
+#define TRACE_SHM_VERSION	2
+#define TRACE_SHM_SLOTS		8192		/* default ring size */
+#define TRACE_SHM_MAXSLOTS	(1<<20)
+#define TRACE_SHM_BUSY		(((__uint64_t)1)<<63)	/* | claimed position+1 */
+
+typedef struct {
+    __uint32_t		magic;
+    __uint32_t		version;
+    __int32_t		pid;		/* process writing into this ring */
+    __uint32_t		nslots;		/* a power of 2 */
+    char		pad0[48];
+    __uint64_t		head;		/* next position claimed by a writer */
+    char		pad1[56];	/* head is on a cacheline of its own */
+} __pmTraceShmHdr;
+
+typedef struct {
+    __uint64_t		seq;		/* position+1, BUSY while writing */
+    __int32_t		type;
+    __int32_t		taglen;		/* includes the null-byte terminator */
+    double		value;
+    char		tag[MAXTAGNAMELEN];
+} __pmTraceShmSlot;
+
+typedef struct {			/* pmdatrace's view of one ring */
+    __pmTraceShmHdr	*hdr;		/* read-only mapping */
+    __pmTraceShmSlot	*slot;
+    size_t		size;
+    __uint32_t		nslots;
+    __int32_t		pid;
+    __int32_t		owner;		/* process holding the ring's lock */
+    __uint64_t		tail;		/* next position to read */
+    __uint64_t		stall;		/* tail+1 if waiting on an unwritten slot */
+    __uint64_t		lost;		/* events overwritten or dropped */
+} __pmTraceShmReader;
+
+extern char *__pmtraceshmdir(char *, size_t);
+extern int __pmtraceshmopen(void);
+extern int __pmtraceshmpost(const char *, int, int, double);
+extern int __pmtraceshmattach(const char *, __pmTraceShmReader *);
+extern int __pmtraceshmread(__pmTraceShmReader *, __pmTraceShmSlot *);
+extern void __pmtraceshmdetach(__pmTraceShmReader *);
+
 extern int __pmstate;
 
 #ifdef __cplusplus
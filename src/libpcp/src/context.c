@@ -421,6 +421,79 @@ ctxlocal(__pmHashCtl *attrs)
     return 0;
 }
 
+/*
+ * Find an existing connection for a PM_CTXFLAG_SHARED host context,
+ * i.e. one made by another shared context with the same host spec,
+ * attributes and connection flags.  On success the reference count
+ * of the connection is bumped (under contexts_lock, which protects
+ * pc_refcnt) and it is returned, else NULL.
+ */
+static __pmPMCDCtl *
+sharedpmcd(__pmHostSpec *hosts, int nhosts, __pmContext *new)
+{
+    __pmContext	*ctxp;
+    __pmPMCDCtl	*ctl = NULL;
+    char	spec[4096];
+    char	other[4096];
+    int		i;
+
+    if (__pmUnparseHostAttrsSpec(hosts, nhosts, &new->c_attrs,
+				spec, sizeof(spec)) < 0)
+	return NULL;
+
+    PM_LOCK(contexts_lock);
+    for (i = 0; i < contexts_len; i++) {
+	if (contexts_map[i] < 0)
+	    continue;
+	ctxp = contexts[i];
+	if (ctxp == new || ctxp->c_type != PM_CONTEXT_HOST ||
+	    ctxp->c_pmcd == NULL || ctxp->c_flags != new->c_flags)
+	    continue;
+	if (__pmUnparseHostAttrsSpec(ctxp->c_pmcd->pc_hosts,
+		ctxp->c_pmcd->pc_nhosts, &ctxp->c_attrs,
+		other, sizeof(other)) < 0 || strcmp(spec, other) != 0)
+	    continue;
+	ctl = ctxp->c_pmcd;
+	ctl->pc_refcnt++;
+	if (pmDebugOptions.context)
+	    fprintf(stderr, "pmNewContext: share pmcd connection fd=%d "
+			    "with context %d (refcnt=%d)\n",
+			    ctl->pc_fd, ctxp->c_handle, ctl->pc_refcnt);
+	break;
+    }
+    PM_UNLOCK(contexts_lock);
+    return ctl;
+}
+
+/*
+ * A request/reply exchange on the pmcd connection of a shared host
+ * context timed out or failed.  A late reply would be read by the
+ * next request from whichever context uses the connection next, so
+ * close it now - every sharing context then sees PM_ERR_IPC and must
+ * reconnect, and the bumped generation makes them all resend their
+ * profiles.  Called with c_pmcd->pc_lock held.
+ */
+void
+__pmSharedPMCDError(__pmContext *ctxp, int sts)
+{
+    __pmPMCDCtl	*ctl = ctxp->c_pmcd;
+
+    if ((ctxp->c_flags & PM_CTXFLAG_SHARED) == 0 || ctl->pc_fd < 0)
+	return;
+    if (sts != PM_ERR_TIMEOUT && sts != PM_ERR_IPC &&
+	sts != -EPIPE && sts != -ECONNRESET)
+	return;
+    if (pmDebugOptions.context) {
+	char	errmsg[PM_MAXERRMSGLEN];
+
+	fprintf(stderr, "context %d: close shared pmcd connection fd=%d: %s\n",
+		ctxp->c_handle, ctl->pc_fd, pmErrStr_r(sts, errmsg, sizeof(errmsg)));
+    }
+    __pmCloseSocket(ctl->pc_fd);
+    ctl->pc_fd = -1;
+    ctl->pc_gen++;
+}
+
 static int
 ctxflags(__pmHashCtl *attrs, int *flags)
 {
@@ -806,6 +879,7 @@ initarchive(__pmContext	*ctxp, const char *name)
     acp->ac_log_list = NULL;
     acp->ac_log = NULL;
     acp->ac_mark_done = 0;
+    acp->ac_delta = NULL;
 
     /*
      * The list of names may contain one or more directories. Examine the
@@ -1146,6 +1220,19 @@ INIT_CONTEXT:
 	    goto FAILED;
 	}
 
+	/*
+	 * For shared contexts, first look for an existing connection
+	 * to the same pmcd with the same attributes.  pmcd keeps the
+	 * instance profiles by the context slot number sent in each
+	 * request and derived metrics are evaluated here, so contexts
+	 * can share one connection if their requests are serialized.
+	 */
+	if ((new->c_flags & PM_CTXFLAG_SHARED) &&
+	    (new->c_pmcd = sharedpmcd(hosts, nhosts, new)) != NULL) {
+	    __pmFreeHostSpec(hosts, nhosts);
+	    goto INSTALL;
+	}
+
 	/*
 	 * Try to establish the connection.
 	 * If this fails, restore the original current context
@@ -1170,6 +1257,8 @@ INIT_CONTEXT:
 	new->c_pmcd->pc_hosts = hosts;
 	new->c_pmcd->pc_nhosts = nhosts;
 	new->c_pmcd->pc_tout_sec = __pmConvertTimeout(TIMEOUT_DEFAULT) / 1000;
+	new->c_pmcd->pc_refcnt = 1;
+	__pmInitMutex(&new->c_pmcd->pc_lock);
     }
     else if (new->c_type == PM_CONTEXT_LOCAL) {
 	if ((sts = ctxlocal(&new->c_attrs)) != 0)
@@ -1196,6 +1285,7 @@ INIT_CONTEXT:
 	goto pmapi_return;
     }
 
+INSTALL:
     /* Take contexts_lock mutex to update contexts[] with this fully operational
        battle station ^W context. */
     PM_LOCK(contexts_lock);
@@ -1301,6 +1391,7 @@ pmReconnectContext(int handle)
 	    goto pmapi_return;
 	}
 
+	PM_LOCK(ctl->pc_lock);
 	if (ctl->pc_fd >= 0) {
 	    /* don't care if this fails */
 	    __pmCloseSocket(ctl->pc_fd);
@@ -1309,6 +1400,7 @@ pmReconnectContext(int handle)
 
 	if ((sts = __pmConnectPMCD(ctl->pc_hosts, ctl->pc_nhosts,
 				   ctxp->c_flags, &ctxp->c_attrs)) < 0) {
+	    PM_UNLOCK(ctl->pc_lock);
 	    PM_UNLOCK(ctxp->c_lock);
 	    waitawhile(ctl);
 	    if (pmDebugOptions.context)
@@ -1320,6 +1412,9 @@ pmReconnectContext(int handle)
 	else {
 	    ctl->pc_fd = sts;
 	    ctl->pc_timeout = 0;
+	    /* profiles of all contexts sharing ctl must be resent */
+	    ctl->pc_gen++;
+	    PM_UNLOCK(ctl->pc_lock);
 	    ctxp->c_sent = 0;
 
 	    if (pmDebugOptions.context)
@@ -1473,6 +1568,7 @@ pmDupContext(void)
 	newcon->c_archctl->ac_pmid_hc.nodes = 0;
 	newcon->c_archctl->ac_pmid_hc.hsize = 0;
 	newcon->c_archctl->ac_cache = NULL;
+	newcon->c_archctl->ac_delta = NULL;
 
 	/*
 	 * Need a new ac_mfp, but pointing at the same volume so ac_offset
@@ -1627,6 +1723,8 @@ __pmPMCDCtlFree(__pmPMCDCtl *cp)
 {
     struct linger	dolinger = {0, 1};
 
+    __pmDestroyMutex(&cp->pc_lock);
+
     if (cp->pc_fd >= 0) {
 	/* before close, unsent data should be flushed */
 	__pmSetSockOpt(cp->pc_fd, SOL_SOCKET, SO_LINGER,
@@ -1662,6 +1760,9 @@ pmDestroyContext(int handle)
     ctxp = contexts[ctxnum];
     PM_LOCK(ctxp->c_lock);
     contexts_map[ctxnum] = MAP_TEARDOWN;
+    /* a shared pmcd connection is closed by the last context using it */
+    if (ctxp->c_pmcd != NULL && --ctxp->c_pmcd->pc_refcnt > 0)
+	ctxp->c_pmcd = NULL;
     PM_UNLOCK(contexts_lock);
     if (ctxp->c_pmcd != NULL) {
 	__pmPMCDCtlFree(ctxp->c_pmcd);
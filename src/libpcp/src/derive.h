@@ -38,6 +38,11 @@ typedef struct {		/* dynamic information for an expression node */
     int			last_numval;	/* length of last_ivlist[] */
     val_t		*last_ivlist;	/* values from previous fetch for delta() or rate() */
     struct timespec	last_stamp;	/* timestamp from previous fetch for rate() */
+    pmAtomValue		*vec;		/* converted operands for binary operators */
+    int			maxvec;		/* length of vec[] */
+    int			vsetidx;	/* N_NAME: vset[] index in the last pmResult */
+    unsigned int	evalgen;	/* ctl_t fetchgen when last evaluated */
+    int			evalsts;	/* and the result of that evaluation */
 } info_t;
 
 typedef struct {			/* for instance filtering */
@@ -64,17 +69,38 @@ typedef struct node {		/* expression tree node */
     struct node	*left;
     struct node	*right;
     char	*value;
+    int		share;		/* bit-field flags, see SHARE_* macros below */
     union {
 	info_t		*info;
 	pattern_t	*pattern;
     } data;
 } node_t;
 
+/* bit-fields for share above */
+#define SHARE_NODE	1	/* operand of more than one expression node */
+#define SHARE_LEFT	2	/* left operand is owned by another node */
+#define SHARE_RIGHT	4	/* right operand is owned by another node */
+
+typedef struct {		/* hangs off .data field of __pmHashNode in nodehash */
+    node_t	*np;		/* shareable node */
+    int		owner;		/* mlist[] index of the expression that owns np */
+} share_t;
+
 /* bit-fields for flags below */
 #define DM_BIND		1	/* 0/1 if bind expr() has been called */
 #define DM_GLOBAL	2	/* 0 => per-context, 1 => global */
 #define DM_MASKED	4	/* 1 => global name masked by per-context name */
 #define DM_FREE		8	/* 1 => entry not used */
+#define DM_COMPILED	16	/* 1 => evaluate prog[] rather than expr */
+#define DM_BINDING	32	/* 1 => __dmbind() in progress */
+#define DM_RECOMPILE	64	/* 1 => nodes now shared, prog[] is stale */
+
+typedef struct {		/* one instruction of a compiled expression */
+    node_t	*np;		/* node to evaluate, operands already done */
+    int		onerr;		/* resume at this insn if np fails, -1 to stop */
+    int		vector;		/* 1 => binary operator over whole vectors */
+    int		skip;		/* > 0 => start of shared np, skip to here if done */
+} insn_t;
 
 typedef struct {		/* one derived metric */
     char	*name;
@@ -84,6 +110,10 @@ typedef struct {		/* one derived metric */
     node_t	*expr;		/* NULL => invalid, e.g. dup or missing operands */
     const char	*oneline;	/* help text for PM_TEXT_ONELINE */
     const char	*helptext;	/* help text for PM_TEXT_HELP */
+    int		ninsn;		/* length of prog[] */
+    insn_t	*prog;		/* expr compiled by __dmcompile() */
+    int		nops;		/* length of ops[] */
+    pmID	*ops;		/* operand metrics to be fetched, see __dmoperands() */
 } dm_t;
 
 #define DM_UNLIMITED	-1	/* no limit on the # of derived metrics */
@@ -105,6 +135,16 @@ typedef struct {
     int			glob_last;	/* last global metric added */
     int			fetch_has_dm;	/* ==1 if pmResult rewrite needed */
     int			numpmid;	/* from pmFetch before rewrite */
+    unsigned int	fetchgen;	/* bumped for each pmResult rewrite */
+    unsigned int	bindgen;	/* bumped for each __dmbind() */
+    int			nhashed;	/* mlist[] entries in pmidhash */
+    __pmHashCtl		pmidhash;	/* pmID -> mlist[] index + 1 */
+    __pmHashCtl		nodehash;	/* shareable expression nodes */
+    int			pf_numpmid;	/* last pmFetch list for __dmprefetch() */
+    pmID		*pf_pmidlist;
+    int			pf_newcnt;	/* and the combined list returned */
+    pmID		*pf_newlist;
+    unsigned int	pf_bindgen;	/* bindgen when pf_* saved */
 } ctl_t;
 
 /* node_t types */
@@ -161,6 +201,11 @@ extern int __dmdesc(__pmContext *, int, pmID, pmDesc *) _PCP_HIDDEN;
 extern int __dmprefetch(__pmContext *, int, const pmID *, pmID **) _PCP_HIDDEN;
 extern void __dmpostfetch(__pmContext *, pmResult **) _PCP_HIDDEN;
 extern void __dmposthighresfetch(__pmContext *, pmHighResResult **) _PCP_HIDDEN;
+extern void __dmcompile(__pmContext *, dm_t *) _PCP_HIDDEN;
+extern void __dmfreeprog(dm_t *) _PCP_HIDDEN;
+extern void __dmoperands(__pmContext *, dm_t *) _PCP_HIDDEN;
+extern int __dmlookup(ctl_t *, pmID) _PCP_HIDDEN;
+extern void __dmfreectl(ctl_t *) _PCP_HIDDEN;
 extern void __dmdumpexpr(node_t *, int) _PCP_HIDDEN;
 extern char *__dmnode_type_str(int) _PCP_HIDDEN;
 extern int __dmhelptext(pmID, int, char **) _PCP_HIDDEN;
@@ -27,22 +27,86 @@
 
 extern const int promote[6][6];
 
+/*
+ * Map a derived metric pmID to its mlist[] index, or -1 if not found.
+ * The hash is extended on demand as metrics are added to the context,
+ * and like a linear search the first mlist[] entry for a pmID wins.
+ */
+int
+__dmlookup(ctl_t *cp, pmID pmid)
+{
+    __pmHashNode	*hp;
+
+    for ( ; cp->nhashed < cp->nmetric; cp->nhashed++) {
+	if (__pmHashSearch(cp->mlist[cp->nhashed].pmid, &cp->pmidhash) != NULL)
+	    continue;
+	if (__pmHashAdd(cp->mlist[cp->nhashed].pmid,
+			(void *)(__psint_t)(cp->nhashed+1), &cp->pmidhash) < 0) {
+	    pmNoMem("__dmlookup: pmidhash", sizeof(__pmHashNode), PM_FATAL_ERR);
+	    /*NOTREACHED*/
+	}
+    }
+    if ((hp = __pmHashSearch(pmid, &cp->pmidhash)) == NULL)
+	return -1;
+    return (int)(__psint_t)hp->data - 1;
+}
+
 static void
-get_pmids(node_t *np, int *cnt, pmID **list)
+add_pmid(pmID pmid, int *cnt, pmID **list)
 {
+    int		i;
+
+    for (i = 0; i < *cnt; i++) {
+	if ((*list)[i] == pmid)
+	    return;
+    }
+    (*cnt)++;
+    if ((*list = (pmID *)realloc(*list, (*cnt)*sizeof(pmID))) == NULL) {
+	pmNoMem("__dmoperands: realloc ops", (*cnt)*sizeof(pmID), PM_FATAL_ERR);
+	/*NOTREACHED*/
+    }
+    (*list)[*cnt-1] = pmid;
+}
+
+static void
+get_pmids(ctl_t *cp, node_t *np, int *cnt, pmID **list)
+{
+    int		i;
+    int		m;
+
     assert(np != NULL);
-    if (np->left != NULL) get_pmids(np->left, cnt, list);
-    if (np->right != NULL) get_pmids(np->right, cnt, list);
+    if (np->left != NULL) get_pmids(cp, np->left, cnt, list);
+    if (np->right != NULL) get_pmids(cp, np->right, cnt, list);
     if (np->type == N_NAME) {
-	(*cnt)++;
-	if ((*list = (pmID *)realloc(*list, (*cnt)*sizeof(pmID))) == NULL) {
-	    pmNoMem("__dmprefetch: realloc xtralist", (*cnt)*sizeof(pmID), PM_FATAL_ERR);
-	    /*NOTREACHED*/
+	if (IS_DERIVED(np->data.info->pmid) &&
+	    (m = __dmlookup(cp, np->data.info->pmid)) >= 0) {
+	    /* derived metric operand, fetch its operands instead */
+	    for (i = 0; i < cp->mlist[m].nops; i++)
+		add_pmid(cp->mlist[m].ops[i], cnt, list);
 	}
-	(*list)[*cnt-1] = np->data.info->pmid;
+	else
+	    add_pmid(np->data.info->pmid, cnt, list);
     }
 }
 
+/*
+ * Build the list of metrics to be fetched for a bound derived metric,
+ * i.e. the leaf operands of the expression, with any derived metric
+ * operands (bound before this one) replaced by their operands.
+ */
+void
+__dmoperands(__pmContext *ctxp, dm_t *dmp)
+{
+    ctl_t	*cp = (ctl_t *)ctxp->c_dm;
+
+    if (dmp->ops != NULL)
+	free(dmp->ops);
+    dmp->ops = NULL;
+    dmp->nops = 0;
+    if (dmp->expr != NULL)
+	get_pmids(cp, dmp->expr, &dmp->nops, &dmp->ops);
+}
+
 /*
  * Walk the pmidlist[] from pmFetch.
  * For each derived metric found in the list add all the operand metrics,
@@ -54,6 +118,10 @@ get_pmids(node_t *np, int *cnt, pmID **list)
  * The derived metric pmIDs are left in the combined list (they will
  * return PM_ERR_NOAGENT from the fetch) to simplify the post-processing
  * of the pmResult in __dmpostfetch()
+ *
+ * Most callers fetch the same pmidlist[] over and over, so the last
+ * combined list is kept and reused until the pmidlist[] changes or
+ * another derived metric is bound in this context.
  */
 int
 __dmprefetch(__pmContext *ctxp, int numpmid, const pmID *pmidlist, pmID **newlist)
@@ -63,7 +131,7 @@ __dmprefetch(__pmContext *ctxp, int numpmid, const pmID *pmidlist, pmID **newlis
     int		m;
     int		xtracnt = 0;
     pmID	*xtralist = NULL;
-    pmID	*list;
+    pmID	*list = NULL;
     ctl_t	*cp = (ctl_t *)ctxp->c_dm;
 
     /* if needed, __dminit() called in __dmopencontext beforehand */
@@ -79,33 +147,44 @@ __dmprefetch(__pmContext *ctxp, int numpmid, const pmID *pmidlist, pmID **newlis
     cp->numpmid = numpmid;
     cp->fetch_has_dm = 0;
 
+    if (cp->pf_pmidlist != NULL && cp->pf_bindgen == cp->bindgen &&
+	cp->pf_numpmid == numpmid &&
+	memcmp(cp->pf_pmidlist, pmidlist, numpmid*sizeof(pmID)) == 0) {
+	/* same as last time */
+	cp->fetch_has_dm = 1;
+	if (cp->pf_newcnt > numpmid) {
+	    if ((list = (pmID *)malloc(cp->pf_newcnt*sizeof(pmID))) == NULL) {
+		pmNoMem("__dmprefetch: alloc list", cp->pf_newcnt*sizeof(pmID), PM_FATAL_ERR);
+		/*NOTREACHED*/
+	    }
+	    memcpy(list, cp->pf_newlist, cp->pf_newcnt*sizeof(pmID));
+	    *newlist = list;
+	}
+	return cp->pf_newcnt;
+    }
+
     for (m = 0; m < numpmid; m++) {
 	if (!IS_DERIVED(pmidlist[m]))
 	    continue;
-	for (i = 0; i < cp->nmetric; i++) {
-	    if (pmidlist[m] == cp->mlist[i].pmid) {
-		if ((cp->mlist[i].flags & DM_BIND) == 0)
-		    __dmbind(PM_NOT_LOCKED, ctxp, i, 1);
-		if (cp->mlist[i].expr != NULL) {
-		    get_pmids(cp->mlist[i].expr, &xtracnt, &xtralist);
-		    cp->fetch_has_dm = 1;
-		}
-		break;
-	    }
+	if ((i = __dmlookup(cp, pmidlist[m])) < 0)
+	    continue;
+	if ((cp->mlist[i].flags & DM_BIND) == 0)
+	    __dmbind(PM_NOT_LOCKED, ctxp, i, 1);
+	if (cp->mlist[i].expr != NULL) {
+	    for (j = 0; j < cp->mlist[i].nops; j++)
+		add_pmid(cp->mlist[i].ops[j], &xtracnt, &xtralist);
+	    cp->fetch_has_dm = 1;
 	}
     }
-    if (xtracnt == 0) {
-	if (cp->fetch_has_dm)
-	    return numpmid;
-	else
-	    return 0;
+    if (cp->fetch_has_dm == 0) {
+	free(xtralist);
+	return 0;
     }
 
     /*
      * Some of the "extra" ones, may already be in the caller's pmFetch 
-     * list, or repeated in xtralist[] (if the same metric operand appears
-     * more than once as a leaf node in the expression tree.
-     * Remove these duplicates
+     * list, remove these duplicates (add_pmid() has already removed
+     * any repeated in xtralist[]).
      */
     j = 0;
     for (i = 0; i < xtracnt; i++) {
@@ -114,40 +193,52 @@ __dmprefetch(__pmContext *ctxp, int numpmid, const pmID *pmidlist, pmID **newlis
 		/* already in pmFetch list */
 		break;
 	}
-	if (m < numpmid) continue;
-	for (m = 0; m < j; m++) {
-	    if (xtralist[i] == xtralist[m])
-	    	/* already in xtralist[] */
-		break;
-	}
-	if (m == j)
+	if (m == numpmid)
 	    xtralist[j++] = xtralist[i];
     }
     xtracnt = j;
-    if (xtracnt == 0) {
-	free(xtralist);
-	return numpmid;
-    }
 
-    if (pmDebugOptions.derive && pmDebugOptions.appl2) {
-	char	strbuf[20];
-	fprintf(stderr, "derived metrics prefetch added %d metrics:", xtracnt);
-	for (i = 0; i < xtracnt; i++)
-	    fprintf(stderr, " %s", pmIDStr_r(xtralist[i], strbuf, sizeof(strbuf)));
-	fputc('\n', stderr);
-    }
-    if ((list = (pmID *)malloc((numpmid+xtracnt)*sizeof(pmID))) == NULL) {
-	pmNoMem("__dmprefetch: alloc list", (numpmid+xtracnt)*sizeof(pmID), PM_FATAL_ERR);
-	/*NOTREACHED*/
-    }
-    for (m = 0; m < numpmid; m++) {
-	list[m] = pmidlist[m];
-    }
-    for (i = 0; i < xtracnt; i++) {
-	list[m++] = xtralist[i];
+    if (xtracnt > 0) {
+	if (pmDebugOptions.derive && pmDebugOptions.appl2) {
+	    char	strbuf[20];
+	    fprintf(stderr, "derived metrics prefetch added %d metrics:", xtracnt);
+	    for (i = 0; i < xtracnt; i++)
+		fprintf(stderr, " %s", pmIDStr_r(xtralist[i], strbuf, sizeof(strbuf)));
+	    fputc('\n', stderr);
+	}
+	if ((list = (pmID *)malloc((numpmid+xtracnt)*sizeof(pmID))) == NULL) {
+	    pmNoMem("__dmprefetch: alloc list", (numpmid+xtracnt)*sizeof(pmID), PM_FATAL_ERR);
+	    /*NOTREACHED*/
+	}
+	for (m = 0; m < numpmid; m++) {
+	    list[m] = pmidlist[m];
+	}
+	for (i = 0; i < xtracnt; i++) {
+	    list[m++] = xtralist[i];
+	}
+	*newlist = list;
     }
+    else
+	m = numpmid;
     free(xtralist);
-    *newlist = list;
+
+    /* remember this one for next time */
+    free(cp->pf_pmidlist);
+    free(cp->pf_newlist);
+    cp->pf_newlist = NULL;
+    if ((cp->pf_pmidlist = (pmID *)malloc(numpmid*sizeof(pmID))) != NULL) {
+	memcpy(cp->pf_pmidlist, pmidlist, numpmid*sizeof(pmID));
+	if (list != NULL &&
+	    (cp->pf_newlist = (pmID *)malloc(m*sizeof(pmID))) != NULL)
+	    memcpy(cp->pf_newlist, list, m*sizeof(pmID));
+	if (list != NULL && cp->pf_newlist == NULL) {
+	    free(cp->pf_pmidlist);
+	    cp->pf_pmidlist = NULL;
+	}
+    }
+    cp->pf_numpmid = numpmid;
+    cp->pf_newcnt = m;
+    cp->pf_bindgen = cp->bindgen;
 
     return m;
 }
@@ -635,6 +726,301 @@ bin_op(int type, int op, pmAtomValue a, int ltype, int lmul, int ldiv, pmAtomVal
     return res;
 }
 
+/*
+ * One trip initialization for rate() time utilization scaling factor
+ * (to scale metric from counter units into seconds), done when the
+ * expression is compiled or else on the first evaluation.
+ */
+static void
+rate_time_scale(node_t *np)
+{
+    int		n;
+
+    np->data.info->time_scale = 1;
+    if (np->left->desc.units.scaleTime > PM_TIME_SEC) {
+	for (n = PM_TIME_SEC; n < np->left->desc.units.scaleTime; n++)
+	    np->data.info->time_scale *= 60;
+    }
+    else {
+	for (n = np->left->desc.units.scaleTime; n < PM_TIME_SEC; n++)
+	    np->data.info->time_scale /= 1000;
+    }
+}
+
+/*
+ * Convert n operand values of type stype to the type dtype used for
+ * a binary operator, as bin_op() does for a single value, but with
+ * the type dispatch done once for the whole vector.
+ */
+static void
+promote_vec(pmAtomValue *dst, const val_t *src, int n, int stype, int dtype,
+		int mul, int div)
+{
+    int		i;
+
+    switch (dtype) {
+	case PM_TYPE_64:
+	    if (stype == PM_TYPE_32) {
+		for (i = 0; i < n; i++)
+		    dst[i].ll = src[i].value.l;
+		return;
+	    }
+	    if (stype == PM_TYPE_U32) {
+		for (i = 0; i < n; i++)
+		    dst[i].ll = src[i].value.ul;
+		return;
+	    }
+	    break;
+	case PM_TYPE_U64:
+	    if (stype == PM_TYPE_32) {
+		for (i = 0; i < n; i++)
+		    dst[i].ull = src[i].value.l;
+		return;
+	    }
+	    if (stype == PM_TYPE_U32) {
+		for (i = 0; i < n; i++)
+		    dst[i].ull = src[i].value.ul;
+		return;
+	    }
+	    break;
+	case PM_TYPE_FLOAT:
+	    switch (stype) {
+		case PM_TYPE_32:
+		    for (i = 0; i < n; i++)
+			dst[i].f = src[i].value.l;
+		    return;
+		case PM_TYPE_U32:
+		    for (i = 0; i < n; i++)
+			dst[i].f = src[i].value.ul;
+		    return;
+		case PM_TYPE_64:
+		    for (i = 0; i < n; i++)
+			dst[i].f = src[i].value.ll;
+		    return;
+		case PM_TYPE_U64:
+		    for (i = 0; i < n; i++)
+			dst[i].f = src[i].value.ull;
+		    return;
+	    }
+	    break;
+	case PM_TYPE_DOUBLE:
+	    switch (stype) {
+		case PM_TYPE_32:
+		    for (i = 0; i < n; i++)
+			dst[i].d = src[i].value.l;
+		    break;
+		case PM_TYPE_U32:
+		    for (i = 0; i < n; i++)
+			dst[i].d = src[i].value.ul;
+		    break;
+		case PM_TYPE_64:
+		    for (i = 0; i < n; i++)
+			dst[i].d = src[i].value.ll;
+		    break;
+		case PM_TYPE_U64:
+		    for (i = 0; i < n; i++)
+			dst[i].d = src[i].value.ull;
+		    break;
+		case PM_TYPE_FLOAT:
+		    for (i = 0; i < n; i++)
+			dst[i].d = src[i].value.f;
+		    break;
+		default:
+		    for (i = 0; i < n; i++)
+			dst[i].d = src[i].value.d;
+		    break;
+	    }
+	    /* units scale conversion, precomputed in check_expr() */
+	    if (mul != 1 || div != 1) {
+		for (i = 0; i < n; i++)
+		    dst[i].d = (dst[i].d / div) * mul;
+	    }
+	    return;
+    }
+    /* same type, or the same bits as for bin_op() */
+    for (i = 0; i < n; i++)
+	dst[i] = src[i].value;
+}
+
+#define VEC_OP(f) \
+    switch (np->type) { \
+	case N_PLUS: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f + rv[k*rs].f; \
+	    break; \
+	case N_MINUS: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f - rv[k*rs].f; \
+	    break; \
+	case N_STAR: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f * rv[k*rs].f; \
+	    break; \
+	case N_SLASH: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f == 0 ? 0 : lv[k].f / rv[k*rs].f; \
+	    break; \
+	case N_LT: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f < rv[k*rs].f; \
+	    break; \
+	case N_LEQ: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f <= rv[k*rs].f; \
+	    break; \
+	case N_EQ: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f == rv[k*rs].f; \
+	    break; \
+	case N_GEQ: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f >= rv[k*rs].f; \
+	    break; \
+	case N_GT: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f > rv[k*rs].f; \
+	    break; \
+	case N_NEQ: \
+	    for (k = 0; k < n; k++) lv[k].f = lv[k].f != rv[k*rs].f; \
+	    break; \
+	case N_AND: \
+	    for (k = 0; k < n; k++) lv[k].f = (lv[k].f != 0) && (rv[k*rs].f != 0); \
+	    break; \
+	case N_OR: \
+	    for (k = 0; k < n; k++) lv[k].f = (lv[k].f != 0) || (rv[k*rs].f != 0); \
+	    break; \
+	default: \
+	    return -1; \
+    }
+
+/*
+ * Binary operator over whole operand vectors, for the usual case where
+ * operands with instance domains have the same instances in the same
+ * order.  Returns 0 with np->data.info->ivlist[] filled in, or -1 if the
+ * value at a time path in eval_node() must be used instead.
+ */
+static int
+bin_vec(node_t *np)
+{
+    info_t	*ip = np->data.info;
+    info_t	*lip = np->left->data.info;
+    info_t	*rip = np->right->data.info;
+    val_t	*insts;
+    pmAtomValue	*lv;
+    pmAtomValue	*rv;
+    int		relop;
+    int		type;
+    int		n = ip->numval;
+    int		rs = 1;
+    int		k;
+
+    if (np->left->desc.indom != PM_INDOM_NULL &&
+	np->right->desc.indom != PM_INDOM_NULL) {
+	if (lip->numval != n || rip->numval != n)
+	    return -1;
+	for (k = 0; k < n; k++) {
+	    if (lip->ivlist[k].inst != rip->ivlist[k].inst)
+		return -1;
+	}
+    }
+
+    relop = (np->type >= N_LT && np->type <= N_OR);
+    if (relop)
+	type = promote[np->left->desc.type][np->right->desc.type];
+    else
+	type = np->desc.type;
+    /* semantics enforce no N_SLASH for integer results */
+    if (np->type == N_SLASH && type != PM_TYPE_DOUBLE)
+	return -1;
+
+    if (ip->maxvec < 2 * n) {
+	pmAtomValue	*tmp_vec;
+
+	if ((tmp_vec = (pmAtomValue *)realloc(ip->vec, 2 * n * sizeof(pmAtomValue))) == NULL) {
+	    pmNoMem("bin_vec: operand vector", 2 * n * sizeof(pmAtomValue), PM_FATAL_ERR);
+	    /*NOTREACHED*/
+	}
+	ip->vec = tmp_vec;
+	ip->maxvec = 2 * n;
+    }
+    lv = ip->vec;
+    rv = ip->vec + n;
+
+    if (np->left->desc.indom == PM_INDOM_NULL) {
+	promote_vec(lv, lip->ivlist, 1, np->left->desc.type, type,
+			lip->mul_scale, lip->div_scale);
+	for (k = 1; k < n; k++)
+	    lv[k] = lv[0];
+	insts = rip->ivlist;
+    }
+    else {
+	promote_vec(lv, lip->ivlist, n, np->left->desc.type, type,
+			lip->mul_scale, lip->div_scale);
+	insts = lip->ivlist;
+    }
+    if (np->right->desc.indom == PM_INDOM_NULL) {
+	promote_vec(rv, rip->ivlist, 1, np->right->desc.type, type,
+			rip->mul_scale, rip->div_scale);
+	rs = 0;
+    }
+    else
+	promote_vec(rv, rip->ivlist, n, np->right->desc.type, type,
+			rip->mul_scale, rip->div_scale);
+
+    switch (type) {
+	case PM_TYPE_32:
+	    VEC_OP(l)
+	    break;
+	case PM_TYPE_U32:
+	    VEC_OP(ul)
+	    break;
+	case PM_TYPE_64:
+	    VEC_OP(ll)
+	    break;
+	case PM_TYPE_U64:
+	    VEC_OP(ull)
+	    break;
+	case PM_TYPE_FLOAT:
+	    VEC_OP(f)
+	    break;
+	case PM_TYPE_DOUBLE:
+	    VEC_OP(d)
+	    break;
+	default:
+	    return -1;
+    }
+
+    for (k = 0; k < n; k++)
+	ip->ivlist[k].inst = insts[k].inst;
+    if (!relop) {
+	for (k = 0; k < n; k++)
+	    ip->ivlist[k].value = lv[k];
+	return 0;
+    }
+    /*
+     * relational and boolean operators cast the result back to a
+     * U32 value
+     */
+    switch (type) {
+	case PM_TYPE_32:
+	    for (k = 0; k < n; k++)
+		ip->ivlist[k].value.ul = (__uint32_t)lv[k].l;
+	    break;
+	case PM_TYPE_U32:
+	    for (k = 0; k < n; k++)
+		ip->ivlist[k].value.ul = (__uint32_t)lv[k].ul;
+	    break;
+	case PM_TYPE_64:
+	    for (k = 0; k < n; k++)
+		ip->ivlist[k].value.ul = (__uint32_t)lv[k].ll;
+	    break;
+	case PM_TYPE_U64:
+	    for (k = 0; k < n; k++)
+		ip->ivlist[k].value.ul = (__uint32_t)lv[k].ull;
+	    break;
+	case PM_TYPE_FLOAT:
+	    for (k = 0; k < n; k++)
+		ip->ivlist[k].value.ul = (__uint32_t)lv[k].f;
+	    break;
+	case PM_TYPE_DOUBLE:
+	    for (k = 0; k < n; k++)
+		ip->ivlist[k].value.ul = (__uint32_t)lv[k].d;
+	    break;
+    }
+    return 0;
+}
+
 /*
  * For regular expression instance matching, the hash list of observed
  * instances could grow without bounds for a dynamic indom.
@@ -675,13 +1061,33 @@ regex_inst_gc(pattern_t *pp)
 }
 
 /*
- * Walk an expression tree, filling in operand values from the
- * pmResult at the leaf nodes and propagating the computed values
- * towards the root node of the tree.
+ * count() ... special case, map errors in the operand to 0
  */
 static int
-eval_expr(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
-		pmValueSet **vset, int level)
+count_error(node_t *np)
+{
+    if (np->data.info->ivlist == NULL) {
+	/* initialize ivlist[] for singular instance first time through */
+	if ((np->data.info->ivlist = (val_t *)malloc(sizeof(val_t))) == NULL) {
+	    pmNoMem("eval_expr: count ivlist", sizeof(val_t), PM_FATAL_ERR);
+	    /*NOTREACHED*/
+	}
+	np->data.info->ivlist[0].inst = PM_IN_NULL;
+    }
+    np->data.info->numval = 1;
+    np->data.info->ivlist[0].value.l = 0;
+    return 1;
+}
+
+static int eval_ref(__pmContext *, node_t *, struct timespec *, int, pmValueSet **);
+
+/*
+ * Compute the values for one expression node, from the values
+ * already computed for its operands.
+ */
+static int
+eval_node(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
+		pmValueSet **vset, int vector)
 {
     int		sts;
     int		i;
@@ -691,30 +1097,6 @@ eval_expr(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
     char	strbuf[20];
 
     assert(np != NULL);
-    if (np->left != NULL) {
-	sts = eval_expr(ctxp, np->left, stamp, numpmid, vset, level+1);
-	if (sts < 0) {
-	    if (np->type == N_COUNT) {
-		/* count() ... special case, map errors to 0 */
-		if (np->data.info->ivlist == NULL) {
-		    /* initialize ivlist[] for singular instance first time through */
-		    if ((np->data.info->ivlist = (val_t *)malloc(sizeof(val_t))) == NULL) {
-			pmNoMem("eval_expr: count ivlist", sizeof(val_t), PM_FATAL_ERR);
-			/*NOTREACHED*/
-		    }
-		    np->data.info->ivlist[0].inst = PM_IN_NULL;
-		}
-		np->data.info->numval = 1;
-		np->data.info->ivlist[0].value.l = 0;
-		sts = 1;
-	    }
-	    return sts;
-	}
-    }
-    if (np->right != NULL) {
-	sts = eval_expr(ctxp, np->right, stamp, numpmid, vset, level+1);
-	if (sts < 0) return sts;
-    }
 
     /* mostly, np->left is not NULL ... */
     assert (np->type == N_INTEGER || np->type == N_DOUBLE ||
@@ -884,23 +1266,8 @@ eval_expr(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
 		     */
 		    if (np->left->desc.units.dimTime == 1) {
 			/* scale rate(time counter) -> time utilization */
-			if (np->data.info->time_scale < 0) {
-			    /*
-			     * one trip initialization for time utilization
-			     * scaling factor (to scale metric from counter
-			     * units into seconds)
-			     */
-			    int		n;
-			    np->data.info->time_scale = 1;
-			    if (np->left->desc.units.scaleTime > PM_TIME_SEC) {
-				for (n = PM_TIME_SEC; n < np->left->desc.units.scaleTime; n++)
-				    np->data.info->time_scale *= 60;
-			    }
-			    else {
-				for (n = np->left->desc.units.scaleTime; n < PM_TIME_SEC; n++)
-				    np->data.info->time_scale /= 1000;
-			    }
-			}
+			if (np->data.info->time_scale < 0)
+			    rate_time_scale(np);
 			np->data.info->ivlist[k].value.d *= np->data.info->time_scale;
 		    }
 		}
@@ -1391,84 +1758,93 @@ eval_expr(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
 	     * Extract instance-values from pmResult and store them in
 	     * ivlist[] as <int, pmAtomValue> pairs
 	     */
-	    for (j = 0; j < numpmid; j++) {
-		if (np->data.info->pmid == vset[j]->pmid) {
-		    free_ivlist(np);
-		    np->data.info->numval = vset[j]->numval;
-		    if (np->data.info->numval <= 0)
-			return np->data.info->numval;
-		    if ((np->data.info->ivlist = (val_t *)malloc(np->data.info->numval*sizeof(val_t))) == NULL) {
-			pmNoMem("eval_expr: metric ivlist", np->data.info->numval*sizeof(val_t), PM_FATAL_ERR);
-			/*NOTREACHED*/
-		    }
-		    for (i = 0; i < np->data.info->numval; i++) {
-			np->data.info->ivlist[i].inst = vset[j]->vlist[i].inst;
-			switch (np->desc.type) {
-			    case PM_TYPE_32:
-			    case PM_TYPE_U32:
-				np->data.info->ivlist[i].value.l = vset[j]->vlist[i].value.lval;
-				break;
-			    case PM_TYPE_64:
-			    case PM_TYPE_U64:
-				if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
-				    return PM_ERR_LOGREC;
-				memcpy((void *)&np->data.info->ivlist[i].value.ll, (void *)vset[j]->vlist[i].value.pval->vbuf, sizeof(__int64_t));
-				break;
-			    case PM_TYPE_FLOAT:
-				if (vset[j]->valfmt == PM_VAL_INSITU) {
-				    /* old style insitu float */
-				    np->data.info->ivlist[i].value.l = vset[j]->vlist[i].value.lval;
-				}
-				else if (vset[j]->valfmt == PM_VAL_DPTR || vset[j]->valfmt == PM_VAL_SPTR) {
-				    assert(vset[j]->vlist[i].value.pval->vtype == PM_TYPE_FLOAT);
-				    memcpy((void *)&np->data.info->ivlist[i].value.f, (void *)vset[j]->vlist[i].value.pval->vbuf, sizeof(float));
-				}
-				else
-				    return PM_ERR_LOGREC;
-				break;
-			    case PM_TYPE_DOUBLE:
-				if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
-				    return PM_ERR_LOGREC;
-				memcpy((void *)&np->data.info->ivlist[i].value.d, (void *)vset[j]->vlist[i].value.pval->vbuf, sizeof(double));
-				break;
-			    case PM_TYPE_STRING:
-				if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
-				    return PM_ERR_LOGREC;
-				need = vset[j]->vlist[i].value.pval->vlen-PM_VAL_HDR_SIZE;
-				if ((np->data.info->ivlist[i].value.cp = (char *)malloc(need)) == NULL) {
-				    pmNoMem("eval_expr: string value", vset[j]->vlist[i].value.pval->vlen, PM_FATAL_ERR);
-				    /*NOTREACHED*/
-				}
-				memcpy((void *)np->data.info->ivlist[i].value.cp, (void *)vset[j]->vlist[i].value.pval->vbuf, need);
-				np->data.info->ivlist[i].vlen = need;
-				break;
-			    case PM_TYPE_AGGREGATE:
-			    case PM_TYPE_AGGREGATE_STATIC:
-			    case PM_TYPE_EVENT:
-			    case PM_TYPE_HIGHRES_EVENT:
-				if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
-				    return PM_ERR_LOGREC;
-				if ((np->data.info->ivlist[i].value.vbp = (pmValueBlock *)malloc(vset[j]->vlist[i].value.pval->vlen)) == NULL) {
-				    pmNoMem("eval_expr: aggregate value", vset[j]->vlist[i].value.pval->vlen, PM_FATAL_ERR);
-				    /*NOTREACHED*/
-				}
-				memcpy(np->data.info->ivlist[i].value.vbp, (void *)vset[j]->vlist[i].value.pval, vset[j]->vlist[i].value.pval->vlen);
-				np->data.info->ivlist[i].vlen = vset[j]->vlist[i].value.pval->vlen;
-				break;
-			    default:
-				/*
-				 * really only PM_TYPE_NOSUPPORT should
-				 * end up here
-				 */
-				return PM_ERR_TYPE;
+	    if (IS_DERIVED(np->data.info->pmid))
+		return eval_ref(ctxp, np, stamp, numpmid, vset);
+	    /* the pmResult is usually laid out the same as last time */
+	    j = np->data.info->vsetidx;
+	    if (j >= numpmid || vset[j]->pmid != np->data.info->pmid) {
+		for (j = 0; j < numpmid; j++) {
+		    if (np->data.info->pmid == vset[j]->pmid)
+			break;
+		}
+		if (j == numpmid) {
+		    if (pmDebugOptions.derive)
+			fprintf(stderr, "eval_expr: botch: operand %s not in the extended pmResult\n", pmIDStr_r(np->data.info->pmid, strbuf, sizeof(strbuf)));
+		    return PM_ERR_PMID;
+		}
+		np->data.info->vsetidx = j;
+	    }
+	    free_ivlist(np);
+	    np->data.info->numval = vset[j]->numval;
+	    if (np->data.info->numval <= 0)
+		return np->data.info->numval;
+	    if ((np->data.info->ivlist = (val_t *)malloc(np->data.info->numval*sizeof(val_t))) == NULL) {
+		pmNoMem("eval_expr: metric ivlist", np->data.info->numval*sizeof(val_t), PM_FATAL_ERR);
+		/*NOTREACHED*/
+	    }
+	    for (i = 0; i < np->data.info->numval; i++) {
+		np->data.info->ivlist[i].inst = vset[j]->vlist[i].inst;
+		switch (np->desc.type) {
+		    case PM_TYPE_32:
+		    case PM_TYPE_U32:
+			np->data.info->ivlist[i].value.l = vset[j]->vlist[i].value.lval;
+			break;
+		    case PM_TYPE_64:
+		    case PM_TYPE_U64:
+			if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
+			    return PM_ERR_LOGREC;
+			memcpy((void *)&np->data.info->ivlist[i].value.ll, (void *)vset[j]->vlist[i].value.pval->vbuf, sizeof(__int64_t));
+			break;
+		    case PM_TYPE_FLOAT:
+			if (vset[j]->valfmt == PM_VAL_INSITU) {
+			    /* old style insitu float */
+			    np->data.info->ivlist[i].value.l = vset[j]->vlist[i].value.lval;
 			}
-		    }
-		    return np->data.info->numval;
+			else if (vset[j]->valfmt == PM_VAL_DPTR || vset[j]->valfmt == PM_VAL_SPTR) {
+			    assert(vset[j]->vlist[i].value.pval->vtype == PM_TYPE_FLOAT);
+			    memcpy((void *)&np->data.info->ivlist[i].value.f, (void *)vset[j]->vlist[i].value.pval->vbuf, sizeof(float));
+			}
+			else
+			    return PM_ERR_LOGREC;
+			break;
+		    case PM_TYPE_DOUBLE:
+			if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
+			    return PM_ERR_LOGREC;
+			memcpy((void *)&np->data.info->ivlist[i].value.d, (void *)vset[j]->vlist[i].value.pval->vbuf, sizeof(double));
+			break;
+		    case PM_TYPE_STRING:
+			if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
+			    return PM_ERR_LOGREC;
+			need = vset[j]->vlist[i].value.pval->vlen-PM_VAL_HDR_SIZE;
+			if ((np->data.info->ivlist[i].value.cp = (char *)malloc(need)) == NULL) {
+			    pmNoMem("eval_expr: string value", vset[j]->vlist[i].value.pval->vlen, PM_FATAL_ERR);
+			    /*NOTREACHED*/
+			}
+			memcpy((void *)np->data.info->ivlist[i].value.cp, (void *)vset[j]->vlist[i].value.pval->vbuf, need);
+			np->data.info->ivlist[i].vlen = need;
+			break;
+		    case PM_TYPE_AGGREGATE:
+		    case PM_TYPE_AGGREGATE_STATIC:
+		    case PM_TYPE_EVENT:
+		    case PM_TYPE_HIGHRES_EVENT:
+			if (vset[j]->valfmt != PM_VAL_DPTR && vset[j]->valfmt != PM_VAL_SPTR)
+			    return PM_ERR_LOGREC;
+			if ((np->data.info->ivlist[i].value.vbp = (pmValueBlock *)malloc(vset[j]->vlist[i].value.pval->vlen)) == NULL) {
+			    pmNoMem("eval_expr: aggregate value", vset[j]->vlist[i].value.pval->vlen, PM_FATAL_ERR);
+			    /*NOTREACHED*/
+			}
+			memcpy(np->data.info->ivlist[i].value.vbp, (void *)vset[j]->vlist[i].value.pval, vset[j]->vlist[i].value.pval->vlen);
+			np->data.info->ivlist[i].vlen = vset[j]->vlist[i].value.pval->vlen;
+			break;
+		    default:
+			/*
+			 * really only PM_TYPE_NOSUPPORT should
+			 * end up here
+			 */
+			return PM_ERR_TYPE;
 		}
 	    }
-	    if (pmDebugOptions.derive)
-		fprintf(stderr, "eval_expr: botch: operand %s not in the extended pmResult\n", pmIDStr_r(np->data.info->pmid, strbuf, sizeof(strbuf)));
-	    return PM_ERR_PMID;
+	    return np->data.info->numval;
 
 	case N_DEFINED:
 	    /* already setup from check_expr(), nothing to do ... */
@@ -1667,6 +2043,8 @@ eval_expr(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
 		pmNoMem("eval_expr: expr ivlist", np->data.info->numval*sizeof(val_t), PM_FATAL_ERR);
 		/*NOTREACHED*/
 	    }
+	    if (vector && bin_vec(np) == 0)
+		return np->data.info->numval;
 	    /*
 	     * ivlist[k] = left->ivlist[i] <op> right->ivlist[j]
 	     */
@@ -1783,6 +2161,375 @@ eval_expr(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
     /*NOTREACHED*/
 }
 
+/*
+ * Walk an expression tree, filling in operand values from the
+ * pmResult at the leaf nodes and propagating the computed values
+ * towards the root node of the tree.
+ *
+ * A shared node (see SHARE_NODE) is only evaluated once for each
+ * pmResult, later visits reuse the values already computed.
+ */
+static int
+eval_expr(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
+		pmValueSet **vset, int level)
+{
+    ctl_t	*cp = (ctl_t *)ctxp->c_dm;
+    int		sts;
+
+    assert(np != NULL);
+    if ((np->share & SHARE_NODE) && np->data.info->evalgen == cp->fetchgen)
+	return np->data.info->evalsts;
+    if (np->left != NULL) {
+	sts = eval_expr(ctxp, np->left, stamp, numpmid, vset, level+1);
+	if (sts < 0) {
+	    if (np->type == N_COUNT)
+		sts = count_error(np);
+	    return sts;
+	}
+    }
+    if (np->right != NULL) {
+	sts = eval_expr(ctxp, np->right, stamp, numpmid, vset, level+1);
+	if (sts < 0) return sts;
+    }
+    sts = eval_node(ctxp, np, stamp, numpmid, vset, 0);
+    if (np->share & SHARE_NODE) {
+	np->data.info->evalgen = cp->fetchgen;
+	np->data.info->evalsts = sts;
+    }
+    return sts;
+}
+
+/*
+ * Run a compiled expression, see __dmcompile() ... the same nodes in
+ * the same order as eval_expr(), but without the recursion.
+ */
+static int
+eval_prog(__pmContext *ctxp, dm_t *dmp, struct timespec *stamp, int numpmid,
+		pmValueSet **vset)
+{
+    ctl_t	*cp = (ctl_t *)ctxp->c_dm;
+    insn_t	*ip;
+    node_t	*np;
+    int		pc;
+    int		sts = 0;
+
+    if (dmp->ninsn == 0) {
+	/* constant expression, evaluated when compiled */
+	return dmp->expr->data.info->numval;
+    }
+    for (pc = 0; pc < dmp->ninsn; pc++) {
+	ip = &dmp->prog[pc];
+	np = ip->np;
+	if (ip->skip > 0) {
+	    /* start of a shared node's operands */
+	    if (np->data.info->evalgen != cp->fetchgen)
+		continue;
+	    /* already done, resume after the node */
+	    sts = np->data.info->evalsts;
+	    pc = ip->skip - 1;
+	}
+	else {
+	    sts = eval_node(ctxp, np, stamp, numpmid, vset, ip->vector);
+	    if (np->share & SHARE_NODE) {
+		np->data.info->evalgen = cp->fetchgen;
+		np->data.info->evalsts = sts;
+	    }
+	}
+	if (sts < 0) {
+	    if (ip->onerr < 0)
+		return sts;
+	    /* resume at the enclosing count() */
+	    pc = ip->onerr;
+	    sts = count_error(dmp->prog[pc].np);
+	}
+    }
+    return sts;
+}
+
+/*
+ * Evaluate one derived metric for the current pmResult.  This happens
+ * at most once per pmResult, no matter how many times the metric
+ * appears in the pmFetch list or as an operand of other derived
+ * metrics, so the history for delta() and rate() is only advanced
+ * once.
+ */
+static int
+eval_metric(__pmContext *ctxp, dm_t *dmp, struct timespec *stamp, int numpmid,
+		pmValueSet **vset)
+{
+    ctl_t	*cp = (ctl_t *)ctxp->c_dm;
+    info_t	*info = dmp->expr->data.info;
+
+    if (info->evalgen != cp->fetchgen) {
+	if (dmp->flags & DM_COMPILED)
+	    info->evalsts = eval_prog(ctxp, dmp, stamp, numpmid, vset);
+	else
+	    info->evalsts = eval_expr(ctxp, dmp->expr, stamp, numpmid, vset, 1);
+	info->evalgen = cp->fetchgen;
+    }
+    return info->evalsts;
+}
+
+/*
+ * A derived metric as an operand ... evaluate that metric (if not
+ * already done) and copy its values.
+ */
+static int
+eval_ref(__pmContext *ctxp, node_t *np, struct timespec *stamp, int numpmid,
+		pmValueSet **vset)
+{
+    ctl_t	*cp = (ctl_t *)ctxp->c_dm;
+    val_t	*src;
+    int		m;
+    int		i;
+    int		sts;
+
+    if ((m = __dmlookup(cp, np->data.info->pmid)) < 0 ||
+	cp->mlist[m].expr == NULL)
+	return PM_ERR_PMID;
+    if ((sts = eval_metric(ctxp, &cp->mlist[m], stamp, numpmid, vset)) < 0)
+	return sts;
+
+    free_ivlist(np);
+    np->data.info->numval = sts;
+    if (sts == 0)
+	return 0;
+    if ((np->data.info->ivlist = (val_t *)malloc(sts*sizeof(val_t))) == NULL) {
+	pmNoMem("eval_expr: derived operand ivlist", sts*sizeof(val_t), PM_FATAL_ERR);
+	/*NOTREACHED*/
+    }
+    src = cp->mlist[m].expr->data.info->ivlist;
+    memcpy(np->data.info->ivlist, src, sts*sizeof(val_t));
+    for (i = 0; i < sts; i++) {
+	switch (np->desc.type) {
+	    case PM_TYPE_STRING:
+		if ((np->data.info->ivlist[i].value.cp = (char *)malloc(src[i].vlen)) == NULL) {
+		    pmNoMem("eval_expr: derived operand string", src[i].vlen, PM_FATAL_ERR);
+		    /*NOTREACHED*/
+		}
+		memcpy(np->data.info->ivlist[i].value.cp, src[i].value.cp, src[i].vlen);
+		break;
+	    case PM_TYPE_AGGREGATE:
+	    case PM_TYPE_AGGREGATE_STATIC:
+	    case PM_TYPE_EVENT:
+	    case PM_TYPE_HIGHRES_EVENT:
+		if ((np->data.info->ivlist[i].value.vbp = (pmValueBlock *)malloc(src[i].vlen)) == NULL) {
+		    pmNoMem("eval_expr: derived operand aggregate", src[i].vlen, PM_FATAL_ERR);
+		    /*NOTREACHED*/
+		}
+		memcpy(np->data.info->ivlist[i].value.vbp, src[i].value.vbp, src[i].vlen);
+		break;
+	}
+    }
+    return sts;
+}
+
+/*
+ * Compiling an expression ...
+ * Constant subexpressions are evaluated once, here, and the remaining
+ * nodes are flattened into prog[] in the order that eval_expr() would
+ * compute them (operands first).  Each instruction records where to
+ * resume if that node fails, which is the enclosing count() when the
+ * node is part of count()'s operand, else nowhere.
+ */
+static int
+is_const(node_t *np)
+{
+    switch (np->type) {
+	case N_INTEGER:
+	case N_DOUBLE:
+	    return 1;
+	case N_NEG:
+	case N_NOT:
+	    return is_const(np->left);
+	case N_PLUS:
+	case N_MINUS:
+	case N_STAR:
+	case N_SLASH:
+	case N_LT:
+	case N_LEQ:
+	case N_EQ:
+	case N_GEQ:
+	case N_GT:
+	case N_NEQ:
+	case N_AND:
+	case N_OR:
+	    return is_const(np->left) && is_const(np->right);
+    }
+    return 0;
+}
+
+static int
+is_numeric(int type)
+{
+    return type >= PM_TYPE_32 && type <= PM_TYPE_DOUBLE;
+}
+
+static int
+emit(dm_t *dmp, node_t *np, node_t *handler, node_t ***handlers)
+{
+    insn_t		*ip;
+
+    if ((ip = (insn_t *)realloc(dmp->prog, (dmp->ninsn+1)*sizeof(insn_t))) == NULL ||
+	(*handlers = (node_t **)realloc(*handlers, (dmp->ninsn+1)*sizeof(node_t *))) == NULL) {
+	pmNoMem("__dmcompile: prog", (dmp->ninsn+1)*sizeof(insn_t), PM_FATAL_ERR);
+	/*NOTREACHED*/
+    }
+    dmp->prog = ip;
+    ip = &dmp->prog[dmp->ninsn];
+    ip->np = np;
+    ip->onerr = -1;
+    ip->vector = 0;
+    ip->skip = 0;
+    (*handlers)[dmp->ninsn] = handler;
+    return dmp->ninsn++;
+}
+
+static void
+compile(__pmContext *ctxp, dm_t *dmp, node_t *np, node_t *handler, node_t ***handlers)
+{
+    struct timespec	zero = { 0, 0 };
+    insn_t		*ip;
+    int			mark = -1;
+    int			pc;
+    int			sts;
+
+    if (is_const(np) && !np->save_last) {
+	if ((sts = eval_expr(ctxp, np, &zero, 0, NULL, 0)) >= 0)
+	    return;
+	/* should not happen, leave it to be evaluated every time */
+	if (pmDebugOptions.derive) {
+	    char	errmsg[PM_MAXERRMSGLEN];
+	    fprintf(stderr, "__dmcompile: %s: constant %s: %s\n", dmp->name,
+		__dmnode_type_str(np->type), pmErrStr_r(sts, errmsg, sizeof(errmsg)));
+	}
+    }
+
+    if (np->share & SHARE_NODE) {
+	/*
+	 * shared node, if it has already been evaluated for this
+	 * pmResult skip it and its operands, see eval_prog()
+	 */
+	mark = emit(dmp, np, handler, handlers);
+    }
+
+    if (np->left != NULL)
+	compile(ctxp, dmp, np->left, np->type == N_COUNT ? np : handler, handlers);
+    if (np->right != NULL)
+	compile(ctxp, dmp, np->right, handler, handlers);
+
+    switch (np->type) {
+	case N_COLON:
+	case N_PATTERN:
+	case N_SCALE:
+	    /* no values, nothing to be done at fetch time */
+	    return;
+	case N_RATE:
+	    if (np->left->desc.units.dimTime == 1 && np->data.info->time_scale < 0)
+		rate_time_scale(np);
+	    break;
+    }
+
+    pc = emit(dmp, np, handler, handlers);
+    ip = &dmp->prog[pc];
+    if (np->left != NULL && np->right != NULL &&
+	((np->type >= N_PLUS && np->type <= N_SLASH) ||
+	 (np->type >= N_LT && np->type <= N_OR)) &&
+	is_numeric(np->left->desc.type) && is_numeric(np->right->desc.type) &&
+	is_numeric(np->desc.type))
+	ip->vector = 1;
+    if (mark >= 0)
+	dmp->prog[mark].skip = dmp->ninsn;
+}
+
+/*
+ * Compile a bound derived metric expression into dmp->prog[], which
+ * is then used by __dmpostfetch() in place of the tree walk.
+ */
+void
+__dmcompile(__pmContext *ctxp, dm_t *dmp)
+{
+    node_t	**handlers = NULL;
+    int		i;
+    int		j;
+
+    __dmfreeprog(dmp);
+    if (dmp->expr == NULL)
+	return;
+    compile(ctxp, dmp, dmp->expr, NULL, &handlers);
+    for (i = 0; i < dmp->ninsn; i++) {
+	if (handlers[i] == NULL)
+	    continue;
+	/* count() follows its operand */
+	for (j = i+1; j < dmp->ninsn; j++) {
+	    if (dmp->prog[j].np == handlers[i] && dmp->prog[j].skip == 0) {
+		dmp->prog[i].onerr = j;
+		break;
+	    }
+	}
+    }
+    free(handlers);
+    dmp->flags |= DM_COMPILED;
+
+    if (pmDebugOptions.derive && pmDebugOptions.appl1) {
+	fprintf(stderr, "__dmcompile: %s: %d instructions\n", dmp->name, dmp->ninsn);
+	for (i = 0; i < dmp->ninsn; i++) {
+	    fprintf(stderr, "[%d] %s node " PRINTF_P_PFX "%p", i,
+		__dmnode_type_str(dmp->prog[i].np->type), dmp->prog[i].np);
+	    if (dmp->prog[i].skip > 0)
+		fprintf(stderr, " shared skip=%d", dmp->prog[i].skip);
+	    if (dmp->prog[i].vector)
+		fprintf(stderr, " vector");
+	    if (dmp->prog[i].onerr >= 0)
+		fprintf(stderr, " onerr=%d", dmp->prog[i].onerr);
+	    fputc('\n', stderr);
+	}
+    }
+}
+
+void
+__dmfreeprog(dm_t *dmp)
+{
+    if (dmp->prog != NULL)
+	free(dmp->prog);
+    dmp->prog = NULL;
+    dmp->ninsn = 0;
+    dmp->flags &= ~DM_COMPILED;
+}
+
+/*
+ * Release the per-context fetch state hanging off a ctl_t, see
+ * __dmlookup(), __dmprefetch() and share_expr().
+ */
+static __pmHashWalkState
+free_share_callback(const __pmHashNode *tp, void *cp)
+{
+    (void)cp;
+    free(tp->data);
+    return PM_HASH_WALK_DELETE_NEXT;
+}
+
+static __pmHashWalkState
+free_pmid_callback(const __pmHashNode *tp, void *cp)
+{
+    (void)tp;
+    (void)cp;
+    return PM_HASH_WALK_DELETE_NEXT;
+}
+
+void
+__dmfreectl(ctl_t *cp)
+{
+    __pmHashWalkCB(free_share_callback, NULL, &cp->nodehash);
+    __pmHashClear(&cp->nodehash);
+    __pmHashWalkCB(free_pmid_callback, NULL, &cp->pmidhash);
+    __pmHashClear(&cp->pmidhash);
+    cp->nhashed = 0;
+    free(cp->pf_pmidlist);
+    free(cp->pf_newlist);
+    cp->pf_pmidlist = cp->pf_newlist = NULL;
+}
+
 /*
  * Algorithm here is complicated by trying to re-write the pmValueSets
  * in a result structure (either pmResult or pmHighResResult).
@@ -1827,6 +2574,10 @@ __dmpostvalueset(__pmContext *ctxp, struct timespec *stamp, int vnumpmid,
     int		rewrite;
     ctl_t	*cp = (ctl_t *)ctxp->c_dm;
 
+    /* new values, nothing has been evaluated yet, see eval_metric() */
+    if (++cp->fetchgen == 0)
+	cp->fetchgen = 1;
+
     for (j = 0; j < numpmid; j++) {
 	numval = vset[j]->numval;
 	valfmt = vset[j]->valfmt;
@@ -1836,63 +2587,59 @@ __dmpostvalueset(__pmContext *ctxp, struct timespec *stamp, int vnumpmid,
 	 * which case m is well-defined
 	 */
 	m = 0;
-	if (IS_DERIVED(vset[j]->pmid)) {
-	    for (m = 0; m < cp->nmetric; m++) {
-		if (vset[j]->pmid == cp->mlist[m].pmid) {
-		    if (cp->mlist[m].expr == NULL) {
-			numval = PM_ERR_PMID;
-		    }
-		    else {
-			rewrite = 1;
-			if (cp->mlist[m].expr->desc.type == PM_TYPE_32 ||
-			    cp->mlist[m].expr->desc.type == PM_TYPE_U32)
-			    valfmt = PM_VAL_INSITU;
+	if (IS_DERIVED(vset[j]->pmid) &&
+	    (m = __dmlookup(cp, vset[j]->pmid)) >= 0) {
+	    if (cp->mlist[m].expr == NULL) {
+		numval = PM_ERR_PMID;
+	    }
+	    else {
+		rewrite = 1;
+		if (cp->mlist[m].expr->desc.type == PM_TYPE_32 ||
+		    cp->mlist[m].expr->desc.type == PM_TYPE_U32)
+		    valfmt = PM_VAL_INSITU;
+		else
+		    valfmt = PM_VAL_DPTR;
+
+		numval = eval_metric(ctxp, &cp->mlist[m],
+					stamp, vnumpmid, vset);
+		if (numval == PM_ERR_PMID)
+		    fails++;
+
+		if (pmDebugOptions.derive && pmDebugOptions.appl2) {
+		    int		k, type = cp->mlist[m].expr->desc.type;
+		    info_t	*info = cp->mlist[m].expr->data.info;
+		    char	strbuf[20];
+
+		    pmIDStr_r(vset[j]->pmid, strbuf, sizeof(strbuf));
+		    fprintf(stderr, "%s: [%d] root node %s: numval=%d",
+				    "__dmpostvalueset", j, strbuf, numval);
+		    for (k = 0; k < numval; k++) {
+			pmAtomValue value = info->ivlist[k].value;
+
+			fprintf(stderr, " vset[%d]: inst=%d", k,
+					info->ivlist[k].inst);
+			if (type == PM_TYPE_32)
+			    fprintf(stderr, " l=%d", value.l);
+			else if (type == PM_TYPE_U32)
+			    fprintf(stderr, " u=%u", value.ul);
+			else if (type == PM_TYPE_64)
+			    fprintf(stderr, " ll=%"PRIi64, value.ll);
+			else if (type == PM_TYPE_U64)
+			    fprintf(stderr, " ul=%"PRIu64, value.ull);
+			else if (type == PM_TYPE_FLOAT)
+			    fprintf(stderr, " f=%f", (double)value.f);
+			else if (type == PM_TYPE_DOUBLE)
+			    fprintf(stderr, " d=%f", value.d);
+			else if (type == PM_TYPE_STRING)
+			    fprintf(stderr, " cp=%s (len=%d)", value.cp,
+					info->ivlist[k].vlen);
 			else
-			    valfmt = PM_VAL_DPTR;
-
-			numval = eval_expr(ctxp, cp->mlist[m].expr,
-						stamp, vnumpmid, vset, 1);
-			if (numval == PM_ERR_PMID)
-			    fails++;
-
-			if (pmDebugOptions.derive && pmDebugOptions.appl2) {
-			    int		k, type = cp->mlist[m].expr->desc.type;
-			    info_t	*info = cp->mlist[m].expr->data.info;
-			    char	strbuf[20];
-	
-			    pmIDStr_r(vset[j]->pmid, strbuf, sizeof(strbuf));
-			    fprintf(stderr, "%s: [%d] root node %s: numval=%d",
-					    "__dmpostvalueset", j, strbuf, numval);
-			    for (k = 0; k < numval; k++) {
-				pmAtomValue value = info->ivlist[k].value;
-
-				fprintf(stderr, " vset[%d]: inst=%d", k,
-						info->ivlist[k].inst);
-				if (type == PM_TYPE_32)
-				    fprintf(stderr, " l=%d", value.l);
-				else if (type == PM_TYPE_U32)
-				    fprintf(stderr, " u=%u", value.ul);
-				else if (type == PM_TYPE_64)
-				    fprintf(stderr, " ll=%"PRIi64, value.ll);
-				else if (type == PM_TYPE_U64)
-				    fprintf(stderr, " ul=%"PRIu64, value.ull);
-				else if (type == PM_TYPE_FLOAT)
-				    fprintf(stderr, " f=%f", (double)value.f);
-				else if (type == PM_TYPE_DOUBLE)
-				    fprintf(stderr, " d=%f", value.d);
-				else if (type == PM_TYPE_STRING)
-				    fprintf(stderr, " cp=%s (len=%d)", value.cp,
-						info->ivlist[k].vlen);
-				else
-				    fprintf(stderr, " vbp="PRINTF_P_PFX"%p (len=%d)",
-						value.vbp, info->ivlist[k].vlen);
-			    }
-			    fputc('\n', stderr);
-			    if (info != NULL)
-				__dmdumpexpr(cp->mlist[m].expr, 1);
-			}
+			    fprintf(stderr, " vbp="PRINTF_P_PFX"%p (len=%d)",
+					value.vbp, info->ivlist[k].vlen);
 		    }
-		    break;
+		    fputc('\n', stderr);
+		    if (info != NULL)
+			__dmdumpexpr(cp->mlist[m].expr, 1);
 		}
 	    }
 	}
@@ -226,9 +226,11 @@ __pmLogLoadIndex(__pmLogCtl *lcp)
     size_t	bytes;
     void	*buffer;
     __pmLogTI	*tip;
+    int		maxti = 0;
 
     lcp->numti = 0;
     lcp->ti = NULL;
+    lcp->tisorted = 1;
 
     if (__pmLogVersion(lcp) == PM_LOG_VERS03)
 	record_size = sizeof(__pmTI_v3);
@@ -246,14 +248,18 @@ __pmLogLoadIndex(__pmLogCtl *lcp)
 	__pmFseek(f, (long)__pmLogLabelSize(lcp), SEEK_SET);
 	for ( ; ; ) {
 	    __pmLogTI	*tmp;
-	    bytes = (1 + lcp->numti) * sizeof(__pmLogTI);
-	    tmp = (__pmLogTI *)realloc(lcp->ti, bytes);
-	    if (tmp == NULL) {
-		pmNoMem("__pmLogLoadIndex: realloc TI", bytes, PM_FATAL_ERR);
-		sts = -oserror();
-		goto bad;
+	    if (lcp->numti == maxti) {
+		/* dense indexes may have very many entries, grow geometrically */
+		maxti = maxti ? 2 * maxti : 64;
+		bytes = maxti * sizeof(__pmLogTI);
+		tmp = (__pmLogTI *)realloc(lcp->ti, bytes);
+		if (tmp == NULL) {
+		    pmNoMem("__pmLogLoadIndex: realloc TI", bytes, PM_FATAL_ERR);
+		    sts = -oserror();
+		    goto bad;
+		}
+		lcp->ti = tmp;
 	    }
-	    lcp->ti = tmp;
 	    bytes = __pmFread(buffer, 1, record_size, f);
 	    if (bytes != record_size) {
 		if (__pmFeof(f)) {
@@ -296,6 +302,15 @@ __pmLogLoadIndex(__pmLogCtl *lcp)
 		tip->off_data = ntohl(tip_v2->off_data);
 	    }
 
+	    if (lcp->numti > 0 && lcp->tisorted &&
+		(__pmTimestampSub(&tip->stamp, &tip[-1].stamp) < 0 ||
+		 tip->vol < tip[-1].vol)) {
+		if (pmDebugOptions.log)
+		    fprintf(stderr, "%s: TI entry %d out of order, "
+				    "no binary search\n",
+				    "__pmLogLoadIndex", lcp->numti);
+		lcp->tisorted = 0;
+	    }
 	    lcp->numti++;
 	}
     }
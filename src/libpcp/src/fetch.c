@@ -23,11 +23,12 @@ __pmUpdateProfile(int fd, __pmContext *ctxp, int timeout)
 {
     int		sts;
 
-    if (ctxp->c_sent == 0) {
+    if (ctxp->c_sent == 0 || ctxp->c_sentgen != ctxp->c_pmcd->pc_gen) {
 
 	/*
 	 * current profile is _not_ already cached at other end of
-	 * IPC, so send the current profile
+	 * IPC (or the connection, possibly shared with other contexts,
+	 * has been re-established since), so send the current profile
 	 */
 	if (pmDebugOptions.profile) {
 	    fprintf(stderr, "pmFetch: calling __pmSendProfile, context: %d slot: %d\n",
@@ -37,8 +38,10 @@ __pmUpdateProfile(int fd, __pmContext *ctxp, int timeout)
 	if ((sts = __pmSendProfile(fd, __pmPtrToHandle(ctxp),
 				   ctxp->c_slot, ctxp->c_instprof)) < 0)
 	    return sts;
-	else
+	else {
 	    ctxp->c_sent = 1;
+	    ctxp->c_sentgen = ctxp->c_pmcd->pc_gen;
+	}
     }
     return 0;
 }
@@ -197,6 +200,7 @@ pmFetch_ctx(__pmContext *ctxp, int numpmid, pmID *pmidlist, pmResult **result)
 	}
 
 	if (ctxp->c_type == PM_CONTEXT_HOST) {
+	    PM_LOCK(ctxp->c_pmcd->pc_lock);
 	    tout = ctxp->c_pmcd->pc_tout_sec;
 	    fd = ctxp->c_pmcd->pc_fd;
 	    if ((sts = __pmUpdateProfile(fd, ctxp, tout)) < 0) {
@@ -211,6 +215,9 @@ pmFetch_ctx(__pmContext *ctxp, int numpmid, pmID *pmidlist, pmResult **result)
 		    sts = __pmRecvFetch(fd, ctxp, tout, result);
 		}
 	    }
+	    if (sts < 0)
+		__pmSharedPMCDError(ctxp, sts);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	}
 	else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	    sts = __pmFetchLocal(ctxp, numpmid, pmidlist, result);
@@ -341,6 +348,7 @@ pmHighResFetch_ctx(__pmContext *ctxp, int numpmid, pmID *pmidlist, pmHighResResu
 	}
 
 	if (ctxp->c_type == PM_CONTEXT_HOST) {
+	    PM_LOCK(ctxp->c_pmcd->pc_lock);
 	    tout = ctxp->c_pmcd->pc_tout_sec;
 	    fd = ctxp->c_pmcd->pc_fd;
 	    if (!(__pmFeaturesIPC(fd) & PDU_FLAG_HIGHRES))
@@ -354,6 +362,9 @@ pmHighResFetch_ctx(__pmContext *ctxp, int numpmid, pmID *pmidlist, pmHighResResu
 		PM_FAULT_POINT("libpcp/" __FILE__ ":2", PM_FAULT_TIMEOUT);
 		sts = __pmRecvHighResFetch(fd, ctxp, tout, result);
 	    }
+	    if (sts < 0)
+		__pmSharedPMCDError(ctxp, sts);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	}
 	else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	    sts = __pmHighResFetchLocal(ctxp, numpmid, pmidlist, result);
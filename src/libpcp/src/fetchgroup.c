@@ -31,6 +31,9 @@
 #define ULLONG_MAX ULONGLONG_MAX
 #endif
 
+/* default cap on concurrent fetches for pmFetchGroups() */
+#define PMFG_MAXTHREADS	64
+
 /* ------------------------------------------------------------------------ */
 
 /*
@@ -88,6 +91,8 @@ struct __pmFetchGroupItem {
 	    int *output_inst_codes;	/* NB: may be NULL */
 	    char **output_inst_names;	/* NB: may be NULL */
 	    pmAtomValue *output_values;	/* NB: may be NULL */
+	    double *output_doubles;	/* NB: may be NULL, set only for pmfg_indom
+					   items from pmExtendFetchGroup_vector */
 	    int output_type;
 	    int *output_stss;	/* NB: may be NULL */
 	    int *output_sts;	/* NB: may be NULL */
@@ -579,6 +584,10 @@ pmfg_reinit_indom(pmFGI item)
 	for (i = 0; i < item->u.indom.output_maxnum; i++)
 	    __pmReinitValue(&item->u.indom.output_values[i], item->u.indom.output_type);
 
+    if (item->u.indom.output_doubles)
+	for (i = 0; i < item->u.indom.output_maxnum; i++)
+	    item->u.indom.output_doubles[i] = (double)0.0 / (double)0.0; /* nan(""); */
+
     if (item->u.indom.output_inst_names)
 	for (i = 0; i < item->u.indom.output_maxnum; i++)
 	    item->u.indom.output_inst_names[i] = NULL;	/* break ref into indom_names[] */
@@ -706,6 +715,64 @@ pmfg_unwrap_counter(pmFG pmfg, int type, double *value)
     return PM_ERR_VALUE;
 }
 
+/*
+ * Interval from the previous result to timestamp, for rate conversion.
+ */
+static double
+pmfg_rate_interval(pmFG pmfg, const struct timespec *timestamp)
+{
+    struct timespec prev_t;
+    double deltaT;
+    const double epsilon = 0.000000001;	/* 1 nanosecond */
+
+    assert(pmfg->prevResult != NULL);
+
+    pmfg_timespec_from_timeval(&pmfg->prevResult->timestamp, &prev_t);
+    deltaT = pmfg_timespec_delta(timestamp, &prev_t);
+
+    if (deltaT < epsilon)	/* avoid division by zero */
+	deltaT = epsilon;	/* (chose not to PM_ERR_CONV here) */
+    return deltaT;
+}
+
+/*
+ * Rate-convert (given the previous value and interval) and/or scale
+ * the extracted double value.
+ */
+static int
+pmfg_convert_value(pmFG pmfg, const pmDesc *desc, const pmFGC conv,
+		   double v, double prev_v, double deltaT, double *value)
+{
+    double delta;
+    int sts = 0;
+
+    if (conv->rate_convert) {
+	delta = v - prev_v;
+	if (delta < 0.0)
+	    sts = pmfg_unwrap_counter(pmfg, desc->type, &delta);
+	/*
+	 * NB: the units of this delta value are: "metric_units / second",
+	 * something we don't represent formally with another pmUnits
+	 * struct.
+	 * If the requested output format was a "metric_units / hour" or
+	 * other, the pmfg_prep_conversion code will adjust the scalar
+	 * multiplier to map from /second to /hour etc.
+	 */
+	if (sts == 0) {
+	    delta /= deltaT;
+	    sts = pmfg_convert_double(desc, conv, &delta);
+	}
+	if (sts == 0)
+	    *value = delta;
+    }
+    else {			/* no rate conversion */
+	sts = pmfg_convert_double(desc, conv, &v);
+	if (sts == 0)
+	    *value = v;
+    }
+    return sts;
+}
+
 static int
 pmfg_extract_convert_item(pmFG pmfg, pmID metric_pmid, int metric_inst,
 			  int first_vset, const pmDesc *desc, const pmFGC conv,
@@ -713,8 +780,8 @@ pmfg_extract_convert_item(pmFG pmfg, pmID metric_pmid, int metric_inst,
 			  const struct timespec *timestamp,
 			  pmAtomValue *oval, int otype)
 {
-    pmAtomValue v;
-    double value;
+    pmAtomValue v, prev_v;
+    double value, deltaT = 1.0;
     int sts;
 
     assert(oval != NULL);
@@ -724,58 +791,23 @@ pmfg_extract_convert_item(pmFG pmfg, pmID metric_pmid, int metric_inst,
     if (sts)
 	return sts;
 
+    prev_v.d = 0.0;
     if (conv->rate_convert) {
-	if (pmfg->prevResult) {
-	    pmResult *prev_r;
-	    pmAtomValue prev_v;
-	    struct timespec prev_t;
-	    double deltaT, delta;
-	    const double epsilon = 0.000000001;	/* 1 nanosecond */
-
-	    prev_r = pmfg->prevResult;
-	    pmfg_timespec_from_timeval(&prev_r->timestamp, &prev_t);
-	    deltaT = pmfg_timespec_delta(timestamp, &prev_t);
-
-	    if (deltaT < epsilon)	/* avoid division by zero */
-		deltaT = epsilon;	/* (chose not to PM_ERR_CONV here) */
-
-	    sts = pmfg_extract_item(metric_pmid, metric_inst, first_vset,
-				    desc, prev_r->vset, prev_r->numpmid,
-				    &prev_v, PM_TYPE_DOUBLE);
-	    if (sts)
-		return sts;
-
-	    delta = v.d - prev_v.d;
-	    if (delta < 0.0)
-		sts = pmfg_unwrap_counter(pmfg, desc->type, &delta);
-	    /*
-	     * NB: the units of this delta value are: "metric_units / second",
-	     * something we don't represent formally with another pmUnits
-	     * struct.
-	     * If the requested output format was a "metric_units / hour" or
-	     * other, the pmfg_prep_conversion code will adjust the scalar
-	     * multiplier to map from /second to /hour etc.
-	     */
-	    if (sts == 0) {
-		delta /= deltaT;
-		sts = pmfg_convert_double(desc, conv, &delta);
-	    }
-	    if (sts)
-		return sts;
-
-	    value = delta;
-	}
-	else {			/* no previous result */
+	if (pmfg->prevResult == NULL)	/* no previous result */
 	    return PM_ERR_AGAIN;
-	}
-    }
-    else {			/* no rate conversion */
-	sts = pmfg_convert_double(desc, conv, &v.d);
+	sts = pmfg_extract_item(metric_pmid, metric_inst, first_vset,
+				desc, pmfg->prevResult->vset,
+				pmfg->prevResult->numpmid,
+				&prev_v, PM_TYPE_DOUBLE);
 	if (sts)
 	    return sts;
-	value = v.d;
+	deltaT = pmfg_rate_interval(pmfg, timestamp);
     }
 
+    sts = pmfg_convert_value(pmfg, desc, conv, v.d, prev_v.d, deltaT, &value);
+    if (sts)
+	return sts;
+
     /*
      * Convert the double temporary value into the gen oval/otype.
      * This is similar to __pmStuffValue, except that the destination
@@ -854,18 +886,103 @@ pmfg_fetch_timestamp(pmFG pmfg, pmFGI item, pmResult *newResult)
 	*item->u.timestamp.output_value = newResult->timestamp;
 }
 
+static int
+pmfg_compare_inst(const void *a, const void *b)
+{
+    const int *ap = (const int *)a;
+    const int *bp = (const int *)b;
+
+    return (*ap > *bp) - (*ap < *bp);
+}
+
+/*
+ * Sort the instance codes and names cached from pmGetInDom, so that
+ * pmfg_find_inst can binary search them.  On failure, drop the cache
+ * - instance names are then not supplied, as if pmGetInDom had failed.
+ */
+static void
+pmfg_sort_indom(pmFGI item)
+{
+    struct { int code; char *name; } *pairs;
+    unsigned k, n = item->u.indom.indom_size;
+
+    if (n < 2)
+	return;
+    if ((pairs = malloc(n * sizeof(*pairs))) == NULL) {
+	free(item->u.indom.indom_codes);
+	free(item->u.indom.indom_names);
+	item->u.indom.indom_codes = NULL;
+	item->u.indom.indom_names = NULL;
+	item->u.indom.indom_size = 0;
+	return;
+    }
+    for (k = 0; k < n; k++) {
+	pairs[k].code = item->u.indom.indom_codes[k];
+	pairs[k].name = item->u.indom.indom_names[k];
+    }
+    qsort(pairs, n, sizeof(*pairs), pmfg_compare_inst);
+    for (k = 0; k < n; k++) {
+	item->u.indom.indom_codes[k] = pairs[k].code;
+	item->u.indom.indom_names[k] = pairs[k].name;
+    }
+    free(pairs);
+}
+
+/* Index of inst in the sorted cache of instances, else -1. */
+static int
+pmfg_find_inst(pmFGI item, int inst)
+{
+    const int *codes = item->u.indom.indom_codes;
+    unsigned lo = 0, hi = item->u.indom.indom_size;
+
+    while (lo < hi) {
+	unsigned mid = lo + (hi - lo) / 2;
+
+	if (codes[mid] == inst)
+	    return mid;
+	if (codes[mid] < inst)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return -1;
+}
+
+/*
+ * Index of inst in the previous pmValueSet, else -1.  Try the given
+ * position first, then fall back to a full search - PCP does not
+ * guarantee any order of instances within a pmValueSet.
+ */
+static int
+pmfg_find_prev(const pmValueSet *pv, int inst, int hint)
+{
+    int k;
+
+    if (hint < pv->numval && pv->vlist[hint].inst == inst)
+	return hint;
+    for (k = 0; k < pv->numval; k++)
+	if (pv->vlist[k].inst == inst)
+	    return k;
+    return -1;
+}
+
 static void
 pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
 {
     int sts = 0;
-    int i;
+    int i, k;
     unsigned j;
     int need_indom_refresh;
+    int convert, prev_sts = 0;
+    double deltaT = 1.0;
     const pmValueSet *iv;
+    const pmValueSet *pv = NULL;
+    const pmDesc *desc;
 
     assert(item != NULL);
     assert(item->type == pmfg_indom);
     assert(newResult != NULL);
+    desc = &item->u.indom.metric_desc;
 
     /*
      * Find our pmid in the newResult.	If rate-converting, we'll need to
@@ -892,7 +1009,7 @@ pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
      * If we have some values, the DISCRETE preserved values should be
      * cleared now.
      */
-    if (item->u.indom.metric_desc.sem == PM_SEM_DISCRETE) {
+    if (desc->sem == PM_SEM_DISCRETE) {
 	if (iv->numval > 0)
 	    pmfg_reinit_indom(item);
 	else /* = 0 */
@@ -901,18 +1018,12 @@ pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
 
     /*
      * Analyze newResult to see whether it only contains instances we
-     * already know.  This is unfortunately an O(N**2) operation.  It
-     * could be made a bit faster if we build a pmGetInDom()- variant
-     * that provides instances in sorted order.
+     * already know, from the (sorted) pmGetInDom cache.
      */
     need_indom_refresh = 0;
     if (item->u.indom.output_inst_names) {	/* Caller interested at all? */
 	for (j = 0; j < (unsigned)iv->numval; j++) {
-	    unsigned k;
-	    for (k = 0; k < item->u.indom.indom_size; k++)
-		if (item->u.indom.indom_codes[k] == iv->vlist[j].inst)
-		    break;
-	    if (k >= item->u.indom.indom_size) {
+	    if (pmfg_find_inst(item, iv->vlist[j].inst) < 0) {
 		need_indom_refresh = 1;
 		break;
 	    }
@@ -921,7 +1032,7 @@ pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
     if (need_indom_refresh) {
 	free(item->u.indom.indom_codes);
 	free(item->u.indom.indom_names);
-	sts = pmGetInDom(item->u.indom.metric_desc.indom,
+	sts = pmGetInDom(desc->indom,
 			&item->u.indom.indom_codes, &item->u.indom.indom_names);
 	if (sts < 1) {
 	    /* Need to manually clear; pmGetInDom claims they are undefined. */
@@ -931,6 +1042,7 @@ pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
 	}
 	else {
 	    item->u.indom.indom_size = sts;
+	    pmfg_sort_indom(item);
 	}
 	/*
 	 * NB: Even if the pmGetInDom failed, we can proceed with
@@ -940,15 +1052,47 @@ pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
 	sts = 0;
     }
 
+    /*
+     * For rate conversion, find our pmid in the previous pmResult once.
+     * Instances are not necessarily sorted, but usually come in the same
+     * order as last time, so each instance's previous value is looked
+     * for just after the last one matched - see pmfg_find_prev.
+     */
+    convert = item->u.indom.conv.rate_convert || item->u.indom.conv.unit_convert;
+    if (item->u.indom.conv.rate_convert) {
+	pmResult *prev_r = pmfg->prevResult;
+
+	if (prev_r == NULL) {
+	    prev_sts = PM_ERR_AGAIN;
+	}
+	else {
+	    struct timespec timestamp;
+
+	    for (k = 0; k < prev_r->numpmid; k++) {
+		if (prev_r->vset[k]->pmid == item->u.indom.metric_pmid)
+		    break;
+	    }
+	    if (k >= prev_r->numpmid)
+		prev_sts = PM_ERR_VALUE;
+	    else if (prev_r->vset[k]->numval < 0)
+		prev_sts = prev_r->vset[k]->numval;
+	    else
+		pv = prev_r->vset[k];
+	    pmfg_timespec_from_timeval(&newResult->timestamp, &timestamp);
+	    deltaT = pmfg_rate_interval(pmfg, &timestamp);
+	}
+    }
+
     /*
      * Process each instance element in the pmValueSet.	 We persevere
      * in the face of per-item errors (including conversion errors),
      * since we signal individual errors, except once we run out of
      * output space.
      */
-    for (j = 0; j < (unsigned)iv->numval; j++) {
+    for (j = 0, k = 0; j < (unsigned)iv->numval; j++) {
 	const pmValue *jv = &iv->vlist[j];
-	pmAtomValue v;
+	pmAtomValue v, prev_v;
+	double value;
 	int stss = 0;
 
 	if (j >= item->u.indom.output_maxnum) {	/* too many instances! */
@@ -965,41 +1109,49 @@ pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
 	 * results from pmGetIndom.
 	 */
 	if (item->u.indom.output_inst_names) {
-	    unsigned k;
-
-	    for (k = 0; k < item->u.indom.indom_size; k++) {
-		if (item->u.indom.indom_codes[k] == jv->inst) {
-		    /*
-		     * NB: copy the indom name char* by value.
-		     * The user is not supposed to modify / free this pointer,
-		     * or use it after a subsequent fetch or delete operation.
-		     */
-		    item->u.indom.output_inst_names[j] =
-				item->u.indom.indom_names[k];
-		    break;
-		}
-	    }
+	    int n = pmfg_find_inst(item, jv->inst);
+
+	    /*
+	     * NB: copy the indom name char* by value.
+	     * The user is not supposed to modify / free this pointer,
+	     * or use it after a subsequent fetch or delete operation.
+	     */
+	    if (n >= 0)
+		item->u.indom.output_inst_names[j] =
+				item->u.indom.indom_names[n];
 	}
 
 	/* Fetch & convert the actual value. */
-	if (item->u.indom.conv.rate_convert ||
-	    item->u.indom.conv.unit_convert) {
-	    struct timespec timestamp;
-
-	    pmfg_timespec_from_timeval(&newResult->timestamp, &timestamp);
-	    stss = pmfg_extract_convert_item(pmfg, item->u.indom.metric_pmid,
-				jv->inst, 0, &item->u.indom.metric_desc,
-				&item->u.indom.conv,
-				newResult->vset, newResult->numpmid, &timestamp,
-				&v, item->u.indom.output_type);
+	if (convert) {
+	    stss = __pmExtractValue2(iv->valfmt, jv, desc->type,
+				&v, PM_TYPE_DOUBLE);
+	    if (stss < 0)
+		goto out1;
+	    prev_v.d = 0.0;
+	    if (item->u.indom.conv.rate_convert) {
+		if ((stss = prev_sts) < 0)
+		    goto out1;
+		if ((i = pmfg_find_prev(pv, jv->inst, k)) < 0) {
+		    stss = PM_ERR_VALUE;
+		    goto out1;
+		}
+		k = i + 1;
+		stss = __pmExtractValue2(pv->valfmt, &pv->vlist[i], desc->type,
+				&prev_v, PM_TYPE_DOUBLE);
+		if (stss < 0)
+		    goto out1;
+	    }
+	    stss = pmfg_convert_value(pmfg, desc, &item->u.indom.conv,
+				v.d, prev_v.d, deltaT, &value);
+	    if (stss < 0)
+		goto out1;
+	    stss = __pmStuffDoubleValue(value, &v, item->u.indom.output_type);
 	    if (stss < 0)
 		goto out1;
 	}
 	else {
-	    stss = pmfg_extract_item(item->u.indom.metric_pmid, jv->inst,
-				0, &item->u.indom.metric_desc,
-				newResult->vset, newResult->numpmid, &v,
-				item->u.indom.output_type);
+	    stss = __pmExtractValue2(iv->valfmt, jv, desc->type,
+				&v, item->u.indom.output_type);
 	    if (stss < 0)
 		goto out1;
 	}
@@ -1007,6 +1159,8 @@ pmfg_fetch_indom(pmFG pmfg, pmFGI item, pmResult *newResult)
 	/* Pass the output value. */
 	if (item->u.indom.output_values)
 	    item->u.indom.output_values[j] = v;
+	else if (item->u.indom.output_doubles)
+	    item->u.indom.output_doubles[j] = v.d;
 
 out1:
 	if (item->u.indom.output_stss)
@@ -1410,11 +1564,15 @@ pmExtendFetchGroup_timestamp(pmFG pmfg, struct timeval *out_value)
     return 0;
 }
 
-int
-pmExtendFetchGroup_indom(pmFG pmfg,
+/*
+ * Common code for pmExtendFetchGroup_indom and pmExtendFetchGroup_vector,
+ * one of out_values and out_doubles being NULL.
+ */
+static int
+pmfg_extend_indom(pmFG pmfg,
 		const char *metric, const char *scale,
 		int out_inst_codes[], char *out_inst_names[],
-		pmAtomValue out_values[], int out_type,
+		pmAtomValue out_values[], double out_doubles[], int out_type,
 		int out_stss[], unsigned int out_maxnum,
 		unsigned int *out_num, int *out_sts)
 {
@@ -1450,6 +1608,7 @@ pmExtendFetchGroup_indom(pmFG pmfg,
     item->u.indom.output_inst_codes = out_inst_codes;
     item->u.indom.output_inst_names = out_inst_names;
     item->u.indom.output_values = out_values;
+    item->u.indom.output_doubles = out_doubles;
     item->u.indom.output_type = out_type;
     item->u.indom.output_stss = out_stss;
     item->u.indom.output_sts = out_sts;
@@ -1473,6 +1632,36 @@ out:
     return sts;
 }
 
+int
+pmExtendFetchGroup_indom(pmFG pmfg,
+		const char *metric, const char *scale,
+		int out_inst_codes[], char *out_inst_names[],
+		pmAtomValue out_values[], int out_type,
+		int out_stss[], unsigned int out_maxnum,
+		unsigned int *out_num, int *out_sts)
+{
+    return pmfg_extend_indom(pmfg, metric, scale,
+		out_inst_codes, out_inst_names, out_values, NULL, out_type,
+		out_stss, out_maxnum, out_num, out_sts);
+}
+
+/*
+ * As for pmExtendFetchGroup_indom, but the values are converted to
+ * doubles and stored contiguously in out_values[], so that callers can
+ * operate on the whole vector at once.
+ */
+int
+pmExtendFetchGroup_vector(pmFG pmfg,
+		const char *metric, const char *scale,
+		int out_inst_codes[], char *out_inst_names[],
+		double out_values[], int out_stss[],
+		unsigned int out_maxnum, unsigned int *out_num, int *out_sts)
+{
+    return pmfg_extend_indom(pmfg, metric, scale,
+		out_inst_codes, out_inst_names, NULL, out_values, PM_TYPE_DOUBLE,
+		out_stss, out_maxnum, out_num, out_sts);
+}
+
 int
 pmExtendFetchGroup_event(pmFG pmfg,
 		const char *metric, const char *instance,
@@ -1698,6 +1887,219 @@ pmFetchGroup(pmFG pmfg)
     return sts;
 }
 
+/*
+ * One pmFetchGroups() call, queued for the worker pool; each thread
+ * (the caller included) claims the next unfetched group until there
+ * are none left.
+ */
+typedef struct pmfg_batch {
+    int			numfg;
+    pmFG		*pmfgs;
+    int			*stss;
+    int			next;		/* next group to claim */
+    int			helpers;	/* pool threads fetching for it */
+    int			maxhelpers;	/* ... and the most allowed */
+    struct pmfg_batch	*link;
+} pmfg_batch_t;
+
+#ifdef PM_MULTI_THREAD
+/*
+ * Worker threads persist between calls, started on demand up to
+ * PMFG_MAXTHREADS and joined at exit.  All fields are protected by
+ * pool.lock.
+ */
+static struct {
+    pthread_mutex_t	lock;
+    pthread_cond_t	work;		/* a batch has groups to claim */
+    pthread_cond_t	done;		/* a group has been fetched */
+    pmfg_batch_t	*batches;	/* calls in progress */
+    pthread_t		thread[PMFG_MAXTHREADS];
+    int			nthread;
+    int			busy;		/* threads helping with a batch */
+    int			stop;
+    int			atexit;		/* pmfg_pool_exit registered */
+    pid_t		pid;		/* process that started them */
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+	   PTHREAD_COND_INITIALIZER };
+
+/* a queued batch that a pool thread may help with, if any */
+static pmfg_batch_t *
+pmfg_pool_batch(void)
+{
+    pmfg_batch_t	*bp;
+
+    for (bp = pool.batches; bp != NULL; bp = bp->link) {
+	if (bp->next < bp->numfg && bp->helpers < bp->maxhelpers)
+	    return bp;
+    }
+    return NULL;
+}
+#endif
+
+/* fetch groups of bp until none are left to claim, with pool.lock held */
+static void
+pmfg_fetch_batch(pmfg_batch_t *bp)
+{
+    int			i;
+
+    while (bp->next < bp->numfg) {
+	i = bp->next++;
+#ifdef PM_MULTI_THREAD
+	PM_UNLOCK(pool.lock);
+#endif
+	if (bp->pmfgs[i] == NULL)
+	    bp->stss[i] = -EINVAL;
+	else
+	    bp->stss[i] = pmFetchGroup(bp->pmfgs[i]);
+#ifdef PM_MULTI_THREAD
+	PM_LOCK(pool.lock);
+#endif
+    }
+}
+
+#ifdef PM_MULTI_THREAD
+static void *
+pmfg_pool_worker(void *arg)
+{
+    pmfg_batch_t	*bp;
+
+    (void)arg;
+    PM_LOCK(pool.lock);
+    while (!pool.stop) {
+	if ((bp = pmfg_pool_batch()) == NULL) {
+	    pthread_cond_wait(&pool.work, &pool.lock);
+	    continue;
+	}
+	bp->helpers++;
+	pool.busy++;
+	pmfg_fetch_batch(bp);
+	pool.busy--;
+	bp->helpers--;
+	pthread_cond_broadcast(&pool.done);
+    }
+    PM_UNLOCK(pool.lock);
+    return NULL;
+}
+
+static void
+pmfg_pool_exit(void)
+{
+    int			i, n;
+
+    PM_LOCK(pool.lock);
+    if (pool.pid != getpid()) {
+	/* threads belong to our parent, not to us */
+	PM_UNLOCK(pool.lock);
+	return;
+    }
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.work);
+    n = pool.nthread;
+    pool.nthread = 0;
+    PM_UNLOCK(pool.lock);
+    for (i = 0; i < n; i++)
+	pthread_join(pool.thread[i], NULL);
+}
+
+/*
+ * Make sure enough pool threads exist for a batch wanting help from
+ * want of them, with pool.lock held; on failure, make do with the
+ * threads there are.
+ */
+static void
+pmfg_pool_grow(int want)
+{
+    if (pool.nthread > 0 && pool.pid != getpid()) {
+	/* forked, the pool threads were not inherited */
+	pool.nthread = pool.busy = 0;
+	pool.batches = NULL;
+    }
+    if (pool.stop)
+	return;
+    if (!pool.atexit) {
+	atexit(pmfg_pool_exit);
+	pool.atexit = 1;
+    }
+    pool.pid = getpid();
+    if (want > PMFG_MAXTHREADS)
+	want = PMFG_MAXTHREADS;
+    while (pool.nthread - pool.busy < want && pool.nthread < PMFG_MAXTHREADS) {
+	if (pthread_create(&pool.thread[pool.nthread], NULL,
+				pmfg_pool_worker, NULL) != 0)
+	    break;
+	pool.nthread++;
+    }
+}
+#endif
+
+/*
+ * Call pmFetchGroup() for each of a set of fetchgroups, typically one
+ * per host, with up to maxthreads of them in flight at once (zero
+ * selects a default).  The pmFetch() status for each group is returned
+ * in out_stss[]; the result is the number of groups fetched successfully.
+ * The caller's current context is not changed.
+ */
+int
+pmFetchGroups(int numfg, pmFG pmfgs[], int out_stss[], int maxthreads)
+{
+    pmfg_batch_t	batch;
+    int			ctx;
+    int			sts = 0;
+    int			i;
+
+    if (numfg < 0 || pmfgs == NULL || out_stss == NULL)
+	return -EINVAL;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.numfg = numfg;
+    batch.pmfgs = pmfgs;
+    batch.stss = out_stss;
+    ctx = pmWhichContext();
+
+#ifdef PM_MULTI_THREAD
+    if (maxthreads <= 0)
+	maxthreads = PMFG_MAXTHREADS;
+    if (maxthreads > numfg)
+	maxthreads = numfg;
+    /* this thread fetches too, so one less from the pool */
+    batch.maxhelpers = maxthreads - 1;
+
+    PM_LOCK(pool.lock);
+    if (batch.maxhelpers > 0) {
+	pmfg_pool_grow(batch.maxhelpers);
+	batch.link = pool.batches;
+	pool.batches = &batch;
+	pthread_cond_broadcast(&pool.work);
+    }
+    pmfg_fetch_batch(&batch);
+    /* wait for the groups claimed by pool threads */
+    while (batch.helpers > 0)
+	pthread_cond_wait(&pool.done, &pool.lock);
+    if (batch.maxhelpers > 0) {
+	pmfg_batch_t	**bpp;
+
+	for (bpp = &pool.batches; *bpp != NULL; bpp = &(*bpp)->link) {
+	    if (*bpp == &batch) {
+		*bpp = batch.link;
+		break;
+	    }
+	}
+    }
+    PM_UNLOCK(pool.lock);
+#else
+    (void)maxthreads;
+    pmfg_fetch_batch(&batch);
+#endif
+
+    for (i = 0; i < numfg; i++) {
+	if (out_stss[i] >= 0)
+	    sts++;
+    }
+    if (ctx >= 0)
+	pmUseContext(ctx);
+    return sts;
+}
+
 /*
  * Clear the fetchgroup of all items, keeping the PMAPI context alive.
  */
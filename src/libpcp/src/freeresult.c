@@ -15,9 +15,39 @@
 
 #include "pmapi.h"
 #include "libpcp.h"
+#include "internal.h"
+
+/*
+ * Set once any result has been decoded into an arena, so that results
+ * need not be checked for that otherwise.
+ */
+int	__pmResultArenas;
 
 /* Free result buffer routines */
 
+/*
+ * If result is the pmResult or pmHighResResult in an arena, release
+ * the arena and any PDU buffer it references, and return 1.  Arenas
+ * are pinned twice on creation, so the header remains valid after the
+ * first unpin here establishes that this is an arena.
+ */
+int
+__pmFreeResultArena(void *result)
+{
+    __pmResultArena	*arena;
+
+    if (!__pmUnpinPDUBuf(result))
+	return 0;
+    arena = (__pmResultArena *)result - 1;
+    if (pmDebugOptions.pdubuf)
+	fprintf(stderr, "__pmFreeResultArena(" PRINTF_P_PFX "%p) pdubuf="
+			PRINTF_P_PFX "%p\n", result, arena->pdubuf);
+    if (arena->pdubuf)
+	__pmUnpinPDUBuf(arena->pdubuf);
+    __pmUnpinPDUBuf(arena);
+    return 1;
+}
+
 static void
 __pmFreeResultValueSets(pmValueSet **ppvstart, pmValueSet **ppvsend)
 {
@@ -69,6 +99,8 @@ pmFreeResult(pmResult *result)
 {
     if (pmDebugOptions.pdubuf)
 	fprintf(stderr, "pmFreeResult(" PRINTF_P_PFX "%p)\n", result);
+    if (__pmResultArenas && __pmFreeResultArena(result))
+	return;
     __pmFreeResultValues(result);
     free(result);
 }
@@ -88,6 +120,8 @@ __pmFreeHighResResult(pmHighResResult *result)
 {
     if (pmDebugOptions.pdubuf)
 	fprintf(stderr, "__pmFreeHighResResult(" PRINTF_P_PFX "%p)\n", result);
+    if (__pmResultArenas && __pmFreeResultArena(result))
+	return;
     __pmFreeHighResResultValues(result);
     free(result);
 }
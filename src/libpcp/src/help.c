@@ -74,16 +74,21 @@ lookuptext(int ident, int type, char **buffer)
     *buffer = NULL;
 
     if (ctxp->c_type == PM_CONTEXT_HOST) {
+	PM_LOCK(ctxp->c_pmcd->pc_lock);
 	tout = ctxp->c_pmcd->pc_tout_sec;
 	fd = ctxp->c_pmcd->pc_fd;
 again_host:
 	sts = __pmSendTextReq(fd, __pmPtrToHandle(ctxp), ident, type);
-	if (sts < 0)
+	if (sts < 0) {
 	    sts = __pmMapErrno(sts);
+	    __pmSharedPMCDError(ctxp, sts);
+	}
 	else {
 	    PM_FAULT_POINT("libpcp/" __FILE__ ":1", PM_FAULT_TIMEOUT);
 	    sts = __pmRecvText(fd, ctxp, tout, buffer);
-	    if (sts != 0 || *buffer[0] == '\0') {
+	    if (sts < 0)
+		__pmSharedPMCDError(ctxp, sts);
+	    if ((sts != 0 || *buffer[0] == '\0') && ctxp->c_pmcd->pc_fd >= 0) {
 		/* failed help text request, maybe try for one-line */
 		if ((type = fallbacktext(type, *buffer)) != 0) {
 		    if (*buffer != NULL) {
@@ -94,6 +99,7 @@ again_host:
 		}
 	    }
 	}
+	PM_UNLOCK(ctxp->c_pmcd->pc_lock);
     }
     else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	if (PM_MULTIPLE_THREADS(PM_SCOPE_DSO_PMDA))
@@ -48,6 +48,7 @@ pmLookupInDom_ctx(__pmContext *ctxp, pmInDom indom, const char *name)
 	else
 	    PM_ASSERT_IS_LOCKED(ctxp->c_lock);
 	if (ctxp->c_type == PM_CONTEXT_HOST) {
+	    PM_LOCK(ctxp->c_pmcd->pc_lock);
 	    sts = __pmSendInstanceReq(ctxp->c_pmcd->pc_fd, __pmPtrToHandle(ctxp), indom, PM_IN_NULL, name);
 	    if (sts < 0)
 		sts = __pmMapErrno(sts);
@@ -73,6 +74,9 @@ PM_FAULT_POINT("libpcp/" __FILE__ ":3", PM_FAULT_TIMEOUT);
 		if (pinpdu > 0)
 		    __pmUnpinPDUBuf(pb);
 	    }
+	    if (sts < 0)
+		__pmSharedPMCDError(ctxp, sts);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	}
 	else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	    __pmDSO	*dp;
@@ -161,6 +165,7 @@ pmNameInDom_ctx(__pmContext *ctxp, pmInDom indom, int inst, char **name)
 	else
 	    PM_ASSERT_IS_LOCKED(ctxp->c_lock);
 	if (ctxp->c_type == PM_CONTEXT_HOST) {
+	    PM_LOCK(ctxp->c_pmcd->pc_lock);
 	    sts = __pmSendInstanceReq(ctxp->c_pmcd->pc_fd, __pmPtrToHandle(ctxp), indom, inst, NULL);
 	    if (sts < 0)
 		sts = __pmMapErrno(sts);
@@ -187,6 +192,9 @@ PM_FAULT_POINT("libpcp/" __FILE__ ":2", PM_FAULT_TIMEOUT);
 		if (pinpdu > 0)
 		    __pmUnpinPDUBuf(pb);
 	    }
+	    if (sts < 0)
+		__pmSharedPMCDError(ctxp, sts);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	}
 	else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	    __pmDSO	*dp;
@@ -318,6 +326,7 @@ pmGetInDom(pmInDom indom, int **instlist, char ***namelist)
 	    goto pmapi_return;
 	}
 	if (ctxp->c_type == PM_CONTEXT_HOST) {
+	    PM_LOCK(ctxp->c_pmcd->pc_lock);
 	    sts = __pmSendInstanceReq(ctxp->c_pmcd->pc_fd, __pmPtrToHandle(ctxp), indom, PM_IN_NULL, NULL);
 	    if (sts < 0)
 		sts = __pmMapErrno(sts);
@@ -333,6 +342,7 @@ PM_FAULT_POINT("libpcp/" __FILE__ ":1", PM_FAULT_TIMEOUT);
 		    if ((sts = __pmDecodeInstance(pb, &result)) < 0) {
 			if (pinpdu > 0)
 			    __pmUnpinPDUBuf(pb);
+			PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 			PM_UNLOCK(ctxp->c_lock);
 			goto pmapi_return;
 		    }
@@ -346,6 +356,9 @@ PM_FAULT_POINT("libpcp/" __FILE__ ":1", PM_FAULT_TIMEOUT);
 		if (pinpdu > 0)
 		    __pmUnpinPDUBuf(pb);
 	    }
+	    if (sts < 0)
+		__pmSharedPMCDError(ctxp, sts);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	}
 	else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	    __pmDSO	*dp;
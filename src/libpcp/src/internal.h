@@ -31,6 +31,7 @@ extern int __pmConvertTimeout(int) _PCP_HIDDEN;
 extern int __pmConnectWithFNDELAY(int, void *, __pmSockLen) _PCP_HIDDEN;
 
 extern int __pmPtrToHandle(__pmContext *) _PCP_HIDDEN;
+extern void __pmSharedPMCDError(__pmContext *, int) _PCP_HIDDEN;
 
 extern int __pmGetDate(struct timespec *, char const *, struct timespec const *)  _PCP_HIDDEN;
 
@@ -188,6 +189,20 @@ extern int __pmIsExecLock(void *) _PCP_HIDDEN;
 #endif
 #endif
 
+/*
+ * Header for a pmResult or pmHighResResult decoded into a single pinned
+ * PDU buffer (for contexts with PM_CTXFLAG_ARENA), which precedes the
+ * result structure itself.  Any pmValueBlocks are referenced in place
+ * in the (also pinned) PDU buffer the result was decoded from.
+ */
+typedef struct {
+    __pmPDU	*pdubuf;	/* input PDU buffer holding pmValueBlocks */
+    void	*unused;	/* padding, keeps the result aligned */
+} __pmResultArena;
+
+extern int __pmResultArenas _PCP_HIDDEN;
+extern int __pmFreeResultArena(void *) _PCP_HIDDEN;
+
 /* AF_UNIX socket family internals */
 #define PM_HOST_SPEC_NPORTS_LOCAL (-1)
 #define PM_HOST_SPEC_NPORTS_UNIX  (-2)
@@ -343,7 +358,6 @@ extern int pmLookupInDom_ctx(__pmContext *, pmInDom, const char *) _PCP_HIDDEN;
 extern int pmGetInDomArchive_ctx(__pmContext *, pmInDom, int **, char ***) _PCP_HIDDEN;
 extern int pmFetch_ctx(__pmContext *, int, pmID *, pmResult **) _PCP_HIDDEN;
 extern int pmStore_ctx(__pmContext *, const pmResult *) _PCP_HIDDEN;
-extern int __pmDecodeResult_ctx(__pmContext *, __pmPDU *, pmResult **) _PCP_HIDDEN;
 extern int __pmDecodeHighResResult_ctx(__pmContext *, __pmPDU *, pmHighResResult **) _PCP_HIDDEN;
 extern int __pmSendResult_ctx(__pmContext *, int, int, const pmResult *) _PCP_HIDDEN;
 extern int __pmSendHighResResult_ctx(__pmContext *, int, int, const pmHighResResult *) _PCP_HIDDEN;
@@ -425,6 +439,11 @@ extern void __pmArchCtlFree(__pmArchCtl *) _PCP_HIDDEN;
 extern int __pmLogChangeArchive(__pmContext *, int) _PCP_HIDDEN;
 extern int __pmLogChangeToNextArchive(__pmLogCtl **) _PCP_HIDDEN;
 extern int __pmLogChangeToPreviousArchive(__pmLogCtl **) _PCP_HIDDEN;
+extern int __pmLogDeltaEncode(__pmArchCtl *, __pmPDU *, __pmPDU **) _PCP_HIDDEN;
+extern int __pmLogDeltaDecode(__pmArchCtl *, __pmFILE *, long, __pmPDU **) _PCP_HIDDEN;
+extern void __pmLogDeltaRemember(__pmArchCtl *, __pmFILE *, long, __pmPDU *) _PCP_HIDDEN;
+extern void __pmLogDeltaReset(__pmArchCtl *) _PCP_HIDDEN;
+extern void __pmLogDeltaFree(__pmArchCtl *) _PCP_HIDDEN;
 
 /* DSO PMDA helpers */
 struct __pmDSO;			/* opaque, real definition in pmda.h */
@@ -1344,13 +1344,16 @@ getlabels(int ident, int type, pmLabelSet **sets, int *nsets)
     if (ctxp->c_type == PM_CONTEXT_HOST) {
 	int	handle = __pmPtrToHandle(ctxp);
 	int	tout = ctxp->c_pmcd->pc_tout_sec;
-	int	fd = ctxp->c_pmcd->pc_fd;
+	int	fd;
 
+	PM_LOCK(ctxp->c_pmcd->pc_lock);
+	fd = ctxp->c_pmcd->pc_fd;
 	if (!(__pmFeaturesIPC(fd) & PDU_FLAG_LABELS))
 	    sts = PM_ERR_NOLABELS;	/* lack pmcd support */
 	else {
 	    sts = 0;
-	    if ((type & PM_LABEL_INSTANCES) && ctxp->c_sent == 0) {
+	    if ((type & PM_LABEL_INSTANCES) &&
+		(ctxp->c_sent == 0 || ctxp->c_sentgen != ctxp->c_pmcd->pc_gen)) {
 	    	/* profile not current for label instances request */
 		if (pmDebugOptions.indom || pmDebugOptions.labels) {
 		    fprintf(stderr, "dolabels: sent profile, indom=%d\n", ident);
@@ -1362,6 +1365,7 @@ getlabels(int ident, int type, pmLabelSet **sets, int *nsets)
 		else {
 		    /* no reply expected for profile */
 		    ctxp->c_sent = 1;
+		    ctxp->c_sentgen = ctxp->c_pmcd->pc_gen;
 		}
 	    }
 	    if (sts >= 0) {
@@ -1374,6 +1378,9 @@ getlabels(int ident, int type, pmLabelSet **sets, int *nsets)
 		}
 	    }
 	}
+	if (sts < 0)
+	    __pmSharedPMCDError(ctxp, sts);
+	PM_UNLOCK(ctxp->c_pmcd->pc_lock);
     }
     else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	__pmDSO	*dp;
@@ -0,0 +1,926 @@
+/*
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * Columnar export of numeric archive values.
+ *
+ * Archive data records hold one pmResult per sample time, so reading one
+ * metric over a long period means reading and decoding every record.  A
+ * columns file holds the same values by metric-instance instead: each
+ * column is a sequence of blocks of up to COL_BLOCK values, and a block
+ * is the timestamps (delta-of-delta, zigzag varints) followed by the
+ * values (zigzag varint deltas for integer types, XOR compressed in the
+ * style of Facebook's Gorilla for floating point types).  A directory at
+ * the end of the file has the description of every column and the time
+ * range and file offset of every block, so a reader only reads the blocks
+ * of the columns and times it wants.
+ *
+ * File layout, all integers in network byte order ...
+ *
+ *	header		"PCPCOLS\n", version, number of columns, block size,
+ *			offset of the directory
+ *	blocks		in the order they fill up, columns interleaved
+ *	directory	hostname, timezone, then for each column the name,
+ *			instance, pmDesc, count and block list
+ *
+ * Thread-safe notes
+ *
+ * - a __pmLogColumns is only ever used by one thread at a time, there
+ *   is no shared state
+ */
+
+#include "pmapi.h"
+#include "libpcp.h"
+#include "internal.h"
+
+#define COL_MAGIC	"PCPCOLS\n"
+#define COL_VERSION	1
+#define COL_BLOCK	1024		/* values per block */
+#define COL_HDRSIZE	32
+
+typedef struct {
+    unsigned char	*buf;
+    size_t		len;
+    size_t		maxlen;
+    int			nbits;		/* bits used in the last byte */
+} colbuf_t;
+
+typedef struct {
+    __pmTimestamp	first;
+    __pmTimestamp	last;
+    __uint32_t		count;
+    __uint64_t		offset;		/* in the file */
+    __uint32_t		tslen;		/* bytes of timestamps ... */
+    __uint32_t		vlen;		/* ... then bytes of values */
+} colblock_t;
+
+typedef struct {
+    __pmLogColumnDesc	cd;
+    int			nblock;
+    colblock_t		*block;
+    /* when writing, the block being filled */
+    colbuf_t		ts;
+    colbuf_t		val;
+    __uint32_t		n;		/* values in this block */
+    __pmTimestamp	first;
+    __pmTimestamp	prev;
+    __int64_t		prevdelta;	/* nsec */
+    __uint64_t		prevval;	/* bits of previous value */
+    int			lead;		/* previous XOR window */
+    int			trail;
+} column_t;
+
+struct __pmLogColumns {
+    FILE		*f;
+    int			writing;
+    char		*hostname;
+    char		*timezone;
+    int			ncol;
+    column_t		*col;
+    __uint64_t		offset;		/* when writing, end of the blocks */
+    __uint64_t		size;		/* when reading, of the file */
+};
+
+static int
+isfloat(int type)
+{
+    return type == PM_TYPE_FLOAT || type == PM_TYPE_DOUBLE;
+}
+
+/*
+ * byte and bit buffers
+ */
+
+static int
+buf_need(colbuf_t *bp, size_t need)
+{
+    unsigned char	*tmp;
+    size_t		want;
+
+    if (bp->len + need <= bp->maxlen)
+	return 0;
+    want = bp->maxlen ? 2 * bp->maxlen : 256;
+    while (want < bp->len + need)
+	want *= 2;
+    if ((tmp = (unsigned char *)realloc(bp->buf, want)) == NULL) {
+	pmNoMem("__pmLogColumns: buffer", want, PM_RECOV_ERR);
+	return -ENOMEM;
+    }
+    bp->buf = tmp;
+    bp->maxlen = want;
+    return 0;
+}
+
+static int
+put_bytes(colbuf_t *bp, const void *p, size_t n)
+{
+    if (buf_need(bp, n) < 0)
+	return -ENOMEM;
+    memcpy(&bp->buf[bp->len], p, n);
+    bp->len += n;
+    bp->nbits = 0;
+    return 0;
+}
+
+static int
+put_u32(colbuf_t *bp, __uint32_t v)
+{
+    unsigned char	b[4];
+
+    b[0] = v >> 24; b[1] = v >> 16; b[2] = v >> 8; b[3] = v;
+    return put_bytes(bp, b, 4);
+}
+
+static int
+put_u64(colbuf_t *bp, __uint64_t v)
+{
+    if (put_u32(bp, (__uint32_t)(v >> 32)) < 0)
+	return -ENOMEM;
+    return put_u32(bp, (__uint32_t)v);
+}
+
+static int
+put_str(colbuf_t *bp, const char *s)
+{
+    __uint32_t	len = s ? strlen(s) : 0;
+
+    if (put_u32(bp, len) < 0)
+	return -ENOMEM;
+    return put_bytes(bp, s, len);
+}
+
+static __uint64_t
+zigzag(__int64_t v)
+{
+    return ((__uint64_t)v << 1) ^ (__uint64_t)(v >> 63);
+}
+
+static __int64_t
+unzigzag(__uint64_t v)
+{
+    return (__int64_t)(v >> 1) ^ -(__int64_t)(v & 1);
+}
+
+static int
+put_varint(colbuf_t *bp, __uint64_t v)
+{
+    unsigned char	b[10];
+    int			n = 0;
+
+    while (v >= 0x80) {
+	b[n++] = (v & 0x7f) | 0x80;
+	v >>= 7;
+    }
+    b[n++] = v;
+    return put_bytes(bp, b, n);
+}
+
+/* append the low nbits bits of v, most significant first */
+static int
+put_bits(colbuf_t *bp, __uint64_t v, int nbits)
+{
+    int		room, take;
+
+    while (nbits > 0) {
+	if (bp->nbits == 0 || bp->nbits == 8) {
+	    if (buf_need(bp, 1) < 0)
+		return -ENOMEM;
+	    bp->buf[bp->len++] = 0;
+	    bp->nbits = 0;
+	}
+	room = 8 - bp->nbits;
+	take = nbits < room ? nbits : room;
+	bp->buf[bp->len-1] |= ((v >> (nbits - take)) & ((1 << take) - 1)) << (room - take);
+	bp->nbits += take;
+	nbits -= take;
+    }
+    return 0;
+}
+
+typedef struct {
+    const unsigned char	*p;
+    const unsigned char	*end;
+    int			bit;		/* next bit in *p */
+} colrd_t;
+
+static int
+get_varint(colrd_t *rp, __uint64_t *vp)
+{
+    __uint64_t	v = 0;
+    int		shift = 0;
+
+    while (rp->p < rp->end && shift < 64) {
+	v |= (__uint64_t)(*rp->p & 0x7f) << shift;
+	if ((*rp->p++ & 0x80) == 0) {
+	    *vp = v;
+	    return 0;
+	}
+	shift += 7;
+    }
+    return PM_ERR_LOGREC;
+}
+
+static int
+get_bits(colrd_t *rp, int nbits, __uint64_t *vp)
+{
+    __uint64_t	v = 0;
+    int		take;
+
+    while (nbits > 0) {
+	if (rp->p >= rp->end)
+	    return PM_ERR_LOGREC;
+	take = 8 - rp->bit;
+	if (take > nbits)
+	    take = nbits;
+	v = (v << take) | ((*rp->p >> (8 - rp->bit - take)) & ((1 << take) - 1));
+	rp->bit += take;
+	nbits -= take;
+	if (rp->bit == 8) {
+	    rp->p++;
+	    rp->bit = 0;
+	}
+    }
+    *vp = v;
+    return 0;
+}
+
+static __uint32_t
+get_u32(const unsigned char *b)
+{
+    return ((__uint32_t)b[0] << 24) | ((__uint32_t)b[1] << 16) |
+	   ((__uint32_t)b[2] << 8) | b[3];
+}
+
+static __uint64_t
+get_u64(const unsigned char *b)
+{
+    return ((__uint64_t)get_u32(b) << 32) | get_u32(&b[4]);
+}
+
+static int
+clz64(__uint64_t v)
+{
+    int		n = 0;
+
+    while (n < 64 && (v & ((__uint64_t)1 << 63)) == 0) {
+	v <<= 1;
+	n++;
+    }
+    return n;
+}
+
+static int
+ctz64(__uint64_t v)
+{
+    int		n = 0;
+
+    while (n < 64 && (v & 1) == 0) {
+	v >>= 1;
+	n++;
+    }
+    return n;
+}
+
+static __int64_t
+nsec(const __pmTimestamp *tp)
+{
+    return tp->sec * (__int64_t)1000000000 + tp->nsec;
+}
+
+/*
+ * writing
+ */
+
+int
+__pmLogColumnsCreate(const char *path, const char *hostname,
+		const char *tz, __pmLogColumns **colp)
+{
+    __pmLogColumns	*cp;
+    char		hdr[COL_HDRSIZE];
+
+    if ((cp = (__pmLogColumns *)calloc(1, sizeof(*cp))) == NULL)
+	return -ENOMEM;
+    if ((cp->f = fopen(path, "w")) == NULL) {
+	int	sts = -oserror();
+	free(cp);
+	return sts;
+    }
+    cp->writing = 1;
+    cp->hostname = hostname ? strdup(hostname) : NULL;
+    cp->timezone = tz ? strdup(tz) : NULL;
+    /* header is rewritten by __pmLogColumnsClose() */
+    memset(hdr, 0, sizeof(hdr));
+    if (fwrite(hdr, 1, sizeof(hdr), cp->f) != sizeof(hdr)) {
+	int	sts = -oserror();
+	cp->writing = 0;
+	__pmLogColumnsClose(cp);
+	return sts;
+    }
+    cp->offset = sizeof(hdr);
+    *colp = cp;
+    return 0;
+}
+
+int
+__pmLogColumnsAdd(__pmLogColumns *cp, const char *name, const pmDesc *dp,
+		int inst, const char *iname)
+{
+    column_t	*tmp;
+    column_t	*col;
+    size_t	need = (cp->ncol + 1) * sizeof(column_t);
+
+    if (!cp->writing)
+	return -EINVAL;
+    if (dp->type != PM_TYPE_32 && dp->type != PM_TYPE_U32 &&
+	dp->type != PM_TYPE_64 && dp->type != PM_TYPE_U64 &&
+	!isfloat(dp->type))
+	return PM_ERR_TYPE;
+    if ((tmp = (column_t *)realloc(cp->col, need)) == NULL) {
+	pmNoMem("__pmLogColumnsAdd", need, PM_RECOV_ERR);
+	return -ENOMEM;
+    }
+    cp->col = tmp;
+    col = &cp->col[cp->ncol];
+    memset(col, 0, sizeof(*col));
+    col->cd.name = strdup(name);
+    col->cd.iname = (inst == PM_IN_NULL || iname == NULL) ? NULL : strdup(iname);
+    col->cd.inst = inst;
+    col->cd.desc = *dp;
+    return cp->ncol++;
+}
+
+/* write out the block being filled for column c */
+static int
+flush_block(__pmLogColumns *cp, column_t *col)
+{
+    colblock_t	*tmp;
+    colblock_t	*bp;
+    size_t	need = (col->nblock + 1) * sizeof(colblock_t);
+
+    if (col->n == 0)
+	return 0;
+    if ((tmp = (colblock_t *)realloc(col->block, need)) == NULL) {
+	pmNoMem("__pmLogColumns: block", need, PM_RECOV_ERR);
+	return -ENOMEM;
+    }
+    col->block = tmp;
+    bp = &col->block[col->nblock++];
+    bp->first = col->first;
+    bp->last = col->prev;
+    bp->count = col->n;
+    bp->offset = cp->offset;
+    bp->tslen = col->ts.len;
+    bp->vlen = col->val.len;
+    if ((col->ts.len && fwrite(col->ts.buf, 1, col->ts.len, cp->f) != col->ts.len) ||
+	(col->val.len && fwrite(col->val.buf, 1, col->val.len, cp->f) != col->val.len))
+	return -oserror();
+    cp->offset += col->ts.len + col->val.len;
+    col->ts.len = col->val.len = 0;
+    col->ts.nbits = col->val.nbits = 0;
+    col->n = 0;
+    return 0;
+}
+
+int
+__pmLogColumnsPut(__pmLogColumns *cp, int c, const __pmTimestamp *tp,
+		const pmAtomValue *ap)
+{
+    column_t	*col;
+    __uint64_t	bits;
+    __uint64_t	xor;
+    __int64_t	delta;
+    int		lead, trail;
+    int		sts = 0;
+
+    if (!cp->writing || c < 0 || c >= cp->ncol)
+	return -EINVAL;
+    col = &cp->col[c];
+
+    switch (col->cd.desc.type) {
+	case PM_TYPE_32:
+	    bits = (__uint64_t)(__int64_t)ap->l;
+	    break;
+	case PM_TYPE_U32:
+	    bits = ap->ul;
+	    break;
+	case PM_TYPE_64:
+	    bits = (__uint64_t)ap->ll;
+	    break;
+	case PM_TYPE_U64:
+	    bits = ap->ull;
+	    break;
+	case PM_TYPE_FLOAT:
+	    {
+		double	d = ap->f;
+		memcpy(&bits, &d, sizeof(bits));
+	    }
+	    break;
+	default:	/* PM_TYPE_DOUBLE */
+	    memcpy(&bits, &ap->d, sizeof(bits));
+	    break;
+    }
+
+    if (col->n == 0) {
+	/* first value in block, timestamp is in the directory */
+	col->first = *tp;
+	col->prevdelta = 0;
+	if (isfloat(col->cd.desc.type)) {
+	    sts = put_bits(&col->val, bits, 64);
+	    col->lead = col->trail = -1;
+	}
+	else
+	    sts = put_varint(&col->val, zigzag((__int64_t)bits));
+    }
+    else {
+	delta = nsec(tp) - nsec(&col->prev);
+	if ((sts = put_varint(&col->ts, zigzag(delta - col->prevdelta))) < 0)
+	    return sts;
+	col->prevdelta = delta;
+	if (isfloat(col->cd.desc.type)) {
+	    if ((xor = bits ^ col->prevval) == 0)
+		sts = put_bits(&col->val, 0, 1);
+	    else {
+		lead = clz64(xor);
+		trail = ctz64(xor);
+		if (lead > 31)
+		    lead = 31;
+		if (col->lead >= 0 && lead >= col->lead && trail >= col->trail) {
+		    /* fits in the previous window */
+		    if ((sts = put_bits(&col->val, 2, 2)) == 0)
+			sts = put_bits(&col->val, xor >> col->trail,
+					64 - col->lead - col->trail);
+		}
+		else {
+		    /* new window, 5 bits leading zeroes, 6 bits length-1 */
+		    if ((sts = put_bits(&col->val, 3, 2)) == 0 &&
+			(sts = put_bits(&col->val, lead, 5)) == 0 &&
+			(sts = put_bits(&col->val, 63 - lead - trail, 6)) == 0)
+			sts = put_bits(&col->val, xor >> trail, 64 - lead - trail);
+		    col->lead = lead;
+		    col->trail = trail;
+		}
+	    }
+	}
+	else
+	    sts = put_varint(&col->val, zigzag((__int64_t)(bits - col->prevval)));
+    }
+    if (sts < 0)
+	return sts;
+
+    col->prevval = bits;
+    col->prev = *tp;
+    if (col->cd.count == 0)
+	col->cd.first = *tp;
+    col->cd.last = *tp;
+    col->cd.count++;
+    if (++col->n == COL_BLOCK)
+	sts = flush_block(cp, col);
+    return sts;
+}
+
+static int
+write_directory(__pmLogColumns *cp)
+{
+    colbuf_t	dir = { NULL };
+    colbuf_t	hdr = { NULL };
+    column_t	*col;
+    colblock_t	*bp;
+    __uint32_t	units;
+    int		c, b;
+    int		sts;
+
+    for (c = 0; c < cp->ncol; c++) {
+	if ((sts = flush_block(cp, &cp->col[c])) < 0)
+	    return sts;
+    }
+
+    if ((sts = put_str(&dir, cp->hostname)) < 0 ||
+	(sts = put_str(&dir, cp->timezone)) < 0)
+	goto done;
+    for (c = 0; c < cp->ncol; c++) {
+	col = &cp->col[c];
+	memcpy(&units, &col->cd.desc.units, sizeof(units));
+	if ((sts = put_str(&dir, col->cd.name)) < 0 ||
+	    (sts = put_str(&dir, col->cd.iname)) < 0 ||
+	    (sts = put_u32(&dir, col->cd.inst)) < 0 ||
+	    (sts = put_u32(&dir, col->cd.desc.pmid)) < 0 ||
+	    (sts = put_u32(&dir, col->cd.desc.type)) < 0 ||
+	    (sts = put_u32(&dir, col->cd.desc.indom)) < 0 ||
+	    (sts = put_u32(&dir, col->cd.desc.sem)) < 0 ||
+	    (sts = put_u32(&dir, units)) < 0 ||
+	    (sts = put_u32(&dir, col->cd.count)) < 0 ||
+	    (sts = put_u32(&dir, col->nblock)) < 0)
+	    goto done;
+	for (b = 0; b < col->nblock; b++) {
+	    bp = &col->block[b];
+	    if ((sts = put_u64(&dir, bp->first.sec)) < 0 ||
+		(sts = put_u32(&dir, bp->first.nsec)) < 0 ||
+		(sts = put_u64(&dir, bp->last.sec)) < 0 ||
+		(sts = put_u32(&dir, bp->last.nsec)) < 0 ||
+		(sts = put_u32(&dir, bp->count)) < 0 ||
+		(sts = put_u64(&dir, bp->offset)) < 0 ||
+		(sts = put_u32(&dir, bp->tslen)) < 0 ||
+		(sts = put_u32(&dir, bp->vlen)) < 0)
+		goto done;
+	}
+    }
+    if (fwrite(dir.buf, 1, dir.len, cp->f) != dir.len) {
+	sts = -oserror();
+	goto done;
+    }
+
+    if ((sts = put_bytes(&hdr, COL_MAGIC, 8)) < 0 ||
+	(sts = put_u32(&hdr, COL_VERSION)) < 0 ||
+	(sts = put_u32(&hdr, cp->ncol)) < 0 ||
+	(sts = put_u32(&hdr, COL_BLOCK)) < 0 ||
+	(sts = put_u32(&hdr, dir.len)) < 0 ||
+	(sts = put_u64(&hdr, cp->offset)) < 0)
+	goto done;
+    if (fseek(cp->f, 0L, SEEK_SET) < 0 ||
+	fwrite(hdr.buf, 1, hdr.len, cp->f) != hdr.len ||
+	fflush(cp->f) != 0)
+	sts = -oserror();
+
+done:
+    free(dir.buf);
+    free(hdr.buf);
+    return sts;
+}
+
+/*
+ * reading
+ */
+
+/*
+ * string from the directory, NULL for an empty one unless keep is set
+ */
+static int
+get_str(const unsigned char **pp, const unsigned char *end, int keep, char **sp)
+{
+    __uint32_t	len;
+
+    if (end - *pp < 4)
+	return PM_ERR_LOGREC;
+    len = get_u32(*pp);
+    *pp += 4;
+    if (end - *pp < len)
+	return PM_ERR_LOGREC;
+    *sp = NULL;
+    if (len > 0 || keep) {
+	if ((*sp = (char *)malloc(len + 1)) == NULL)
+	    return -ENOMEM;
+	memcpy(*sp, *pp, len);
+	(*sp)[len] = '\0';
+    }
+    *pp += len;
+    return 0;
+}
+
+int
+__pmLogColumnsOpen(const char *path, __pmLogColumns **colp)
+{
+    __pmLogColumns	*cp;
+    unsigned char	hdr[COL_HDRSIZE];
+    unsigned char	*dir = NULL;
+    const unsigned char	*p, *end;
+    column_t		*col;
+    colblock_t		*bp;
+    __uint32_t		dirlen;
+    __uint32_t		units;
+    struct stat		sbuf;
+    int			c, b;
+    int			sts;
+
+    if ((cp = (__pmLogColumns *)calloc(1, sizeof(*cp))) == NULL)
+	return -ENOMEM;
+    if ((cp->f = fopen(path, "r")) == NULL) {
+	sts = -oserror();
+	free(cp);
+	return sts;
+    }
+    if (fstat(fileno(cp->f), &sbuf) < 0) {
+	sts = -oserror();
+	goto fail;
+    }
+    cp->size = sbuf.st_size;
+    if (fread(hdr, 1, sizeof(hdr), cp->f) != sizeof(hdr) ||
+	memcmp(hdr, COL_MAGIC, 8) != 0 || get_u32(&hdr[8]) != COL_VERSION) {
+	sts = PM_ERR_LABEL;
+	goto fail;
+    }
+    dirlen = get_u32(&hdr[20]);
+    if (dirlen > cp->size) {
+	sts = PM_ERR_LOGREC;
+	goto fail;
+    }
+    if ((dir = (unsigned char *)malloc(dirlen ? dirlen : 1)) == NULL) {
+	sts = -ENOMEM;
+	goto fail;
+    }
+    if (fseek(cp->f, (long)get_u64(&hdr[24]), SEEK_SET) < 0 ||
+	fread(dir, 1, dirlen, cp->f) != dirlen) {
+	sts = PM_ERR_LOGREC;
+	goto fail;
+    }
+    p = dir;
+    end = dir + dirlen;
+    if ((sts = get_str(&p, end, 1, &cp->hostname)) < 0 ||
+	(sts = get_str(&p, end, 1, &cp->timezone)) < 0)
+	goto fail;
+
+    sts = PM_ERR_LOGREC;
+    for (c = 0; c < get_u32(&hdr[12]); c++) {
+	col = (column_t *)realloc(cp->col, (c + 1) * sizeof(column_t));
+	if (col == NULL) {
+	    sts = -ENOMEM;
+	    goto fail;
+	}
+	cp->col = col;
+	col = &cp->col[c];
+	memset(col, 0, sizeof(*col));
+	cp->ncol++;
+	if ((sts = get_str(&p, end, 1, &col->cd.name)) < 0 ||
+	    (sts = get_str(&p, end, 0, &col->cd.iname)) < 0)
+	    goto fail;
+	sts = PM_ERR_LOGREC;
+	if (end - p < 32)
+	    goto fail;
+	col->cd.inst = get_u32(p);
+	col->cd.desc.pmid = get_u32(p + 4);
+	col->cd.desc.type = get_u32(p + 8);
+	col->cd.desc.indom = get_u32(p + 12);
+	col->cd.desc.sem = get_u32(p + 16);
+	units = get_u32(p + 20);
+	memcpy(&col->cd.desc.units, &units, sizeof(units));
+	col->cd.count = get_u32(p + 24);
+	col->nblock = get_u32(p + 28);
+	p += 32;
+	if (col->nblock < 0 || (end - p) / 44 < col->nblock)
+	    goto fail;
+	if (col->nblock > 0 &&
+	    (col->block = (colblock_t *)malloc(col->nblock * sizeof(colblock_t))) == NULL) {
+	    sts = -ENOMEM;
+	    goto fail;
+	}
+	for (b = 0; b < col->nblock; b++, p += 44) {
+	    bp = &col->block[b];
+	    bp->first.sec = (__int64_t)get_u64(p);
+	    bp->first.nsec = get_u32(p + 8);
+	    bp->last.sec = (__int64_t)get_u64(p + 12);
+	    bp->last.nsec = get_u32(p + 20);
+	    bp->count = get_u32(p + 24);
+	    bp->offset = get_u64(p + 28);
+	    bp->tslen = get_u32(p + 36);
+	    bp->vlen = get_u32(p + 40);
+	}
+	if (col->nblock > 0) {
+	    col->cd.first = col->block[0].first;
+	    col->cd.last = col->block[col->nblock-1].last;
+	}
+    }
+    free(dir);
+    *colp = cp;
+    return 0;
+
+fail:
+    free(dir);
+    __pmLogColumnsClose(cp);
+    return sts;
+}
+
+int
+__pmLogColumnsInfo(__pmLogColumns *cp, const char **hostname, const char **tz)
+{
+    if (hostname)
+	*hostname = cp->hostname;
+    if (tz)
+	*tz = cp->timezone;
+    return cp->ncol;
+}
+
+const __pmLogColumnDesc *
+__pmLogColumnsDesc(__pmLogColumns *cp, int c)
+{
+    if (c < 0 || c >= cp->ncol)
+	return NULL;
+    return &cp->col[c].cd;
+}
+
+/*
+ * column for metric name and instance name (NULL for a singular metric),
+ * or PM_ERR_NAME or PM_ERR_INST
+ */
+int
+__pmLogColumnsLookup(__pmLogColumns *cp, const char *name, const char *iname)
+{
+    int		c;
+    int		sts = PM_ERR_NAME;
+
+    for (c = 0; c < cp->ncol; c++) {
+	if (strcmp(cp->col[c].cd.name, name) != 0)
+	    continue;
+	if (iname == NULL && cp->col[c].cd.iname == NULL)
+	    return c;
+	if (iname != NULL && cp->col[c].cd.iname != NULL &&
+	    strcmp(cp->col[c].cd.iname, iname) == 0)
+	    return c;
+	sts = PM_ERR_INST;
+    }
+    return sts;
+}
+
+static int
+decode_block(__pmLogColumns *cp, column_t *col, colblock_t *bp,
+	const __pmTimestamp *start, const __pmTimestamp *end,
+	double *times, double *values)
+{
+    unsigned char	*buf;
+    colrd_t		ts;
+    colrd_t		val;
+    __int64_t		t = nsec(&bp->first);
+    __int64_t		delta = 0;
+    __int64_t		lo = start ? nsec(start) : INT64_MIN;
+    __int64_t		hi = end ? nsec(end) : INT64_MAX;
+    __uint64_t		bits = 0;
+    __uint64_t		u;
+    int			lead = 0, trail = 0;
+    int			type = col->cd.desc.type;
+    int			n = 0;
+    int			i;
+    int			sts;
+    size_t		len = (size_t)bp->tslen + bp->vlen;
+
+    /* block must lie within the file, before trusting its lengths */
+    if (bp->offset > cp->size || len > cp->size - bp->offset)
+	return PM_ERR_LOGREC;
+    if ((buf = (unsigned char *)malloc(len ? len : 1)) == NULL)
+	return -ENOMEM;
+    if (fseek(cp->f, (long)bp->offset, SEEK_SET) < 0 ||
+	fread(buf, 1, len, cp->f) != len) {
+	free(buf);
+	return PM_ERR_LOGREC;
+    }
+    ts.p = buf;
+    ts.end = buf + bp->tslen;
+    ts.bit = 0;
+    val.p = ts.end;
+    val.end = buf + len;
+    val.bit = 0;
+
+    for (i = 0; i < bp->count; i++) {
+	if (i > 0) {
+	    if ((sts = get_varint(&ts, &u)) < 0)
+		goto fail;
+	    delta += unzigzag(u);
+	    t += delta;
+	}
+	if (!isfloat(type)) {
+	    if ((sts = get_varint(&val, &u)) < 0)
+		goto fail;
+	    bits += (__uint64_t)unzigzag(u);
+	}
+	else if (i == 0) {
+	    if ((sts = get_bits(&val, 64, &bits)) < 0)
+		goto fail;
+	}
+	else {
+	    if ((sts = get_bits(&val, 1, &u)) < 0)
+		goto fail;
+	    if (u) {
+		if ((sts = get_bits(&val, 1, &u)) < 0)
+		    goto fail;
+		if (u) {
+		    /* new window */
+		    if ((sts = get_bits(&val, 5, &u)) < 0)
+			goto fail;
+		    lead = u;
+		    if ((sts = get_bits(&val, 6, &u)) < 0)
+			goto fail;
+		    if (lead + u + 1 > 64) {
+			sts = PM_ERR_LOGREC;
+			goto fail;
+		    }
+		    trail = 64 - lead - (u + 1);
+		}
+		if ((sts = get_bits(&val, 64 - lead - trail, &u)) < 0)
+		    goto fail;
+		bits ^= u << trail;
+	    }
+	}
+	if (t < lo || t > hi)
+	    continue;
+	times[n] = t / 1e9;
+	switch (type) {
+	    case PM_TYPE_32:
+	    case PM_TYPE_64:
+		values[n] = (double)(__int64_t)bits;
+		break;
+	    case PM_TYPE_U32:
+	    case PM_TYPE_U64:
+		values[n] = (double)bits;
+		break;
+	    default:	/* PM_TYPE_FLOAT, PM_TYPE_DOUBLE */
+		memcpy(&values[n], &bits, sizeof(bits));
+		break;
+	}
+	n++;
+    }
+    free(buf);
+    return n;
+
+fail:
+    free(buf);
+    return sts;
+}
+
+/*
+ * Values of column c from start to end inclusive (either NULL for no
+ * limit), as contiguous arrays of times (seconds since the epoch) and
+ * values (converted to double) that the caller must free().  Returns
+ * the number of values, and only blocks overlapping the time window
+ * are read.
+ */
+int
+__pmLogColumnsRead(__pmLogColumns *cp, int c, const __pmTimestamp *start,
+		const __pmTimestamp *end, double **timesp, double **valuesp)
+{
+    column_t	*col;
+    colblock_t	*bp;
+    double	*times = NULL;
+    double	*values = NULL;
+    size_t	max = 0;
+    int		n = 0;
+    int		b;
+    int		sts;
+
+    if (cp->writing || c < 0 || c >= cp->ncol)
+	return -EINVAL;
+    col = &cp->col[c];
+
+    for (b = 0; b < col->nblock; b++) {
+	bp = &col->block[b];
+	if ((start && __pmTimestampSub(&bp->last, start) < 0) ||
+	    (end && __pmTimestampSub(&bp->first, end) > 0))
+	    continue;
+	max += bp->count;
+    }
+    if (max > 0 &&
+	((times = (double *)malloc(max * sizeof(double))) == NULL ||
+	 (values = (double *)malloc(max * sizeof(double))) == NULL)) {
+	pmNoMem("__pmLogColumnsRead", max * sizeof(double), PM_RECOV_ERR);
+	free(times);
+	return -ENOMEM;
+    }
+    for (b = 0; b < col->nblock; b++) {
+	bp = &col->block[b];
+	if ((start && __pmTimestampSub(&bp->last, start) < 0) ||
+	    (end && __pmTimestampSub(&bp->first, end) > 0))
+	    continue;
+	if ((sts = decode_block(cp, col, bp, start, end, &times[n], &values[n])) < 0) {
+	    free(times);
+	    free(values);
+	    return sts;
+	}
+	n += sts;
+    }
+    *timesp = times;
+    *valuesp = values;
+    return n;
+}
+
+/*
+ * Finish a columns file being written (returning any error from
+ * writing the last blocks and the directory), or close one being read
+ */
+int
+__pmLogColumnsClose(__pmLogColumns *cp)
+{
+    int		sts = 0;
+    int		c;
+
+    if (cp->writing && cp->f != NULL)
+	sts = write_directory(cp);
+    if (cp->f != NULL && fclose(cp->f) != 0 && sts == 0)
+	sts = -oserror();
+    for (c = 0; c < cp->ncol; c++) {
+	free(cp->col[c].cd.name);
+	free(cp->col[c].cd.iname);
+	free(cp->col[c].block);
+	free(cp->col[c].ts.buf);
+	free(cp->col[c].val.buf);
+    }
+    free(cp->col);
+    free(cp->hostname);
+    free(cp->timezone);
+    free(cp);
+    return sts;
+}
@@ -0,0 +1,902 @@
+/*
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * Delta encoded archive data records.
+ *
+ * In an archive with PM_LOG_FEATURE_DELTA set in the label, a data
+ * record may encode its values relative to an earlier ordinary record
+ * (the reference record) in the same volume that has exactly the same
+ * list of PMIDs, which is the usual case for the records pmlogger writes
+ * for one logging group.  On disk a delta encoded record is ...
+ *
+ *	len, timestamp (2 words), PM_LOG_DELTA_MARK, bytes back to the
+ *	start of the reference record, numpmid, payload bytes, payload
+ *	(padded to a word boundary), len
+ *
+ * and the payload is, for each pmValueSet, numval (zigzag varint) and
+ * if numval > 0, a flags byte (valfmt, and whether the instances are
+ * the same as the reference record's), the instances as a list of edits
+ * to the reference record's instances if they are not, then the values.
+ * Each value is compared to the value for the same instance in the
+ * reference record: insitu values and 64-bit integers are zigzag varint
+ * deltas, doubles are the XOR of the two values with leading and
+ * trailing zero bytes dropped, and any other pmValueBlock is copied.  The type and length of a pmValueBlock
+ * are a single zero byte when they match the reference value.
+ *
+ * Because every delta encoded record depends only on its reference
+ * record (and not on the record before it), reading in either direction
+ * and positioning from the temporal index need at most one extra record
+ * read, and the last few reference records are cached.  The old record
+ * decoders reject the negative numpmid of PM_LOG_DELTA_MARK.
+ *
+ * Thread-safe notes
+ *
+ * - the encoding and decoding state hangs off the __pmArchCtl, which is
+ *   only used with the context lock held when reading, and by one thread
+ *   at a time when writing
+ */
+
+#include "pmapi.h"
+#include "libpcp.h"
+#include "internal.h"
+
+#define DELTA_NREF	4	/* reference records cached */
+#define DELTA_MAXREC	32	/* delta records per reference record */
+#define DELTA_SAME	0x4	/* flags: instances as in reference record */
+#define DELTA_WINDOW	16	/* instances searched in reference record */
+#define DELTA_HDR	4	/* words after the timestamp in the record */
+
+/* instance edits, (count << 2) | op */
+#define DELTA_COPY	0	/* next count reference record instances */
+#define DELTA_SKIP	1	/* skip count reference record instances */
+#define DELTA_NEW	2	/* count new instances follow */
+
+typedef struct {
+    __pmFILE	*f;		/* file holding the reference record ... */
+    long	off;		/* ... and its offset, -1 if slot is free */
+    int		vol;		/* (writing) volume */
+    int		nrec;		/* (writing) delta records encoded with this */
+    unsigned	lru;
+    __uint32_t	sig;		/* (writing) hash of the PMID list */
+    int		numpmid;
+    int		*vl;		/* word index of each vlist in pdu[] */
+    int		maxvl;
+    __pmPDU	*pdu;		/* record in PDU_RESULT format */
+    size_t	maxpdu;
+} ref_t;
+
+typedef struct {
+    ref_t	ref[DELTA_NREF];
+    unsigned	clock;
+    int		*vl;		/* (writing) vlist index of current record */
+    int		maxvl;
+    int		*rj;		/* reference value index for each value */
+    size_t	maxrj;
+    __pmPDU	*buf;		/* encoded record or decoded vlists ... */
+    size_t	maxbuf;
+    __pmPDU	*vb;		/* ... and decoded pmValueBlocks */
+    size_t	maxvb;
+} delta_t;
+
+static delta_t *
+delta_get(__pmArchCtl *acp)
+{
+    delta_t	*dp;
+    int		i;
+
+    if (acp->ac_delta != NULL)
+	return (delta_t *)acp->ac_delta;
+    if ((dp = (delta_t *)calloc(1, sizeof(delta_t))) == NULL) {
+	pmNoMem("__pmLogDelta", sizeof(delta_t), PM_RECOV_ERR);
+	return NULL;
+    }
+    for (i = 0; i < DELTA_NREF; i++)
+	dp->ref[i].off = -1;
+    acp->ac_delta = dp;
+    return dp;
+}
+
+static int
+grow(void **pp, size_t *maxp, size_t need)
+{
+    void	*tmp;
+    size_t	want;
+
+    if (need <= *maxp)
+	return 0;
+    want = *maxp ? *maxp : 1024;
+    while (want < need)
+	want *= 2;
+    if ((tmp = realloc(*pp, want)) == NULL) {
+	pmNoMem("__pmLogDelta", want, PM_RECOV_ERR);
+	return -ENOMEM;
+    }
+    *pp = tmp;
+    *maxp = want;
+    return 0;
+}
+
+static unsigned char *
+put_varint(unsigned char *p, __uint64_t v)
+{
+    while (v >= 0x80) {
+	*p++ = (v & 0x7f) | 0x80;
+	v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+static inline const unsigned char *
+get_varint(const unsigned char *p, const unsigned char *end, __uint64_t *vp)
+{
+    __uint64_t	v = 0;
+    int		shift;
+
+    if (p < end && *p < 0x80) {
+	/* the common case, a small value or delta */
+	*vp = *p;
+	return p + 1;
+    }
+    for (shift = 0; p < end && shift < 64; shift += 7) {
+	v |= (__uint64_t)(*p & 0x7f) << shift;
+	if ((*p++ & 0x80) == 0) {
+	    *vp = v;
+	    return p;
+	}
+    }
+    return NULL;
+}
+
+static __uint64_t
+zigzag(__int64_t v)
+{
+    return ((__uint64_t)v << 1) ^ (__uint64_t)(v >> 63);
+}
+
+static __int64_t
+unzigzag(__uint64_t v)
+{
+    return (__int64_t)(v >> 1) ^ -(__int64_t)(v & 1);
+}
+
+static inline __uint64_t
+get_be64(const void *vp)
+{
+    __uint32_t	w[2];
+
+    memcpy(w, vp, sizeof(w));
+    return ((__uint64_t)ntohl(w[0]) << 32) | ntohl(w[1]);
+}
+
+static inline void
+put_be64(void *vp, __uint64_t v)
+{
+    __uint32_t	w[2];
+
+    w[0] = htonl((__uint32_t)(v >> 32));
+    w[1] = htonl((__uint32_t)v);
+    memcpy(vp, w, sizeof(w));
+}
+
+/* vtype and vlen from a pmValueBlock header in network byte order */
+static void
+vb_hdr(__pmPDU w, int *vtype, int *vlen)
+{
+    pmValueBlock	vb;
+    __uint32_t		h = ntohl(w);
+
+    memcpy(&vb, &h, sizeof(h));
+    *vtype = vb.vtype;
+    *vlen = vb.vlen;
+}
+
+static __pmPDU
+vb_mkhdr(int vtype, int vlen)
+{
+    pmValueBlock	vb;
+    __uint32_t		h;
+
+    memset(&vb, 0, sizeof(vb));
+    vb.vtype = vtype;
+    vb.vlen = vlen;
+    memcpy(&h, &vb, sizeof(h));
+    return htonl(h);
+}
+
+/*
+ * Index the vlists of a record in PDU_RESULT format (len bytes),
+ * checking it is sane enough to encode or decode with.
+ * Returns numpmid, or < 0 for a corrupt record.
+ */
+static int
+index_vlists(const __pmPDU *pdu, int len, int **vlp, int *maxvlp)
+{
+    int		nw = len / sizeof(__pmPDU);
+    int		numpmid, numval, valfmt;
+    int		i, j, w, idx;
+    int		vtype, vlen;
+    size_t	max;
+
+    if (nw < 6)
+	return PM_ERR_LOGREC;
+    numpmid = ntohl(pdu[5]);
+    if (numpmid < 0 || numpmid > nw)
+	return PM_ERR_LOGREC;
+    max = *maxvlp * sizeof(int);
+    if (grow((void **)vlp, &max, numpmid * sizeof(int)) < 0)
+	return -ENOMEM;
+    *maxvlp = max / sizeof(int);
+
+    for (i = 0, w = 6; i < numpmid; i++) {
+	if (w + 2 > nw)
+	    return PM_ERR_LOGREC;
+	(*vlp)[i] = w;
+	numval = ntohl(pdu[w+1]);
+	if (numval <= 0) {
+	    w += 2;
+	    continue;
+	}
+	if (numval > nw || w + 3 + 2 * numval > nw)
+	    return PM_ERR_LOGREC;
+	valfmt = ntohl(pdu[w+2]);
+	if (valfmt == PM_VAL_DPTR || valfmt == PM_VAL_SPTR) {
+	    for (j = 0; j < numval; j++) {
+		idx = ntohl(pdu[w+4+2*j]);
+		if (idx < 6 || idx >= nw)
+		    return PM_ERR_LOGREC;
+		vb_hdr(pdu[idx], &vtype, &vlen);
+		if (vlen < PM_VAL_HDR_SIZE || idx * sizeof(__pmPDU) + vlen > len)
+		    return PM_ERR_LOGREC;
+	    }
+	}
+	else if (valfmt != PM_VAL_INSITU)
+	    return PM_ERR_LOGREC;
+	w += 3 + 2 * numval;
+    }
+    return numpmid;
+}
+
+static __uint32_t
+signature(const __pmPDU *pdu, const int *vl, int numpmid)
+{
+    __uint32_t	sig = numpmid;
+    int		i;
+
+    for (i = 0; i < numpmid; i++)
+	sig = sig * 31 + (__uint32_t)pdu[vl[i]];
+    return sig;
+}
+
+/*
+ * Match the instances of vlist vp with those of the reference vlist rvl,
+ * setting rj[j] to the index of the reference value for value j (or -1),
+ * and encode the instances as edits to the reference instances.  Values
+ * are almost always in the same order from one record to the next, so
+ * only DELTA_WINDOW reference instances are searched for each instance.
+ */
+static unsigned char *
+put_insts(unsigned char *p, const __pmPDU *vp, int numval,
+	const __pmPDU *rvl, int rnumval, int *rj)
+{
+    __int32_t	inst, previnst;
+    int		j, k, r, rpos, last;
+
+    for (j = 0, rpos = 0; j < numval; j++) {
+	rj[j] = -1;
+	last = rpos + DELTA_WINDOW;
+	if (last > rnumval)
+	    last = rnumval;
+	for (r = rpos; r < last; r++) {
+	    if (rvl[3+2*r] == vp[3+2*j]) {
+		rj[j] = r;
+		rpos = r + 1;
+		break;
+	    }
+	}
+    }
+
+    for (j = 0, rpos = 0; j < numval; j += k) {
+	if (rj[j] < 0) {
+	    for (k = 1; j + k < numval && rj[j+k] < 0; k++)
+		;
+	    p = put_varint(p, ((__uint64_t)k << 2) | DELTA_NEW);
+	    previnst = j > 0 ? ntohl(vp[3+2*(j-1)]) : 0;
+	    for (r = j; r < j + k; r++) {
+		inst = ntohl(vp[3+2*r]);
+		p = put_varint(p, zigzag((__int64_t)inst - previnst));
+		previnst = inst;
+	    }
+	    continue;
+	}
+	if (rj[j] > rpos)
+	    p = put_varint(p, ((__uint64_t)(rj[j] - rpos) << 2) | DELTA_SKIP);
+	rpos = rj[j];
+	for (k = 1; j + k < numval && rj[j+k] == rpos + k; k++)
+	    ;
+	p = put_varint(p, ((__uint64_t)k << 2) | DELTA_COPY);
+	rpos += k;
+    }
+    return p;
+}
+
+/* the reverse of put_insts() */
+static const unsigned char *
+get_insts(const unsigned char *p, const unsigned char *end, __pmPDU *vp,
+	int numval, const __pmPDU *rvl, int rnumval, int *rj)
+{
+    __uint64_t	x, v;
+    __int32_t	inst;
+    int		j, k, r, rpos;
+
+    for (j = 0, rpos = 0; j < numval; ) {
+	if ((p = get_varint(p, end, &x)) == NULL)
+	    return NULL;
+	if ((x >> 2) < 1 || (x >> 2) > 0x7fffffff)
+	    return NULL;
+	k = (int)(x >> 2);
+	switch ((int)(x & 0x3)) {
+	    case DELTA_COPY:
+		if (j + k > numval || rpos + k > rnumval)
+		    return NULL;
+		for (r = 0; r < k; r++, j++, rpos++) {
+		    vp[3+2*j] = rvl[3+2*rpos];
+		    rj[j] = rpos;
+		}
+		break;
+	    case DELTA_SKIP:
+		if (rpos + k > rnumval)
+		    return NULL;
+		rpos += k;
+		break;
+	    case DELTA_NEW:
+		if (j + k > numval)
+		    return NULL;
+		inst = j > 0 ? ntohl(vp[3+2*(j-1)]) : 0;
+		for (r = 0; r < k; r++, j++) {
+		    if ((p = get_varint(p, end, &v)) == NULL)
+			return NULL;
+		    inst = (__int32_t)(inst + unzigzag(v));
+		    vp[3+2*j] = htonl(inst);
+		    rj[j] = -1;
+		}
+		break;
+	    default:
+		return NULL;
+	}
+    }
+    return p;
+}
+
+static int
+ref_slot(delta_t *dp, __pmFILE *f, long off)
+{
+    int		i, k = 0;
+
+    for (i = 0; i < DELTA_NREF; i++) {
+	if (dp->ref[i].off == off && dp->ref[i].f == f && off >= 0)
+	    return i;
+    }
+    /* not cached, choose a free or the least recently used slot */
+    for (i = 0; i < DELTA_NREF; i++) {
+	if (dp->ref[i].off < 0)
+	    return -1 - i;
+	if (dp->ref[i].lru < dp->ref[k].lru)
+	    k = i;
+    }
+    return -1 - k;
+}
+
+/* copy a record (PDU_RESULT format) into a reference slot */
+static int
+ref_set(delta_t *dp, int k, __pmFILE *f, long off, const __pmPDU *pdu)
+{
+    ref_t	*rp = &dp->ref[k];
+    int		len = pdu[0];
+
+    rp->off = -1;
+    if (grow((void **)&rp->pdu, &rp->maxpdu, len) < 0)
+	return -ENOMEM;
+    memcpy(rp->pdu, pdu, len);
+    if ((rp->numpmid = index_vlists(rp->pdu, len, &rp->vl, &rp->maxvl)) < 0)
+	return rp->numpmid;
+    rp->f = f;
+    rp->off = off;
+    rp->nrec = 0;
+    rp->lru = ++dp->clock;
+    return 0;
+}
+
+/*
+ * Encode the pmValueSets of the record cur (PDU_RESULT format, with vlist
+ * index vl) relative to reference record rp, into buf.  Returns bytes used.
+ */
+static size_t
+encode(const ref_t *rp, const __pmPDU *cur, const int *vl, int numpmid,
+	int *rjv, unsigned char *buf)
+{
+    unsigned char	*p = buf;
+    const __pmPDU	*vp, *rvl;
+    const __pmPDU	*vb, *rvb;
+    int			i, j, rj;
+    int			numval, rnumval, valfmt, rvalfmt;
+    int			same, vtype, vlen, idx;
+    __uint32_t		lval, rlval;
+    __uint64_t		v, rv, x;
+    int			lead, trail, n;
+
+    for (i = 0; i < numpmid; i++) {
+	vp = &cur[vl[i]];
+	rvl = &rp->pdu[rp->vl[i]];
+	numval = ntohl(vp[1]);
+	p = put_varint(p, zigzag(numval));
+	if (numval <= 0)
+	    continue;
+	valfmt = ntohl(vp[2]);
+	rnumval = ntohl(rvl[1]);
+	if (rnumval < 0)
+	    rnumval = 0;
+	rvalfmt = rnumval > 0 ? ntohl(rvl[2]) : -1;
+	same = (rnumval == numval);
+	for (j = 0; same && j < numval; j++) {
+	    if (vp[3+2*j] != rvl[3+2*j])
+		same = 0;
+	}
+	*p++ = valfmt | (same ? DELTA_SAME : 0);
+	if (!same)
+	    p = put_insts(p, vp, numval, rvl, rnumval, rjv);
+	for (j = 0; j < numval; j++) {
+	    rj = same ? j : rjv[j];
+	    if (valfmt == PM_VAL_INSITU) {
+		lval = ntohl(vp[4+2*j]);
+		rlval = (rj >= 0 && rvalfmt == PM_VAL_INSITU) ?
+			ntohl(rvl[4+2*rj]) : 0;
+		p = put_varint(p, zigzag((__int32_t)(lval - rlval)));
+		continue;
+	    }
+	    idx = ntohl(vp[4+2*j]);
+	    vb = &cur[idx];
+	    vb_hdr(vb[0], &vtype, &vlen);
+	    rvb = NULL;
+	    if (rj >= 0 && rvalfmt != PM_VAL_INSITU && rvalfmt != -1) {
+		rvb = &rp->pdu[ntohl(rvl[4+2*rj])];
+		if (rvb[0] != vb[0])
+		    rvb = NULL;
+	    }
+	    /* 0 for the same type and length as the reference value */
+	    if (rvb != NULL)
+		*p++ = 0;
+	    else {
+		p = put_varint(p, vtype + 1);
+		p = put_varint(p, vlen);
+	    }
+	    if (vlen == PM_VAL_HDR_SIZE + 8 &&
+		(vtype == PM_TYPE_64 || vtype == PM_TYPE_U64)) {
+		v = get_be64(&vb[1]);
+		rv = rvb ? get_be64(&rvb[1]) : 0;
+		p = put_varint(p, zigzag((__int64_t)(v - rv)));
+	    }
+	    else if (vlen == PM_VAL_HDR_SIZE + 8 && vtype == PM_TYPE_DOUBLE) {
+		v = get_be64(&vb[1]);
+		rv = rvb ? get_be64(&rvb[1]) : 0;
+		if ((x = v ^ rv) == 0) {
+		    *p++ = 0;
+		    continue;
+		}
+		for (lead = 0; (x >> (56 - 8 * lead)) == 0; lead++)
+		    ;
+		for (trail = 0; ((x >> (8 * trail)) & 0xff) == 0; trail++)
+		    ;
+		n = 8 - lead - trail;
+		*p++ = (n << 4) | trail;
+		for (x >>= 8 * trail; n > 0; n--) {
+		    *p++ = (x >> (8 * (n - 1))) & 0xff;
+		}
+	    }
+	    else {
+		memcpy(p, &vb[1], vlen - PM_VAL_HDR_SIZE);
+		p += vlen - PM_VAL_HDR_SIZE;
+	    }
+	}
+    }
+    return p - buf;
+}
+
+/*
+ * Called for each data record written to an archive with
+ * PM_LOG_FEATURE_DELTA in the label.  If the record pb (PDU_RESULT
+ * format) can be delta encoded, build the external record in *out and
+ * return its length, else return 0 to write pb as is (it may become a
+ * reference record for later records).
+ */
+int
+__pmLogDeltaEncode(__pmArchCtl *acp, __pmPDU *pb, __pmPDU **out)
+{
+    delta_t		*dp;
+    ref_t		*rp = NULL;
+    long		off;
+    int			numpmid;
+    int			len = pb[0];
+    int			i, k;
+    int			rlen, nbytes;
+    __uint32_t		sig;
+
+    if (len < 6 * (int)sizeof(__pmPDU) || (int)ntohl(pb[5]) <= 0)
+	return 0;		/* <mark> record */
+    if ((dp = delta_get(acp)) == NULL)
+	return 0;
+    if ((off = __pmFtell(acp->ac_mfp)) < 0)
+	return 0;
+    if ((numpmid = index_vlists(pb, len, &dp->vl, &dp->maxvl)) <= 0)
+	return 0;
+    sig = signature(pb, dp->vl, numpmid);
+
+    for (k = 0; k < DELTA_NREF; k++) {
+	rp = &dp->ref[k];
+	if (rp->off < 0 || rp->vol != acp->ac_curvol || rp->f != acp->ac_mfp ||
+	    rp->sig != sig || rp->numpmid != numpmid)
+	    continue;
+	for (i = 0; i < numpmid; i++) {
+	    if (rp->pdu[rp->vl[i]] != pb[dp->vl[i]])
+		break;
+	}
+	if (i == numpmid)
+	    break;
+    }
+
+    if (k < DELTA_NREF && rp->nrec < DELTA_MAXREC && off > rp->off) {
+	/*
+	 * worst case encoding is less than twice the size of the record,
+	 * and there are fewer than len / 8 values in any pmValueSet
+	 */
+	if (grow((void **)&dp->buf, &dp->maxbuf, 2 * len + 64) < 0 ||
+	    grow((void **)&dp->rj, &dp->maxrj, (len / 8) * sizeof(int)) < 0)
+	    return 0;
+	nbytes = encode(rp, pb, dp->vl, numpmid, dp->rj,
+			(unsigned char *)&dp->buf[1 + 2 + DELTA_HDR]);
+	rlen = (1 + 2 + DELTA_HDR + 1) * sizeof(__pmPDU) + PM_PDU_SIZE_BYTES(nbytes);
+	if (rlen < len - (int)sizeof(__pmPDUHdr) + 2 * (int)sizeof(__pmPDU)) {
+	    /* clear the padding bytes, lest they contain garbage */
+	    memset((char *)&dp->buf[1 + 2 + DELTA_HDR] + nbytes, '~',
+			PM_PDU_SIZE_BYTES(nbytes) - nbytes);
+	    dp->buf[0] = htonl(rlen);
+	    dp->buf[1] = pb[3];		/* timestamp */
+	    dp->buf[2] = pb[4];
+	    dp->buf[3] = htonl(PM_LOG_DELTA_MARK);
+	    dp->buf[4] = htonl(off - rp->off);
+	    dp->buf[5] = htonl(numpmid);
+	    dp->buf[6] = htonl(nbytes);
+	    dp->buf[rlen / sizeof(__pmPDU) - 1] = dp->buf[0];
+	    rp->nrec++;
+	    rp->lru = ++dp->clock;
+	    *out = dp->buf;
+	    return rlen;
+	}
+    }
+
+    /* written as is, and becomes a reference record */
+    if (k == DELTA_NREF)
+	k = -1 - ref_slot(dp, NULL, -1);
+    if (ref_set(dp, k, acp->ac_mfp, off, pb) < 0)
+	return 0;
+    dp->ref[k].vol = acp->ac_curvol;
+    dp->ref[k].sig = sig;
+    return 0;
+}
+
+/*
+ * Reading ... keep a copy of an ordinary record at offset off in f that
+ * later delta encoded records may refer to
+ */
+void
+__pmLogDeltaRemember(__pmArchCtl *acp, __pmFILE *f, long off, __pmPDU *pb)
+{
+    delta_t	*dp;
+    int		k;
+
+    if (pb[0] < 6 * (int)sizeof(__pmPDU) || (int)ntohl(pb[5]) <= 0)
+	return;
+    if ((dp = delta_get(acp)) == NULL)
+	return;
+    if ((k = ref_slot(dp, f, off)) >= 0) {
+	dp->ref[k].lru = ++dp->clock;
+	return;
+    }
+    ref_set(dp, -1 - k, f, off, pb);
+}
+
+/* read the reference record at offset off in f into slot k */
+static int
+ref_read(delta_t *dp, int k, __pmFILE *f, long off)
+{
+    ref_t	*rp = &dp->ref[k];
+    long	save;
+    int		head, trail;
+    int		rlen;
+    int		sts = PM_ERR_LOGREC;
+
+    rp->off = -1;
+    if ((save = __pmFtell(f)) < 0)
+	return -oserror();
+    if (__pmFseek(f, off, SEEK_SET) < 0)
+	return -oserror();
+    if (__pmFread(&head, 1, sizeof(head), f) != sizeof(head))
+	goto done;
+    head = ntohl(head);
+    rlen = head - 2 * (int)sizeof(head);
+    if (rlen < 3 * (int)sizeof(__pmPDU))
+	goto done;
+    if (grow((void **)&rp->pdu, &rp->maxpdu, rlen + sizeof(__pmPDUHdr)) < 0) {
+	sts = -ENOMEM;
+	goto done;
+    }
+    if (__pmFread(&rp->pdu[3], 1, rlen, f) != rlen ||
+	__pmFread(&trail, 1, sizeof(trail), f) != sizeof(trail) ||
+	ntohl(trail) != head)
+	goto done;
+    rp->pdu[0] = rlen + sizeof(__pmPDUHdr);
+    rp->pdu[1] = PDU_RESULT;
+    rp->pdu[2] = FROM_ANON;
+    if ((int)ntohl(rp->pdu[5]) <= 0)	/* <mark> or delta encoded */
+	goto done;
+    if ((sts = index_vlists(rp->pdu, rp->pdu[0], &rp->vl, &rp->maxvl)) < 0)
+	goto done;
+    rp->numpmid = sts;
+    rp->f = f;
+    rp->off = off;
+    rp->lru = ++dp->clock;
+    sts = 0;
+
+done:
+    __pmClearerr(f);
+    __pmFseek(f, save, SEEK_SET);
+    if (sts < 0 && pmDebugOptions.log)
+	fprintf(stderr, "__pmLogDeltaDecode: bad reference record at offset %ld\n", off);
+    return sts;
+}
+
+/*
+ * Decode the delta encoded record *pbp (PDU_RESULT format, read from
+ * offset off in f) relative to its reference record, replacing *pbp
+ * with a new pinned PDU buffer holding the ordinary record
+ */
+int
+__pmLogDeltaDecode(__pmArchCtl *acp, __pmFILE *f, long off, __pmPDU **pbp)
+{
+    __pmPDU		*pb = *pbp;
+    __pmPDU		*npb;
+    __pmPDU		*vl, *vp;
+    const __pmPDU	*rvl, *rvb;
+    const unsigned char	*p, *end;
+    delta_t		*dp;
+    ref_t		*rp;
+    long		back;
+    size_t		maxvl, vln, vbn;
+    int			numpmid, nbytes;
+    int			i, j, k, rj, w, base;
+    int			numval, rnumval, valfmt, rvalfmt, flags;
+    int			vtype, vlen, n, trail;
+    __uint32_t		rlval;
+    __uint64_t		v, rv;
+    __pmPDU		hdr;
+    int			sts;
+
+    if (pb[0] < (3 + 2 + DELTA_HDR) * (int)sizeof(__pmPDU))
+	return PM_ERR_LOGREC;
+    back = ntohl(pb[6]);
+    numpmid = ntohl(pb[7]);
+    nbytes = ntohl(pb[8]);
+    if (back <= 0 || back > off || nbytes < 0 ||
+	nbytes > pb[0] - (3 + 2 + DELTA_HDR) * (int)sizeof(__pmPDU))
+	return PM_ERR_LOGREC;
+    if ((dp = delta_get(acp)) == NULL)
+	return -ENOMEM;
+    if ((k = ref_slot(dp, f, off - back)) < 0) {
+	k = -1 - k;
+	if ((sts = ref_read(dp, k, f, off - back)) < 0)
+	    return sts;
+    }
+    rp = &dp->ref[k];
+    rp->lru = ++dp->clock;
+    if (rp->numpmid != numpmid)
+	return PM_ERR_LOGREC;
+
+    p = (const unsigned char *)&pb[3 + 2 + DELTA_HDR];
+    end = p + nbytes;
+    vln = vbn = 0;
+    for (i = 0; i < numpmid; i++) {
+	rvl = &rp->pdu[rp->vl[i]];
+	if ((p = get_varint(p, end, &v)) == NULL)
+	    return PM_ERR_LOGREC;
+	numval = (int)unzigzag(v);
+	if (numval > 0 && numval > end - p)
+	    return PM_ERR_LOGREC;
+	maxvl = dp->maxbuf;
+	if (grow((void **)&dp->buf, &maxvl,
+		(vln + 3 + 2 * (numval > 0 ? numval : 0)) * sizeof(__pmPDU)) < 0)
+	    return -ENOMEM;
+	dp->maxbuf = maxvl;
+	vl = dp->buf;
+	vl[vln++] = rvl[0];		/* pmid */
+	vl[vln++] = htonl(numval);
+	if (numval <= 0)
+	    continue;
+	if (p >= end)
+	    return PM_ERR_LOGREC;
+	flags = *p++;
+	valfmt = flags & 0x3;
+	if (valfmt != PM_VAL_INSITU && valfmt != PM_VAL_DPTR &&
+	    valfmt != PM_VAL_SPTR)
+	    return PM_ERR_LOGREC;
+	vl[vln++] = htonl(valfmt);
+	vp = &vl[vln - 3];
+	rnumval = ntohl(rvl[1]);
+	if (rnumval < 0)
+	    rnumval = 0;
+	rvalfmt = rnumval > 0 ? ntohl(rvl[2]) : -1;
+	if (flags & DELTA_SAME) {
+	    if (rnumval != numval)
+		return PM_ERR_LOGREC;
+	    for (j = 0; j < numval; j++)
+		vp[3+2*j] = rvl[3+2*j];
+	}
+	else {
+	    if (numval * sizeof(int) > dp->maxrj &&
+		grow((void **)&dp->rj, &dp->maxrj, numval * sizeof(int)) < 0)
+		return -ENOMEM;
+	    p = get_insts(p, end, vp, numval, rvl, rnumval, dp->rj);
+	    if (p == NULL)
+		return PM_ERR_LOGREC;
+	}
+	vln += 2 * numval;
+	for (j = 0; j < numval; j++) {
+	    rj = (flags & DELTA_SAME) ? j : dp->rj[j];
+	    if ((p = get_varint(p, end, &v)) == NULL)
+		return PM_ERR_LOGREC;
+	    if (valfmt == PM_VAL_INSITU) {
+		rlval = (rj >= 0 && rvalfmt == PM_VAL_INSITU) ?
+			ntohl(rvl[4+2*rj]) : 0;
+		vp[4+2*j] = htonl(rlval + (__uint32_t)unzigzag(v));
+		continue;
+	    }
+	    /* pmValueBlock, v is 0 or vtype + 1 */
+	    rvb = NULL;
+	    if (rj >= 0 && rvalfmt != PM_VAL_INSITU && rvalfmt != -1)
+		rvb = &rp->pdu[ntohl(rvl[4+2*rj])];
+	    if (v == 0) {
+		/* same type and length as the reference value */
+		if (rvb == NULL)
+		    return PM_ERR_LOGREC;
+		hdr = rvb[0];
+		vb_hdr(hdr, &vtype, &vlen);
+	    }
+	    else {
+		if (v > 0x100)
+		    return PM_ERR_LOGREC;
+		vtype = (int)(v - 1);
+		if ((p = get_varint(p, end, &v)) == NULL)
+		    return PM_ERR_LOGREC;
+		if (v > 0xffffff || v < PM_VAL_HDR_SIZE)
+		    return PM_ERR_LOGREC;
+		vlen = (int)v;
+		hdr = vb_mkhdr(vtype, vlen);
+		if (rvb != NULL && rvb[0] != hdr)
+		    rvb = NULL;
+	    }
+	    if ((vbn + PM_PDU_SIZE(vlen)) * sizeof(__pmPDU) > dp->maxvb &&
+		grow((void **)&dp->vb, &dp->maxvb,
+			(vbn + PM_PDU_SIZE(vlen)) * sizeof(__pmPDU)) < 0)
+		return -ENOMEM;
+	    vp[4+2*j] = htonl(vbn);	/* relative, fixed up below */
+	    dp->vb[vbn] = hdr;
+	    if (vlen == PM_VAL_HDR_SIZE + 8 &&
+		(vtype == PM_TYPE_64 || vtype == PM_TYPE_U64)) {
+		if ((p = get_varint(p, end, &v)) == NULL)
+		    return PM_ERR_LOGREC;
+		rv = rvb ? get_be64(&rvb[1]) : 0;
+		put_be64(&dp->vb[vbn + 1], rv + (__uint64_t)unzigzag(v));
+	    }
+	    else if (vlen == PM_VAL_HDR_SIZE + 8 && vtype == PM_TYPE_DOUBLE) {
+		if (p >= end)
+		    return PM_ERR_LOGREC;
+		n = *p >> 4;
+		trail = *p++ & 0xf;
+		if (n + trail > 8 || n > end - p)
+		    return PM_ERR_LOGREC;
+		for (v = 0; n > 0; n--)
+		    v = (v << 8) | *p++;
+		rv = rvb ? get_be64(&rvb[1]) : 0;
+		put_be64(&dp->vb[vbn + 1], rv ^ (trail < 8 ? v << (8 * trail) : 0));
+	    }
+	    else {
+		if (vlen - PM_VAL_HDR_SIZE > end - p)
+		    return PM_ERR_LOGREC;
+		memcpy(&dp->vb[vbn + 1], p, vlen - PM_VAL_HDR_SIZE);
+		p += vlen - PM_VAL_HDR_SIZE;
+		/* clear the padding bytes, lest they contain garbage */
+		memset((char *)&dp->vb[vbn] + vlen, '~',
+			PM_PDU_SIZE_BYTES(vlen) - vlen);
+	    }
+	    vbn += PM_PDU_SIZE(vlen);
+	}
+    }
+    if (p != end)
+	return PM_ERR_LOGREC;
+
+    /* reassemble as an ordinary record, with room for a trailer */
+    base = 6 + vln;
+    n = (base + vbn) * sizeof(__pmPDU);
+    if ((npb = __pmFindPDUBuf(n + sizeof(int))) == NULL)
+	return -oserror();
+    npb[0] = n;
+    npb[1] = PDU_RESULT;
+    npb[2] = FROM_ANON;
+    npb[3] = pb[3];
+    npb[4] = pb[4];
+    npb[5] = htonl(numpmid);
+    if (vln > 0)
+	memcpy(&npb[6], dp->buf, vln * sizeof(__pmPDU));
+    if (vbn > 0)
+	memcpy(&npb[base], dp->vb, vbn * sizeof(__pmPDU));
+    for (i = 0, w = 6; i < numpmid; i++) {
+	numval = ntohl(npb[w+1]);
+	if (numval <= 0) {
+	    w += 2;
+	    continue;
+	}
+	if (ntohl(npb[w+2]) != PM_VAL_INSITU) {
+	    for (j = 0; j < numval; j++)
+		npb[w+4+2*j] = htonl(ntohl(npb[w+4+2*j]) + base);
+	}
+	w += 3 + 2 * numval;
+    }
+
+    __pmUnpinPDUBuf(pb);
+    *pbp = npb;
+    return 0;
+}
+
+/*
+ * Forget the cached reference records, e.g. when changing volumes
+ */
+void
+__pmLogDeltaReset(__pmArchCtl *acp)
+{
+    delta_t	*dp = (delta_t *)acp->ac_delta;
+    int		i;
+
+    if (dp == NULL)
+	return;
+    for (i = 0; i < DELTA_NREF; i++)
+	dp->ref[i].off = -1;
+}
+
+void
+__pmLogDeltaFree(__pmArchCtl *acp)
+{
+    delta_t	*dp = (delta_t *)acp->ac_delta;
+    int		i;
+
+    if (dp == NULL)
+	return;
+    for (i = 0; i < DELTA_NREF; i++) {
+	free(dp->ref[i].vl);
+	free(dp->ref[i].pdu);
+    }
+    free(dp->vl);
+    free(dp->rj);
+    free(dp->buf);
+    free(dp->vb);
+    free(dp);
+    acp->ac_delta = NULL;
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * Archive record pipeline for tools that rewrite an archive one record
+ * at a time (pmlogrewrite, pmlogreduce).
+ *
+ * A reader thread reads the data volumes of an archive context forwards,
+ * cutting the records into chunks that never span a volume boundary.
+ * Worker threads apply the caller's transform to whole chunks, and the
+ * caller collects the records, still in archive order, so it remains
+ * the single (ordered) writer of the output archive and can interleave
+ * metadata exactly as before.  A transform that fails leaves its error
+ * in the record's sts, which the caller receives in order like any
+ * read error, so the caller (not a worker) decides how to give up.
+ *
+ * With no workers there are no threads at all, and chunks are read and
+ * transformed synchronously from __pmLogPipeNext().
+ *
+ * Thread-safe notes
+ *
+ * - all pipeline state is private to one __pmLogPipe and protected by
+ *   its lock, except the records in a chunk which are owned by exactly
+ *   one of the reader, a worker or the caller at any time (see the
+ *   slot state)
+ * - the archive context is only read while holding its c_lock, so the
+ *   caller may use other libpcp services on the context concurrently,
+ *   but must not read the data volumes itself
+ */
+
+#include "pmapi.h"
+#include "libpcp.h"
+#include "internal.h"
+
+#define PIPE_CHUNK	64	/* default records per chunk */
+
+#define SLOT_EMPTY	0	/* free for the reader */
+#define SLOT_READ	1	/* filled, waiting for a worker */
+#define SLOT_BUSY	2	/* being transformed */
+#define SLOT_DONE	3	/* ready for the caller */
+
+typedef struct {
+    int			state;
+    int			nrec;
+    __pmLogPipeRec	*rec;
+} pipeslot_t;
+
+struct __pmLogPipe {
+    __pmContext		*ctxp;
+    __pmLogPipeFn	fn;
+    void		*arg;
+    int			nworker;
+    int			chunk;		/* max records per slot */
+    int			nslot;
+    pipeslot_t		*slot;
+    int			rd;		/* next slot for the reader */
+    int			wk;		/* next slot for a worker */
+    int			cn;		/* current slot for the caller */
+    int			cnrec;		/* next record in slot[cn] */
+    int			ready;		/* slot[cn] known to be SLOT_DONE */
+    int			sts;		/* < 0 once the input is exhausted */
+    int			eof;		/* reader has finished */
+    int			stop;
+    int			carry;		/* next[] holds first record of a volume */
+    __pmLogPipeRec	next;
+#ifdef PM_MULTI_THREAD
+    pthread_mutex_t	lock;
+    pthread_cond_t	cond;
+    pthread_t		*thread;	/* [0] reader, then workers */
+    int			nthread;
+#endif
+};
+
+static void
+readrec(__pmLogPipe *pp, __pmLogPipeRec *rec)
+{
+    __pmArchCtl	*acp = pp->ctxp->c_archctl;
+
+    PM_LOCK(pp->ctxp->c_lock);
+    rec->offset = __pmFtell(acp->ac_mfp);
+    rec->sts = __pmLogRead_ctx(pp->ctxp, PM_MODE_FORW, NULL, &rec->rp, PMLOGREAD_NEXT);
+    rec->vol = acp->ac_curvol;
+    PM_UNLOCK(pp->ctxp->c_lock);
+    if (rec->sts < 0)
+	rec->rp = NULL;
+    rec->data = NULL;
+}
+
+/*
+ * fill a slot with the next chunk of records ... stop short at a volume
+ * change, and after an error or end of log (which is kept as the last
+ * record so the caller sees it in order)
+ */
+static void
+fillslot(__pmLogPipe *pp, pipeslot_t *sp)
+{
+    __pmLogPipeRec	*rec;
+
+    sp->nrec = 0;
+    if (pp->carry) {
+	sp->rec[sp->nrec++] = pp->next;
+	pp->carry = 0;
+    }
+    while (sp->nrec < pp->chunk) {
+	rec = &sp->rec[sp->nrec];
+	readrec(pp, rec);
+	if (rec->sts < 0) {
+	    pp->sts = rec->sts;
+	    sp->nrec++;
+	    break;
+	}
+	if (sp->nrec > 0 && rec->vol != sp->rec[0].vol) {
+	    pp->next = *rec;
+	    pp->carry = 1;
+	    break;
+	}
+	sp->nrec++;
+    }
+    if (pmDebugOptions.log)
+	fprintf(stderr, "__pmLogPipe: chunk of %d records vol=%d sts=%d\n",
+		sp->nrec, sp->rec[0].vol, pp->sts);
+}
+
+/*
+ * apply the transform to each record in a slot ... after a failure the
+ * rest of the chunk is left alone, as the caller stops at the failed
+ * record (which keeps its rp, for __pmLogPipeStop to free)
+ */
+static void
+transform(__pmLogPipe *pp, pipeslot_t *sp)
+{
+    int		i;
+    int		sts;
+
+    if (pp->fn == NULL)
+	return;
+    for (i = 0; i < sp->nrec; i++) {
+	if (sp->rec[i].sts < 0)
+	    break;
+	if ((sts = pp->fn(&sp->rec[i], pp->arg)) < 0) {
+	    sp->rec[i].sts = sts;
+	    if (pmDebugOptions.log)
+		fprintf(stderr, "__pmLogPipe: transform failed vol=%d offset=%ld: %s\n",
+			sp->rec[i].vol, sp->rec[i].offset, pmErrStr(sts));
+	    break;
+	}
+    }
+}
+
+#ifdef PM_MULTI_THREAD
+static void *
+pipereader(void *arg)
+{
+    __pmLogPipe	*pp = (__pmLogPipe *)arg;
+    pipeslot_t	*sp;
+
+    PM_LOCK(pp->lock);
+    while (!pp->stop && pp->sts >= 0) {
+	sp = &pp->slot[pp->rd];
+	if (sp->state != SLOT_EMPTY) {
+	    pthread_cond_wait(&pp->cond, &pp->lock);
+	    continue;
+	}
+	PM_UNLOCK(pp->lock);
+	fillslot(pp, sp);
+	PM_LOCK(pp->lock);
+	sp->state = pp->fn == NULL ? SLOT_DONE : SLOT_READ;
+	pp->rd = (pp->rd + 1) % pp->nslot;
+	pthread_cond_broadcast(&pp->cond);
+    }
+    pp->eof = 1;
+    pthread_cond_broadcast(&pp->cond);
+    PM_UNLOCK(pp->lock);
+    return NULL;
+}
+
+static void *
+pipeworker(void *arg)
+{
+    __pmLogPipe	*pp = (__pmLogPipe *)arg;
+    pipeslot_t	*sp;
+
+    PM_LOCK(pp->lock);
+    while (!pp->stop) {
+	sp = &pp->slot[pp->wk];
+	if (sp->state != SLOT_READ) {
+	    /* slots are filled in order, so nothing more to come */
+	    if (pp->eof && pp->wk == pp->rd)
+		break;
+	    pthread_cond_wait(&pp->cond, &pp->lock);
+	    continue;
+	}
+	sp->state = SLOT_BUSY;
+	pp->wk = (pp->wk + 1) % pp->nslot;
+	PM_UNLOCK(pp->lock);
+	transform(pp, sp);
+	PM_LOCK(pp->lock);
+	sp->state = SLOT_DONE;
+	pthread_cond_broadcast(&pp->cond);
+    }
+    PM_UNLOCK(pp->lock);
+    return NULL;
+}
+#endif
+
+/*
+ * Start a pipeline over the data volumes of the archive context ctxp,
+ * from the current position, with nworker transform threads and chunks
+ * of up to chunk records (0 for the default).  fn (may be NULL) is
+ * called for each record that was read successfully, from a worker
+ * thread, and may replace rec->rp and set rec->data; it returns 0, or
+ * a value less than zero (with rec->rp still valid) to fail the record.
+ */
+int
+__pmLogPipeStart(__pmContext *ctxp, int nworker, int chunk,
+		__pmLogPipeFn fn, void *arg, __pmLogPipe **pipep)
+{
+    __pmLogPipe	*pp;
+    int		i;
+    int		sts = 0;
+
+    if (ctxp == NULL || ctxp->c_type != PM_CONTEXT_ARCHIVE)
+	return PM_ERR_NOTARCHIVE;
+#ifndef PM_MULTI_THREAD
+    nworker = 0;
+#endif
+    if (nworker < 0)
+	nworker = 0;
+    if (chunk <= 0)
+	chunk = PIPE_CHUNK;
+
+    if ((pp = (__pmLogPipe *)calloc(1, sizeof(*pp))) == NULL)
+	return -oserror();
+    pp->ctxp = ctxp;
+    pp->fn = fn;
+    pp->arg = arg;
+    pp->nworker = nworker;
+    pp->chunk = chunk;
+    /* enough to keep every worker busy while the caller drains a chunk */
+    pp->nslot = nworker == 0 ? 1 : 2 * nworker + 2;
+    if ((pp->slot = (pipeslot_t *)calloc(pp->nslot, sizeof(pipeslot_t))) == NULL) {
+	sts = -oserror();
+	free(pp);
+	return sts;
+    }
+    for (i = 0; i < pp->nslot; i++) {
+	pp->slot[i].rec = (__pmLogPipeRec *)malloc(chunk * sizeof(__pmLogPipeRec));
+	if (pp->slot[i].rec == NULL) {
+	    sts = -oserror();
+	    goto fail;
+	}
+    }
+
+#ifdef PM_MULTI_THREAD
+    if (nworker > 0) {
+	__pmInitMutex(&pp->lock);
+	pthread_cond_init(&pp->cond, NULL);
+	if ((pp->thread = (pthread_t *)malloc((nworker + 1) * sizeof(pthread_t))) == NULL) {
+	    sts = -oserror();
+	    pthread_mutex_destroy(&pp->lock);
+	    pthread_cond_destroy(&pp->cond);
+	    goto fail;
+	}
+	/* no transform, so just the reader thread */
+	for (i = 0; i <= (fn == NULL ? 0 : nworker); i++) {
+	    sts = pthread_create(&pp->thread[i], NULL,
+			i == 0 ? pipereader : pipeworker, pp);
+	    if (sts != 0) {
+		sts = -sts;
+		break;
+	    }
+	    pp->nthread++;
+	}
+	if (sts < 0) {
+	    __pmLogPipeStop(pp);
+	    return sts;
+	}
+    }
+#endif
+
+    *pipep = pp;
+    return 0;
+
+fail:
+    while (--i >= 0)
+	free(pp->slot[i].rec);
+    free(pp->slot);
+    free(pp);
+    return sts;
+}
+
+/*
+ * Return the next record in archive order.  The caller owns rec->rp
+ * (and rec->data) from here on.  At the end of the archive, or after
+ * a read or transform error, the same rec->sts < 0 is returned from
+ * every later call; rec->rp is only set for a transform error, and
+ * remains owned by the pipeline.
+ */
+int
+__pmLogPipeNext(__pmLogPipe *pp, __pmLogPipeRec *rec)
+{
+    pipeslot_t	*sp = &pp->slot[pp->cn];
+
+    if (!pp->ready) {
+	if (pp->nworker == 0) {
+	    fillslot(pp, sp);
+	    transform(pp, sp);
+	}
+#ifdef PM_MULTI_THREAD
+	else {
+	    PM_LOCK(pp->lock);
+	    while (sp->state != SLOT_DONE)
+		pthread_cond_wait(&pp->cond, &pp->lock);
+	    PM_UNLOCK(pp->lock);
+	}
+#endif
+	pp->ready = 1;
+	pp->cnrec = 0;
+    }
+
+    *rec = sp->rec[pp->cnrec];
+    if (rec->sts < 0)
+	return rec->sts;
+    if (++pp->cnrec == sp->nrec) {
+	/* slot drained, hand it back to the reader */
+	pp->ready = 0;
+#ifdef PM_MULTI_THREAD
+	if (pp->nworker > 0) {
+	    PM_LOCK(pp->lock);
+	    sp->state = SLOT_EMPTY;
+	    pp->cn = (pp->cn + 1) % pp->nslot;
+	    pthread_cond_broadcast(&pp->cond);
+	    PM_UNLOCK(pp->lock);
+	}
+#endif
+    }
+    return 0;
+}
+
+/*
+ * Stop the pipeline and release it.  Records that were read but not
+ * yet returned by __pmLogPipeNext() have rec->rp freed, but anything
+ * a transform hung off rec->data is not touched.
+ */
+void
+__pmLogPipeStop(__pmLogPipe *pp)
+{
+    pipeslot_t	*sp;
+    int		i;
+    int		j;
+
+#ifdef PM_MULTI_THREAD
+    if (pp->nthread > 0) {
+	PM_LOCK(pp->lock);
+	pp->stop = 1;
+	pthread_cond_broadcast(&pp->cond);
+	PM_UNLOCK(pp->lock);
+	for (i = 0; i < pp->nthread; i++)
+	    pthread_join(pp->thread[i], NULL);
+    }
+    if (pp->nworker > 0) {
+	free(pp->thread);
+	pthread_mutex_destroy(&pp->lock);
+	pthread_cond_destroy(&pp->cond);
+    }
+#endif
+
+    for (i = 0; i < pp->nslot; i++) {
+	sp = &pp->slot[i];
+	if (pp->nworker == 0 ? pp->ready : sp->state != SLOT_EMPTY) {
+	    for (j = (i == pp->cn && pp->ready) ? pp->cnrec : 0; j < sp->nrec; j++) {
+		if (sp->rec[j].rp != NULL)
+		    pmFreeResult(sp->rec[j].rp);
+	    }
+	}
+	free(sp->rec);
+    }
+    if (pp->carry && pp->next.rp != NULL)
+	pmFreeResult(pp->next.rp);
+    free(pp->slot);
+    free(pp);
+}
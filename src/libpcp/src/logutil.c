@@ -194,6 +194,7 @@ __pmLogChangeVol(__pmArchCtl *acp, int vol)
 	__pmResetIPC(__pmFileno(acp->ac_mfp));
 	__pmFclose(acp->ac_mfp);
     }
+    __pmLogDeltaReset(acp);
     pmsprintf(fname, sizeof(fname), "%s.%d", lcp->name, vol);
     /* need mutual exclusion here to avoid race with a concurrent uncompress */
     PM_LOCK(logutil_lock);
@@ -598,6 +599,7 @@ __pmLogClose(__pmArchCtl *acp)
 	__pmFclose(acp->ac_mfp);
 	acp->ac_mfp = NULL;
     }
+    __pmLogDeltaReset(acp);
     if (lcp->name != NULL) {
 	free(lcp->name);
 	lcp->name = NULL;
@@ -914,6 +916,21 @@ logputresult(int version, __pmArchCtl *acp, __pmPDU *pb)
 	lcp->state = PM_LOG_STATE_INIT;
     }
 
+    if ((lcp->label.features & PM_LOG_FEATURE_DELTA) &&
+	(sz = __pmLogDeltaEncode(acp, pb, &start)) > 0) {
+	if (pmDebugOptions.log) {
+	    fprintf(stderr, "logputresult: pdubuf=" PRINTF_P_PFX "%p input len=%d delta len=%d posn=%ld\n", pb, pb[0], sz, (long)__pmFtell(acp->ac_mfp));
+	}
+	if ((sts = __pmFwrite(start, 1, sz, acp->ac_mfp)) != sz) {
+	    char	errmsg[PM_MAXERRMSGLEN];
+	    pmprintf("__pmLogPutResult2: write failed: returns %d expecting %d: %s\n",
+	    	sts, sz, osstrerror_r(errmsg, sizeof(errmsg)));
+	    pmflush();
+	    return -oserror();
+	}
+	return sts;
+    }
+
     sz = pb[0] - (int)sizeof(__pmPDUHdr) + 2 * (int)sizeof(int);
 
     if (pmDebugOptions.log) {
@@ -1545,6 +1562,32 @@ again:
 	goto func_return;
     }
 
+    if (lcp->label.features & PM_LOG_FEATURE_DELTA) {
+	/*
+	 * record may be delta encoded, see logdelta.c ... offset of the
+	 * start of this record is needed to find the reference record
+	 */
+	long	recoff = __pmFtell(f);
+
+	recoff -= (mode == PM_MODE_BACK) ? (long)sizeof(trail) : (long)head;
+	if (rlen >= 3 * (int)sizeof(__pmPDU) &&
+	    (int)ntohl(pb[5]) == PM_LOG_DELTA_MARK) {
+	    if ((sts = __pmLogDeltaDecode(acp, f, recoff, &pb)) < 0) {
+		if (pmDebugOptions.log) {
+		    char	errmsg[PM_MAXERRMSGLEN];
+		    fprintf(stderr, "\nError: delta record decode failed: %s\n", pmErrStr_r(sts, errmsg, sizeof(errmsg)));
+		}
+		__pmUnpinPDUBuf(pb);
+		if (sts != -ENOMEM)
+		    sts = PM_ERR_LOGREC;
+		goto func_return;
+	    }
+	    head = pb[0] - (int)sizeof(__pmPDUHdr) + 2 * (int)sizeof(head);
+	}
+	else
+	    __pmLogDeltaRemember(acp, f, recoff, pb);
+    }
+
     if (option == PMLOGREAD_TO_EOF && paranoidCheck(head, pb) == -1) {
 	__pmUnpinPDUBuf(pb);
 	sts = PM_ERR_LOGREC;
@@ -1987,6 +2030,66 @@ VolSkip(__pmArchCtl *acp, int mode, int j)
     return PM_ERR_EOL;
 }
 
+/*
+ * Find the first temporal index entry for a volume that is present
+ * with a timestamp at or after origin ... entries beyond the physical
+ * end of a (truncated) last volume are not valid, and the first of
+ * those is returned (with *toobig set) if reached before origin.
+ * Return lcp->numti if there is no such entry.  Requires ti[] to be
+ * in time order, see __pmLogLoadIndex().
+ */
+static int
+ti_search(__pmArchCtl *acp, const __pmTimestamp *origin, int *match, int *toobig)
+{
+    __pmLogCtl	*lcp = acp->ac_log;
+    __pmLogTI	*ti = lcp->ti;
+    int		numti = lcp->numti;
+    int		lo = 0;
+    int		hi;
+    int		end = numti;
+    int		mid;
+
+    if (ti[numti-1].vol == lcp->maxvol) {
+	/* truncated check for last volume */
+	struct stat	sbuf;
+	__pmFILE	*f;
+	int		vol = lcp->maxvol;
+
+	sbuf.st_size = 0;
+	if (vol >= 0 && vol < lcp->numseen && lcp->seen[vol])
+	    __pmFstat(acp->ac_mfp, &sbuf);
+	else if ((f = _logpeek(acp, vol)) != NULL) {
+	    __pmFstat(f, &sbuf);
+	    __pmFclose(f);
+	}
+	while (end > 0 && ti[end-1].vol == vol && ti[end-1].off_data > sbuf.st_size)
+	    end--;
+    }
+
+    hi = end;
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if (__pmTimestampSub(&ti[mid].stamp, origin) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    /* skip missing preliminary volumes */
+    while (lo < end && ti[lo].vol < lcp->minvol)
+	lo++;
+
+    if (lo < end) {
+	if (__pmTimestampSub(&ti[lo].stamp, origin) == 0)
+	    *match = 1;
+	return lo;
+    }
+    if (end < numti && ti[end].vol >= lcp->minvol) {
+	*toobig = 1;
+	return end;
+    }
+    return numti;
+}
+
 int
 __pmLogSetTime(__pmContext *ctxp)
 {
@@ -2058,39 +2161,50 @@ __pmLogSetTime(__pmContext *ctxp)
 
 	sbuf.st_size = -1;
 
-	for (i = 0; i < numti; i++, tip++) {
-	    tivol = tip->vol;
-	    tilog = tip->off_data;
-	    if (tivol < lcp->minvol)
-		/* skip missing preliminary volumes */
-		continue;
-	    if (tivol == lcp->maxvol) {
-		/* truncated check for last volume */
-		if (sbuf.st_size < 0) {
-		    sbuf.st_size = 0;
-		    vol = lcp->maxvol;
-		    if (vol >= 0 && vol < lcp->numseen && lcp->seen[vol])
-			__pmFstat(acp->ac_mfp, &sbuf);
-		    else if ((f = _logpeek(acp, lcp->maxvol)) != NULL) {
-			__pmFstat(f, &sbuf);
-			__pmFclose(f);
+	if (lcp->tisorted) {
+	    /*
+	     * binary search for the first entry at or after the origin,
+	     * equivalent to the linear scan below ... with a dense
+	     * temporal index this avoids a long walk through ti[]
+	     */
+	    j = ti_search(acp, &ctxp->c_origin, &match, &toobig);
+	    i = j;
+	}
+	else {
+	    for (i = 0; i < numti; i++, tip++) {
+		tivol = tip->vol;
+		tilog = tip->off_data;
+		if (tivol < lcp->minvol)
+		    /* skip missing preliminary volumes */
+		    continue;
+		if (tivol == lcp->maxvol) {
+		    /* truncated check for last volume */
+		    if (sbuf.st_size < 0) {
+			sbuf.st_size = 0;
+			vol = lcp->maxvol;
+			if (vol >= 0 && vol < lcp->numseen && lcp->seen[vol])
+			    __pmFstat(acp->ac_mfp, &sbuf);
+			else if ((f = _logpeek(acp, lcp->maxvol)) != NULL) {
+			    __pmFstat(f, &sbuf);
+			    __pmFclose(f);
+			}
+		    }
+		    if (tilog > sbuf.st_size) {
+			j = i;
+			toobig++;
+			break;
 		    }
 		}
-		if (tilog > sbuf.st_size) {
+		t_hi = __pmTimestampSub(&tip->stamp, &ctxp->c_origin);
+		if (t_hi > 0) {
 		    j = i;
-		    toobig++;
 		    break;
 		}
-	    }
-	    t_hi = __pmTimestampSub(&tip->stamp, &ctxp->c_origin);
-	    if (t_hi > 0) {
-		j = i;
-		break;
-	    }
-	    else if (t_hi == 0) {
-		j = i;
-		match = 1;
-		break;
+		else if (t_hi == 0) {
+		    j = i;
+		    match = 1;
+		    break;
+		}
 	    }
 	}
 	if (i == numti)
@@ -2519,6 +2633,7 @@ prior_vol:
 	if (f != acp->ac_mfp) {
 	    /* f comes from _logpeek(), close it */
 	    __pmFclose(f);
+	    __pmLogDeltaReset(acp);
 	    f = NULL;
 	}
 
@@ -2528,7 +2643,10 @@ prior_vol:
 	__pmFseek(f, save, SEEK_SET); /* restore file pointer in current vol */ 
     else if (f != NULL)
 	/* temporary __pmFILE * from _logpeek() */
+    {
 	__pmFclose(f);
+	__pmLogDeltaReset(acp);
+    }
 
     if (found) {
 	tsp->sec = rp->timestamp.tv_sec;
@@ -3003,6 +3121,7 @@ __pmArchCtlFree(__pmArchCtl *acp)
 	__pmFclose(acp->ac_mfp);
 	acp->ac_mfp = NULL;
     }
+    __pmLogDeltaFree(acp);
 
     /* Now we can free it. */
     free(acp);
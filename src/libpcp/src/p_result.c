@@ -33,6 +33,7 @@
  */
 
 #include <ctype.h>
+#include <stddef.h>
 #include "pmapi.h"
 #include "libpcp.h"
 #include "internal.h"
@@ -277,10 +278,23 @@ __pmSendHighResResult(int fd, int from, const pmHighResResult *result)
     return __pmSendHighResResult_ctx(NULL, fd, from, result);
 }
 
+/*
+ * Decoding a result into an arena (one pinned PDU buffer) - head bytes
+ * at the start of the arena are for the __pmResultArena header and the
+ * pmResult or pmHighResResult (with its vset[] at offset vsetoff), the
+ * pmValueSets follow, and pmValueBlocks are left in the input buffer.
+ */
+typedef struct {
+    int		head;		/* bytes before the first pmValueSet */
+    int		vsetoff;	/* offset of the vset[] array */
+    char	*buf;		/* the arena, on success */
+} arena_t;
+
 #if defined(HAVE_64BIT_PTR)
 static int
 __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
-		int numpmid, int preamble, int unaligned, pmValueSet *vset[])
+		int numpmid, int preamble, int unaligned, pmValueSet *vset[],
+		arena_t *arena)
 {
     char	*newbuf;
     int		valfmt;
@@ -416,7 +430,7 @@ __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
 	}
     }
 
-    need = nvsize + vbsize;
+    need = arena ? arena->head + nvsize : nvsize + vbsize;
     offset = preamble + vsize;
 
     if (pmDebugOptions.pdu && pmDebugOptions.desperate) {
@@ -462,6 +476,17 @@ __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
     if ((newbuf = (char *)__pmFindPDUBuf(need)) == NULL)
 	return -oserror();
 
+    if (arena) {
+	/*
+	 * pmValueSets follow the result in the arena, pmValueBlocks are
+	 * referenced in place and the input buffer is pinned again below
+	 */
+	arena->buf = newbuf;
+	vset = (pmValueSet **)&newbuf[arena->vsetoff];
+	newbuf += arena->head;
+	vbsize = 0;
+    }
+
     /*
      * At this point, we have verified the contents of the incoming PDU and
      * the following is set up ...
@@ -532,8 +557,12 @@ __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
 		     * in the input PDU buffer, lval is an index to the
 		     * start of the pmValueBlock, in units of __pmPDU
 		     */
-		    vindex = sizeof(__pmPDU) * ntohl(vp->value.lval) + offset;
-		    nvp->value.pval = (pmValueBlock *)&newbuf[vindex];
+		    if (arena)
+			nvp->value.pval = (pmValueBlock *)&pdubuf[ntohl(vp->value.lval)];
+		    else {
+			vindex = sizeof(__pmPDU) * ntohl(vp->value.lval) + offset;
+			nvp->value.pval = (pmValueBlock *)&newbuf[vindex];
+		    }
 		    if (pmDebugOptions.pdu && pmDebugOptions.desperate) {
 			int		k, len;
 			len = nvp->value.pval->vlen - PM_VAL_HDR_SIZE;
@@ -546,6 +575,8 @@ __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
 		else {
 		    if (pmDebugOptions.pdu && pmDebugOptions.desperate)
 			fprintf(stderr, " botch: valfmt=%d\n", nvsp->valfmt);
+		    if (arena)
+			__pmUnpinPDUBuf(arena->buf);
 		    return PM_ERR_IPC;
 		}
 	    }
@@ -554,7 +585,15 @@ __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
 	    fputc('\n', stderr);
 	}
     }
-    if (numpmid == 0)
+    if (arena) {
+	((__pmResultArena *)arena->buf)->pdubuf = NULL;
+	if (vsplit < pduend) {
+	    /* pmValueBlocks referenced in place */
+	    __pmPinPDUBuf(pdubuf);
+	    ((__pmResultArena *)arena->buf)->pdubuf = pdubuf;
+	}
+    }
+    else if (numpmid == 0)
 	__pmUnpinPDUBuf(newbuf);
     return 0;
 }
@@ -562,8 +601,8 @@ __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
 #elif defined(HAVE_32BIT_PTR)
 
 static int
-__pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
-		int numpmid, int preamble, int unaligned, pmValueSet *vset[])
+__pmDecodeVlist(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
+		int numpmid, int preamble, pmValueSet *vset[])
 {
     pmValueSet	*vsp;		/* vlist_t == pmValueSet */
     char	*vsplit;	/* vlist/valueblock division point */
@@ -700,10 +739,54 @@ __pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
     return 0;
 }
 
+static int
+__pmDecodeValueSet(__pmPDU *pdubuf, int pdulen, __pmPDU *data, char *pduend,
+		int numpmid, int preamble, int unaligned, pmValueSet *vset[],
+		arena_t *arena)
+{
+    int		sts;
+
+    (void)unaligned;
+    if (arena == NULL)
+	return __pmDecodeVlist(pdubuf, pdulen, data, pduend,
+				numpmid, preamble, vset);
+
+    /* pmValueSets are decoded in place, so the arena is just the result */
+    if ((arena->buf = (char *)__pmFindPDUBuf(arena->head)) == NULL)
+	return -oserror();
+    vset = (pmValueSet **)&arena->buf[arena->vsetoff];
+    if ((sts = __pmDecodeVlist(pdubuf, pdulen, data, pduend,
+				numpmid, preamble, vset)) < 0) {
+	__pmUnpinPDUBuf(arena->buf);
+	return sts;
+    }
+    /* input buffer pinned again in __pmDecodeVlist() if numpmid > 0 */
+    ((__pmResultArena *)arena->buf)->pdubuf = numpmid > 0 ? pdubuf : NULL;
+    return 0;
+}
+
 #else
 #error Bozo - unexpected sizeof pointer!! - commented for static checking
 #endif
 
+/*
+ * Results are decoded into an arena for host contexts that ask for it,
+ * see PM_CTXFLAG_ARENA in pmNewContext(3).
+ */
+static int
+__pmUseArena(__pmContext *ctxp, int numpmid, size_t vsetoff, arena_t *arena)
+{
+    size_t	head;
+
+    if (ctxp == NULL || ctxp->c_type != PM_CONTEXT_HOST ||
+	(ctxp->c_flags & PM_CTXFLAG_ARENA) == 0)
+	return 0;
+    arena->vsetoff = sizeof(__pmResultArena) + vsetoff;
+    head = arena->vsetoff + (numpmid > 0 ? numpmid : 1) * sizeof(pmValueSet *);
+    arena->head = (head + sizeof(double) - 1) & ~(sizeof(double) - 1);
+    return 1;
+}
+
 /*
  * Internal variant of __pmDecodeResult() with current context.
  *
@@ -719,6 +802,7 @@ __pmDecodeResult_ctx(__pmContext *ctxp, __pmPDU *pdubuf, pmResult **result)
     size_t	bytes, nopad;
     result_t	*pp;
     pmResult	*pr;
+    arena_t	arena;
 
     if (ctxp != NULL)
 	PM_ASSERT_IS_LOCKED(ctxp->c_lock);
@@ -749,23 +833,32 @@ __pmDecodeResult_ctx(__pmContext *ctxp, __pmPDU *pdubuf, pmResult **result)
 	return PM_ERR_IPC;
     }
 
-    if ((pr = (pmResult *)malloc(sizeof(pmResult) +
+    bytes = sizeof(result_t) - sizeof(__pmPDU);
+    nopad = sizeof(pp->hdr) + sizeof(pp->timestamp) + sizeof(pp->numpmid);
+
+    if (__pmUseArena(ctxp, numpmid, offsetof(pmResult, vset), &arena)) {
+	if ((sts = __pmDecodeValueSet(pdubuf, pp->hdr.len, pp->data, pduend,
+				  numpmid, bytes, nopad, NULL, &arena)) < 0)
+	    return sts;
+	pr = (pmResult *)&arena.buf[sizeof(__pmResultArena)];
+	__pmPinPDUBuf(arena.buf);	/* see __pmFreeResultArena() */
+	__pmResultArenas = 1;
+    }
+    else {
+	if ((pr = (pmResult *)malloc(sizeof(pmResult) +
 			 	(numpmid - 1) * sizeof(pmValueSet *))) == NULL)
-	return -oserror();
+	    return -oserror();
+	if ((sts = __pmDecodeValueSet(pdubuf, pp->hdr.len, pp->data, pduend,
+				  numpmid, bytes, nopad, pr->vset, NULL)) < 0) {
+	    free(pr);
+	    return sts;
+	}
+    }
 
     pr->numpmid = numpmid;
     pr->timestamp.tv_sec = ntohl(pp->timestamp.tv_sec);
     pr->timestamp.tv_usec = ntohl(pp->timestamp.tv_usec);
 
-    bytes = sizeof(result_t) - sizeof(__pmPDU);
-    nopad = sizeof(pp->hdr) + sizeof(pp->timestamp) + sizeof(pp->numpmid);
-
-    if ((sts = __pmDecodeValueSet(pdubuf, pp->hdr.len, pp->data, pduend,
-				  numpmid, bytes, nopad, pr->vset)) < 0) {
-	free(pr);
-	return sts;
-    }
-
     if (pmDebugOptions.pdu)
 	__pmDumpResult_ctx(ctxp, stderr, pr);
 
@@ -799,6 +892,7 @@ __pmDecodeHighResResult_ctx(__pmContext *ctxp, __pmPDU *pdubuf, pmHighResResult
     size_t		bytes, nopad;
     pmHighResResult	*pr;
     highres_result_t	*pp;
+    arena_t		arena;
 
     if (ctxp != NULL)
 	PM_ASSERT_IS_LOCKED(ctxp->c_lock);
@@ -829,9 +923,27 @@ __pmDecodeHighResResult_ctx(__pmContext *ctxp, __pmPDU *pdubuf, pmHighResResult
 	return PM_ERR_IPC;
     }
 
-    if ((pr = (pmHighResResult *)malloc(sizeof(pmHighResResult) +
+    bytes = sizeof(highres_result_t) - (sizeof(__pmPDU) * 2);
+    nopad = sizeof(pp->hdr) + sizeof(pp->numpmid) + sizeof(pp->timestamp);
+
+    if (__pmUseArena(ctxp, numpmid, offsetof(pmHighResResult, vset), &arena)) {
+	if ((sts = __pmDecodeValueSet(pdubuf, pp->hdr.len, pp->data, pduend,
+				  numpmid, bytes, nopad, NULL, &arena)) < 0)
+	    return sts;
+	pr = (pmHighResResult *)&arena.buf[sizeof(__pmResultArena)];
+	__pmPinPDUBuf(arena.buf);	/* see __pmFreeResultArena() */
+	__pmResultArenas = 1;
+    }
+    else {
+	if ((pr = (pmHighResResult *)malloc(sizeof(pmHighResResult) +
 			 	(numpmid - 1) * sizeof(pmValueSet *))) == NULL)
-	return -oserror();
+	    return -oserror();
+	if ((sts = __pmDecodeValueSet(pdubuf, pp->hdr.len, pp->data, pduend,
+				  numpmid, bytes, nopad, pr->vset, NULL)) < 0) {
+	    free(pr);
+	    return sts;
+	}
+    }
 
     pr->numpmid = numpmid;
     __ntohll((char *)&pp->timestamp.tv_sec);
@@ -839,15 +951,6 @@ __pmDecodeHighResResult_ctx(__pmContext *ctxp, __pmPDU *pdubuf, pmHighResResult
     __ntohll((char *)&pp->timestamp.tv_nsec);
     pr->timestamp.tv_nsec = pp->timestamp.tv_nsec;
 
-    bytes = sizeof(highres_result_t) - (sizeof(__pmPDU) * 2);
-    nopad = sizeof(pp->hdr) + sizeof(pp->numpmid) + sizeof(pp->timestamp);
-
-    if ((sts = __pmDecodeValueSet(pdubuf, pp->hdr.len, pp->data, pduend,
-				  numpmid, bytes, nopad, pr->vset)) < 0) {
-	free(pr);
-	return sts;
-    }
-
     if (pmDebugOptions.pdu)
 	__pmDumpHighResResult_ctx(ctxp, stderr, pr);
 
@@ -1871,10 +1871,14 @@ pmLookupName_ctx(__pmContext *ctxp, int derive_locked, int numpmid, const char *
 		fprintf(stderr, " [%d] %s", i, namelist[i]);
 	    fputc('\n', stderr);
 	}
+	PM_LOCK(ctxp->c_pmcd->pc_lock);
 	sts = __pmSendNameList(ctxp->c_pmcd->pc_fd, __pmPtrToHandle(ctxp),
 		numpmid, namelist, NULL);
-	if (sts < 0)
+	if (sts < 0) {
 	    sts = __pmMapErrno(sts);
+	    __pmSharedPMCDError(ctxp, sts);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
+	}
 	else {
 	    __pmPDU	*pb;
 	    int		pinpdu;
@@ -1882,6 +1886,9 @@ pmLookupName_ctx(__pmContext *ctxp, int derive_locked, int numpmid, const char *
 PM_FAULT_POINT("libpcp/" __FILE__ ":1", PM_FAULT_TIMEOUT);
 	    pinpdu = sts = __pmGetPDU(ctxp->c_pmcd->pc_fd, ANY_SIZE,
 				    ctxp->c_pmcd->pc_tout_sec, &pb);
+	    if (sts < 0 || (sts != PDU_PMNS_IDS && sts != PDU_ERROR))
+		__pmSharedPMCDError(ctxp, sts < 0 ? sts : PM_ERR_IPC);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	    if (sts == PDU_PMNS_IDS) {
 		/* Note:
 		 * pmLookupName may return an error even though
@@ -2013,6 +2020,7 @@ GetChildrenStatusRemote(__pmContext *ctxp, const char *name,
 {
     int n;
 
+    PM_LOCK(ctxp->c_pmcd->pc_lock);
     n = __pmSendChildReq(ctxp->c_pmcd->pc_fd, __pmPtrToHandle(ctxp),
 		name, statuslist == NULL ? 0 : 1);
     if (n < 0)
@@ -2038,6 +2046,9 @@ PM_FAULT_POINT("libpcp/" __FILE__ ":2", PM_FAULT_TIMEOUT);
 	if (pinpdu > 0)
 	    __pmUnpinPDUBuf(pb);
     }
+    if (n < 0)
+	__pmSharedPMCDError(ctxp, n);
+    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 
     return n;
 }
@@ -2600,9 +2611,13 @@ pmNameID(pmID pmid, char **name)
     else {
 	/* assume PMNS_REMOTE */
 	assert(c_type == PM_CONTEXT_HOST);
+	PM_LOCK(ctxp->c_pmcd->pc_lock);
 	if ((sts = request_namebypmid(ctxp, pmid)) >= 0) {
 	    sts = receive_a_name(ctxp, name);
 	}
+	if (sts < 0)
+	    __pmSharedPMCDError(ctxp, sts);
+	PM_UNLOCK(ctxp->c_pmcd->pc_lock);
     }
 
     if (sts >= 0)
@@ -2770,9 +2785,13 @@ pmNameAll_ctx(__pmContext *ctxp, pmID pmid, char ***namelist)
     else {
 	/* assume PMNS_REMOTE */
 	assert(c_type == PM_CONTEXT_HOST);
+	PM_LOCK(ctxp->c_pmcd->pc_lock);
 	if ((sts = request_namebypmid (ctxp, pmid)) >= 0) {
 	    sts = receive_namesbyid (ctxp, namelist);
 	}
+	if (sts < 0)
+	    __pmSharedPMCDError(ctxp, sts);
+	PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	if (sts > 0)
 	    goto pmapi_return;
     }
@@ -2975,9 +2994,12 @@ TraversePMNS(const char *name, void(*func)(const char *), void(*func_r)(const ch
 	    sts = PM_ERR_NOCONTEXT;
 	    goto pmapi_return;
 	}
+	PM_LOCK(ctxp->c_pmcd->pc_lock);
 	sts = __pmSendTraversePMNSReq(ctxp->c_pmcd->pc_fd, __pmPtrToHandle(ctxp), name);
 	if (sts < 0) {
 	    sts = __pmMapErrno(sts);
+	    __pmSharedPMCDError(ctxp, sts);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 	    goto pmapi_return;
 	}
 	else {
@@ -2989,6 +3011,9 @@ TraversePMNS(const char *name, void(*func)(const char *), void(*func_r)(const ch
 PM_FAULT_POINT("libpcp/" __FILE__ ":4", PM_FAULT_TIMEOUT);
 	    pinpdu = sts = __pmGetPDU(ctxp->c_pmcd->pc_fd, ANY_SIZE, 
 				      TIMEOUT_DEFAULT, &pb);
+	    if (sts < 0 || (sts != PDU_PMNS_NAMES && sts != PDU_ERROR))
+		__pmSharedPMCDError(ctxp, sts < 0 ? sts : PM_ERR_IPC);
+	    PM_UNLOCK(ctxp->c_pmcd->pc_lock);
 
 	    /*
 	     * It is important that we don't hold the context lock before
@@ -71,6 +71,7 @@ pmStore_ctx(__pmContext *ctxp, const pmResult *result)
 	PM_ASSERT_IS_LOCKED(ctxp->c_lock);
 
     if (ctxp->c_type == PM_CONTEXT_HOST) {
+	PM_LOCK(ctxp->c_pmcd->pc_lock);
 	sts = __pmSendResult_ctx(ctxp, ctxp->c_pmcd->pc_fd, __pmPtrToHandle(ctxp), result);
 	if (sts < 0)
 	    sts = __pmMapErrno(sts);
@@ -89,6 +90,9 @@ PM_FAULT_POINT("libpcp/" __FILE__ ":1", PM_FAULT_TIMEOUT);
 	    if (pinpdu > 0)
 		__pmUnpinPDUBuf(pb);
 	}
+	if (sts < 0)
+	    __pmSharedPMCDError(ctxp, sts);
+	PM_UNLOCK(ctxp->c_pmcd->pc_lock);
     }
     else if (ctxp->c_type == PM_CONTEXT_LOCAL) {
 	/*
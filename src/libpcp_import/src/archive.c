@@ -150,8 +150,13 @@ newvolume(pmi_context *current, pmTimeval *tvp)
     __pmFflush(acp->ac_mfp);
 }
 
-int
-_pmi_put_result(pmi_context *current, pmResult *result)
+/*
+ * Write one pmResult, with the instances in each pmValueSet already in
+ * ascending order.  Metadata for the metrics and instance domains is
+ * only checked (and written if needed) when checkmeta is set.
+ */
+static int
+put_result(pmi_context *current, pmResult *result, int checkmeta)
 {
     int		sts;
     __pmPDU	*pb;
@@ -162,13 +167,6 @@ _pmi_put_result(pmi_context *current, pmResult *result)
     unsigned long off;
     unsigned long max_logsz = p ? strtoul(p, NULL, 10) : 0x7fffffff;
 
-    /*
-     * some front-end tools use lazy discovery of instances and/or process
-     * data in non-deterministic order ... it is simpler for everyone if
-     * we sort the values into ascending instance order.
-     */
-    pmSortInstances(result);
-
     stamp.sec = result->timestamp.tv_sec;
     stamp.nsec = result->timestamp.tv_usec * 1000;
 
@@ -182,7 +180,7 @@ _pmi_put_result(pmi_context *current, pmResult *result)
 	return sts;
 
     needti = 0;
-    for (k = 0; k < result->numpmid; k++) {
+    for (k = 0; checkmeta && k < result->numpmid; k++) {
 	sts = check_metric(current, result->vset[k]->pmid, &needti);
 	if (sts < 0) {
 	    __pmUnpinPDUBuf(pb);
@@ -205,6 +203,29 @@ _pmi_put_result(pmi_context *current, pmResult *result)
     return 0;
 }
 
+int
+_pmi_put_result(pmi_context *current, pmResult *result)
+{
+    /*
+     * some front-end tools use lazy discovery of instances and/or process
+     * data in non-deterministic order ... it is simpler for everyone if
+     * we sort the values into ascending instance order.
+     */
+    pmSortInstances(result);
+
+    return put_result(current, result, 1);
+}
+
+/*
+ * Batch results are built in instance order, and the metadata cannot
+ * change part way through a batch so only needs checking for the first.
+ */
+int
+_pmi_put_batch(pmi_context *current, pmResult *result, int first)
+{
+    return put_result(current, result, first);
+}
+
 int
 _pmi_put_text(pmi_context *current)
 {
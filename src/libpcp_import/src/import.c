@@ -330,6 +330,7 @@ pmiStart(const char *archive, int inherit)
     current->hostname = NULL;
     current->timezone = NULL;
     current->result = NULL;
+    current->batch = NULL;
     memset((void *)&current->logctl, 0, sizeof(current->logctl));
     memset((void *)&current->archctl, 0, sizeof(current->archctl));
     current->archctl.ac_log = &current->logctl;
@@ -485,6 +486,9 @@ pmiEnd(void)
     if (current == NULL)
 	return PM_ERR_NOCONTEXT;
 
+    _pmi_batch_free(current->batch);
+    current->batch = NULL;
+
     return current->last_sts = _pmi_end(current);
 }
 
@@ -1028,21 +1032,27 @@ text_pending(void)
 }
 
 static int
-check_timestamp(const struct timeval *timestamp)
+check_order(const struct timeval *timestamp, const struct timeval *previous)
 {
-    if (timestamp->tv_sec < current->last_stamp.tv_sec ||
-        (timestamp->tv_sec == current->last_stamp.tv_sec &&
-	 timestamp->tv_usec < current->last_stamp.tv_usec)) {
+    if (timestamp->tv_sec < previous->tv_sec ||
+        (timestamp->tv_sec == previous->tv_sec &&
+	 timestamp->tv_usec < previous->tv_usec)) {
 	fprintf(stderr, "Fatal Error: timestamp ");
 	printstamp(stderr, timestamp);
 	fprintf(stderr, " not greater than previous valid timestamp ");
-	printstamp(stderr, &current->last_stamp);
+	printstamp(stderr, previous);
 	fputc('\n', stderr);
 	return PMI_ERR_BADTIMESTAMP;
     }
     return 0;
 }
 
+static int
+check_timestamp(const struct timeval *timestamp)
+{
+    return check_order(timestamp, &current->last_stamp);
+}
+
 int
 pmiWrite(int sec, int usec)
 {
@@ -1106,6 +1116,48 @@ pmiPutResult(const pmResult *result)
     return current->last_sts = sts;
 }
 
+int
+pmiPutBatch(int nstamp, const struct timeval *stamps, int nhandle,
+	    const int *handles, const pmAtomValue *values)
+{
+    int		s;
+    int		sts;
+
+    if (current == NULL)
+	return PM_ERR_NOCONTEXT;
+    if (nstamp <= 0 || nhandle <= 0)
+	return current->last_sts = PMI_ERR_NODATA;
+    if ((sts = _pmi_batch_setup(current, nhandle, handles)) < 0)
+	return current->last_sts = sts;
+
+    /* check the whole batch first, so a bad batch writes nothing */
+    for (s = 0; s < nstamp; s++) {
+	if ((sts = check_order(&stamps[s],
+			s ? &stamps[s-1] : &current->last_stamp)) < 0)
+	    return current->last_sts = sts;
+    }
+    if ((sts = _pmi_batch_check(current, nstamp, values)) < 0)
+	return current->last_sts = sts;
+
+    for (s = 0; s < nstamp; s++) {
+	if ((sts = _pmi_batch_stuff(current, &values[(size_t)s * nhandle])) < 0)
+	    break;
+	current->batch->result->timestamp = stamps[s];
+	if ((sts = _pmi_put_batch(current, current->batch->result, s == 0)) < 0)
+	    break;
+	current->last_stamp = stamps[s];
+	if (s == 0) {
+	    /* pending text and labels, as for pmiWrite() */
+	    if ((sts = _pmi_put_text(current)) < 0)
+		break;
+	    if ((sts = _pmi_put_label(current)) < 0)
+		break;
+	}
+    }
+
+    return current->last_sts = sts;
+}
+
 int
 pmiPutMark(void)
 {
@@ -37,6 +37,14 @@ typedef struct {
     int		inst;		// internal instance identifier
 } pmi_handle;
 
+typedef struct {
+    int		nhandle;
+    int		*handle;	// handle for each column of values
+    pmValue	**value;	// where each column goes in result
+    int		*size;		// allocated length of pmValueBlock
+    pmResult	*result;	// reused for every timestamp
+} pmi_batch;
+
 typedef struct {
     unsigned int	type;
     unsigned int	id;
@@ -59,6 +67,7 @@ typedef struct {
     __pmLogCtl	logctl;
     __pmArchCtl	archctl;
     pmResult	*result;
+    pmi_batch	*batch;
     int		nmetric;
     pmi_metric	*metric;
     int		nindom;
@@ -84,7 +93,12 @@ typedef struct {
 #endif
 
 extern int _pmi_stuff_value(pmi_context *, pmi_handle *, const char *) _PMI_HIDDEN;
+extern int _pmi_batch_setup(pmi_context *, int, const int *) _PMI_HIDDEN;
+extern int _pmi_batch_stuff(pmi_context *, const pmAtomValue *) _PMI_HIDDEN;
+extern int _pmi_batch_check(pmi_context *, int, const pmAtomValue *) _PMI_HIDDEN;
+extern void _pmi_batch_free(pmi_batch *) _PMI_HIDDEN;
 extern int _pmi_put_result(pmi_context *, pmResult *) _PMI_HIDDEN;
+extern int _pmi_put_batch(pmi_context *, pmResult *, int) _PMI_HIDDEN;
 extern int _pmi_put_text(pmi_context *) _PMI_HIDDEN;
 extern int _pmi_put_label(pmi_context *) _PMI_HIDDEN;
 extern int _pmi_end(pmi_context *) _PMI_HIDDEN;
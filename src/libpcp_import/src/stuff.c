@@ -190,3 +190,261 @@ _pmi_stuff_value(pmi_context *current, pmi_handle *hp, const char *value)
 
     return 0;
 }
+
+typedef struct {
+    int		order;		// first column for this metric
+    int		midx;
+    int		inst;
+    int		col;
+} batch_col;
+
+static int
+batch_col_cmp(const void *a, const void *b)
+{
+    const batch_col	*ap = (const batch_col *)a;
+    const batch_col	*bp = (const batch_col *)b;
+
+    if (ap->order != bp->order)
+	return ap->order < bp->order ? -1 : 1;
+    if (ap->inst != bp->inst)
+	return ap->inst < bp->inst ? -1 : 1;
+    return 0;
+}
+
+void
+_pmi_batch_free(pmi_batch *bp)
+{
+    pmValueSet	*vsp;
+    int		i, j;
+
+    if (bp == NULL)
+	return;
+    if (bp->result != NULL) {
+	for (i = 0; i < bp->result->numpmid; i++) {
+	    vsp = bp->result->vset[i];
+	    if (vsp->valfmt == PM_VAL_DPTR) {
+		for (j = 0; j < vsp->numval; j++)
+		    free(vsp->vlist[j].value.pval);
+	    }
+	    free(vsp);
+	}
+	free(bp->result);
+    }
+    free(bp->handle);
+    free(bp->value);
+    free(bp->size);
+    free(bp);
+}
+
+/*
+ * Build the pmResult for a batch from the handles for its columns of
+ * values - one pmValueSet per metric (in the order the metrics first
+ * appear in the columns, as for pmiPutValue), instances in ascending
+ * order and
+ * a pmValueBlock allocated for each non-insitu value, so the same
+ * pmResult can be filled in and encoded for every timestamp.  Kept in
+ * the context and reused while the caller passes the same handles.
+ */
+int
+_pmi_batch_setup(pmi_context *current, int nhandle, const int *handle)
+{
+    pmi_batch	*bp = current->batch;
+    batch_col	*cols;
+    int		*first;
+    pmResult	*rp;
+    pmValueSet	*vsp;
+    pmi_metric	*mp;
+    size_t	size;
+    int		numpmid;
+    int		dsize, need;
+    int		j, k, h;
+
+    if (bp != NULL && bp->nhandle == nhandle &&
+	memcmp(bp->handle, handle, nhandle * sizeof(int)) == 0)
+	return 0;	/* same columns as last time */
+
+    _pmi_batch_free(bp);
+    current->batch = NULL;
+
+    if ((cols = (batch_col *)malloc(nhandle * sizeof(batch_col))) == NULL)
+	pmNoMem("_pmi_batch_setup: cols", nhandle * sizeof(batch_col), PM_FATAL_ERR);
+    if ((first = (int *)malloc(current->nmetric * sizeof(int))) == NULL)
+	pmNoMem("_pmi_batch_setup: first", current->nmetric * sizeof(int), PM_FATAL_ERR);
+    for (j = 0; j < current->nmetric; j++)
+	first[j] = -1;
+    for (h = 0; h < nhandle; h++) {
+	if (handle[h] <= 0 || handle[h] > current->nhandle) {
+	    free(first);
+	    free(cols);
+	    return PMI_ERR_BADHANDLE;
+	}
+	cols[h].midx = current->handle[handle[h]-1].midx;
+	cols[h].inst = current->handle[handle[h]-1].inst;
+	cols[h].col = h;
+	if (first[cols[h].midx] < 0)
+	    first[cols[h].midx] = h;
+	cols[h].order = first[cols[h].midx];
+	switch (current->metric[cols[h].midx].desc.type) {
+	    case PM_TYPE_32:
+	    case PM_TYPE_U32:
+	    case PM_TYPE_64:
+	    case PM_TYPE_U64:
+	    case PM_TYPE_FLOAT:
+	    case PM_TYPE_DOUBLE:
+	    case PM_TYPE_STRING:
+		break;
+	    default:
+		free(first);
+		free(cols);
+		return PM_ERR_TYPE;
+	}
+    }
+    free(first);
+    qsort(cols, nhandle, sizeof(batch_col), batch_col_cmp);
+    for (numpmid = 1, h = 1; h < nhandle; h++) {
+	if (cols[h].midx != cols[h-1].midx)
+	    numpmid++;
+	else if (cols[h].inst == cols[h-1].inst) {
+	    /* each metric-instance can appear at most once per pmResult */
+	    free(cols);
+	    return PMI_ERR_DUPVALUE;
+	}
+    }
+
+    if ((bp = (pmi_batch *)calloc(1, sizeof(pmi_batch))) == NULL)
+	pmNoMem("_pmi_batch_setup: batch", sizeof(pmi_batch), PM_FATAL_ERR);
+    bp->nhandle = nhandle;
+    if ((bp->handle = (int *)malloc(nhandle * sizeof(int))) == NULL)
+	pmNoMem("_pmi_batch_setup: handle", nhandle * sizeof(int), PM_FATAL_ERR);
+    memcpy(bp->handle, handle, nhandle * sizeof(int));
+    if ((bp->value = (pmValue **)malloc(nhandle * sizeof(pmValue *))) == NULL)
+	pmNoMem("_pmi_batch_setup: value", nhandle * sizeof(pmValue *), PM_FATAL_ERR);
+    if ((bp->size = (int *)calloc(nhandle, sizeof(int))) == NULL)
+	pmNoMem("_pmi_batch_setup: size", nhandle * sizeof(int), PM_FATAL_ERR);
+    size = sizeof(pmResult) + (numpmid-1) * sizeof(pmValueSet *);
+    if ((rp = bp->result = (pmResult *)calloc(1, size)) == NULL)
+	pmNoMem("_pmi_batch_setup: result", size, PM_FATAL_ERR);
+
+    for (h = 0; h < nhandle; h = j) {
+	for (j = h + 1; j < nhandle && cols[j].midx == cols[h].midx; j++)
+	    ;
+	mp = &current->metric[cols[h].midx];
+	size = sizeof(pmValueSet) + (j-h-1) * sizeof(pmValue);
+	if ((vsp = (pmValueSet *)malloc(size)) == NULL)
+	    pmNoMem("_pmi_batch_setup: vset", size, PM_FATAL_ERR);
+	rp->vset[rp->numpmid++] = vsp;
+	vsp->pmid = mp->pmid;
+	vsp->numval = j - h;
+	switch (mp->desc.type) {
+	    case PM_TYPE_32:
+	    case PM_TYPE_U32:
+		vsp->valfmt = PM_VAL_INSITU;
+		dsize = -1;
+		break;
+	    case PM_TYPE_FLOAT:
+		vsp->valfmt = PM_VAL_DPTR;
+		dsize = sizeof(float);
+		break;
+	    case PM_TYPE_STRING:
+		vsp->valfmt = PM_VAL_DPTR;
+		dsize = 0;	/* grown as needed */
+		break;
+	    default:
+		vsp->valfmt = PM_VAL_DPTR;
+		dsize = sizeof(__int64_t);
+		break;
+	}
+	for (k = 0; k < vsp->numval; k++) {
+	    vsp->vlist[k].inst = cols[h+k].inst;
+	    bp->value[cols[h+k].col] = &vsp->vlist[k];
+	    if (dsize < 0)
+		continue;
+	    need = dsize + PM_VAL_HDR_SIZE;
+	    if (need < sizeof(pmValueBlock))
+		need = sizeof(pmValueBlock);
+	    if ((vsp->vlist[k].value.pval = (pmValueBlock *)malloc(need)) == NULL)
+		pmNoMem("_pmi_batch_setup: pmValueBlock", need, PM_FATAL_ERR);
+	    vsp->vlist[k].value.pval->vlen = dsize + PM_VAL_HDR_SIZE;
+	    vsp->vlist[k].value.pval->vtype = mp->desc.type;
+	    bp->size[cols[h+k].col] = need;
+	}
+    }
+
+    free(cols);
+    current->batch = bp;
+    return 0;
+}
+
+/*
+ * Check every row of values for a batch before any are written - the
+ * only value that cannot be encoded is a NULL string.
+ */
+int
+_pmi_batch_check(pmi_context *current, int nrow, const pmAtomValue *values)
+{
+    pmi_batch		*bp = current->batch;
+    const pmAtomValue	*row;
+    int			r, h;
+
+    for (h = 0; h < bp->nhandle; h++) {
+	if (bp->size[h] == 0 || bp->value[h]->value.pval->vtype != PM_TYPE_STRING)
+	    continue;
+	for (r = 0, row = values; r < nrow; r++, row += bp->nhandle) {
+	    if (row[h].cp == NULL)
+		return PM_ERR_CONV;
+	}
+    }
+    return 0;
+}
+
+/*
+ * Fill in the batch pmResult from one row of values, one pmAtomValue
+ * per column with the field used chosen by the metric's type.
+ */
+int
+_pmi_batch_stuff(pmi_context *current, const pmAtomValue *row)
+{
+    pmi_batch		*bp = current->batch;
+    pmValueBlock	*vbp;
+    pmValue		*vp;
+    size_t		len;
+    int			need;
+    int			h;
+
+    for (h = 0; h < bp->nhandle; h++) {
+	vp = bp->value[h];
+	if (bp->size[h] == 0) {
+	    /* PM_TYPE_32 or PM_TYPE_U32, insitu */
+	    vp->value.lval = row[h].l;
+	    continue;
+	}
+	vbp = vp->value.pval;
+	switch (vbp->vtype) {
+	    case PM_TYPE_64:
+	    case PM_TYPE_U64:
+		memcpy(vbp->vbuf, &row[h].ll, sizeof(__int64_t));
+		break;
+	    case PM_TYPE_FLOAT:
+		memcpy(vbp->vbuf, &row[h].f, sizeof(float));
+		break;
+	    case PM_TYPE_DOUBLE:
+		memcpy(vbp->vbuf, &row[h].d, sizeof(double));
+		break;
+	    case PM_TYPE_STRING:
+		if (row[h].cp == NULL)
+		    return PM_ERR_CONV;
+		len = strlen(row[h].cp) + 1;
+		need = len + PM_VAL_HDR_SIZE;
+		if (need > bp->size[h]) {
+		    if ((vbp = (pmValueBlock *)realloc(vbp, need)) == NULL)
+			pmNoMem("_pmi_batch_stuff: pmValueBlock", need, PM_FATAL_ERR);
+		    vp->value.pval = vbp;
+		    bp->size[h] = need;
+		}
+		vbp->vlen = need;
+		memcpy(vbp->vbuf, row[h].cp, len);
+		break;
+	}
+    }
+    return 0;
+}
@@ -35,9 +35,20 @@ struct mmv_registry {
     const char *	file;
     __uint32_t		cluster;
     mmv_stats_flags_t	flags;
+    __uint32_t		nshards;
     void *		addr;
 };
 
+struct mmv_handle {
+    void *		addr;		/* start of the mapping */
+    int			type;		/* MMV_TYPE_* of the metric */
+    int			nshards;	/* number of value records */
+    mmv_disk_value_t *	shards[1];	/* one value record per shard */
+};
+
+#define MMV_CACHELINE	64	/* alignment for shards and padded values */
+#define MMV_MAXSHARDS	64	/* upper bound on per-thread value shards */
+
 static void
 mmv_stats_path(const char *fname, char *fullpath, size_t pathlen)
 {
@@ -128,9 +139,23 @@ mmv_generation(void)
     return (((__uint64_t)gen1 << 32) | (__uint64_t)gen2);
 }
 
+/*
+ * Metric type of a value record (filler records used for padding
+ * have no metric, and no type).
+ */
+static mmv_metric_type_t
+mmv_value_type(void *addr, int version, mmv_disk_value_t *v)
+{
+    if (v->metric == 0)
+	return MMV_TYPE_NOSUPPORT;
+    if (version == MMV_VERSION1)
+	return ((mmv_disk_metric_t *)((char *)addr + v->metric))->type;
+    return ((mmv_disk_metric2_t *)((char *)addr + v->metric))->type;
+}
+
 static void * 
 mmv_init(const char *fname, int version,
-		int cluster, mmv_stats_flags_t fl,
+		int cluster, mmv_stats_flags_t fl, int nshards,
 		const mmv_metric_t *st1, int nmetric1,
 		const mmv_indom_t *in1, int nindom1,
 		const mmv_metric2_t *st2, int nmetric2,
@@ -155,6 +180,7 @@ mmv_init(const char *fname, int version,
     __uint64_t values_offset;		/* anchor start of values section */
     __uint64_t strings_offset;		/* anchor start of any/all strings */
     __uint64_t labels_offset;		/* anchor start of any/all labels */
+    __uint64_t histograms_offset;	/* anchor start of histogram buckets */
     void *addr;
     size_t size;
     __uint64_t offset;
@@ -162,6 +188,8 @@ mmv_init(const char *fname, int version,
     int ninstances = 0;
     int nstrings = 0;
     int nvalues = 0;
+    int nhistograms = 0;
+    int stride, block;
 
     for (i = 0; i < nindom1; i++) {
 	ninstances += in1[i].count;
@@ -172,7 +200,7 @@ mmv_init(const char *fname, int version,
     }
     for (i = 0; i < nindom2; i++) {
 	ninstances += in2[i].count;
-	if (version == MMV_VERSION2 || version == MMV_VERSION3)
+	if (version != MMV_VERSION1)
 	    nstrings += in2[i].count;	/* instance names */
 	if (in2[i].shorttext)
 	    nstrings++;
@@ -198,7 +226,7 @@ mmv_init(const char *fname, int version,
 	}
     }
     for (i = 0; i < nmetric2; i++) {
-	if (version == MMV_VERSION2 || version == MMV_VERSION3)
+	if (version != MMV_VERSION1)
 	    nstrings++;		/* metric name */
 	if (st2[i].helptext)
 	    nstrings++;
@@ -213,6 +241,8 @@ mmv_init(const char *fname, int version,
 	} else {
 	    if (st2[i].type == MMV_TYPE_STRING)
 		nstrings++;
+	    if (st2[i].type == MMV_TYPE_HISTOGRAM)
+		nhistograms++;
 	    nvalues++;
 	}
     }
@@ -227,6 +257,8 @@ mmv_init(const char *fname, int version,
     if (nlabels) {
 	size += sizeof(mmv_disk_toc_t) * 1;
     }
+    if (nhistograms)
+	size += sizeof(mmv_disk_toc_t) * 1;
     indoms_offset = sizeof(mmv_disk_header_t) + size;
 
     /* Following the indom definitions are the actual instances */
@@ -263,16 +295,40 @@ mmv_init(const char *fname, int version,
     }
     values_offset = metrics_offset + size;
 
+    /*
+     * Padded values occupy a cache line each (the second record in
+     * each line is an unused filler), and each set of value shards
+     * starts on a cache line boundary, so that threads updating
+     * different values or shards never contend for the same line.
+     */
+    if (!(fl & MMV_FLAG_SHARDED))
+	nshards = 1;
+    stride = (fl & MMV_FLAG_PADDED) ?
+		MMV_CACHELINE / sizeof(mmv_disk_value_t) : 1;
+    block = nvalues * stride;
+    if (fl & (MMV_FLAG_SHARDED | MMV_FLAG_PADDED)) {
+	k = MMV_CACHELINE / sizeof(mmv_disk_value_t);
+	block = ((block + k - 1) / k) * k;
+	values_offset = ((values_offset + MMV_CACHELINE - 1) /
+				MMV_CACHELINE) * MMV_CACHELINE;
+    }
+
     /* Following the values are the string values and/or help text */
-    size = nvalues * sizeof(mmv_disk_value_t);
+    size = nshards * block * sizeof(mmv_disk_value_t);
     strings_offset = values_offset + size;
 
     /* Following the strings are the labels */
     size = nstrings * sizeof(mmv_disk_string_t);
     labels_offset = strings_offset + size;
 
-    /* End of file follows all of the actual strings */
+    /* Following the labels are the histograms, one set per shard */
     size = labels_offset + nlabels * sizeof(mmv_disk_label_t);
+    histograms_offset = ((size + MMV_CACHELINE - 1) /
+				MMV_CACHELINE) * MMV_CACHELINE;
+
+    /* End of file follows all of the histograms */
+    size = histograms_offset +
+	   nshards * nhistograms * sizeof(mmv_disk_histogram_t);
 
     if ((addr = mmv_mapping_init(fname, size)) == NULL)
 	return NULL;
@@ -300,6 +356,8 @@ mmv_init(const char *fname, int version,
 	hdr->tocs += 1;
     if (nlabels)
 	hdr->tocs += 1;    
+    if (nhistograms)
+	hdr->tocs += 1;
     hdr->flags = fl;
     hdr->cluster = cluster;
     hdr->process = (__int32_t)getpid();
@@ -322,7 +380,7 @@ mmv_init(const char *fname, int version,
     toc[tocidx].offset = metrics_offset;
     tocidx++;
     toc[tocidx].type = MMV_TOC_VALUES;
-    toc[tocidx].count = nvalues;
+    toc[tocidx].count = nshards * block;
     toc[tocidx].offset = values_offset;
     tocidx++;
     if (nstrings) {
@@ -337,6 +395,12 @@ mmv_init(const char *fname, int version,
 	toc[tocidx].offset = labels_offset;
 	tocidx++;
     }
+    if (nhistograms) {
+	toc[tocidx].type = MMV_TOC_HISTOGRAMS;
+	toc[tocidx].count = nshards * nhistograms;
+	toc[tocidx].offset = histograms_offset;
+	tocidx++;
+    }
 
     /* Indom section */
     domlist = (mmv_disk_indom_t *)((char *)addr + indoms_offset);
@@ -493,7 +557,7 @@ mmv_init(const char *fname, int version,
      * 6 phases: v2 instance names, v2 metric names, all string values,
      *	   any metric help, any indom help, v3 metric labels.
      */
-    if (version == MMV_VERSION2 || version == MMV_VERSION3) {
+    if (version != MMV_VERSION1) {
 	inlist2 = (mmv_disk_instance2_t *)((char *)addr + instances_offset);
 	for (i = 0; i < nindom2; i++) {
 	    mmv_instances2_t *insts = in2[i].instances;
@@ -518,22 +582,17 @@ mmv_init(const char *fname, int version,
 	}
     }
 
-    for (i = 0; i < nvalues; i++) {
-	mmv_metric_type_t type = MMV_TYPE_NOSUPPORT;
+    for (i = j = 0; i < nvalues; i++) {
+	mmv_metric_type_t type = mmv_value_type(addr, version, &vlist[i]);
 
-	if (version == MMV_VERSION1) {
-	    mmv_disk_metric_t *m1 = (mmv_disk_metric_t *)
-			((char *)(addr + vlist[i].metric));
-	    type = m1->type;
-	} else if (version == MMV_VERSION2 || version == MMV_VERSION3) {
-	    mmv_disk_metric2_t *m2 = (mmv_disk_metric2_t *)
-			((char *)(addr + vlist[i].metric));
-	    type = m2->type;
-	}
 	if (type == MMV_TYPE_STRING) {
 	    vlist[i].extra = strings_offset +
 				(stridx * sizeof(mmv_disk_string_t));
 	    stridx++;
+	} else if (type == MMV_TYPE_HISTOGRAM) {
+	    vlist[i].extra = histograms_offset +
+				(j * sizeof(mmv_disk_histogram_t));
+	    j++;
 	}
     }
     for (i = 0; i < nmetric1; i++) {
@@ -617,6 +676,24 @@ mmv_init(const char *fname, int version,
 	memcpy(lblist[i].payload, lb[i].payload, MMV_LABELMAX);
     }
 
+    /* Spread values out for padding and copy them into each shard */
+    if (stride > 1) {
+	for (i = nvalues - 1; i > 0; i--) {
+	    vlist[i * stride] = vlist[i];
+	    memset(&vlist[i], 0, sizeof(mmv_disk_value_t));
+	}
+    }
+    for (i = 1; i < nshards; i++) {
+	memcpy(&vlist[i * block], &vlist[0], block * sizeof(mmv_disk_value_t));
+	if (nhistograms == 0)
+	    continue;
+	/* each shard has its own set of histogram buckets */
+	for (k = i * block; k < (i + 1) * block; k++) {
+	    if (mmv_value_type(addr, version, &vlist[k]) == MMV_TYPE_HISTOGRAM)
+		vlist[k].extra += i * nhistograms * sizeof(mmv_disk_histogram_t);
+	}
+    }
+
     /* Complete - unlock the header, PMDA can read now */
     hdr->g2 = hdr->g1;
 
@@ -686,7 +763,7 @@ mmv_stats_init(const char *fname,
     if ((version = mmv_check(st, nmetrics, in, nindoms)) < 0)
 	return NULL;
 
-    return mmv_init(fname, version, cluster, flags,
+    return mmv_init(fname, version, cluster, flags, 1,
 		    st, nmetrics, in, nindoms, 
 		    NULL, 0, NULL, 0, NULL, 0);
 }
@@ -699,7 +776,7 @@ mmv_check2(const mmv_metric2_t *st, int nmetrics,
     const mmv_metric2_t *metric;
     const mmv_indom2_t *indom;
     size_t size;
-    int i, j, version = MMV_VERSION1;
+    int i, j, histograms = 0, version = MMV_VERSION1;
 
     for (i = 0; i < nindoms; i++) {
 	indom = &in[i];
@@ -741,7 +818,7 @@ mmv_check2(const mmv_metric2_t *st, int nmetrics,
 	metric = &st[i];
 	size = strlen(metric->name);
 	if (metric->type < MMV_TYPE_NOSUPPORT ||
-	    metric->type > MMV_TYPE_ELAPSED || size == 0) {
+	    metric->type > MMV_TYPE_HISTOGRAM || size == 0) {
 	    setoserror(EINVAL);
 	    return -1;
 	}
@@ -749,6 +826,14 @@ mmv_check2(const mmv_metric2_t *st, int nmetrics,
 	    setoserror(E2BIG);
 	    return -1;
 	}
+	if (metric->type == MMV_TYPE_HISTOGRAM) {
+	    /* histograms are singular, with buckets as their instances */
+	    if (!mmv_singular(metric->indom)) {
+		setoserror(EINVAL);
+		return -1;
+	    }
+	    histograms = 1;
+	}
 	if (size >= MMV_NAMEMAX)
 	    version = MMV_VERSION2;
 	if (!mmv_singular(metric->indom) &&
@@ -757,7 +842,7 @@ mmv_check2(const mmv_metric2_t *st, int nmetrics,
 	    return -1;
 	}
     }
-    return version;
+    return histograms ? MMV_VERSION4 : version;
 }
 
 void * 
@@ -771,7 +856,7 @@ mmv_stats2_init(const char *fname,
     if ((version = mmv_check2(st, nmetrics, in, nindoms)) < 0)
 	return NULL;
 
-    return mmv_init(fname, version, cluster, flags,
+    return mmv_init(fname, version, cluster, flags, 1,
 		    NULL, 0, NULL, 0, st, nmetrics, in, nindoms, NULL, 0);
 }
 
@@ -792,7 +877,8 @@ mmv_stats_registry(const char *file,
     }
     /*
      * Initial version is 1, this increases to 2 if adding
-     * long strings, and to 3 if adding any metric labels.
+     * long strings, to 3 if adding any metric labels, and
+     * to 4 if adding any histogram metrics.
      */
     mr->version = MMV_VERSION1;
     mr->file = file;
@@ -921,6 +1007,27 @@ mmv_stats_add_instance(mmv_registry_t *registry, int serial,
     return 0;
 }
 
+/*
+ * Use per-thread value shards - each value in the mapping is repeated
+ * nshards times, updates through a handle go to the calling thread's
+ * shard and the PMDA sums the shards to report each value.
+ */
+int
+mmv_stats_set_shards(mmv_registry_t *registry, int nshards)
+{
+    if (registry == NULL) {
+	setoserror(EFAULT);
+	return -1;
+    }
+    if (nshards < 1 || nshards > MMV_MAXSHARDS) {
+	setoserror(EINVAL);
+	return -1;
+    }
+    registry->flags |= MMV_FLAG_SHARDED;
+    registry->nshards = nshards;
+    return 0;
+}
+
 /*
  * Verify the user-supplied label.  Produce a JSONB form label in
  * the provided buffer (out) of length MMV_LABELMAX.
@@ -1198,12 +1305,25 @@ mmv_stats_start(mmv_registry_t *registry)
 				registry->indoms, registry->nindoms)) < 0)
 	return NULL;
 
-    if (registry->version != MMV_VERSION3)
+    if (registry->version != MMV_VERSION3 || version == MMV_VERSION4)
 	registry->version = version;
 
+    if (registry->nshards == 0) {
+	/* default to one value shard per online CPU */
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpu < 1)
+	    ncpu = 1;
+	registry->nshards = ncpu < MMV_MAXSHARDS ? ncpu : MMV_MAXSHARDS;
+    }
+    /* older readers would silently report only the first shard */
+    if ((registry->flags & MMV_FLAG_SHARDED) && registry->nshards > 1)
+	registry->version = MMV_VERSION5;
+
     registry->addr = mmv_init(registry->file,
 				registry->version, registry->cluster,
-				registry->flags, NULL, 0, NULL, 0, 
+				registry->flags, registry->nshards,
+				NULL, 0, NULL, 0, 
 				registry->metrics, registry->nmetrics, 
 				registry->indoms, registry->nindoms,
 				registry->labels, registry->nlabels);
@@ -1257,69 +1377,82 @@ mmv_stats_free(mmv_registry_t *registry)
     free(registry);
 }
 
-static pmAtomValue *
-mmv_lookup_value_desc1(void *addr, const char *metric, const char *inst,
-			mmv_disk_toc_t *toc)
+/*
+ * Value updates are atomic where the compiler provides the builtins,
+ * relaxed ordering suffices as each value is independent of others.
+ */
+#ifdef __ATOMIC_RELAXED
+#define mmv_atomic_add(p, n)	__atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+#define mmv_atomic_set(p, n)	__atomic_store_n((p), (n), __ATOMIC_RELAXED)
+#define mmv_atomic_cas(p, o, n)	__atomic_compare_exchange_n((p), (o), (n), \
+				    1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+#define mmv_atomic_add(p, n)	(*(p) += (n))
+#define mmv_atomic_set(p, n)	(*(p) = (n))
+#define mmv_atomic_cas(p, o, n)	(*(p) = (n), 1)
+#endif
+
+/*
+ * Returns non-zero if value record v is for the named metric and
+ * instance (filler records used for padding match nothing).
+ */
+static int
+mmv_value_match(void *addr, int version, mmv_disk_value_t *v,
+		const char *metric, const char *inst)
 {
-    int j;
-    mmv_disk_value_t *v = (mmv_disk_value_t *)((char *)addr + toc->offset);
+    mmv_disk_string_t *s;
+    const char *name;
+    __int32_t indom;
 
-    for (j = 0; j < toc->count; j++) {
-	mmv_disk_metric_t *m = (mmv_disk_metric_t *)
-					((char *)addr + v[j].metric);
-	if (strcmp(m->name, metric) == 0) {
-	    if (mmv_singular(m->indom)) {  /* Singular metric */
-		return &v[j].value;
-	    } else {
-		if (inst == NULL) {
-		    /* Metric has multiple instances, but we don't know
-		     * which one to return, so return an error.
-		     */
-		    return NULL;
-		} else {
-		    mmv_disk_instance_t *in = (mmv_disk_instance_t *)
-					((char *)addr + v[j].instance);
-		    if (strcmp(in->external, inst) == 0)
-			return &v[j].value;
-		}
-	    }
-	}
-    }
+    if (v->metric == 0)
+	return 0;
 
-    return NULL;
+    if (version == MMV_VERSION1) {
+	mmv_disk_metric_t *m = (mmv_disk_metric_t *)
+					((char *)addr + v->metric);
+	name = m->name;
+	indom = m->indom;
+    } else {
+	mmv_disk_metric2_t *m = (mmv_disk_metric2_t *)
+					((char *)addr + v->metric);
+	s = (mmv_disk_string_t *)((char *)addr + m->name);
+	name = s->payload;
+	indom = m->indom;
+    }
+    if (strcmp(name, metric) != 0)
+	return 0;
+    if (mmv_singular(indom))	/* Singular metric */
+	return 1;
+    /* Metric has multiple instances, but we don't know
+     * which one to return, so return an error.
+     */
+    if (inst == NULL)
+	return 0;
+
+    if (version == MMV_VERSION1) {
+	mmv_disk_instance_t *in = (mmv_disk_instance_t *)
+					((char *)addr + v->instance);
+	name = in->external;
+    } else {
+	mmv_disk_instance2_t *in = (mmv_disk_instance2_t *)
+					((char *)addr + v->instance);
+	s = (mmv_disk_string_t *)((char *)addr + in->external);
+	name = s->payload;
+    }
+    return strcmp(name, inst) == 0;
 }
 
-static pmAtomValue *
-mmv_lookup_value_desc2(void *addr, const char *metric, const char *inst,
-			mmv_disk_toc_t *toc)
+static mmv_disk_toc_t *
+mmv_lookup_values_toc(void *addr)
 {
-    int j;
-    mmv_disk_value_t *v = (mmv_disk_value_t *)((char *)addr + toc->offset);
+    mmv_disk_header_t *hdr = (mmv_disk_header_t *)addr;
+    mmv_disk_toc_t *toc = (mmv_disk_toc_t *)
+			((char *)addr + sizeof(mmv_disk_header_t));
+    int i;
 
-    for (j = 0; j < toc->count; j++) {
-	mmv_disk_metric2_t *m = (mmv_disk_metric2_t *)
-					((char *)addr + v[j].metric);
-	mmv_disk_string_t *s = (mmv_disk_string_t *)
-					((char *)addr + m->name);
-	if (strcmp(s->payload, metric) == 0) {
-	    if (mmv_singular(m->indom)) {  /* Singular metric */
-		return &v[j].value;
-	    } else {
-		if (inst == NULL) {
-		    /* Metric has multiple instances, but we don't know
-		     * which one to return, so return an error.
-		     */
-		    return NULL;
-		} else {
-		    mmv_disk_instance2_t *in = (mmv_disk_instance2_t *)
-					((char *)addr + v[j].instance);
-		    s = (mmv_disk_string_t *)((char *)addr + in->external);
-		    if (strcmp(s->payload, inst) == 0)
-			return &v[j].value;
-		}
-	    }
-	}
-    }
+    for (i = 0; i < hdr->tocs; i++)
+	if (toc[i].type == MMV_TOC_VALUES)
+	    return &toc[i];
     return NULL;
 }
 
@@ -1327,22 +1460,211 @@ pmAtomValue *
 mmv_lookup_value_desc(void *addr, const char *metric, const char *inst)
 {
     if (addr != NULL && metric != NULL) {
-	int i;
 	mmv_disk_header_t *hdr = (mmv_disk_header_t *)addr;
-	mmv_disk_toc_t *toc = (mmv_disk_toc_t *)
-			((char *)addr + sizeof(mmv_disk_header_t));
+	mmv_disk_toc_t *toc = mmv_lookup_values_toc(addr);
+	mmv_disk_value_t *v;
+	int j;
+
+	if (toc == NULL)
+	    return NULL;
+	v = (mmv_disk_value_t *)((char *)addr + toc->offset);
+	for (j = 0; j < toc->count; j++)
+	    if (mmv_value_match(addr, hdr->version, &v[j], metric, inst))
+		return &v[j].value;
+    }
+    return NULL;
+}
 
-	if (hdr->version == MMV_VERSION1) {
-	    for (i = 0; i < hdr->tocs; i++)
-		if (toc[i].type == MMV_TOC_VALUES)
-		    return mmv_lookup_value_desc1(addr, metric, inst, &toc[i]);
-	} else {
-	    for (i = 0; i < hdr->tocs; i++)
-		if (toc[i].type == MMV_TOC_VALUES)
-		    return mmv_lookup_value_desc2(addr, metric, inst, &toc[i]);
+/*
+ * Resolve a metric and instance to a handle once, for any number of
+ * subsequent updates via mmv_handle_add and mmv_handle_set - these
+ * avoid name lookups and are atomic for all numeric metric types.
+ * In a sharded mapping the handle refers to every shard of a value.
+ */
+mmv_handle_t *
+mmv_lookup_handle(void *addr, const char *metric, const char *inst)
+{
+    mmv_disk_header_t *hdr = (mmv_disk_header_t *)addr;
+    mmv_disk_toc_t *toc;
+    mmv_disk_value_t *v;
+    mmv_handle_t *hp = NULL, *tmp;
+    int j, n = 0;
+
+    if (addr == NULL || metric == NULL ||
+	(toc = mmv_lookup_values_toc(addr)) == NULL) {
+	setoserror(EINVAL);
+	return NULL;
+    }
+
+    v = (mmv_disk_value_t *)((char *)addr + toc->offset);
+    for (j = 0; j < toc->count && n < MMV_MAXSHARDS; j++) {
+	if (!mmv_value_match(addr, hdr->version, &v[j], metric, inst))
+	    continue;
+	tmp = (mmv_handle_t *)realloc(hp, sizeof(mmv_handle_t) +
+					n * sizeof(mmv_disk_value_t *));
+	if (tmp == NULL) {
+	    free(hp);
+	    setoserror(ENOMEM);
+	    return NULL;
+	}
+	hp = tmp;
+	hp->shards[n++] = &v[j];
+    }
+    if (hp == NULL) {
+	setoserror(ENOENT);
+	return NULL;
+    }
+    hp->addr = addr;
+    hp->nshards = n;
+    hp->type = mmv_value_type(addr, hdr->version, hp->shards[0]);
+    return hp;
+}
+
+void
+mmv_handle_free(mmv_handle_t *hp)
+{
+    free(hp);
+}
+
+/*
+ * Each updating thread is assigned a shard on first use, round-robin.
+ */
+static int
+mmv_thread_shard(mmv_handle_t *hp)
+{
+#ifdef HAVE___THREAD
+    static __thread int	shard = -1;
+    static int		nthreads;
+
+    if (hp->nshards == 1)
+	return 0;
+    if (shard < 0)
+	shard = mmv_atomic_add(&nthreads, 1) & 0x7fffffff;
+    return shard % hp->nshards;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Record one histogram sample - the bucket, sum and sample count are
+ * updated independently, so readers may briefly see them disagree.
+ */
+static void
+mmv_histogram_observe(void *addr, mmv_disk_value_t *v, __uint64_t sample)
+{
+    mmv_disk_histogram_t *h = (mmv_disk_histogram_t *)((char *)addr + v->extra);
+
+    mmv_atomic_add(&h->buckets[mmv_histogram_bucket(sample)], 1);
+    mmv_atomic_add(&h->sum, sample);
+    mmv_atomic_add(&v->value.ull, 1);
+}
+
+void
+mmv_handle_add(mmv_handle_t *hp, __int64_t inc)
+{
+    mmv_disk_value_t *v;
+    __uint64_t old64, new64;
+    __uint32_t old32, new32;
+    double d;
+    float f;
+
+    if (hp == NULL)
+	return;
+    v = hp->shards[mmv_thread_shard(hp)];
+
+    switch (hp->type) {
+    case MMV_TYPE_I32:
+    case MMV_TYPE_U32:
+	mmv_atomic_add(&v->value.ul, (__uint32_t)inc);
+	break;
+    case MMV_TYPE_I64:
+    case MMV_TYPE_U64:
+    case MMV_TYPE_ELAPSED:
+	mmv_atomic_add(&v->value.ull, (__uint64_t)inc);
+	break;
+    case MMV_TYPE_FLOAT:
+	old32 = v->value.ul;
+	do {
+	    memcpy(&f, &old32, sizeof(f));
+	    f += (float)inc;
+	    memcpy(&new32, &f, sizeof(f));
+	} while (!mmv_atomic_cas(&v->value.ul, &old32, new32));
+	break;
+    case MMV_TYPE_DOUBLE:
+	old64 = v->value.ull;
+	do {
+	    memcpy(&d, &old64, sizeof(d));
+	    d += (double)inc;
+	    memcpy(&new64, &d, sizeof(d));
+	} while (!mmv_atomic_cas(&v->value.ull, &old64, new64));
+	break;
+    case MMV_TYPE_HISTOGRAM:
+	if (inc >= 0)
+	    mmv_histogram_observe(hp->addr, v, (__uint64_t)inc);
+	break;
+    default:
+	break;
+    }
+}
+
+/*
+ * Record one sample in a histogram, through a handle - equivalent to
+ * mmv_handle_add of the sample value for a histogram metric.
+ */
+void
+mmv_handle_observe(mmv_handle_t *hp, __uint64_t sample)
+{
+    if (hp == NULL || hp->type != MMV_TYPE_HISTOGRAM)
+	return;
+    mmv_histogram_observe(hp->addr, hp->shards[mmv_thread_shard(hp)], sample);
+}
+
+/*
+ * Set a value - for a sharded value, the calling thread's shard takes
+ * the new value and all other shards are zeroed.
+ */
+void
+mmv_handle_set(mmv_handle_t *hp, __int64_t val)
+{
+    mmv_disk_value_t *v;
+    int i, shard;
+
+    if (hp == NULL)
+	return;
+    shard = mmv_thread_shard(hp);
+
+    for (i = 0; i < hp->nshards; i++) {
+	v = hp->shards[i];
+	switch (hp->type) {
+	case MMV_TYPE_I32:
+	case MMV_TYPE_U32:
+	    mmv_atomic_set(&v->value.ul, i == shard ? (__uint32_t)val : 0);
+	    break;
+	case MMV_TYPE_I64:
+	case MMV_TYPE_U64:
+	case MMV_TYPE_ELAPSED:
+	    mmv_atomic_set(&v->value.ull, i == shard ? (__uint64_t)val : 0);
+	    break;
+	case MMV_TYPE_FLOAT: {
+	    pmAtomValue av;
+
+	    memset(&av, 0, sizeof(av));
+	    av.f = i == shard ? (float)val : 0;
+	    mmv_atomic_set(&v->value.ul, av.ul);
+	    break;
+	}
+	case MMV_TYPE_DOUBLE: {
+	    pmAtomValue av;
+
+	    av.d = i == shard ? (double)val : 0;
+	    mmv_atomic_set(&v->value.ull, av.ull);
+	    break;
+	}
+	default:
+	    break;
 	}
     }
-    return NULL;
 }
 
 void
@@ -1364,16 +1686,16 @@ mmv_inc_value(void *addr, pmAtomValue *av, double inc)
 	}
 	switch (type) {
 	case MMV_TYPE_I32:
-	    v->value.l += (__int32_t)inc;
+	    mmv_atomic_add(&v->value.l, (__int32_t)inc);
 	    break;
 	case MMV_TYPE_U32:
-	    v->value.ul += (__uint32_t)inc;
+	    mmv_atomic_add(&v->value.ul, (__uint32_t)inc);
 	    break;
 	case MMV_TYPE_I64:
-	    v->value.ll += (__int64_t)inc;
+	    mmv_atomic_add(&v->value.ll, (__int64_t)inc);
 	    break;
 	case MMV_TYPE_U64:
-	    v->value.ull += (__uint64_t)inc;
+	    mmv_atomic_add(&v->value.ull, (__uint64_t)inc);
 	    break;
 	case MMV_TYPE_FLOAT:
 	    v->value.f += (float)inc;
@@ -1389,6 +1711,10 @@ mmv_inc_value(void *addr, pmAtomValue *av, double inc)
 		v->extra = 0;
 	    }
 	    break;
+	case MMV_TYPE_HISTOGRAM:
+	    if (inc >= 0)
+		mmv_histogram_observe(addr, v, (__uint64_t)inc);
+	    break;
 	default:
 	    break;
 	}
@@ -1497,15 +1823,32 @@ mmv_stats_inc(void *addr, const char *metric, const char *instance)
     mmv_stats_add(addr, metric, instance, 1);
 }
 
+/*
+ * In a sharded mapping the first shard takes the new value and all
+ * other shards of it are zeroed, so that their sum is that value.
+ */
 void
 mmv_stats_set(void *addr,
 	const char *metric, const char *instance, double value)
 {
     if (addr) {
+	mmv_disk_header_t *hdr = (mmv_disk_header_t *)addr;
+	mmv_disk_toc_t *toc;
+	mmv_disk_value_t *v;
 	pmAtomValue * mmv_metric;
+	int j;
+
 	mmv_metric = mmv_lookup_value_desc(addr, metric, instance);
-	if (mmv_metric)
-	    mmv_set_value(addr, mmv_metric, value);
+	if (mmv_metric == NULL)
+	    return;
+	mmv_set_value(addr, mmv_metric, value);
+	if (!(hdr->flags & MMV_FLAG_SHARDED) ||
+	    (toc = mmv_lookup_values_toc(addr)) == NULL)
+	    return;
+	v = (mmv_disk_value_t *)((char *)addr + toc->offset);
+	for (j = (mmv_disk_value_t *)mmv_metric - v + 1; j < toc->count; j++)
+	    if (mmv_value_match(addr, hdr->version, &v[j], metric, instance))
+		mmv_set_value(addr, &v[j].value, 0);
     }
 }
 
@@ -533,7 +533,7 @@ reorder:
 	else
 	    last_e = t;
     }
-
+    h->last = last_e;
 }
 
 /*
@@ -621,11 +621,17 @@ insert_cache(hdr_t *h, const char *name, int inst, int *sts)
 	    *sts = PM_ERR_INST;
 	    return e;
 	}
-	for (e = h->first; e != NULL; e = e->next) {
-	    if (e->inst < inst)
-		last_e = e;
-	    else if (e->inst > inst)
-		break;
+	if (h->last != NULL && h->last->inst < inst) {
+	    /* appending, as when loading a cache saved in inst order */
+	    last_e = h->last;
+	}
+	else {
+	    for (e = h->first; e != NULL; e = e->next) {
+		if (e->inst < inst)
+		    last_e = e;
+		else if (e->inst > inst)
+		    break;
+	    }
 	}
     }
 
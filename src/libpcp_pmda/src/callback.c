@@ -493,9 +493,463 @@ __pmdaEncodeStatus(pmResult *result, unsigned char byte)
 
 #define PMDA_STATUS_CHANGE (PMDA_EXT_LABEL_CHANGE|PMDA_EXT_NAMES_CHANGE)
 
+/*
+ * Ensure the instance, value and status lists have room for need entries.
+ */
+static int
+__pmdaGrowInst(e_ext_t *extp, int need)
+{
+    unsigned int	*instlist;
+    pmAtomValue		*atomlist;
+    int			*stslist;
+    int			size;
+
+    if (need <= extp->maxninst)
+	return 0;
+    for (size = extp->maxninst ? extp->maxninst : 64; size < need; size *= 2)
+	;
+    if ((instlist = realloc(extp->instlist, size * sizeof(*instlist))) == NULL)
+	return -oserror();
+    extp->instlist = instlist;
+    if ((atomlist = realloc(extp->atomlist, size * sizeof(*atomlist))) == NULL)
+	return -oserror();
+    extp->atomlist = atomlist;
+    if ((stslist = realloc(extp->stslist, size * sizeof(*stslist))) == NULL)
+	return -oserror();
+    extp->stslist = stslist;
+    extp->maxninst = size;
+    return 0;
+}
+
+/*
+ * Gather the instances required in the profile into the instance list
+ * from index start onwards (and size the value and status lists to
+ * match) for indomCallBack and batchCallBack.
+ */
+static int
+__pmdaGatherInst(pmInDom indom, pmdaExt *pmda, e_ext_t *extp, int start)
+{
+    int			inst, numinst = start;
+    int			sts;
+
+    __pmdaStartInst(indom, pmda);
+    while (__pmdaNextInst(&inst, pmda)) {
+	if (numinst == extp->maxninst &&
+	    (sts = __pmdaGrowInst(extp, numinst + 1)) < 0)
+	    return sts;
+	extp->instlist[numinst++] = inst;
+    }
+    return numinst - start;
+}
+
+/*
+ * Report an error returned by a fetch callback.
+ */
+static void
+__pmdaFetchError(pmDesc *dp, unsigned int inst, int sts)
+{
+    char		strbuf[20];
+
+    pmIDStr_r(dp->pmid, strbuf, sizeof(strbuf));
+    if (sts == PM_ERR_PMID) {
+	pmNotifyErr(LOG_ERR, 
+	    "pmdaFetch: PMID %s not handled by fetch callback\n",
+		    strbuf);
+    }
+    else if (sts == PM_ERR_INST) {
+	if (pmDebugOptions.libpmda) {
+	    pmNotifyErr(LOG_ERR,
+		"pmdaFetch: Instance %d of PMID %s not handled by fetch callback\n",
+			inst, strbuf);
+	}
+    }
+    else if (sts == PM_ERR_VALUE ||
+	     sts == PM_ERR_APPVERSION ||
+	     sts == PM_ERR_PERMISSION ||
+	     sts == PM_ERR_AGAIN ||
+	     sts == PM_ERR_NYI) {
+	if (pmDebugOptions.libpmda) {
+	    pmNotifyErr(LOG_ERR,
+		 "pmdaFetch: Fetch callback error from metric PMID %s[%d]: %s\n",
+		    strbuf, inst, pmErrStr(sts));
+	}
+    }
+    else {
+	pmNotifyErr(LOG_ERR,
+	    "pmdaFetch: Fetch callback error from metric PMID %s[%d]: %s\n",
+		    strbuf, inst, pmErrStr(sts));
+    }
+}
+
+/*
+ * Release a PMDA_FETCH_DYNAMIC value once it has been copied.
+ */
+static void
+__pmdaFetchFree(pmDesc *dp, pmAtomValue *atom)
+{
+    char		idbuf[20];
+    char		strbuf[20];
+
+    if (dp->type == PM_TYPE_STRING)
+	free(atom->cp);
+    else if (dp->type == PM_TYPE_AGGREGATE)
+	free(atom->vbp);
+    else {
+	pmNotifyErr(LOG_WARNING, "pmdaFetch: Attempt to free value for metric %s of wrong type %s\n",
+		    pmIDStr_r(dp->pmid, idbuf, sizeof(idbuf)),
+		    pmTypeStr_r(dp->type, strbuf, sizeof(strbuf)));
+    }
+}
+
+/*
+ * Report a fetch callback error, or add a value returned by a fetch
+ * callback to the value set at vlist[*j] (incrementing *j if so).
+ */
+static int
+__pmdaFetchValue(int version, pmDesc *dp, unsigned int inst, int sts,
+		pmAtomValue *atom, pmValueSet *vset, int *j)
+{
+    int			type = dp->type;
+    int			lsts;
+    char		idbuf[20];
+    char		strbuf[20];
+
+    if (sts < 0)
+	__pmdaFetchError(dp, inst, sts);
+    else {
+	/*
+	 * PMDA_INTERFACE_2
+	 *	>= 0 => OK
+	 * PMDA_INTERFACE_3 or PMDA_INTERFACE_4
+	 *	== 0 => no values
+	 *	> 0  => OK
+	 * PMDA_INTERFACE_5 or later
+	 *	== 0 (PMDA_FETCH_NOVALUES) => no values
+	 *	== 1 (PMDA_FETCH_STATIC) or > 2 => OK
+	 *	== 2 (PMDA_FETCH_DYNAMIC) => OK and free(atom.vp)
+	 *	     after __pmStuffValue() called
+	 */
+	if ((version == PMDA_INTERFACE_2) || (version >= PMDA_INTERFACE_3 && sts > 0)) {
+
+	    if ((lsts = __pmStuffValue(atom, &vset->vlist[*j], type)) == PM_ERR_TYPE) {
+		pmNotifyErr(LOG_ERR, "pmdaFetch: Descriptor type (%s) for metric %s is bad",
+			    pmTypeStr_r(type, strbuf, sizeof(strbuf)),
+			    pmIDStr_r(dp->pmid, idbuf, sizeof(idbuf)));
+	    }
+	    else if (lsts >= 0) {
+		vset->vlist[*j].inst = inst;
+		vset->valfmt = lsts;
+		(*j)++;
+	    }
+	    if (version >= PMDA_INTERFACE_5 && sts == PMDA_FETCH_DYNAMIC)
+		__pmdaFetchFree(dp, atom);
+	    if (lsts < 0)
+		sts = lsts;
+	}
+    }
+    return sts;
+}
+
+#define ARENA_ALIGN(n)	(((n) + 7) & ~7)
+
+/*
+ * Space needed in the batch arena for a value set with numval values.
+ */
+static size_t
+__pmdaArenaValueSet(int numval)
+{
+    if (numval < 1)
+	numval = 1;
+    return ARENA_ALIGN(sizeof(pmValueSet) + (numval - 1) * sizeof(pmValue));
+}
+
+/*
+ * Space needed in the batch arena for the pmValueBlock holding a value
+ * of the given type, zero if it is stored in the pmValue itself.
+ */
+static size_t
+__pmdaArenaValueBlock(int type, pmAtomValue *atom)
+{
+    size_t		need;
+
+    switch (type) {
+	case PM_TYPE_FLOAT:
+	    need = PM_VAL_HDR_SIZE + sizeof(float);
+	    break;
+	case PM_TYPE_64:
+	case PM_TYPE_U64:
+	case PM_TYPE_DOUBLE:
+	    need = PM_VAL_HDR_SIZE + sizeof(__int64_t);
+	    break;
+	case PM_TYPE_STRING:
+	    need = PM_VAL_HDR_SIZE + strlen(atom->cp) + 1;
+	    break;
+	case PM_TYPE_AGGREGATE:
+	    need = atom->vbp->vlen;
+	    break;
+	default:
+	    return 0;
+    }
+    if (need < sizeof(pmValueBlock))
+	need = sizeof(pmValueBlock);
+    return ARENA_ALIGN(need);
+}
+
+/*
+ * Like __pmStuffValue(), but any pmValueBlock is carved out of the
+ * batch arena at *next rather than malloc'd.
+ */
+static int
+__pmdaArenaStuffValue(pmAtomValue *atom, pmValue *vp, int type, char **next)
+{
+    pmValueBlock	*vbp;
+    size_t		body;
+    void		*src;
+
+    switch (type) {
+	case PM_TYPE_32:
+	case PM_TYPE_U32:
+	    vp->value.lval = atom->ul;
+	    return PM_VAL_INSITU;
+	case PM_TYPE_FLOAT:
+	    body = sizeof(float);
+	    src = (void *)&atom->f;
+	    break;
+	case PM_TYPE_64:
+	case PM_TYPE_U64:
+	case PM_TYPE_DOUBLE:
+	    body = sizeof(__int64_t);
+	    src = (void *)&atom->ull;
+	    break;
+	case PM_TYPE_STRING:
+	    body = strlen(atom->cp) + 1;
+	    src = (void *)atom->cp;
+	    break;
+	case PM_TYPE_AGGREGATE:
+	    body = atom->vbp->vlen - PM_VAL_HDR_SIZE;
+	    src = (void *)atom->vbp->vbuf;
+	    break;
+	case PM_TYPE_AGGREGATE_STATIC:
+	case PM_TYPE_EVENT:
+	case PM_TYPE_HIGHRES_EVENT:
+	    vp->value.pval = atom->vbp;
+	    return PM_VAL_SPTR;
+	default:
+	    return PM_ERR_TYPE;
+    }
+    vbp = (pmValueBlock *)*next;
+    *next += __pmdaArenaValueBlock(type, atom);
+    vbp->vlen = (int)(body + PM_VAL_HDR_SIZE);
+    vbp->vtype = type;
+    memcpy((void *)vbp->vbuf, src, body);
+    vp->value.pval = vbp;
+    return PM_VAL_DPTR;
+}
+
+/*
+ * Build the pmResult value sets for a batchCallBack fetch in a single
+ * pinned PDU buffer, which __pmFreeResultValues releases with one unpin
+ * (and which __pmSendResult copies from like any other pmResult).  Only
+ * used for daemon PMDAs with the default result callback - a DSO PMDA
+ * result may be taken apart by a local context, and a PMDA's own result
+ * callback may free value sets one at a time, both of which require
+ * individually allocated value sets.
+ */
+static int
+__pmdaBatchArena(pmdaFetchBatch *bp, pmResult *res)
+{
+    pmDesc		*dp;
+    pmValueSet		*vset;
+    char		*arena, *next;
+    char		idbuf[20];
+    char		strbuf[20];
+    size_t		need = 0;
+    int			i, j, k, sts, vsts, lsts;
+
+    for (i = 0; i < bp->numpmid; i++) {
+	need += __pmdaArenaValueSet(bp->numinst[i]);
+	if (bp->metrics[i] == NULL)
+	    continue;
+	dp = &bp->metrics[i]->m_desc;
+	for (k = bp->offset[i]; k < bp->offset[i] + bp->numinst[i]; k++) {
+	    if (bp->status[k] > 0)
+		need += __pmdaArenaValueBlock(dp->type, &bp->values[k]);
+	}
+    }
+    if (need > INT_MAX || (arena = (char *)__pmFindPDUBuf((int)need)) == NULL)
+	return -ENOMEM;
+
+    next = arena;
+    for (i = 0; i < bp->numpmid; i++) {
+	res->vset[i] = vset = (pmValueSet *)next;
+	next += __pmdaArenaValueSet(bp->numinst[i]);
+	vset->pmid = bp->pmidlist[i];
+	vset->valfmt = PM_VAL_INSITU;
+	if (bp->metrics[i] == NULL) {
+	    vset->numval = PM_ERR_PMID;
+	    continue;
+	}
+	dp = &bp->metrics[i]->m_desc;
+	for (j = 0, vsts = 0, k = bp->offset[i]; k < bp->offset[i] + bp->numinst[i]; k++) {
+	    if ((sts = bp->status[k]) < 0) {
+		__pmdaFetchError(dp, bp->instlist[k], sts);
+		vsts = sts;
+		continue;
+	    }
+	    if (sts == PMDA_FETCH_NOVALUES) {
+		vsts = sts;
+		continue;
+	    }
+	    lsts = __pmdaArenaStuffValue(&bp->values[k], &vset->vlist[j], dp->type, &next);
+	    if (lsts >= 0) {
+		vset->vlist[j++].inst = bp->instlist[k];
+		vset->valfmt = lsts;
+		vsts = 0;
+	    }
+	    else {
+		if (lsts == PM_ERR_TYPE)
+		    pmNotifyErr(LOG_ERR, "pmdaFetch: Descriptor type (%s) for metric %s is bad",
+				pmTypeStr_r(dp->type, strbuf, sizeof(strbuf)),
+				pmIDStr_r(dp->pmid, idbuf, sizeof(idbuf)));
+		vsts = lsts;
+	    }
+	    if (sts == PMDA_FETCH_DYNAMIC)
+		__pmdaFetchFree(dp, &bp->values[k]);
+	}
+	vset->numval = j ? j : vsts;
+    }
+    return 0;
+}
+
+/*
+ * Build the pmResult value sets for a batchCallBack fetch using one
+ * allocation per value set (and pmValueBlock) as for pmdaFetchCallBack.
+ */
+static int
+__pmdaBatchValueSets(pmdaFetchBatch *bp, pmResult *res, int version)
+{
+    pmDesc		*dp;
+    pmValueSet		*vset;
+    int			i, j, k, sts = 0;
+
+    for (i = 0; i < bp->numpmid; i++) {
+	if ((vset = malloc(__pmdaArenaValueSet(bp->numinst[i]))) == NULL) {
+	    sts = -oserror();
+	    break;
+	}
+	res->vset[i] = vset;
+	vset->pmid = bp->pmidlist[i];
+	vset->valfmt = PM_VAL_INSITU;
+	if (bp->metrics[i] == NULL) {
+	    vset->numval = PM_ERR_PMID;
+	    continue;
+	}
+	dp = &bp->metrics[i]->m_desc;
+	for (j = 0, k = bp->offset[i]; k < bp->offset[i] + bp->numinst[i]; k++)
+	    sts = __pmdaFetchValue(version, dp, bp->instlist[k], bp->status[k],
+				&bp->values[k], vset, &j);
+	vset->numval = j ? j : (bp->numinst[i] ? sts : 0);
+    }
+    if (i < bp->numpmid) {
+	if ((res->numpmid = i) > 0)
+	    __pmFreeResultValues(res);
+	/* release any dynamic values the PMDA handed over to us */
+	for (; i < bp->numpmid; i++) {
+	    if (bp->metrics[i] == NULL)
+		continue;
+	    dp = &bp->metrics[i]->m_desc;
+	    for (k = bp->offset[i]; k < bp->offset[i] + bp->numinst[i]; k++)
+		if (bp->status[k] == PMDA_FETCH_DYNAMIC)
+		    __pmdaFetchFree(dp, &bp->values[k]);
+	}
+	return sts;
+    }
+    return 0;
+}
+
+/*
+ * Resolve the metrics and instances for a batchCallBack fetch, call
+ * it, and build the pmResult value sets from the values it returns.
+ */
+static int
+__pmdaFetchBatch(int numpmid, pmID pmidlist[], pmdaExt *pmda, e_ext_t *extp)
+{
+    pmdaFetchBatch	*bp = &extp->batch;
+    pmdaMetric		*metap;
+    pmDesc		*dp;
+    char		strbuf[20];
+    void		*tmp;
+    int			version = extp->dispatch->comm.pmda_interface;
+    int			i, n, sts, total;
+
+    if (numpmid > extp->maxnbatch) {
+	if ((tmp = realloc(extp->batchmeta, numpmid * sizeof(pmdaMetric))) == NULL)
+	    return -oserror();
+	extp->batchmeta = (pmdaMetric *)tmp;
+	if ((tmp = realloc(bp->metrics, numpmid * sizeof(pmdaMetric *))) == NULL)
+	    return -oserror();
+	bp->metrics = (pmdaMetric **)tmp;
+	if ((tmp = realloc(bp->offset, numpmid * sizeof(int))) == NULL)
+	    return -oserror();
+	bp->offset = (int *)tmp;
+	if ((tmp = realloc(bp->numinst, numpmid * sizeof(int))) == NULL)
+	    return -oserror();
+	bp->numinst = (int *)tmp;
+	extp->maxnbatch = numpmid;
+    }
+
+    for (i = total = 0; i < numpmid; i++) {
+	metap = __pmdaMetricSearch(pmda, pmidlist[i], &extp->batchmeta[i], extp);
+	dp = &metap->m_desc;
+	bp->offset[i] = total;
+	if (dp->pmid == 0) {
+	    /* dynamic name metrics may often vanish, avoid log spam */
+	    if (version < PMDA_INTERFACE_4) {
+		pmNotifyErr(LOG_ERR,
+			"pmdaFetch: Requested metric %s is not defined",
+			 pmIDStr_r(pmidlist[i], strbuf, sizeof(strbuf)));
+	    }
+	    bp->metrics[i] = NULL;
+	    bp->numinst[i] = 0;
+	    continue;
+	}
+	bp->metrics[i] = metap;
+	if (dp->indom == PM_INDOM_NULL) {
+	    if ((sts = __pmdaGrowInst(extp, total + 1)) < 0)
+		return sts;
+	    extp->instlist[total] = PM_IN_NULL;
+	    n = 1;
+	}
+	else if ((n = __pmdaGatherInst(dp->indom, pmda, extp, total)) < 0)
+	    return n;
+	bp->numinst[i] = n;
+	total += n;
+    }
+
+    bp->numpmid = numpmid;
+    bp->pmidlist = pmidlist;
+    bp->instlist = extp->instlist;
+    bp->values = extp->atomlist;
+    bp->status = extp->stslist;
+    memset(bp->status, 0, total * sizeof(int));	/* PMDA_FETCH_NOVALUES */
+
+    if ((sts = (*(extp->batchCallBack))(bp)) < 0)
+	return sts;
+
+    extp->res->numpmid = numpmid;
+    /* the arena can only be released by the default result callback */
+    if (extp->daemon && pmda->e_resultCallBack == __pmFreeResultValues &&
+	__pmdaBatchArena(bp, extp->res) == 0)
+	return 0;
+    return __pmdaBatchValueSets(bp, extp->res, version);
+}
+
 /*
  * Resize the pmResult and call the e_callback for each metric instance
- * required in the profile.
+ * required in the profile.  If the PMDA has an indomCallBack, offer it
+ * all instances of each metric with an instance domain in one call,
+ * falling back to e_callback for the metrics it declines.  If the PMDA
+ * has a batchCallBack, that is used for all metrics instead.
  */
 
 int
@@ -503,11 +957,13 @@ pmdaFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 {
     int			i;		/* over pmidlist[] */
     int			j;		/* over metatab and vset->vlist[] */
+    int			k;		/* over instlist[] */
     int			sts;
     int			need;
     int			inst;
     int			numval;
     int			version;
+    int			bulk;
     unsigned char	flags;
     pmValueSet		*vset;
     pmValueSet		*tmp_vset;
@@ -515,8 +971,6 @@ pmdaFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
     pmdaMetric          metabuf;
     pmdaMetric		*metap;
     pmAtomValue		atom;
-    int			type;
-    int			lsts;
     char		idbuf[20];
     char		strbuf[20];
     e_ext_t		*extp = (e_ext_t *)pmda->e_ext;
@@ -559,6 +1013,12 @@ pmdaFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
     }
     __pmdaEncodeStatus(extp->res, flags);
 
+    if (extp->batchCallBack != NULL) {
+	if ((sts = __pmdaFetchBatch(numpmid, pmidlist, pmda, extp)) < 0)
+	    return sts;
+	goto done;
+    }
+
     /* Look up the pmDesc for the incoming pmids in our pmdaMetrics tables,
        if present.  Fall back to .desc callback if not found (for highly
        dynamic pmdas). */
@@ -569,8 +1029,20 @@ pmdaFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 	 * will be zero
 	 */
 	dp = &(metap->m_desc);
-	if (dp->pmid != 0)
-	    numval = __pmdaCountInst(dp, pmda);
+	bulk = 0;
+	if (dp->pmid != 0) {
+	    if (extp->indomCallBack != NULL && dp->indom != PM_INDOM_NULL) {
+		/* single pass over the instances, keeping the list */
+		if ((numval = __pmdaGatherInst(dp->indom, pmda, extp, 0)) < 0) {
+		    sts = numval;
+		    extp->res->vset[i] = NULL;
+		    goto error;
+		}
+		bulk = 1;
+	    }
+	    else
+		numval = __pmdaCountInst(dp, pmda);
+	}
 	else {
 	    /* dynamic name metrics may often vanish, avoid log spam */
 	    if (version < PMDA_INTERFACE_4) {
@@ -598,13 +1070,33 @@ pmdaFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 	if (vset->numval <= 0)
 	    continue;
 
+	if (bulk) {
+	    sts = (*(extp->indomCallBack))(metap, numval, extp->instlist,
+					extp->atomlist, extp->stslist);
+	    if (sts < 0) {
+		vset->numval = sts;
+		continue;
+	    }
+	    if (sts > 0) {
+		/* values filled in for every instance in instlist[] */
+		for (j = k = 0; k < numval; k++)
+		    sts = __pmdaFetchValue(version, dp, extp->instlist[k],
+				extp->stslist[k], &extp->atomlist[k], vset, &j);
+		if (j == 0)
+		    vset->numval = sts;
+		else
+		    vset->numval = j;
+		continue;
+	    }
+	    /* else metric declined, fall back to the per-instance callback */
+	}
+
 	if (dp->indom == PM_INDOM_NULL)
 	    inst = PM_IN_NULL;
 	else {
 	    __pmdaStartInst(dp->indom, pmda);
 	    __pmdaNextInst(&inst, pmda);
 	}
-	type = dp->type;
 	j = 0;
 	do {
 	    if (j == numval) {
@@ -622,76 +1114,8 @@ pmdaFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 	    }
 	    vset->vlist[j].inst = inst;
 
-	    if ((sts = (*(pmda->e_fetchCallBack))(metap, inst, &atom)) < 0) {
-		pmIDStr_r(dp->pmid, strbuf, sizeof(strbuf));
-		if (sts == PM_ERR_PMID) {
-		    pmNotifyErr(LOG_ERR, 
-		        "pmdaFetch: PMID %s not handled by fetch callback\n",
-				strbuf);
-		}
-		else if (sts == PM_ERR_INST) {
-		    if (pmDebugOptions.libpmda) {
-			pmNotifyErr(LOG_ERR,
-			    "pmdaFetch: Instance %d of PMID %s not handled by fetch callback\n",
-				    inst, strbuf);
-		    }
-		}
-		else if (sts == PM_ERR_VALUE ||
-			 sts == PM_ERR_APPVERSION ||
-			 sts == PM_ERR_PERMISSION ||
-			 sts == PM_ERR_AGAIN ||
-			 sts == PM_ERR_NYI) {
-		    if (pmDebugOptions.libpmda) {
-			pmNotifyErr(LOG_ERR,
-			     "pmdaFetch: Fetch callback error from metric PMID %s[%d]: %s\n",
-				strbuf, inst, pmErrStr(sts));
-		    }
-		}
-		else {
-		    pmNotifyErr(LOG_ERR,
-			"pmdaFetch: Fetch callback error from metric PMID %s[%d]: %s\n",
-				strbuf, inst, pmErrStr(sts));
-		}
-	    }
-	    else {
-		/*
-		 * PMDA_INTERFACE_2
-		 *	>= 0 => OK
-		 * PMDA_INTERFACE_3 or PMDA_INTERFACE_4
-		 *	== 0 => no values
-		 *	> 0  => OK
-		 * PMDA_INTERFACE_5 or later
-		 *	== 0 (PMDA_FETCH_NOVALUES) => no values
-		 *	== 1 (PMDA_FETCH_STATIC) or > 2 => OK
-		 *	== 2 (PMDA_FETCH_DYNAMIC) => OK and free(atom.vp)
-		 *	     after __pmStuffValue() called
-		 */
-		if ((version == PMDA_INTERFACE_2) || (version >= PMDA_INTERFACE_3 && sts > 0)) {
-
-		    if ((lsts = __pmStuffValue(&atom, &vset->vlist[j], type)) == PM_ERR_TYPE) {
-			pmNotifyErr(LOG_ERR, "pmdaFetch: Descriptor type (%s) for metric %s is bad",
-				    pmTypeStr_r(type, strbuf, sizeof(strbuf)),
-				    pmIDStr_r(dp->pmid, idbuf, sizeof(idbuf)));
-		    }
-		    else if (lsts >= 0) {
-			vset->valfmt = lsts;
-			j++;
-		    }
-		    if (version >= PMDA_INTERFACE_5 && sts == PMDA_FETCH_DYNAMIC) {
-			if (type == PM_TYPE_STRING)
-			    free(atom.cp);
-			else if (type == PM_TYPE_AGGREGATE)
-			    free(atom.vbp);
-			else {
-			    pmNotifyErr(LOG_WARNING, "pmdaFetch: Attempt to free value for metric %s of wrong type %s\n",
-					pmIDStr_r(dp->pmid, idbuf, sizeof(idbuf)),
-					pmTypeStr_r(type, strbuf, sizeof(strbuf)));
-			}
-		    }
-		    if (lsts < 0)
-			sts = lsts;
-		}
-	    }
+	    sts = (*(pmda->e_fetchCallBack))(metap, inst, &atom);
+	    sts = __pmdaFetchValue(version, dp, inst, sts, &atom, vset, &j);
 	} while (dp->indom != PM_INDOM_NULL && __pmdaNextInst(&inst, pmda));
 
 	if (j == 0)
@@ -700,6 +1124,7 @@ pmdaFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 	    vset->numval = j;
     }
 
+done:
     /* success, we will send this PDU - safe to clear flags */
     pmda->e_flags &= ~PMDA_STATUS_CHANGE;
     *resp = extp->res;
@@ -37,6 +37,16 @@ typedef struct {
     int			ndynamics;	/* number of dynamics entries, below */
     struct dynamic	*dynamics;	/* dynamic metric manipulation table */
     void		*privdata;	/* private (user) data for this PMDA */
+    pmdaFetchInDomCallBack indomCallBack; /* optional bulk fetch callback */
+    int			maxninst;	/* high-water allocation for the */
+    unsigned int	*instlist;	/* instance, value and status arrays */
+    pmAtomValue		*atomlist;	/* passed to indomCallBack */
+    int			*stslist;
+    pmdaFetchBatchCallBack batchCallBack; /* optional batched fetch callback */
+    pmdaFetchBatch	batch;		/* arguments to batchCallBack, with */
+    pmdaMetric		*batchmeta;	/* per-pmid metric table entries */
+    int			maxnbatch;	/* high-water allocation for batch */
+    int			daemon;		/* pmdaDaemon (not pmdaDSO) PMDA */
 } e_ext_t;
 
 /*
@@ -527,6 +527,38 @@ pmdaSetFetchCallBack(pmdaInterface *dispatch, pmdaFetchCallBack callback)
     }
 }
 
+void
+pmdaSetFetchInDomCallBack(pmdaInterface *dispatch, pmdaFetchInDomCallBack callback)
+{
+    e_ext_t	*extp;
+
+    if (HAVE_V_FIVE(dispatch->comm.pmda_interface)) {
+	extp = (e_ext_t *)dispatch->version.any.ext->e_ext;
+	extp->indomCallBack = callback;
+    }
+    else {
+	pmNotifyErr(LOG_CRIT, "Unable to set fetch indom callback for PMDA interface version %d.",
+		     dispatch->comm.pmda_interface);
+	dispatch->status = PM_ERR_GENERIC;
+    }
+}
+
+void
+pmdaSetFetchBatchCallBack(pmdaInterface *dispatch, pmdaFetchBatchCallBack callback)
+{
+    e_ext_t	*extp;
+
+    if (HAVE_V_FIVE(dispatch->comm.pmda_interface)) {
+	extp = (e_ext_t *)dispatch->version.any.ext->e_ext;
+	extp->batchCallBack = callback;
+    }
+    else {
+	pmNotifyErr(LOG_CRIT, "Unable to set fetch batch callback for PMDA interface version %d.",
+		     dispatch->comm.pmda_interface);
+	dispatch->status = PM_ERR_GENERIC;
+    }
+}
+
 void
 pmdaSetCheckCallBack(pmdaInterface *dispatch, pmdaCheckCallBack callback)
 {
@@ -1034,6 +1034,7 @@ pmdaDaemon(pmdaInterface *dispatch, int version, const char *name, int domain,
 	return;
 
     pmda = dispatch->version.any.ext;
+    ((e_ext_t *)pmda->e_ext)->daemon = 1;
     pmda->e_logfile = (logfile == NULL ? NULL : strdup(logfile));
     pmda->e_helptext = (helptext == NULL ? NULL : strdup(helptext));
 
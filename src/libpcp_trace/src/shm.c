@@ -0,0 +1,369 @@
+/*
+ * shm.c - shared memory transport between libpcp_trace and pmdatrace
+ *
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+/*
+ * Each traced process writes its events into a ring of fixed size
+ * slots in a file below $PCP_TMP_DIR/trace, named for the process ID,
+ * which pmdatrace maps read-only and drains on its own schedule.
+ *
+ * Writers (any number of threads) claim a position by incrementing
+ * the shared head, then claim the slot for that position with a single
+ * compare-and-swap of its sequence number, from that of an earlier lap
+ * to TRACE_SHM_BUSY tagged with position+1, fill it in and publish it
+ * by storing position+1 in the sequence number.  So a slot is always
+ * owned by exactly one position, and a writer that has been lapped
+ * cannot take over a slot already claimed for a later position.  There
+ * are no locks and no system calls, and a writer never waits - if the
+ * reader falls behind older events are overwritten, and if the slot is
+ * still being written by another thread (or has moved on) the new
+ * event is simply dropped.
+ *
+ * The writer holds a write lock on the file for as long as it runs,
+ * which identifies the process that owns the ring to the reader (the
+ * descriptor stays open, as closing any descriptor for the file would
+ * release the lock).
+ *
+ * The reader keeps its own tail (so the ring never needs to be
+ * writable by pmdatrace) and detects lost events from gaps in the
+ * sequence numbers, reading each slot seqlock-style so an event that
+ * is overwritten while it is being copied is discarded, not torn.
+ */
+
+#include "pmapi.h"
+#include "libpcp.h"
+#include "trace.h"
+#include "trace_dev.h"
+
+#ifdef __ATOMIC_RELAXED
+#define shm_atomic_inc(p)	__atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
+#define shm_atomic_load(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define shm_atomic_store(p, n)	__atomic_store_n((p), (n), __ATOMIC_RELEASE)
+#define shm_atomic_cas(p, o, n)	__atomic_compare_exchange_n((p), (o), (n), \
+				    0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#define shm_barrier()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+#define shm_atomic_inc(p)	((*(p))++)
+#define shm_atomic_load(p)	(*(p))
+#define shm_atomic_store(p, n)	(*(p) = (n))
+#define shm_atomic_cas(p, o, n)	(*(p) = (n), 1)
+#define shm_barrier()		do { } while (0)
+#endif
+
+static __pmTraceShmHdr	*shmhdr;	/* this process' ring, once mapped */
+static int		shmfd = -1;	/* holds the lock on the ring file */
+static __pmTraceShmSlot	*shmslot;
+static size_t		shmsize;
+static int		shmslots;	/* from $PCP_TRACE_SHM */
+
+/*
+ * Directory for the ring buffer files, created by pmdatrace.
+ */
+char *
+__pmtraceshmdir(char *buf, size_t buflen)
+{
+    int		sep = pmPathSeparator();
+
+    pmsprintf(buf, buflen, "%s%c" "trace", pmGetConfig("PCP_TMP_DIR"), sep);
+    return buf;
+}
+
+static size_t
+shm_size(unsigned int nslots)
+{
+    return sizeof(__pmTraceShmHdr) + nslots * sizeof(__pmTraceShmSlot);
+}
+
+/*
+ * Create and map the ring buffer for this process, if requested via
+ * $PCP_TRACE_SHM.  Returns 1 if the shared memory transport is ready,
+ * 0 if it is not requested, else a negative error code (and the
+ * caller falls back to the socket transport).
+ *
+ * Called again after a fork(), when the ring belongs to the parent.
+ */
+int
+__pmtraceshmopen(void)
+{
+    char		dir[MAXPATHLEN];
+    char		path[MAXPATHLEN];
+    char		*env, *end;
+    __pmTraceShmHdr	*hdr;
+#ifdef F_SETLK
+    struct flock	lock;
+#endif
+    mode_t		cur_umask;
+    size_t		size;
+    long		n;
+    int			nslots;
+    int			fd, sts;
+
+    if (shmslots == 0) {
+	if ((env = getenv(TRACE_ENV_SHM)) == NULL)
+	    return 0;
+	n = strtol(env, &end, 10);
+	if (*end != '\0' || n <= 0)
+	    n = TRACE_SHM_SLOTS;
+	else if (n > TRACE_SHM_MAXSLOTS)
+	    n = TRACE_SHM_MAXSLOTS;
+	for (nslots = 1; nslots < n; nslots <<= 1)
+	    ;
+	shmslots = nslots;
+    }
+    if (shmhdr != NULL) {
+	/* mapping inherited across fork(), the parent still owns it */
+	__pmMemoryUnmap(shmhdr, shmsize);
+	shmhdr = NULL;
+	shmslot = NULL;
+    }
+    if (shmfd >= 0) {
+	/* the parent's lock is not inherited, nor released by this */
+	close(shmfd);
+	shmfd = -1;
+    }
+
+    size = shm_size(shmslots);
+    pmsprintf(path, sizeof(path), "%s%c%" FMT_PID,
+		__pmtraceshmdir(dir, sizeof(dir)), pmPathSeparator(), (pid_t)getpid());
+    unlink(path);
+    cur_umask = umask(S_IWGRP | S_IWOTH);
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    umask(cur_umask);
+    if (fd < 0) {
+	sts = -oserror();
+#ifdef PMTRACE_DEBUG
+	if (__pmstate & PMTRACE_STATE_COMMS)
+	    fprintf(stderr, "__pmtraceshmopen: cannot create %s: %s\n",
+			    path, pmErrStr(sts));
+#endif
+	return sts;
+    }
+#ifdef F_SETLK
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(fd, F_SETLK, &lock) < 0) {
+	sts = -oserror();
+	close(fd);
+	unlink(path);
+	return sts;
+    }
+#endif
+    if (ftruncate(fd, size) < 0) {
+	sts = -oserror();
+	close(fd);
+	unlink(path);
+	return sts;
+    }
+    if ((hdr = (__pmTraceShmHdr *)__pmMemoryMap(fd, size, 1)) == NULL) {
+	sts = -oserror();
+	close(fd);
+	unlink(path);
+	return sts;
+    }
+    shmfd = fd;
+
+    /* file is zero-filled, so all slots start out unwritten (seq 0) */
+    hdr->version = TRACE_SHM_VERSION;
+    hdr->pid = (__int32_t)getpid();
+    hdr->nslots = shmslots;
+    hdr->head = 0;
+    shm_atomic_store(&hdr->magic, TRACE_SHM_MAGIC);
+
+    shmhdr = hdr;
+    shmslot = (__pmTraceShmSlot *)&hdr[1];
+    shmsize = size;
+
+#ifdef PMTRACE_DEBUG
+    if (__pmstate & PMTRACE_STATE_COMMS)
+	fprintf(stderr, "__pmtraceshmopen: %d slot ring buffer %s\n",
+			shmslots, path);
+#endif
+    return 1;
+}
+
+/*
+ * Append one event to this process' ring buffer, never blocking.
+ */
+int
+__pmtraceshmpost(const char *tag, int taglen, int type, double value)
+{
+    __pmTraceShmSlot	*sp;
+    __uint64_t		pos, seq;
+    int			sts;
+
+    if (shmhdr == NULL || shmhdr->pid != (__int32_t)getpid()) {
+	/* first event, or first event in a child process */
+	if ((sts = __pmtraceshmopen()) <= 0)
+	    return sts < 0 ? sts : PMTRACE_ERR_IPC;
+    }
+
+    pos = shm_atomic_inc(&shmhdr->head);
+    sp = &shmslot[pos & (shmhdr->nslots - 1)];
+    seq = shm_atomic_load(&sp->seq);
+    if ((seq & TRACE_SHM_BUSY) || seq > pos ||
+	!shm_atomic_cas(&sp->seq, &seq, TRACE_SHM_BUSY | (pos + 1))) {
+	/*
+	 * another writer is still filling this slot, or the ring has
+	 * lapped this writer and the slot belongs to a later position,
+	 * drop this event (the reader counts it as lost)
+	 */
+#ifdef PMTRACE_DEBUG
+	if (__pmstate & PMTRACE_STATE_API)
+	    fprintf(stderr, "__pmtraceshmpost: '%s' dropped, slot busy\n", tag);
+#endif
+	return 0;
+    }
+    shm_barrier();
+    sp->type = type;
+    sp->taglen = taglen;
+    sp->value = value;
+    memcpy(sp->tag, tag, taglen);
+    shm_atomic_store(&sp->seq, pos + 1);
+    return 0;
+}
+
+/*
+ * Reader side, for pmdatrace.  Map an existing ring buffer read-only.
+ */
+int
+__pmtraceshmattach(const char *path, __pmTraceShmReader *rp)
+{
+    __pmTraceShmHdr	hdr;
+    struct stat		sbuf;
+    size_t		size;
+    void		*addr;
+    int			fd, sts;
+#ifdef F_GETLK
+    struct flock	lock;
+#endif
+
+    memset(rp, 0, sizeof(*rp));
+    if ((fd = open(path, O_RDONLY)) < 0)
+	return -oserror();
+    if (fstat(fd, &sbuf) < 0) {
+	sts = -oserror();
+	close(fd);
+	return sts;
+    }
+    if (sbuf.st_size < (off_t)sizeof(hdr) ||
+	read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	hdr.magic != TRACE_SHM_MAGIC) {
+	/* not (yet) a ring buffer, writer may still be initialising */
+	close(fd);
+	return -EAGAIN;
+    }
+    size = shm_size(hdr.nslots);
+    if (hdr.version != TRACE_SHM_VERSION || hdr.nslots == 0 ||
+	(hdr.nslots & (hdr.nslots - 1)) != 0 ||
+	hdr.nslots > TRACE_SHM_MAXSLOTS || sbuf.st_size < (off_t)size) {
+	close(fd);
+	return PMTRACE_ERR_VERSION;
+    }
+#ifdef F_GETLK
+    /* the process holding the write lock is the one writing the ring */
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_RDLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(fd, F_GETLK, &lock) == 0 && lock.l_type == F_WRLCK)
+	rp->owner = (__int32_t)lock.l_pid;
+#else
+    rp->owner = hdr.pid;
+#endif
+    addr = __pmMemoryMap(fd, size, 0);
+    sts = (addr == NULL) ? -oserror() : 0;
+    close(fd);
+    if (addr == NULL)
+	return sts;
+
+    rp->hdr = (__pmTraceShmHdr *)addr;
+    rp->slot = (__pmTraceShmSlot *)&rp->hdr[1];
+    rp->size = size;
+    rp->nslots = hdr.nslots;
+    rp->pid = hdr.pid;
+    /* start with whatever is still in the ring */
+    rp->tail = shm_atomic_load(&rp->hdr->head);
+    rp->tail = rp->tail > rp->nslots ? rp->tail - rp->nslots : 0;
+    return 0;
+}
+
+void
+__pmtraceshmdetach(__pmTraceShmReader *rp)
+{
+    if (rp->hdr != NULL)
+	__pmMemoryUnmap(rp->hdr, rp->size);
+    rp->hdr = NULL;
+    rp->slot = NULL;
+}
+
+/*
+ * Copy the next event out of the ring into *slotp.  Returns 1 if an
+ * event was read, 0 if there are no more complete events right now.
+ *
+ * A slot that is claimed but not yet published is waited for once,
+ * i.e. until the next call that finds it still incomplete, after which
+ * the event is counted as lost - so a writer that dropped its event,
+ * or died part way through, does not stall the reader.
+ */
+int
+__pmtraceshmread(__pmTraceShmReader *rp, __pmTraceShmSlot *slotp)
+{
+    __pmTraceShmSlot	*sp;
+    __uint64_t		head, seq;
+
+    for ( ; ; ) {
+	head = shm_atomic_load(&rp->hdr->head);
+	if (rp->tail >= head)
+	    return 0;
+	if (head - rp->tail > rp->nslots) {
+	    /* overwritten before they could be read */
+	    rp->lost += head - rp->nslots - rp->tail;
+	    rp->tail = head - rp->nslots;
+	}
+	sp = &rp->slot[rp->tail & (rp->nslots - 1)];
+	seq = shm_atomic_load(&sp->seq);
+	if (seq == rp->tail + 1) {
+	    memcpy(slotp, sp, sizeof(*slotp));
+	    shm_barrier();
+	    rp->tail++;
+	    rp->stall = 0;
+	    if (shm_atomic_load(&sp->seq) != seq ||
+		slotp->type < TRACE_FIRST_TYPE ||
+		slotp->type > TRACE_LAST_TYPE ||
+		slotp->taglen < 2 || slotp->taglen > MAXTAGNAMELEN ||
+		slotp->tag[slotp->taglen - 1] != '\0') {
+		/* overwritten while copying, or garbage */
+		rp->lost++;
+		continue;
+	    }
+	    return 1;
+	}
+	if ((seq & ~TRACE_SHM_BUSY) > rp->tail + 1) {
+	    /* lapped since head was read */
+	    rp->lost++;
+	    rp->tail++;
+	    continue;
+	}
+	/* claimed but not yet published, or not yet claimed */
+	if (rp->stall == rp->tail + 1) {
+	    rp->lost++;
+	    rp->tail++;
+	    rp->stall = 0;
+	    continue;
+	}
+	rp->stall = rp->tail + 1;
+	return 0;
+    }
+}
@@ -33,6 +33,7 @@
 
 static int	_pmtimedout = 1;
 static time_t	_pmttimeout = 0;
+static int	_pmtraceshm;	/* 1 => shared memory transport, see shm.c */
 
 static int _pmtraceconnect(int);
 static int _pmtracereconnect(void);
@@ -233,6 +234,14 @@ pmtraceend(const char *tag)
 	hptr->inprogress = 0;
 	hptr->data = pmtimevalSub(&now, &hptr->start);
 
+	if (_pmtraceshm) {
+	    sts = __pmtraceshmpost(hptr->tag, hptr->taglength,
+					TRACE_TYPE_TRANSACT, hptr->data);
+	    if (TRACE_UNLOCK != 0)
+		return -oserror();
+	    return sts;
+	}
+
 	if (sts >= 0 && _pmtimedout) {
 	    sts = _pmtracereconnect();
 	    sts = _pmtraceremaperr(sts);
@@ -337,6 +346,10 @@ _pmtracecommon(const char *label, double value, int type)
     }
     first = 0;
 
+    /* no PDU, no ack and no lock - straight into the ring buffer */
+    if (_pmtraceshm)
+	return __pmtraceshmpost(label, taglength, type, value);
+
     TRACE_LOCK;
 
     if (sts >= 0 && _pmtimedout) {
@@ -661,8 +674,25 @@ _pmtraceconnect(int doit)
 	TRACE_LOCK;
 	sts = __pmhashinit(&_pmtable, 0, sizeof(_pmTraceLibdata),
 						_pmlibcmp, _pmlibdel);
-    if (TRACE_UNLOCK != 0)
-	return -oserror();
+	if (TRACE_UNLOCK != 0)
+	    return -oserror();
+	if (sts >= 0) {
+	    if ((sts = __pmtraceshmopen()) > 0) {
+		/* shared memory transport, there is no PMDA connection */
+		_pmtraceshm = 1;
+		_pmtimedout = 0;
+		__pmtraceprotocol(TRACE_PROTOCOL_FINAL);
+		return 0;
+	    }
+	    if (sts < 0) {
+#ifdef PMTRACE_DEBUG
+		if (__pmstate & PMTRACE_STATE_COMMS)
+		    fprintf(stderr, "_pmtraceconnect: shared memory transport "
+			"unavailable, using sockets: %s\n", pmtraceerrstr(sts));
+#endif
+		sts = 0;
+	    }
+	}
     }
     else if (__pmtraceprotocol(TRACE_PROTOCOL_QUERY) == TRACE_PROTOCOL_ASYNC)
 	return PMTRACE_ERR_IPC;
@@ -36,6 +36,7 @@ typedef struct context {
     sds			username;	/* authentication information */
     sds			password;	/* authentication information */
     sds			realm;		/* authentication information */
+    sds			pool;		/* shared pmcd connection identity */
     unsigned char	hostid[20];	/* SHA1 of host identifier */
     double		location[2];	/* latitude and longitude */
     unsigned int	type	: 8;	/* PMAPI context type */
@@ -43,7 +44,8 @@ typedef struct context {
     unsigned int	cached	: 1;	/* context/source in cache */
     unsigned int	garbage	: 1;	/* context pending removal */
     unsigned int	updated : 1;	/* context labels are updated */
-    unsigned int	padding : 4;	/* zero-filled struct padding */
+    unsigned int	shared	: 1;	/* share pmcd connection (HOST) */
+    unsigned int	padding : 3;	/* zero-filled struct padding */
     unsigned int	refcount : 16;	/* currently-referenced counter */
     unsigned int	timeout;	/* context timeout in milliseconds */
     uv_timer_t		timer;
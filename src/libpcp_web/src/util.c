@@ -603,10 +603,16 @@ pmwebapi_new_context(context_t *cp)
     char		labels[PM_MAXLABELJSONLEN];
     char		pmmsg[PM_MAXERRMSGLEN];
     sds			msg = NULL;
-    int			sts;
+    int			sts, type = cp->type;
+
+    if (cp->shared)
+	type |= PM_CTXFLAG_SHARED;
+    /* fetched values are copied out, results only go to pmFreeResult */
+    if (cp->type == PM_CONTEXT_HOST)
+	type |= PM_CTXFLAG_ARENA;
 
     /* establish PMAPI context */
-    if ((sts = cp->context = pmNewContext(cp->type, cp->name.sds)) < 0) {
+    if ((sts = cp->context = pmNewContext(type, cp->name.sds)) < 0) {
 	if (cp->type == PM_CONTEXT_HOST)
 	    infofmt(msg, "cannot connect to PMCD: %s",
 		    pmErrStr_r(sts, pmmsg, sizeof(pmmsg)));
@@ -717,6 +723,7 @@ pmwebapi_release_context(context_t *cp)
     sdsfree(cp->username);
     sdsfree(cp->password);
     sdsfree(cp->realm);
+    sdsfree(cp->pool);
 
     sdsfree(cp->labels);
     if (cp->labelset)
@@ -14,6 +14,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include "pmapi.h"
+#include "libpcp.h"
 #include "pmda.h"
 #include "schema.h"
 #include "util.h"
@@ -32,19 +33,22 @@ static unsigned int default_timeout;	/* timeout in milliseconds */
 #define DEFAULT_BATCHSIZE 256
 static unsigned int default_batchsize;	/* for groups of metrics */
 
+static unsigned int default_shared = 1;	/* share pmcd host connections */
+
 /* constant string keys (initialized during setup) */
 static sds PARAM_HOSTNAME, PARAM_HOSTSPEC, PARAM_CTXNUM, PARAM_CTXID,
            PARAM_POLLTIME, PARAM_PREFIX, PARAM_MNAME, PARAM_MNAMES,
            PARAM_PMIDS, PARAM_PMID, PARAM_INDOM, PARAM_INSTANCE,
            PARAM_INAME, PARAM_MVALUE, PARAM_TARGET, PARAM_EXPR, PARAM_MATCH;
 static sds AUTH_USERNAME, AUTH_PASSWORD;
-static sds EMPTYSTRING, LOCALHOST, WORK_TIMER, POLL_TIMEOUT, BATCHSIZE;
+static sds EMPTYSTRING, LOCALHOST, WORK_TIMER, POLL_TIMEOUT, BATCHSIZE, SHARED;
 
 enum matches { MATCH_EXACT, MATCH_GLOB, MATCH_REGEX };
 enum profile { PROFILE_ADD, PROFILE_DEL };
 
 typedef struct webgroups {
     struct dict		*contexts;
+    struct dict		*pool;		/* connection: count of shared contexts */
     mmv_registry_t	*metrics;
     void		*metrics_handle;
     struct dict		*config;
@@ -79,6 +83,64 @@ webgroup_deref_context(struct context *cp)
     return (--cp->refcount > 0);
 }
 
+/*
+ * Account for web contexts sharing pmcd connections - libpcp decides
+ * which PM_CTXFLAG_SHARED contexts share a connection, so the pool is
+ * keyed on the identity of the connection libpcp actually chose, and
+ * reuse is reported from its reference count (which includes contexts
+ * created outside of this webgroup).
+ */
+static void
+webgroup_pool_add(struct webgroups *groups, struct context *cp)
+{
+    __pmContext		*ctxp;
+    dictEntry		*entry, *existing = NULL;
+    int			refcnt = 0;
+
+    if ((ctxp = __pmHandleToPtr(cp->context)) == NULL)
+	return;
+    if (ctxp->c_pmcd != NULL) {
+	cp->pool = sdscatprintf(sdsempty(), "%p", (void *)ctxp->c_pmcd);
+	refcnt = ctxp->c_pmcd->pc_refcnt;
+    }
+    PM_UNLOCK(ctxp->c_lock);
+    if (cp->pool == NULL)
+	return;
+
+    uv_mutex_lock(&groups->mutex);
+    if ((entry = dictAddRaw(groups->pool, cp->pool, &existing)) != NULL)
+	dictSetSignedIntegerVal(entry, 1);
+    else if (existing != NULL)
+	dictSetSignedIntegerVal(existing, dictGetSignedIntegerVal(existing) + 1);
+    uv_mutex_unlock(&groups->mutex);
+
+    if (pmDebugOptions.libweb)
+	fprintf(stderr, "context %d: pool connection %s [refcount=%d]%s\n",
+		cp->context, cp->pool, refcnt, existing ? " reused" : "");
+    if ((existing != NULL || refcnt > 1) && groups->metrics_handle)
+	mmv_stats_inc(groups->metrics_handle, "pool.reused", NULL);
+}
+
+static void
+webgroup_pool_drop(struct webgroups *groups, struct context *cp)
+{
+    dictEntry		*entry;
+
+    if (cp->pool == NULL)
+	return;
+
+    uv_mutex_lock(&groups->mutex);
+    if ((entry = dictFind(groups->pool, cp->pool)) != NULL) {
+	if (dictGetSignedIntegerVal(entry) > 1)
+	    dictSetSignedIntegerVal(entry, dictGetSignedIntegerVal(entry) - 1);
+	else
+	    dictDelete(groups->pool, cp->pool);
+    }
+    uv_mutex_unlock(&groups->mutex);
+    sdsfree(cp->pool);
+    cp->pool = NULL;
+}
+
 static void
 webgroup_release_context(uv_handle_t *handle)
 {
@@ -106,6 +168,8 @@ webgroup_drop_context(struct context *context, struct webgroups *groups)
 	    uv_mutex_lock(&groups->mutex);
 	    dictDelete(groups->contexts, &context->randomid);
 	    uv_mutex_unlock(&groups->mutex);
+	    if (context->shared)
+		webgroup_pool_drop(groups, context);
 	}
 	uv_close((uv_handle_t *)&context->timer, webgroup_release_context);
     }
@@ -215,6 +279,7 @@ webgroup_new_context(pmWebGroupSettings *sp, dict *params,
 	return NULL;
     }
     cp->type = PM_CONTEXT_HOST;
+    cp->shared = default_shared;
     cp->context = -1;
     cp->timeout = polltime;
 
@@ -259,6 +324,8 @@ webgroup_new_context(pmWebGroupSettings *sp, dict *params,
     uv_mutex_lock(&groups->mutex);
     dictAdd(groups->contexts, &cp->randomid, cp);
     uv_mutex_unlock(&groups->mutex);
+    if (cp->shared)
+	webgroup_pool_add(groups, cp);
 
     /* leave until the end because uv_timer_init makes this visible in uv_run */
     handle = (uv_handle_t *)&cp->timer;
@@ -310,6 +377,9 @@ static void
 refresh_maps_metrics(void *data)
 {
     struct webgroups	*groups = (struct webgroups *)data;
+    dictIterator	*iterator;
+    dictEntry		*entry;
+    unsigned int	connections, contexts = 0;
 
     if (groups->metrics_handle) {
 	mmv_stats_set(groups->metrics_handle, "contextmap.size",
@@ -320,6 +390,18 @@ refresh_maps_metrics(void *data)
 	    NULL, dictSize(labelsmap));
 	mmv_stats_set(groups->metrics_handle, "instmap.size",
 	    NULL, dictSize(instmap));
+
+	uv_mutex_lock(&groups->mutex);
+	connections = dictSize(groups->pool);
+	iterator = dictGetIterator(groups->pool);
+	while ((entry = dictNext(iterator)) != NULL)
+	    contexts += dictGetSignedIntegerVal(entry);
+	dictReleaseIterator(iterator);
+	uv_mutex_unlock(&groups->mutex);
+	mmv_stats_set(groups->metrics_handle, "pool.connections",
+	    NULL, connections);
+	mmv_stats_set(groups->metrics_handle, "pool.contexts",
+	    NULL, contexts);
     }
 }
 
@@ -2246,6 +2328,7 @@ pmWebGroupSetup(pmWebGroupModule *module)
     WORK_TIMER = sdsnew("pmwebapi.work");
     POLL_TIMEOUT = sdsnew("pmwebapi.timeout");
     BATCHSIZE = sdsnew("pmwebapi.batchsize");
+    SHARED = sdsnew("pmwebapi.shared");
     AUTH_USERNAME = sdsnew("auth.username");
     AUTH_PASSWORD = sdsnew("auth.password");
 
@@ -2256,6 +2339,8 @@ pmWebGroupSetup(pmWebGroupModule *module)
 
     /* setup a dictionary mapping context number to data */
     groups->contexts = dictCreate(&intKeyDictCallBacks, NULL);
+    /* and hostspecs to counts of contexts sharing pmcd connections */
+    groups->pool = dictCreate(&sdsKeyDictCallBacks, NULL);
 
     return 0;
 }
@@ -2303,6 +2388,11 @@ pmWebGroupSetConfiguration(pmWebGroupModule *module, dict *config)
 	    default_batchsize = DEFAULT_BATCHSIZE;
     }
 
+    if ((value = dictFetchValue(config, SHARED)) == NULL)
+	default_shared = 1;
+    else
+	default_shared = (strcasecmp(value, "false") != 0);
+
     if (groups) {
 	groups->config = config;
 	return 0;
@@ -2315,6 +2405,7 @@ pmWebGroupSetupMetrics(pmWebGroupModule *module)
 {
     struct webgroups	*groups = webgroups_lookup(module);
     pmUnits            nounits = MMV_UNITS(0,0,0,0,0,0);
+    pmUnits            countunits = MMV_UNITS(0,0,1,0,0,0);
     pmInDom            noindom = MMV_INDOM_NULL;
 
     if (groups == NULL || groups->metrics == NULL)
@@ -2343,6 +2434,26 @@ pmWebGroupSetupMetrics(pmWebGroupModule *module)
 	"instance name map dictionary size",
 	"number of entries in the instance name map dictionary");
 
+    /*
+     * Shared pmcd connection pool metrics
+     */
+    mmv_stats_add_metric(groups->metrics, "pool.connections", 5,
+	MMV_TYPE_U32, MMV_SEM_INSTANT, nounits, noindom,
+	"pmcd connections shared by web contexts",
+	"number of distinct pmcd host connections in use by web contexts\n"
+	"created with connection sharing enabled (pmwebapi.shared)");
+
+    mmv_stats_add_metric(groups->metrics, "pool.contexts", 6,
+	MMV_TYPE_U32, MMV_SEM_INSTANT, nounits, noindom,
+	"web contexts using shared pmcd connections",
+	"number of web contexts using the shared pmcd host connections");
+
+    mmv_stats_add_metric(groups->metrics, "pool.reused", 7,
+	MMV_TYPE_U64, MMV_SEM_COUNTER, countunits, noindom,
+	"web contexts reusing an existing pmcd connection",
+	"count of new web contexts that shared an existing pmcd connection\n"
+	"rather than establishing a new one");
+
     groups->metrics_handle = mmv_stats_start(groups->metrics);
 }
 
@@ -2380,6 +2491,7 @@ pmWebGroupClose(pmWebGroupModule *module)
 	    webgroup_drop_context((context_t *)dictGetVal(entry), NULL);
 	dictReleaseIterator(iterator);
 	dictRelease(groups->contexts);
+	dictRelease(groups->pool);
 	memset(groups, 0, sizeof(struct webgroups));
 	free(groups);
     }
@@ -2408,6 +2520,7 @@ pmWebGroupClose(pmWebGroupModule *module)
     sdsfree(WORK_TIMER);
     sdsfree(POLL_TIMEOUT);
     sdsfree(BATCHSIZE);
+    sdsfree(SHARED);
     sdsfree(AUTH_USERNAME);
     sdsfree(AUTH_PASSWORD);
 }
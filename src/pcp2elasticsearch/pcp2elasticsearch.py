@@ -33,6 +33,7 @@ import requests
 # PCP Python PMAPI
 from pcp import pmapi, pmconfig
 from cpmapi import PM_CONTEXT_ARCHIVE, PM_IN_NULL, PM_DEBUG_APPL1, PM_TIME_MSEC
+from cpmapi import PM_OPTFLAG_MULTI
 
 if sys.version_info[0] >= 3:
     long = int # pylint: disable=redefined-builtin
@@ -135,6 +136,7 @@ class pcp2elasticsearch(object):
     def options(self):
         """ Setup default command line argument option handling """
         opts = pmapi.pmOptions()
+        opts.pmSetOptionFlags(opts.pmGetOptionFlags() | PM_OPTFLAG_MULTI)
         opts.pmSetOptionCallback(self.option)
         opts.pmSetOverrideCallback(self.option_override)
         opts.pmSetShortOptions("a:h:LK:c:Ce:D:V?HGA:S:T:O:s:t:rRIi:jJ:4:58:9:nN:vmP:0:q:b:y:Q:B:Y:g:x:X:p:")
@@ -145,6 +147,7 @@ class pcp2elasticsearch(object):
         opts.pmSetLongOptionArchiveFolio() # --archive-folio
         opts.pmSetLongOptionContainer()    # --container
         opts.pmSetLongOptionHost()         # -h/--host
+        opts.pmSetLongOptionHostList()     # --host-list
         opts.pmSetLongOptionLocalPMDA()    # -L/--local-PMDA
         opts.pmSetLongOptionSpecLocal()    # -K/--spec-local
         opts.pmSetLongOption("config", 1, "c", "FILE", "config file path")
@@ -413,16 +416,24 @@ class pcp2elasticsearch(object):
             self.es_failed = True
             return
 
-        # Assemble all metrics into a single document
+        # Assemble all metrics of each host into a single document
         # Use @-prefixed keys for metadata not coming in from PCP metrics
-        es_doc = {'@host-id': self.es_hostid, '@timestamp': long(ts)}
+        host_results = self.pmconfig.get_host_results(valid_only=True)
+        for i, host in enumerate(host_results):
+            # Labels are only tracked for the primary host
+            if i == 0:
+                self.write_es_doc(self.es_hostid, ts, host_results[host], headers, self.include_labels)
+            else:
+                self.write_es_doc(host, ts, host_results[host], headers, False)
+
+    def write_es_doc(self, hostid, ts, results, headers, include_labels):
+        """ Write (send) metrics of one host to Elasticsearch host """
+        es_doc = {'@host-id': hostid, '@timestamp': long(ts)}
 
         insts_key = "@instances"
         inst_key = "@id"
         labels_key = "@labels"
 
-        results = self.pmconfig.get_ranked_results(valid_only=True)
-
         for metric in results:
             # Install value into outgoing json/dict in key1{key2{key3=value}} style:
             # foo.bar.baz=value    =>  foo: { bar: { baz: value ...} }
@@ -437,7 +448,7 @@ class pcp2elasticsearch(object):
             # Find/create the parent dictionary into which to insert the final component
             for inst, name, value in results[metric]:
                 labels = None
-                if self.include_labels:
+                if include_labels:
                     labels = self.pmconfig.get_labels_str(metric, inst)
                 if isinstance(value, long):
                     if value > (self.maxlong - 1) or value < (-self.maxlong):
@@ -456,7 +467,7 @@ class pcp2elasticsearch(object):
                 last_part = pmns_parts[-1]
 
                 if inst == PM_IN_NULL:
-                    if self.include_labels:
+                    if include_labels:
                         value = value, labels
                     pmns_leaf_dict[last_part] = value
                 else:
@@ -468,11 +479,11 @@ class pcp2elasticsearch(object):
                     for j in range(0, len(insts)):
                         if insts[j][inst_key] == name:
                             insts[j][last_part] = value
-                            if self.include_labels:
+                            if include_labels:
                                 insts[j][labels_key] = labels
                             found = True
                     if not found:
-                        if self.include_labels:
+                        if include_labels:
                             insts.append({inst_key: name, last_part: value, labels_key: labels})
                         else:
                             insts.append({inst_key: name, last_part: value})
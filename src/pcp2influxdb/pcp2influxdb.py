@@ -35,6 +35,7 @@ import requests
 # PCP Python PMAPI
 from pcp import pmapi, pmconfig
 from cpmapi import PM_CONTEXT_ARCHIVE, PM_DEBUG_APPL1, PM_TIME_NSEC
+from cpmapi import PM_OPTFLAG_MULTI
 
 if sys.version_info[0] >= 3:
     long = int # pylint: disable=redefined-builtin
@@ -236,6 +237,7 @@ class PCP2InfluxDB(object):
     def options(self):
         """ Setup default command line argument option handling """
         opts = pmapi.pmOptions()
+        opts.pmSetOptionFlags(opts.pmGetOptionFlags() | PM_OPTFLAG_MULTI)
         opts.pmSetOptionCallback(self.option)
         opts.pmSetOverrideCallback(self.option_override)
         opts.pmSetShortOptions("a:h:LK:c:Ce:D:V?HGA:S:T:O:s:t:rRIi:jJ:4:58:9:nN:vP:0:q:b:y:Q:B:Y:g:x:U:E:X:")
@@ -246,6 +248,7 @@ class PCP2InfluxDB(object):
         opts.pmSetLongOptionArchiveFolio() # --archive-folio
         opts.pmSetLongOptionContainer()    # --container
         opts.pmSetLongOptionHost()         # -h/--host
+        opts.pmSetLongOptionHostList()     # --host-list
         opts.pmSetLongOptionLocalPMDA()    # -L/--local-PMDA
         opts.pmSetLongOptionSpecLocal()    # -K/--spec-local
         opts.pmSetLongOption("config", 1, "c", "FILE", "config file path")
@@ -496,24 +499,28 @@ class PCP2InfluxDB(object):
             """ Sanitize instance domain string for InfluxDB """
             return "_" + re.sub('[^a-zA-Z_0-9-]', '_', string)
 
-        results = self.pmconfig.get_ranked_results(valid_only=True)
+        results = self.pmconfig.get_host_results(valid_only=True)
 
         # Prepare data for easier processing below
         metrics = []
-        for metric in results:
-            tmp = Metric(metric)
-            for _, name, value in results[metric]:
-                suffix = sanitize_name_indom(name) if name else "value"
-                value = round(value, self.metrics[metric][6]) if isinstance(value, float) else value
-                tmp.add_field(suffix, value)
-            metrics.append(tmp)
+        for host in results:
+            tags = self.influx_tags
+            if len(results) > 1:
+                tags = (tags + "," if tags else "") + "host=" + host
+            for metric in results[host]:
+                tmp = Metric(metric)
+                for _, name, value in results[host][metric]:
+                    suffix = sanitize_name_indom(name) if name else "value"
+                    value = round(value, self.metrics[metric][6]) if isinstance(value, float) else value
+                    tmp.add_field(suffix, value)
+                tmp.set_tag_string(tags)
+                metrics.append(tmp)
 
         ts = self.context.datetime_to_secs(self.pmfg_ts(), PM_TIME_NSEC)
 
         body = WriteBody()
 
         for metric in metrics:
-            metric.set_tag_string(self.influx_tags)
             metric.set_timestamp(long(ts))
             body.add(metric)
 
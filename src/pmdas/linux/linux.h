@@ -113,6 +113,7 @@ enum {
 	CLUSTER_ZRAM_BD_STAT,	/* 89 /sys/block/zram[0-9]/bd_stat metrics */
 	CLUSTER_NET_ALL,	/* 90 /proc/net/dev aggregate metrics */
 	CLUSTER_FCHOST,		/* 91 /sys/class/fc_host metrics */
+	CLUSTER_REFRESH,	/* 92 refresh coalescing and snapshot metrics */
 
 	NUM_CLUSTERS		/* one more than highest numbered cluster */
 };
@@ -309,5 +310,10 @@ typedef struct {
     softnet_t		*softnet;
 } percpu_t;
 
+extern percpu_t **percpu_table;		/* indexed by CPU_INDOM instance */
+extern unsigned int percpu_count;
+extern pernode_t **pernode_table;	/* indexed by NODE_INDOM instance */
+extern unsigned int pernode_count;
+
 
 #endif /* LINUX_PMDA_H */
@@ -71,6 +71,7 @@
 #include "sysfs_tapestats.h"
 #include "proc_tty.h"
 #include "proc_pressure.h"
+#include "snapshot.h"
 
 static proc_stat_t		proc_stat;
 static proc_meminfo_t		proc_meminfo;
@@ -6390,6 +6391,26 @@ static pmdaMetric metrictab[] = {
     { NULL, { PMDA_PMID(CLUSTER_FCHOST, FCHOST_HINV_NFCHOST), PM_TYPE_U32,
 	PM_INDOM_NULL, PM_SEM_DISCRETE, PMDA_PMUNITS(0,0,0,0,0,0) }, },
 
+/*
+ * refresh coalescing cluster
+ */
+
+    /* pmda.refresh.interval */
+    { &snapshot.interval, { PMDA_PMID(CLUSTER_REFRESH, 0), PM_TYPE_U32,
+	PM_INDOM_NULL, PM_SEM_DISCRETE, PMDA_PMUNITS(0,1,0,0,PM_TIME_MSEC,0) }, },
+    /* pmda.refresh.window */
+    { &snapshot.window, { PMDA_PMID(CLUSTER_REFRESH, 1), PM_TYPE_U32,
+	PM_INDOM_NULL, PM_SEM_DISCRETE, PMDA_PMUNITS(0,1,0,0,PM_TIME_MSEC,0) }, },
+    /* pmda.refresh.age */
+    { NULL, { PMDA_PMID(CLUSTER_REFRESH, 2), PM_TYPE_DOUBLE,
+	PM_INDOM_NULL, PM_SEM_INSTANT, PMDA_PMUNITS(0,1,0,0,PM_TIME_MSEC,0) }, },
+    /* pmda.refresh.count */
+    { &snapshot.refreshes, { PMDA_PMID(CLUSTER_REFRESH, 3), PM_TYPE_U64,
+	PM_INDOM_NULL, PM_SEM_COUNTER, PMDA_PMUNITS(0,0,1,0,0,PM_COUNT_ONE) }, },
+    /* pmda.refresh.coalesced */
+    { &snapshot.coalesced, { PMDA_PMID(CLUSTER_REFRESH, 4), PM_TYPE_U64,
+	PM_INDOM_NULL, PM_SEM_COUNTER, PMDA_PMUNITS(0,0,1,0,0,PM_COUNT_ONE) }, },
+
 };
 
 typedef struct {
@@ -6736,6 +6757,36 @@ done:
     return sts;
 }
 
+/*
+ * Refresh with optional coalescing - called with the snapshot lock
+ * held.  Host values refreshed recently (or by the background thread)
+ * are reused; container refreshes always go to the source files.
+ */
+static int
+linux_refresh_snapshot(pmdaExt *pmda, int *need_refresh, int context)
+{
+    int		sts;
+
+    if (linux_ctx_container(context) != NULL) {
+	snapshot_invalidate(need_refresh);
+	return linux_refresh(pmda, need_refresh, context);
+    }
+    snapshot_coalesce(need_refresh);
+    if ((sts = linux_refresh(pmda, need_refresh, context)) >= 0)
+	snapshot_update(need_refresh);
+    return sts;
+}
+
+/*
+ * Background refresh of all clusters requested so far, in the host
+ * namespaces and without any client credentials.
+ */
+static int
+linux_refresh_background(int *need_refresh)
+{
+    return linux_refresh(NULL, need_refresh, -1);
+}
+
 static int
 linux_instance(pmInDom indom, int inst, char *name, pmInResult **result, pmdaExt *pmda)
 {
@@ -6835,15 +6886,87 @@ linux_instance(pmInDom indom, int inst, char *name, pmInResult **result, pmdaExt
     /* no default label : pmdaInstance will pick up errors */
     }
 
-    if ((sts = linux_refresh(pmda, need_refresh, pmda->e_context)) < 0)
-	return sts;
-    return pmdaInstance(indom, inst, name, result, pmda);
+    snapshot_lock();
+    if ((sts = linux_refresh_snapshot(pmda, need_refresh, pmda->e_context)) >= 0)
+	sts = pmdaInstance(indom, inst, name, result, pmda);
+    snapshot_unlock();
+    return sts;
 }
 
 /*
  * callback provided to pmdaFetch
  */
 
+/*
+ * Per-CPU and per-node CPU time counters from /proc/stat, for the
+ * kernel.percpu.cpu and kernel.pernode.cpu metrics (CLUSTER_STAT).
+ */
+static int
+cpuacct_fetch(unsigned int item, cpuacct_t *sp, pmAtomValue *atom)
+{
+    switch (item) {
+    case 0: /* kernel.percpu.cpu.user */
+    case 62: /* kernel.pernode.cpu.user */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->user / hz);
+	break;
+    case 1: /* kernel.percpu.cpu.nice */
+    case 63: /* kernel.pernode.cpu.nice */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->nice / hz);
+	break;
+    case 2: /* kernel.percpu.cpu.sys */
+    case 64: /* kernel.pernode.cpu.sys */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->sys / hz);
+	break;
+    case 3: /* kernel.percpu.cpu.idle */
+    case 65: /* kernel.pernode.cpu.idle */
+	_pm_assign_utype(_pm_idletime_size, atom, 1000 * (double)sp->idle / hz);
+	break;
+    case 30: /* kernel.percpu.cpu.wait.total */
+    case 69: /* kernel.pernode.cpu.wait.total */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->wait / hz);
+	break;
+    case 31: /* kernel.percpu.cpu.intr */
+    case 66: /* kernel.pernode.cpu.intr */
+	_pm_assign_utype(_pm_cputime_size, atom,
+			1000 * ((double)sp->irq + (double)sp->sirq) / hz);
+	break;
+    case 56: /* kernel.percpu.cpu.irq.soft */
+    case 70: /* kernel.pernode.cpu.irq.soft */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->sirq / hz);
+	break;
+    case 57: /* kernel.percpu.cpu.irq.hard */
+    case 71: /* kernel.pernode.cpu.irq.hard */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->irq / hz);
+	break;
+    case 58: /* kernel.percpu.cpu.steal */
+    case 67: /* kernel.pernode.cpu.steal */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->steal / hz);
+	break;
+    case 61: /* kernel.percpu.cpu.guest */
+    case 68: /* kernel.pernode.cpu.guest */
+	_pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)sp->guest / hz);
+	break;
+    case 76: /* kernel.percpu.cpu.vuser */
+    case 77: /* kernel.pernode.cpu.vuser */
+	_pm_assign_utype(_pm_cputime_size, atom,
+			1000 * (double)(sp->user - sp->guest) / hz);
+	break;
+    case 83: /* kernel.percpu.cpu.guest_nice */
+    case 85: /* kernel.pernode.cpu.guest_nice */
+	_pm_assign_utype(_pm_cputime_size, atom,
+			1000 * (double)sp->guest_nice / hz);
+	break;
+    case 84: /* kernel.percpu.cpu.vnice */
+    case 86: /* kernel.pernode.cpu.vnice */
+	_pm_assign_utype(_pm_cputime_size, atom,
+			1000 * (double)(sp->nice - sp->guest_nice) / hz);
+	break;
+    default:
+	return 0;
+    }
+    return 1;
+}
+
 static int
 linux_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
 {
@@ -6952,142 +7075,38 @@ linux_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
 	 */
 	switch (item) {
 	case 0: /* kernel.percpu.cpu.user */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.user / hz);
-	    break;
 	case 1: /* kernel.percpu.cpu.nice */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.nice / hz);
-	    break;
 	case 2: /* kernel.percpu.cpu.sys */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.sys / hz);
-	    break;
 	case 3: /* kernel.percpu.cpu.idle */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_idletime_size, atom, 1000 * (double)cp->stat.idle / hz);
-	    break;
 	case 30: /* kernel.percpu.cpu.wait.total */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.wait / hz);
-	    break;
 	case 31: /* kernel.percpu.cpu.intr */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * ((double)cp->stat.irq + (double)cp->stat.sirq) / hz);
-	    break;
 	case 56: /* kernel.percpu.cpu.irq.soft */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.sirq / hz);
-	    break;
 	case 57: /* kernel.percpu.cpu.irq.hard */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.irq / hz);
-	    break;
 	case 58: /* kernel.percpu.cpu.steal */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.steal / hz);
-	    break;
 	case 61: /* kernel.percpu.cpu.guest */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)cp->stat.guest / hz);
-	    break;
 	case 76: /* kernel.percpu.cpu.vuser */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * (double)(cp->stat.user - cp->stat.guest) / hz);
-	    break;
 	case 83: /* kernel.percpu.cpu.guest_nice */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * (double)cp->stat.guest_nice / hz);
-	    break;
 	case 84: /* kernel.percpu.cpu.vnice */
 	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&cp) < 0)
 		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * (double)(cp->stat.nice - cp->stat.guest_nice) / hz);
+	    cpuacct_fetch(item, &cp->stat, atom);
 	    break;
 	case 62: /* kernel.pernode.cpu.user */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.user / hz);
-	    break;
 	case 63: /* kernel.pernode.cpu.nice */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.nice / hz);
-	    break;
 	case 64: /* kernel.pernode.cpu.sys */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.sys / hz);
-	    break;
 	case 65: /* kernel.pernode.cpu.idle */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_idletime_size, atom, 1000 * (double)np->stat.idle / hz);
-	    break;
 	case 69: /* kernel.pernode.cpu.wait.total */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.wait / hz);
-	    break;
 	case 66: /* kernel.pernode.cpu.intr */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * ((double)np->stat.irq + (double)np->stat.sirq) / hz);
-	    break;
 	case 70: /* kernel.pernode.cpu.irq.soft */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.sirq / hz);
-	    break;
 	case 71: /* kernel.pernode.cpu.irq.hard */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.irq / hz);
-	    break;
 	case 67: /* kernel.pernode.cpu.steal */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.steal / hz);
-	    break;
 	case 68: /* kernel.pernode.cpu.guest */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom, 1000 * (double)np->stat.guest / hz);
-	    break;
 	case 77: /* kernel.pernode.cpu.vuser */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * (double)(np->stat.user - np->stat.guest) / hz);
-	    break;
 	case 85: /* kernel.pernode.cpu.guest_nice */
-	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
-		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * (double)np->stat.guest_nice / hz);
-	    break;
 	case 86: /* kernel.pernode.cpu.vnice */
 	    if (pmdaCacheLookup(mdesc->m_desc.indom, inst, NULL, (void **)&np) < 0)
 		return PM_ERR_INST;
-	    _pm_assign_utype(_pm_cputime_size, atom,
-			1000 * (double)(np->stat.nice - np->stat.guest_nice) / hz);
+	    cpuacct_fetch(item, &np->stat, atom);
 	    break;
 
 	case 8: /* swap.pagesin */
@@ -8889,6 +8908,12 @@ linux_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
 	}
 	break;
 
+    case CLUSTER_REFRESH:
+	if (item != 2)
+	    return PM_ERR_PMID;
+	atom->d = snapshot_age();	/* pmda.refresh.age */
+	break;
+
     default: /* unknown cluster */
 	return PM_ERR_PMID;
     }
@@ -8896,6 +8921,90 @@ linux_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
     return PMDA_FETCH_STATIC;
 }
 
+/*
+ * Bulk fetch for the per-CPU and per-node metrics, filling the values
+ * for all requested instances in one pass over arrays indexed by the
+ * instance identifier.  Returns zero for all other metrics, which are
+ * then fetched one instance at a time by linux_fetchCallBack.
+ */
+static int
+linux_fetchInDomCallBack(pmdaMetric *mdesc, int numinst, unsigned int *instlist,
+		pmAtomValue *atoms, int *sts)
+{
+    unsigned int	cluster = pmID_cluster(mdesc->m_desc.pmid);
+    unsigned int	item = pmID_item(mdesc->m_desc.pmid);
+    unsigned int	inst, flag;
+    softnet_t		*snp;
+    percpu_t		*cp;
+    pernode_t		*np;
+    int			i;
+
+    if (mdesc->m_user != NULL)
+	return 0;
+
+    switch (cluster) {
+    case CLUSTER_STAT:
+	if (mdesc->m_desc.indom == INDOM(CPU_INDOM)) {
+	    for (i = 0; i < numinst; i++) {
+		inst = instlist[i];
+		if (inst >= percpu_count || (cp = percpu_table[inst]) == NULL)
+		    sts[i] = PM_ERR_INST;
+		else if ((sts[i] = cpuacct_fetch(item, &cp->stat, &atoms[i])) == 0)
+		    return 0;
+	    }
+	    return 1;
+	}
+	if (mdesc->m_desc.indom == INDOM(NODE_INDOM)) {
+	    for (i = 0; i < numinst; i++) {
+		inst = instlist[i];
+		if (inst >= pernode_count || (np = pernode_table[inst]) == NULL)
+		    sts[i] = PM_ERR_INST;
+		else if ((sts[i] = cpuacct_fetch(item, &np->stat, &atoms[i])) == 0)
+		    return 0;
+	    }
+	    return 1;
+	}
+	break;
+
+    case CLUSTER_INTERRUPTS:
+    case CLUSTER_SOFTIRQS:
+	return proc_interrupts_fetch_indom(cluster, item, numinst, instlist, atoms, sts);
+
+    case CLUSTER_NET_SOFTNET:
+	switch (item) {
+	case 6: flag = SN_PROCESSED; break;
+	case 7: flag = SN_DROPPED; break;
+	case 8: flag = SN_TIME_SQUEEZE; break;
+	case 9: flag = SN_CPU_COLLISION; break;
+	case 10: flag = SN_RECEIVED_RPS; break;
+	case 11: flag = SN_FLOW_LIMIT_COUNT; break;
+	default: return 0;
+	}
+	for (i = 0; i < numinst; i++) {
+	    inst = instlist[i];
+	    if (!(proc_net_softnet.flags & flag)) {
+		sts[i] = PM_ERR_APPVERSION;
+		continue;
+	    }
+	    if (inst >= percpu_count || (cp = percpu_table[inst]) == NULL ||
+		(snp = cp->softnet) == NULL) {
+		sts[i] = PM_ERR_INST;
+		continue;
+	    }
+	    switch (item) {
+	    case 6: atoms[i].ull = snp->processed; break;
+	    case 7: atoms[i].ull = snp->dropped; break;
+	    case 8: atoms[i].ull = snp->time_squeeze; break;
+	    case 9: atoms[i].ull = snp->cpu_collision; break;
+	    case 10: atoms[i].ull = snp->received_rps; break;
+	    case 11: atoms[i].ull = snp->flow_limit_count; break;
+	    }
+	    sts[i] = PMDA_FETCH_STATIC;
+	}
+	return 1;
+    }
+    return 0;
+}
 
 static int
 linux_fetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
@@ -9015,41 +9124,65 @@ linux_fetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 	}
     }
 
-    if ((sts = linux_refresh(pmda, need_refresh, pmda->e_context)) < 0)
-	return sts;
-    return pmdaFetch(numpmid, pmidlist, resp, pmda);
+    snapshot_lock();
+    if ((sts = linux_refresh_snapshot(pmda, need_refresh, pmda->e_context)) >= 0)
+	sts = pmdaFetch(numpmid, pmidlist, resp, pmda);
+    snapshot_unlock();
+    return sts;
 }
 
 static int
 linux_text(int ident, int type, char **buf, pmdaExt *pmda)
 {
-    if ((type & PM_TEXT_PMID) == PM_TEXT_PMID) {
-	int sts = pmdaDynamicLookupText(ident, type, buf, pmda);
-	if (sts != -ENOENT)
-	    return sts;
-    }
-    return pmdaText(ident, type, buf, pmda);
+    int		sts = -ENOENT;
+
+    /* dynamic metric tables are rewritten by background refresh */
+    snapshot_lock();
+    if ((type & PM_TEXT_PMID) == PM_TEXT_PMID)
+	sts = pmdaDynamicLookupText(ident, type, buf, pmda);
+    if (sts == -ENOENT)
+	sts = pmdaText(ident, type, buf, pmda);
+    snapshot_unlock();
+    return sts;
 }
 
 static int
 linux_pmid(const char *name, pmID *pmid, pmdaExt *pmda)
 {
-    pmdaNameSpace *tree = pmdaDynamicLookupName(pmda, name);
-    return pmdaTreePMID(tree, name, pmid);
+    pmdaNameSpace	*tree;
+    int			sts;
+
+    snapshot_lock();
+    tree = pmdaDynamicLookupName(pmda, name);
+    sts = pmdaTreePMID(tree, name, pmid);
+    snapshot_unlock();
+    return sts;
 }
 
 static int
 linux_name(pmID pmid, char ***nameset, pmdaExt *pmda)
 {
-    pmdaNameSpace *tree = pmdaDynamicLookupPMID(pmda, pmid);
-    return pmdaTreeName(tree, pmid, nameset);
+    pmdaNameSpace	*tree;
+    int			sts;
+
+    snapshot_lock();
+    tree = pmdaDynamicLookupPMID(pmda, pmid);
+    sts = pmdaTreeName(tree, pmid, nameset);
+    snapshot_unlock();
+    return sts;
 }
 
 static int
 linux_children(const char *name, int flag, char ***kids, int **sts, pmdaExt *pmda)
 {
-    pmdaNameSpace *tree = pmdaDynamicLookupName(pmda, name);
-    return pmdaTreeChildren(tree, name, flag, kids, sts);
+    pmdaNameSpace	*tree;
+    int			n;
+
+    snapshot_lock();
+    tree = pmdaDynamicLookupName(pmda, name);
+    n = pmdaTreeChildren(tree, name, flag, kids, sts);
+    snapshot_unlock();
+    return n;
 }
 
 static void
@@ -9309,21 +9442,27 @@ linux_labelCallBack(pmInDom indom, unsigned int inst, pmLabelSet **lp)
 static int
 linux_label(int ident, int type, pmLabelSet **lpp, pmdaExt *pmda)
 {
-    int		sts;
+    int		sts = 0;
 
+    /*
+     * pmdaLabel walks instance domains (and linux_labelCallBack the
+     * interrupt and zoneinfo tables) that background refresh rewrites
+     */
+    snapshot_lock();
     switch (type) {
     case PM_LABEL_INDOM:
-	if ((sts = linux_labelInDom((pmInDom)ident, lpp)) < 0)
-	    return sts;
+	sts = linux_labelInDom((pmInDom)ident, lpp);
 	break;
     case PM_LABEL_ITEM:
-	if ((sts = linux_labelItem((pmID)ident, lpp)) < 0)
-	    return sts;
+	sts = linux_labelItem((pmID)ident, lpp);
 	break;
     default:
 	break;
     }
-    return pmdaLabel(ident, type, lpp, pmda);
+    if (sts >= 0)
+	sts = pmdaLabel(ident, type, lpp, pmda);
+    snapshot_unlock();
+    return sts;
 }
 
 pmInDom
@@ -9442,6 +9581,9 @@ linux_init(pmdaInterface *dp)
 	linux_test_mode |= (LINUX_TEST_MODE|LINUX_TEST_MEMINFO);
     }
 
+    /* optional refresh coalescing, $LINUX_REFRESH and $LINUX_WINDOW */
+    snapshot_config();
+
     if (_isDSO) {
 	char helppath[MAXPATHLEN];
 	int sep = pmPathSeparator();
@@ -9469,6 +9611,7 @@ linux_init(pmdaInterface *dp)
     pmdaSetLabelCallBack(dp, linux_labelCallBack);
     pmdaSetEndContextCallBack(dp, linux_endContextCallBack);
     pmdaSetFetchCallBack(dp, linux_fetchCallBack);
+    pmdaSetFetchInDomCallBack(dp, linux_fetchInDomCallBack);
 
     proc_buddyinfo.indom = &indomtab[BUDDYINFO_INDOM];
 
@@ -9566,6 +9709,9 @@ linux_init(pmdaInterface *dp)
 
     /* string metrics use the pmdaCache API for value indexing */
     pmdaCacheOp(INDOM(STRINGS_INDOM), PMDA_CACHE_STRINGS);
+
+    /* optional background refresh, once all other state is set up */
+    snapshot_start(linux_refresh_background);
 }
 
 pmLongOptions	longopts[] = {
@@ -9573,13 +9719,15 @@ pmLongOptions	longopts[] = {
     PMOPT_DEBUG,
     PMDAOPT_DOMAIN,
     PMDAOPT_LOGFILE,
+    { "refresh", 1, 'r', "DELTA", "refresh values in the background every DELTA" },
     PMDAOPT_USERNAME,
+    { "window", 1, 'w', "DELTA", "reuse values refreshed within the last DELTA" },
     PMOPT_HELP,
     PMDA_OPTIONS_END
 };
 
 pmdaOptions	opts = {
-    .short_options = "D:d:l:U:?",
+    .short_options = "D:d:l:r:U:w:?",
     .long_options = longopts,
 };
 
@@ -9591,7 +9739,10 @@ main(int argc, char **argv)
 {
     int			sep = pmPathSeparator();
     pmdaInterface	dispatch;
+    struct timeval	delta;
     char		helppath[MAXPATHLEN];
+    char		*endnum;
+    int			c;
 
     _isDSO = 0;
     pmSetProgname(argv[0]);
@@ -9600,7 +9751,23 @@ main(int argc, char **argv)
 		pmGetConfig("PCP_PMDAS_DIR"), sep, sep);
     pmdaDaemon(&dispatch, PMDA_INTERFACE_7, pmGetProgname(), LINUX, "linux.log", helppath);
 
-    pmdaGetOptions(argc, argv, &opts, &dispatch);
+    while ((c = pmdaGetOptions(argc, argv, &opts, &dispatch)) != EOF) {
+	switch (c) {
+	case 'r':
+	case 'w':
+	    if (pmParseInterval(opts.optarg, &delta, &endnum) < 0) {
+		pmprintf("%s: -%c requires a time interval: %s\n",
+			 pmGetProgname(), c, endnum);
+		free(endnum);
+		opts.errors++;
+	    } else if (c == 'r') {
+		snapshot.interval = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	    } else {
+		snapshot.window = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	    }
+	    break;
+	}
+    }
     if (opts.errors) {
 	pmdaUsageMessage(&opts);
 	exit(1);
@@ -15,16 +15,44 @@
 #include "linux.h"
 #include "filesys.h"
 #include "proc_interrupts.h"
+#include "statsfile.h"
 #include <sys/stat.h>
 #include <ctype.h>
 
-static char *iobuf;			/* buffer sized based on CPU count */
-static unsigned int iobufsz;
-
 static online_cpu_t *online_cpumap;	/* maps input columns to CPU info */
 unsigned int irq_err_count;
 unsigned int irq_mis_count;
 
+typedef struct {
+    char		*name;		/* interrupt name from start of row */
+    interrupt_t		*ip;		/* INTERRUPT/SOFTIRQ indom entry */
+    interrupt_cpu_t	**cpus;		/* per-CPU indom entry per column */
+    int			ncpus;		/* number of valid column entries */
+} interrupt_row_t;
+
+typedef struct {
+    statsfile_t		file;
+    pmInDom		indom;
+    pmInDom		cpuindom;
+    int			setup;
+    int			softirqs;	/* softirqs (or interrupts) file */
+    char		*header;	/* CPU header from the last rebuild */
+    int			ncolumns;
+    int			nrows;		/* rows seen in the last rebuild */
+    int			maxrows;
+    interrupt_row_t	*rows;		/* row-to-instance mapping */
+    unsigned int	ninst;
+    interrupt_cpu_t	**byinst;	/* per-CPU entry per instance */
+} interrupt_layout_t;
+
+static interrupt_layout_t interrupts = {
+    .file = STATSFILE_INIT("/proc/interrupts"),
+};
+static interrupt_layout_t softirqs = {
+    .file = STATSFILE_INIT("/proc/softirqs"),
+    .softirqs = 1,
+};
+
 /*
  * One-shot initialisation for global interrupt-metric-related state
  */
@@ -34,15 +62,9 @@ setup_buffers(void)
     static int setup;
 
     if (!setup) {
-	if ((iobufsz = (_pm_ncpus * 64)) < BUFSIZ)
-	    iobufsz = BUFSIZ;
-	if ((iobuf = malloc(iobufsz)) == NULL)
-	    return;
 	online_cpumap = calloc(_pm_ncpus, sizeof(online_cpu_t));
-	if (!online_cpumap) {
-	    free(iobuf);
+	if (!online_cpumap)
 	    return;
-	}
 	setup = 1;
     }
 }
@@ -124,48 +146,96 @@ extract_interrupt_name(char *buffer, char **suffix)
     return s;
 }
 
+/*
+ * The ERR and MIS row labels are right-aligned to the width of the
+ * interrupt number column, so are indented when there are many lines.
+ */
 static int
 extract_interrupt_errors(char *buffer)
 {
-    return (sscanf(buffer, "ERR: %u", &irq_err_count) == 1 ||
-	    sscanf(buffer, "Err: %u", &irq_err_count) == 1  ||
-	    sscanf(buffer, "BAD: %u", &irq_err_count) == 1);
+    while (*buffer == ' ')
+	buffer++;
+    if (strncmp(buffer, "ERR:", 4) != 0 &&
+	strncmp(buffer, "Err:", 4) != 0 &&
+	strncmp(buffer, "BAD:", 4) != 0)
+	return 0;
+    buffer += 4;
+    irq_err_count = statsfile_ull(&buffer);
+    return 1;
 }
 
 static int
 extract_interrupt_misses(char *buffer)
 {
-    return sscanf(buffer, "MIS: %u", &irq_mis_count) == 1;
+    while (*buffer == ' ')
+	buffer++;
+    if (strncmp(buffer, "MIS:", 4) != 0)
+	return 0;
+    buffer += 4;
+    irq_mis_count = statsfile_ull(&buffer);
+    return 1;
+}
+
+static void
+layout_instance(interrupt_layout_t *layout, unsigned int inst, interrupt_cpu_t *cpuip)
+{
+    interrupt_cpu_t **byinst;
+    unsigned int need;
+
+    if (inst >= layout->ninst) {
+	need = layout->ninst ? layout->ninst * 2 : 1024;
+	while (need <= inst)
+	    need *= 2;
+	if ((byinst = realloc(layout->byinst, need * sizeof(*byinst))) == NULL)
+	    return;
+	memset(byinst + layout->ninst, 0, (need - layout->ninst) * sizeof(*byinst));
+	layout->byinst = byinst;
+	layout->ninst = need;
+    }
+    layout->byinst[inst] = cpuip;
 }
 
+/*
+ * Slow path - lookup (or create) the instances for one row and all of
+ * its per-CPU columns, recording them in the row for later refreshes.
+ */
 static int
-extract_interrupt_values(char *name, char *buffer, pmInDom intr, pmInDom cpuintr, int ncolumns)
+extract_interrupt_values(interrupt_layout_t *layout, interrupt_row_t *row,
+		char *name, char *buffer, int ncolumns)
 {
-    unsigned long i, cpuid, value;
+    unsigned long i, cpuid;
+    unsigned long long value;
     char *s = buffer, *end = NULL;
     char cpubuf[64];
     interrupt_cpu_t *cpuip;
     interrupt_t *ip = NULL;
     int sts, changed = 0;
 
-    sts = pmdaCacheLookupName(intr, name, NULL, (void **)&ip);
+    sts = pmdaCacheLookupName(layout->indom, name, NULL, (void **)&ip);
     if (sts < 0 || ip == NULL) {
 	if ((ip = calloc(1, sizeof(interrupt_t))) == NULL)
 	    return 0;
 	changed = 1;
     }
 
+    free(row->name);
+    row->name = strdup(name);
+    row->ip = ip;
+    row->ncpus = 0;
+
     ip->total = 0;
     for (i = 0; i < ncolumns; i++) {
-	value = strtoul(s, &end, 10);
-	if (!isspace(*end))
-	    continue;
-	s = end;
+	if (statsfile_column(&s, &value) < 0)
+	    value = 0;		/* short row, e.g. ERR or MIS */
+	end = s;
 	cpuip = NULL;
 	cpuid = column_to_cpuid(i);
-	online_cpumap[cpuid].intr_count += value;
+	if (layout->softirqs)
+	    online_cpumap[cpuid].sirq_count += value;
+	else
+	    online_cpumap[cpuid].intr_count += value;
 	pmsprintf(cpubuf, sizeof cpubuf, "%s::cpu%lu", name, cpuid);
-	sts = pmdaCacheLookupName(cpuintr, cpubuf, NULL, (void **)&cpuip);
+	sts = pmdaCacheLookupName(layout->cpuindom, cpubuf, NULL, (void **)&cpuip);
 	if (sts < 0 || cpuip == NULL) {
 	    if ((cpuip = calloc(1, sizeof(interrupt_cpu_t))) == NULL)
 	        continue;
@@ -175,9 +245,12 @@ extract_interrupt_values(char *name, char *buffer, pmInDom intr, pmInDom cpuintr
 	cpuip->value = value;
 	ip->total += value;
 
-	pmdaCacheStore(cpuintr, PMDA_CACHE_ADD, cpubuf, cpuip);
+	sts = pmdaCacheStore(layout->cpuindom, PMDA_CACHE_ADD, cpubuf, cpuip);
+	if (sts >= 0)
+	    layout_instance(layout, sts, cpuip);
+	row->cpus[row->ncpus++] = cpuip;
     }
-    pmdaCacheStore(intr, PMDA_CACHE_ADD, name, ip);
+    pmdaCacheStore(layout->indom, PMDA_CACHE_ADD, name, ip);
 
     if (ip->label == NULL)
 	ip->label = end ? strdup(label_reformat(end)) : NULL;
@@ -185,151 +258,170 @@ extract_interrupt_values(char *name, char *buffer, pmInDom intr, pmInDom cpuintr
     return changed;
 }
 
-int
-refresh_proc_interrupts(void)
+/*
+ * Fast path - the row layout matches the previous refresh, so only
+ * the numbers need scanning; instances are already known and active.
+ */
+static void
+update_interrupt_values(interrupt_layout_t *layout, interrupt_row_t *row,
+		char *buffer)
 {
-    static int setup;
-    FILE *fp;
-    char *name, *values;
-    int i, save, ncolumns;
-    pmInDom intr_indom = INDOM(INTERRUPT_INDOM);
-    pmInDom cpu_intr_indom = INDOM(INTERRUPT_CPU_INDOM);
+    unsigned long long value;
+    interrupt_cpu_t *cpuip;
+    interrupt_t *ip = row->ip;
+    char *s = buffer;
+    int i;
 
-    if (!setup) {
-	pmdaCacheOp(cpu_intr_indom, PMDA_CACHE_LOAD);
-	pmdaCacheOp(intr_indom, PMDA_CACHE_LOAD);
-	setup = 1;
+    ip->total = 0;
+    for (i = 0; i < row->ncpus; i++) {
+	if (statsfile_column(&s, &value) < 0)
+	    value = 0;
+	cpuip = row->cpus[i];
+	if (layout->softirqs)
+	    online_cpumap[cpuip->cpuid].sirq_count += value;
+	else
+	    online_cpumap[cpuip->cpuid].intr_count += value;
+	cpuip->value = value;
+	ip->total += value;
     }
-    pmdaCacheOp(cpu_intr_indom, PMDA_CACHE_INACTIVE);
-    pmdaCacheOp(intr_indom, PMDA_CACHE_INACTIVE);
+}
 
-    setup_buffers();
-    for (i = 0; i < _pm_ncpus; i++)
-	online_cpumap[i].intr_count = 0;
+static int
+layout_rows(interrupt_layout_t *layout, int nrows, int ncolumns)
+{
+    interrupt_row_t *rows;
+    interrupt_cpu_t **cpus;
+    int i;
 
-    if ((fp = linux_statsfile("/proc/interrupts", iobuf, iobufsz)) == NULL)
-	return -oserror();
+    if (ncolumns != layout->ncolumns) {
+	for (i = 0; i < layout->maxrows; i++) {
+	    cpus = realloc(layout->rows[i].cpus, (ncolumns ? ncolumns : 1) * sizeof(*cpus));
+	    if (cpus == NULL)
+		return -ENOMEM;
+	    layout->rows[i].cpus = cpus;
+	}
+	layout->ncolumns = ncolumns;
+    }
+    if (nrows >= layout->maxrows) {
+	i = layout->maxrows ? layout->maxrows * 2 : 64;
+	if ((rows = realloc(layout->rows, i * sizeof(*rows))) == NULL)
+	    return -ENOMEM;
+	memset(rows + layout->maxrows, 0, (i - layout->maxrows) * sizeof(*rows));
+	layout->rows = rows;
+	for (; layout->maxrows < i; layout->maxrows++) {
+	    cpus = calloc(ncolumns ? ncolumns : 1, sizeof(*cpus));
+	    if ((rows[layout->maxrows].cpus = cpus) == NULL)
+		return -ENOMEM;
+	}
+    }
+    return 0;
+}
+
+/*
+ * Parse the buffered /proc/{interrupts,softirqs} contents.  While the
+ * CPU header and sequence of row names are unchanged, rows map to the
+ * same instances as the previous refresh and only the values are
+ * scanned.  Otherwise (first time, CPUs on/offline, new interrupt
+ * lines) returns -EAGAIN, after which the caller re-reads the file
+ * and rebuilds the layout using pmdaCache lookups.
+ */
+static int
+parse_interrupts(interrupt_layout_t *layout, int rebuild)
+{
+    char *cursor = layout->file.buf, *line, *name, *values;
+    int i, sts, nrows = 0, save = 0, ncolumns;
 
     /* first parse header, which maps online CPU number to column number */
-    if (fgets(iobuf, iobufsz, fp)) {
-	ncolumns = map_online_cpus(iobuf);
-    } else {
-	fclose(fp);
+    if ((line = statsfile_getline(&cursor)) == NULL)
 	return -EINVAL;		/* unrecognised file format */
+    if (!rebuild && (layout->header == NULL || strcmp(line, layout->header) != 0))
+	return -EAGAIN;
+    ncolumns = map_online_cpus(line);
+    if (rebuild) {
+	free(layout->header);
+	layout->header = strdup(line);
+	layout->nrows = 0;
+	pmdaCacheOp(layout->cpuindom, PMDA_CACHE_INACTIVE);
+	pmdaCacheOp(layout->indom, PMDA_CACHE_INACTIVE);
+    }
+
+    for (i = 0; i < _pm_ncpus; i++) {
+	if (layout->softirqs)
+	    online_cpumap[i].sirq_count = 0;
+	else
+	    online_cpumap[i].intr_count = 0;
     }
 
-    save = 0;
-    while (fgets(iobuf, iobufsz, fp) != NULL) {
+    while ((line = statsfile_getline(&cursor)) != NULL) {
 	/* extract interrupt line (or other) and values from each row */
-	if (extract_interrupt_errors(iobuf))
-	    continue;
-	if (extract_interrupt_misses(iobuf))
-	    continue;
-	name = extract_interrupt_name(iobuf, &values);
-	save |= extract_interrupt_values(name, values, intr_indom, cpu_intr_indom, ncolumns);
+	if (!layout->softirqs) {
+	    if (extract_interrupt_errors(line))
+		continue;
+	    if (extract_interrupt_misses(line))
+		continue;
+	}
+	name = extract_interrupt_name(line, &values);
+	if (!rebuild) {
+	    if (nrows >= layout->nrows ||
+		strcmp(name, layout->rows[nrows].name) != 0)
+		return -EAGAIN;
+	    update_interrupt_values(layout, &layout->rows[nrows], values);
+	} else {
+	    if ((sts = layout_rows(layout, nrows, ncolumns)) < 0)
+		return sts;
+	    save |= extract_interrupt_values(layout, &layout->rows[nrows],
+					name, values, ncolumns);
+	}
+	nrows++;
     }
-    fclose(fp);
+    if (!rebuild)
+	return (nrows == layout->nrows) ? 0 : -EAGAIN;
 
+    layout->nrows = nrows;
     if (save) {
-	pmdaCacheOp(cpu_intr_indom, PMDA_CACHE_SAVE);
-	pmdaCacheOp(intr_indom, PMDA_CACHE_SAVE);
+	pmdaCacheOp(layout->cpuindom, PMDA_CACHE_SAVE);
+	pmdaCacheOp(layout->indom, PMDA_CACHE_SAVE);
     }
     return 0;
 }
 
 static int
-extract_softirq_values(char *name, char *buffer, pmInDom sirq, pmInDom cpusirq, int ncolumns)
+refresh_interrupts(interrupt_layout_t *layout)
 {
-    unsigned long i, cpuid, value;
-    char *s = buffer, *end = NULL;
-    char cpubuf[64];
-    interrupt_cpu_t *cpuip;
-    interrupt_t *ip = NULL;
-    int sts, changed = 0;
-
-    sts = pmdaCacheLookupName(sirq, name, NULL, (void **)&ip);
-    if (sts < 0 || ip == NULL) {
-	if ((ip = calloc(1, sizeof(interrupt_t))) == NULL)
-	    return 0;
-	changed = 1;
-    }
+    int sts;
 
-    ip->total = 0;
-    for (i = 0; i < ncolumns; i++) {
-	value = strtoul(s, &end, 10);
-	if (!isspace(*end))
-	    continue;
-	s = end;
-	cpuip = NULL;
-	cpuid = column_to_cpuid(i);
-	online_cpumap[cpuid].sirq_count += value;
-	pmsprintf(cpubuf, sizeof cpubuf, "%s::cpu%lu", name, cpuid);
-	sts = pmdaCacheLookupName(cpusirq, cpubuf, NULL, (void **)&cpuip);
-	if (sts < 0 || cpuip == NULL) {
-	    if ((cpuip = calloc(1, sizeof(interrupt_cpu_t))) == NULL)
-	        continue;
-	    cpuip->row = ip;
-	}
-	cpuip->cpuid = cpuid;
-	cpuip->value = value;
-	ip->total += value;
-
-	pmdaCacheStore(cpusirq, PMDA_CACHE_ADD, cpubuf, cpuip);
+    if (!layout->setup) {
+	pmdaCacheOp(layout->cpuindom, PMDA_CACHE_LOAD);
+	pmdaCacheOp(layout->indom, PMDA_CACHE_LOAD);
+	layout->setup = 1;
     }
-    pmdaCacheStore(sirq, PMDA_CACHE_ADD, name, ip);
 
-    if (ip->label == NULL)
-	ip->label = end ? strdup(label_reformat(end)) : NULL;
+    setup_buffers();
+    if ((sts = statsfile_read(&layout->file)) < 0)
+	return sts;
+    if ((sts = parse_interrupts(layout, 0)) != -EAGAIN)
+	return sts;
+
+    /* layout changed - buffer was modified in-place, so read it again */
+    if ((sts = statsfile_read(&layout->file)) < 0)
+	return sts;
+    return parse_interrupts(layout, 1);
+}
 
-    return changed;
+int
+refresh_proc_interrupts(void)
+{
+    interrupts.indom = INDOM(INTERRUPT_INDOM);
+    interrupts.cpuindom = INDOM(INTERRUPT_CPU_INDOM);
+    return refresh_interrupts(&interrupts);
 }
 
 int
 refresh_proc_softirqs(void)
 {
-    static int setup;
-    FILE *fp;
-    char *name, *values;
-    int i = 0, save, ncolumns;
-    pmInDom sirq_indom = INDOM(SOFTIRQ_INDOM);
-    pmInDom cpu_sirq_indom = INDOM(SOFTIRQ_CPU_INDOM);
-
-    if (!setup) {
-	pmdaCacheOp(cpu_sirq_indom, PMDA_CACHE_LOAD);
-	pmdaCacheOp(sirq_indom, PMDA_CACHE_LOAD);
-	setup = 1;
-    }
-    pmdaCacheOp(cpu_sirq_indom, PMDA_CACHE_INACTIVE);
-    pmdaCacheOp(sirq_indom, PMDA_CACHE_INACTIVE);
-
-    setup_buffers();
-    for (i = 0; i < _pm_ncpus; i++)
-	online_cpumap[i].sirq_count = 0;
-
-    if ((fp = linux_statsfile("/proc/softirqs", iobuf, iobufsz)) == NULL)
-	return -oserror();
-
-    /* first parse header, which maps online CPU number to column number */
-    if (fgets(iobuf, iobufsz, fp)) {
-	ncolumns = map_online_cpus(iobuf);
-    } else {
-	fclose(fp);
-	return -EINVAL;		/* unrecognised file format */
-    }
-
-    save = 0;
-    while (fgets(iobuf, iobufsz, fp) != NULL) {
-	/* extract values from all subsequent softirqs file lines */
-	name = extract_interrupt_name(iobuf, &values);
-	save |= extract_softirq_values(name, values, sirq_indom, cpu_sirq_indom, ncolumns);
-    }
-    fclose(fp);
-
-    if (save) {
-	pmdaCacheOp(cpu_sirq_indom, PMDA_CACHE_SAVE);
-	pmdaCacheOp(sirq_indom, PMDA_CACHE_SAVE);
-    }
-    return 0;
+    softirqs.indom = INDOM(SOFTIRQ_INDOM);
+    softirqs.cpuindom = INDOM(SOFTIRQ_CPU_INDOM);
+    return refresh_interrupts(&softirqs);
 }
 
 int
@@ -409,3 +501,53 @@ proc_interrupts_fetch(int cluster, int item, unsigned int inst, pmAtomValue *ato
     }
     return PM_ERR_PMID;
 }
+
+/*
+ * Fill in the per-CPU values for all requested instances at once,
+ * returning zero for those metrics not handled here.
+ */
+int
+proc_interrupts_fetch_indom(int cluster, int item, int numinst,
+		unsigned int *instlist, pmAtomValue *atoms, int *sts)
+{
+    interrupt_layout_t *layout;
+    interrupt_cpu_t *cpuip;
+    unsigned int inst;
+    int i, sirq;
+
+    if ((cluster == CLUSTER_INTERRUPTS && item == 1) ||
+	(cluster == CLUSTER_SOFTIRQS && item == 0)) {
+	/* kernel.percpu.interrupts and kernel.percpu.softirqs */
+	layout = (cluster == CLUSTER_SOFTIRQS) ? &softirqs : &interrupts;
+	for (i = 0; i < numinst; i++) {
+	    inst = instlist[i];
+	    if (inst >= layout->ninst || (cpuip = layout->byinst[inst]) == NULL) {
+		sts[i] = PM_ERR_INST;
+		continue;
+	    }
+	    atoms[i].ul = cpuip->value;
+	    sts[i] = PMDA_FETCH_STATIC;
+	}
+	return 1;
+    }
+
+    if ((cluster == CLUSTER_INTERRUPTS && item == 4) ||
+	(cluster == CLUSTER_SOFTIRQS && item == 1)) {
+	/* kernel.percpu.intr and kernel.percpu.sirq */
+	sirq = (cluster == CLUSTER_SOFTIRQS);
+	for (i = 0; i < numinst; i++) {
+	    inst = instlist[i];
+	    if (inst >= _pm_ncpus || online_cpumap == NULL) {
+		sts[i] = PM_ERR_INST;
+		continue;
+	    }
+	    inst = column_to_cpuid(inst);
+	    atoms[i].ull = sirq ? online_cpumap[inst].sirq_count :
+				  online_cpumap[inst].intr_count;
+	    sts[i] = PMDA_FETCH_STATIC;
+	}
+	return 1;
+    }
+
+    return 0;
+}
@@ -36,5 +36,6 @@ extern unsigned int irq_mis_count;
 extern int refresh_proc_interrupts(void);
 extern int refresh_proc_softirqs(void);
 extern int proc_interrupts_fetch(int, int, unsigned int, pmAtomValue *);
+extern int proc_interrupts_fetch_indom(int, int, int, unsigned int *, pmAtomValue *, int *);
 extern int proc_softirqs_fetch(int, int, unsigned int, pmAtomValue *);
 
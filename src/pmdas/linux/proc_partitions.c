@@ -22,6 +22,7 @@
 #include <sys/sysmacros.h>
 #include "linux.h"
 #include "proc_partitions.h"
+#include "statsfile.h"
 
 static int _pm_have_kernel_2_6_partition_stats;
 
@@ -521,41 +522,114 @@ refresh_disk_indom(char *namebuf, size_t namelen, int devmaj, int devmin,
     return p;
 }
 
+#define DISKSTATS_FIELDS	17	/* maximum values after device name */
+
+/*
+ * Mapping from /proc/diskstats line (by position) to the instance it
+ * was resolved to on a previous refresh.  Entries are never freed, so
+ * while a line names the same device, classifying the device and the
+ * instance lookup can be skipped.  Device mapper and md lines are not
+ * mapped, as their persistent names can change while the line doesn't.
+ */
+typedef struct {
+    int			devmaj;
+    int			devmin;
+    int			remap;		/* persistent name lookup needed */
+    char		*name;		/* device name as in /proc/diskstats */
+    pmInDom		indom;
+    partitions_entry_t	*p;		/* NULL if device is not exported */
+} diskstats_line_t;
+
+static diskstats_line_t	*diskstats_lines;
+static int		diskstats_maxlines;
+
+static diskstats_line_t *
+diskstats_line(int nline)
+{
+    diskstats_line_t	*lines;
+    int			size;
+
+    if (nline >= diskstats_maxlines) {
+	size = diskstats_maxlines ? diskstats_maxlines * 2 : 64;
+	if ((lines = realloc(diskstats_lines, size * sizeof(*lines))) == NULL)
+	    return NULL;
+	memset(lines + diskstats_maxlines, 0,
+		(size - diskstats_maxlines) * sizeof(*lines));
+	diskstats_lines = lines;
+	diskstats_maxlines = size;
+    }
+    return &diskstats_lines[nline];
+}
+
 static int
-refresh_diskstats(FILE *fp, pmInDom disk_indom, pmInDom part_indom,
+refresh_diskstats(statsfile_t *file, pmInDom disk_indom, pmInDom part_indom,
 		pmInDom zram_indom, pmInDom dm_indom, pmInDom md_indom)
 {
     int			indom_changes = 0;
-    int			devmin, devmaj, n;
-    char		buf[MAXPATHLEN];
+    int			devmin, devmaj, n, nline = 0;
+    unsigned long long	v[DISKSTATS_FIELDS];
     char		name[MAXPATHLEN];
+    char		*cursor = file->buf, *line, *s;
+    diskstats_line_t	*lp;
     partitions_entry_t	*p;
 
-    while (fgets(buf, sizeof(buf), fp) != NULL) {
+    while ((line = statsfile_getline(&cursor)) != NULL) {
 	/* skip heading */
-	if (buf[0] != ' ' || buf[0] == '\n')
+	if (line[0] != ' ')
 	    continue;
 
-	if ((n = sscanf(buf, "%d %d %s", &devmaj, &devmin, name)) != 3)
+	/* Linux source: block/genhd.c::diskstats_show(1) */
+	s = line;
+	if (statsfile_column(&s, &v[0]) < 0 || statsfile_column(&s, &v[1]) < 0)
+	    continue;
+	devmaj = v[0];
+	devmin = v[1];
+	while (*s == ' ' || *s == '\t')
+	    s++;
+	for (n = 0; *s != '\0' && *s != ' ' && *s != '\t' && n < sizeof(name) - 1; n++)
+	    name[n] = *s++;
+	name[n] = '\0';
+	if (n == 0)
 	    continue;
 
-	if (!(p = refresh_disk_indom(name, sizeof(name), devmaj, devmin,
+	/* values are scanned directly, before name is remapped in-place */
+	for (n = 0; n < DISKSTATS_FIELDS; n++)
+	    if (statsfile_column(&s, &v[n]) < 0)
+		break;
+
+	lp = diskstats_line(nline++);
+	if (lp && !lp->remap && lp->name && lp->devmaj == devmaj &&
+	    lp->devmin == devmin && strcmp(lp->name, name) == 0) {
+	    /* same device as last time, just (re)activate its instance */
+	    if ((p = lp->p) == NULL)
+		continue;
+	    if (p->zram)
+		p->zram->uptodate = 0;	/* refreshing now required */
+	    p->nr_blocks = 0;		/* zero if not read/needed */
+	    pmdaCacheStore(lp->indom, PMDA_CACHE_ADD,
+			p->udevnamebuf ? p->udevnamebuf : p->namebuf, p);
+	} else {
+	    if (lp) {
+		free(lp->name);
+		lp->name = strdup(name);
+		lp->devmaj = devmaj;
+		lp->devmin = devmin;
+		lp->remap = _pm_isdm(name) || _pm_ismd(name);
+		lp->indom = _pm_ispartition(name) ? part_indom :
+			    _pm_isdisk(name) ? disk_indom : zram_indom;
+	    }
+	    p = refresh_disk_indom(name, sizeof(name), devmaj, devmin,
 			disk_indom, part_indom, zram_indom, dm_indom, md_indom,
-			&indom_changes)))
-	    continue;
+			&indom_changes);
+	    if (lp)
+		lp->p = p;
+	    if (p == NULL)
+		continue;
+	}
 
-	/* 2.6 style /proc/diskstats */
-	name[0] = '\0';
-	/* Linux source: block/genhd.c::diskstats_show(1) */
-	n = sscanf(buf, "%u %u %s %llu %llu %llu %u %llu %llu %llu %u "
-			"%u %u %u %llu %llu %llu %u %llu %u",
-		&p->major, &p->minor, name,
-		&p->rd_ios, &p->rd_merges, &p->rd_sectors, &p->rd_ticks,
-		&p->wr_ios, &p->wr_merges, &p->wr_sectors, &p->wr_ticks,
-		&p->ios_in_flight, &p->io_ticks, &p->aveq,
-		&p->ds_ios, &p->ds_merges, &p->ds_sectors, &p->ds_ticks,
-		&p->fl_ios, &p->fl_ticks);
-	if (n < 14) {
+	p->major = devmaj;
+	p->minor = devmin;
+	if (n < 11) {
 	    /*
 	     * From 2.6.25 onward, the full set of statistics is
 	     * available again for both partitions and disks.
@@ -566,18 +640,38 @@ refresh_diskstats(FILE *fp, pmInDom disk_indom, pmInDom part_indom,
 			p->ds_ios = p->ds_merges = p->ds_sectors =
 			p->ds_ticks = p->fl_ios = p->fl_ticks = 0;
 	    /* Linux source: block/genhd.c::diskstats_show(2) */
-	    sscanf(buf, "%u %u %s %u %u %u %u\n",
-		    &p->major, &p->minor, name,
-		    (unsigned int *)&p->rd_ios, (unsigned int *)&p->rd_sectors,
-		    (unsigned int *)&p->wr_ios, (unsigned int *)&p->wr_sectors);
+	    p->rd_ios = (unsigned int)(n > 0 ? v[0] : 0);
+	    p->rd_sectors = (unsigned int)(n > 1 ? v[1] : 0);
+	    p->wr_ios = (unsigned int)(n > 2 ? v[2] : 0);
+	    p->wr_sectors = (unsigned int)(n > 3 ? v[3] : 0);
+	    continue;
 	}
-	if (n < 18) {
+	p->rd_ios = v[0];
+	p->rd_merges = v[1];
+	p->rd_sectors = v[2];
+	p->rd_ticks = v[3];
+	p->wr_ios = v[4];
+	p->wr_merges = v[5];
+	p->wr_sectors = v[6];
+	p->wr_ticks = v[7];
+	p->ios_in_flight = v[8];
+	p->io_ticks = v[9];
+	p->aveq = v[10];
+	if (n < 15) {
 	    /* Discard statistics are not present */
 	    p->ds_ios = p->ds_merges = p->ds_sectors = p->ds_ticks = 0;
+	} else {
+	    p->ds_ios = v[11];
+	    p->ds_merges = v[12];
+	    p->ds_sectors = v[13];
+	    p->ds_ticks = v[14];
 	}
-	if (n < 20) {
+	if (n < 17) {
 	    /* Flush statistics are not present */
 	    p->fl_ios = p->fl_ticks = 0;
+	} else {
+	    p->fl_ios = v[15];
+	    p->fl_ticks = v[16];
 	}
     }
     return indom_changes;
@@ -630,6 +724,7 @@ refresh_proc_partitions(pmInDom disk_indom, pmInDom part_indom,
     int		indom_changes = 0;
     char	buf[MAXPATHLEN];
     static int	first = 1;
+    static statsfile_t diskstats = STATSFILE_INIT("/proc/diskstats");
 
     if (first) {
 	/* initialize the instance domain caches */
@@ -650,10 +745,9 @@ refresh_proc_partitions(pmInDom disk_indom, pmInDom part_indom,
 
     /* 2.6 style disk stats */
     if (need_diskstats) {
-	if ((fp = linux_statsfile("/proc/diskstats", buf, sizeof(buf)))) {
-	    indom_changes += refresh_diskstats(fp, disk_indom, part_indom,
+	if (statsfile_read(&diskstats) >= 0) {
+	    indom_changes += refresh_diskstats(&diskstats, disk_indom, part_indom,
 						zram_indom, dm_indom, md_indom);
-	    fclose(fp);
 	} else {
 	    need_partitions = 1;
 	}
@@ -17,6 +17,7 @@
  */
 #include "linux.h"
 #include "proc_stat.h"
+#include "statsfile.h"
 #include <sys/stat.h>
 #include <dirent.h>
 #include <ctype.h>
@@ -59,6 +60,34 @@ setup_cpu_info(cpuinfo_t *cip)
     cip->flags = -1;
 }
 
+/*
+ * CPU and node private data indexed by instance identifier, allowing
+ * values for all instances to be fetched without pmdaCache lookups.
+ */
+percpu_t	**percpu_table;
+unsigned int	percpu_count;
+pernode_t	**pernode_table;
+unsigned int	pernode_count;
+
+static void
+table_insert(void ***table, unsigned int *count, int inst, void *data)
+{
+    void	**entries;
+    unsigned int need;
+
+    if (inst < 0)
+	return;
+    if (inst >= *count) {
+	need = inst + 1;
+	if ((entries = realloc(*table, need * sizeof(void *))) == NULL)
+	    return;
+	memset(entries + *count, 0, (need - *count) * sizeof(void *));
+	*table = entries;
+	*count = need;
+    }
+    (*table)[inst] = data;
+}
+
 static void
 cpu_add(pmInDom cpus, unsigned int cpuid, pernode_t *np)
 {
@@ -72,6 +101,7 @@ cpu_add(pmInDom cpus, unsigned int cpuid, pernode_t *np)
     setup_cpu_info(&cpu->info);
     pmsprintf(name, sizeof(name)-1, "cpu%u", cpuid);
     cpu->instid = pmdaCacheStore(cpus, PMDA_CACHE_ADD, name, (void*)cpu);
+    table_insert((void ***)&percpu_table, &percpu_count, cpu->instid, cpu);
 }
 
 static pernode_t *
@@ -85,6 +115,7 @@ node_add(pmInDom nodes, unsigned int nodeid)
     node->nodeid = nodeid;
     pmsprintf(name, sizeof(name)-1, "node%u", nodeid);
     node->instid = pmdaCacheStore(nodes, PMDA_CACHE_ADD, name, (void*)node);
+    table_insert((void ***)&pernode_table, &pernode_count, node->instid, node);
     return node;
 }
 
@@ -175,14 +206,12 @@ refresh_proc_stat(proc_stat_t *proc_stat)
     pernode_t	*np;
     percpu_t	*cp;
     pmInDom	cpus, nodes;
-    char	buf[MAXPATHLEN], *name, *sp, **bp;
-    char	cpuname[32];
+    char	*name, *line, *cursor, **bp;
     int		n = 0, i, size;
+    unsigned int cpuid;
     static unsigned long long	prev_wait;
 
-    static int fd = -1; /* kept open until exit(), unless testing */
-    static char *statbuf;
-    static int maxstatbuf;
+    static statsfile_t statfile = STATSFILE_INIT("/proc/stat");
     static char **bufindex;
     static int nbufindex;
     static int maxbufindex;
@@ -201,36 +230,9 @@ refresh_proc_stat(proc_stat_t *proc_stat)
 	memset(&np->stat, 0, sizeof(np->stat));
     }
 
-    /* in test mode we replace procfs files (keeping fd open thwarts that) */
-    if (fd >= 0 && (linux_test_mode & LINUX_TEST_STATSPATH)) {
-	close(fd);
-	fd = -1;
-    }
-
-    if (fd >= 0) {
-	if (lseek(fd, 0, SEEK_SET) < 0)
-	    return -oserror();
-    } else {
-	pmsprintf(buf, sizeof(buf), "%s/proc/stat", linux_statspath);
-	if ((fd = open(buf, O_RDONLY)) < 0)
-	    return -oserror();
-    }
-
-    for (;;) {
-	while (n >= maxstatbuf) {
-	    size = maxstatbuf + 512;
-	    if ((sp = (char *)realloc(statbuf, size)) == NULL)
-		return -ENOMEM;
-	    statbuf = sp;
-	    maxstatbuf = size;
-	}
-	size = (statbuf + maxstatbuf) - (statbuf + n);
-	if ((i = read(fd, statbuf + n, size)) > 0)
-	    n += i;
-	else
-	    break;
-    }
-    statbuf[n] = '\0';
+    /* kept open until exit(), unless testing */
+    if ((n = statsfile_read(&statfile)) < 0)
+	return n;
 
     if (bufindex == NULL) {
 	size = 16 * sizeof(char *);
@@ -240,19 +242,16 @@ refresh_proc_stat(proc_stat_t *proc_stat)
     }
 
     nbufindex = 0;
-    bufindex[nbufindex] = statbuf;
-    for (i = 0; i < n; i++) {
-	if (statbuf[i] == '\n' || statbuf[i] == '\0') {
-	    statbuf[i] = '\0';
-	    if (nbufindex + 1 >= maxbufindex) {
-		size = (maxbufindex + 4) * sizeof(char *);
-		if ((bp = (char **)realloc(bufindex, size)) == NULL)
-		    return -ENOMEM;
-		bufindex = bp;
-	    	maxbufindex += 4;
-	    }
-	    bufindex[++nbufindex] = statbuf + i + 1;
+    bufindex[nbufindex] = cursor = statfile.buf;
+    while ((line = statsfile_getline(&cursor)) != NULL) {
+	if (nbufindex + 1 >= maxbufindex) {
+	    size = (maxbufindex + 4) * sizeof(char *);
+	    if ((bp = (char **)realloc(bufindex, size)) == NULL)
+		return -ENOMEM;
+	    bufindex = bp;
+	    maxbufindex += 4;
 	}
+	bufindex[++nbufindex] = cursor;
     }
 
 #define ALLCPU_FMT "cpu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu"
@@ -304,19 +303,28 @@ refresh_proc_stat(proc_stat_t *proc_stat)
 		continue;
 	    cp = NULL;
 	    np = NULL;
-	    i = atoi(&bufindex[n][3]);	/* extract CPU identifier */
-	    pmsprintf(cpuname, sizeof(cpuname), "cpu%u", i); /* instance name */
-	    if (pmdaCacheLookupName(cpus, cpuname, &i, (void **)&cp) < 0 || !cp)
+	    /*
+	     * extract CPU identifier, which is also the instance identifier
+	     * (direct mapping, see setup_cpu_indom) - then scan the values
+	     * directly, as per PERCPU_FMT; missing trailing values are zero.
+	     */
+	    line = &bufindex[n][3];
+	    cpuid = statsfile_ull(&line);
+	    if (pmdaCacheLookup(cpus, cpuid, &name, (void **)&cp) < 0 || !cp)
 		continue;
 	    /* need to NOT zero out the prev_wait field, as it is used below */
 	    prev_wait = cp->stat.prev_wait;
-	    memset(&cp->stat, 0, sizeof(cp->stat));
+	    cp->stat.user = statsfile_ull(&line);
+	    cp->stat.nice = statsfile_ull(&line);
+	    cp->stat.sys = statsfile_ull(&line);
+	    cp->stat.idle = statsfile_ull(&line);
+	    cp->stat.wait = statsfile_ull(&line);
+	    cp->stat.irq = statsfile_ull(&line);
+	    cp->stat.sirq = statsfile_ull(&line);
+	    cp->stat.steal = statsfile_ull(&line);
+	    cp->stat.guest = statsfile_ull(&line);
+	    cp->stat.guest_nice = statsfile_ull(&line);
 	    cp->stat.prev_wait = prev_wait;
-	    sscanf(bufindex[n], PERCPU_FMT, &i,
-		    &cp->stat.user, &cp->stat.nice, &cp->stat.sys,
-		    &cp->stat.idle, &cp->stat.wait, &cp->stat.irq,
-		    &cp->stat.sirq, &cp->stat.steal, &cp->stat.guest,
-		    &cp->stat.guest_nice);
 	    /* see comment above re kernel waitio */
 	    if (cp->stat.prev_wait > 0 &&
 		    cp->stat.wait < cp->stat.prev_wait &&
@@ -326,7 +334,7 @@ refresh_proc_stat(proc_stat_t *proc_stat)
 	    else
 		cp->stat.prev_wait = cp->stat.wait;
 
-	    pmdaCacheStore(cpus, PMDA_CACHE_ADD, cpuname, (void *)cp);
+	    pmdaCacheStore(cpus, PMDA_CACHE_ADD, name, (void *)cp);
 
 	    /* update per-node aggregate CPU utilisation stats as well */
 	    if (pmdaCacheLookup(nodes, cp->node->instid, NULL, (void **)&np) < 0 || !np)
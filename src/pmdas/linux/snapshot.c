@@ -0,0 +1,222 @@
+/*
+ * Linux PMDA refresh coalescing and background refresh
+ *
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#include <pthread.h>
+#include "linux.h"
+#include "snapshot.h"
+
+snapshot_t			snapshot;
+
+static pthread_mutex_t		snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t		snapshot_thread;
+static snapshot_refresh_t	snapshot_refresh;
+static double			stamps[NUM_REFRESHES];	/* last refresh time */
+static int			demand[NUM_REFRESHES];	/* requested so far */
+
+static double
+snapshot_now(void)
+{
+    struct timeval	now;
+
+    pmtimevalNow(&now);
+    return pmtimevalToReal(&now);
+}
+
+/*
+ * Some refreshes depend on the credentials of the requesting client,
+ * or are cheap enough (and namespace-specific) that sharing them
+ * between contexts is not worthwhile - these are never coalesced.
+ */
+static int
+snapshot_exempt(int index)
+{
+    switch (index) {
+    case CLUSTER_SLAB:
+    case CLUSTER_TTY:
+    case CLUSTER_KERNEL_UNAME:
+    case CLUSTER_REFRESH:
+	return 1;
+    }
+    return 0;
+}
+
+void
+snapshot_lock(void)
+{
+    pthread_mutex_lock(&snapshot_mutex);
+}
+
+void
+snapshot_unlock(void)
+{
+    pthread_mutex_unlock(&snapshot_mutex);
+}
+
+/*
+ * Clear the refresh request for each cluster with values still
+ * considered fresh - called with the snapshot lock held, and only
+ * for contexts without a container (host namespaces).
+ */
+void
+snapshot_coalesce(int *need_refresh)
+{
+    double		now, window;
+    int			i;
+
+    if (snapshot.interval == 0 && snapshot.window == 0)
+	return;
+
+    now = snapshot_now();
+    window = snapshot.window / 1000.0;
+    for (i = 0; i < NUM_REFRESHES; i++) {
+	if (need_refresh[i] == 0 || snapshot_exempt(i))
+	    continue;
+	demand[i] = 1;
+	if (stamps[i] == 0.0)	/* no snapshot yet */
+	    continue;
+	if (snapshot.interval || now - stamps[i] < window) {
+	    need_refresh[i] = 0;
+	    snapshot.coalesced++;
+	}
+    }
+}
+
+/*
+ * Record the time at which each requested cluster was refreshed.
+ */
+void
+snapshot_update(int *need_refresh)
+{
+    double		now;
+    int			i, count = 0;
+
+    if (snapshot.interval == 0 && snapshot.window == 0)
+	return;
+
+    now = snapshot_now();
+    for (i = 0; i < NUM_REFRESHES; i++) {
+	if (need_refresh[i] && !snapshot_exempt(i)) {
+	    stamps[i] = now;
+	    count++;
+	}
+    }
+    if (count)
+	snapshot.refreshes++;
+}
+
+/*
+ * Values refreshed inside a container namespace replace the host
+ * values in memory, so these must be re-read for the next host fetch.
+ */
+void
+snapshot_invalidate(int *need_refresh)
+{
+    int			i;
+
+    for (i = 0; i < NUM_REFRESHES; i++) {
+	if (need_refresh[i])
+	    stamps[i] = 0.0;
+    }
+}
+
+/*
+ * Age (msec) of the oldest snapshot of any requested cluster, i.e.
+ * the worst-case staleness of values currently being served.
+ */
+double
+snapshot_age(void)
+{
+    double		now, oldest = 0.0;
+    int			i;
+
+    for (i = 0; i < NUM_REFRESHES; i++) {
+	if (demand[i] == 0 || stamps[i] == 0.0)
+	    continue;
+	if (oldest == 0.0 || stamps[i] < oldest)
+	    oldest = stamps[i];
+    }
+    if (oldest == 0.0)
+	return 0.0;
+    now = snapshot_now();
+    return (now - oldest) * 1000.0;
+}
+
+static void *
+snapshot_worker(void *arg)
+{
+    struct timespec	delay;
+    int			need_refresh[NUM_REFRESHES];
+    int			i, count;
+
+    (void)arg;
+    delay.tv_sec = snapshot.interval / 1000;
+    delay.tv_nsec = (snapshot.interval % 1000) * 1000000;
+
+    for (;;) {
+	snapshot_lock();
+	for (i = count = 0; i < NUM_REFRESHES; i++)
+	    count += (need_refresh[i] = demand[i]);
+	if (count && snapshot_refresh(need_refresh) >= 0)
+	    snapshot_update(need_refresh);
+	snapshot_unlock();
+	nanosleep(&delay, NULL);
+    }
+    return NULL;
+}
+
+static void
+snapshot_environ(const char *name, unsigned int *msec)
+{
+    struct timeval	delta;
+    char		*value, *errmsg;
+
+    if (*msec != 0 || (value = getenv(name)) == NULL)
+	return;
+    if (pmParseInterval(value, &delta, &errmsg) < 0) {
+	pmNotifyErr(LOG_ERR, "%s: ignoring invalid $%s interval \"%s\"",
+			pmGetProgname(), name, value);
+	free(errmsg);
+	return;
+    }
+    *msec = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+}
+
+/*
+ * Settings from the environment, the only means of configuring the
+ * DSO - explicit command line options of the daemon take precedence.
+ */
+void
+snapshot_config(void)
+{
+    snapshot_environ("LINUX_REFRESH", &snapshot.interval);
+    snapshot_environ("LINUX_WINDOW", &snapshot.window);
+}
+
+int
+snapshot_start(snapshot_refresh_t refresh)
+{
+    int			sts;
+
+    if (snapshot.interval == 0)
+	return 0;
+    snapshot_refresh = refresh;
+    if ((sts = pthread_create(&snapshot_thread, NULL, snapshot_worker, NULL)) != 0) {
+	pmNotifyErr(LOG_ERR, "%s: cannot start refresh thread: %s",
+			pmGetProgname(), pmErrStr(-sts));
+	snapshot.interval = 0;
+	return -sts;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/*
+ * Optional refresh coalescing for the linux PMDA.  By default every
+ * fetch re-reads each needed /proc and /sys file.  With a freshness
+ * window, a cluster refreshed within the window is served from the
+ * values already in memory.  With a background interval, a separate
+ * thread refreshes every cluster that has been requested so far and
+ * fetches are always served from the latest snapshot.
+ */
+typedef struct {
+    unsigned int	interval;	/* background refresh interval (msec) */
+    unsigned int	window;		/* freshness window (msec) */
+    unsigned long long	refreshes;	/* number of refresh passes */
+    unsigned long long	coalesced;	/* cluster refreshes avoided */
+} snapshot_t;
+
+extern snapshot_t snapshot;
+
+typedef int (*snapshot_refresh_t)(int *);
+
+extern void snapshot_lock(void);
+extern void snapshot_unlock(void);
+extern void snapshot_coalesce(int *);
+extern void snapshot_update(int *);
+extern void snapshot_invalidate(int *);
+extern double snapshot_age(void);
+extern void snapshot_config(void);
+extern int snapshot_start(snapshot_refresh_t);
+
+#endif /* SNAPSHOT_H */
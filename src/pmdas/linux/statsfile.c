@@ -0,0 +1,86 @@
+/*
+ * Linux PMDA reusable /proc file reader
+ *
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#include "linux.h"
+#include "statsfile.h"
+
+/*
+ * Read the entire file into the (persistent) buffer, returning its
+ * length or a negative error code.
+ */
+int
+statsfile_read(statsfile_t *file)
+{
+    char		path[MAXPATHLEN], *p;
+    unsigned int	size;
+    ssize_t		bytes;
+    off_t		offset = 0;
+
+    /* in test mode we replace procfs files (keeping fd open thwarts that) */
+    if (file->fd >= 0 && (linux_test_mode & LINUX_TEST_STATSPATH)) {
+	close(file->fd);
+	file->fd = -1;
+    }
+    if (file->fd < 0) {
+	pmsprintf(path, sizeof(path), "%s%s", linux_statspath, file->path);
+	if ((file->fd = open(path, O_RDONLY)) < 0)
+	    return -oserror();
+    }
+
+    for (;;) {
+	if (offset + 1 >= file->size) {
+	    size = file->size ? file->size * 2 : BUFSIZ;
+	    if ((p = (char *)realloc(file->buf, size)) == NULL)
+		return -ENOMEM;
+	    file->buf = p;
+	    file->size = size;
+	}
+	bytes = pread(file->fd, file->buf + offset,
+			file->size - offset - 1, offset);
+	if (bytes < 0) {
+	    bytes = -oserror();
+	    close(file->fd);
+	    file->fd = -1;
+	    return bytes;
+	}
+	if (bytes == 0)
+	    break;
+	offset += bytes;
+    }
+    file->buf[offset] = '\0';
+    file->length = offset;
+    return offset;
+}
+
+/*
+ * Return the next line from the buffer (NUL terminated in place),
+ * advancing the cursor, or NULL at the end of the buffer.  The C
+ * library delimiter search is vectorised on most platforms.
+ */
+char *
+statsfile_getline(char **cursor)
+{
+    char		*line = *cursor, *end;
+
+    if (line == NULL || *line == '\0')
+	return NULL;
+    if ((end = strchr(line, '\n')) != NULL) {
+	*end = '\0';
+	*cursor = end + 1;
+    } else {
+	*cursor = line + strlen(line);
+    }
+    return line;
+}
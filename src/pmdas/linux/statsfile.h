@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#ifndef STATSFILE_H
+#define STATSFILE_H
+
+/*
+ * Reusable whole-file reader for hot, frequently refreshed /proc
+ * files.  The file descriptor is kept open between refreshes (except
+ * in QA mode, where the files are replaced under us) and the buffer
+ * is grown as needed and never freed, so steady state refreshes do
+ * not allocate memory or go through stdio.
+ *
+ * Only suitable for files that are not namespace-specific, since the
+ * open descriptor retains the namespace it was first opened in.
+ */
+typedef struct {
+    const char		*path;		/* path below linux_statspath */
+    int			fd;		/* descriptor kept open, or -1 */
+    unsigned int	size;		/* allocated buffer size */
+    unsigned int	length;		/* bytes from most recent read */
+    char		*buf;		/* file contents, NUL terminated */
+} statsfile_t;
+
+#define STATSFILE_INIT(path)	{ (path), -1, 0, 0, NULL }
+
+extern int statsfile_read(statsfile_t *);
+extern char *statsfile_getline(char **);
+
+/*
+ * Skip leading non-digits then scan an unsigned decimal value,
+ * advancing the cursor past it.  Returns 0 at end of line (NUL).
+ */
+static inline unsigned long long
+statsfile_ull(char **cursor)
+{
+    unsigned long long	value = 0;
+    char		*s = *cursor;
+
+    while (*s != '\0' && (*s < '0' || *s > '9'))
+	s++;
+    while (*s >= '0' && *s <= '9')
+	value = value * 10 + (*s++ - '0');
+    *cursor = s;
+    return value;
+}
+
+/*
+ * Scan one whitespace-separated unsigned decimal column, stopping at
+ * the first non-digit; returns -1 if the next column is not numeric.
+ */
+static inline int
+statsfile_column(char **cursor, unsigned long long *value)
+{
+    char		*s = *cursor;
+
+    while (*s == ' ' || *s == '\t')
+	s++;
+    if (*s < '0' || *s > '9')
+	return -1;
+    for (*value = 0; *s >= '0' && *s <= '9'; s++)
+	*value = *value * 10 + (*s - '0');
+    *cursor = s;
+    return 0;
+}
+
+#endif /* STATSFILE_H */
@@ -183,6 +183,9 @@ metrictype(int mtype)
     case MMV_TYPE_ELAPSED:
 	type = "elapsed";
 	break;
+    case MMV_TYPE_HISTOGRAM:
+	type = "histogram";
+	break;
     default:
 	type = "?";
 	break;
@@ -396,6 +399,14 @@ dump_value(void *addr, size_t size, mmv_disk_value_t *vals, int i, int toc, int
 	    printf("Bad (positive) ELAPSED 'extra' value found!");
 	}
 	break;
+    case MMV_TYPE_HISTOGRAM:
+	printf(" = %" PRIu64 " (buckets at %" PRIi64 ")",
+			vals[i].value.ull, vals[i].extra);
+	if (size < vals[i].extra + sizeof(mmv_disk_histogram_t)) {
+	    printf("\nBad file size: toc[%d] histogram value[%d] extra\n", toc, i);
+	    return 1;
+	}
+	break;
     default:
 	printf("Unknown type %d", type);
     }
@@ -419,6 +430,8 @@ dump_values1(void *addr, size_t size, int idx, long base, __uint64_t offset, __i
 	    return 1;
 	}
 	moff = vals[i].metric;
+	if (moff == 0)		/* padding */
+	    continue;
 	if (size < moff + sizeof(mmv_disk_metric_t)) {
 	    printf("Bad file size: toc[%d] value[%d] metric offset\n", idx, i);
 	    return 1;
@@ -458,6 +471,8 @@ dump_values2(void *addr, size_t size, int idx, long base, __uint64_t offset, __i
 	    return 1;
 	}
 	moff = vals[i].metric;
+	if (moff == 0)		/* padding */
+	    continue;
 	if (size < moff + sizeof(mmv_disk_metric2_t)) {
 	    printf("Bad file size: toc[%d] value[%d] metric offset\n", idx, i);
 	    return 1;
@@ -563,6 +578,35 @@ dump_labels(void *addr, size_t size, int idx, long base, __uint64_t offset, __in
     return 0;
 }
 
+int
+dump_histograms(void *addr, size_t size, int idx, long base, __uint64_t offset, __int32_t count)
+{
+    int i, b;
+    mmv_disk_histogram_t *hist = (mmv_disk_histogram_t *)
+			((char *)addr + offset);
+
+    printf("\nTOC[%d]: offset %ld, histograms offset %"PRIu64" (%d entries)\n",
+		idx, base, offset, count);
+
+    for (i = 0; i < count; i++) {
+	__uint64_t off = offset + i * sizeof(mmv_disk_histogram_t);
+
+	if (size < off + sizeof(mmv_disk_histogram_t)) {
+	    printf("Bad file size: too small for toc[%d] histogram[%d]\n", idx, i);
+	    return 1;
+	}
+	printf("  [%u/%"PRIu64"] sum=%"PRIu64"\n", i+1, off, hist[i].sum);
+	for (b = 0; b < MMV_HISTOGRAM_BUCKETS; b++) {
+	    if (hist[i].buckets[b] == 0)
+		continue;
+	    printf("       bucket[%d] %"PRIu64"-%"PRIu64" = %"PRIu64"\n", b,
+		    mmv_histogram_lower(b), mmv_histogram_upper(b),
+		    hist[i].buckets[b]);
+	}
+    }
+    return 0;
+}
+
 static char *
 flagstr(int flags)
 {
@@ -579,8 +623,13 @@ flagstr(int flags)
 	strcat(buf, "process, ");
     if (flags & MMV_FLAG_SENTINEL)
 	strcat(buf, "sentinel, ");
+    if (flags & MMV_FLAG_SHARDED)
+	strcat(buf, "sharded, ");
+    if (flags & MMV_FLAG_PADDED)
+	strcat(buf, "padded, ");
 
-    flags &= ~(MMV_FLAG_NOPREFIX | MMV_FLAG_PROCESS | MMV_FLAG_SENTINEL);
+    flags &= ~(MMV_FLAG_NOPREFIX | MMV_FLAG_PROCESS | MMV_FLAG_SENTINEL |
+	       MMV_FLAG_SHARDED | MMV_FLAG_PADDED);
 
     /* unrecognised bits */
     if (flags) {
@@ -616,7 +665,8 @@ dump(const char *file, void *addr, size_t size)
     }
     version = hdr->version;
     if (version != MMV_VERSION1 && version != MMV_VERSION2 &&
-	version != MMV_VERSION3)
+	version != MMV_VERSION3 && version != MMV_VERSION4 &&
+	version != MMV_VERSION5)
     {
 	printf("Version %d not supported\n", version);
 	return 1;
@@ -688,6 +738,10 @@ dump(const char *file, void *addr, size_t size)
 	    if (dump_labels(addr, size, i, base, offset, count))
 		sts = 1;
 	    break;    
+	case MMV_TOC_HISTOGRAMS:
+	    if (dump_histograms(addr, size, i, base, offset, count))
+		sts = 1;
+	    break;
 	default:
 	    printf("Unrecognised TOC[%d] type: 0x%x\n", i, type);
 	    sts = 1;
@@ -60,6 +60,34 @@ static pmdaOptions opts = {
     .long_options = longopts,
 };
 
+typedef struct {
+    __uint32_t		item;		/* metric item number */
+    __uint32_t		inst;		/* internal instance identifier */
+    int			metric;		/* metric descriptor slot */
+    int			value;		/* value slot */
+    int			first;		/* first value slot for this metric */
+    int			next;		/* first entry after this metric */
+    int			shards;		/* entries for this value, if sharded */
+    int			singular;	/* metric has no instance domain */
+} mmv_index_t;
+
+/*
+ * Each histogram metric in a mapping has three metrics derived from it,
+ * with item numbers allocated downwards from the largest valid item.
+ */
+enum {
+    HISTOGRAM_SUM,		/* sum of sample values */
+    HISTOGRAM_BUCKET,		/* sample count per bucket */
+    HISTOGRAM_PERCENTILE,	/* percentiles estimated from buckets */
+    HISTOGRAM_KINDS
+};
+
+typedef struct {
+    __uint32_t		item;		/* derived metric item number */
+    __uint32_t		base;		/* histogram metric item number */
+    int			kind;		/* HISTOGRAM_* */
+} mmv_hist_t;
+
 typedef struct {
     char		*name;		/* strdup client name */
     void		*addr;		/* mmap */
@@ -67,6 +95,10 @@ typedef struct {
     mmv_disk_metric_t	*metrics1;	/* v1 metric descs in mmap */
     mmv_disk_metric2_t	*metrics2;	/* v2 metric descs in mmap */
     mmv_disk_label_t	*labels; 	/* labels desc in mmap */
+    mmv_index_t		*index;		/* sorted (item,inst) value index */
+    int			icnt;		/* number of index entries */
+    mmv_hist_t		*hist;		/* histogram derived metrics */
+    int			hcnt;		/* number of derived metrics */
     int			vcnt;		/* number of values */
     int			mcnt1;		/* number of metrics */
     int			mcnt2;		/* number of v2 metrics */
@@ -87,6 +119,7 @@ typedef struct {
     int			mtot;
     int			intot;
     int			reload;		/* require reload of maps */
+    int			histograms;	/* any histograms in current maps */
     int			notify;		/* notify pmcd of changes */
     int			statsdir_code;	/* last statsdir stat code */
     time_t		statsdir_ts;	/* last statsdir timestamp */
@@ -105,6 +138,27 @@ typedef struct {
 #define MAX_MMV_CLUSTER ((1<<12)-1)
 #define MAX_MMV_LABELS	((1<<8)-1)
 
+/*
+ * Instance domains of histogram buckets and percentiles, one of each
+ * per cluster, remapped like the client indoms ((cluster << 11) | serial)
+ * and using serials at the top of each cluster's range, reserved from
+ * the clients.
+ */
+#define MAX_MMV_CLIENT_SERIAL		((1<<11)-1)
+#define HISTOGRAM_BUCKET_SERIAL		MAX_MMV_CLIENT_SERIAL
+#define HISTOGRAM_PERCENTILE_SERIAL	(MAX_MMV_CLIENT_SERIAL-1)
+
+static const struct {
+    int			permille;
+    char		*name;
+} percentiles[] = {
+    { 500, "p50" }, { 750, "p75" }, { 900, "p90" },
+    { 950, "p95" }, { 990, "p99" }, { 999, "p99.9" },
+};
+#define NUM_PERCENTILES	(sizeof(percentiles) / sizeof(percentiles[0]))
+
+static char bucketnames[MMV_HISTOGRAM_BUCKETS][48];
+
 /*
  * Check cluster number validity (must be in range 0 .. 1<<12).
  */
@@ -183,7 +237,9 @@ create_client_stat(agent_t *ap, const char *client, const char *path, size_t siz
 
 	    if (header.version != MMV_VERSION1 &&
 		header.version != MMV_VERSION2 &&
-		header.version != MMV_VERSION3) {
+		header.version != MMV_VERSION3 &&
+		header.version != MMV_VERSION4 &&
+		header.version != MMV_VERSION5) {
 		if (pmDebugOptions.appl0)
 		    pmNotifyErr(LOG_ERR,
 			"%s: %s client version %d unsupported (current is %d)",
@@ -393,6 +449,148 @@ create_metric(pmdaExt *pmda, stats_t *s, char *name, pmID pmid, unsigned indom,
     return 0;
 }
 
+/* next free item for a histogram derived metric, or -1 if none left */
+static int
+next_histogram_item(stats_t *s)
+{
+    int			item, i;
+
+    item = s->hcnt ? s->hist[s->hcnt - 1].item - 1 : MAX_MMV_ITEMS;
+    for (; item > 0; item--) {
+	for (i = 0; i < s->mcnt1; i++)
+	    if (s->metrics1[i].item == item)
+		break;
+	if (i < s->mcnt1)
+	    continue;
+	for (i = 0; i < s->mcnt2; i++)
+	    if (s->metrics2[i].item == item)
+		break;
+	if (i == s->mcnt2)
+	    return item;
+    }
+    return -1;
+}
+
+/*
+ * A histogram metric is exported as name.count (the sample count, from
+ * the histogram metric item) plus name.sum, name.bucket (one instance
+ * per bucket) and name.percentile.
+ */
+static int
+create_histogram(pmdaExt *pmda, stats_t *s, char *name, size_t size,
+	__uint32_t item, pmUnits units)
+{
+    static const char	*suffix[] = { "sum", "bucket", "percentile" };
+    agent_t		*ap = (agent_t *)pmdaExtGetData(pmda);
+    pmUnits		count = PMDA_PMUNITS(0,0,1,0,0,PM_COUNT_ONE);
+    mmv_hist_t		*hp;
+    size_t		length = strlen(name);
+    int			kind, sts, sub;
+
+    pmsprintf(name + length, size - length, ".count");
+    if ((sts = create_metric(pmda, s, name, pmID_build(pmda->e_domain,
+			s->cluster, item), 0, MMV_TYPE_U64,
+			MMV_SEM_COUNTER, count)) < 0)
+	return sts;
+
+    for (kind = 0; kind < HISTOGRAM_KINDS; kind++) {
+	if ((sub = next_histogram_item(s)) < 0) {
+	    pmNotifyErr(LOG_WARNING, "MMV: no free items for histogram %s in %s",
+			name, s->name);
+	    return -ENOSPC;
+	}
+	hp = realloc(s->hist, sizeof(mmv_hist_t) * (s->hcnt + 1));
+	if (hp == NULL) {
+	    pmNotifyErr(LOG_ERR, "cannot grow MMV histogram list: %s", s->name);
+	    return -ENOMEM;
+	}
+	s->hist = hp;
+	hp = &s->hist[s->hcnt++];
+	hp->item = sub;
+	hp->base = item;
+	hp->kind = kind;
+
+	pmsprintf(name + length, size - length, ".%s", suffix[kind]);
+	if (kind == HISTOGRAM_PERCENTILE)
+	    sts = create_metric(pmda, s, name, pmID_build(pmda->e_domain,
+			s->cluster, sub), 0, MMV_TYPE_DOUBLE,
+			MMV_SEM_INSTANT, units);
+	else
+	    sts = create_metric(pmda, s, name, pmID_build(pmda->e_domain,
+			s->cluster, sub), 0, MMV_TYPE_U64, MMV_SEM_COUNTER,
+			kind == HISTOGRAM_SUM ? units : count);
+	if (sts < 0)
+	    return sts;
+	if (kind == HISTOGRAM_BUCKET)
+	    ap->metrics[ap->mtot - 1].m_desc.indom =
+		pmInDom_build(pmda->e_domain,
+			(s->cluster << 11) | HISTOGRAM_BUCKET_SERIAL);
+	else if (kind == HISTOGRAM_PERCENTILE)
+	    ap->metrics[ap->mtot - 1].m_desc.indom =
+		pmInDom_build(pmda->e_domain,
+			(s->cluster << 11) | HISTOGRAM_PERCENTILE_SERIAL);
+    }
+    ap->histograms = 1;
+    return 0;
+}
+
+/* instance domains shared by the derived metrics of a cluster's histograms */
+static void
+create_histogram_indoms(pmdaExt *pmda, stats_t *s)
+{
+    agent_t		*ap = (agent_t *)pmdaExtGetData(pmda);
+    pmdaIndom		*ip;
+    __uint64_t		lower, upper;
+    int			i;
+
+    if (bucketnames[1][0] == '\0') {
+	for (i = 0; i < MMV_HISTOGRAM_BUCKETS; i++) {
+	    lower = mmv_histogram_lower(i);
+	    upper = mmv_histogram_upper(i);
+	    if (lower == upper)
+		pmsprintf(bucketnames[i], sizeof(bucketnames[i]),
+			"%" PRIu64, lower);
+	    else
+		pmsprintf(bucketnames[i], sizeof(bucketnames[i]),
+			"%" PRIu64 "-%" PRIu64, lower, upper);
+	}
+    }
+
+    ip = realloc(ap->indoms, sizeof(pmdaIndom) * (ap->intot + 2));
+    if (ip == NULL) {
+	pmNotifyErr(LOG_ERR, "%s: cannot grow indom list for histograms",
+			pmGetProgname());
+	return;
+    }
+    ap->indoms = ip;
+
+    ip = &ap->indoms[ap->intot];
+    ip->it_indom = pmInDom_build(pmda->e_domain,
+			(s->cluster << 11) | HISTOGRAM_BUCKET_SERIAL);
+    ip->it_numinst = 0;
+    if ((ip->it_set = calloc(MMV_HISTOGRAM_BUCKETS, sizeof(pmdaInstid))) != NULL) {
+	ip->it_numinst = MMV_HISTOGRAM_BUCKETS;
+	for (i = 0; i < MMV_HISTOGRAM_BUCKETS; i++) {
+	    ip->it_set[i].i_inst = i;
+	    ip->it_set[i].i_name = bucketnames[i];
+	}
+    }
+    ap->intot++;
+
+    ip = &ap->indoms[ap->intot];
+    ip->it_indom = pmInDom_build(pmda->e_domain,
+			(s->cluster << 11) | HISTOGRAM_PERCENTILE_SERIAL);
+    ip->it_numinst = 0;
+    if ((ip->it_set = calloc(NUM_PERCENTILES, sizeof(pmdaInstid))) != NULL) {
+	ip->it_numinst = NUM_PERCENTILES;
+	for (i = 0; i < NUM_PERCENTILES; i++) {
+	    ip->it_set[i].i_inst = percentiles[i].permille;
+	    ip->it_set[i].i_name = percentiles[i].name;
+	}
+    }
+    ap->intot++;
+}
+
 /* check client serial number validity, and check for a duplicate */
 static int
 verify_indom_serial(pmdaExt *pmda, int serial, stats_t *s, pmInDom *p, pmdaIndom **i)
@@ -410,6 +608,11 @@ verify_indom_serial(pmdaExt *pmda, int serial, stats_t *s, pmInDom *p, pmdaIndom
     }
 
     *p = pmInDom_build(pmda->e_domain, (s->cluster << 11) | serial);
+    if ((pmInDom_serial(*p) & MAX_MMV_CLIENT_SERIAL) >= HISTOGRAM_PERCENTILE_SERIAL) {
+	pmNotifyErr(LOG_WARNING, "reserved serial %u in %s, ignored",
+			serial, s->name);
+	return -EINVAL;
+    }
     for (index = 0; index < ap->intot; index++) {
 	*i = &ap->indoms[index];
 	if (ap->indoms[index].it_indom == *p)
@@ -443,7 +646,7 @@ update_indom(pmdaExt *pmda, stats_t *s, __uint64_t offset, __uint32_t count,
 	    if (j == ip->it_numinst)
 		newinsts++;
 	}
-    } else if (s->version == MMV_VERSION2 || s->version == MMV_VERSION3) {
+    } else {
 	in2 = (mmv_disk_instance2_t *)((char *)s->addr + offset);
 	for (i = 0; i < count; i++) {
 	    for (j = 0; j < ip->it_numinst; j++) {
@@ -485,7 +688,7 @@ update_indom(pmdaExt *pmda, stats_t *s, __uint64_t offset, __uint32_t count,
 		ip->it_numinst++;
 	    }
 	}
-    } else if (s->version == MMV_VERSION2 || s->version == MMV_VERSION3) {
+    } else {
 	for (i = 0; i < count; i++) {
 	    for (j = 0; j < ip->it_numinst; j++)
 		if (ip->it_set[j].i_inst == in2[i].internal)
@@ -540,7 +743,7 @@ create_indom(pmdaExt *pmda, stats_t *s, __uint64_t offset, __uint32_t count,
 	    ip->it_set[i].i_inst = in1[i].internal;
 	    ip->it_set[i].i_name = in1[i].external;
 	}
-    } else if (s->version == MMV_VERSION2 || s->version == MMV_VERSION3) {
+    } else {
 	in2 = (mmv_disk_instance2_t *)((char *)s->addr + offset);
 	ip->it_numinst = count;
 	for (i = 0; i < count; i++) {
@@ -553,6 +756,124 @@ create_indom(pmdaExt *pmda, stats_t *s, __uint64_t offset, __uint32_t count,
     return 0;
 }
 
+static int
+index_compare(const void *a, const void *b)
+{
+    const mmv_index_t	*ia = (const mmv_index_t *)a;
+    const mmv_index_t	*ib = (const mmv_index_t *)b;
+
+    if (ia->item != ib->item)
+	return ia->item < ib->item ? -1 : 1;
+    if (ia->metric != ib->metric)
+	return ia->metric < ib->metric ? -1 : 1;
+    if (ia->inst != ib->inst)
+	return ia->inst < ib->inst ? -1 : 1;
+    return ia->value - ib->value;
+}
+
+/*
+ * Build a sorted index of the values in a mapping, so that fetching
+ * a (item,inst) pair is a binary search rather than a scan through
+ * every metric and value.  Entries are ordered by item, metric slot,
+ * instance and value slot, which preserves the first-match semantics
+ * of a linear scan through the file.  The mapping is immutable until
+ * its generation number changes, which forces map_stats() to rebuild.
+ */
+static void
+create_index(stats_t *s)
+{
+    mmv_disk_value_t	*v = s->values;
+    mmv_index_t		*ip;
+    __uint64_t		mbase, moffset, msize, ioffset, isize;
+    __uint32_t		indom;
+    int			i, mcnt, vi, first;
+
+    free(s->index);
+    s->index = NULL;
+    s->icnt = 0;
+
+    if (s->version == MMV_VERSION1) {
+	mbase = (char *)s->metrics1 - (char *)s->addr;
+	msize = sizeof(mmv_disk_metric_t);
+	isize = sizeof(mmv_disk_instance_t);
+	mcnt = s->metrics1 ? s->mcnt1 : 0;
+    } else {
+	mbase = (char *)s->metrics2 - (char *)s->addr;
+	msize = sizeof(mmv_disk_metric2_t);
+	isize = sizeof(mmv_disk_instance2_t);
+	mcnt = s->metrics2 ? s->mcnt2 : 0;
+    }
+    if (mcnt == 0 || s->vcnt == 0)
+	return;
+
+    if ((s->index = malloc(s->vcnt * sizeof(mmv_index_t))) == NULL) {
+	pmNotifyErr(LOG_WARNING, "MMV: %s - cannot index %d values, "
+			"using linear lookups", s->name, s->vcnt);
+	return;
+    }
+
+    for (vi = 0; vi < s->vcnt; vi++) {
+	moffset = v[vi].metric;
+	if (moffset < mbase || (moffset - mbase) % msize != 0 ||
+	    (moffset - mbase) / msize >= mcnt)
+	    continue;	/* matches no metric descriptor */
+
+	ip = &s->index[s->icnt];
+	ip->metric = (moffset - mbase) / msize;
+	ip->value = vi;
+	if (s->version == MMV_VERSION1) {
+	    ip->item = s->metrics1[ip->metric].item;
+	    indom = s->metrics1[ip->metric].indom;
+	} else {
+	    ip->item = s->metrics2[ip->metric].item;
+	    indom = s->metrics2[ip->metric].indom;
+	}
+	ip->singular = (indom == PM_INDOM_NULL || indom == 0);
+	if (ip->singular)
+	    ip->inst = PM_IN_NULL;
+	else {
+	    ioffset = v[vi].instance;
+	    if (s->len < ioffset + isize)
+		continue;
+	    ip->inst = (s->version == MMV_VERSION1) ?
+		((mmv_disk_instance_t *)((char *)s->addr + ioffset))->internal :
+		((mmv_disk_instance2_t *)((char *)s->addr + ioffset))->internal;
+	}
+	s->icnt++;
+    }
+
+    qsort(s->index, s->icnt, sizeof(mmv_index_t), index_compare);
+
+    /* note the first value (in file order) and extent of each metric */
+    for (i = 0; i < s->icnt; i = vi) {
+	first = s->index[i].value;
+	for (vi = i + 1; vi < s->icnt; vi++) {
+	    if (s->index[vi].metric != s->index[i].metric)
+		break;
+	    if (s->index[vi].value < first)
+		first = s->index[vi].value;
+	}
+	for (; i < vi; i++) {
+	    s->index[i].first = first;
+	    s->index[i].next = vi;
+	}
+    }
+
+    /* count the shards of each value, being consecutive index entries */
+    for (i = s->icnt - 1; i >= 0; i--) {
+	if (i + 1 < s->icnt &&
+	    s->index[i + 1].metric == s->index[i].metric &&
+	    s->index[i + 1].inst == s->index[i].inst)
+	    s->index[i].shards = s->index[i + 1].shards + 1;
+	else
+	    s->index[i].shards = 1;
+    }
+
+    if (pmDebugOptions.appl0)
+	pmNotifyErr(LOG_DEBUG, "MMV: %s - indexed %d of %d values",
+			s->name, s->icnt, s->vcnt);
+}
+
 static void
 map_stats(pmdaExt *pmda)
 {
@@ -591,10 +912,13 @@ map_stats(pmdaExt *pmda)
 	ap->indoms = NULL;
 	ap->intot = 0;
     }
+    ap->histograms = 0;
 
     if (ap->slist != NULL) {
 	for (i = 0; i < ap->scnt; i++) {
 	    free(ap->slist[i].name);
+	    free(ap->slist[i].index);
+	    free(ap->slist[i].hist);
 	    __pmMemoryUnmap(ap->slist[i].addr, ap->slist[i].len);
 	}
 	free(ap->slist);
@@ -680,7 +1004,7 @@ map_stats(pmdaExt *pmda)
 					mp->type, mp->semantics, mp->dimension);
 		    }
 		}
-		else if (s->version == MMV_VERSION2 || s->version == MMV_VERSION3) {
+		else {
 		    mmv_disk_metric2_t *ml = (mmv_disk_metric2_t *)
 					((char *)s->addr + offset);
 
@@ -730,6 +1054,12 @@ map_stats(pmdaExt *pmda)
 			if (verify_metric_item2(ml, k, name, s) != 0)
 			    continue;
 
+			if (mp->type == MMV_TYPE_HISTOGRAM &&
+			    s->version >= MMV_VERSION4) {
+			    create_histogram(pmda, s, name, sizeof(name),
+					mp->item, mp->dimension);
+			    continue;
+			}
 			pmid = pmID_build(pmda->e_domain, s->cluster, mp->item);
 			create_metric(pmda, s, name, pmid, mp->indom,
 					mp->type, mp->semantics, mp->dimension);
@@ -817,6 +1147,7 @@ map_stats(pmdaExt *pmda)
 
 	    case MMV_TOC_INSTANCES:
 	    case MMV_TOC_STRINGS:
+	    case MMV_TOC_HISTOGRAMS:
 		break;
 		
 	    case MMV_TOC_LABELS:
@@ -853,21 +1184,83 @@ map_stats(pmdaExt *pmda)
 		break;
 	    }
 	}
+	create_index(s);
     }
+    for (i = 0; ap->histograms && i < ap->scnt; i++)
+	if (ap->slist[i].hcnt)
+	    create_histogram_indoms(pmda, &ap->slist[i]);
 
     pmdaTreeRebuildHash(ap->pmns, ap->mtot); /* for reverse (pmid->name) lookups */
     ap->reload = need_reload;
 }
 
+/*
+ * Binary search the value index of a mapping for an (item,inst) pair,
+ * returning metric and value slots, and the index entry of the first
+ * shard of the value.  PM_ERR_PMID is returned when no value exists
+ * for the item at all - callers check the metric table.
+ */
+static int
+mmv_lookup_index(stats_t *s, __uint32_t item, unsigned int inst,
+	int *metric, int *value, mmv_index_t **entry)
+{
+    mmv_index_t		*ip = s->index;
+    int			lo = 0, hi = s->icnt, mid, sts = PM_ERR_PMID;
+
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if (ip[mid].item < item)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    /* one pass per metric slot with this item, in file order */
+    for (; lo < s->icnt && ip[lo].item == item; lo = ip[lo].next) {
+	sts = PM_ERR_INST;
+	if (ip[lo].singular || inst == PM_IN_NULL) {
+	    *metric = ip[lo].metric;
+	    *value = ip[lo].first;
+	    *entry = ip[lo].singular ? &ip[lo] : NULL;
+	    return 0;
+	}
+	for (mid = lo, hi = ip[lo].next; mid < hi; ) {
+	    int	i = mid + (hi - mid) / 2;
+
+	    if (ip[i].inst < inst)
+		mid = i + 1;
+	    else
+		hi = i;
+	}
+	if (mid < ip[lo].next && ip[mid].inst == inst) {
+	    *metric = ip[mid].metric;
+	    *value = ip[mid].value;
+	    *entry = &ip[mid];
+	    return 0;
+	}
+    }
+    return sts;
+}
+
 static int
 mmv_lookup_item1(int item, unsigned int inst,
-	stats_t *s, mmv_disk_value_t **value,
+	stats_t *s, mmv_disk_value_t **value, mmv_index_t **entry,
 	__uint64_t *shorttext, __uint64_t *helptext)
 {
     mmv_disk_metric_t	*m1 = s->metrics1;
     mmv_disk_value_t	*v = s->values;
     int			mi, vi, sts = PM_ERR_PMID;
 
+    *entry = NULL;
+    if (s->index) {
+	if ((sts = mmv_lookup_index(s, item, inst, &mi, &vi, entry)) == 0)
+	    goto found;
+	for (mi = 0; sts == PM_ERR_PMID && mi < s->mcnt1; mi++)
+	    if (m1[mi].item == item)
+		sts = PM_ERR_INST;
+	return sts;
+    }
+
     for (mi = 0; mi < s->mcnt1; mi++) {
 	if (m1[mi].item != item)
 	    continue;
@@ -881,28 +1274,40 @@ mmv_lookup_item1(int item, unsigned int inst,
 
 	    if ((mt == &m1[mi]) &&
 		(mt->indom == PM_INDOM_NULL || mt->indom == 0 ||
-		inst == PM_IN_NULL || is->internal == inst)) {
-		if (shorttext)
-		    *shorttext = m1[mi].shorttext;
-		if (helptext)
-		    *helptext = m1[mi].helptext;
-		*value = &v[vi];
-		return m1[mi].type;
-	    }
+		inst == PM_IN_NULL || is->internal == inst))
+		goto found;
 	}
     }
     return sts;
+
+found:
+    if (shorttext)
+	*shorttext = m1[mi].shorttext;
+    if (helptext)
+	*helptext = m1[mi].helptext;
+    *value = &v[vi];
+    return m1[mi].type;
 }
 
 static int
 mmv_lookup_item2(int item, unsigned int inst,
-	stats_t *s, mmv_disk_value_t **value,
+	stats_t *s, mmv_disk_value_t **value, mmv_index_t **entry,
 	__uint64_t *shorttext, __uint64_t *helptext)
 {
     mmv_disk_metric2_t	*m2 = s->metrics2;
     mmv_disk_value_t	*v = s->values;
     int			mi, vi, sts = PM_ERR_PMID;
 
+    *entry = NULL;
+    if (s->index) {
+	if ((sts = mmv_lookup_index(s, item, inst, &mi, &vi, entry)) == 0)
+	    goto found;
+	for (mi = 0; sts == PM_ERR_PMID && mi < s->mcnt2; mi++)
+	    if (m2[mi].item == item)
+		sts = PM_ERR_INST;
+	return sts;
+    }
+
     for (mi = 0; mi < s->mcnt2; mi++) {
 	if (m2[mi].item != item)
 	    continue;
@@ -916,22 +1321,24 @@ mmv_lookup_item2(int item, unsigned int inst,
 
 	    if ((mt == &m2[mi]) &&
 		(mt->indom == PM_INDOM_NULL || mt->indom == 0 ||
-		inst == PM_IN_NULL || is->internal == inst)) {
-		if (shorttext)
-		    *shorttext = m2[mi].shorttext;
-		if (helptext)
-		    *helptext = m2[mi].helptext;
-		*value = &v[vi];
-		return m2[mi].type;
-	    }
+		inst == PM_IN_NULL || is->internal == inst))
+		goto found;
 	}
     }
     return sts;
+
+found:
+    if (shorttext)
+	*shorttext = m2[mi].shorttext;
+    if (helptext)
+	*helptext = m2[mi].helptext;
+    *value = &v[vi];
+    return m2[mi].type;
 }
 
 static int
 mmv_lookup_stat_metric(agent_t *agent, pmID pmid, unsigned int inst,
-	stats_t **stats, mmv_disk_value_t **value,
+	stats_t **stats, mmv_disk_value_t **value, mmv_index_t **entry,
 	__uint64_t *shorttext, __uint64_t *helptext)
 {
     int			si, sts = PM_ERR_PMID;
@@ -943,8 +1350,8 @@ mmv_lookup_stat_metric(agent_t *agent, pmID pmid, unsigned int inst,
 	    continue;
 
 	sts = (s->version == MMV_VERSION1) ?
-	    mmv_lookup_item1(pmID_item(pmid), inst, s, value, shorttext, helptext):
-	    mmv_lookup_item2(pmID_item(pmid), inst, s, value, shorttext, helptext);
+	    mmv_lookup_item1(pmID_item(pmid), inst, s, value, entry, shorttext, helptext):
+	    mmv_lookup_item2(pmID_item(pmid), inst, s, value, entry, shorttext, helptext);
 	if (sts == MMV_TYPE_NOSUPPORT)
 	    sts = PM_ERR_APPVERSION;
 	if (sts >= 0) {
@@ -957,9 +1364,195 @@ mmv_lookup_stat_metric(agent_t *agent, pmID pmid, unsigned int inst,
 
 static int
 mmv_lookup_stat_metric_value(agent_t *agent, pmID pmid, unsigned int inst,
-	stats_t **stats, mmv_disk_value_t **value)
+	stats_t **stats, mmv_disk_value_t **value, mmv_index_t **entry)
 {
-    return mmv_lookup_stat_metric(agent, pmid, inst, stats, value, NULL, NULL);
+    return mmv_lookup_stat_metric(agent, pmid, inst, stats, value, entry, NULL, NULL);
+}
+
+/*
+ * The shard following shard n-1 (v) of a value in a sharded mapping,
+ * or NULL after the last one.  With an index entry for the first shard
+ * the shards are adjacent entries, otherwise (no index could be built,
+ * or no entry for the value) they are the later value records for the
+ * same metric and instance.
+ */
+static mmv_disk_value_t *
+mmv_next_shard(stats_t *s, mmv_index_t *ip, mmv_disk_value_t *v, int n)
+{
+    int			vi;
+
+    if (ip != NULL)
+	return n < ip->shards ? &s->values[ip[n].value] : NULL;
+    for (vi = (v - s->values) + 1; vi < s->vcnt; vi++) {
+	if (s->values[vi].metric == v->metric &&
+	    s->values[vi].instance == v->instance)
+	    return &s->values[vi];
+    }
+    return NULL;
+}
+
+/*
+ * Sum the remaining shards of a value from a sharded mapping into the
+ * value from the first shard, v.
+ */
+static void
+mmv_fold_shards(stats_t *s, mmv_index_t *ip, mmv_disk_value_t *v,
+		int type, pmAtomValue *atom)
+{
+    struct timeval	tv;
+    int			i;
+
+    if (type == MMV_TYPE_STRING)
+	return;
+    for (i = 1; (v = mmv_next_shard(s, ip, v, i)) != NULL; i++) {
+	switch (type) {
+	    case MMV_TYPE_I32:
+		atom->l += v->value.l;
+		break;
+	    case MMV_TYPE_U32:
+		atom->ul += v->value.ul;
+		break;
+	    case MMV_TYPE_I64:
+		atom->ll += v->value.ll;
+		break;
+	    case MMV_TYPE_ELAPSED:
+		atom->ll += v->value.ll;
+		if (v->extra < 0) {	/* inside a timed section */
+		    pmtimevalNow(&tv);
+		    atom->ll += (tv.tv_sec * 1e6 + tv.tv_usec) + v->extra;
+		}
+		break;
+	    case MMV_TYPE_U64:
+	    case MMV_TYPE_HISTOGRAM:
+		atom->ull += v->value.ull;
+		break;
+	    case MMV_TYPE_FLOAT:
+		atom->f += v->value.f;
+		break;
+	    case MMV_TYPE_DOUBLE:
+		atom->d += v->value.d;
+		break;
+	}
+    }
+}
+
+/* find the histogram derived metric for a PMID, if there is one */
+static int
+mmv_lookup_histogram(agent_t *ap, pmID pmid, stats_t **stats, mmv_hist_t **hist)
+{
+    stats_t		*s;
+    int			si, hi;
+
+    for (si = 0; si < ap->scnt; si++) {
+	s = &ap->slist[si];
+	if (s->cluster != pmID_cluster(pmid))
+	    continue;
+	for (hi = 0; hi < s->hcnt; hi++) {
+	    if (s->hist[hi].item == pmID_item(pmid)) {
+		*stats = s;
+		*hist = &s->hist[hi];
+		return 0;
+	    }
+	}
+    }
+    return PM_ERR_PMID;
+}
+
+/* estimate a percentile, interpolating within the bucket it falls in */
+static double
+mmv_histogram_percentile(const __uint64_t *buckets, __uint64_t total, int permille)
+{
+    __uint64_t		rank, seen = 0;
+    double		lower, upper;
+    int			b;
+
+    rank = (total * permille + 999) / 1000;
+    if (rank == 0)
+	rank = 1;
+    for (b = 0; b < MMV_HISTOGRAM_BUCKETS; b++) {
+	if (buckets[b] == 0)
+	    continue;
+	if (seen + buckets[b] >= rank) {
+	    lower = (double)mmv_histogram_lower(b);
+	    upper = (double)mmv_histogram_upper(b);
+	    return lower + (upper - lower) * (rank - seen) / buckets[b];
+	}
+	seen += buckets[b];
+    }
+    return (double)mmv_histogram_upper(MMV_HISTOGRAM_BUCKETS - 1);
+}
+
+/*
+ * Fetch a histogram derived metric value, summing the buckets of all
+ * shards of a sharded histogram.
+ */
+static int
+mmv_fetch_histogram(stats_t *s, mmv_hist_t *hp, unsigned int inst, pmAtomValue *atom)
+{
+    mmv_disk_histogram_t *h;
+    mmv_disk_value_t	*v;
+    mmv_index_t		*ip;
+    __uint64_t		buckets[MMV_HISTOGRAM_BUCKETS];
+    __uint64_t		total = 0;
+    int			flags = ((mmv_disk_header_t *)s->addr)->flags;
+    int			i, b, sts;
+
+    sts = mmv_lookup_item2(hp->base, PM_IN_NULL, s, &v, &ip, NULL, NULL);
+    if (sts < 0)
+	return sts;
+    if (sts != MMV_TYPE_HISTOGRAM)
+	return PM_ERR_TYPE;
+
+    if (hp->kind == HISTOGRAM_BUCKET && inst >= MMV_HISTOGRAM_BUCKETS)
+	return PM_ERR_INST;
+    if (hp->kind == HISTOGRAM_PERCENTILE) {
+	for (i = 0; i < NUM_PERCENTILES; i++)
+	    if (percentiles[i].permille == inst)
+		break;
+	if (i == NUM_PERCENTILES)
+	    return PM_ERR_INST;
+    }
+
+    memset(buckets, 0, sizeof(buckets));
+    atom->ull = 0;
+    for (i = 1; v != NULL; i++) {
+	if (v->extra <= 0 || s->len < v->extra + sizeof(mmv_disk_histogram_t)) {
+	    if (pmDebugOptions.appl0)
+		pmNotifyErr(LOG_ERR, "MMV: %s - "
+				"bad histogram offset: %"PRIu64" < %"PRIi64,
+				s->name, s->len, v->extra);
+	    return PM_ERR_GENERIC;
+	}
+	h = (mmv_disk_histogram_t *)((char *)s->addr + v->extra);
+	switch (hp->kind) {
+	case HISTOGRAM_SUM:
+	    atom->ull += h->sum;
+	    break;
+	case HISTOGRAM_BUCKET:
+	    atom->ull += h->buckets[inst];
+	    break;
+	case HISTOGRAM_PERCENTILE:
+	    for (b = 0; b < MMV_HISTOGRAM_BUCKETS; b++)
+		buckets[b] += h->buckets[b];
+	    break;
+	}
+	v = (flags & MMV_FLAG_SHARDED) ? mmv_next_shard(s, ip, v, i) : NULL;
+    }
+
+    switch (hp->kind) {
+    case HISTOGRAM_BUCKET:
+	if (atom->ull == 0)
+	    return PMDA_FETCH_NOVALUES;
+	break;
+    case HISTOGRAM_PERCENTILE:
+	for (b = 0; b < MMV_HISTOGRAM_BUCKETS; b++)
+	    total += buckets[b];
+	if (total == 0)
+	    return PMDA_FETCH_NOVALUES;
+	atom->d = mmv_histogram_percentile(buckets, total, inst);
+	break;
+    }
+    return PMDA_FETCH_STATIC;
 }
 
 /*
@@ -970,8 +1563,10 @@ mmv_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
 {
     mmv_disk_string_t	*str;
     mmv_disk_value_t	*v;
+    mmv_index_t		*ip;
     __uint64_t		offset;
     agent_t		*ap = (agent_t *)mdesc->m_user;
+    mmv_hist_t		*hp;
     stats_t		*s;
     pmID		pmid = mdesc->m_desc.pmid;
     int			sts, flags;
@@ -994,7 +1589,9 @@ mmv_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
     }
 
     if (ap->scnt > 0) {	/* We have at least one source of metrics */
-	if ((sts = mmv_lookup_stat_metric_value(ap, pmid, inst, &s, &v)) < 0)
+	if (ap->histograms && mmv_lookup_histogram(ap, pmid, &s, &hp) == 0)
+	    return mmv_fetch_histogram(s, hp, inst, atom);
+	if ((sts = mmv_lookup_stat_metric_value(ap, pmid, inst, &s, &v, &ip)) < 0)
 	    return sts;
 	flags = ((mmv_disk_header_t *)s->addr)->flags;
 
@@ -1003,6 +1600,7 @@ mmv_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
 	    case MMV_TYPE_U32:
 	    case MMV_TYPE_I64:
 	    case MMV_TYPE_U64:
+	    case MMV_TYPE_HISTOGRAM:
 		memcpy(atom, &v->value, sizeof(pmAtomValue));
 		if ((flags & MMV_FLAG_SENTINEL) &&
 		    (memcmp(atom, &aNaN, sizeof(*atom)) == 0))
@@ -1049,6 +1647,8 @@ mmv_fetchCallBack(pmdaMetric *mdesc, unsigned int inst, pmAtomValue *atom)
 		break;
 	    }
 	}
+	if (flags & MMV_FLAG_SHARDED)
+	    mmv_fold_shards(s, ip, v, sts, atom);
 	return PMDA_FETCH_STATIC;
     }
 
@@ -1125,11 +1725,12 @@ mmv_lookup_metric_helptext(agent_t *ap, pmID pmid, int type, char **text)
 {
     mmv_disk_string_t	*str;
     mmv_disk_value_t	*v;
+    mmv_index_t		*ip;
     __uint64_t		st, lt;
     size_t		offset;
     stats_t		*s;
 
-    if (mmv_lookup_stat_metric(ap, pmid, PM_IN_NULL, &s, &v, &st, &lt) < 0)
+    if (mmv_lookup_stat_metric(ap, pmid, PM_IN_NULL, &s, &v, &ip, &st, &lt) < 0)
 	return PM_ERR_PMID;
 
     if ((type & PM_TEXT_ONELINE) && st) {
@@ -1211,6 +1812,21 @@ mmv_text(int ident, int type, char **buffer, pmdaExt *pmda)
 	return PM_ERR_PMID;
     }
 
+    if (agent->histograms) {
+	static char *histogramtext[] = {
+	    "Sum of histogram sample values",
+	    "Histogram sample counts, one instance per bucket",
+	    "Histogram percentiles, estimated from the bucket counts",
+	};
+	mmv_hist_t	*hp;
+	stats_t		*s;
+
+	if (mmv_lookup_histogram(agent, ident, &s, &hp) == 0) {
+	    *buffer = histogramtext[hp->kind];
+	    return 0;
+	}
+    }
+
     return mmv_lookup_metric_helptext(agent, ident, type, buffer);
 }
 
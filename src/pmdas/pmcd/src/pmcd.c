@@ -218,6 +218,12 @@ static pmDesc	desctab[] = {
     { PMDA_PMID(5,8), PM_TYPE_FLOAT, PM_INDOM_NULL, PM_SEM_DISCRETE, PMDA_PMUNITS(0,-1,1,0,PM_TIME_SEC,PM_COUNT_ONE) },
 /* pmie.eval.actual */
     { PMDA_PMID(5,9), PM_TYPE_U32, PM_INDOM_NULL, PM_SEM_COUNTER, PMDA_PMUNITS(0,0,1,0,0,PM_COUNT_ONE) },
+/* pmie.expr.nodes */
+    { PMDA_PMID(5,10), PM_TYPE_U32, PM_INDOM_NULL, PM_SEM_DISCRETE, PMDA_PMUNITS(0,0,1,0,0,PM_COUNT_ONE) },
+/* pmie.expr.shared */
+    { PMDA_PMID(5,11), PM_TYPE_U32, PM_INDOM_NULL, PM_SEM_DISCRETE, PMDA_PMUNITS(0,0,1,0,0,PM_COUNT_ONE) },
+/* pmie.expr.reused */
+    { PMDA_PMID(5,12), PM_TYPE_U32, PM_INDOM_NULL, PM_SEM_COUNTER, PMDA_PMUNITS(0,0,1,0,0,PM_COUNT_ONE) },
 
 /* client.whoami */
     { PMDA_PMID(6,0), PM_TYPE_STRING, PM_INDOM_NULL, PM_SEM_DISCRETE, PMDA_PMUNITS(0,0,0,0,0,0) },
@@ -539,7 +545,8 @@ refresh_pmie_indom(void)
 				fullpath, osstrerror());
 		    continue;
 		}
-		if (statbuf.st_size != sizeof(pmiestats_t))
+		if (statbuf.st_size < PMIE_STATS_V1_SIZE ||
+		    statbuf.st_size > sizeof(pmiestats_t))
 		    continue;
 		if  ((endp = strdup(dp->d_name)) == NULL) {
 		    pmNoMem("pmie iname", strlen(dp->d_name), PM_RECOV_ERR);
@@ -565,7 +572,8 @@ refresh_pmie_indom(void)
 		    free(endp);
 		    continue;
 		}
-		else if (((pmiestats_t *)ptr)->version != 1) {
+		else if (((pmiestats_t *)ptr)->version != 1 &&
+			 ((pmiestats_t *)ptr)->version != 2) {
 		    pmNotifyErr(LOG_WARNING, "incompatible pmie version: %s",
 				fullpath);
 		    __pmMemoryUnmap(ptr, statbuf.st_size);
@@ -1712,6 +1720,8 @@ pmcd_fetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 		for (j = numval = 0; j < npmies; ++j) {
 		    if (!__pmInProfile(pmieindom, _profile, pmies[j].pid))
 			continue;
+		    if (item >= 10 && pmies[j].size < sizeof(pmiestats_t))
+			continue;	/* version 1 pmie, no expression stats */
 		    vset->vlist[numval].inst = pmies[j].pid;
 		    pmie = (pmiestats_t *)pmies[j].mmap;
 		    switch (item) {
@@ -1745,6 +1755,15 @@ pmcd_fetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
 			case 9:		/* pmie.eval.actual */
 			    atom.ul = pmie->eval_actual;
 			    break;
+			case 10:	/* pmie.expr.nodes */
+			    atom.ul = pmie->expr_nodes;
+			    break;
+			case 11:	/* pmie.expr.shared */
+			    atom.ul = pmie->expr_shared;
+			    break;
+			case 12:	/* pmie.expr.reused */
+			    atom.ul = pmie->expr_reused;
+			    break;
 			default:
 			    sts = atom.l = PM_ERR_PMID;
 			    break;
@@ -35,4 +35,17 @@ extern client_t *acceptClient(int);
 extern void deleteClient(client_t *);
 extern void showClients(void);
 
+/* clients using the shared memory transport, see ring.c */
+typedef struct {
+    __pmTraceShmReader	reader;		/* mapping and read position */
+    ino_t		ino;		/* of the ring buffer file */
+} shmclient_t;
+
+extern int shmInit(void);
+extern void shmDrain(void);
+extern int shmClients(void);
+
+extern __uint64_t	shmevents;
+extern __uint64_t	shmdropped;
+
 #endif	/* CLIENT_H */
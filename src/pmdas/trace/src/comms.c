@@ -23,6 +23,7 @@
 #include "comms.h"
 
 extern struct timeval	interval;
+extern struct timeval	drain;
 extern int readData(int, int *);
 extern void timerUpdate(void);
 
@@ -48,6 +49,8 @@ traceMain(pmdaInterface *dispatch)
 {
     client_t	*cp;
     fd_set	readyfds;
+    struct timeval	now, last = { 0, 0 };
+    struct timeval	wait, *waitp = NULL;
     int		nready, i, pdutype, sts, protocol;
 
     ctlfd = getcport();
@@ -68,9 +71,23 @@ traceMain(pmdaInterface *dispatch)
 	exit(1);
     }
 
+    /* shared memory transport clients are drained on a timer */
+    if ((drain.tv_sec != 0 || drain.tv_usec != 0) && shmInit() == 0)
+	waitp = &wait;
+
     for (;;) {
+	if (waitp != NULL) {
+	    pmtimevalNow(&now);
+	    if (pmtimevalSub(&now, &last) >= pmtimevalToReal(&drain)) {
+		__pmAFblock();
+		shmDrain();
+		__pmAFunblock();
+		last = now;
+	    }
+	    wait = drain;
+	}
 	memcpy(&readyfds, &fds, sizeof(readyfds));
-	nready = select(maxfd+1, &readyfds, NULL, NULL, NULL);
+	nready = select(maxfd+1, &readyfds, NULL, NULL, waitp);
 
 	if (nready == 0)
 	    continue;
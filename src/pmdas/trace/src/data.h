@@ -62,6 +62,7 @@ typedef struct {
 } ringbuf_t;
 
 void debuglibrary(void);
+int recordData(int, char *, int, int, double);
 
 extern int somedebug;
 
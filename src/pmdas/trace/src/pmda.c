@@ -27,9 +27,11 @@
 
 #define DEFAULT_TIMESPAN	60	/* one minute  */
 #define DEFAULT_BUFSIZE		5	/* twelve second update */
+#define DEFAULT_DRAIN		100000	/* usec between shared memory drains */
 
 struct timeval	timespan  = { DEFAULT_TIMESPAN, 0 };
 struct timeval	interval;
+struct timeval	drain	  = { 0, DEFAULT_DRAIN };
 unsigned int	rbufsize  = DEFAULT_BUFSIZE;
 int		ctlport	  = -1;
 char		*ctlsock;
@@ -57,6 +59,7 @@ Options:\n\
   -I port     expect programs to connect on given inet port (number/name)\n\
   -M username user account to run under (default \"pcp\")\n\
   -N buckets  number of historical data buffers maintained\n\
+  -S drain    interval between reads of shared memory clients (default 100ms)\n\
   -T period   time over which samples are considered (default 60 seconds)\n\
   -U units    export observation values using the given units\n\
   -V units    export counter values using the given units\n",
@@ -162,7 +165,7 @@ main(int argc, char **argv)
 		"trace.log", mypath);
 
     /* need - port, as well as time interval and time span for averaging */
-    while ((c = pmdaGetOpt(argc, argv, "A:D:d:I:l:T:M:N:U:V:?",
+    while ((c = pmdaGetOpt(argc, argv, "A:D:d:I:l:T:M:N:S:U:V:?",
 						&dispatch, &err)) != EOF) {
 	switch(c) {
 	case 'A':
@@ -194,6 +197,14 @@ main(int argc, char **argv)
 		err++;
 	    }
 	    break;
+	case 'S':
+	    if (pmParseInterval(optarg, &drain, &endnum) < 0) {
+		fprintf(stderr, "%s: -S requires a time interval: %s\n",
+			pmGetProgname(), endnum);
+		free(endnum);
+		err++;
+	    }
+	    break;
 	case 'T':
 	    if (pmParseInterval(optarg, &timespan, &endnum) < 0) {
 		fprintf(stderr, "%s: -T requires a time interval: %s\n",
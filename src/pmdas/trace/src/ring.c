@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Clients using the shared memory transport ($PCP_TRACE_SHM) - each
+ * has a ring buffer file in $PCP_TMP_DIR/trace which is drained here,
+ * from the main loop every drain interval and before each fetch.
+ */
+
+#include <dirent.h>
+#include "pmapi.h"
+#include "libpcp.h"
+#include "trace.h"
+#include "trace_dev.h"
+#include "data.h"
+#include "client.h"
+
+__uint64_t	shmevents;		/* events read from all rings */
+__uint64_t	shmdropped;		/* events lost from all rings */
+
+static shmclient_t	*shmclients;	/* array of attached rings */
+static int		nshmclients;	/* number of entries in array */
+static int		shmsize;	/* allocated length of the array */
+static char		shmdir[MAXPATHLEN];
+
+/*
+ * Create the directory clients put their ring buffers in, world
+ * writable and sticky like /tmp.  Failure is not fatal, clients
+ * then fall back to the socket transport.
+ */
+int
+shmInit(void)
+{
+    struct stat	sbuf;
+
+    __pmtraceshmdir(shmdir, sizeof(shmdir));
+    if (mkdir2(shmdir, 01777) < 0 && oserror() != EEXIST) {
+	pmNotifyErr(LOG_WARNING, "cannot create %s: %s", shmdir, osstrerror());
+	shmdir[0] = '\0';
+	return -oserror();
+    }
+    if (stat(shmdir, &sbuf) < 0 || !S_ISDIR(sbuf.st_mode)) {
+	pmNotifyErr(LOG_WARNING, "%s is not a directory", shmdir);
+	shmdir[0] = '\0';
+	return -ENOTDIR;
+    }
+    /* mkdir is subject to umask, so set the mode explicitly */
+    if ((sbuf.st_mode & 01777) != 01777)
+	chmod(shmdir, 01777);
+    return 0;
+}
+
+static shmclient_t *
+findClient(pid_t pid)
+{
+    int		i;
+
+    for (i = 0; i < nshmclients; i++)
+	if (shmclients[i].reader.hdr != NULL && shmclients[i].reader.pid == pid)
+	    return &shmclients[i];
+    return NULL;
+}
+
+static void
+attachClient(const char *name)
+{
+    shmclient_t	*cp;
+    struct stat	sbuf;
+    char	path[MAXPATHLEN];
+    char	*end;
+    long	pid;
+    int		i, sts;
+
+    pid = strtol(name, &end, 10);
+    if (*end != '\0' || pid <= 0)
+	return;
+    pmsprintf(path, sizeof(path), "%s%c%s", shmdir, pmPathSeparator(), name);
+    if (stat(path, &sbuf) < 0)
+	return;
+    if ((cp = findClient((pid_t)pid)) != NULL) {
+	if (cp->ino == sbuf.st_ino)
+	    return;
+	/* process ID reused by a new client, the old one is long gone */
+	__pmtraceshmdetach(&cp->reader);
+    }
+
+    for (i = 0; i < nshmclients; i++)
+	if (shmclients[i].reader.hdr == NULL)
+	    break;
+    if (i == shmsize) {
+	shmsize = shmsize ? shmsize * 2 : 8;
+	shmclients = (shmclient_t *)realloc(shmclients, shmsize * sizeof(shmclient_t));
+	if (shmclients == NULL)
+	    pmNoMem("attachClient", shmsize * sizeof(shmclient_t), PM_FATAL_ERR);
+    }
+    cp = &shmclients[i];
+    if ((sts = __pmtraceshmattach(path, &cp->reader)) < 0) {
+	if (sts != -EAGAIN && pmDebugOptions.appl0)
+	    pmNotifyErr(LOG_DEBUG, "shm client %s: attach failed: %s",
+			path, pmtraceerrstr(sts));
+	return;
+    }
+    if (cp->reader.pid != (__int32_t)pid) {
+	/* file name and contents disagree, ignore it */
+	__pmtraceshmdetach(&cp->reader);
+	return;
+    }
+    /*
+     * The directory is world writable, so the owner of a ring is taken
+     * from the lock its writer holds, as recorded when it was attached.
+     * A process that is running but not holding the lock did not write
+     * this ring.  One that has already exited no longer holds any lock,
+     * its ring is drained and then dropped as the process is gone.
+     */
+    if (cp->reader.owner != cp->reader.pid && __pmProcessExists((pid_t)pid)) {
+	if (pmDebugOptions.appl0)
+	    pmNotifyErr(LOG_DEBUG, "shm client %s: not owned by process %ld, "
+			"ignored", path, pid);
+	__pmtraceshmdetach(&cp->reader);
+	return;
+    }
+    cp->ino = sbuf.st_ino;
+    if (i >= nshmclients)
+	nshmclients = i + 1;
+    if (pmDebugOptions.appl0)
+	pmNotifyErr(LOG_DEBUG, "shm client %s: attached, %u slots",
+			path, (unsigned int)cp->reader.nslots);
+}
+
+static void
+detachClient(shmclient_t *cp)
+{
+    char	path[MAXPATHLEN];
+
+    pmsprintf(path, sizeof(path), "%s%c%" FMT_PID, shmdir,
+		pmPathSeparator(), (pid_t)cp->reader.pid);
+    if (pmDebugOptions.appl0)
+	pmNotifyErr(LOG_DEBUG, "shm client %s: process gone, %" PRIu64
+			" events lost", path, cp->reader.lost);
+    __pmtraceshmdetach(&cp->reader);
+    unlink(path);
+    while (nshmclients > 0 && shmclients[nshmclients-1].reader.hdr == NULL)
+	nshmclients--;
+}
+
+/*
+ * Read at most one ring's worth of events, so a busy client cannot
+ * keep us here indefinitely.
+ */
+static void
+drainClient(shmclient_t *cp)
+{
+    __pmTraceShmSlot	slot;
+    __uint64_t		lost = cp->reader.lost;
+    __uint32_t		n;
+    char		*tag;
+
+    for (n = 0; n < cp->reader.nslots; n++) {
+	if (__pmtraceshmread(&cp->reader, &slot) <= 0)
+	    break;
+	shmevents++;
+	if ((tag = strdup(slot.tag)) == NULL) {
+	    pmNotifyErr(LOG_ERR, "dropping '%s' event: %s", slot.tag, osstrerror());
+	    continue;
+	}
+	recordData(-1, tag, slot.taglen, slot.type, slot.value);
+    }
+    shmdropped += cp->reader.lost - lost;
+}
+
+void
+shmDrain(void)
+{
+    DIR			*dirp;
+    struct dirent	*dp;
+    int			i;
+
+    if (shmdir[0] == '\0')
+	return;
+
+    if ((dirp = opendir(shmdir)) != NULL) {
+	while ((dp = readdir(dirp)) != NULL) {
+	    if (dp->d_name[0] != '.')
+		attachClient(dp->d_name);
+	}
+	closedir(dirp);
+    }
+
+    for (i = 0; i < nshmclients; i++) {
+	if (shmclients[i].reader.hdr == NULL)
+	    continue;
+	drainClient(&shmclients[i]);
+	if (!__pmProcessExists((pid_t)shmclients[i].reader.pid)) {
+	    /* exited - pick up any final events, then clean up */
+	    drainClient(&shmclients[i]);
+	    detachClient(&shmclients[i]);
+	}
+    }
+}
+
+int
+shmClients(void)
+{
+    int		i, n = 0;
+
+    for (i = 0; i < nshmclients; i++)
+	if (shmclients[i].reader.hdr != NULL)
+	    n++;
+    return n;
+}
@@ -18,6 +18,7 @@
 #include "pmda.h"
 #include "domain.h"
 #include "data.h"
+#include "client.h"
 #include "trace_dev.h"
 
 static pmdaIndom indomtab[] = {	/* list of trace metric instance domains */
@@ -122,6 +123,18 @@ static pmdaMetric metrictab[] = {
     { NULL,
       { PMDA_PMID(0,19), PM_TYPE_DOUBLE, COUNTER_INDOM, PM_SEM_COUNTER,
 	PMDA_PMUNITS(0,0,0, 0,0,0) }, },	/* this may be modified at startup */
+/* shm.clients */
+    { NULL,
+      { PMDA_PMID(0,20), PM_TYPE_U32, PM_INDOM_NULL, PM_SEM_INSTANT,
+	PMDA_PMUNITS(0,0,0, 0,0,0) }, },
+/* shm.events */
+    { NULL,
+      { PMDA_PMID(0,21), PM_TYPE_U64, PM_INDOM_NULL, PM_SEM_COUNTER,
+	PMDA_PMUNITS(0,0,1, 0,0,PM_COUNT_ONE) }, },
+/* shm.dropped */
+    { NULL,
+      { PMDA_PMID(0,22), PM_TYPE_U64, PM_INDOM_NULL, PM_SEM_COUNTER,
+	PMDA_PMUNITS(0,0,1, 0,0,PM_COUNT_ONE) }, },
 };
 
 extern void __pmdaStartInst(pmInDom indom, pmdaExt *pmda);
@@ -279,12 +292,8 @@ readData(int clientfd, int *protocol)
 {
     __pmTracePDU	*result;
     double	 	data;
-    hashdata_t		newhash;
-    hashdata_t		*hptr;
-    hashdata_t		hash;
     char		*tag;
     int			type, taglen, sts;
-    int			freeflag=0;
 
     if ((sts = __pmtracegetPDU(clientfd, TRACE_TIMEOUT_NEVER, &result)) < 0) {
 	pmNotifyErr(LOG_ERR, "bogus PDU read - %s", pmtraceerrstr(sts));
@@ -299,9 +308,6 @@ readData(int clientfd, int *protocol)
 	    free(tag);
 	    return -1;
 	}
-	newhash.tag = tag;
-	newhash.taglength = taglen;
-	newhash.tracetype = type;
     }
     else if (sts == 0) {	/* client has exited - cleanup in mainloop */
 	return -1;
@@ -312,6 +318,26 @@ readData(int clientfd, int *protocol)
 	return -1;
     }
 
+    return recordData(clientfd, tag, taglen, type, data);
+}
+
+/*
+ * Accumulate one trace event, from either a client connection (fd) or
+ * a shared memory ring buffer (fd is -1).  The tag is malloc'd and
+ * becomes the property of the summary table or is freed here.
+ */
+int
+recordData(int clientfd, char *tag, int taglen, int type, double data)
+{
+    hashdata_t		newhash;
+    hashdata_t		*hptr;
+    hashdata_t		hash;
+    int			freeflag=0;
+
+    newhash.tag = tag;
+    newhash.taglength = taglen;
+    newhash.tracetype = type;
+
     /*
      * First, update the global summary table with this new data
      */
@@ -756,6 +782,15 @@ auxFetch(int inst, pmID pmid, char *tag, pmAtomValue *atom)
 	case 16:			/* trace.control.debug */
 	    atom->ul = pmDebug;
 	    break;
+	case 20:			/* trace.shm.clients */
+	    atom->ul = shmClients();
+	    break;
+	case 21:			/* trace.shm.events */
+	    atom->ull = shmevents;
+	    break;
+	case 22:			/* trace.shm.dropped */
+	    atom->ull = shmdropped;
+	    break;
 	default:
 	    return PM_ERR_PMID;
 	}
@@ -826,6 +861,7 @@ traceFetch(int numpmid, pmID pmidlist[], pmResult **resp, pmdaExt *pmda)
     int			numval;
     int			sts, i, j, need;
 
+    shmDrain();		/* pick up the latest shared memory events */
     indomSortCheck();
     pmda->e_idp = indomtab;
 
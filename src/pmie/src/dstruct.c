@@ -81,6 +81,7 @@ pmiestats_t	instrument;			/* used if no mmap (archive) */
 
 Task		*taskq = NULL;		/* evaluator task queue */
 Expr		*curr;			/* current executing rule expression */
+unsigned int	evalseq;		/* count of Task evaluations */
 
 SymbolTable	hosts;			/* currently known hosts */
 SymbolTable	metrics;		/* currently known metrics */
@@ -634,8 +635,10 @@ freeFetch(Fetch *f)
 	    f->host->fetches = f->next;
 	    freeHost(f->host);
 	}
+	fetchWait(f);
 	pmDestroyContext(f->handle);
 	if (f->result) pmFreeResult(f->result);
+	if (f->pending) pmFreeResult(f->pending);
 	if (f->pmids) free(f->pmids);
 	free(f);
     }
@@ -709,6 +712,7 @@ freeExpr(Expr *x)
 	     */
 	    free(x->metrics);
 	}
+	if (x->sharers) free(x->sharers);
 	if (x->ring) free(x->ring);
 	free(x);
     }
@@ -804,6 +808,7 @@ static void
 instExpr(Expr *x)
 {
     int	    up = 0;
+    int	    i;
     Expr    *arg1 = x->arg1;
     Expr    *arg2 = x->arg2;
     Expr    *arg = primary(arg1, arg2);
@@ -873,8 +878,12 @@ instExpr(Expr *x)
 	newRingBfr(x);
     }
 
-    if (up && x->parent)
-	instExpr(x->parent);
+    if (up) {
+	if (x->parent)
+	    instExpr(x->parent);
+	for (i = 0; i < x->nsharers; i++)
+	    instExpr(x->sharers[i]);
+    }
 }
 
 
@@ -944,6 +953,12 @@ instFetchExpr(Expr *x)
 	    instExpr(x->parent);
 	}
     }
+    for (i = 0; i < x->nsharers; i++) {
+	if (up ||
+	    (UNITS_UNKNOWN(x->sharers[i]->units) && !UNITS_UNKNOWN(x->units))) {
+	    instExpr(x->sharers[i]);
+	}
+    }
 }
 
 
@@ -1177,6 +1192,13 @@ __dumpExpr(int level, Expr *x)
     for (i = 0; i < level; i++) fprintf(stderr, ".. ");
     fprintf(stderr, "  op=%d (%s) arg1=" PRINTF_P_PFX "%p arg2=" PRINTF_P_PFX "%p parent=" PRINTF_P_PFX "%p\n",
 	x->op, opStrings(x->op), x->arg1, x->arg2, x->parent);
+    if (x->nsharers > 0) {
+	for (i = 0; i < level; i++) fprintf(stderr, ".. ");
+	fprintf(stderr, "  shared by %d more parents:", x->nsharers);
+	for (j = 0; j < x->nsharers; j++)
+	    fprintf(stderr, " " PRINTF_P_PFX "%p", x->sharers[j]);
+	fputc('\n', stderr);
+    }
     for (i = 0; i < level; i++) fprintf(stderr, ".. ");
     fprintf(stderr, "  eval=");
     for (j = 0; fn_map[j].addr; j++) {
@@ -1185,8 +1207,12 @@ __dumpExpr(int level, Expr *x)
 	    break;
 	}
     }
-    if (fn_map[j].addr == NULL)
-	fprintf(stderr, "" PRINTF_P_PFX "%p()", x->eval);
+    if (fn_map[j].addr == NULL) {
+	if (fusedName(x->eval) != NULL)
+	    fprintf(stderr, "%s", fusedName(x->eval));
+	else
+	    fprintf(stderr, "" PRINTF_P_PFX "%p()", x->eval);
+    }
     fprintf(stderr, " metrics=" PRINTF_P_PFX "%p ring=" PRINTF_P_PFX "%p\n", x->metrics, x->ring);
     for (i = 0; i < level; i++) fprintf(stderr, ".. ");
     fprintf(stderr, "  valid=%d cardinality[H,I,T]=[%d,%d,%d] tspan=%d\n",
@@ -125,6 +125,11 @@ typedef struct expr {
     int   	    sem;	/* value semantics, see below */
     pmUnits	    units;	/* value units, as in pmDesc */
 
+    /* common subexpressions, see shareExpr() */
+    int		    nsharers;	/* number of parents other than parent */
+    struct expr	    **sharers;	/* parents other than parent */
+    unsigned int    seq;	/* evalseq when last evaluated, if shared */
+
     /* value buffer */
     void    	    *ring;	/* base address of value ring buffer */
     Sample	    smpls[1];	/* array dynamically allocated */
@@ -152,6 +157,8 @@ typedef struct metric {
     RealTime	    stomp;	/* previous time stamp for rate calculation */
     double	    *vals;	/* vector of values for rate computation */
     int		    offset;	/* offset within sample in expr ring buffer */
+    int		    vsidx;	/* index of desc.pmid in Fetch pmids, and */
+				/* so of its pmValueSet in the fetch result */
 } Metric;
 
 /*
@@ -185,8 +192,19 @@ typedef struct fetch {
     int		   npmids;	/* number of metrics in fetch */
     pmID	   *pmids;	/* array of metric ids to fetch */
     pmResult       *result;     /* result of fetch */
+    int		   state;	/* concurrent fetch state, FETCH_* below */
+    int		   sts;		/* status of concurrent fetch */
+    pmResult	   *pending;	/* result of concurrent fetch */
+    int		   late;	/* missed a deadline, reported */
+    struct fetch   *qnext;	/* fetch worker queue link */
 } Fetch;
 
+/* concurrent fetch states */
+#define FETCH_IDLE	0	/* no fetch outstanding */
+#define FETCH_QUEUED	1	/* waiting for a fetch worker */
+#define FETCH_BUSY	2	/* fetch in progress */
+#define FETCH_DONE	3	/* sts and pending are ready */
+
 /* set of bundled fetches for single host (may be archive or live):
    The field waits contains a list of Metrics for which descriptors
    were not available during pragmatics analysis. */
@@ -216,6 +234,7 @@ typedef struct task {
     Symbol	  *rules;	/* array of rules to be evaluated */
     Host          *hosts;	/* fetches to be executed and waiting */
     pmResult	  *rslt;	/* for secret agent mode */
+    __pmHashCtl	  exprs;	/* subexpressions shared between rules */
 } Task;
 
 /* value semantics - as in pmDesc plus following */
@@ -426,6 +445,7 @@ extern SymbolTable metrics;	/* currently known metrics */
 
 extern Task	   *taskq;	/* evaluator task queue */
 extern Expr	   *curr;	/* current executing rule expression */
+extern unsigned int evalseq;	/* count of Task evaluations */
 
 extern RealTime	   now;		/* current time */
 extern RealTime    start;	/* start evaluation */
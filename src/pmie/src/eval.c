@@ -213,6 +213,7 @@ eval(Task *task)
 
     /* fetch metrics */
     taskFetch(task);
+    evalseq++;
 
     /* evaluate rule expressions */
     s = task->rules;
@@ -344,12 +345,44 @@ isScalarResult(Expr *x)
     return 0;
 }
 
+/*
+ * Evaluation over whole instance vectors - metric values extracted
+ * a vector at a time, and relational operators over arithmetic operators
+ * evaluated in one pass (see fused.sk) - unless $PMIE_VECTOR is zero.
+ */
+int
+vectorEval(void)
+{
+    static int	enabled = -1;
+    char	*p;
+
+    if (enabled < 0)
+	enabled = ((p = getenv("PMIE_VECTOR")) == NULL || atoi(p) != 0);
+    return enabled;
+}
+
+/*
+ * A shared subexpression is evaluated by the first of its parents to
+ * need it in each Task evaluation, and its values reused by the others.
+ */
+int
+evalShared(Expr *x)
+{
+    if (x->seq == evalseq) {
+	perf->expr_reused++;
+	return 0;
+    }
+    x->seq = evalseq;
+    return 1;
+}
+
 /* fill in appropriate evaluator function for given Expr */
 void
 findEval(Expr *x)
 {
     int		arity = 0;
     Metric	*m;
+    Eval	*e;
 
     /* 
      * arity values constructed from bit masks
@@ -815,6 +848,12 @@ findEval(Expr *x)
 	exit(1);
     }
 
+    if ((x->op == CND_EQ || x->op == CND_NEQ ||
+	 x->op == CND_LT || x->op == CND_LTE ||
+	 x->op == CND_GT || x->op == CND_GTE) &&
+	vectorEval() && x->arg1->nsharers == 0 && (e = fusedEval(x)) != NULL)
+	x->eval = e;
+
     /* patch in fake actions for archive mode */
     if (archives &&
 	(x->op == ACT_SHELL || x->op == ACT_ALARM || x->op == ACT_SYSLOG ||
@@ -30,6 +30,9 @@ int isScalarResult(Expr *);
 /* fill in apprpriate evaluator function for given Expr */
 void findEval(Expr *);
 
+/* evaluate over whole instance vectors? */
+int vectorEval(void);
+
 /* run evaluator until specified time reached */
 void run(void);
 
@@ -24,8 +24,11 @@
 #include "dstruct.h"
 #include "andor.h"
 
+/* evaluate shared subexpression, not yet evaluated for this Task? */
+int evalShared(Expr *);
+
 #define ROTATE(x)  if ((x)->nsmpls > 1) rotate(x);
-#define EVALARG(x) if ((x)->op < NOP) ((x)->eval)(x);
+#define EVALARG(x) if ((x)->op < NOP && ((x)->nsharers == 0 || evalShared(x))) ((x)->eval)(x);
 
 /* expression evaluator function prototypes */
 void rule(Expr *);
@@ -130,5 +133,9 @@ void actStomp(Expr *);
 void actArg(Expr *);
 void actFake(Expr *);
 
+/* fused evaluator for a relational operator, see fused.sk */
+Eval *fusedEval(Expr *);
+char *fusedName(Eval *);
+
 #endif /* FUN_H */
 
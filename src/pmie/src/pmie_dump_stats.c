@@ -44,8 +44,9 @@ main(int argc, char **argv)
 	    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
 	    return 1;
 	}
-	if ((sts = read(fd, &stats, sizeof(stats))) != sizeof(stats)) {
-	    fprintf(stderr, "%s: read %d != %d as expected\n", argv[1], sts, (int)sizeof(stats));
+	memset(&stats, 0, sizeof(stats));
+	if ((sts = read(fd, &stats, sizeof(stats))) < (int)PMIE_STATS_V1_SIZE) {
+	    fprintf(stderr, "%s: read %d < %d as expected\n", argv[1], sts, (int)PMIE_STATS_V1_SIZE);
 	}
 	else {
 	    char	*p;
@@ -74,6 +75,11 @@ main(int argc, char **argv)
 	    printf("%s:eval_unknown=%d\n", p, stats.eval_unknown);
 	    printf("%s:eval_actual=%d\n", p, stats.eval_actual);
 	    printf("%s:version=%d\n", p, stats.version);
+	    if (stats.version >= 2) {
+		printf("%s:expr_nodes=%d\n", p, stats.expr_nodes);
+		printf("%s:expr_shared=%d\n", p, stats.expr_shared);
+		printf("%s:expr_reused=%d\n", p, stats.expr_reused);
+	    }
 	}
 	argc--;
 	argv++;
@@ -36,6 +36,7 @@
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
 #endif
+#include <pthread.h>
 
 extern char	*clientid;
 
@@ -77,7 +78,7 @@ newContext(Symbol *host, const char *hconn, int is_temp)
             exit(1);
         }
     }
-    else if ((sts = pmNewContext(PM_CONTEXT_HOST, hconn)) < 0) {
+    else if ((sts = pmNewContext(PM_CONTEXT_HOST | PM_CTXFLAG_ARENA, hconn)) < 0) {
 	if (host_state_changed(hconn, STATE_FAILINIT) == 1) {
 	    if (sts == -ECONNREFUSED)
 		fprintf(stderr, "%s: warning - pmcd "
@@ -256,8 +257,8 @@ findHost(Task *t, Metric *m)
     Host	*h;
 
     h = t->hosts;
-    while (h) {			/* look for existing host */
-	if (h->name == m->hname)
+    while (h) {			/* look for existing host connection */
+	if (h->name == m->hname && h->conn == m->hconn)
 	    return h;
 	h = h->next;
     }
@@ -340,8 +341,9 @@ findFetch(Host *h, Metric *m)
 	p++;
     }
 
-    /* add new pmid */
+    /* add new pmid, once no fetch worker is using the pmids array */
     if (i == n) {
+	fetchWait(f);
 	p = f->pmids;
 	p = ralloc(p, (n+1) * sizeof(pmID));
 	p[n] = pmid;
@@ -349,6 +351,9 @@ findFetch(Host *h, Metric *m)
 	f->pmids = p;
     }
 
+    /* pmids are only ever appended, so this slot remains valid */
+    m->vsidx = i;
+
     return f;
 }
 
@@ -450,9 +455,11 @@ bundle(Task *t, Expr *x)
 	}
     }
     else {
+	/* a shared subexpression is bundled with its first parent */
 	if (x->arg1) {
-	    bundle(t, x->arg1);
-	    if (x->arg2)
+	    if (x->arg1->nsharers == 0 || x->arg1->parent == x)
+		bundle(t, x->arg1);
+	    if (x->arg2 && (x->arg2->nsharers == 0 || x->arg2->parent == x))
 		bundle(t, x->arg2);
 	}
     }
@@ -649,6 +656,64 @@ scale(pmUnits in)
     return f;
 }
 
+/*
+ * reshape, starting at x and working up the expression (through all
+ * the parents of a shared Expr) until we reach the top of the tree
+ */
+static int
+reshapeExpr(Expr *x)
+{
+    int		reshape = 0;
+    int		i;
+
+    /*
+     * only reshape expressions that may have set values
+     */
+    if (x->op == CND_FETCH ||
+	x->op == CND_NEG || x->op == CND_ADD || x->op == CND_SUB ||
+	x->op == CND_MUL || x->op == CND_DIV ||
+	x->op == CND_SUM_HOST || x->op == CND_SUM_INST ||
+	x->op == CND_SUM_TIME ||
+	x->op == CND_AVG_HOST || x->op == CND_AVG_INST ||
+	x->op == CND_AVG_TIME ||
+	x->op == CND_MAX_HOST || x->op == CND_MAX_INST ||
+	x->op == CND_MAX_TIME ||
+	x->op == CND_MIN_HOST || x->op == CND_MIN_INST ||
+	x->op == CND_MIN_TIME ||
+	x->op == CND_EQ || x->op == CND_NEQ ||
+	x->op == CND_LT || x->op == CND_LTE ||
+	x->op == CND_GT || x->op == CND_GTE ||
+	x->op == CND_NOT || x->op == CND_AND || x->op == CND_OR ||
+	x->op == CND_RISE || x->op == CND_FALL || x->op == CND_INSTANT ||
+	x->op == CND_MATCH || x->op == CND_NOMATCH) {
+	reshape++;
+	instFetchExpr(x);
+	findEval(x);
+	if (pmDebugOptions.appl1) {
+	    fprintf(stderr, "reinitMetric: reshaped ...\n");
+	    dumpExpr(x);
+	}
+    }
+
+    /*
+     * used to stop if x->metrics != m, but this is wrong
+     * when the same metric is used as the left and right
+     * operator (with different instance specifiers), e.g.
+     * all_inst(foo == foo #'magic') ...
+     *
+     * if a parent is a set -> scalar function, like
+     * CND_COUNT_INST, don't propagate instance reshaping
+     * further up the tree
+     */
+    if (x->parent && !isScalarResult(x->parent))
+	reshape += reshapeExpr(x->parent);
+    for (i = 0; i < x->nsharers; i++) {
+	if (!isScalarResult(x->sharers[i]))
+	    reshape += reshapeExpr(x->sharers[i]);
+    }
+    return reshape;
+}
+
 /*
  * initialize / reinitialize Metric (m)
  * reinit is 0 for init case, 1 for reinit case
@@ -843,64 +908,9 @@ init(Metric *m, int reinit)
 	}
     }
     if (ret == 1 && reinit) {
-	/*
-	 * reshape, starting here are working up the expression until
-	 * we reach the top of the tree or the designated metrics
-	 * associated with the node are not the same
-	 */
 	Expr	*x = m->expr;
-	int	reshape = 0;
-	while (x) {
-	    /*
-	     * only reshape expressions that may have set values
-	     */
-	    if (x->op == CND_FETCH ||
-		x->op == CND_NEG || x->op == CND_ADD || x->op == CND_SUB ||
-		x->op == CND_MUL || x->op == CND_DIV ||
-		x->op == CND_SUM_HOST || x->op == CND_SUM_INST ||
-		x->op == CND_SUM_TIME ||
-		x->op == CND_AVG_HOST || x->op == CND_AVG_INST ||
-		x->op == CND_AVG_TIME ||
-		x->op == CND_MAX_HOST || x->op == CND_MAX_INST ||
-		x->op == CND_MAX_TIME ||
-		x->op == CND_MIN_HOST || x->op == CND_MIN_INST ||
-		x->op == CND_MIN_TIME ||
-		x->op == CND_EQ || x->op == CND_NEQ ||
-		x->op == CND_LT || x->op == CND_LTE ||
-		x->op == CND_GT || x->op == CND_GTE ||
-		x->op == CND_NOT || x->op == CND_AND || x->op == CND_OR ||
-		x->op == CND_RISE || x->op == CND_FALL || x->op == CND_INSTANT ||
-		x->op == CND_MATCH || x->op == CND_NOMATCH) {
-		reshape++;
-		instFetchExpr(x);
-		findEval(x);
-		if (pmDebugOptions.appl1) {
-		    fprintf(stderr, "reinitMetric: reshaped ...\n");
-		    dumpExpr(x);
-		}
-	    }
-	    if (x->parent) {
-		x = x->parent;
-		/*
-		 * used to stop if x->metrics != m, but this is wrong
-		 * when the same metric is used as the left and right
-		 * operator (with different instance specifiers), e.g.
-		 * all_inst(foo == foo #'magic') ...
-		 */
-		;
-		/* 
-		 * if operand is a set -> scalar function, like
-		 * CND_COUNT_INST, don't propagate instance reshaping
-		 * further up the tree
-		 */
-		if (isScalarResult(x))
-		    break;
-	    }
-	    else
-		break;		/* x is root of expression tree */
-	}
-	if (reshape && pmDebugOptions.appl1 && pmDebugOptions.desperate) {
-	    x = m->expr;
+
+	if (reshapeExpr(x) && pmDebugOptions.appl1 && pmDebugOptions.desperate) {
 	    while (x->parent)
 		x = x->parent;
 	    fprintf(stderr, "reinitMetric: enclosing tree after reshaping\n");
@@ -970,6 +980,209 @@ reconnect(Host *h)
 }
 
 
+/***********************************************************************
+ * common subexpressions
+ ***********************************************************************
+ *
+ * Rules (and especially those generated by pmieconf) often repeat the
+ * same subexpressions.  Each distinct subexpression within a Task is
+ * kept in the Task's exprs hash table, and identical subexpressions in
+ * later rules are replaced by it, so its metrics are fetched, its ring
+ * buffer allocated and its values computed just once for each Task
+ * evaluation (see EVALARG).  The parent of a shared Expr is its first
+ * parent, the others are in its sharers[].
+ */
+
+/* is sharing of common subexpressions enabled? */
+static int
+shareEval(void)
+{
+    static int	share = -1;
+    char	*p;
+
+    if (share < 0)
+	share = ((p = getenv("PMIE_SHARE")) == NULL || atoi(p) != 0);
+    return share;
+}
+
+/* may x be shared? */
+static int
+shareable(Expr *x)
+{
+    switch (x->op) {
+	case NOP:
+	    return x->sem == SEM_NUMCONST;
+	case CND_FETCH: case CND_DELAY: case CND_RATE: case CND_INSTANT:
+	case CND_NEG: case CND_ADD: case CND_SUB: case CND_MUL: case CND_DIV:
+	case CND_SUM_HOST: case CND_SUM_INST: case CND_SUM_TIME:
+	case CND_AVG_HOST: case CND_AVG_INST: case CND_AVG_TIME:
+	case CND_MAX_HOST: case CND_MAX_INST: case CND_MAX_TIME:
+	case CND_MIN_HOST: case CND_MIN_INST: case CND_MIN_TIME:
+	case CND_EQ: case CND_NEQ: case CND_LT: case CND_LTE:
+	case CND_GT: case CND_GTE:
+	case CND_NOT: case CND_RISE: case CND_FALL: case CND_AND: case CND_OR:
+	case CND_ALL_HOST: case CND_ALL_INST: case CND_ALL_TIME:
+	case CND_SOME_HOST: case CND_SOME_INST: case CND_SOME_TIME:
+	case CND_PCNT_HOST: case CND_PCNT_INST: case CND_PCNT_TIME:
+	case CND_COUNT_HOST: case CND_COUNT_INST: case CND_COUNT_TIME:
+	    return 1;
+    }
+    return 0;
+}
+
+/* is fetch expression x below an instant() operator, so not rate converted? */
+static int
+instantFetch(Expr *x)
+{
+    while ((x = x->parent) != NULL) {
+	if (x->op == CND_INSTANT)
+	    return 1;
+    }
+    return 0;
+}
+
+/* hash of x, given that its arguments are already shared */
+static unsigned int
+exprKey(Expr *x)
+{
+    unsigned int	key;
+    unsigned char	*c;
+    Metric		*m;
+    int			i, j;
+
+    key = x->op * 31 + x->tdom;
+    key = key * 31 + (unsigned int)(__psint_t)x->arg1;
+    key = key * 31 + (unsigned int)(__psint_t)x->arg2;
+    if (x->op == NOP) {
+	c = (unsigned char *)x->smpls[0].ptr;
+	for (i = 0; i < sizeof(double); i++)
+	    key = key * 31 + c[i];
+    }
+    else if (x->op == CND_FETCH) {
+	for (m = x->metrics, i = 0; i < x->hdom; m++, i++) {
+	    key = key * 31 + (unsigned int)(__psint_t)m->mname;
+	    key = key * 31 + (unsigned int)(__psint_t)m->hconn;
+	    for (j = 0; j < m->specinst; j++)
+		key = key * 31 + strlen(m->inames[j]);
+	}
+    }
+    return key;
+}
+
+/* are x and y the same, given that their arguments are already shared? */
+static int
+exprSame(Expr *x, Expr *y)
+{
+    Metric	*m, *n;
+    int		i, j;
+
+    if (x->op != y->op || x->arg1 != y->arg1 || x->arg2 != y->arg2 ||
+	x->hdom != y->hdom || x->tdom != y->tdom || x->nsmpls != y->nsmpls ||
+	x->sem != y->sem)
+	return 0;
+    if (x->op == NOP)
+	return unieq(x->units, y->units) &&
+	       *(double *)x->smpls[0].ptr == *(double *)y->smpls[0].ptr;
+    if (x->op == CND_FETCH) {
+	if (instantFetch(x) != instantFetch(y))
+	    return 0;
+	for (m = x->metrics, n = y->metrics, i = 0; i < x->hdom; m++, n++, i++) {
+	    if (m->mname != n->mname || m->hconn != n->hconn ||
+		m->specinst != n->specinst)
+		return 0;
+	    for (j = 0; j < m->specinst; j++) {
+		if (strcmp(m->inames[j], n->inames[j]) != 0)
+		    return 0;
+	    }
+	}
+    }
+    return 1;
+}
+
+/*
+ * parent p now shares x ... a fused relational operator evaluates its
+ * arithmetic operand itself, so cannot be used once that is shared
+ */
+static void
+addSharer(Expr *x, Expr *p)
+{
+    x->sharers = (Expr **)ralloc(x->sharers, (x->nsharers + 1) * sizeof(Expr *));
+    x->sharers[x->nsharers++] = p;
+    if (x->nsharers == 1 && x->parent &&
+	x->parent->op >= CND_EQ && x->parent->op <= CND_GTE)
+	findEval(x->parent);
+    if (p->op >= CND_EQ && p->op <= CND_GTE)
+	findEval(p);
+}
+
+/* x has shared arguments in place of its original arg1 and arg2 */
+static void
+adoptArgs(Expr *x, Expr *arg1, Expr *arg2)
+{
+    if (x->arg1 != arg1)
+	addSharer(x->arg1, x);
+    if (x->arg2 != arg2)
+	addSharer(x->arg2, x);
+    if (x->op != CND_FETCH && (x->arg1 != arg1 || x->arg2 != arg2))
+	x->metrics = primary(x->arg1, x->arg2)->metrics;
+}
+
+/* return the shared Expr equivalent to x, freeing x if it is a duplicate */
+static Expr *
+shareExpr(Task *t, Expr *x)
+{
+    Expr		*arg1 = x->arg1;
+    Expr		*arg2 = x->arg2;
+    Expr		*y;
+    __pmHashNode	*hp;
+    unsigned int	key;
+
+    if (!shareable(x))
+	return x;
+
+    if (arg1)
+	x->arg1 = shareExpr(t, arg1);
+    if (arg2)
+	x->arg2 = shareExpr(t, arg2);
+
+    key = exprKey(x);
+    for (hp = __pmHashSearch(key, &t->exprs); hp != NULL; hp = hp->next) {
+	y = (Expr *)hp->data;
+	if (hp->key != key || y == x || !exprSame(x, y))
+	    continue;
+	/* y has the same arguments, any duplicate arguments of x are gone */
+	if (pmDebugOptions.appl1) {
+	    fprintf(stderr, "shareExpr: " PRINTF_P_PFX "%p replaced by " PRINTF_P_PFX "%p\n", x, y);
+	    dumpExpr(y);
+	}
+	x->arg1 = x->arg2 = NULL;
+	freeExpr(x);
+	perf->expr_shared++;
+	return y;
+    }
+
+    adoptArgs(x, arg1, arg2);
+    __pmHashAdd(key, x, &t->exprs);
+    perf->expr_nodes++;
+    return x;
+}
+
+/* share the subexpressions of a rule (but not its actions) */
+static void
+shareRule(Task *t, Expr *x)
+{
+    Expr	*arg1 = x->arg1;
+    Expr	*arg2 = x->arg2;
+
+    if (x->op != RULE && !shareable(x))
+	return;
+    if (arg1)
+	x->arg1 = shareExpr(t, arg1);
+    if (arg2 && x->op != RULE)
+	x->arg2 = shareExpr(t, arg2);
+    adoptArgs(x, arg1, arg2);
+}
+
 /* pragmatics analysis */
 void
 pragmatics(Symbol rule, RealTime delta)
@@ -979,6 +1192,8 @@ pragmatics(Symbol rule, RealTime delta)
 
     if (x->op != NOP) {
 	t = findTask(delta);
+	if (shareEval())
+	    shareRule(t, x);
 	bundle(t, x);
 	t->nrules++;
 	t->rules = (Symbol *) ralloc(t->rules, t->nrules * sizeof(Symbol));
@@ -1012,6 +1227,259 @@ mark_all(Host *hdown)
     }
 }
 
+/***********************************************************************
+ * concurrent fetching
+ ***********************************************************************
+ *
+ * When a Task has live Fetches for more than one Host, the fetches are
+ * handed to a pool of worker threads so that one slow or unresponsive
+ * pmcd does not hold up all the others.  Each Fetch has its own context,
+ * so the workers need only share the queue and the completion states
+ * below.  taskFetch waits for the workers until a deadline of one Task
+ * sample interval; a Fetch that is still outstanding then contributes
+ * no values to this evaluation, and is not reissued until it completes.
+ * The first deadline missed, and the eventual reply, are both logged.
+ * Archive fetches are always done in sequence.
+ */
+
+#define FETCH_THREADS	8	/* default size of the fetch worker pool */
+
+static pthread_mutex_t	fetchlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	fetchwork = PTHREAD_COND_INITIALIZER;	/* Fetch queued */
+static pthread_cond_t	fetchdone = PTHREAD_COND_INITIALIZER;	/* Fetch completed */
+static Fetch		*fetchq;	/* Fetches waiting for a worker */
+static Fetch		**fetchtail = &fetchq;
+static int		nworkers;	/* number of workers started */
+static int		maxworkers = -1;	/* limit, from $PMIE_FETCH_THREADS */
+
+static void *
+fetchWorker(void *arg)
+{
+    Fetch	*f;
+    pmResult	*r = NULL;
+    int		sts;
+
+    pthread_mutex_lock(&fetchlock);
+    for ( ; ; ) {
+	while ((f = fetchq) == NULL)
+	    pthread_cond_wait(&fetchwork, &fetchlock);
+	if ((fetchq = f->qnext) == NULL)
+	    fetchtail = &fetchq;
+	f->qnext = NULL;
+	f->state = FETCH_BUSY;
+	pthread_mutex_unlock(&fetchlock);
+
+	/* the current context is per-thread state in libpcp */
+	if ((sts = pmUseContext(f->handle)) >= 0)
+	    sts = pmFetch(f->npmids, f->pmids, &r);
+
+	pthread_mutex_lock(&fetchlock);
+	f->sts = sts;
+	f->pending = (sts < 0) ? NULL : r;
+	f->state = FETCH_DONE;
+	pthread_cond_broadcast(&fetchdone);
+    }
+    /*NOTREACHED*/
+    return NULL;
+}
+
+/* start another worker, if below the limit - called with fetchlock held */
+static void
+fetchWorkerStart(void)
+{
+    pthread_t	tid;
+    sigset_t	mask, save;
+    char	*p;
+    int		sts;
+
+    if (maxworkers < 0) {
+	if ((p = getenv("PMIE_FETCH_THREADS")) != NULL)
+	    maxworkers = atoi(p);
+	else
+	    maxworkers = FETCH_THREADS;
+	if (maxworkers < 0)
+	    maxworkers = 0;
+    }
+    if (nworkers >= maxworkers)
+	return;
+
+    /* signals are handled by the main thread only */
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, &save);
+    if ((sts = pthread_create(&tid, NULL, fetchWorker, NULL)) != 0) {
+	pmNotifyErr(LOG_WARNING, "cannot start fetch worker: %s\n",
+			pmErrStr(-sts));
+	maxworkers = nworkers;
+    }
+    else {
+	pthread_detach(tid);
+	nworkers++;
+    }
+    pthread_sigmask(SIG_SETMASK, &save, NULL);
+}
+
+/* wait for any concurrent fetch outstanding for Fetch f */
+void
+fetchWait(Fetch *f)
+{
+    pthread_mutex_lock(&fetchlock);
+    while (f->state == FETCH_QUEUED || f->state == FETCH_BUSY)
+	pthread_cond_wait(&fetchdone, &fetchlock);
+    pthread_mutex_unlock(&fetchlock);
+}
+
+/* true if the live Fetches of Task t are to be issued concurrently */
+static int
+fetchConcurrent(Task *t)
+{
+    Host	*h;
+    int		n = 0;
+
+    if (archives || maxworkers == 0)
+	return 0;
+    for (h = t->hosts; h != NULL; h = h->next) {
+	if (h->fetches && ! h->down && ++n > 1)
+	    return 1;
+    }
+    return 0;
+}
+
+/* fetch status sts for Fetch f, sorting out any failure */
+static void
+fetchStatus(Fetch *f, int sts)
+{
+    Host	*h = f->host;
+
+    if (archives) {
+	if (sts == PM_ERR_LOGREC) {
+	    fprintf(stderr, "%s: pmFetch failed: %s\n", pmGetProgname(),
+		    pmErrStr(sts));
+	    exit(1);
+	}
+    }
+    else if (! h->down) {
+	pmNotifyErr(LOG_ERR, "pmFetch from %s failed: %s\n",
+		symName(h->name), pmErrStr(sts));
+	host_state_changed(symName(h->conn), STATE_LOSTCONN);
+	h->down = 1;
+	mark_all(h);
+    }
+    f->result = NULL;
+}
+
+/* issue fetches for Task t to the workers, and wait until the deadline */
+static void
+fetchAll(Task *t)
+{
+    Host		*h;
+    Fetch		*f;
+    struct timespec	deadline;
+    RealTime		when;
+    int			nqueued = 0;
+    int			sts = 0;
+
+    pmtimespecNow(&deadline);
+    when = deadline.tv_nsec / 1e9 + t->delta;
+    deadline.tv_sec += (time_t)when;
+    deadline.tv_nsec = (long)((when - (time_t)when) * 1e9);
+
+    pthread_mutex_lock(&fetchlock);
+    for (h = t->hosts; h != NULL; h = h->next) {
+	for (f = h->fetches; f != NULL; f = f->next) {
+	    if (f->result) {
+		pmFreeResult(f->result);
+		f->result = NULL;
+	    }
+	    if (f->state == FETCH_DONE) {
+		/* completed after an earlier deadline - report failure only */
+		f->state = FETCH_IDLE;
+		f->late = 0;
+		if (f->pending) {
+		    pmNotifyErr(LOG_INFO, "pmFetch from %s: late reply received\n",
+				symName(h->conn));
+		    pmFreeResult(f->pending);
+		    f->pending = NULL;
+		}
+		else {
+		    pthread_mutex_unlock(&fetchlock);
+		    fetchStatus(f, f->sts);
+		    pthread_mutex_lock(&fetchlock);
+		}
+	    }
+	    if (f->state != FETCH_IDLE || h->down)
+		continue;
+	    f->state = FETCH_QUEUED;
+	    *fetchtail = f;
+	    fetchtail = &f->qnext;
+	    if (++nqueued > nworkers)
+		fetchWorkerStart();
+	}
+    }
+    if (nworkers == 0) {
+	/* no workers at all, so fall back to fetching in sequence */
+	for (f = fetchq; f != NULL; f = f->qnext) {
+	    f->state = FETCH_DONE;
+	    if ((f->sts = pmUseContext(f->handle)) >= 0)
+		f->sts = pmFetch(f->npmids, f->pmids, &f->pending);
+	    if (f->sts < 0)
+		f->pending = NULL;
+	}
+	fetchq = NULL;
+	fetchtail = &fetchq;
+    }
+    else
+	pthread_cond_broadcast(&fetchwork);
+
+    /* wait for every Fetch queued above, or the deadline */
+    for (h = t->hosts; h != NULL && sts != ETIMEDOUT; h = h->next) {
+	for (f = h->fetches; f != NULL; f = f->next) {
+	    while (f->state == FETCH_QUEUED || f->state == FETCH_BUSY) {
+		if ((sts = pthread_cond_timedwait(&fetchdone, &fetchlock, &deadline)) == ETIMEDOUT)
+		    break;
+	    }
+	    if (sts == ETIMEDOUT)
+		break;
+	}
+    }
+
+    /* collect completed fetches */
+    for (h = t->hosts; h != NULL; h = h->next) {
+	for (f = h->fetches; f != NULL; f = f->next) {
+	    if (f->state != FETCH_DONE) {
+		if (f->state != FETCH_IDLE && !f->late) {
+		    pmNotifyErr(LOG_WARNING, "pmFetch from %s: timed out, "
+				"no reply within %.3f sec\n",
+				symName(h->conn), t->delta);
+		    f->late = 1;
+		}
+		continue;
+	    }
+	    f->state = FETCH_IDLE;
+	    if ((f->result = f->pending) == NULL) {
+		pthread_mutex_unlock(&fetchlock);
+		fetchStatus(f, f->sts);
+		pthread_mutex_lock(&fetchlock);
+	    }
+	    f->pending = NULL;
+	}
+    }
+    pthread_mutex_unlock(&fetchlock);
+}
+
+/* sort vlist of v by instance, if not already in order */
+static void
+sortValueSet(pmValueSet *v)
+{
+    int		i;
+
+    for (i = 1; i < v->numval; i++) {
+	if (v->vlist[i-1].inst > v->vlist[i].inst) {
+	    qsort(v->vlist, (size_t)v->numval, sizeof(pmValue), compair);
+	    break;
+	}
+    }
+}
+
 /* execute fetches for given Task */
 void
 taskFetch(Task *t)
@@ -1021,78 +1489,64 @@ taskFetch(Task *t)
     Profile	*p;
     Metric	*m;
     pmResult	*r;
-    pmValueSet	**v;
+    pmValueSet	*v;
     int		i;
     int		sts;
 
     /* do all fetches, quick as you can */
-    h = t->hosts;
-    while (h) {
-	f = h->fetches;
-	while (f) {
-	    if (f->result) pmFreeResult(f->result);
-	    if (! h->down) {
-		pmUseContext(f->handle);
-		if ((sts = pmFetch(f->npmids, f->pmids, &f->result)) < 0) {
-		    if (archives) {
-			if (sts == PM_ERR_LOGREC) {
-			    fprintf(stderr, "%s: pmFetch failed: %s\n", pmGetProgname(),
-				    pmErrStr(sts));
-			    exit(1);
-			}
-		    }
-		    else {
-			pmNotifyErr(LOG_ERR, "pmFetch from %s failed: %s\n",
-				symName(f->host->name), pmErrStr(sts));
-			host_state_changed(symName(f->host->conn), STATE_LOSTCONN);
-			h->down = 1;
-			mark_all(h);
-		    }
-		    f->result = NULL;
+    if (fetchConcurrent(t))
+	fetchAll(t);
+    else {
+	h = t->hosts;
+	while (h) {
+	    f = h->fetches;
+	    while (f) {
+		if (f->result) pmFreeResult(f->result);
+		f->result = NULL;
+		if (! h->down) {
+		    fetchWait(f);
+		    pmUseContext(f->handle);
+		    if ((sts = pmFetch(f->npmids, f->pmids, &f->result)) < 0)
+			fetchStatus(f, sts);
 		}
+		f = f->next;
 	    }
-	    else
-		f->result = NULL;
-	    f = f->next;
+	    h = h->next;
 	}
-	h = h->next;
     }
 
     /* sort and distribute pmValueSets to requesting Metrics */
     h = t->hosts;
     while (h) {
 	if (! h->down) {
-	    f = h->fetches;
-	    while (f && (r = f->result)) {
+	    for (f = h->fetches; f != NULL; f = f->next) {
+		if ((r = f->result) == NULL)
+		    continue;
+
 		/* sort all vlists in result r */
-		v = r->vset;
 		for (i = 0; i < r->numpmid; i++) {
-		    if ((*v)->numval > 0) {
-			qsort((*v)->vlist, (size_t)(*v)->numval,
-			      sizeof(pmValue), compair);
-		    }
-		    v++;
+		    if (r->vset[i]->numval > 1)
+			sortValueSet(r->vset[i]);
 		}
 
-		/* distribute pmValueSets to Metrics */
+		/*
+		 * distribute pmValueSets to Metrics - the result has a
+		 * pmValueSet for each of f->pmids, in order
+		 */
 		p = f->profiles;
 		while (p) {
 		    m = p->metrics;
 		    while (m) {
-			for (i = 0; i < r->numpmid; i++) {
-			    if (m->desc.pmid == r->vset[i]->pmid) {
-				if (r->vset[i]->numval > 0) {
-				    m->vset = r->vset[i];
-				    m->stamp = pmtimevalToReal(&r->timestamp);
-				}
-				break;
-			    }
+			if (m->vsidx < r->numpmid &&
+			    (v = r->vset[m->vsidx])->pmid == m->desc.pmid &&
+			    v->numval > 0) {
+			    m->vset = v;
+			    m->stamp = pmtimevalToReal(&r->timestamp);
 			}
 			m = m->next;
 		    }
 		    p = p->next;
 		}
-		f = f->next;
 	    }
 	}
 	h = h->next;
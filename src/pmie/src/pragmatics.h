@@ -67,6 +67,9 @@ void pragmatics(Symbol, RealTime);
 /* execute fetches for given Task */
 void taskFetch(Task *);
 
+/* wait for any concurrent fetch outstanding for a Fetch */
+void fetchWait(Fetch *);
+
 /* convert Expr value to pmValueSet value */
 void fillVSet(Expr *, pmValueSet *);
 
@@ -14,6 +14,7 @@
 #ifndef STATS_H
 #define STATS_H
 
+#include <stddef.h>
 #include <sys/types.h>
 #include <sys/param.h>
 
@@ -33,6 +34,13 @@ typedef struct {
     unsigned int	eval_unknown;		/* pmcd.pmie.eval.unknown  */
     unsigned int	eval_actual;		/* pmcd.pmie.eval.actual   */
     unsigned int	version;
+    /* version 2 and later */
+    unsigned int	expr_nodes;		/* pmcd.pmie.expr.nodes    */
+    unsigned int	expr_shared;		/* pmcd.pmie.expr.shared   */
+    unsigned int	expr_reused;		/* pmcd.pmie.expr.reused   */
 } pmiestats_t;
 
+/* version 1 stats files end before the expression sharing stats */
+#define PMIE_STATS_V1_SIZE	offsetof(pmiestats_t, expr_nodes)
+
 #endif /* STATS_H */
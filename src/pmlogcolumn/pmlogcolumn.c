@@ -0,0 +1,485 @@
+/*
+ * pmlogcolumn - columnar export of archive values, and queries of the
+ * exported columns
+ *
+ * Copyright (c) 2021 Red Hat.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <float.h>
+#include "pmapi.h"
+#include "libpcp.h"
+
+static int	lflag;		/* -l list columns */
+static int	qflag;		/* -q query columns */
+static int	sflag;		/* -s summary rather than every value */
+static int	vflag;		/* -v verbose */
+static int	zflag;		/* -z timezone of the archive host */
+static char	*tz;		/* -Z timezone */
+static char	*instname;	/* -i instance */
+static char	*Sflag;		/* -S start of query */
+static char	*Tflag;		/* -T end of query */
+
+static pmLongOptions longopts[] = {
+    PMAPI_OPTIONS_HEADER("Options"),
+    PMOPT_DEBUG,
+    { "instance", 1, 'i', "INST", "query only this instance" },
+    { "list", 0, 'l', 0, "list the columns in a columns file" },
+    { "query", 0, 'q', 0, "report values from a columns file" },
+    { "start", 1, 'S', "TIME", "start of the time window for -q" },
+    { "summary", 0, 's', 0, "with -q, report count, minimum, average and maximum" },
+    { "finish", 1, 'T', "TIME", "end of the time window for -q" },
+    { "verbose", 0, 'v', 0, "verbose, report metrics skipped on export" },
+    PMOPT_HOSTZONE,
+    PMOPT_TIMEZONE,
+    PMOPT_HELP,
+    PMAPI_OPTIONS_TEXT(""),
+    PMAPI_OPTIONS_TEXT("Export: pmlogcolumn [options] archive columns [metricname ...]"),
+    PMAPI_OPTIONS_TEXT("Query:  pmlogcolumn -q [options] columns metricname ..."),
+    PMAPI_OPTIONS_TEXT("List:   pmlogcolumn -l columns"),
+    PMAPI_OPTIONS_END
+};
+
+static int override(int, pmOptions *);
+
+static pmOptions opts = {
+    .short_options = "D:i:lqsS:T:vzZ:?",
+    .long_options = longopts,
+    .short_usage = "[options] archive columns [metricname ...]",
+    .override = override,
+};
+
+/* per-metric state for export */
+typedef struct {
+    pmDesc	desc;
+    int		skip;		/* not exported */
+    __pmHashCtl	insts;		/* instance -> column + 1 */
+} metric_t;
+
+static __pmHashCtl	metrics;	/* pmid -> metric_t */
+static __pmHashCtl	wanted;		/* pmids from the command line */
+
+static void
+dometric(const char *name)
+{
+    pmID	pmid;
+    int		sts;
+
+    if ((sts = pmLookupName(1, &name, &pmid)) < 0) {
+	fprintf(stderr, "%s: %s: %s\n", pmGetProgname(), name, pmErrStr(sts));
+	return;
+    }
+    if (__pmHashSearch(pmid, &wanted) == NULL)
+	__pmHashAdd(pmid, NULL, &wanted);
+}
+
+static metric_t *
+lookup_metric(pmID pmid)
+{
+    __pmHashNode	*hp;
+    metric_t		*mp;
+    int			sts;
+
+    if ((hp = __pmHashSearch(pmid, &metrics)) != NULL)
+	return (metric_t *)hp->data;
+    if ((mp = (metric_t *)calloc(1, sizeof(*mp))) == NULL) {
+	pmNoMem("metric", sizeof(*mp), PM_FATAL_ERR);
+	/* NOTREACHED */
+    }
+    __pmHashInit(&mp->insts);
+    if (wanted.nodes > 0 && __pmHashSearch(pmid, &wanted) == NULL)
+	mp->skip = 1;
+    else if ((sts = pmLookupDesc(pmid, &mp->desc)) < 0) {
+	fprintf(stderr, "%s: pmLookupDesc(%s): %s\n",
+		pmGetProgname(), pmIDStr(pmid), pmErrStr(sts));
+	mp->skip = 1;
+    }
+    else if (mp->desc.type != PM_TYPE_32 && mp->desc.type != PM_TYPE_U32 &&
+	     mp->desc.type != PM_TYPE_64 && mp->desc.type != PM_TYPE_U64 &&
+	     mp->desc.type != PM_TYPE_FLOAT && mp->desc.type != PM_TYPE_DOUBLE) {
+	if (vflag) {
+	    char	*name;
+	    if (pmNameID(pmid, &name) >= 0) {
+		fprintf(stderr, "%s: %s: skipped, %s values\n",
+			pmGetProgname(), name, pmTypeStr(mp->desc.type));
+		free(name);
+	    }
+	}
+	mp->skip = 1;
+    }
+    __pmHashAdd(pmid, mp, &metrics);
+    return mp;
+}
+
+static int
+lookup_column(__pmLogColumns *cp, metric_t *mp, int inst)
+{
+    __pmHashNode	*hp;
+    char		*name;
+    char		*iname = NULL;
+    char		buf[32];
+    int			c;
+
+    if ((hp = __pmHashSearch(inst, &mp->insts)) != NULL)
+	return (int)(__psint_t)hp->data - 1;
+    if (pmNameID(mp->desc.pmid, &name) < 0)
+	name = strdup(pmIDStr(mp->desc.pmid));
+    if (inst != PM_IN_NULL &&
+	pmNameInDomArchive(mp->desc.indom, inst, &iname) < 0) {
+	pmsprintf(buf, sizeof(buf), "%d", inst);
+	iname = strdup(buf);
+    }
+    c = __pmLogColumnsAdd(cp, name, &mp->desc, inst, iname);
+    free(name);
+    free(iname);
+    if (c < 0) {
+	fprintf(stderr, "%s: __pmLogColumnsAdd: %s\n", pmGetProgname(), pmErrStr(c));
+	exit(1);
+    }
+    __pmHashAdd(inst, (void *)(__psint_t)(c + 1), &mp->insts);
+    return c;
+}
+
+static void
+export(const char *archive, const char *columns, int argc, char **argv)
+{
+    __pmLogColumns	*cp;
+    __pmTimestamp	stamp;
+    pmLogLabel		label;
+    pmResult		*rp;
+    pmValueSet		*vsp;
+    pmAtomValue		atom;
+    metric_t		*mp;
+    int			ctx;
+    int			sts;
+    int			i, j, c;
+
+    if ((ctx = pmNewContext(PM_CONTEXT_ARCHIVE, archive)) < 0) {
+	fprintf(stderr, "%s: Cannot open archive \"%s\": %s\n",
+		pmGetProgname(), archive, pmErrStr(ctx));
+	exit(1);
+    }
+    if ((sts = pmGetArchiveLabel(&label)) < 0) {
+	fprintf(stderr, "%s: Cannot get archive label record: %s\n",
+		pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+
+    __pmHashInit(&metrics);
+    __pmHashInit(&wanted);
+    for (i = 0; i < argc; i++) {
+	if ((sts = pmTraversePMNS(argv[i], dometric)) < 0) {
+	    fprintf(stderr, "%s: %s: %s\n", pmGetProgname(), argv[i], pmErrStr(sts));
+	    exit(1);
+	}
+    }
+    if (argc > 0 && wanted.nodes == 0)
+	exit(1);
+
+    if ((sts = __pmLogColumnsCreate(columns, label.ll_hostname, label.ll_tz, &cp)) < 0) {
+	fprintf(stderr, "%s: Cannot create \"%s\": %s\n",
+		pmGetProgname(), columns, pmErrStr(sts));
+	exit(1);
+    }
+
+    while ((sts = pmFetchArchive(&rp)) >= 0) {
+	stamp.sec = rp->timestamp.tv_sec;
+	stamp.nsec = rp->timestamp.tv_usec * 1000;
+	for (i = 0; i < rp->numpmid; i++) {
+	    vsp = rp->vset[i];
+	    if (vsp->numval <= 0)
+		continue;
+	    if ((mp = lookup_metric(vsp->pmid)) == NULL || mp->skip)
+		continue;
+	    for (j = 0; j < vsp->numval; j++) {
+		if (pmExtractValue(vsp->valfmt, &vsp->vlist[j], mp->desc.type,
+				&atom, mp->desc.type) < 0)
+		    continue;
+		c = lookup_column(cp, mp, vsp->vlist[j].inst);
+		if ((sts = __pmLogColumnsPut(cp, c, &stamp, &atom)) < 0) {
+		    fprintf(stderr, "%s: Error writing \"%s\": %s\n",
+			    pmGetProgname(), columns, pmErrStr(sts));
+		    exit(1);
+		}
+	    }
+	}
+	pmFreeResult(rp);
+    }
+    if (sts != PM_ERR_EOL) {
+	fprintf(stderr, "%s: pmFetchArchive: %s\n", pmGetProgname(), pmErrStr(sts));
+	exit(1);
+    }
+    if ((sts = __pmLogColumnsClose(cp)) < 0) {
+	fprintf(stderr, "%s: Error writing \"%s\": %s\n",
+		pmGetProgname(), columns, pmErrStr(sts));
+	exit(1);
+    }
+    pmDestroyContext(ctx);
+}
+
+static __pmLogColumns *
+open_columns(const char *columns)
+{
+    __pmLogColumns	*cp;
+    const char		*zone;
+    int			sts;
+
+    if ((sts = __pmLogColumnsOpen(columns, &cp)) < 0) {
+	fprintf(stderr, "%s: Cannot open columns file \"%s\": %s\n",
+		pmGetProgname(), columns, pmErrStr(sts));
+	exit(1);
+    }
+    __pmLogColumnsInfo(cp, NULL, &zone);
+    if (tz != NULL) {
+	if ((sts = pmNewZone(tz)) < 0) {
+	    fprintf(stderr, "%s: Cannot set timezone to \"%s\": %s\n",
+		    pmGetProgname(), tz, pmErrStr(sts));
+	    exit(1);
+	}
+    }
+    else if (zflag && zone != NULL && zone[0] != '\0')
+	pmNewZone(zone);
+    return cp;
+}
+
+static void
+printstamp(double t)
+{
+    struct tm	tm;
+    time_t	sec = (time_t)t;
+    int		usec = (int)((t - sec) * 1000000 + 0.5);
+
+    if (usec >= 1000000) {
+	sec++;
+	usec -= 1000000;
+    }
+    pmLocaltime(&sec, &tm);
+    printf("%04d-%02d-%02d %02d:%02d:%02d.%06d",
+	    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+	    tm.tm_hour, tm.tm_min, tm.tm_sec, usec);
+}
+
+static void
+list(const char *columns)
+{
+    __pmLogColumns		*cp = open_columns(columns);
+    const __pmLogColumnDesc	*cdp;
+    const char			*host;
+    int				c, ncol;
+
+    ncol = __pmLogColumnsInfo(cp, &host, NULL);
+    printf("Host: %s, %d columns\n", host, ncol);
+    for (c = 0; c < ncol; c++) {
+	cdp = __pmLogColumnsDesc(cp, c);
+	printf("%s", cdp->name);
+	if (cdp->iname != NULL)
+	    printf("[%s]", cdp->iname);
+	printf(" %s %d values ", pmTypeStr(cdp->desc.type), cdp->count);
+	printstamp(cdp->first.sec + cdp->first.nsec / 1e9);
+	printf(" to ");
+	printstamp(cdp->last.sec + cdp->last.nsec / 1e9);
+	putchar('\n');
+    }
+    __pmLogColumnsClose(cp);
+}
+
+static void
+query(const char *columns, int argc, char **argv)
+{
+    __pmLogColumns		*cp = open_columns(columns);
+    const __pmLogColumnDesc	*cdp;
+    struct timeval		first = { INT_MAX, 0 };
+    struct timeval		last = { 0, 0 };
+    struct timeval		start, end, origin;
+    __pmTimestamp		lo, hi;
+    double			*times, *values;
+    double			sum, min, max;
+    char			*msg;
+    int				ncol, c, i, n;
+    int				sts;
+    int				found;
+
+    ncol = __pmLogColumnsInfo(cp, NULL, NULL);
+    for (c = 0; c < ncol; c++) {
+	cdp = __pmLogColumnsDesc(cp, c);
+	if (cdp->count == 0)
+	    continue;
+	if (cdp->first.sec < first.tv_sec) {
+	    first.tv_sec = cdp->first.sec;
+	    first.tv_usec = cdp->first.nsec / 1000;
+	}
+	if (cdp->last.sec >= last.tv_sec) {
+	    last.tv_sec = cdp->last.sec + 1;
+	    last.tv_usec = 0;
+	}
+    }
+    if (pmParseTimeWindow(Sflag, Tflag, NULL, NULL, &first, &last,
+			  &start, &end, &origin, &msg) < 0) {
+	fprintf(stderr, "%s: %s", pmGetProgname(), msg);
+	free(msg);
+	exit(1);
+    }
+    lo.sec = start.tv_sec;
+    lo.nsec = start.tv_usec * 1000;
+    hi.sec = end.tv_sec;
+    hi.nsec = end.tv_usec * 1000;
+
+    for (i = 0; i < argc; i++) {
+	found = 0;
+	for (c = 0; c < ncol; c++) {
+	    cdp = __pmLogColumnsDesc(cp, c);
+	    if (strcmp(cdp->name, argv[i]) != 0)
+		continue;
+	    if (instname != NULL &&
+		(cdp->iname == NULL || strcmp(cdp->iname, instname) != 0))
+		continue;
+	    found = 1;
+	    if ((n = __pmLogColumnsRead(cp, c, &lo, &hi, &times, &values)) < 0) {
+		fprintf(stderr, "%s: %s: %s\n", pmGetProgname(), argv[i], pmErrStr(n));
+		exit(1);
+	    }
+	    printf("%s", cdp->name);
+	    if (cdp->iname != NULL)
+		printf("[%s]", cdp->iname);
+	    if (sflag) {
+		sum = 0;
+		min = DBL_MAX;
+		max = -DBL_MAX;
+		for (sts = 0; sts < n; sts++) {
+		    sum += values[sts];
+		    if (values[sts] < min)
+			min = values[sts];
+		    if (values[sts] > max)
+			max = values[sts];
+		}
+		if (n > 0)
+		    printf(" %d values min %.16g avg %.16g max %.16g\n",
+			    n, min, sum / n, max);
+		else
+		    printf(" no values\n");
+	    }
+	    else {
+		printf(": %d values\n", n);
+		for (sts = 0; sts < n; sts++) {
+		    printstamp(times[sts]);
+		    printf(" %.16g\n", values[sts]);
+		}
+	    }
+	    free(times);
+	    free(values);
+	}
+	if (!found)
+	    fprintf(stderr, "%s: %s%s%s%s: %s\n", pmGetProgname(), argv[i],
+		    instname ? "[" : "", instname ? instname : "",
+		    instname ? "]" : "",
+		    pmErrStr(instname ? PM_ERR_INST : PM_ERR_NAME));
+    }
+    __pmLogColumnsClose(cp);
+}
+
+/*
+ * The time window and timezone apply to the columns file, not to an
+ * archive context, so handle these options here rather than in libpcp.
+ */
+static int
+override(int opt, pmOptions *optsp)
+{
+    if (opt == 's' || opt == 'S' || opt == 'T' || opt == 'z' || opt == 'Z')
+	return 1;
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    int		c;
+
+    while ((c = pmGetOptions(argc, argv, &opts)) != EOF) {
+	switch (c) {
+
+	case 'i':	/* instance */
+	    instname = opts.optarg;
+	    break;
+
+	case 'l':	/* list columns */
+	    lflag = 1;
+	    break;
+
+	case 'q':	/* query columns */
+	    qflag = 1;
+	    break;
+
+	case 's':	/* summary */
+	    sflag = 1;
+	    break;
+
+	case 'S':	/* start time */
+	    Sflag = opts.optarg;
+	    break;
+
+	case 'T':	/* end time */
+	    Tflag = opts.optarg;
+	    break;
+
+	case 'v':	/* verbose */
+	    vflag = 1;
+	    break;
+
+	case 'z':	/* timezone of the archive host */
+	    zflag = 1;
+	    break;
+
+	case 'Z':	/* $TZ timezone */
+	    tz = opts.optarg;
+	    break;
+
+	default:
+	    opts.errors++;
+	    break;
+	}
+    }
+
+    if (lflag + qflag > 1) {
+	pmprintf("%s: at most one of -l and -q may be used\n", pmGetProgname());
+	opts.errors++;
+    }
+    if (zflag && tz != NULL) {
+	pmprintf("%s: at most one of -Z and/or -z allowed\n", pmGetProgname());
+	opts.errors++;
+    }
+    if (!qflag && (instname || sflag || Sflag || Tflag)) {
+	pmprintf("%s: -i, -s, -S and -T are only used with -q\n", pmGetProgname());
+	opts.errors++;
+    }
+    if (!opts.errors) {
+	if (lflag && opts.optind != argc - 1)
+	    opts.errors++;
+	else if (qflag && opts.optind > argc - 2)
+	    opts.errors++;
+	else if (!lflag && !qflag && opts.optind > argc - 2)
+	    opts.errors++;
+    }
+    if (opts.errors) {
+	pmUsageMessage(&opts);
+	exit(1);
+    }
+
+    if (lflag)
+	list(argv[opts.optind]);
+    else if (qflag)
+	query(argv[opts.optind], argc - opts.optind - 1, &argv[opts.optind + 1]);
+    else
+	export(argv[opts.optind], argv[opts.optind + 1],
+		argc - opts.optind - 2, &argv[opts.optind + 2]);
+
+    exit(0);
+}
@@ -0,0 +1,42 @@
+/* hand written stand-in for the flex scanner, local testing only */
+#include "pmapi.h"
+#include "libpcp.h"
+#include "logger.h"
+#include <ctype.h>
+int lineno = 1;
+#include "gram.tab.h"
+FILE *yyin;
+char yytext[1024];
+int yylex(void)
+{
+    int c, n;
+    for (;;) {
+	c = fgetc(yyin);
+	if (c == EOF) return 0;
+	if (c == '[') return LSQB;
+	if (c == ']') return RSQB;
+	if (c == ',') return COMMA;
+	if (c == '\n') { lineno++; continue; }
+	if (c == ' ' || c == '\t' || c == '\r') continue;
+	if (c == '#') { while ((c = fgetc(yyin)) != EOF && c != '\n'); if (c == '\n') ungetc(c, yyin); continue; }
+	if (isalpha(c)) {
+	    n = 0; yytext[n++] = c;
+	    while ((c = fgetc(yyin)) != EOF && (isalnum(c) || c == '_' || c == '.')) yytext[n++] = c;
+	    if (c != EOF) ungetc(c, yyin);
+	    yytext[n] = 0; yylval.str = yytext; return NAME;
+	}
+	if (isdigit(c)) {
+	    n = 0; yytext[n++] = c;
+	    while ((c = fgetc(yyin)) != EOF && isdigit(c)) yytext[n++] = c;
+	    if (c != EOF) ungetc(c, yyin);
+	    yytext[n] = 0; yylval.lval = atol(yytext); return NUMBER;
+	}
+	if (c == '"' || c == '\'') {
+	    int q = c; n = 0;
+	    while ((c = fgetc(yyin)) != EOF && c != q && c != '\n') yytext[n++] = c;
+	    yytext[n] = 0; yylval.str = yytext; return STRING;
+	}
+	pmsprintf(emess, sizeof(emess), "Unexpected character '%c'", c);
+	yyerror(emess);
+    }
+}
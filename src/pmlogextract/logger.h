@@ -35,6 +35,11 @@ typedef struct reclist {
     struct reclist	*next;		/* ptr to next reclist_t record */
 } reclist_t;
 
+/*
+ *  records read ahead for each input archive by the reader threads (-j)
+ */
+#define READAHEAD	8
+
 /*
  *  Input archive control
  */
@@ -50,6 +55,10 @@ typedef struct {
     int		recnum;
     int64_t	pmcd_pid;	/* from prologue/epilogue records */
     int32_t	pmcd_seqnum;	/* from prologue/epilogue records */
+    pmResult	*ahead[READAHEAD]; /* ring of records read ahead */
+    int		head;		/* next record in ahead[] */
+    int		nahead;		/* number of records in ahead[] */
+    int		aheadsts;	/* < 0 for error or EOL after the last one */
 } inarch_t;
 
 extern inarch_t	*inarch;	/* input archive control(s) */
@@ -19,6 +19,7 @@
 #include <ctype.h>
 #include <sys/stat.h>
 #include <assert.h>
+#include <pthread.h>
 #include "pmapi.h"
 #include "libpcp.h"
 #include "logger.h"
@@ -35,6 +36,7 @@ static pmLongOptions longopts[] = {
     { "config", 1, 'c', "FILE", "file to load configuration from" },
     { "desperate", 0, 'd', 0, "desperate, save output after fatal error" },
     { "first", 0, 'f', 0, "use timezone from first archive [default is last]" },
+    { "threads", 1, 'j', "N", "read input archives ahead with N threads" },
     { "mark", 0, 'm', 0, "ignore prologue/epilogue records and <mark> between archives" },
     PMOPT_START,
     { "samples", 1, 's', "NUM", "terminate after NUM log records have been written" },
@@ -49,7 +51,7 @@ static pmLongOptions longopts[] = {
 };
 
 static pmOptions opts = {
-    .short_options = "c:D:dfmS:s:T:v:wxZ:z?",
+    .short_options = "c:D:dfj:mS:s:T:v:wxZ:z?",
     .long_options = longopts,
     .short_usage = "[options] input-archive output-archive",
 };
@@ -296,6 +298,12 @@ off_t		old_log_offset;			/* old log offset */
 off_t		old_meta_offset;		/* old meta offset */
 static off_t	flushsize = 100000;		/* bytes before flush */
 
+/*
+ * output data volume and metadata writes are batched up in buffers of
+ * this size, they are flushed before each temporal index entry anyway
+ */
+#define OUTBUFSIZE	131072
+
 
 /* archive control stuff */
 char			*outarchname;	/* name of output archive */
@@ -306,6 +314,41 @@ int			inarchnum;	/* number of input archives */
 
 int			ilog;		/* index of earliest log */
 
+/*
+ * input archives with a log record or mark pending, as a min-heap
+ * on the time of that record (ties to the first input archive) so the
+ * next one to be written out is always at heap[0]
+ */
+typedef struct {
+    pmTimeval	stamp;		/* time of pending log record or mark */
+    int		indx;		/* input archive */
+} pending_t;
+
+static pending_t	*heap;
+static int		nheap;
+static int		*refill;	/* inputs needing their next log record */
+static int		nrefill;
+static int		*newmark;	/* inputs given a mark by nextlog() */
+static int		nnewmark;
+static int		eoflog;		/* number of inputs at EOF */
+
+/*
+ * read-ahead threads, each decoding log records for the input
+ * archives first, first+nreader, first+2*nreader, ...
+ */
+typedef struct {
+    pthread_t		thread;
+    pthread_mutex_t	lock;
+    pthread_cond_t	cond;		/* space in, or records for, ahead[] */
+    int			first;
+    int			idle;		/* reader waiting for space */
+    int			want;		/* main thread waiting for a record */
+    int			stop;
+} reader_t;
+
+static reader_t		*reader;
+static int		nreader = -1;	/* -j arg, -1 for the default */
+
 static __pmHashCtl	rdesc;		/* meta desc records to be written */
 static __pmHashCtl	rindom;		/* meta indom records to be written */
 static __pmHashCtl	rindomoneline;	/* indom oneline records to be written */
@@ -439,6 +482,7 @@ newvolume(char *base, pmTimeval *tvp)
 
     if ((newfp = __pmLogNewFile(base, nextvol)) != NULL) {
 	struct timeval	stamp;
+	__pmSetvbuf(newfp, NULL, _IOFBF, OUTBUFSIZE);
 	__pmFclose(archctl.ac_mfp);
 	archctl.ac_mfp = newfp;
 	logctl.label.vol = archctl.ac_curvol = nextvol;
@@ -1611,16 +1655,231 @@ _createmark(void)
     return((__int32_t *)markp);
 }
 
-void
-checklogtime(pmTimeval *this, int indx)
+static int
+pendingless(pending_t *a, pending_t *b)
 {
-    if ((curlog.tv_sec == 0 && curlog.tv_usec == 0) ||
-	(curlog.tv_sec > this->tv_sec ||
-	(curlog.tv_sec == this->tv_sec && curlog.tv_usec > this->tv_usec))) {
-	    ilog = indx;
-	    curlog.tv_sec = this->tv_sec;
-	    curlog.tv_usec = this->tv_usec;
+    int		sts;
+
+    if ((sts = tvcmp(&a->stamp, &b->stamp)) != 0)
+	return sts < 0;
+    return a->indx < b->indx;
+}
+
+/*
+ * add input archive indx to the heap, keyed on the time of its
+ * _Nresult or (if none) mark pdu
+ */
+static void
+heappush(int indx)
+{
+    inarch_t	*iap = &inarch[indx];
+    pending_t	this;
+    int		i, parent;
+
+    if (iap->_Nresult != NULL) {
+	this.stamp.tv_sec = iap->_Nresult->timestamp.tv_sec;
+	this.stamp.tv_usec = iap->_Nresult->timestamp.tv_usec;
+    }
+    else {
+	this.stamp.tv_sec = iap->pb[LOG][3]; /* no swab needed */
+	this.stamp.tv_usec = iap->pb[LOG][4]; /* no swab needed */
     }
+    this.indx = indx;
+
+    for (i = nheap++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (!pendingless(&this, &heap[parent]))
+	    break;
+	heap[i] = heap[parent];
+    }
+    heap[i] = this;
+}
+
+/*
+ * remove the earliest input archive, heap[0], from the heap
+ */
+static void
+heappop(void)
+{
+    pending_t	*last = &heap[--nheap];
+    int		i, child;
+
+    for (i = 0; (child = 2 * i + 1) < nheap; i = child) {
+	if (child + 1 < nheap && pendingless(&heap[child+1], &heap[child]))
+	    child++;
+	if (!pendingless(&heap[child], last))
+	    break;
+	heap[i] = heap[child];
+    }
+    heap[i] = *last;
+}
+
+/*
+ * read the next log record from an input archive
+ */
+static int
+readlog(inarch_t *iap, pmResult **resp)
+{
+    int		sts;
+    __pmContext	*ctxp;
+
+    if ((ctxp = __pmHandleToPtr(iap->ctx)) == NULL) {
+	fprintf(stderr, "%s: botch: __pmHandleToPtr(%d) returns NULL!\n", pmGetProgname(), iap->ctx);
+	abandon_extract();
+	/*NOTREACHED*/
+    }
+    /* Need to hold c_lock for __pmLogRead_ctx() */
+    sts = __pmLogRead_ctx(ctxp, PM_MODE_FORW, NULL, resp, PMLOGREAD_NEXT);
+    PM_UNLOCK(ctxp->c_lock);
+    return sts;
+}
+
+/*
+ * read-ahead thread ... keep ahead[] full for each of our input
+ * archives, until each one reaches EOL (or an error)
+ */
+static void *
+readerthread(void *arg)
+{
+    reader_t	*rp = (reader_t *)arg;
+    inarch_t	*iap;
+    pmResult	*result;
+    int		indx;
+    int		busy;
+    int		progress;
+    int		sts;
+
+    pthread_mutex_lock(&rp->lock);
+    while (!rp->stop) {
+	busy = progress = 0;
+	for (indx = rp->first; indx < inarchnum && !rp->stop; indx += nreader) {
+	    iap = &inarch[indx];
+	    if (iap->aheadsts < 0)
+		continue;
+	    busy++;
+	    if (iap->nahead == READAHEAD)
+		continue;
+	    pthread_mutex_unlock(&rp->lock);
+	    sts = readlog(iap, &result);
+	    pthread_mutex_lock(&rp->lock);
+	    if (sts < 0)
+		iap->aheadsts = sts;
+	    else
+		iap->ahead[(iap->head + iap->nahead++) % READAHEAD] = result;
+	    if (rp->want)
+		pthread_cond_signal(&rp->cond);
+	    progress++;
+	}
+	if (busy == 0)
+	    break;
+	if (progress == 0) {
+	    /* all full, wait until one is half empty */
+	    rp->idle = 1;
+	    pthread_cond_wait(&rp->cond, &rp->lock);
+	    rp->idle = 0;
+	}
+    }
+    pthread_mutex_unlock(&rp->lock);
+    return NULL;
+}
+
+/*
+ * next log record for an input archive, from the read-ahead thread
+ * if there is one
+ */
+static int
+getlog(inarch_t *iap, pmResult **resp)
+{
+    reader_t	*rp;
+    int		sts = 0;
+
+    if (nreader == 0)
+	return readlog(iap, resp);
+
+    rp = &reader[(iap - inarch) % nreader];
+    pthread_mutex_lock(&rp->lock);
+    while (iap->nahead == 0 && iap->aheadsts == 0) {
+	rp->want = 1;
+	pthread_cond_wait(&rp->cond, &rp->lock);
+	rp->want = 0;
+    }
+    if (iap->nahead > 0) {
+	*resp = iap->ahead[iap->head];
+	iap->head = (iap->head + 1) % READAHEAD;
+	iap->nahead--;
+	if (rp->idle && iap->nahead <= READAHEAD / 2)
+	    pthread_cond_signal(&rp->cond);
+    }
+    else
+	sts = iap->aheadsts;
+    pthread_mutex_unlock(&rp->lock);
+    return sts;
+}
+
+static void
+startreaders(void)
+{
+    int		indx;
+    int		sts;
+
+    if (nreader < 0) {
+	/* one per CPU by default, but none for a single CPU */
+	nreader = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nreader < 2)
+	    nreader = 0;
+    }
+    if (nreader > inarchnum)
+	nreader = inarchnum;
+    if (nreader == 0)
+	return;
+
+    for (indx=0; indx<inarchnum; indx++) {
+	if (inarch[indx].eof[LOG])
+	    inarch[indx].aheadsts = PM_ERR_EOL;
+    }
+    if ((reader = (reader_t *)calloc(nreader, sizeof(reader_t))) == NULL) {
+	fprintf(stderr, "%s: Error: cannot malloc space for %d readers.\n",
+		pmGetProgname(), nreader);
+	abandon_extract();
+	/*NOTREACHED*/
+    }
+    for (indx=0; indx<nreader; indx++) {
+	reader[indx].first = indx;
+	pthread_mutex_init(&reader[indx].lock, NULL);
+	pthread_cond_init(&reader[indx].cond, NULL);
+	sts = pthread_create(&reader[indx].thread, NULL, readerthread, &reader[indx]);
+	if (sts != 0) {
+	    fprintf(stderr, "%s: Error: cannot create reader thread: %s\n",
+		    pmGetProgname(), pmErrStr(-sts));
+	    abandon_extract();
+	    /*NOTREACHED*/
+	}
+    }
+}
+
+static void
+stopreaders(void)
+{
+    inarch_t	*iap;
+    int		indx;
+
+    for (indx=0; indx<nreader; indx++) {
+	pthread_mutex_lock(&reader[indx].lock);
+	reader[indx].stop = 1;
+	pthread_cond_signal(&reader[indx].cond);
+	pthread_mutex_unlock(&reader[indx].lock);
+	pthread_join(reader[indx].thread, NULL);
+    }
+    for (indx=0; indx<inarchnum; indx++) {
+	iap = &inarch[indx];
+	for ( ; iap->nahead > 0; iap->nahead--) {
+	    pmFreeResult(iap->ahead[iap->head]);
+	    iap->head = (iap->head + 1) % READAHEAD;
+	}
+    }
+    free(reader);
+    reader = NULL;
+    nreader = 0;
 }
 
 
@@ -1930,33 +2189,39 @@ againmeta:
 
 
 /*
- * read in next log record for every archive
+ * read in next log record for every archive that needs one, and put
+ * them (back) on the heap
  */
 static int
 nextlog(void)
 {
     int		indx;
-    int		eoflog = 0;	/* number of log files at eof */
+    int		i;
     int		sts;
     pmTimeval	curtime;
-    __pmArchCtl	*acp;
     __pmContext	*ctxp;
     inarch_t	*iap;
 
+    /* if a mark was created last time, then that log is at EOF */
+    for (i=0; i<nnewmark; i++) {
+	inarch[newmark[i]].eof[LOG] = 1;
+	++eoflog;
+    }
+    nnewmark = 0;
 
-    for (indx=0; indx<inarchnum; indx++) {
+    for (i=0; i<nrefill; i++) {
+	indx = refill[i];
 	iap = &inarch[indx];
 
-	/* if at the end of log file then skip this archive */
-	if (iap->eof[LOG]) {
-	    ++eoflog;
+	/* if we already have a log record or mark then just put it back */
+	if (iap->_Nresult != NULL || iap->pb[LOG] != NULL) {
+	    heappush(indx);
 	    continue;
 	}
 
-	/* if we already have a log record then skip this archive */
-	if (iap->_Nresult != NULL) {
+	/* if at the end of log file then skip this archive */
+	if (iap->eof[LOG])
 	    continue;
-	}
 
 	/* if mark has been written out, then log is at EOF */
 	if (iap->mark) {
@@ -1965,20 +2230,15 @@ nextlog(void)
 	    continue;
 	}
 
-	if ((ctxp = __pmHandleToPtr(iap->ctx)) == NULL) {
-	    fprintf(stderr, "%s: botch: __pmHandleToPtr(%d) returns NULL!\n", pmGetProgname(), iap->ctx);
-	    abandon_extract();
-	    /*NOTREACHED*/
-	}
-	/* Need to hold c_lock for __pmLogRead_ctx() */
-	acp = ctxp->c_archctl;
-
 againlog:
-	if ((sts=__pmLogRead_ctx(ctxp, PM_MODE_FORW, NULL, &iap->_result, PMLOGREAD_NEXT)) < 0) {
+	if ((sts = getlog(iap, &iap->_result)) < 0) {
 	    if (sts != PM_ERR_EOL) {
 		fprintf(stderr, "%s: Error: __pmLogRead[log %s]: %s\n",
 			pmGetProgname(), iap->name, pmErrStr(sts));
-		_report(acp->ac_mfp);
+		if ((ctxp = __pmHandleToPtr(iap->ctx)) != NULL) {
+		    _report(ctxp->c_archctl->ac_mfp);
+		    PM_UNLOCK(ctxp->c_lock);
+		}
 		if (sts != PM_ERR_LOGREC)
 		    abandon_extract();
 		    /*NOTREACHED*/
@@ -1996,8 +2256,9 @@ againlog:
 	    else {
 		iap->mark = 1;
 		iap->pb[LOG] = _createmark();
+		newmark[nnewmark++] = indx;
+		heappush(indx);
 	    }
-	    PM_UNLOCK(ctxp->c_lock);
 	    continue;
 	}
 	iap->recnum++;
@@ -2021,36 +2282,30 @@ againlog:
 	 *          have to change as well.
 	 */
 	if (iap->_result->numpmid == 5) {
-	    int		i;
+	    int		j;
 	    pmAtomValue	av;
 	    int		lsts;
-	    for (i=0; i<iap->_result->numpmid; i++) {
-		if (iap->_result->vset[i]->pmid == pmid_pid) {
-		    lsts = pmExtractValue(iap->_result->vset[i]->valfmt, &iap->_result->vset[i]->vlist[0], PM_TYPE_U64, &av, PM_TYPE_64);
+	    for (j=0; j<iap->_result->numpmid; j++) {
+		if (iap->_result->vset[j]->pmid == pmid_pid) {
+		    lsts = pmExtractValue(iap->_result->vset[j]->valfmt, &iap->_result->vset[j]->vlist[0], PM_TYPE_U64, &av, PM_TYPE_64);
 		    if (lsts != 0) {
 			fprintf(stderr,
 			    "%s: Warning: failed to get pmcd.pid from %s at record %d: %s\n",
 				pmGetProgname(), iap->name, iap->recnum, pmErrStr(lsts));
-			if (pmDebugOptions.desperate) {
-			    PM_UNLOCK(ctxp->c_lock);
+			if (pmDebugOptions.desperate)
 			    __pmDumpResult(stderr, iap->_result);
-			    PM_LOCK(ctxp->c_lock);
-			}
 		    }
 		    else
 			iap->pmcd_pid = av.ll;
 		}
-		else if (iap->_result->vset[i]->pmid == pmid_seqnum) {
-		    lsts = pmExtractValue(iap->_result->vset[i]->valfmt, &iap->_result->vset[i]->vlist[0], PM_TYPE_U32, &av, PM_TYPE_32);
+		else if (iap->_result->vset[j]->pmid == pmid_seqnum) {
+		    lsts = pmExtractValue(iap->_result->vset[j]->valfmt, &iap->_result->vset[j]->vlist[0], PM_TYPE_U32, &av, PM_TYPE_32);
 		    if (lsts != 0) {
 			fprintf(stderr,
 			    "%s: Warning: failed to get pmcd.seqnum from %s at record %d: %s\n",
 				pmGetProgname(), iap->name, iap->recnum, pmErrStr(lsts));
-			if (pmDebugOptions.desperate) {
-			    PM_UNLOCK(ctxp->c_lock);
+			if (pmDebugOptions.desperate)
 			    __pmDumpResult(stderr, iap->_result);
-			    PM_LOCK(ctxp->c_lock);
-			}
 		    }
 		    else
 			iap->pmcd_seqnum = av.l;
@@ -2102,9 +2357,10 @@ againlog:
                 goto againlog;
             }
 	}
-	PM_UNLOCK(ctxp->c_lock);
+	heappush(indx);
 
-    } /*for(indx)*/
+    } /*for(i)*/
+    nrefill = 0;
 
     /*
      * if we are here, then each archive control struct should either
@@ -2155,6 +2411,14 @@ parseargs(int argc, char *argv[])
 	    farg = 1;
 	    break;
 
+	case 'j':	/* number of read-ahead threads */
+	    nreader = (int)strtol(opts.optarg, &endnum, 10);
+	    if (*endnum != '\0' || nreader < 0) {
+		pmprintf("%s: -j requires numeric argument\n", pmGetProgname());
+		opts.errors++;
+	    }
+	    break;
+
 	case 'm':	/* always add <mark> between archives */
 	    old_mark_logic = 1;
 	    break;
@@ -2324,6 +2588,12 @@ checkwinend(pmTimeval now)
 	}
     } /*for(indx)*/
 
+    /* start again with the heap, refilling in nextlog() as needed */
+    nheap = 0;
+    for (indx=0; indx<inarchnum; indx++)
+	refill[indx] = indx;
+    nrefill = inarchnum;
+
     /* must create "mark" record and write it out */
     /* (need only one mark record) */
     markpdu = _createmark();
@@ -2587,10 +2857,7 @@ main(int argc, char **argv)
     char	*msg;
 
     pmTimeval 	now = {0,0};		/* the current time */
-    pmTimeval 	mintime = {0,0};
-    pmTimeval 	tmptime = {0,0};
 
-    pmTimeval	tstamp;			/* temporary timestamp */
     inarch_t	*iap;			/* ptr to archive control */
     rlist_t	*rlready = NULL;	/* results ready for writing */
 
@@ -2639,6 +2906,14 @@ main(int argc, char **argv)
         fprintf(stderr, "main        : allocated %d\n",
 			(int)(inarchnum * sizeof(inarch_t)));
     }
+    heap = (pending_t *)malloc(inarchnum * sizeof(pending_t));
+    refill = (int *)malloc(inarchnum * sizeof(int));
+    newmark = (int *)malloc(inarchnum * sizeof(int));
+    if (heap == NULL || refill == NULL || newmark == NULL) {
+	fprintf(stderr, "%s: Error: malloc heap: %s\n",
+		pmGetProgname(), osstrerror());
+	exit(1);
+    }
 
 
     for (indx=0; indx<inarchnum; indx++, opts.optind++) {
@@ -2654,6 +2929,9 @@ main(int argc, char **argv)
 	iap->recnum = 0;
 	iap->_result = NULL;
 	iap->_Nresult = NULL;
+	iap->head = iap->nahead = 0;
+	iap->aheadsts = 0;
+	refill[indx] = indx;
 
 	if ((iap->ctx = pmNewContext(PM_CONTEXT_ARCHIVE, iap->name)) < 0) {
 	    if (iap->ctx == PM_ERR_NODATA) {
@@ -2781,6 +3059,8 @@ main(int argc, char **argv)
 		pmGetProgname(), pmErrStr(sts));
 	exit(1);
     }
+    __pmSetvbuf(archctl.ac_mfp, NULL, _IOFBF, OUTBUFSIZE);
+    __pmSetvbuf(logctl.mdfp, NULL, _IOFBF, OUTBUFSIZE);
 
     /*
      * This must be done after log is created:
@@ -2825,6 +3105,10 @@ main(int argc, char **argv)
     current.tv_usec = 0;
     first_datarec = 1;
     pre_startwin = 1;
+    nheap = 0;
+    nrefill = inarchnum;
+    nnewmark = 0;
+    eoflog = nempty;
 
     /*
      * get all meta data first
@@ -2841,6 +3125,8 @@ main(int argc, char **argv)
 	}
     }
 
+    startreaders();
+
     /*
      * get log record - choose one with earliest timestamp
      * write out meta data (required by this log record)
@@ -2854,48 +3140,23 @@ main(int argc, char **argv)
 	old_meta_offset = __pmFtell(logctl.mdfp);
 	assert(old_meta_offset >= 0);
 
-	/* nextlog() resets ilog, and curlog (to the smallest timestamp) */
 	stslog = nextlog();
 
 	if (stslog < 0)
 	    break;
 
 	/*
-	 * find the _Nresult (or mark pdu) with the earliest timestamp;
-	 * set ilog
-	 * (this is a bit more complex when tflag is specified)
+	 * the _Nresult (or mark pdu) with the earliest timestamp is at
+	 * the top of the heap; set ilog and curlog from it
 	 */
-	mintime.tv_sec = mintime.tv_usec = 0;
-	for (indx=0; indx<inarchnum; indx++) {
-	    if (inarch[indx]._Nresult != NULL) {
-		tstamp.tv_sec = inarch[indx]._Nresult->timestamp.tv_sec;
-		tstamp.tv_usec = inarch[indx]._Nresult->timestamp.tv_usec;
-		checklogtime(&tstamp, indx);
-
-		if (ilog == indx) {
-		    tmptime = curlog;
-		    if (mintime.tv_sec <= 0 || tvcmp(&mintime, &tmptime) > 0)
-		        mintime = tmptime;
-		}
-	    }
-	    else if (inarch[indx].pb[LOG] != NULL) {
-		tstamp.tv_sec = inarch[indx].pb[LOG][3]; /* no swab needed */
-		tstamp.tv_usec = inarch[indx].pb[LOG][4]; /* no swab needed */
-		checklogtime(&tstamp, indx);
-
-		if (ilog == indx) {
-		    tmptime = curlog;
-		    if (mintime.tv_sec <= 0 || tvcmp(&mintime, &tmptime) > 0)
-		        mintime = tmptime;
-		}
-	    }
+	if (nheap > 0) {
+	    ilog = heap[0].indx;
+	    curlog = heap[0].stamp;
 	}
 
 	/*
 	 * now     == the earliest timestamp of the archive(s)
 	 *		and/or mark records
-	 * mintime == now or timestamp of the earliest mark
-	 *		(whichever is smaller)
 	 */
 	now = curlog;
 
@@ -2924,6 +3185,8 @@ main(int argc, char **argv)
 
 
 	iap = &inarch[ilog];
+	heappop();
+	refill[nrefill++] = ilog;
 	if (iap->mark) {
 	    if (do_not_need_mark(iap)) {
 		free(iap->pb[LOG]);
@@ -2987,6 +3250,8 @@ main(int argc, char **argv)
 	}
     } /*while()*/
 
+    stopreaders();
+
     if (first_datarec) {
         fprintf(stderr, "%s: Warning: no qualifying records found.\n",
                 pmGetProgname());
@@ -3010,8 +3275,8 @@ cleanup:
 	assert(new_meta_offset >= 0);
 
 #if 0
-	fprintf(stderr, "*** last tstamp: \n\tmintime=%d.%06d \n\ttmptime=%d.%06d \n\tlogend=%d.%06d \n\twinend=%d.%06d \n\tcurrent=%d.%06d\n",
-	    mintime.tv_sec, mintime.tv_usec, tmptime.tv_sec, tmptime.tv_usec, logend.tv_sec, logend.tv_usec, winend.tv_sec, winend.tv_usec, current.tv_sec, current.tv_usec);
+	fprintf(stderr, "*** last tstamp: \n\tlogend=%d.%06d \n\twinend=%d.%06d \n\tcurrent=%d.%06d\n",
+	    logend.tv_sec, logend.tv_usec, winend.tv_sec, winend.tv_usec, current.tv_sec, current.tv_usec);
 #endif
 
 	__pmFseek(archctl.ac_mfp, old_log_offset, SEEK_SET);
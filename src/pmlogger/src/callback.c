@@ -636,6 +636,7 @@ do_work(task_t *tp)
     pmResult		*resp;
     __pmPDU		*pb_in;
     __pmPDU		*pb_out;
+    __pmContext		*ctxp;
     AFctl_t		*acp;
     lastfetch_t		*lfp;
     lastfetch_t		*free_lfp;
@@ -643,6 +644,7 @@ do_work(task_t *tp)
     int			needindom;
     int			needti;
     static off_t	flushsize = 100000;
+    static struct timeval	last_ti;
     long		old_meta_offset;
     long		label_offset;
     long		new_offset;
@@ -803,12 +805,21 @@ do_work(task_t *tp)
 	 * the metadata changes have been written out, call
 	 * __pmEncodeResult to re-encode a PDU buffer before doing
 	 * the pmResult write.
+	 *
+	 * Decoding via the context means the pmResult is built in a
+	 * single allocation for a pmcd context (PM_CTXFLAG_ARENA).
 	 */
 	last_log_offset = __pmFtell(archctl.ac_mfp);
 	assert(last_log_offset >= 0);
 
 	resp = NULL; /* silence coverity */
-	if ((sts = __pmDecodeResult(pb_in, &resp)) < 0) {
+	if ((ctxp = __pmHandleToPtr(pmWhichContext())) == NULL) {
+	    fprintf(stderr, "callback: botch: no current context\n");
+	    exit(1);
+	}
+	sts = __pmDecodeResult_ctx(ctxp, pb_in, &resp);
+	PM_UNLOCK(ctxp->c_lock);
+	if (sts < 0) {
 	    fprintf(stderr, "__pmDecodeResult: %s\n", pmErrStr(sts));
 	    exit(1);
 	}
@@ -1043,6 +1054,13 @@ do_work(task_t *tp)
 		fprintf(stderr, "callback: file size (%d) reached flushsize (%ld)\n", (int)__pmFtell(archctl.ac_mfp), (long)flushsize);
 	}
 
+	if ((index_delta.tv_sec > 0 || index_delta.tv_usec > 0) &&
+	    pmtimevalSub(&resp->timestamp, &last_ti) >= pmtimevalToReal(&index_delta)) {
+	    needti = 1;
+	    if (pmDebugOptions.appl2)
+		fprintf(stderr, "callback: index interval reached\n");
+	}
+
 	if (needti) {
 	    /*
 	     * need to unwind seek pointer to start of most recent
@@ -1064,6 +1082,7 @@ do_work(task_t *tp)
 	    __pmFseek(archctl.ac_mfp, new_offset, SEEK_SET);
 	    __pmFseek(logctl.mdfp, new_meta_offset, SEEK_SET);
 	    flushsize = __pmFtell(archctl.ac_mfp) + 100000;
+	    last_ti = resp->timestamp;	/* struct assignment */
 	}
 
 	last_stamp = resp->timestamp;	/* struct assignment */
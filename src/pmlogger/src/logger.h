@@ -162,6 +162,7 @@ extern char		*pmcd_host_conn;	/* ... and this is how we connected to it */
 extern int		primary;		/* Non-zero for primary logger */
 extern int		rflag;
 extern struct timeval	delta;			/* default logging interval */
+extern struct timeval	index_delta;		/* temporal index entry interval */
 extern int		ctlport;		/* pmlogger control port number */
 extern char		*note;			/* note for port map file */
 
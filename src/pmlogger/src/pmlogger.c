@@ -67,8 +67,10 @@ int		notify_service_mgr = 0;	/* notify service manager when we're ready (daemon
 int		pmlogger_reexec = 0;	/* set when PMLOGGER_REEXEC is set in the environment */
 int		rflag;			/* report sizes */
 int		Cflag;			/* parse config and exit */
+int		eflag;			/* delta encode data records */
 struct timeval	epoch;
 struct timeval	delta = { 60, 0 };	/* default logging interval */
+struct timeval	index_delta;		/* temporal index entry interval, if any */
 int		sig_code;		/* caught signal */
 int		qa_case;		/* QA error injection state */
 char		*note;			/* note for port map file */
@@ -568,8 +570,10 @@ static pmLongOptions longopts[] = {
     { "config", 1, 'c', "FILE", "file to load configuration from" },
     { "check", 0, 'C', 0, "parse configuration and exit" },
     PMOPT_DEBUG,
+    { "delta", 0, 'e', 0, "delta encode data records (requires -V 3)" },
     PMOPT_HOST,
     { "labelhost", 1, 'H', "LABELHOST", "override the hostname written into the label" },
+    { "index", 1, 'I', "DELTA", "write a temporal index entry at least this often" },
     { "log", 1, 'l', "FILE", "redirect diagnostics and trace output" },
     { "linger", 0, 'L', 0, "run even if not primary logger instance and nothing to log" },
     { "note", 1, 'm', "MSG", "descriptive note to be added to the port map file" },
@@ -598,7 +602,7 @@ static pmLongOptions longopts[] = {
 };
 
 static pmOptions opts = {
-    .short_options = "c:CD:fh:H:l:K:Lm:Nn:op:Prs:T:t:uU:v:V:x:y?",
+    .short_options = "c:CD:efh:H:I:l:K:Lm:Nn:op:Prs:T:t:uU:v:V:x:y?",
     .long_options = longopts,
     .short_usage = "[options] archive",
 };
@@ -840,6 +844,10 @@ main(int argc, char **argv)
 	    }
 	    break;
 
+	case 'e':		/* delta encode data records */
+	    eflag = 1;
+	    break;
+
 	case 'h':		/* hostname for PMCD to contact */
 	    pmcd_host_conn = opts.optarg;
 	    break;
@@ -848,6 +856,14 @@ main(int argc, char **argv)
 	    pmcd_host_label = strndup(opts.optarg, PM_LOG_MAXHOSTLEN-1);
 	    break;
 
+	case 'I':		/* temporal index interval */
+	    if (pmParseInterval(opts.optarg, &index_delta, &p) < 0) {
+		pmprintf("%s: illegal -I argument\n%s", pmGetProgname(), p);
+		free(p);
+		opts.errors++;
+	    }
+	    break;
+
 	case 'l':		/* log file name */
 	    logfile = opts.optarg;
 	    break;
@@ -1003,6 +1019,12 @@ main(int argc, char **argv)
 	}
     }
 
+    if (eflag && archive_version != PM_LOG_VERS03) {
+	pmprintf("%s: -e requires a version %d archive (-V %d)\n",
+		pmGetProgname(), PM_LOG_VERS03, PM_LOG_VERS03);
+	opts.errors++;
+    }
+
     if (pmcd_host_conn != NULL && primary) {
 	pmprintf(
 	    "%s: -P and -h are mutually exclusive; use -P only when running\n"
@@ -1128,7 +1150,12 @@ main(int argc, char **argv)
 	pmcd_host_conn = "local:";
 
     if (pmDebugOptions.appl4) fprintf(stderr, "@pmNewContext\n");
-    if ((ctx = pmNewContext(host_context, pmcd_host_conn)) < 0) {
+    /* results from pmcd are decoded into one allocation per fetch */
+    if (host_context == PM_CONTEXT_HOST)
+	ctx = pmNewContext(host_context | PM_CTXFLAG_ARENA, pmcd_host_conn);
+    else
+	ctx = pmNewContext(host_context, pmcd_host_conn);
+    if (ctx < 0) {
 	fprintf(stderr, "%s: Cannot connect to PMCD on host \"%s\": %s\n", pmGetProgname(), pmcd_host_conn, pmErrStr(ctx));
 	exit(1);
     }
@@ -1259,6 +1286,8 @@ main(int argc, char **argv)
 	fprintf(stderr, "__pmLogCreate(%s, %s, ...): %s\n", pmcd_host, archName, pmErrStr(sts));
 	exit(1);
     }
+    if (eflag)
+	archctl.ac_log->label.features |= PM_LOG_FEATURE_DELTA;
 
     /*
      * try and establish $TZ from the remote PMCD ...
@@ -64,6 +64,7 @@ char		*Aarg;			/* -A arg - output time alignment */
 int		varg = -1;		/* -v arg - switch log vol every X */
 int		zarg;			/* -z arg - use archive timezone */
 char		*tz;			/* -Z arg - use timezone from user */
+int		jarg = -1;		/* -j arg - read ahead thread */
 
 int	        written;		/* num log writes so far */
 int		exit_status;
@@ -89,6 +90,7 @@ static pmLongOptions longopts[] = {
     PMOPT_START,
     PMOPT_SAMPLES,
     PMOPT_FINISH,
+    { "threads", 1, 'j', "N", "read input archive ahead in a thread, unless N is 0" },
     { "interval", 1, 't', "DELTA", "sample output interval [default 10min]" },
     { "", 1, 'v', "NUM", "switch log volumes after this many samples" },
     PMOPT_TIMEZONE,
@@ -98,7 +100,7 @@ static pmLongOptions longopts[] = {
 };
 
 static pmOptions opts = {
-    .short_options = "A:D:S:s:T:t:v:Z:z?",
+    .short_options = "A:D:j:S:s:T:t:v:Z:z?",
     .long_options = longopts,
     .short_usage = "[options] input-archive output-archive",
 };
@@ -128,6 +130,15 @@ parseargs(int argc, char *argv[])
 	    }
 	    break;
 
+	case 'j':	/* read ahead thread */
+	    jarg = (int)strtol(opts.optarg, &endnum, 10);
+	    if (*endnum != '\0' || jarg < 0) {
+		pmprintf("%s: -j requires numeric argument\n",
+			pmGetProgname());
+		opts.errors++;
+	    }
+	    break;
+
 	case 's':	/* number of samples to write out */
 	    sarg = (int)strtol(opts.optarg, &endnum, 10);
 	    if (*endnum != '\0' || sarg < 0) {
@@ -70,6 +70,7 @@ extern char		*Aarg;		/* -A arg - output time alignment */
 extern int		varg;		/* -v arg - switch log vol every X */
 extern int		zarg;		/* -z arg - use archive timezone */
 extern char		*tz;		/* -Z arg - use timezone from user */
+extern int		jarg;		/* -j arg - read ahead thread */
 
 
 extern int	_pmLogGet(__pmLogCtl *, int, __pmPDU **);
@@ -2,6 +2,8 @@
 
 static struct timeval	last_tv = { 0, 0 };
 static int		ictx_b = -1;
+static __pmLogPipe	*pipe_b;	/* records from ictx_b, in order */
+static pmResult		*next_rp;	/* first record past the last interval */
 
 extern struct timeval	winstart_tval;
 
@@ -26,14 +28,22 @@ extern struct timeval	winstart_tval;
  *
  * 5. all of the above has to be done in a way that makes sense in the
  *    presence of mark records
+ *
+ * The records come from a __pmLogPipe, so they are read ahead by another
+ * thread (unless -j 0) while the interpolated pmFetch() and rewriting
+ * for the previous interval are done here.  The record that ends one
+ * interval starts the next one, rather than repositioning the archive
+ * to its timestamp.
  */
 
 void
 doscan(struct timeval *end)
 {
+    __pmContext		*ctxp;
+    __pmLogPipeRec	rec;
     pmResult		*rp;
     value_t		*vp;
-    int			sts;
+    int			sts = 0;
     int			i;
     int			ir;
     int			nr;
@@ -49,17 +59,23 @@ doscan(struct timeval *end)
 	    exit(1);
 	}
 
-	if ((sts = pmSetMode(PM_MODE_FORW, NULL, 0)) < 0) {
-	    fprintf(stderr,
-		"%s: Error: pmSetMode (ictx_b) failed: %s\n", pmGetProgname(), pmErrStr(sts));
+	if ((ctxp = __pmHandleToPtr(ictx_b)) == NULL) {
+	    fprintf(stderr, "%s: Error: botch: __pmHandleToPtr(%d) returns NULL!\n",
+		    pmGetProgname(), ictx_b);
 	    exit(1);
 	}
-    }
+	/* the pipeline locks the context as required */
+	PM_UNLOCK(ctxp->c_lock);
 
-    if ((sts = pmUseContext(ictx_b)) < 0) {
-	fprintf(stderr, "%s: doscan: Error: cannot use context: %s\n",
-		pmGetProgname(), pmErrStr(sts));
-	exit(1);
+	if (jarg < 0) {
+	    /* read ahead by default, unless there is only one CPU */
+	    jarg = (int)sysconf(_SC_NPROCESSORS_ONLN) > 1;
+	}
+	if ((sts = __pmLogPipeStart(ctxp, jarg, 0, NULL, NULL, &pipe_b)) < 0) {
+	    fprintf(stderr,
+		"%s: Error: __pmLogPipeStart (ictx_b) failed: %s\n", pmGetProgname(), pmErrStr(sts));
+	    exit(1);
+	}
     }
 
     for (i = 0; i < numpmid; i++) {
@@ -71,12 +87,19 @@ doscan(struct timeval *end)
 
     for (nr = 0; ; nr++) {
 
-	if ((sts = pmFetchArchive(&rp)) < 0) {
-	    if (sts == PM_ERR_EOL)
-		break;
-	    fprintf(stderr,
-		"%s: doscan: Error: pmFetch failed: %s\n", pmGetProgname(), pmErrStr(sts));
-	    exit(1);
+	if (next_rp != NULL) {
+	    rp = next_rp;
+	    next_rp = NULL;
+	}
+	else {
+	    if ((sts = __pmLogPipeNext(pipe_b, &rec)) < 0) {
+		if (sts == PM_ERR_EOL)
+		    break;
+		fprintf(stderr,
+		    "%s: doscan: Error: __pmLogPipeNext failed: %s\n", pmGetProgname(), pmErrStr(sts));
+		exit(1);
+	    }
+	    rp = rec.rp;
 	}
 	if (pmDebugOptions.appl2) {
 	    if (nr == 0) {
@@ -125,11 +148,11 @@ doscan(struct timeval *end)
 	    (rp->timestamp.tv_sec == end->tv_sec &&
 	     rp->timestamp.tv_usec > end->tv_usec)) {
 	    /*
-	     * past the end of the interval, remember timestamp so we
+	     * past the end of the interval, keep the record so we
 	     * can resume here next time
 	     */
 	    last_tv = rp->timestamp;	/* struct assignment */
-	    pmFreeResult(rp);
+	    next_rp = rp;
 	    break;
 	}
 
@@ -212,13 +235,4 @@ doscan(struct timeval *end)
 	    fprintf(stderr, " [EOL]");
 	fprintf(stderr, " (%d records)\n", nr);
     }
-
-    if ((sts = pmSetMode(PM_MODE_FORW, &last_tv, 0)) < 0) {
-	fprintf(stderr,
-	    "%s: doscan: Error: pmSetMode (ictx_b) time=", pmGetProgname());
-	pmPrintStamp(stderr, &last_tv);
-	fprintf(stderr,
-	    " failed: %s\n", pmErrStr(sts));
-	exit(1);
-    }
 }
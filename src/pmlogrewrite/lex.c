@@ -0,0 +1,225 @@
+/* hand written stand-in for the flex scanner, local testing only */
+#include "pmapi.h"
+#include "libpcp.h"
+#include "logger.h"
+#include <errno.h>
+#include <regex.h>
+char mess[256];
+#include "gram.tab.h"
+FILE *yyin;
+char *yytext;
+
+enum { S_INITIAL, S_none, S_glob, S_host, S_indom, S_metric, S_text, S_label, S_type, S_iftype, S_sem, S_units, S_space, S_time, S_count, S_output, S_ANY };
+#define LEX_NONE 0
+#define LEX_GLOBAL 1
+#define LEX_INDOM 2
+#define LEX_METRIC 3
+#define LEX_TEXT 4
+#define LEX_LABEL 5
+static int mystate = LEX_NONE;
+static int state = S_INITIAL;
+static int comma_count;
+
+static char *dupstr(char *s, int strip)
+{
+    char *p = strdup(strip ? &s[1] : s);
+    if (strip) p[strlen(p)-1] = '\0';
+    return p;
+}
+static char *duptextstr(char *s, int strip)
+{
+    const char *p; char *q;
+    s = dupstr(s, strip); q = s;
+    for (p = s; *p; ++p) { if (p[0] == '\\' && p[1]) ++p; if (p != q) *q = *p; ++q; }
+    *q = '\0';
+    return s;
+}
+
+typedef struct { int st; const char *re; int id; regex_t rx; } rule_t;
+static rule_t rules[] = {
+ {S_INITIAL,"global",1},{S_INITIAL,"metric",2},{S_INITIAL,"indom",3},{S_INITIAL,"text",4},{S_INITIAL,"label",5},
+ {S_glob,"hostname",10},{S_glob,"time",11},{S_glob,"tz",12},
+ {S_host,"[A-Za-z0-9][A-Za-z0-9.-]*",13},
+ {-1,"delete",20},
+ {S_indom,"indom",21},{S_indom,"duplicate",22},{S_indom,"iname",23},{S_indom,"inst",24},
+ {S_metric,"name",30},{S_metric,"pmid",31},{S_metric,"type",32},{S_metric,"indom",33},{S_metric,"NULL",34},{S_metric,"output",35},{S_metric,"sem",36},{S_metric,"units",37},
+ {S_text,"metric",40},{S_text,"indom",41},{S_text,"oneline",42},{S_text,"help",43},{S_text,"text",44},{S_text,"\\*",45},
+ {S_label,"context",50},{S_label,"domain",51},{S_label,"cluster",52},{S_label,"item",53},{S_label,"indom",54},{S_label,"instances",55},{S_label,"instance",56},{S_label,"new",57},{S_label,"label",58},{S_label,"value",59},{S_label,"true",60},{S_label,"false",61},{S_label,"null",62},{S_label,"\\*",63},
+ {S_type,"32",70},{S_type,"U32",71},{S_type,"64",72},{S_type,"U64",73},{S_type,"FLOAT",74},{S_type,"DOUBLE",75},{S_type,"if",76},
+ {S_iftype,"32",80},{S_iftype,"U32",81},{S_iftype,"64",82},{S_iftype,"U64",83},{S_iftype,"FLOAT",84},{S_iftype,"DOUBLE",85},
+ {S_output,"first",90},{S_output,"last",91},{S_output,"min",92},{S_output,"max",93},{S_output,"sum",94},{S_output,"avg",95},{S_output,"inst",96},{S_output,"iname",97},
+ {S_sem,"COUNTER",100},{S_sem,"INSTANT",101},{S_sem,"DISCRETE",102},
+ {S_units,",",110},{S_metric,"rescale",111},
+ {S_space,"BYTE",120},{S_space,"KBYTE",121},{S_space,"MBYTE",122},{S_space,"GBYTE",123},{S_space,"TBYTE",124},{S_space,"PBYTE",125},{S_space,"EBYTE",126},{S_space,"0",127},
+ {S_time,"NSEC",130},{S_time,"USEC",131},{S_time,"MSEC",132},{S_time,"SEC",133},{S_time,"MIN",134},{S_time,"HOUR",135},{S_time,"0",136},
+ {S_count,"ONE",140},{S_count,"[0-9]+",141},
+ {S_ANY,"\"[^\"\n][^\"\n]*\"",150},
+ {S_ANY,"\"(\\\\\"|[^\"])+\"",151},
+ {S_ANY,"[0-9]+",152},
+ {S_ANY,"[0-9]+\\.[0-9]*",153},
+ {S_ANY,"[0-9]+\\.\\*",154},
+ {S_ANY,"[0-9]+\\.[0-9]+\\.[0-9]+",155},
+ {S_ANY,"[0-9]+\\.[0-9]+\\.\\*",156},
+ {S_ANY,"[0-9]+\\.\\*\\.\\*",157},
+ {S_ANY,"(0|[1-9][0-9]*)(\\.[0-9]+)?([eE][+-]?[0-9]+)?",158},
+ {S_ANY,"\"(\\\\[\"\\\\/bfnrt]|\\\\u[A-Fa-f0-9][A-Fa-f0-9][A-Fa-f0-9][A-Fa-f0-9]|[^\"\\\\\n])*\"",159},
+ {S_ANY,"[A-Za-z]([A-Za-z0-9_.]|([=-][A-Za-z0-9_.]))*",160},
+ {S_ANY,"#[^\n]*",161},
+ {S_ANY,"[ \t\r]+",162},
+ {S_ANY,"->",163},{S_ANY,"\\{",164},{S_ANY,"\\}",165},{S_ANY,"\\+",166},{S_ANY,"-",167},{S_ANY,":",168},{S_ANY,",",169},
+ {S_ANY,"\n",170},{S_ANY,"[^\n]",171},
+};
+#define NRULES (int)(sizeof(rules)/sizeof(rules[0]))
+static char *buf; static size_t pos, len; static int inited;
+
+int yylex(void)
+{
+    int i, best, bestlen, id;
+    regmatch_t m;
+    if (!inited) {
+	for (i = 0; i < NRULES; i++) {
+	    char re[512]; snprintf(re, sizeof(re), "^(%s)", rules[i].re);
+	    if (regcomp(&rules[i].rx, re, REG_EXTENDED|REG_ICASE) != 0) { fprintf(stderr, "bad re %s\n", re); exit(1); }
+	}
+	inited = 1;
+    }
+    if (buf == NULL) {
+	size_t cap = 4096; int c;
+	buf = malloc(cap); len = pos = 0;
+	while ((c = fgetc(yyin)) != EOF) { if (len+2 > cap) buf = realloc(buf, cap *= 2); buf[len++] = c; }
+	buf[len] = 0;
+    }
+    for (;;) {
+	if (pos >= len) { free(buf); buf = NULL; return 0; }
+	best = -1; bestlen = 0;
+	for (i = 0; i < NRULES; i++) {
+	    if (rules[i].st == S_ANY || rules[i].st == state || (rules[i].st == -1 && (state == S_indom || state == S_metric || state == S_text || state == S_label))) {
+		if (regexec(&rules[i].rx, buf+pos, 1, &m, 0) == 0 && m.rm_eo > bestlen) { best = i; bestlen = m.rm_eo; }
+	    }
+	}
+	free(yytext);
+	yytext = strndup(buf+pos, bestlen);
+	pos += bestlen;
+	id = rules[best].id;
+	switch (id) {
+	case 1: mystate = LEX_GLOBAL; return TOK_GLOBAL;
+	case 2: mystate = LEX_METRIC; return TOK_METRIC;
+	case 3: mystate = LEX_INDOM; return TOK_INDOM;
+	case 4: mystate = LEX_TEXT; state = S_text; return TOK_TEXT;
+	case 5: mystate = LEX_LABEL; state = S_label; return TOK_LABEL;
+	case 10: state = S_host; return TOK_HOSTNAME;
+	case 11: return TOK_TIME;
+	case 12: return TOK_TZ;
+	case 13: yylval.str = dupstr(yytext, 0); state = S_glob; return TOK_HNAME;
+	case 20: return TOK_DELETE;
+	case 21: return TOK_INDOM;
+	case 22: return TOK_DUPLICATE;
+	case 23: return TOK_INAME;
+	case 24: return TOK_INST;
+	case 30: return TOK_NAME;
+	case 31: return TOK_PMID;
+	case 32: state = S_type; return TOK_TYPE;
+	case 33: return TOK_INDOM;
+	case 34: return TOK_NULL_INT;
+	case 35: state = S_output; return TOK_OUTPUT;
+	case 36: state = S_sem; return TOK_SEM;
+	case 37: state = S_units; comma_count = 0; return TOK_UNITS;
+	case 40: return TOK_METRIC;
+	case 41: return TOK_INDOM;
+	case 42: return TOK_ONELINE;
+	case 43: return TOK_HELP;
+	case 44: return TOK_TEXT;
+	case 45: return TOK_TEXT_STAR;
+	case 50: return TOK_CONTEXT;
+	case 51: return TOK_DOMAIN;
+	case 52: return TOK_CLUSTER;
+	case 53: return TOK_ITEM;
+	case 54: return TOK_INDOM;
+	case 55: return TOK_INSTANCES;
+	case 56: return TOK_INSTANCE;
+	case 57: return TOK_NEW;
+	case 58: return TOK_LABEL;
+	case 59: return TOK_VALUE;
+	case 60: yylval.str = dupstr(yytext, 0); return TOK_JSON_TRUE;
+	case 61: yylval.str = dupstr(yytext, 0); return TOK_JSON_FALSE;
+	case 62: yylval.str = dupstr(yytext, 0); return TOK_JSON_NULL;
+	case 63: return TOK_LABEL_STAR;
+	case 70: yylval.ival = PM_TYPE_32; state = S_metric; return TOK_TYPE_NAME;
+	case 71: yylval.ival = PM_TYPE_U32; state = S_metric; return TOK_TYPE_NAME;
+	case 72: yylval.ival = PM_TYPE_64; state = S_metric; return TOK_TYPE_NAME;
+	case 73: yylval.ival = PM_TYPE_U64; state = S_metric; return TOK_TYPE_NAME;
+	case 74: yylval.ival = PM_TYPE_FLOAT; state = S_metric; return TOK_TYPE_NAME;
+	case 75: yylval.ival = PM_TYPE_DOUBLE; state = S_metric; return TOK_TYPE_NAME;
+	case 76: state = S_iftype; return TOK_IF;
+	case 80: yylval.ival = PM_TYPE_32; state = S_type; return TOK_TYPE_NAME;
+	case 81: yylval.ival = PM_TYPE_U32; state = S_type; return TOK_TYPE_NAME;
+	case 82: yylval.ival = PM_TYPE_64; state = S_type; return TOK_TYPE_NAME;
+	case 83: yylval.ival = PM_TYPE_U64; state = S_type; return TOK_TYPE_NAME;
+	case 84: yylval.ival = PM_TYPE_FLOAT; state = S_type; return TOK_TYPE_NAME;
+	case 85: yylval.ival = PM_TYPE_DOUBLE; state = S_type; return TOK_TYPE_NAME;
+	case 90: yylval.ival = OUTPUT_FIRST; state = S_metric; return TOK_OUTPUT_TYPE;
+	case 91: yylval.ival = OUTPUT_LAST; state = S_metric; return TOK_OUTPUT_TYPE;
+	case 92: yylval.ival = OUTPUT_MIN; state = S_metric; return TOK_OUTPUT_TYPE;
+	case 93: yylval.ival = OUTPUT_MAX; state = S_metric; return TOK_OUTPUT_TYPE;
+	case 94: yylval.ival = OUTPUT_SUM; state = S_metric; return TOK_OUTPUT_TYPE;
+	case 95: yylval.ival = OUTPUT_AVG; state = S_metric; return TOK_OUTPUT_TYPE;
+	case 96: state = S_metric; return TOK_INST;
+	case 97: state = S_metric; return TOK_INAME;
+	case 100: yylval.ival = PM_SEM_COUNTER; state = S_metric; return TOK_SEM_NAME;
+	case 101: yylval.ival = PM_SEM_INSTANT; state = S_metric; return TOK_SEM_NAME;
+	case 102: yylval.ival = PM_SEM_DISCRETE; state = S_metric; return TOK_SEM_NAME;
+	case 110:
+	    ++comma_count;
+	    if (comma_count == 3) state = S_space;
+	    else if (comma_count == 4) state = S_time;
+	    else if (comma_count == 5) state = S_count;
+	    return TOK_COMMA;
+	case 111: return TOK_RESCALE;
+	case 120: yylval.ival = PM_SPACE_BYTE; state = S_units; return TOK_SPACE_NAME;
+	case 121: yylval.ival = PM_SPACE_KBYTE; state = S_units; return TOK_SPACE_NAME;
+	case 122: yylval.ival = PM_SPACE_MBYTE; state = S_units; return TOK_SPACE_NAME;
+	case 123: yylval.ival = PM_SPACE_GBYTE; state = S_units; return TOK_SPACE_NAME;
+	case 124: yylval.ival = PM_SPACE_TBYTE; state = S_units; return TOK_SPACE_NAME;
+	case 125: yylval.ival = PM_SPACE_PBYTE; state = S_units; return TOK_SPACE_NAME;
+	case 126: yylval.ival = PM_SPACE_EBYTE; state = S_units; return TOK_SPACE_NAME;
+	case 127: yylval.ival = 0; state = S_units; return TOK_SPACE_NAME;
+	case 130: yylval.ival = PM_TIME_NSEC; state = S_units; return TOK_TIME_NAME;
+	case 131: yylval.ival = PM_TIME_USEC; state = S_units; return TOK_TIME_NAME;
+	case 132: yylval.ival = PM_TIME_MSEC; state = S_units; return TOK_TIME_NAME;
+	case 133: yylval.ival = PM_TIME_SEC; state = S_units; return TOK_TIME_NAME;
+	case 134: yylval.ival = PM_TIME_MIN; state = S_units; return TOK_TIME_NAME;
+	case 135: yylval.ival = PM_TIME_HOUR; state = S_units; return TOK_TIME_NAME;
+	case 136: yylval.ival = 0; state = S_units; return TOK_TIME_NAME;
+	case 140: yylval.ival = PM_COUNT_ONE; state = S_metric; return TOK_COUNT_NAME;
+	case 141: yylval.ival = atoi(yytext); state = S_metric; return TOK_COUNT_NAME;
+	case 150: yylval.str = dupstr(yytext, 1); return TOK_STRING;
+	case 151: yylval.str = duptextstr(yytext, 1); return TOK_TEXT_STRING;
+	case 152: yylval.str = dupstr(yytext, 0); return TOK_NUMBER;
+	case 153: yylval.str = dupstr(yytext, 0); return TOK_FLOAT;
+	case 154: yylval.str = dupstr(yytext, 0); return TOK_INDOM_STAR;
+	case 155: yylval.str = dupstr(yytext, 0); return TOK_PMID_INT;
+	case 156: case 157: yylval.str = dupstr(yytext, 0); return TOK_PMID_STAR;
+	case 158: yylval.str = dupstr(yytext, 0); return TOK_JSON_NUMBER;
+	case 159: yylval.str = dupstr(yytext, 0); return TOK_JSON_STRING;
+	case 160: yylval.str = dupstr(yytext, 0); return TOK_GNAME;
+	case 161: case 162: continue;
+	case 163: return TOK_ASSIGN;
+	case 164:
+	    if (mystate == LEX_GLOBAL) state = S_glob;
+	    if (mystate == LEX_INDOM) state = S_indom;
+	    if (mystate == LEX_METRIC) state = S_metric;
+	    return TOK_LBRACE;
+	case 165: mystate = LEX_NONE; state = S_INITIAL; return TOK_RBRACE;
+	case 166: return TOK_PLUS;
+	case 167: return TOK_MINUS;
+	case 168: return TOK_COLON;
+	case 169: return TOK_COMMA;
+	case 170: lineno++; continue;
+	default:
+	    pmsprintf(mess, sizeof(mess), "Unexpected character '%c'", yytext[0]);
+	    yyerror(mess);
+	    continue;
+	}
+    }
+}
+int yywrap(void) { return 1; }
@@ -160,6 +160,12 @@ typedef struct labelspec {
 
 extern labelspec_t	*label_root;
 
+/* pmResult rewritten by rewrite_result(), waiting for do_result() */
+typedef struct {
+    __pmPDU	*pdu;		/* encoded, NULL if nothing to write */
+    int		numpmid;	/* metrics in the rewritten pmResult */
+} outrec_t;
+
 /*
  *  Input archive control
  */
@@ -169,8 +175,11 @@ typedef struct {
     char	*name;
     pmLogLabel	label;
     __int32_t	*metarec;
-    __int32_t	*logrec;
+    __pmLogPipe	*pipe;		/* data records, rewritten in parallel */
     pmResult	*rp;
+    outrec_t	*outrec;	/* rewritten rp, from rewrite_result() */
+    int		vol;		/* input volume holding rp */
+    long	offset;		/* of rp in that volume */
     int		mark;		/* need EOL marker */
 } inarch_t;
 
@@ -233,12 +242,14 @@ extern char	*SemStr(int);
 extern char	*add_quotes(const char *);
 extern char	*dupcat(const char *, const char *);
 extern void	newvolume(int);
+extern int	fixstamp(__pmTimestamp *);
 
 extern void	do_desc(void);
 extern void	do_indom(void);
 extern void	do_labelset(void);
 extern void	do_text(void);
-extern void	do_result(void);
+extern int	rewrite_result(__pmLogPipeRec *, void *);
+extern void	do_result(pmResult *, outrec_t *);
 
 extern void	abandon(void);
 
@@ -46,9 +46,12 @@ static pmLongOptions longopts[] = {
     { "config", 1, 'c', "PATH", "file or directory to load rules from" },
     { "check", 0, 'C', 0, "parse config file(s) and quit (verbose warnings also)" },
     { "desperate", 0, 'd', 0, "desperate, save output archive even after error" },
+    { "delta", 0, 'e', 0, "delta encode data records (V3 output archive)" },
     { "", 0, 'i', 0, "rewrite in place, input-archive will be over-written" },
+    { "index", 1, 'I', "DELTA", "add temporal index entries at least this often" },
     { "quick", 0, 'q', 0, "quick mode, no output if no change" },
     { "scale", 0, 's', 0, "do scale conversion" },
+    { "threads", 1, 'j', "N", "rewrite data records with N worker threads" },
     { "verbose", 0, 'v', 0, "increased diagnostic verbosity" },
     { "warnings", 0, 'w', 0, "emit warnings [default is silence]" },
     PMOPT_HELP,
@@ -58,7 +61,7 @@ static pmLongOptions longopts[] = {
 };
 
 static pmOptions opts = {
-    .short_options = "c:CdD:iqsvw?",
+    .short_options = "c:CdD:eiI:j:qsvw?",
     .long_options = longopts,
     .short_usage = "[options] input-archive [output-archive]",
 };
@@ -84,11 +87,14 @@ char	**conf;				/* list of config files */
 char	*configfile;			/* current config file */
 int	Cflag;				/* -C parse config and quit */
 int	dflag;				/* -d desperate */
+int	eflag;				/* -e delta encode data records */
 int	iflag;				/* -i in-place */
 int	qflag;				/* -q quick or quiet */
 int	sflag;				/* -s scale values */
 int	vflag;				/* -v verbosity */
 int	wflag;				/* -w emit warnings */
+int	nworker = -1;			/* -j worker threads */
+struct timeval	index_delta;		/* -I temporal index interval */
 
 /*
  *  report that archive is corrupted
@@ -152,8 +158,10 @@ newlabel(void)
 {
     __pmLogLabel	*lp = &outarch.logctl.label;
 
-    /* copy magic number, pid, host and timezone */
+    /* copy magic number (V3 for -e), pid, host and timezone */
     lp->magic = inarch.label.ll_magic;
+    if (eflag)
+	lp->magic = PM_LOG_MAGIC | PM_LOG_VERS03;
     lp->pid = inarch.label.ll_pid;
     if (lp->hostname)
 	free(lp->hostname);
@@ -168,6 +176,11 @@ newlabel(void)
     if (lp->zoneinfo)
 	free(lp->zoneinfo);
     lp->zoneinfo = NULL;
+
+    /* preserve archive features, and -e adds delta encoding */
+    lp->features = inarch.ctxp->c_archctl->ac_log->label.features;
+    if (eflag)
+	lp->features |= PM_LOG_FEATURE_DELTA;
 }
 
 /*
@@ -245,12 +258,24 @@ static int
 nextlog(void)
 {
     __pmArchCtl		*acp = inarch.ctxp->c_archctl;
+    __pmLogPipeRec	rec;
     int			sts;
     int			old_vol;
 
-    old_vol = inarch.ctxp->c_archctl->ac_curvol;
+    old_vol = inarch.vol;
 
-    sts = __pmLogRead_ctx(inarch.ctxp, PM_MODE_FORW, NULL, &inarch.rp, PMLOGREAD_NEXT);
+    sts = __pmLogPipeNext(inarch.pipe, &rec);
+    inarch.offset = rec.offset;
+    if (sts < 0 && rec.rp != NULL) {
+	/*
+	 * read, but rewrite_result() failed ... workers keep quiet, so
+	 * rewrite this record again to report the error from here
+	 */
+	if (nworker > 0)
+	    rewrite_result(&rec, NULL);
+	abandon();
+	/*NOTREACHED*/
+    }
     if (sts < 0) {
 	if (sts != PM_ERR_EOL) {
 	    fprintf(stderr, "%s: Error: __pmLogRead[log %s]: %s\n",
@@ -259,8 +284,11 @@ nextlog(void)
 	}
 	return -1;
     }
+    inarch.rp = rec.rp;
+    inarch.outrec = (outrec_t *)rec.data;
+    inarch.vol = rec.vol;
 
-    return old_vol == acp->ac_curvol ? 0 : 1;
+    return old_vol == inarch.vol ? 0 : 1;
 }
 
 #ifdef IS_MINGW
@@ -281,6 +309,8 @@ parseargs(int argc, char *argv[])
     int			sts;
     int			sep = pmPathSeparator();
     char		**cp;
+    char		*endnum;
+    char		*msg;
     struct stat		sbuf;
 
     while ((c = pmgetopt_r(argc, argv, &opts)) != EOF) {
@@ -360,10 +390,35 @@ parseargs(int argc, char *argv[])
 	    }
 	    break;
 
+	case 'e':	/* delta encode data records */
+#ifdef __PCP_EXPERIMENTAL_ARCHIVE_VERSION3
+	    eflag = 1;
+#else
+	    pmprintf("%s: -e requires V3 archive support\n", pmGetProgname());
+	    opts.errors++;
+#endif
+	    break;
+
 	case 'i':	/* in-place, over-write input archive */
 	    iflag = 1;
 	    break;
 
+	case 'I':	/* temporal index interval */
+	    if (pmParseInterval(opts.optarg, &index_delta, &msg) < 0) {
+		pmprintf("%s: illegal -I argument\n%s", pmGetProgname(), msg);
+		free(msg);
+		opts.errors++;
+	    }
+	    break;
+
+	case 'j':	/* number of worker threads */
+	    nworker = (int)strtol(opts.optarg, &endnum, 10);
+	    if (*endnum != '\0' || nworker < 0) {
+		pmprintf("%s: -j requires numeric argument\n", pmGetProgname());
+		opts.errors++;
+	    }
+	    break;
+
 	case 'q':	/* quick or quiet */
 	    qflag = 1;
 	    break;
@@ -833,7 +888,7 @@ anychange(void)
     return 0;
 }
 
-static int
+int
 fixstamp(__pmTimestamp *tsp)
 {
     if (global.flags & GLOBAL_CHANGE_TIME) {
@@ -843,11 +898,13 @@ fixstamp(__pmTimestamp *tsp)
 	}
 	else if (global.time.sec < 0) {
 	    /*
-	     * parser makes sec < 0 and nsec >= 0 ...
+	     * parser makes sec < 0 and nsec >= 0 ... and global is
+	     * not changed here, as the rewrite_result() workers call
+	     * this concurrently
 	     */
-	    global.time.sec = -global.time.sec;
-	    __pmTimestampDec(tsp, &global.time);
-	    global.time.sec = -global.time.sec;
+	    __pmTimestamp	delta = global.time;
+	    delta.sec = -delta.sec;
+	    __pmTimestampDec(tsp, &delta);
 	    return 1;
 	}
     }
@@ -1485,6 +1542,8 @@ main(int argc, char **argv)
     int		doneti = 0;
     int		in_version;
     __pmTimestamp	tstamp = { 0, 0 };	/* for last log record */
+    __pmTimestamp	last_ti = { 0, 0 };	/* for last temporal index entry */
+    double	ti_delta;
     off_t	old_log_offset = 0;	/* log offset before last log record */
     off_t	old_meta_offset;
     int		seen_event = 0;
@@ -1500,7 +1559,8 @@ main(int argc, char **argv)
 	inarch.name = argv[argc-2];
     else
 	inarch.name = argv[argc-1];
-    inarch.logrec = inarch.metarec = NULL;
+    inarch.metarec = NULL;
+    inarch.pipe = NULL;
     inarch.mark = 0;
     inarch.rp = NULL;
 
@@ -1672,7 +1732,8 @@ main(int argc, char **argv)
     if (Cflag)
 	exit(0);
 
-    if (qflag && anychange() == 0) {
+    if (qflag && anychange() == 0 && eflag == 0 &&
+	index_delta.tv_sec == 0 && index_delta.tv_usec == 0) {
 	if (pmDebugOptions.appl3) {
 	    fprintf(stderr, "Done, no rewriting required\n");
 	}
@@ -1681,7 +1742,8 @@ main(int argc, char **argv)
 
     /* create output log - must be done before writing label */
     outarch.archctl.ac_log = &outarch.logctl;
-    if ((sts = __pmLogCreate("", outarch.name, in_version, &outarch.archctl)) < 0) {
+    if ((sts = __pmLogCreate("", outarch.name,
+		eflag ? PM_LOG_VERS03 : in_version, &outarch.archctl)) < 0) {
 	fprintf(stderr, "%s: Error: __pmLogCreate(%s): %s\n",
 		pmGetProgname(), outarch.name, pmErrStr(sts));
 	/*
@@ -1699,6 +1761,28 @@ main(int argc, char **argv)
 
     first_datarec = 1;
     ti_idx = 0;
+    ti_delta = pmtimevalToReal(&index_delta);
+
+    /*
+     * data records are read ahead and rewritten by the pipeline workers,
+     * but come back here in order to be written out ... one worker per
+     * CPU by default, and none at all for a single CPU or -d where an
+     * error must truncate the output at exactly the failing record
+     */
+    if (nworker < 0) {
+	nworker = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nworker < 2)
+	    nworker = 0;
+    }
+    if (dflag)
+	nworker = 0;
+    inarch.vol = inarch.ctxp->c_archctl->ac_curvol;
+    if ((sts = __pmLogPipeStart(inarch.ctxp, nworker, 0, rewrite_result, &nworker, &inarch.pipe)) < 0) {
+	fprintf(stderr, "%s: Error: cannot start rewriting: %s\n",
+		pmGetProgname(), pmErrStr(sts));
+	abandon();
+	/*NOTREACHED*/
+    }
 
     /*
      * loop
@@ -1714,8 +1798,8 @@ main(int argc, char **argv)
 	old_meta_offset = __pmFtell(outarch.logctl.mdfp);
 	assert(old_meta_offset >= 0);
 
-	in_offset = __pmFtell(inarch.ctxp->c_archctl->ac_mfp);
 	stslog = nextlog();
+	in_offset = inarch.offset;
 	if (stslog < 0) {
 	    if (pmDebugOptions.appl0)
 		fprintf(stderr, "Log: read EOF @ offset=%ld\n", in_offset);
@@ -1723,9 +1807,9 @@ main(int argc, char **argv)
 	}
 	if (stslog == 1) {
 	    /* volume change */
-	    if (inarch.ctxp->c_archctl->ac_curvol >= outarch.archctl.ac_curvol+1)
+	    if (inarch.vol >= outarch.archctl.ac_curvol+1)
 		/* track input volume numbering */
-		newvolume(inarch.ctxp->c_archctl->ac_curvol);
+		newvolume(inarch.vol);
 	    else
 		/*
 		 * output archive volume number is ahead, probably because
@@ -1944,6 +2028,10 @@ main(int argc, char **argv)
 	tstamp.sec = inarch.rp->timestamp.tv_sec;
 	tstamp.nsec = inarch.rp->timestamp.tv_usec * 1000;
 
+	if (ti_delta > 0 && __pmTimestampSub(&tstamp, &last_ti) >= ti_delta)
+	    /* -I, denser temporal index than the input archive */
+	    needti = 1;
+
 	if (needti) {
 	    __pmFflush(outarch.logctl.mdfp);
 	    __pmFflush(outarch.archctl.ac_mfp);
@@ -1954,6 +2042,7 @@ main(int argc, char **argv)
             __pmFseek(outarch.logctl.mdfp, (long)new_meta_offset, SEEK_SET);
 	    needti = 0;
 	    doneti = 1;
+	    last_ti = tstamp;
         }
 	else
 	    doneti = 0;
@@ -1965,8 +2054,9 @@ main(int argc, char **argv)
 	    /* mark record, need index entry @ next log record */
 	    needti = 1;
 
-	do_result();
+	do_result(inarch.rp, inarch.outrec);
     }
+    __pmLogPipeStop(inarch.pipe);
 
     if (!doneti) {
 	/* Final temporal index entry */
@@ -37,6 +37,9 @@
  *   orig_numval[] to remember how many pmValue instances we had had for
  *   each pmValueSet, and use orig_numpmid to remember the original numpmid
  *   value
+ * - several pmResults are rewritten concurrently by the __pmLogPipe
+ *   workers, so save[] and friends are allocated for each pmResult and
+ *   the rewriting rules are only ever read here
  */
 
 #include "pmapi.h"
@@ -44,19 +47,15 @@
 #include "logger.h"
 #include <assert.h>
 
-/*
- * Keep track of pmValueSets that have been moved aside to allow for
- * new values from __pmStuffValue() during rewriting.
- */
-static pmValueSet	**save = NULL;
-static int		len_save = 0;
-
 /*
  * Save rp->vset[idx] in save[idx], and build a new rp->vset[idx]
- * for the number of values expected for this metric
+ * for the number of values expected for this metric ... save[] keeps
+ * track of pmValueSets that have been moved aside to allow for new
+ * values from __pmStuffValue() during rewriting.  Returns 1 if already
+ * saved, 0 if saved now, else a negative error code.
  */
 static int
-save_vset(pmResult *rp, int idx)
+save_vset(pmResult *rp, pmValueSet **save, int idx)
 {
     pmValueSet	*vsp;
     int		need;
@@ -75,8 +74,9 @@ save_vset(pmResult *rp, int idx)
     rp->vset[idx] = (pmValueSet *)malloc(need);
     if (rp->vset[idx] == NULL) {
 	fprintf(stderr, "save_vset: malloc(%d) failed: %s\n", need, strerror(errno));
-	abandon();
-	/*NOTREACHED*/
+	rp->vset[idx] = vsp;
+	save[idx] = NULL;
+	return -ENOMEM;
     }
     rp->vset[idx]->pmid = vsp->pmid;
     rp->vset[idx]->numval = vsp->numval;
@@ -108,7 +108,7 @@ free_pval(pmResult *rp, int i, int j)
  * pmValueSet and put the old one back in place
  */
 static void
-clean_vset(pmResult *rp)
+clean_vset(pmResult *rp, pmValueSet **save)
 {
     int		i;
     int		j;
@@ -141,18 +141,18 @@ clean_vset(pmResult *rp)
  *       so memcpy() rather than assign.
  */
 static int
-pick_val(int i, metricspec_t *mp)
+pick_val(pmResult *rp, int i, metricspec_t *mp)
 {
     int		j;
     int		pick = -1;
     pmAtomValue	jval;
     pmAtomValue	pickval;
 
-    assert(inarch.rp->vset[i]->numval > 0);
+    assert(rp->vset[i]->numval > 0);
 
-    for (j = 0; j < inarch.rp->vset[i]->numval; j++) {
+    for (j = 0; j < rp->vset[i]->numval; j++) {
 	if (mp->output == OUTPUT_ONE) {
-	    if (inarch.rp->vset[i]->vlist[j].inst == mp->one_inst) {
+	    if (rp->vset[i]->vlist[j].inst == mp->one_inst) {
 		pick = j;
 		break;
 	    }
@@ -162,16 +162,16 @@ pick_val(int i, metricspec_t *mp)
 	    pick = 0;
 	    switch (mp->old_desc.type) {
 		case PM_TYPE_64:
-		    memcpy(&pickval.ll, &inarch.rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(__int64_t));
+		    memcpy(&pickval.ll, &rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(__int64_t));
 		    break;
 		case PM_TYPE_U64:
-		    memcpy(&pickval.ull, &inarch.rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(__uint64_t));
+		    memcpy(&pickval.ull, &rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(__uint64_t));
 		    break;
 		case PM_TYPE_FLOAT:
-		    memcpy(&pickval.f, &inarch.rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(float));
+		    memcpy(&pickval.f, &rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(float));
 		    break;
 		case PM_TYPE_DOUBLE:
-		    memcpy(&pickval.d, &inarch.rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(double));
+		    memcpy(&pickval.d, &rp->vset[i]->vlist[0].value.pval->vbuf, sizeof(double));
 		    break;
 	    }
 	    if (mp->output == OUTPUT_MIN || mp->output == OUTPUT_MAX ||
@@ -182,37 +182,37 @@ pick_val(int i, metricspec_t *mp)
 	    case PM_TYPE_32:
 		switch (mp->output) {
 		    case OUTPUT_MIN:
-			if (inarch.rp->vset[i]->vlist[j].value.lval < inarch.rp->vset[i]->vlist[pick].value.lval)
+			if (rp->vset[i]->vlist[j].value.lval < rp->vset[i]->vlist[pick].value.lval)
 			    pick = j;
 			break;
 		    case OUTPUT_MAX:
-			if (inarch.rp->vset[i]->vlist[j].value.lval > inarch.rp->vset[i]->vlist[pick].value.lval)
+			if (rp->vset[i]->vlist[j].value.lval > rp->vset[i]->vlist[pick].value.lval)
 			    pick = j;
 			break;
 		    case OUTPUT_SUM:
 		    case OUTPUT_AVG:
-			inarch.rp->vset[i]->vlist[0].value.lval += inarch.rp->vset[i]->vlist[j].value.lval;
+			rp->vset[i]->vlist[0].value.lval += rp->vset[i]->vlist[j].value.lval;
 			break;
 		}
 		break;
 	    case PM_TYPE_U32:
 		switch (mp->output) {
 		    case OUTPUT_MIN:
-			if ((__uint32_t)inarch.rp->vset[i]->vlist[j].value.lval < (__uint32_t)inarch.rp->vset[i]->vlist[pick].value.lval)
+			if ((__uint32_t)rp->vset[i]->vlist[j].value.lval < (__uint32_t)rp->vset[i]->vlist[pick].value.lval)
 			    pick = j;
 			break;
 		    case OUTPUT_MAX:
-			if ((__uint32_t)inarch.rp->vset[i]->vlist[j].value.lval > (__uint32_t)inarch.rp->vset[i]->vlist[pick].value.lval)
+			if ((__uint32_t)rp->vset[i]->vlist[j].value.lval > (__uint32_t)rp->vset[i]->vlist[pick].value.lval)
 			    pick = j;
 			break;
 		    case OUTPUT_SUM:
 		    case OUTPUT_AVG:
-			*(__uint32_t *)&inarch.rp->vset[i]->vlist[0].value.lval += (__uint32_t)inarch.rp->vset[i]->vlist[j].value.lval;
+			*(__uint32_t *)&rp->vset[i]->vlist[0].value.lval += (__uint32_t)rp->vset[i]->vlist[j].value.lval;
 			break;
 		}
 		break;
 	    case PM_TYPE_64:
-		memcpy(&jval.ll, &inarch.rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(__int64_t));
+		memcpy(&jval.ll, &rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(__int64_t));
 		switch (mp->output) {
 		    case OUTPUT_MIN:
 			if (jval.ll < pickval.ll) {
@@ -233,7 +233,7 @@ pick_val(int i, metricspec_t *mp)
 		}
 		break;
 	    case PM_TYPE_U64:
-		memcpy(&jval.ull, &inarch.rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(__int64_t));
+		memcpy(&jval.ull, &rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(__int64_t));
 		switch (mp->output) {
 		    case OUTPUT_MIN:
 			if (jval.ull < pickval.ull) {
@@ -254,7 +254,7 @@ pick_val(int i, metricspec_t *mp)
 		}
 		break;
 	    case PM_TYPE_FLOAT:
-		memcpy(&jval.f, &inarch.rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(float));
+		memcpy(&jval.f, &rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(float));
 		switch (mp->output) {
 		    case OUTPUT_MIN:
 			if (jval.f < pickval.f) {
@@ -275,7 +275,7 @@ pick_val(int i, metricspec_t *mp)
 		}
 		break;
 	    case PM_TYPE_DOUBLE:
-		memcpy(&jval.d, &inarch.rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(double));
+		memcpy(&jval.d, &rp->vset[i]->vlist[j].value.pval->vbuf, sizeof(double));
 		switch (mp->output) {
 		    case OUTPUT_MIN:
 			if (jval.d < pickval.d) {
@@ -301,38 +301,38 @@ pick_val(int i, metricspec_t *mp)
     if (mp->output == OUTPUT_AVG) {
 	switch (mp->old_desc.type) {
 	    case PM_TYPE_32:
-		inarch.rp->vset[i]->vlist[0].value.lval = (int)(0.5 + inarch.rp->vset[i]->vlist[0].value.lval / (double)inarch.rp->vset[i]->numval);
+		rp->vset[i]->vlist[0].value.lval = (int)(0.5 + rp->vset[i]->vlist[0].value.lval / (double)rp->vset[i]->numval);
 		break;
 	    case PM_TYPE_U32:
-		*(__uint32_t *)&inarch.rp->vset[i]->vlist[0].value.lval = (__uint32_t)(0.5 + *(__uint32_t *)&inarch.rp->vset[i]->vlist[0].value.lval / (double)inarch.rp->vset[i]->numval);
+		*(__uint32_t *)&rp->vset[i]->vlist[0].value.lval = (__uint32_t)(0.5 + *(__uint32_t *)&rp->vset[i]->vlist[0].value.lval / (double)rp->vset[i]->numval);
 		break;
 	    case PM_TYPE_64:
-		pickval.ll = 0.5 + pickval.ll / (double)inarch.rp->vset[i]->numval;
+		pickval.ll = 0.5 + pickval.ll / (double)rp->vset[i]->numval;
 		break;
 	    case PM_TYPE_U64:
-		pickval.ull = 0.5 + pickval.ull / (double)inarch.rp->vset[i]->numval;
+		pickval.ull = 0.5 + pickval.ull / (double)rp->vset[i]->numval;
 		break;
 	    case PM_TYPE_FLOAT:
-		pickval.f = pickval.f / (float)inarch.rp->vset[i]->numval;
+		pickval.f = pickval.f / (float)rp->vset[i]->numval;
 		break;
 	    case PM_TYPE_DOUBLE:
-		pickval.d = pickval.d / (double)inarch.rp->vset[i]->numval;
+		pickval.d = pickval.d / (double)rp->vset[i]->numval;
 		break;
 	}
     }
     if (mp->output == OUTPUT_AVG || mp->output == OUTPUT_SUM) {
 	switch (mp->old_desc.type) {
 	    case PM_TYPE_64:
-		memcpy(&inarch.rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.ll, sizeof(__int64_t));
+		memcpy(&rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.ll, sizeof(__int64_t));
 		break;
 	    case PM_TYPE_U64:
-		memcpy(&inarch.rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.ull, sizeof(__uint64_t));
+		memcpy(&rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.ull, sizeof(__uint64_t));
 		break;
 	    case PM_TYPE_FLOAT:
-		memcpy(&inarch.rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.f, sizeof(float));
+		memcpy(&rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.f, sizeof(float));
 		break;
 	    case PM_TYPE_DOUBLE:
-		memcpy(&inarch.rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.d, sizeof(double));
+		memcpy(&rp->vset[i]->vlist[0].value.pval->vbuf, &pickval.d, sizeof(double));
 		break;
 	}
     }
@@ -343,35 +343,39 @@ pick_val(int i, metricspec_t *mp)
 /*
  * rescale values for the ith vset[]
  */
-static void
-rescale(int i, metricspec_t *mp)
+static int
+rescale(pmResult *rp, pmValueSet **save, int i, metricspec_t *mp, int quiet)
 {
     int		sts;
     int		j;
     pmAtomValue	ival;
     pmAtomValue	oval;
-    int		old_valfmt = inarch.rp->vset[i]->valfmt;
+    int		old_valfmt = rp->vset[i]->valfmt;
+    int		fmt = old_valfmt;	/* of the values rewritten so far */
     int		already_saved;
     pmValueSet	*vsp;
 
     sts = old_valfmt;
-    already_saved = save_vset(inarch.rp, i);
+    if ((already_saved = save_vset(rp, save, i)) < 0)
+	return already_saved;
     if (already_saved)
-	vsp = inarch.rp->vset[i];
+	vsp = rp->vset[i];
     else
 	vsp = save[i];
-    for (j = 0; j < inarch.rp->vset[i]->numval; j++) {
+    for (j = 0; j < rp->vset[i]->numval; j++) {
 	sts = pmExtractValue(old_valfmt, &vsp->vlist[j], mp->old_desc.type, &ival, mp->old_desc.type);
 	if (sts < 0) {
 	    /*
 	     * No type conversion here, so error not expected
 	     */
-	    fprintf(stderr, "%s: Botch: %s (%s): extracting value: %s\n",
-			pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmErrStr(sts));
-	    inarch.rp->vset[i]->numval = j;
-	    __pmDumpResult(stderr, inarch.rp);
-	    abandon();
-	    /*NOTREACHED*/
+	    rp->vset[i]->numval = j;
+	    rp->vset[i]->valfmt = fmt;
+	    if (!quiet) {
+		fprintf(stderr, "%s: Botch: %s (%s): extracting value: %s\n",
+				pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmErrStr(sts));
+		__pmDumpResult(stderr, rp);
+	    }
+	    return sts;
 	}
 	sts = pmConvScale(mp->old_desc.type, &ival, &mp->old_desc.units, &oval, &mp->new_desc.units);
 	if (sts < 0) {
@@ -380,13 +384,15 @@ rescale(int i, metricspec_t *mp)
 	     * make sure this does not happen) we do not expect errors
 	     * from pmConvScale()
 	     */
-	    fprintf(stderr, "%s: Botch: %s (%s): scale conversion from %s",
-			pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmUnitsStr(&mp->old_desc.units));
-	    fprintf(stderr, " to %s failed: %s\n", pmUnitsStr(&mp->new_desc.units), pmErrStr(sts));
-	    inarch.rp->vset[i]->numval = j;
-	    __pmDumpResult(stderr, inarch.rp);
-	    abandon();
-	    /*NOTREACHED*/
+	    rp->vset[i]->numval = j;
+	    rp->vset[i]->valfmt = fmt;
+	    if (!quiet) {
+		fprintf(stderr, "%s: Botch: %s (%s): scale conversion from %s",
+				pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmUnitsStr(&mp->old_desc.units));
+		fprintf(stderr, " to %s failed: %s\n", pmUnitsStr(&mp->new_desc.units), pmErrStr(sts));
+		__pmDumpResult(stderr, rp);
+	    }
+	    return sts;
 	}
 	if (already_saved && old_valfmt == PM_VAL_DPTR) {
 	    /*
@@ -396,28 +402,32 @@ rescale(int i, metricspec_t *mp)
 	     */
 	    if (pmDebugOptions.appl2) {
 		fprintf(stderr, "rescale free(" PRINTF_P_PFX "%p) pval pmid=%s inst=%d\n",
-		    inarch.rp->vset[i]->vlist[j].value.pval,
-		    pmIDStr(inarch.rp->vset[i]->pmid),
-		    inarch.rp->vset[i]->vlist[j].inst);
+		    rp->vset[i]->vlist[j].value.pval,
+		    pmIDStr(rp->vset[i]->pmid),
+		    rp->vset[i]->vlist[j].inst);
 	    }
-	    free(inarch.rp->vset[i]->vlist[j].value.pval);
+	    free(rp->vset[i]->vlist[j].value.pval);
 	}
-	sts = __pmStuffValue(&oval, &inarch.rp->vset[i]->vlist[j], mp->old_desc.type);
+	sts = __pmStuffValue(&oval, &rp->vset[i]->vlist[j], mp->old_desc.type);
 	if (sts < 0) {
 	    /*
 	     * unless "type" is bad (which the parser is supposed to
 	     * prevent) or malloc() failed, we do not expect errors from
 	     * __pmStuffValue()
 	     */
-	    fprintf(stderr, "%s: Botch: %s (%s): stuffing value %s (type=%s) into rewritten pmResult: %s\n",
-			pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmAtomStr(&oval, mp->old_desc.type), pmTypeStr(mp->old_desc.type), pmErrStr(sts));
-	    inarch.rp->vset[i]->numval = j;
-	    __pmDumpResult(stderr, inarch.rp);
-	    abandon();
-	    /*NOTREACHED*/
+	    rp->vset[i]->numval = j;
+	    rp->vset[i]->valfmt = fmt;
+	    if (!quiet) {
+		fprintf(stderr, "%s: Botch: %s (%s): stuffing value %s (type=%s) into rewritten pmResult: %s\n",
+				pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmAtomStr(&oval, mp->old_desc.type), pmTypeStr(mp->old_desc.type), pmErrStr(sts));
+		__pmDumpResult(stderr, rp);
+	    }
+	    return sts;
 	}
+	fmt = sts;
     }
-    inarch.rp->vset[i]->valfmt = sts;
+    rp->vset[i]->valfmt = sts;
+    return 0;
 }
 
 /*
@@ -425,32 +435,36 @@ rescale(int i, metricspec_t *mp)
  * fail, as some failure modes depend on the sign or size of the data
  * values found in the pmResult
  */
-static void
-retype(int i, metricspec_t *mp)
+static int
+retype(pmResult *rp, pmValueSet **save, int i, metricspec_t *mp, int quiet)
 {
     int		sts;
     int		j;
     pmAtomValue	val;
-    int		old_valfmt = inarch.rp->vset[i]->valfmt;
+    int		old_valfmt = rp->vset[i]->valfmt;
+    int		fmt = old_valfmt;	/* of the values rewritten so far */
     int		already_saved;
     pmValueSet	*vsp;
 
     sts = old_valfmt;
-    already_saved = save_vset(inarch.rp, i);
+    if ((already_saved = save_vset(rp, save, i)) < 0)
+	return already_saved;
     if (already_saved)
-	vsp = inarch.rp->vset[i];
+	vsp = rp->vset[i];
     else
 	vsp = save[i];
-    for (j = 0; j < inarch.rp->vset[i]->numval; j++) {
+    for (j = 0; j < rp->vset[i]->numval; j++) {
 	sts = pmExtractValue(old_valfmt, &vsp->vlist[j], mp->old_desc.type, &val, mp->new_desc.type);
 	if (sts < 0) {
-	    fprintf(stderr, "%s: Error: %s (%s): extracting value from type %s",
-			pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmTypeStr(mp->old_desc.type));
-	    fprintf(stderr, " to %s: %s\n", pmTypeStr(mp->new_desc.type), pmErrStr(sts));
-	    inarch.rp->vset[i]->numval = j;
-	    __pmDumpResult(stderr, inarch.rp);
-	    abandon();
-	    /*NOTREACHED*/
+	    rp->vset[i]->numval = j;
+	    rp->vset[i]->valfmt = fmt;
+	    if (!quiet) {
+		fprintf(stderr, "%s: Error: %s (%s): extracting value from type %s",
+				pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmTypeStr(mp->old_desc.type));
+		fprintf(stderr, " to %s: %s\n", pmTypeStr(mp->new_desc.type), pmErrStr(sts));
+		__pmDumpResult(stderr, rp);
+	    }
+	    return sts;
 	}
 	if (already_saved && old_valfmt == PM_VAL_DPTR) {
 	    /*
@@ -460,87 +474,130 @@ retype(int i, metricspec_t *mp)
 	     */
 	    if (pmDebugOptions.appl2) {
 		fprintf(stderr, "retype free(" PRINTF_P_PFX "%p) pval pmid=%s inst=%d\n",
-		    inarch.rp->vset[i]->vlist[j].value.pval,
-		    pmIDStr(inarch.rp->vset[i]->pmid),
-		    inarch.rp->vset[i]->vlist[j].inst);
+		    rp->vset[i]->vlist[j].value.pval,
+		    pmIDStr(rp->vset[i]->pmid),
+		    rp->vset[i]->vlist[j].inst);
 	    }
-	    free(inarch.rp->vset[i]->vlist[j].value.pval);
+	    free(rp->vset[i]->vlist[j].value.pval);
 	}
-	sts = __pmStuffValue(&val, &inarch.rp->vset[i]->vlist[j], mp->new_desc.type);
+	sts = __pmStuffValue(&val, &rp->vset[i]->vlist[j], mp->new_desc.type);
 	if (sts < 0) {
 	    /*
 	     * unless "type" is bad (which the parser is supposed to
 	     * prevent) or malloc() failed, we do not expect errors from
 	     * __pmStuffValue()
 	     */
-	    fprintf(stderr, "%s: Botch: %s (%s): stuffing value %s (type=%s) into rewritten pmResult: %s\n",
-			pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmAtomStr(&val, mp->new_desc.type), pmTypeStr(mp->new_desc.type), pmErrStr(sts));
-	    inarch.rp->vset[i]->numval = j;
-	    __pmDumpResult(stderr, inarch.rp);
-	    abandon();
-	    /*NOTREACHED*/
+	    rp->vset[i]->numval = j;
+	    rp->vset[i]->valfmt = fmt;
+	    if (!quiet) {
+		fprintf(stderr, "%s: Botch: %s (%s): stuffing value %s (type=%s) into rewritten pmResult: %s\n",
+				pmGetProgname(), mp->old_name, pmIDStr(mp->old_desc.pmid), pmAtomStr(&val, mp->new_desc.type), pmTypeStr(mp->new_desc.type), pmErrStr(sts));
+		__pmDumpResult(stderr, rp);
+	    }
+	    return sts;
 	}
+	fmt = sts;
     }
-    inarch.rp->vset[i]->valfmt = sts;
+    rp->vset[i]->valfmt = sts;
+    return 0;
 }
 
-void
-do_result(void)
+/*
+ * Rewrite one pmResult from the input archive, and encode the result
+ * ready for do_result() ... this is the transform for the __pmLogPipe
+ * workers, so several records may be rewritten at once.
+ *
+ * The pmResult is then put back the way it was, apart from the order
+ * of the vset[]s and the values within them, so the metadata can still
+ * be matched against the input pmIDs and timestamp.  This is done even
+ * when the rewriting fails, and the error is returned for the main
+ * thread to give up when it reaches this record.
+ *
+ * If arg is not NULL it points to an int, and if that is non-zero the
+ * errors are not reported here ... a worker may be running ahead of
+ * the failing record, and cannot find metric names for __pmDumpResult(),
+ * so the main thread calls us again for the failing record (with arg
+ * NULL) to report the error.
+ */
+int
+rewrite_result(__pmLogPipeRec *rec, void *arg)
 {
+    pmResult		*rp = rec->rp;
+    outrec_t		*orp;
     metricspec_t	*mp;
     int			i;
     int			j;
-    int			sts;
+    int			sts = 0;
     int			orig_numpmid;
     int			*orig_numval = NULL;
+    pmID		*orig_pmid = NULL;
+    pmValueSet		**save = NULL;
+    struct timeval	orig_stamp;
+    __pmTimestamp	stamp;
+    int			quiet = (arg != NULL && *(int *)arg);
 
-    orig_numpmid = inarch.rp->numpmid;
+    orig_numpmid = rp->numpmid;
 
-    if (inarch.rp->numpmid > len_save) {
-	/* expand save[] */
-	save = (pmValueSet **)realloc(save, inarch.rp->numpmid * sizeof(save[0]));
-	if (save == NULL) {
-	    fprintf(stderr, "save_vset: save realloc(...,%d) failed: %s\n", (int)(inarch.rp->numpmid * sizeof(save[0])), strerror(errno));
-	    abandon();
-	    /*NOTREACHED*/
+    if ((orp = (outrec_t *)malloc(sizeof(outrec_t))) == NULL) {
+	fprintf(stderr, "outrec malloc(%d) failed: %s\n", (int)sizeof(outrec_t), strerror(errno));
+	return -ENOMEM;
+    }
+    orp->pdu = NULL;
+    if (orig_numpmid > 0) {
+	save = (pmValueSet **)calloc(orig_numpmid, sizeof(save[0]));
+	orig_numval = (int *)malloc(orig_numpmid * sizeof(int));
+	orig_pmid = (pmID *)malloc(orig_numpmid * sizeof(pmID));
+	if (save == NULL || orig_numval == NULL || orig_pmid == NULL) {
+	    fprintf(stderr, "save_vset: save malloc(...,%d) failed: %s\n", (int)(orig_numpmid * sizeof(save[0])), strerror(errno));
+	    free(save);
+	    free(orig_numval);
+	    free(orig_pmid);
+	    free(orp);
+	    return -ENOMEM;
 	}
-	for (i = len_save; i < inarch.rp->numpmid; i++)
-	    save[i] = NULL;
-	len_save = inarch.rp->numpmid;
     }
-    orig_numval = (int *)malloc(orig_numpmid * sizeof(int));
-    if (orig_numval == NULL) {
-	fprintf(stderr, "orig_numval malloc(%d) failed: %s\n", (int)(orig_numpmid * sizeof(int)), strerror(errno));
-	abandon();
-	/*NOTREACHED*/
+    for (i = 0; i < orig_numpmid; i++) {
+	orig_numval[i] = rp->vset[i]->numval;
+	orig_pmid[i] = rp->vset[i]->pmid;
     }
-    for (i = 0; i < orig_numpmid; i++)
-	orig_numval[i] = inarch.rp->vset[i]->numval;
 
-    for (i = 0; i < inarch.rp->numpmid; i++) {
+    /* global time adjustment, undone below */
+    orig_stamp = rp->timestamp;
+    stamp.sec = rp->timestamp.tv_sec;
+    stamp.nsec = rp->timestamp.tv_usec * 1000;
+    if (fixstamp(&stamp)) {
+	rp->timestamp.tv_sec = stamp.sec;
+	rp->timestamp.tv_usec = stamp.nsec / 1000;
+    }
+
+    for (i = 0; i < rp->numpmid; i++) {
 	for (mp = metric_root; mp != NULL; mp = mp->m_next) {
-	    if (inarch.rp->vset[i]->pmid != mp->old_desc.pmid)
+	    if (rp->vset[i]->pmid != mp->old_desc.pmid)
 		continue;
 	    if (mp->flags == 0 && mp->ip == NULL)
 		break;
 	    if (mp->flags & METRIC_DELETE) {
 		/* move vset[i] to end of list, shuffle lower ones up */
-		pmValueSet	*vsp = inarch.rp->vset[i];
+		pmValueSet	*vsp = rp->vset[i];
 		pmValueSet	*save_vsp = save[i];
 		int		save_numval;
+		pmID		save_pmid;
 		save_numval = orig_numval[i];
+		save_pmid = orig_pmid[i];
 		if (pmDebugOptions.appl2)
-		    fprintf(stderr, "Delete: vset[%d] for %s\n", i, pmIDStr(inarch.rp->vset[i]->pmid));
-		for (j = i+1; j < inarch.rp->numpmid; j++) {
-		    inarch.rp->vset[j-1] = inarch.rp->vset[j];
+		    fprintf(stderr, "Delete: vset[%d] for %s\n", i, pmIDStr(rp->vset[i]->pmid));
+		for (j = i+1; j < rp->numpmid; j++) {
+		    rp->vset[j-1] = rp->vset[j];
 		    save[j-1] = save[j];
 		    orig_numval[j-1] = orig_numval[j];
+		    orig_pmid[j-1] = orig_pmid[j];
 		}
-		inarch.rp->vset[j-1] = vsp;
+		rp->vset[j-1] = vsp;
 		save[j-1] = save_vsp;
 		orig_numval[j-1] = save_numval;
+		orig_pmid[j-1] = save_pmid;
 		/* one less metric to write out, process vset[i] again */
-		inarch.rp->numpmid--;
+		rp->numpmid--;
 		i--;
 		break;
 	    }
@@ -550,11 +607,11 @@ do_result(void)
 	     *   METRIC_CHANGE_SEM
 	     */
 	    if (pmDebugOptions.appl2)
-		fprintf(stderr, "Rewrite: vset[%d] for %s\n", i, pmIDStr(inarch.rp->vset[i]->pmid));
+		fprintf(stderr, "Rewrite: vset[%d] for %s\n", i, pmIDStr(rp->vset[i]->pmid));
 
 	    if (mp->flags & METRIC_CHANGE_PMID)
-		inarch.rp->vset[i]->pmid = mp->new_desc.pmid;
-	    if ((mp->flags & METRIC_CHANGE_INDOM) && inarch.rp->vset[i]->numval > 0) {
+		rp->vset[i]->pmid = mp->new_desc.pmid;
+	    if ((mp->flags & METRIC_CHANGE_INDOM) && rp->vset[i]->numval > 0) {
 		if (mp->output != OUTPUT_ALL) {
 		    /*
 		     * Output only one value ...
@@ -574,33 +631,33 @@ do_result(void)
 			case OUTPUT_FIRST:
 			    break;
 			case OUTPUT_LAST:
-			    pick = inarch.rp->vset[i]->numval-1;
+			    pick = rp->vset[i]->numval-1;
 			    break;
 			case OUTPUT_ONE:
 			case OUTPUT_MIN:
 			case OUTPUT_MAX:
 			case OUTPUT_SUM:
 			case OUTPUT_AVG:
-			    pick = pick_val(i, mp);
+			    pick = pick_val(rp, i, mp);
 			    break;
 		    }
 		    if (pick >= 0) {
 			if (pick > 0) {
 			    /* swap vlist[0] and vlist[pick] */
-			    pmValue		save;
-			    save = inarch.rp->vset[i]->vlist[0];
-			    inarch.rp->vset[i]->vlist[0] = inarch.rp->vset[i]->vlist[pick];
-			    inarch.rp->vset[i]->vlist[0].inst = inarch.rp->vset[i]->vlist[pick].inst;
-			    inarch.rp->vset[i]->vlist[pick] = save;
+			    pmValue		tmp;
+			    tmp = rp->vset[i]->vlist[0];
+			    rp->vset[i]->vlist[0] = rp->vset[i]->vlist[pick];
+			    rp->vset[i]->vlist[0].inst = rp->vset[i]->vlist[pick].inst;
+			    rp->vset[i]->vlist[pick] = tmp;
 			}
 			if (mp->new_desc.indom == PM_INDOM_NULL)
-			    inarch.rp->vset[i]->vlist[0].inst = PM_IN_NULL;
+			    rp->vset[i]->vlist[0].inst = PM_IN_NULL;
 			else if (mp->old_desc.indom == PM_INDOM_NULL)
-			    inarch.rp->vset[i]->vlist[0].inst = mp->one_inst;
-			inarch.rp->vset[i]->numval = 1;
+			    rp->vset[i]->vlist[0].inst = mp->one_inst;
+			rp->vset[i]->numval = 1;
 		    }
 		    else
-			inarch.rp->vset[i]->numval = 0;
+			rp->vset[i]->numval = 0;
 		}
 	    }
 	    /*
@@ -614,22 +671,22 @@ do_result(void)
 		int	k;
 		for (k = 0; k < mp->ip->numinst; k++) {
 		    if (mp->ip->inst_flags[k] & INST_CHANGE_INST) {
-			for (j = 0; j < inarch.rp->vset[i]->numval; j++) {
-			    if (inarch.rp->vset[i]->vlist[j].inst == mp->ip->old_inst[k]) {
-				inarch.rp->vset[i]->vlist[j].inst = mp->ip->new_inst[k];
+			for (j = 0; j < rp->vset[i]->numval; j++) {
+			    if (rp->vset[i]->vlist[j].inst == mp->ip->old_inst[k]) {
+				rp->vset[i]->vlist[j].inst = mp->ip->new_inst[k];
 			    }
 			}
 		    }
 		    if (mp->ip->inst_flags[k] & INST_DELETE) {
-			for (j = 0; j < inarch.rp->vset[i]->numval; j++) {
-			    if (inarch.rp->vset[i]->vlist[j].inst == mp->ip->old_inst[k]) {
+			for (j = 0; j < rp->vset[i]->numval; j++) {
+			    if (rp->vset[i]->vlist[j].inst == mp->ip->old_inst[k]) {
 				j++;
-				while (j < inarch.rp->vset[i]->numval) {
-				    inarch.rp->vset[i]->vlist[j-1] = inarch.rp->vset[i]->vlist[j];
+				while (j < rp->vset[i]->numval) {
+				    rp->vset[i]->vlist[j-1] = rp->vset[i]->vlist[j];
 				    j++;
 				}
 				if (save[i] != NULL &&
-				    inarch.rp->vset[i]->valfmt == PM_VAL_DPTR) {
+				    rp->vset[i]->valfmt == PM_VAL_DPTR) {
 				    /*
 				     * messy case ... last instance pval is
 				     * from calling __pmStuffValue() in
@@ -637,9 +694,9 @@ do_result(void)
 				     * buffer, so free here because
 				     * clean_vset() won't find it
 				     */
-				    free_pval(inarch.rp, i, j-1);
+				    free_pval(rp, i, j-1);
 				}
-				inarch.rp->vset[i]->numval--;
+				rp->vset[i]->numval--;
 			    }
 			}
 		    }
@@ -651,10 +708,12 @@ do_result(void)
 		 * scale is different and -s on command line or RESCALE
 		 * in UNITS clause of metricspec => rescale values
 		 */
-		rescale(i, mp);
+		if ((sts = rescale(rp, save, i, mp, quiet)) < 0)
+		    goto restore;
 	    }
-	    if (mp->flags & METRIC_CHANGE_TYPE)
-		retype(i, mp);
+	    if ((mp->flags & METRIC_CHANGE_TYPE) &&
+		(sts = retype(rp, save, i, mp, quiet)) < 0)
+		goto restore;
 	    break;
 	}
     }
@@ -662,18 +721,56 @@ do_result(void)
     /*
      * only output numpmid == 0 case if input was a mark record
      */
-    if (orig_numpmid == 0 || inarch.rp->numpmid > 0) {
-	unsigned long	out_offset;
-	unsigned long	peek_offset;
-	peek_offset = __pmFtell(outarch.archctl.ac_mfp);
-	sts = __pmEncodeResult(PDU_OVERRIDE2, inarch.rp, (__pmPDU **)&inarch.logrec);
-	if (sts < 0) {
+    orp->numpmid = rp->numpmid;
+    if (orig_numpmid == 0 || rp->numpmid > 0) {
+	sts = __pmEncodeResult(PDU_OVERRIDE2, rp, &orp->pdu);
+	if (sts < 0 && !quiet)
 	    fprintf(stderr, "%s: Error: __pmEncodeResult: %s\n",
 		    pmGetProgname(), pmErrStr(sts));
-	    abandon();
-	    /*NOTREACHED*/
+    }
+
+restore:
+    /* restore numpmid up so all vset[]s are freed */
+    rp->numpmid = orig_numpmid;
+    rp->timestamp = orig_stamp;
+    /*
+     * put pmResult back the way it was (so pmFreeResult works correctly
+     * and the metadata matches) and release any allocated memory used
+     * in the rewriting
+     */
+    if (orig_numpmid > 0) {
+	clean_vset(rp, save);
+	/* restore numval up so all vlist[]s are freed */
+	for (i = 0; i < orig_numpmid; i++) {
+	    rp->vset[i]->numval = orig_numval[i];
+	    rp->vset[i]->pmid = orig_pmid[i];
 	}
-	peek_offset += ((__pmPDUHdr *)inarch.logrec)->len - sizeof(__pmPDUHdr) + 2*sizeof(int);
+    }
+    free(save);
+    free(orig_numval);
+    free(orig_pmid);
+
+    if (sts < 0) {
+	free(orp);
+	return sts;
+    }
+    rec->data = orp;
+    return 0;
+}
+
+/*
+ * Write out a pmResult rewritten by rewrite_result(), in archive order
+ */
+void
+do_result(pmResult *rp, outrec_t *orp)
+{
+    int			sts;
+
+    if (orp->pdu != NULL) {
+	unsigned long	out_offset;
+	unsigned long	peek_offset;
+	peek_offset = __pmFtell(outarch.archctl.ac_mfp);
+	peek_offset += ((__pmPDUHdr *)orp->pdu)->len - sizeof(__pmPDUHdr) + 2*sizeof(int);
 	if (peek_offset > 0x7fffffff) {
 	    /*
 	     * data file size will exceed 2^31-1 bytes, so force
@@ -682,39 +779,28 @@ do_result(void)
 	    newvolume(outarch.archctl.ac_curvol+1);
 	}
 	out_offset = __pmFtell(outarch.archctl.ac_mfp);
-	if ((sts = __pmLogPutResult2(&outarch.archctl, (__pmPDU *)inarch.logrec)) < 0) {
+	if ((sts = __pmLogPutResult2(&outarch.archctl, orp->pdu)) < 0) {
 	    fprintf(stderr, "%s: Error: __pmLogPutResult2: log data: %s\n",
 		    pmGetProgname(), pmErrStr(sts));
 	    abandon();
 	    /*NOTREACHED*/
 	}
 	/*
-	 * do not free inarch.logrec ... this is a libpcp record buffer,
+	 * do not free orp->pdu ... this is a libpcp record buffer,
 	 * so Unpin it
 	 */
-	__pmUnpinPDUBuf(inarch.logrec);
+	__pmUnpinPDUBuf(orp->pdu);
 	
 	if (pmDebugOptions.appl0) {
 	    struct timeval	stamp;
 	    fprintf(stderr, "Log: write ");
-	    stamp.tv_sec = inarch.rp->timestamp.tv_sec;
-	    stamp.tv_usec = inarch.rp->timestamp.tv_usec;
+	    stamp.tv_sec = rp->timestamp.tv_sec;
+	    stamp.tv_usec = rp->timestamp.tv_usec;
 	    pmPrintStamp(stderr, &stamp);
-	    fprintf(stderr, " numpmid=%d @ offset=%ld\n", inarch.rp->numpmid, out_offset);
+	    fprintf(stderr, " numpmid=%d @ offset=%ld\n", orp->numpmid, out_offset);
 	}
     }
+    free(orp);
 
-    /* restore numpmid up so all vset[]s are freed */
-    inarch.rp->numpmid = orig_numpmid;
-    /*
-     * put pmResult back the way it was (so pmFreeResult works correctly)
-     * and release any allocated memory used in the rewriting
-     */
-    clean_vset(inarch.rp);
-    /* restore numval up so all vlist[]s are freed */
-    for (i = 0; i < orig_numpmid; i++)
-	inarch.rp->vset[i]->numval = orig_numval[i];
-    free(orig_numval);
-
-    pmFreeResult(inarch.rp);
+    pmFreeResult(rp);
 }
@@ -121,6 +121,7 @@ do_data(__pmFILE *f, char *fname)
     long	sum_bytes;
     int		nrec = 0;
     int		nmark = 0;
+    int		ndelta = 0;
     __pmPDU	header;
     __pmPDU	trailer;
     int		need;
@@ -170,6 +171,20 @@ do_data(__pmFILE *f, char *fname)
 	php->type = PDU_RESULT;
 	php->from = FROM_ANON;
 
+	if (rlen >= 3 * (int)sizeof(__pmPDU) &&
+	    (int)ntohl(((__pmPDU *)buf)[5]) == PM_LOG_DELTA_MARK) {
+	    /*
+	     * delta encoded record, values are relative to an earlier
+	     * record, so only counted here and not in the -d details
+	     */
+	    __pmFread(&trailer, 1, sizeof(trailer), f);
+	    oheadbytes += sizeof(trailer);
+	    __pmUnpinPDUBuf(buf);
+	    ndelta++;
+	    nrec++;
+	    continue;
+	}
+
 	sts = __pmDecodeResult((__pmPDU *)buf, &rp);
 	if (sts < 0) {
 	    fprintf(stderr, "Error: __pmDecodeResult failed: %s\n", pmErrStr(sts));
@@ -348,6 +363,8 @@ do_data(__pmFILE *f, char *fname)
 	bytes, 100*(float)bytes/sbuf.st_size, nrec);
     if (nmark > 0)
 	printf(" (+ %d <mark> records)", nmark);
+    if (ndelta > 0)
+	printf(" (%d delta encoded)", ndelta);
     printf("]\n");
 
     if (dflag && nmetric != 0) {
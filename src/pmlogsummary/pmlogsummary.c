@@ -16,13 +16,16 @@
 #include <math.h>
 #include <stdarg.h>
 #include <limits.h>
+#include <pthread.h>
 #include "pmapi.h"
 #include "libpcp.h"
 
 static pmLongOptions longopts[] = {
     PMAPI_OPTIONS_HEADER("Options"),
     PMOPT_DEBUG,
+    { "single-pass", 0, '1', 0, "distribute values into bins in one pass, estimating for long archives" },
     { "all", 0, 'a', 0, "print all information (equivalent to -blmMy)" },
+    { "archive", 1, 'A', "FILE", "summarise another archive (may be repeated)" },
     { "", 0, 'b', 0, "print both stochastic and time averages for counter metrics" },
     { "bins", 1, 'B', "N", "print value distribution across a number of bins" },
     { "", 0, 'f', 0, "print using \"spreadsheet\" format (tab delimited fields)" },
@@ -30,12 +33,14 @@ static pmLongOptions longopts[] = {
     { "header", 0, 'H', 0, "print one-line header at start showing each column" },
     { "mintime", 0, 'i', 0, "also print timestamp for minimum value" },
     { "maxtime", 0, 'I', 0, "also print timestamp for maximum value" },
+    { "threads", 1, 'j', "N", "summarise up to N archives in parallel" },
     { "label", 0, 'l', 0, "also print the archive label and time window" },
     { "minimum", 0, 'm', 0, "also print minimum value" },
     { "maximum", 0, 'M', 0, "also print maximum value" },
     PMOPT_NAMESPACE,
     { "", 0, 'N', 0, "suppress warnings from individual archive fetches (default)" },
     { "precision", 1, 'p', "N", "number of digits to display after the decimal point" },
+    { "percentiles", 0, 'P', 0, "also print 50th, 95th and 99th percentile values" },
     { "sum", 0, 's', 0, "only print the sum of all values of each metric" },
     PMOPT_START,
     PMOPT_FINISH,
@@ -50,14 +55,42 @@ static pmLongOptions longopts[] = {
 };
 
 static int override(int, pmOptions *);
+unsigned int findbin(pmID, double, double, double);
 static pmOptions opts = {
-    .flags = PM_OPTFLAG_DONE | PM_OPTFLAG_BOUNDARIES | PM_OPTFLAG_STDOUT_TZ,
-    .short_options = "abB:D:fFHiIlmMNn:p:rsS:T:vVxyzZ:?",
+    .flags = PM_OPTFLAG_DONE | PM_OPTFLAG_BOUNDARIES | PM_OPTFLAG_STDOUT_TZ |
+	     PM_OPTFLAG_MULTI,
+    .short_options = "1aA:bB:D:fFHiIj:lmMNn:p:PrsS:T:vVxyzZ:?",
     .long_options = longopts,
-    .short_usage = "[options] archive [metricname ...]",
+    .short_usage = "[options] archive [metricname ...]\n"
+		   "       [options] -A archive [-A archive ...] [metricname ...]",
     .override = override,
 };
 
+/*
+ * Bounded memory summary of the values seen for one instance, from
+ * which both the value distribution and percentiles can be estimated
+ * without a second pass through the archive.  Every value is kept
+ * until there are SKETCHSIZE of them, so short archives give exact
+ * results; after that the sorted values are merged with neighbours into
+ * weighted centroids whenever the array fills up.  Centroids are kept
+ * smaller towards either end of the distribution, so the estimates of
+ * the high percentiles are the most accurate.
+ */
+#define SKETCHSIZE	1024
+
+typedef struct {
+    double		value;		/* mean of the merged values */
+    double		weight;		/* number of values merged */
+} centroid;
+
+typedef struct {
+    unsigned int	count;		/* centroids in use */
+    unsigned int	sorted;		/* leading centroids in value order */
+    unsigned int	size;		/* centroids allocated */
+    double		total;		/* sum of all weights */
+    centroid		*list;
+} sketch;
+
 typedef struct {
     int			inst;
     unsigned int	count;
@@ -75,6 +108,7 @@ typedef struct {
     int			marked;		/* seen since last "mark" record? */
     unsigned int	bintotal;	/* copy of count for 2nd pass */
     unsigned int	*bin;		/* bins for value distribution */
+    sketch		values;		/* for -P and -1 */
 } instData;
 
 typedef struct {
@@ -85,10 +119,28 @@ typedef struct {
 } aveData;
 
 /*
- * Hash control for statistics & errors related to each metric
+ * Everything known about one archive - each is summarised separately,
+ * possibly in parallel, then reported in command line order
  */
-static __pmHashCtl	hashlist;
-static __pmHashCtl	errlist;
+typedef struct {
+    char		*name;		/* archive name */
+    int			ctx;		/* PMAPI context */
+    int			zone;		/* timezone for reporting */
+    int			sts;		/* fetch status at end of pass(es) */
+    const char		*failed;	/* operation failing, else NULL */
+    __pmHashCtl		hashlist;	/* statistics related to each metric */
+    __pmHashCtl		errlist;	/* errors related to each metric */
+    struct timeval	start;		/* time window */
+    struct timeval	finish;
+    double		logspan;	/* duration of log */
+    int			dayflag;	/* timestamps include the date */
+    centroid		*scratch;	/* SKETCHSIZE centroids for merging */
+} archData;
+
+static archData		*archlist;
+static int		narchives;
+static int		nextarch;	/* next archive for a worker thread */
+static pthread_mutex_t	archlock = PTHREAD_MUTEX_INITIALIZER;
 
 /* output format flags */
 static unsigned int	stocaveflag;	/* no stochastic counter ave */
@@ -103,14 +155,16 @@ static unsigned int	warnflag;	/* warnings are off by default */
 static unsigned int	delimiter = ' ';/* output field separator */
 static unsigned int	nbins;		/* number of distribution bins */
 static unsigned int	precision = 3;	/* number of digits after "." */
+static unsigned int	pctflag;	/* no percentiles */
+static unsigned int	onepass;	/* bins from second pass */
+static unsigned int	sketchflag;	/* values sketch needed */
+
+static double		percentiles[] = { 50, 95, 99 };
+#define NPERCENTILES	(sizeof(percentiles) / sizeof(percentiles[0]))
 
 /* time window stuff */
-static int		dayflag;
 static char		timebuf[32];		/* for pmCtime result + .xxx */
 
-/* duration of log */
-static double		logspan;
-
 /* optional metric specification, optionally with instances */
 pmMetricSpec		*msp;
 
@@ -139,9 +193,9 @@ tadd(struct timeval *a, struct timeval *b)
 }
 
 static void
-pmiderr(pmID pmid, const char *msg, ...)
+pmiderr(archData *ap, pmID pmid, const char *msg, ...)
 {
-    if (warnflag && __pmHashSearch(pmid, &errlist) == NULL) {
+    if (warnflag && __pmHashSearch(pmid, &ap->errlist) == NULL) {
 	va_list	arg;
 	int	numnames;
 	char	**names;
@@ -153,15 +207,15 @@ pmiderr(pmID pmid, const char *msg, ...)
 	va_start(arg, msg);
 	vfprintf(stderr, msg, arg);
 	va_end(arg);
-	__pmHashAdd(pmid, NULL, &errlist);
+	__pmHashAdd(pmid, NULL, &ap->errlist);
 	if (numnames > 0) free(names);
     }
 }
 
 static void
-printstamp(struct timeval *stamp, int delim)
+printstamp(archData *ap, struct timeval *stamp, int delim)
 {
-    if (dayflag) {
+    if (ap->dayflag) {
 	char	*ddmm;
 	char	*yr;
 	time_t	time;
@@ -182,7 +236,7 @@ printstamp(struct timeval *stamp, int delim)
 }
 
 static void
-printlabel(void)
+printlabel(archData *ap)
 {
     pmLogLabel  label;
     char        *ddmm;
@@ -199,25 +253,25 @@ printlabel(void)
     printf("Log Label (Log Format Version %d)\n", label.ll_magic & 0xff);
     printf("Performance metrics from host %s\n", label.ll_hostname);
 
-    time = opts.start.tv_sec;
+    time = ap->start.tv_sec;
     ddmm = pmCtime(&time, timebuf);
     ddmm[10] = '\0';
     yr = &ddmm[20];
     printf("  commencing %s ", ddmm);
-    pmPrintStamp(stdout, &opts.start);
+    pmPrintStamp(stdout, &ap->start);
     printf(" %4.4s\n", yr);
 
-    if (opts.finish.tv_sec == INT_MAX) {
+    if (ap->finish.tv_sec == INT_MAX) {
 	/* pmGetArchiveEnd() failed! */
 	printf("  ending     UNKNOWN\n");
     }
     else {
-	time = opts.finish.tv_sec;
+	time = ap->finish.tv_sec;
 	ddmm = pmCtime(&time, timebuf);
 	ddmm[10] = '\0';
 	yr = &ddmm[20];
 	printf("  ending     %s ", ddmm);
-	pmPrintStamp(stdout, &opts.finish);
+	pmPrintStamp(stdout, &ap->finish);
 	printf(" %4.4s\n", yr);
     }
 }
@@ -225,6 +279,8 @@ printlabel(void)
 static void
 printheaders(void)
 {
+    int		j;
+
     printf("metric");
     if (stocaveflag)
 	printf("%cstochastic_average", delimiter);
@@ -240,6 +296,10 @@ printheaders(void)
 	printf("%cmaximum", delimiter);
     if (maxtimeflag)
 	printf("%cmaximum_time", delimiter);
+    if (pctflag) {
+	for (j = 0; j < NPERCENTILES; j++)
+	    printf("%cp%.0f", delimiter, percentiles[j]);
+    }
     if (countflag)
 	printf("%ccount", delimiter);
     if (nbins)
@@ -247,9 +307,191 @@ printheaders(void)
     printf("%cunits\n", delimiter);
 }
 
+/*
+ * Sort centroids by value - this happens for every few hundred values
+ * added to a sketch, so avoid qsort(3) calling back for each compare
+ */
+static void
+sortcentroids(centroid *list, int n)
+{
+    centroid	tmp;
+    double	pivot;
+    int		i, j, mid;
+
+    while (n > 16) {
+	/* median of three, leaving the ends as sentinels */
+	mid = (n - 1) / 2;
+	if (list[mid].value < list[0].value) {
+	    tmp = list[mid]; list[mid] = list[0]; list[0] = tmp;
+	}
+	if (list[n-1].value < list[0].value) {
+	    tmp = list[n-1]; list[n-1] = list[0]; list[0] = tmp;
+	}
+	if (list[n-1].value < list[mid].value) {
+	    tmp = list[n-1]; list[n-1] = list[mid]; list[mid] = tmp;
+	}
+	pivot = list[mid].value;
+	for (i = -1, j = n; ; ) {
+	    do i++; while (list[i].value < pivot);
+	    do j--; while (list[j].value > pivot);
+	    if (i >= j)
+		break;
+	    tmp = list[i]; list[i] = list[j]; list[j] = tmp;
+	}
+	/* recurse into the smaller part, iterate over the larger */
+	if (j + 1 < n - j - 1) {
+	    sortcentroids(list, j + 1);
+	    list += j + 1;
+	    n -= j + 1;
+	}
+	else {
+	    sortcentroids(list + j + 1, n - j - 1);
+	    n = j + 1;
+	}
+    }
+    for (i = 1; i < n; i++) {
+	tmp = list[i];
+	for (j = i; j > 0 && list[j-1].value > tmp.value; j--)
+	    list[j] = list[j-1];
+	list[j] = tmp;
+    }
+}
+
+/*
+ * Sort the centroids added since the last merge, then merge them with
+ * the rest (already in order) into scratch
+ */
+static void
+sketchmerge(sketch *sp, centroid *scratch)
+{
+    unsigned int	a = 0, b = sp->sorted, k = 0;
+
+    sortcentroids(&sp->list[sp->sorted], sp->count - sp->sorted);
+    while (a < sp->sorted && b < sp->count) {
+	if (sp->list[a].value <= sp->list[b].value)
+	    scratch[k++] = sp->list[a++];
+	else
+	    scratch[k++] = sp->list[b++];
+    }
+    while (a < sp->sorted)
+	scratch[k++] = sp->list[a++];
+    while (b < sp->count)
+	scratch[k++] = sp->list[b++];
+}
+
+/*
+ * Put the whole sketch in value order, for reporting
+ */
+static void
+sketchsort(sketch *sp, centroid *scratch)
+{
+    if (sp->sorted == sp->count)
+	return;
+    sketchmerge(sp, scratch);
+    memcpy(sp->list, scratch, sp->count * sizeof(centroid));
+    sp->sorted = sp->count;
+}
+
+/*
+ * Merge neighbouring centroids (in value order) while their combined
+ * weight stays within a limit proportional to sqrt(q(1-q)), where q is
+ * the fraction of values below the merged centroid.  Integrating over
+ * q, this leaves about SKETCHSIZE/2 centroids - if not, try again with
+ * larger centroids.
+ */
 static void
-printsummary(const char *name)
+sketchcompress(sketch *sp, centroid *scratch)
 {
+    double		scale = 4 * M_PI * sp->total / SKETCHSIZE;
+    double		cum, q, weight;
+    centroid		*from = scratch;
+    centroid		*cp, *last;
+    unsigned int	i, n;
+
+    sketchmerge(sp, scratch);
+    do {
+	for (i = n = 0, cum = 0; i < sp->count; i++) {
+	    cp = &from[i];
+	    last = n > 0 ? &sp->list[n-1] : NULL;
+	    if (last) {
+		weight = last->weight + cp->weight;
+		q = (cum - last->weight + weight / 2) / sp->total;
+		if (weight <= scale * sqrt(q * (1 - q))) {
+		    last->value += (cp->value - last->value) * cp->weight / weight;
+		    last->weight = weight;
+		    cum += cp->weight;
+		    continue;
+		}
+	    }
+	    sp->list[n++] = *cp;
+	    cum += cp->weight;
+	}
+	sp->count = sp->sorted = n;
+	from = sp->list;	/* any second attempt is in place */
+	scale *= 2;
+    } while (n > SKETCHSIZE * 3 / 4);
+}
+
+static void
+sketchadd(sketch *sp, double val, centroid *scratch)
+{
+    size_t	size;
+
+    if (sp->count == sp->size) {
+	if (sp->size < SKETCHSIZE) {
+	    sp->size = sp->size ? sp->size * 2 : 16;
+	    size = sp->size * sizeof(centroid);
+	    if ((sp->list = (centroid *)realloc(sp->list, size)) == NULL)
+		pmNoMem("sketchadd", size, PM_FATAL_ERR);
+	}
+	else
+	    sketchcompress(sp, scratch);
+    }
+    sp->list[sp->count].value = val;
+    sp->list[sp->count].weight = 1;
+    sp->count++;
+    sp->total++;
+}
+
+/*
+ * Estimate the value below which pct percent of the values fall, from
+ * a sketch sorted by value.  Interpolate linearly between the ranks of
+ * the centroids (the middle of the values each one holds) and out to
+ * the exact minimum and maximum - while no values have been merged this
+ * is the usual interpolation between the two closest ranks.
+ */
+static double
+sketchquantile(sketch *sp, double pct, double min, double max)
+{
+    double		rank, centre, cum = 0;
+    double		lastrank = 0, lastval = min;
+    unsigned int	i;
+
+    if (sp->total == 0)
+	return min;
+    rank = pct / 100 * (sp->total - 1);
+    for (i = 0; i < sp->count; i++) {
+	centre = cum + (sp->list[i].weight - 1) / 2;
+	if (rank <= centre) {
+	    if (centre == lastrank)
+		return sp->list[i].value;
+	    return lastval + (rank - lastrank) *
+		   (sp->list[i].value - lastval) / (centre - lastrank);
+	}
+	lastrank = centre;
+	lastval = sp->list[i].value;
+	cum += sp->list[i].weight;
+    }
+    centre = sp->total - 1;
+    if (centre == lastrank)
+	return lastval;
+    return lastval + (rank - lastrank) * (max - lastval) / (centre - lastrank);
+}
+
+static void
+printsummary(const char *name, void *arg)
+{
+    archData		*ap = (archData *)arg;
     int			sts;
     int			i, j;
     int			star;
@@ -270,7 +512,7 @@ printsummary(const char *name)
     }
 
     /* lookup using pmid, print values according to set flags */
-    if ((hptr = __pmHashSearch(pmid, &hashlist)) != NULL) {
+    if ((hptr = __pmHashSearch(pmid, &ap->hashlist)) != NULL) {
 	avedata = (aveData*)hptr->data;
 	for (i = 0; i < avedata->listsize; i++) {
 	    if ((instdata = avedata->instlist[i]) == NULL)
@@ -280,19 +522,19 @@ printsummary(const char *name)
 		struct timeval	timediff;
 
 		/* extend discrete metrics to the archive end */
-		timediff = opts.finish;
+		timediff = ap->finish;
 		tsub(&timediff, &instdata->lasttime);
 		val = instdata->lastval;
 		instdata->stocave += val;
 		instdata->timeave += val*pmtimevalToReal(&timediff);
-		instdata->lasttime = opts.finish;
+		instdata->lasttime = ap->finish;
 		instdata->count++;
 	    }
 	    metrictimespan = instdata->lasttime;
 	    tsub(&metrictimespan, &instdata->firsttime);
 	    metricspan = pmtimevalToReal(&metrictimespan);
 	    /* counter metric doesn't cover 90% of log */
-	    star = (avedata->desc.sem == PM_SEM_COUNTER && metricspan / logspan <= 0.1);
+	    star = (avedata->desc.sem == PM_SEM_COUNTER && metricspan / ap->logspan <= 0.1);
 
 	    if ((sts = pmNameInDomArchive(avedata->desc.indom, instdata->inst, &str)) < 0) {
 		if (msp && msp->ninst > 0 && avedata->desc.indom == PM_INDOM_NULL)
@@ -347,15 +589,30 @@ printsummary(const char *name)
 	    if (minflag)
 		printf("%c%.*f", delimiter, (int)precision, instdata->min);
 	    if (mintimeflag)
-		printstamp(&instdata->mintime, delimiter);
+		printstamp(ap, &instdata->mintime, delimiter);
 	    if (maxflag)
 		printf("%c%.*f", delimiter, (int)precision, instdata->max);
 	    if (maxtimeflag)
-		printstamp(&instdata->maxtime, delimiter);
+		printstamp(ap, &instdata->maxtime, delimiter);
+	    if (sketchflag)
+		sketchsort(&instdata->values, ap->scratch);
+	    if (pctflag) {
+		for (j = 0; j < NPERCENTILES; j++)
+		    printf("%c%.*f", delimiter, (int)precision,
+			sketchquantile(&instdata->values, percentiles[j],
+					instdata->min, instdata->max));
+	    }
 	    if (avedata->desc.sem == PM_SEM_DISCRETE)	/* all added marks + added endpoint above */
 		instdata->count = instdata->count - instdata->markcount - 1;
 	    if (countflag)
 		printf("%c%u", delimiter, instdata->count);
+	    if (nbins && onepass) {	/* value distribution from the sketch */
+		for (j = 0; j < instdata->values.count; j++)
+		    instdata->bin[findbin(avedata->desc.pmid,
+				instdata->values.list[j].value,
+				instdata->min, instdata->max)] +=
+				(unsigned int)instdata->values.list[j].weight;
+	    }
 	    for (j=0; j < nbins; j++) {	/* print value distribution summary */
 		if (j > 0 && instdata->min == instdata->max)	/* all in 1st bin */
 		    printf("%c[]%c%u", delimiter, delimiter, 0);
@@ -369,11 +626,13 @@ printsummary(const char *name)
 	    if (instdata) {
 		if (instdata->bin)
 		    free(instdata->bin);
+		if (instdata->values.list)
+		    free(instdata->values.list);
 		free(instdata);
 	    }
 	}
 	if (avedata->instlist) free(avedata->instlist);
-	__pmHashDel(avedata->desc.pmid, (void*)avedata, &hashlist);
+	__pmHashDel(avedata->desc.pmid, (void*)avedata, &ap->hashlist);
 	free(avedata);
     }
 }
@@ -409,8 +668,9 @@ unwrap(double current, double previous, int pmtype)
     return outval;
 }
 
-static void
-newHashInst(pmValue *vp,
+static int
+newHashInst(archData *ap,
+	pmValue *vp,
 	aveData *avedata,		/* updated by this function */
 	int valfmt,
 	struct timeval *timestamp,	/* timestamp for this sample */
@@ -422,9 +682,9 @@ newHashInst(pmValue *vp,
     pmAtomValue av;
 
     if ((sts = pmExtractValue(valfmt, vp, avedata->desc.type, &av, PM_TYPE_DOUBLE)) < 0) {
-	pmiderr(avedata->desc.pmid, "failed to extract value: %s\n", pmErrStr(sts));
-	fprintf(stderr, "%s: possibly corrupt archive?\n", pmGetProgname());
-	exit(1);
+	pmiderr(ap, avedata->desc.pmid, "failed to extract value: %s\n", pmErrStr(sts));
+	ap->failed = "pmExtractValue (possibly corrupt archive?)";
+	return sts;
     }
     size = (pos+1) * sizeof(instData *);
     avedata->instlist = (instData **) realloc(avedata->instlist, size);
@@ -443,6 +703,7 @@ newHashInst(pmValue *vp,
 	    pmNoMem("newHashInst.instlist[inst].bin", size, PM_FATAL_ERR);
 	memset(instdata->bin, 0, size);
     }
+    memset(&instdata->values, 0, sizeof(instdata->values));
     instdata->inst = vp->inst;
     if (avedata->desc.sem == PM_SEM_COUNTER) {
 	instdata->min = 0.0;
@@ -463,6 +724,8 @@ newHashInst(pmValue *vp,
 	instdata->stocave = av.d;
 	instdata->timeave = 0.0;
 	instdata->count = 1;
+	if (sketchflag)
+	    sketchadd(&instdata->values, av.d, ap->scratch);
     }
     instdata->marked = 0;
     instdata->bintotal = 0;
@@ -480,15 +743,17 @@ newHashInst(pmValue *vp,
 		instdata->min, instdata->max);
 	if (numnames > 0) free(names);
     }
+    return 0;
 }
 
-static void
-newHashItem(pmValueSet *vsp,
+static int
+newHashItem(archData *ap,
+	pmValueSet *vsp,
 	pmDesc *desc,
 	aveData *avedata,		/* output from this function */
 	struct timeval *timestamp)	/* timestamp for this sample */
 {
-    int j;
+    int j, sts;
 
     avedata->desc = *desc;
     avedata->scale = 0.0;
@@ -512,8 +777,11 @@ newHashItem(pmValueSet *vsp,
     }
     avedata->listsize = 0;
     avedata->instlist = NULL;
-    for (j = 0; j < vsp->numval; j++)
-	newHashInst(&vsp->vlist[j], avedata, vsp->valfmt, timestamp, j);
+    for (j = 0; j < vsp->numval; j++) {
+	if ((sts = newHashInst(ap, &vsp->vlist[j], avedata, vsp->valfmt, timestamp, j)) < 0)
+	    return sts;
+    }
+    return 0;
 }
 
 /*
@@ -554,7 +822,7 @@ findbin(pmID pmid, double val, double min, double max)
  * record has been seen between now & the last fetch for that instance
  */
 static void
-markrecord(pmResult *result)
+markrecord(archData *ap, pmResult *result)
 {
     int			i, j;
     __pmHashNode	*hptr;
@@ -564,11 +832,11 @@ markrecord(pmResult *result)
     struct timeval	timediff;
 
     if (pmDebugOptions.appl0) {
-	printstamp(&result->timestamp, '\n');
+	printstamp(ap, &result->timestamp, '\n');
 	printf(" - mark record\n\n");
     }
-    for (i = 0; i < hashlist.hsize; i++) {
-	for (hptr = hashlist.hash[i]; hptr != NULL; hptr = hptr->next) {
+    for (i = 0; i < ap->hashlist.hsize; i++) {
+	for (hptr = ap->hashlist.hash[i]; hptr != NULL; hptr = hptr->next) {
 	    avedata = (aveData *)hptr->data;
 	    for (j = 0; j < avedata->listsize; j++) {
 		instdata = avedata->instlist[j];
@@ -590,7 +858,7 @@ markrecord(pmResult *result)
 }
 
 static void
-calcbinning(pmResult *result)
+calcbinning(archData *ap, pmResult *result)
 {
     unsigned int	bin;
     int			i, j, k;
@@ -607,18 +875,18 @@ calcbinning(pmResult *result)
     struct timeval	timediff;
 
     if (result->numpmid == 0)	/* mark record */
-	markrecord(result);
+	markrecord(ap, result);
 
     for (i = 0; i < result->numpmid; i++) {
 	vsp = result->vset[i];
 	if (vsp->numval == 0)
 	    continue;
 	else if (vsp->numval < 0) {
-	    pmiderr(vsp->pmid, "failed in 2nd pass archive fetch: %s\n", pmErrStr(vsp->numval));
+	    pmiderr(ap, vsp->pmid, "failed in 2nd pass archive fetch: %s\n", pmErrStr(vsp->numval));
 	    continue;
 	}
 
-	if ((hptr = __pmHashSearch(vsp->pmid, &hashlist)) != NULL) {
+	if ((hptr = __pmHashSearch(vsp->pmid, &ap->hashlist)) != NULL) {
 	    avedata = (aveData *)hptr->data;
 	    for (j = 0; j < vsp->numval; j++) {	/* iterate thro result values */
 		int	fp_bad;
@@ -631,20 +899,20 @@ calcbinning(pmResult *result)
 				break;	/* k now correct */
 			}
 			if (k == avedata->listsize) {
-			    pmiderr(vsp->pmid, "ignoring new instance found on second pass\n");
+			    pmiderr(ap, vsp->pmid, "ignoring new instance found on second pass\n");
 			    continue;
 			}
 		    }
 		    else if (k >= avedata->listsize) {
 			k = avedata->listsize;
-			pmiderr(vsp->pmid, "ignoring new instance found on second pass\n");
+			pmiderr(ap, vsp->pmid, "ignoring new instance found on second pass\n");
 			continue;
 		    }
 		}
 		instdata = avedata->instlist[k];
 
 		if ((sts = pmExtractValue(vsp->valfmt, vp, avedata->desc.type, &av, PM_TYPE_DOUBLE)) < 0) {
-		    pmiderr(avedata->desc.pmid, "failed to extract value: %s\n", pmErrStr(sts));
+		    pmiderr(ap, avedata->desc.pmid, "failed to extract value: %s\n", pmErrStr(sts));
 		    continue;
 		}
 		fp_bad = 0;
@@ -713,8 +981,8 @@ calcbinning(pmResult *result)
     }
 }
 
-static void
-calcaverage(pmResult *result)
+static int
+calcaverage(archData *ap, pmResult *result)
 {
     int			i, j, k;
     int			sts;
@@ -732,21 +1000,21 @@ calcaverage(pmResult *result)
     struct timeval	timediff;
 
     if (result->numpmid == 0)	/* mark record */
-	markrecord(result);
+	markrecord(ap, result);
 
     for (i = 0; i < result->numpmid; i++) {
 	vsp = result->vset[i];
 	if (vsp->numval == 0)
 	    continue;
 	else if (vsp->numval < 0) {
-	    pmiderr(vsp->pmid, "failed in archive value fetch: %s\n", pmErrStr(vsp->numval));
+	    pmiderr(ap, vsp->pmid, "failed in archive value fetch: %s\n", pmErrStr(vsp->numval));
 	    continue;
 	}
 
 	/* check if pmid already in hash list */
-	if ((hptr = __pmHashSearch(vsp->pmid, &hashlist)) == NULL) {
+	if ((hptr = __pmHashSearch(vsp->pmid, &ap->hashlist)) == NULL) {
 	    if ((sts = pmLookupDesc(vsp->pmid, &desc)) < 0) {
-		pmiderr(vsp->pmid, "cannot find descriptor: %s\n", pmErrStr(sts));
+		pmiderr(ap, vsp->pmid, "cannot find descriptor: %s\n", pmErrStr(sts));
 		continue;
 	    }
 
@@ -758,9 +1026,15 @@ calcaverage(pmResult *result)
 
 	    /* create a new one & add to list */
 	    avedata = (aveData*) malloc(sizeof(aveData));
-	    newHashItem(vsp, &desc, avedata, &result->timestamp);
-	    if (__pmHashAdd(avedata->desc.pmid, (void*)avedata, &hashlist) < 0) {
-		pmiderr(avedata->desc.pmid, "failed %s hash table insertion\n", pmGetProgname());
+	    if ((sts = newHashItem(ap, vsp, &desc, avedata, &result->timestamp)) < 0) {
+		for (j = 0; j < avedata->listsize; j++)
+		    free(avedata->instlist[j]);
+		free(avedata->instlist);
+		free(avedata);
+		return sts;
+	    }
+	    if (__pmHashAdd(avedata->desc.pmid, (void*)avedata, &ap->hashlist) < 0) {
+		pmiderr(ap, avedata->desc.pmid, "failed %s hash table insertion\n", pmGetProgname());
 		/* free memory allocated above on insert failure */
 		for (j = 0; j < vsp->numval; j++)
 		    if (avedata->instlist[j]) free(avedata->instlist[j]);
@@ -783,20 +1057,22 @@ calcaverage(pmResult *result)
 			    }
 			}
 			if (k == avedata->listsize) {	/* no matching inst was found */
-			    newHashInst(vp, avedata, vsp->valfmt, &result->timestamp, k);
+			    if ((sts = newHashInst(ap, vp, avedata, vsp->valfmt, &result->timestamp, k)) < 0)
+				return sts;
 			    continue;
 			}
 		    }
 		    else if (k >= avedata->listsize) {
 			k = avedata->listsize;
-			newHashInst(vp, avedata, vsp->valfmt, &result->timestamp, k);
+			if ((sts = newHashInst(ap, vp, avedata, vsp->valfmt, &result->timestamp, k)) < 0)
+			    return sts;
 			continue;
 		    }
 		}
 		instdata = avedata->instlist[k];
 
 		if ((sts = pmExtractValue(vsp->valfmt, vp, avedata->desc.type, &av, PM_TYPE_DOUBLE)) < 0) {
-		    pmiderr(avedata->desc.pmid, "failed to extract value: %s\n", pmErrStr(sts));
+		    pmiderr(ap, avedata->desc.pmid, "failed to extract value: %s\n", pmErrStr(sts));
 		    continue;
 		}
 		fp_bad = 0;
@@ -848,6 +1124,8 @@ calcaverage(pmResult *result)
 		    else {
 			rate = (val - instdata->lastval) / diff;
 			instdata->stocave += rate;
+			if (sketchflag)
+			    sketchadd(&instdata->values, rate, ap->scratch);
 			if (!instdata->marked)
 			    instdata->timeave += (val - instdata->lastval);
 			else {
@@ -905,6 +1183,8 @@ calcaverage(pmResult *result)
 		    val = av.d;
 		    instdata->sum += val;
 		    instdata->stocave += val;
+		    if (sketchflag)
+			sketchadd(&instdata->values, val, ap->scratch);
 		    if (val < instdata->min) {
 			instdata->min = val;
 			instdata->mintime = result->timestamp;
@@ -966,35 +1246,129 @@ calcaverage(pmResult *result)
 	    }
 	}
     }
+    return 0;
 }
 
 static int
 override(int opt, pmOptions *optsp)
 {
-    if (opt == 'a' || opt == 'H' || opt == 'N' || opt == 'p' || opt == 's')
+    if (opt == 'a' || opt == 'A' || opt == 'H' || opt == 'N' || opt == 'p' || opt == 's')
 	return 1;
     return 0;
 }
 
+/*
+ * Gather the statistics for one archive, in one pass or in two passes
+ * if distributing values into bins and -1 was not given.  This runs in
+ * a worker thread, so a failure is noted in ap->failed and ap->sts for
+ * the main thread to report.
+ */
+static void
+summarise(archData *ap)
+{
+    int			sts, trip;
+    pmResult		*result;
+
+    if ((sts = pmUseContext(ap->ctx)) < 0) {
+	ap->failed = "pmUseContext";
+	ap->sts = sts;
+	return;
+    }
+    if ((sts = pmSetMode(PM_MODE_FORW, &ap->start, 0)) < 0) {
+	ap->failed = "pmSetMode";
+	ap->sts = sts;
+	return;
+    }
+
+    for (trip = 0; trip < 2; trip++) {	/* two passes if binning */
+	for ( ; ; ) {
+	    if ((sts = pmFetchArchive(&result)) < 0)
+		break;
+
+	    if (ap->finish.tv_sec > result->timestamp.tv_sec ||
+		(ap->finish.tv_sec == result->timestamp.tv_sec &&
+		 ap->finish.tv_usec >= result->timestamp.tv_usec)) {
+		if (trip == 0)
+		    sts = calcaverage(ap, result);
+		else
+		    calcbinning(ap, result);
+		pmFreeResult(result);
+		if (sts < 0) {
+		    ap->sts = sts;
+		    return;
+		}
+	    }
+	    else {
+		pmFreeResult(result);
+		sts = PM_ERR_EOL;
+		break;
+	    }
+	}
+
+	if (trip == 0 && nbins > 0 && !onepass) {	/* distribute values into bins */
+	    if (pmDebugOptions.appl0)
+		fprintf(stderr, "resetting for second iteration\n");
+	    if ((sts = pmSetMode(PM_MODE_FORW, &ap->start, 0)) < 0) {
+		ap->failed = "pmSetMode reset";
+		ap->sts = sts;
+		return;
+	    }
+	}
+	else
+	    break;	/* two passes only when doing binning */
+    }
+    ap->sts = sts;
+}
+
+/*
+ * Worker thread for -j, summarising archives until none are left
+ */
+static void *
+worker(void *arg)
+{
+    archData		*ap;
+
+    for ( ; ; ) {
+	pthread_mutex_lock(&archlock);
+	ap = nextarch < narchives ? &archlist[nextarch++] : NULL;
+	pthread_mutex_unlock(&archlock);
+	if (ap == NULL)
+	    break;
+	summarise(ap);
+    }
+    return NULL;
+}
+
 int
 main(int argc, char *argv[])
 {
-    int			c, i, sts, trip, exitstatus = 0;
+    int			c, i, sts, exitstatus = 0;
     int			lflag = 0;		/* no label by default */
     int			Hflag = 0;		/* no header by default */
-    pmResult		*result;
+    int			nthreads = 0;		/* one per CPU by default */
+    pthread_t		*threads;
     struct timeval 	timespan = {0, 0};
+    archData		*ap;
     char		*endnum;
-    char		*archive;
+    char		*tz;
+    char		**archives;
 
     while ((c = pmGetOptions(argc, argv, &opts)) != EOF) {
 	switch (c) {
 
+	case '1':	/* bins from a single pass */
+	    onepass = 1;
+	    break;
+
 	case 'a':	/* provide all information */
 	    stocaveflag = timeaveflag = lflag = countflag = minflag = maxflag = 1;
 	    sumflag = 0;
 	    break;
 
+	case 'A':	/* another archive */
+	    __pmAddOptArchive(&opts, opts.optarg);
+	    break;
+
 	case 'b':	/* use both averages */
 	    stocaveflag = 1;
 	    timeaveflag = 1;
@@ -1032,6 +1406,15 @@ main(int argc, char *argv[])
 	    maxtimeflag = 1;
 	    break;
 
+	case 'j':	/* number of worker threads */
+	    nthreads = (int)strtol(opts.optarg, &endnum, 10);
+	    if (*endnum != '\0' || nthreads <= 0) {
+		pmprintf("%s: -j requires positive numeric argument\n",
+			pmGetProgname());
+		opts.errors++;
+	    }
+	    break;
+
 	case 'l':	/* display label */
 	    lflag = 1;
 	    break;
@@ -1056,6 +1439,10 @@ main(int argc, char *argv[])
 	    }
 	    break;
 
+	case 'P':	/* print percentiles */
+	    pctflag = 1;
+	    break;
+
 	case 's':	/* print sums (and only sums) */
 	    stocaveflag = timeaveflag = lflag = countflag = minflag = maxflag = 0;
 	    sumflag = 1;
@@ -1089,104 +1476,140 @@ main(int argc, char *argv[])
 	exit(exitstatus);
     }
 
-    if (opts.narchives > 0) {
-	archive = opts.archives[0];
-    } else {
-	archive = argv[opts.optind++];
-	__pmAddOptArchive(&opts, archive);
-    }
+    /* archives from -A, else the first argument */
+    if (opts.narchives == 0)
+	__pmAddOptArchive(&opts, argv[opts.optind++]);
     opts.flags &= ~PM_OPTFLAG_DONE;
     __pmEndOptions(&opts);
 
-    if ((sts = c = pmNewContext(PM_CONTEXT_ARCHIVE, archive)) < 0) {
-	fprintf(stderr, "%s: Cannot open archive \"%s\": %s\n",
-		pmGetProgname(), archive, pmErrStr(sts));
-	exit(1);
+    sketchflag = pctflag || (nbins > 0 && onepass);
+
+    archives = opts.archives;
+    narchives = opts.narchives;
+    if ((archlist = (archData *)calloc(narchives, sizeof(archData))) == NULL)
+	pmNoMem("archlist", narchives * sizeof(archData), PM_FATAL_ERR);
+    for (i = 0; i < narchives; i++) {
+	ap = &archlist[i];
+	ap->name = opts.archives[i];
+	if (sketchflag) {
+	    ap->scratch = (centroid *)malloc(SKETCHSIZE * sizeof(centroid));
+	    if (ap->scratch == NULL)
+		pmNoMem("scratch", SKETCHSIZE * sizeof(centroid), PM_FATAL_ERR);
+	}
+	if ((sts = ap->ctx = pmNewContext(PM_CONTEXT_ARCHIVE, ap->name)) < 0) {
+	    fprintf(stderr, "%s: Cannot open archive \"%s\": %s\n",
+		    pmGetProgname(), ap->name, pmErrStr(sts));
+	    exit(1);
+	}
+
+	/* time window from this archive alone, not all of them */
+	opts.archives = &archlist[i].name;
+	opts.narchives = 1;
+	sts = pmGetContextOptions(ap->ctx, &opts);
+	opts.archives = archives;
+	opts.narchives = narchives;
+	if (sts < 0) {
+	    pmflush();	/* runtime errors only at this stage */
+	    exit(EXIT_FAILURE);
+	}
+	if (opts.timezone)	/* same for every archive, say so once */
+	    opts.flags &= ~PM_OPTFLAG_STDOUT_TZ;
+	ap->zone = pmWhichZone(&tz);
+	ap->start = opts.start;
+	ap->finish = opts.finish;
+	ap->logspan = pmtimevalToReal(&ap->finish) - pmtimevalToReal(&ap->start);
+
+	/* check which timestamp print format we should be using */
+	timespan = ap->finish;
+	tsub(&timespan, &ap->start);
+	if (timespan.tv_sec > 86400) /* seconds per day: 60*60*24 */
+	    ap->dayflag = 1;
     }
 
-    if (pmGetContextOptions(c, &opts) < 0) {
-	pmflush();	/* runtime errors only at this stage */
-	exit(EXIT_FAILURE);
+    if (nthreads == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+	nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (nthreads <= 0)
+	    nthreads = 1;
     }
-    
-    if ((sts = pmSetMode(PM_MODE_FORW, &opts.start, 0)) < 0) {
-	fprintf(stderr, "%s: pmSetMode failed: %s\n", pmGetProgname(), pmErrStr(sts));
-	exit(1);
+    if (nthreads > narchives)
+	nthreads = narchives;
+    if (nthreads == 1)
+	worker(NULL);
+    else {
+	if ((threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t))) == NULL)
+	    pmNoMem("threads", nthreads * sizeof(pthread_t), PM_FATAL_ERR);
+	for (i = 0; i < nthreads; i++) {
+	    if ((sts = pthread_create(&threads[i], NULL, worker, NULL)) != 0) {
+		fprintf(stderr, "%s: pthread_create failed: %s\n",
+			pmGetProgname(), pmErrStr(-sts));
+		exit(1);
+	    }
+	}
+	for (i = 0; i < nthreads; i++)
+	    pthread_join(threads[i], NULL);
+	free(threads);
     }
 
-    if (lflag)
-	printlabel();
+    /* failures other than fetching, before any output as without -A */
+    for (i = 0; i < narchives; i++) {
+	ap = &archlist[i];
+	if (ap->failed == NULL)
+	    continue;
+	if (narchives > 1)
+	    fprintf(stderr, "%s: %s: %s failed: %s\n", pmGetProgname(),
+		    ap->name, ap->failed, pmErrStr(ap->sts));
+	else
+	    fprintf(stderr, "%s: %s failed: %s\n", pmGetProgname(),
+		    ap->failed, pmErrStr(ap->sts));
+	exitstatus = 1;
+    }
+    if (exitstatus)
+	exit(exitstatus);
 
-    logspan = pmtimevalToReal(&opts.finish) - pmtimevalToReal(&opts.start);
+    for (i = 0; i < narchives; i++) {
+	ap = &archlist[i];
+	pmUseContext(ap->ctx);
+	if (ap->zone >= 0)
+	    pmUseZone(ap->zone);
 
-    /* check which timestamp print format we should be using */
-    timespan = opts.finish;
-    tsub(&timespan, &opts.start);
-    if (timespan.tv_sec > 86400) /* seconds per day: 60*60*24 */
-	dayflag = 1;
+	if (narchives > 1)
+	    printf("%sArchive: %s\n", i > 0 ? "\n" : "", ap->name);
 
-    for (trip = 0; trip < 2; trip++) {	/* two passes if binning */
-	for ( ; ; ) {
-	    if ((sts = pmFetchArchive(&result)) < 0)
-		break;
+	if (lflag)
+	    printlabel(ap);
 
-	    if (opts.finish.tv_sec > result->timestamp.tv_sec ||
-		(opts.finish.tv_sec == result->timestamp.tv_sec &&
-		 opts.finish.tv_usec >= result->timestamp.tv_usec)) {
-		if (trip == 0)
-		    calcaverage(result);
-		else
-		    calcbinning(result);
-		pmFreeResult(result);
-	    }
-	    else {
-		pmFreeResult(result);
-		sts = PM_ERR_EOL;
-		break;
-	    }
+	if (ap->sts != PM_ERR_EOL) {
+	    fprintf(stderr, "%s: fetch failed: %s\n", pmGetProgname(), pmErrStr(ap->sts));
+	    exitstatus = 1;
 	}
 
-	if (trip == 0 && nbins > 0) {	/* distribute values into bins */
-	    if (pmDebugOptions.appl0)
-		fprintf(stderr, "resetting for second iteration\n");
-	    if ((sts = pmSetMode(PM_MODE_FORW, &opts.start, 0)) < 0) {
-		fprintf(stderr, "%s: pmSetMode reset failed: %s\n",
-		    pmGetProgname(), pmErrStr(sts));
+	if (Hflag)
+	    printheaders();
+
+	if (opts.optind >= argc) {	/* print all results */
+	    if ((sts = pmTraversePMNS_r("", printsummary, ap)) < 0) {
+		fprintf(stderr, "%s: PMNS traversal failed: %s\n", pmGetProgname(), pmErrStr(sts));
 		exit(1);
 	    }
 	}
-	else
-	    break;	/* two passes only when doing binning */
-    }
+	else {		/* print only selected results */
+	    for (c = opts.optind; c < argc; c++) {
+		char *msg;
 
-    if (sts != PM_ERR_EOL) {
-	fprintf(stderr, "%s: fetch failed: %s\n", pmGetProgname(), pmErrStr(sts));
-	exitstatus = 1;
-    }
-
-    if (Hflag)
-	printheaders();
-
-    if (opts.optind >= argc) {	/* print all results */
-	if ((sts = pmTraversePMNS("", printsummary)) < 0) {
-	    fprintf(stderr, "%s: PMNS traversal failed: %s\n", pmGetProgname(), pmErrStr(sts));
-	    exit(1);
-	}
-    }
-    else {		/* print only selected results */
-	for (i = opts.optind; i < argc; i++) {
-	    char *msg;
-
-	    if (pmParseMetricSpec(argv[i], 1, archive, &msp, &msg) < 0) {
-		fputs(msg, stderr);
-		free(msg);
-		continue;
+		if (pmParseMetricSpec(argv[c], 1, ap->name, &msp, &msg) < 0) {
+		    fputs(msg, stderr);
+		    free(msg);
+		    continue;
+		}
+		if ((sts = pmTraversePMNS_r(msp->metric, printsummary, ap)) < 0)
+		    fprintf(stderr, "%s: PMNS traversal failed for %s: %s\n",
+			    pmGetProgname(), msp->metric, pmErrStr(sts));
+		pmFreeMetricSpec(msp);
 	    }
-	    if ((sts = pmTraversePMNS(msp->metric, printsummary)) < 0)
-		fprintf(stderr, "%s: PMNS traversal failed for %s: %s\n",
-			pmGetProgname(), msp->metric, pmErrStr(sts));
-	    pmFreeMetricSpec(msp);
 	}
+	fflush(stdout);
     }
 
     exit(exitstatus);
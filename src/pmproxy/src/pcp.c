@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2019 Red Hat.
+ * Copyright (c) 2018-2019,2021 Red Hat.
  * 
  * This program is free software; you can redistribute it and/or modify it
  * under the terms of the GNU Lesser General Public License as published
@@ -12,17 +12,85 @@
  * License for more details.
  */
 #include "server.h"
+#include "dict.h"
+#include "util.h"
 
 #define PMPROXY_SERVER	"pmproxy-server 1\n"
 #define PMPROXY_CLIENT	"pmproxy-client 1\n"
 #define HEADER_LENGTH	(sizeof(PMPROXY_CLIENT)-1)
 #define PDU_MAXLENGTH	(MAXHOSTNAMELEN + HEADER_LENGTH + sizeof("65536")-1)
 
+#define PDU_HDRLENGTH	(3 * sizeof(__int32_t))	/* len, type, from */
+#define PDU_CTXOFFSET	PDU_HDRLENGTH		/* client context number */
+#define PDU_PMIDOFFSET	(PDU_HDRLENGTH + 3 * sizeof(__int32_t))
+#define PDU_LIMIT	(16 * 1024 * 1024)	/* larger is malformed */
+
+/*
+ * Coalescing of identical fetch requests from different clients.
+ * A fetch is identical when it targets the same pmcd with the same
+ * credentials/attributes, instance profile and list of PMIDs.  The
+ * first such client (leader) sends its request to pmcd, others that
+ * arrive while it is in-flight wait for the same reply, and later
+ * ones are answered from the reply until the freshness window ends.
+ */
+typedef struct pcp_fetch {
+    sds			key;		/* identifies equivalent requests */
+    sds			reply;		/* PDU(s) returned from pmcd */
+    struct client	*leader;	/* client with request sent to pmcd */
+    struct client	*waiters;	/* clients waiting on same reply */
+    uint64_t		stamp;		/* uv_now time the reply completed */
+    unsigned int	ready;		/* full reply received from pmcd */
+} pcp_fetch;
+
+enum {
+    FETCH_REQUESTS	= 1,
+    FETCH_UPSTREAM	= 2,
+    FETCH_COALESCED	= 3,
+    FETCH_CACHED	= 4,
+    FETCH_ENTRIES	= 5,
+    FETCH_RATIO		= 6,
+    CLIENT_PASSTHRU	= 7,
+};
+
+static unsigned int	coalesce_window;	/* milliseconds, zero is off */
+static struct dict	*coalesce_fetches;	/* key: pcp_fetch */
+static struct proxy	*coalesce_proxy;
+static void		*coalesce_metrics;
+static int		coalesce_timer = -1;
+static unsigned long long coalesce_requests;
+static unsigned long long coalesce_shared;
+
+static void pcp_client_process(struct client *);
+
+static void
+pcp_fetch_free(pcp_fetch *fetch)
+{
+    sdsfree(fetch->key);
+    sdsfree(fetch->reply);
+    free(fetch);
+}
+
+static void
+pcp_fetch_drop(pcp_fetch *fetch)
+{
+    dictDelete(coalesce_fetches, fetch->key);
+    pcp_fetch_free(fetch);
+    mmv_stats_add(coalesce_metrics, "fetch.entries", NULL, -1);
+}
+
 static void
 client_free(struct client *client)
 {
     if (client->u.pcp.hostname)
 	sdsfree(client->u.pcp.hostname);
+    if (client->u.pcp.server)
+	sdsfree(client->u.pcp.server);
+    if (client->u.pcp.identity)
+	sdsfree(client->u.pcp.identity);
+    if (client->u.pcp.request)
+	sdsfree(client->u.pcp.request);
+    if (client->u.pcp.profiles)
+	dictRelease(client->u.pcp.profiles);
     if (client->buffer)
 	sdsfree(client->buffer);
 }
@@ -30,31 +98,34 @@ client_free(struct client *client)
 static void
 on_server_close(uv_handle_t *handle)
 {
-    struct client	*client = (struct client *)handle;
-
     if (pmDebugOptions.pdu)
-	fprintf(stderr, "client %p pmcd connection closed\n", client);
-    client_free(client);
+	fprintf(stderr, "pmcd connection %p closed\n", handle);
+    free(handle);
 }
 
 static void
 on_server_write(uv_write_t *writer, int status)
 {
-    struct client	*client = (struct client *)writer->handle;
+    struct client	*client = (struct client *)writer->handle->data;
     stream_write_baton	*request = (stream_write_baton *)writer;
 
+    sdsfree(request->buffer[0].base);
     free(request);
-    if (status != 0)
+    /* client is detached from the pmcd socket once closed */
+    if (status != 0 && client != NULL)
 	client_close(client);
 }
 
+/* send a PDU (or raw bytes) to pmcd, taking ownership of the buffer */
 static void
 server_write(struct client *client, sds buffer)
 {
     stream_write_baton	*request;
 
-    if (client_is_closed(client))
+    if (client_is_closed(client)) {
+	sdsfree(buffer);
 	return;
+    }
 
     if ((request = calloc(1, sizeof(stream_write_baton))) != NULL) {
 	if (pmDebugOptions.pdu)
@@ -63,28 +134,192 @@ server_write(struct client *client, sds buffer)
 	request->buffer[0] = uv_buf_init(buffer, sdslen(buffer));
 	request->nbuffers = 1;
 	request->writer.data = client;
-	uv_write(&request->writer, (uv_stream_t *)&client->u.pcp.socket,
+	uv_write(&request->writer, (uv_stream_t *)client->u.pcp.socket,
 		 request->buffer, request->nbuffers, on_server_write);
     } else {
+	sdsfree(buffer);
 	client_close(client);
     }
 }
 
+static unsigned int
+pdu_word(const char *pdu, size_t offset)
+{
+    __int32_t		value;
+
+    memcpy(&value, pdu + offset, sizeof(value));
+    return ntohl(value);
+}
+
+/* send the reply from pmcd to all clients waiting on this fetch */
+static void
+pcp_fetch_complete(pcp_fetch *fetch, int success)
+{
+    struct client	*client, *next;
+
+    next = fetch->waiters;
+    fetch->waiters = NULL;
+    fetch->leader = NULL;
+
+    if (success) {
+	fetch->ready = 1;
+	fetch->stamp = uv_now(coalesce_proxy->events);
+    } else {
+	pcp_fetch_drop(fetch);
+    }
+
+    while ((client = next) != NULL) {
+	next = client->u.pcp.waiter;
+	client->u.pcp.waiter = NULL;
+	client->u.pcp.fetch = NULL;
+	if (success) {
+	    sdsfree(client->u.pcp.request);
+	    client->u.pcp.request = NULL;
+	    client_write(client, sdsdup(fetch->reply), NULL);
+	}
+	/* failed requests are retried individually, then later PDUs */
+	pcp_client_process(client);
+    }
+}
+
+/* a client is going away - forget any fetch it leads or waits upon */
+static void
+pcp_fetch_detach(struct client *client)
+{
+    pcp_fetch		*fetch = client->u.pcp.fetch;
+    struct client	**waiter;
+
+    if (fetch == NULL)
+	return;
+    client->u.pcp.fetch = NULL;
+
+    if (fetch->leader == client) {
+	fetch->leader = NULL;
+	if (fetch->waiters == NULL)
+	    pcp_fetch_drop(fetch);
+	else	/* first waiter takes over as the leader */
+	    pcp_client_process(fetch->waiters);
+	return;
+    }
+    for (waiter = &fetch->waiters; *waiter; waiter = &(*waiter)->u.pcp.waiter) {
+	if (*waiter == client) {
+	    *waiter = client->u.pcp.waiter;
+	    break;
+	}
+    }
+    client->u.pcp.waiter = NULL;
+}
+
+/*
+ * Give up on PDU-level processing for this client (encrypted or
+ * compressed streams, malformed PDUs, or coalescing is disabled),
+ * flushing any partial PDUs held so far in each direction.
+ */
+static void
+pcp_client_passthru(struct client *client)
+{
+    sds			buffer;
+
+    if (client->u.pcp.passthru)
+	return;
+    client->u.pcp.passthru = 1;
+    if (coalesce_window)
+	mmv_stats_inc(coalesce_metrics, "clients.passthru", NULL);
+
+    /* no longer able to identify the reply to a fetch in-flight */
+    pcp_fetch_detach(client);
+    if ((buffer = client->u.pcp.request) != NULL) {
+	client->u.pcp.request = NULL;
+	server_write(client, buffer);
+    }
+
+    if ((buffer = client->u.pcp.server) != NULL) {
+	client->u.pcp.server = NULL;
+	if (sdslen(buffer) > 0)
+	    client_write(client, buffer, NULL);
+	else
+	    sdsfree(buffer);
+    }
+    if ((buffer = client->buffer) != NULL) {
+	client->buffer = NULL;
+	if (sdslen(buffer) > 0)
+	    server_write(client, buffer);
+	else
+	    sdsfree(buffer);
+    }
+}
+
+/*
+ * Process one complete PDU from pmcd, forwarding it to the client.
+ * Replies are matched to requests in order; a positive error code
+ * (pmcd state change notification) may prefix the fetch result.
+ */
+static void
+pcp_server_pdu(struct client *client, sds pdu)
+{
+    pcp_fetch		*fetch = client->u.pcp.fetch;
+    unsigned int	type = pdu_word(pdu, sizeof(__int32_t));
+    int			code, final = 1;
+
+    if (type == PDU_ERROR && sdslen(pdu) > PDU_HDRLENGTH) {
+	code = (int)pdu_word(pdu, PDU_HDRLENGTH);
+	final = (code <= 0);
+    }
+
+    if (fetch && fetch->leader == client) {
+	fetch->reply = sdscatsds(fetch->reply, pdu);
+	if (final) {
+	    client->u.pcp.fetch = NULL;
+	    pcp_fetch_complete(fetch,
+			type == PDU_RESULT || type == PDU_HIGHRES_RESULT);
+	}
+    }
+    if (final && client->u.pcp.pending > 0)
+	client->u.pcp.pending--;
+
+    client_write(client, pdu, NULL);
+}
+
 static void
 on_server_read(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf)
 {
     uv_handle_t		*handle = (uv_handle_t *)stream;
     struct client	*client = (struct client *)handle->data;
-    sds			buffer;
+    sds			buffer, pdu;
+    size_t		length, bytes;
 
     if (pmDebugOptions.pdu)
 	fprintf(stderr, "%s: client %p read %ld bytes from pmcd\n",
 			"on_server_read", client, (long)nread);
 
-    /* proxy data through to the client */
-    if (nread > 0) {
+    if (nread < 0) {
+	/* pmcd has gone away, cannot continue servicing this client */
+	client_close(client);
+    } else if (nread > 0 && client->u.pcp.passthru) {
+	/* proxy data through to the client */
 	buffer = sdsnewlen(buf->base, nread);
 	client_write(client, buffer, NULL);
+    } else if (nread > 0) {
+	if ((buffer = client->u.pcp.server) == NULL)
+	    buffer = sdsnewlen(buf->base, nread);
+	else
+	    buffer = sdscatlen(buffer, buf->base, nread);
+	client->u.pcp.server = buffer;
+
+	while (!client->u.pcp.passthru &&
+		(length = sdslen(client->u.pcp.server)) >= PDU_HDRLENGTH) {
+	    buffer = client->u.pcp.server;
+	    bytes = pdu_word(buffer, 0);
+	    if (bytes < PDU_HDRLENGTH || bytes > PDU_LIMIT) {
+		pcp_client_passthru(client);
+		break;
+	    }
+	    if (length < bytes)
+		break;
+	    pdu = sdsnewlen(buffer, bytes);
+	    sdsrange(buffer, bytes, -1);
+	    pcp_server_pdu(client, pdu);
+	}
     }
     sdsfree(buf->base);
 }
@@ -92,20 +327,27 @@ on_server_read(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf)
 void
 on_pcp_client_close(struct client *client)
 {
+    uv_handle_t		*handle;
+
+    pcp_fetch_detach(client);
     if (client->u.pcp.connected) {
-	uv_close((uv_handle_t *)&client->u.pcp.socket, on_server_close);
-	memset(&client->u.pcp, 0, sizeof(client->u.pcp));
-    } else {
-	client_free(client);
+	handle = (uv_handle_t *)client->u.pcp.socket;
+	handle->data = NULL;
+	uv_close(handle, on_server_close);
     }
+    client_free(client);
+    memset(&client->u.pcp, 0, sizeof(client->u.pcp));
 }
 
 static void
 on_pcp_client_connect(uv_connect_t *connected, int status)
 {
-    uv_handle_t		*handle = (uv_handle_t *)connected;
-    struct client	*client = (struct client *)handle->data;
-    sds			buffer;
+    struct client	*client = (struct client *)connected->handle->data;
+
+    free(connected);
+    if (client == NULL)		/* client closed while connecting */
+	return;
+    client->u.pcp.pmcd = NULL;
 
     if (pmDebugOptions.pdu)
 	fprintf(stderr, "%s: client %p connected to pmcd (status=%d)\n",
@@ -120,12 +362,12 @@ on_pcp_client_connect(uv_connect_t *connected, int status)
     client->u.pcp.state = PCP_PROXY_SETUP;
 
     /* if we have already received PDUs, send them on now */
-    if ((buffer = client->buffer) != NULL) {
-	client->buffer = NULL;	/* free buffer on completion */
-	server_write(client, buffer);
-    }
+    if (coalesce_window == 0)
+	pcp_client_passthru(client);
+    else
+	pcp_client_process(client);
 
-    status = uv_read_start((uv_stream_t *)&client->u.pcp.socket,
+    status = uv_read_start((uv_stream_t *)client->u.pcp.socket,
 			    on_buffer_alloc, on_server_read);
     if (status != 0) {
 	fprintf(stderr, "%s: server read start failed: %s\n",
@@ -146,15 +388,29 @@ pcp_client_connect_pmcd(struct client *client)
 			"pcp_client_connect_pmcd",
 			client->u.pcp.hostname, client->u.pcp.port);
 
-    handle = (uv_handle_t *)&client->u.pcp.pmcd;
-    handle->data = (void *)client;
-    handle = (uv_handle_t *)&client->u.pcp.socket;
+    /*
+     * The pmcd socket and connect request are allocated separately
+     * from the client, as they may outlive it during uv_close.
+     */
+    if ((client->u.pcp.socket = calloc(1, sizeof(uv_tcp_t))) == NULL ||
+	(client->u.pcp.pmcd = calloc(1, sizeof(uv_connect_t))) == NULL) {
+	free(client->u.pcp.socket);
+	client->u.pcp.socket = NULL;
+	client_close(client);
+	return;
+    }
+    handle = (uv_handle_t *)client->u.pcp.socket;
     handle->data = (void *)client;
 
-    uv_tcp_init(proxy->events, &client->u.pcp.socket);
+    uv_tcp_init(proxy->events, client->u.pcp.socket);
+    client->u.pcp.connected = 1;
     uv_ip4_addr(client->u.pcp.hostname, client->u.pcp.port, &pmcd);
-    uv_tcp_connect(&client->u.pcp.pmcd, &client->u.pcp.socket,
-		    (struct sockaddr *)&pmcd, on_pcp_client_connect);
+    if (uv_tcp_connect(client->u.pcp.pmcd, client->u.pcp.socket,
+		    (struct sockaddr *)&pmcd, on_pcp_client_connect) != 0) {
+	free(client->u.pcp.pmcd);
+	client->u.pcp.pmcd = NULL;
+	client_close(client);
+    }
 }
 
 static ssize_t
@@ -207,7 +463,7 @@ pcp_consume_client_hostspec(struct client *client, char *buffer, ssize_t buflen)
 	    sdsfree(client->buffer);
 	    client->buffer = NULL;
 	}
-	pcp_consume_bytes(client, bp + 1, buflen - (bp - buffer));
+	pcp_consume_bytes(client, bp + 1, buflen - (bp - buffer) - 1);
     }
 
     /* initiate the connection to pmcd */
@@ -235,6 +491,220 @@ pcp_consume_client_header(struct proxy *proxy, struct client *client,
     return -EINVAL;
 }
 
+/* send a request to pmcd, for which a reply PDU is expected */
+static void
+pcp_client_request(struct client *client, sds pdu)
+{
+    client->u.pcp.pending++;
+    server_write(client, pdu);
+}
+
+static sds
+pcp_fetch_key(struct client *client, sds pdu)
+{
+    struct pcp_client	*pcp = &client->u.pcp;
+    sds			key, context, profile;
+
+    key = sdscatfmt(sdsempty(), "%S:%u", pcp->hostname, pcp->port);
+    key = sdscatlen(key, pdu + sizeof(__int32_t), sizeof(__int32_t));
+    if (pcp->identity)
+	key = sdscatsds(key, pcp->identity);
+    key = sdscatlen(key, "\0", 1);
+    if (pcp->profiles) {
+	context = sdsnewlen(pdu + PDU_CTXOFFSET, sizeof(__int32_t));
+	if ((profile = dictFetchValue(pcp->profiles, context)) != NULL)
+	    key = sdscatsds(key, profile);
+	sdsfree(context);
+    }
+    key = sdscatlen(key, "\0", 1);
+    return sdscatlen(key, pdu + PDU_PMIDOFFSET, sdslen(pdu) - PDU_PMIDOFFSET);
+}
+
+static void
+pcp_client_fetch(struct client *client, sds pdu)
+{
+    pcp_fetch		*fetch;
+    sds			key;
+
+    coalesce_requests++;
+    mmv_stats_inc(coalesce_metrics, "fetch.requests", NULL);
+
+    /* replies must be returned in order - only coalesce when idle */
+    if (client->u.pcp.pending || sdslen(pdu) < PDU_PMIDOFFSET) {
+	mmv_stats_inc(coalesce_metrics, "fetch.upstream", NULL);
+	pcp_client_request(client, pdu);
+	return;
+    }
+
+    key = pcp_fetch_key(client, pdu);
+    if ((fetch = dictFetchValue(coalesce_fetches, key)) != NULL &&
+	fetch->ready &&
+	uv_now(client->proxy->events) - fetch->stamp >= coalesce_window) {
+	pcp_fetch_drop(fetch);	/* reply is no longer fresh */
+	fetch = NULL;
+    }
+
+    if (fetch == NULL) {
+	if ((fetch = calloc(1, sizeof(pcp_fetch))) == NULL) {
+	    sdsfree(key);
+	    mmv_stats_inc(coalesce_metrics, "fetch.upstream", NULL);
+	    pcp_client_request(client, pdu);
+	    return;
+	}
+	fetch->key = key;
+	fetch->reply = sdsempty();
+	fetch->leader = client;
+	dictAdd(coalesce_fetches, key, fetch);
+	mmv_stats_inc(coalesce_metrics, "fetch.entries", NULL);
+	mmv_stats_inc(coalesce_metrics, "fetch.upstream", NULL);
+	client->u.pcp.fetch = fetch;
+	pcp_client_request(client, pdu);
+	return;
+    }
+    sdsfree(key);
+    coalesce_shared++;
+
+    if (fetch->ready) {
+	if (pmDebugOptions.pdu)
+	    fprintf(stderr, "%s: client %p fetch reply from cache\n",
+			"pcp_client_fetch", client);
+	mmv_stats_inc(coalesce_metrics, "fetch.cached", NULL);
+	client_write(client, sdsdup(fetch->reply), NULL);
+	sdsfree(pdu);
+    } else {
+	if (pmDebugOptions.pdu)
+	    fprintf(stderr, "%s: client %p waits on fetch from client %p\n",
+			"pcp_client_fetch", client, fetch->leader);
+	mmv_stats_inc(coalesce_metrics, "fetch.coalesced", NULL);
+	client->u.pcp.fetch = fetch;
+	client->u.pcp.request = pdu;
+	client->u.pcp.waiter = fetch->waiters;
+	fetch->waiters = client;
+    }
+}
+
+/* credentials and attributes affect pmcd replies, so form part of keys */
+static void
+pcp_client_identity(struct client *client, sds pdu)
+{
+    const char		*body = pdu + PDU_HDRLENGTH;
+    size_t		length = sdslen(pdu) - PDU_HDRLENGTH;
+
+    if (client->u.pcp.identity == NULL)
+	client->u.pcp.identity = sdsnewlen(body, length);
+    else
+	client->u.pcp.identity = sdscatlen(client->u.pcp.identity, body, length);
+    server_write(client, pdu);
+}
+
+static void
+pcp_client_creds(struct client *client, sds pdu)
+{
+    unsigned int	i, count, cred;
+
+    count = (sdslen(pdu) - PDU_HDRLENGTH) / sizeof(__int32_t);
+    for (i = 1; i < count; i++) {
+	cred = pdu_word(pdu, PDU_HDRLENGTH + i * sizeof(__int32_t));
+	/* version credential - feature bits in the low 16 bits */
+	if ((cred >> 24) == CVERSION &&
+	    (cred & (PDU_FLAG_SECURE|PDU_FLAG_COMPRESS|PDU_FLAG_AUTH))) {
+	    /* stream is about to be encrypted, compressed or use SASL */
+	    server_write(client, pdu);
+	    pcp_client_passthru(client);
+	    return;
+	}
+    }
+    pcp_client_identity(client, pdu);
+}
+
+static void
+pcp_client_profile(struct client *client, sds pdu)
+{
+    sds			context, profile;
+
+    if (sdslen(pdu) >= PDU_CTXOFFSET + sizeof(__int32_t)) {
+	if (client->u.pcp.profiles == NULL)
+	    client->u.pcp.profiles = dictCreate(&sdsOwnDictCallBacks, NULL);
+	context = sdsnewlen(pdu + PDU_CTXOFFSET, sizeof(__int32_t));
+	profile = sdsnewlen(pdu + PDU_CTXOFFSET + sizeof(__int32_t),
+			sdslen(pdu) - PDU_CTXOFFSET - sizeof(__int32_t));
+	if (dictReplace(client->u.pcp.profiles, context, profile) == 0)
+	    sdsfree(context);	/* existing key retained */
+    }
+    server_write(client, pdu);	/* no reply unless in error */
+}
+
+static void
+pcp_client_pdu(struct client *client, sds pdu)
+{
+    switch (pdu_word(pdu, sizeof(__int32_t))) {
+    case PDU_FETCH:
+    case PDU_HIGHRES_FETCH:
+	pcp_client_fetch(client, pdu);
+	break;
+    case PDU_PROFILE:
+	pcp_client_profile(client, pdu);
+	break;
+    case PDU_CREDS:
+	pcp_client_creds(client, pdu);
+	break;
+    case PDU_ATTR:
+	pcp_client_identity(client, pdu);
+	break;
+    default:
+	pcp_client_request(client, pdu);
+	break;
+    }
+}
+
+/*
+ * Send complete client PDUs on to pmcd, unless this client is waiting
+ * for a coalesced fetch reply - later requests are held until then.
+ */
+static void
+pcp_client_process(struct client *client)
+{
+    pcp_fetch		*fetch = client->u.pcp.fetch;
+    sds			buffer, pdu;
+    size_t		length, bytes;
+
+    if (fetch != NULL) {
+	if (fetch->leader != NULL)
+	    return;
+	/* previous leader has gone - send this request upstream now */
+	fetch->leader = client;
+	fetch->waiters = client->u.pcp.waiter;
+	client->u.pcp.waiter = NULL;
+	sdsclear(fetch->reply);
+	mmv_stats_inc(coalesce_metrics, "fetch.upstream", NULL);
+	pcp_client_request(client, client->u.pcp.request);
+	client->u.pcp.request = NULL;
+    } else if (client->u.pcp.request != NULL) {
+	/* coalesced fetch failed - send this request upstream itself */
+	mmv_stats_inc(coalesce_metrics, "fetch.upstream", NULL);
+	pcp_client_request(client, client->u.pcp.request);
+	client->u.pcp.request = NULL;
+    }
+
+    while (!client->u.pcp.passthru && client->buffer != NULL &&
+	   (length = sdslen(client->buffer)) >= PDU_HDRLENGTH) {
+	fetch = client->u.pcp.fetch;
+	if (fetch != NULL && fetch->leader != client)
+	    break;
+	buffer = client->buffer;
+	bytes = pdu_word(buffer, 0);
+	if (bytes < PDU_HDRLENGTH || bytes > PDU_LIMIT) {
+	    pcp_client_passthru(client);
+	    break;
+	}
+	if (length < bytes)
+	    break;
+	pdu = sdsnewlen(buffer, bytes);
+	sdsrange(buffer, bytes, -1);
+	pcp_client_pdu(client, pdu);
+    }
+}
+
 void
 on_pcp_client_read(struct proxy *proxy, struct client *client,
 		ssize_t nread, const uv_buf_t *buf)
@@ -285,8 +755,12 @@ on_pcp_client_read(struct proxy *proxy, struct client *client,
 
     case PCP_PROXY_SETUP:
 	/* initial setup is now complete - direct proxying from here onward */
-	sdssetlen(buf->base, nread);
-	server_write(client, buf->base);
+	if (client->u.pcp.passthru) {
+	    server_write(client, sdsnewlen(buf->base, nread));
+	} else {
+	    pcp_consume_bytes(client, buf->base, nread);
+	    pcp_client_process(client);
+	}
 	break;
     }
 }
@@ -298,14 +772,116 @@ on_pcp_client_write(struct client *client)
 	fprintf(stderr, "%s: client %p\n", "on_pcp_client_write", client);
 }
 
+static void
+pcp_fetch_expire(void *arg)
+{
+    struct proxy	*proxy = (struct proxy *)arg;
+    dictIterator	*iterator;
+    dictEntry		*entry;
+    pcp_fetch		*fetch;
+    uint64_t		now = uv_now(proxy->events);
+
+    iterator = dictGetSafeIterator(coalesce_fetches);
+    while ((entry = dictNext(iterator)) != NULL) {
+	fetch = (pcp_fetch *)dictGetVal(entry);
+	if (fetch->ready && now - fetch->stamp >= coalesce_window)
+	    pcp_fetch_drop(fetch);
+    }
+    dictReleaseIterator(iterator);
+
+    mmv_stats_set(coalesce_metrics, "fetch.ratio", NULL, coalesce_requests ?
+		(double)coalesce_shared / (double)coalesce_requests : 0.0);
+}
+
+static void
+pcp_setup_metrics(mmv_registry_t *registry)
+{
+    pmUnits		nounits = MMV_UNITS(0,0,0,0,0,0);
+    pmUnits		countunits = MMV_UNITS(0,0,1,0,0,PM_COUNT_ONE);
+    pmInDom		noindom = MMV_INDOM_NULL;
+
+    if (registry == NULL)
+	return;
+
+    mmv_stats_add_metric(registry, "fetch.requests", FETCH_REQUESTS,
+	MMV_TYPE_U64, MMV_SEM_COUNTER, countunits, noindom,
+	"fetch requests from PCP clients",
+	"Number of fetch PDUs received from PCP protocol clients.");
+
+    mmv_stats_add_metric(registry, "fetch.upstream", FETCH_UPSTREAM,
+	MMV_TYPE_U64, MMV_SEM_COUNTER, countunits, noindom,
+	"fetch requests sent on to pmcd",
+	"Number of client fetch PDUs sent on to pmcd, either because no\n"
+	"equivalent fetch was in-flight or fresh, or the client was busy.");
+
+    mmv_stats_add_metric(registry, "fetch.coalesced", FETCH_COALESCED,
+	MMV_TYPE_U64, MMV_SEM_COUNTER, countunits, noindom,
+	"fetch requests joined to one in-flight",
+	"Number of client fetch PDUs answered by the pmcd reply to an\n"
+	"identical fetch request from another client that was in-flight.");
+
+    mmv_stats_add_metric(registry, "fetch.cached", FETCH_CACHED,
+	MMV_TYPE_U64, MMV_SEM_COUNTER, countunits, noindom,
+	"fetch requests answered from a fresh reply",
+	"Number of client fetch PDUs answered by a pmcd reply to an\n"
+	"identical fetch request received within the pcp.coalesce window.");
+
+    mmv_stats_add_metric(registry, "fetch.entries", FETCH_ENTRIES,
+	MMV_TYPE_I64, MMV_SEM_DISCRETE, countunits, noindom,
+	"in-flight and fresh fetch replies",
+	"Number of distinct fetch requests either in-flight to pmcd or\n"
+	"with replies available to be shared with other clients.");
+
+    mmv_stats_add_metric(registry, "fetch.ratio", FETCH_RATIO,
+	MMV_TYPE_DOUBLE, MMV_SEM_INSTANT, nounits, noindom,
+	"fraction of fetch requests coalesced",
+	"Proportion of client fetch PDUs answered without sending them\n"
+	"on to pmcd - coalesced and cached over total fetch requests.");
+
+    mmv_stats_add_metric(registry, "clients.passthru", CLIENT_PASSTHRU,
+	MMV_TYPE_U64, MMV_SEM_COUNTER, countunits, noindom,
+	"clients with fetch coalescing disabled",
+	"Number of PCP protocol clients switched to byte-level proxying,\n"
+	"due to secure (TLS), compressed or authenticated connections.");
+
+    coalesce_metrics = mmv_stats_start(registry);
+}
+
 void
 setup_pcp_module(struct proxy *proxy)
 {
-    proxymetrics(proxy, METRICS_PCP);
+    mmv_registry_t	*registry = proxymetrics(proxy, METRICS_PCP);
+    sds			option;
+
+    if ((option = pmIniFileLookup(proxy->config, "pmproxy", "pcp.coalesce")))
+	coalesce_window = strtoul(option, NULL, 10);
+    if (coalesce_window == 0)
+	return;
+
+    coalesce_proxy = proxy;
+    coalesce_fetches = dictCreate(&sdsKeyDictCallBacks, NULL);
+    pcp_setup_metrics(registry);
+    coalesce_timer = pmWebTimerRegister(pcp_fetch_expire, proxy);
 }
 
 void
 close_pcp_module(struct proxy *proxy)
 {
+    dictIterator	*iterator;
+    dictEntry		*entry;
+
+    if (coalesce_timer >= 0) {
+	pmWebTimerRelease(coalesce_timer);
+	coalesce_timer = -1;
+    }
+    if (coalesce_fetches) {
+	iterator = dictGetSafeIterator(coalesce_fetches);
+	while ((entry = dictNext(iterator)) != NULL)
+	    pcp_fetch_free((pcp_fetch *)dictGetVal(entry));
+	dictReleaseIterator(iterator);
+	dictRelease(coalesce_fetches);
+	coalesce_fetches = NULL;
+    }
+    coalesce_metrics = NULL;
     proxymetrics_close(proxy, METRICS_PCP);
 }
@@ -101,9 +101,17 @@ typedef struct pcp_client {
     unsigned int	port : 16;
     unsigned int	certreq : 1;
     unsigned int	connected : 1;
-    unsigned int	pad : 14;
-    uv_connect_t	pmcd;
-    uv_tcp_t		socket;
+    unsigned int	passthru : 1;	/* no PDU parsing, proxy bytes only */
+    unsigned int	pad : 13;
+    unsigned int	pending;	/* requests sent to pmcd, no reply yet */
+    uv_connect_t	*pmcd;
+    uv_tcp_t		*socket;
+    sds			server;		/* partial PDU read from pmcd */
+    sds			identity;	/* credentials and attributes sent */
+    struct dict		*profiles;	/* context number: instance profile */
+    struct pcp_fetch	*fetch;		/* coalesced fetch led or awaited */
+    sds			request;	/* fetch PDU held while awaiting */
+    struct client	*waiter;	/* next client awaiting same fetch */
 } pcp_client;
 
 #ifdef HAVE_OPENSSL
@@ -1357,7 +1357,8 @@ class pmContext(object):
         if c_api.pmGetOptionArchives():
             context = c_api.PM_CONTEXT_ARCHIVE
             options.pmSetOptionContext(c_api.PM_CONTEXT_ARCHIVE)
-            source = options.pmGetOptionArchives()[0]
+            # PM_OPTFLAG_MULTI (for several hosts) splits the archive list
+            source = ",".join(options.pmGetOptionArchives())
         elif c_api.pmGetOptionHosts():
             context = c_api.PM_CONTEXT_HOST
             options.pmSetOptionContext(c_api.PM_CONTEXT_HOST)
@@ -2661,6 +2662,15 @@ LIBPCP.pmExtendFetchGroup_indom.argtypes = [c_void_p, c_char_p, c_char_p,
                                             c_uint,
                                             POINTER(c_uint),
                                             POINTER(c_int)]
+LIBPCP.pmExtendFetchGroup_vector.restype = c_int
+LIBPCP.pmExtendFetchGroup_vector.argtypes = [c_void_p, c_char_p, c_char_p,
+                                             POINTER(c_int),
+                                             POINTER(c_char_p),
+                                             POINTER(c_double),
+                                             POINTER(c_int),
+                                             c_uint,
+                                             POINTER(c_uint),
+                                             POINTER(c_int)]
 LIBPCP.pmExtendFetchGroup_event.restype = c_int
 LIBPCP.pmExtendFetchGroup_event.argtypes = [c_void_p, c_char_p, c_char_p, c_char_p, c_char_p,
                                             POINTER(timespec),
@@ -2674,6 +2684,8 @@ LIBPCP.pmExtendFetchGroup_timestamp.restype = c_int
 LIBPCP.pmExtendFetchGroup_timestamp.argtypes = [c_void_p, POINTER(timeval)]
 LIBPCP.pmFetchGroup.restype = c_int
 LIBPCP.pmFetchGroup.argtypes = [c_void_p]
+LIBPCP.pmFetchGroups.restype = c_int
+LIBPCP.pmFetchGroups.argtypes = [c_int, POINTER(c_void_p), POINTER(c_int), c_int]
 
 
 class fetchgroup(object):
@@ -2777,6 +2789,51 @@ class fetchgroup(object):
             return vv
 
 
+    class fetchgroup_vector(object):
+        """
+        An internal class to receive values for an indom of items as
+        doubles in contiguous arrays.  It may be called as if it were
+        a function object to return memoryviews of the instance codes
+        and values set at the most recent fetch() call, without any
+        per-value decoding, e.g. for use with numpy.frombuffer().
+        Values that could not be fetched or converted are NaN.
+        """
+
+        def __init__(self, num):
+            """Allocate arrays to receive up to num fetchgroup values."""
+            stss_t = c_int * num
+            values_t = c_double * num
+            icodes_t = c_uint * num
+            inames_t = c_char_p * num
+            self.sts = c_int()
+            self.stss = stss_t()
+            self.values = values_t()
+            self.icodes = icodes_t()
+            self.inames = inames_t()
+            self.num = c_uint()
+            # ctypes arrays export explicit byte-order formats like '<d',
+            # cast once to the native formats that memoryview supports
+            self.vstss = memoryview(self.stss).cast('B').cast('i')
+            self.vvalues = memoryview(self.values).cast('B').cast('d')
+            self.vicodes = memoryview(self.icodes).cast('B').cast('I')
+
+        def __call__(self):
+            """Retrieve (instance codes, values) memoryviews, if available."""
+            if self.sts.value < 0:
+                raise pmErr(self.sts.value)
+            num = self.num.value
+            return (self.vicodes[:num], self.vvalues[:num])
+
+        def status(self):
+            """Retrieve per-instance status codes as a memoryview."""
+            return self.vstss[:self.num.value]
+
+        def names(self):
+            """Retrieve the list of instance names (None if unknown)."""
+            return [self.inames[i].decode('utf-8') if self.inames[i] else None
+                    for i in range(self.num.value)]
+
+
     class fetchgroup_event(object):
         """
         An internal class to receive value/status for an
@@ -2925,6 +2982,29 @@ class fetchgroup(object):
         self.items.append(vv) # keep registered pmAtomValue/etc. alive
         return vv
 
+    def extend_vector(self, metric=None, scale=None, maxnum=100):
+        # pylint: disable=C0330
+        """Extend the fetchgroup with up to @maxnum instances of a metric,
+        (metrics without instances are also accepted), with values
+        converted to doubles and stored contiguously.  Convert scale/rate
+        if appropriate/requested.
+        """
+        if metric is None or maxnum < 0:
+            raise pmErr(-errno.EINVAL)
+        vv = fetchgroup.fetchgroup_vector(maxnum)
+        sts = LIBPCP.pmExtendFetchGroup_vector(self.pmfg,
+                      c_char_p(metric.encode('utf-8') if metric else None),
+                      c_char_p(scale.encode('utf-8') if scale else None),
+                      cast(pointer(vv.icodes), POINTER(c_int)),
+                      cast(pointer(vv.inames), POINTER(c_char_p)),
+                      cast(pointer(vv.values), POINTER(c_double)),
+                      cast(pointer(vv.stss), POINTER(c_int)),
+                      c_uint(maxnum), pointer(vv.num), pointer(vv.sts))
+        if sts < 0:
+            raise pmErr(sts)
+        self.items.append(vv) # keep registered arrays alive
+        return vv
+
     def extend_timestamp(self):
         """Extend the fetchgroup with a timestamp query. """
         v = fetchgroup.fetchgroup_timestamp(self.ctx)
@@ -2971,6 +3051,21 @@ class fetchgroup(object):
             raise pmErr(sts)
         return sts  # propogate any pmFetch(3) state flags to caller
 
+    @staticmethod
+    def fetch_groups(groups, maxthreads=0):
+        """Fetch several fetchgroups (e.g. one per host) concurrently.
+        The fetches run in native threads, with the GIL released.
+        Returns a list with the pmFetch(3) status for each fetchgroup;
+        unlike fetch(), failures are reported there, not raised.
+        """
+        num = len(groups)
+        pmfgs = (c_void_p * num)(*[group.pmfg.value for group in groups])
+        stss = (c_int * num)()
+        sts = LIBPCP.pmFetchGroups(num, pmfgs, stss, maxthreads)
+        if sts < 0:
+            raise pmErr(sts)
+        return list(stss)
+
     def clear(self):
         """Clear all the metrics in this fetchgroup ready to start again."""
         sts = LIBPCP.pmClearFetchGroup(self.pmfg)
@@ -81,6 +81,11 @@ class pmConfig(object):
         # Update PCP labels on instance changes
         self._prev_insts = []
 
+        # Additional hosts, one fetchgroup each: host: [name, pmfg, items]
+        self._hosts = OrderedDict()
+        self._host_name = None
+        self._fg_specs = OrderedDict()
+
     def set_signal_handler(self):
         """ Set default signal handler """
         def handler(_signum, _frame):
@@ -1037,9 +1042,15 @@ class pmConfig(object):
                             if self.provide_labels():
                                 del self.labels[i][1][v]
                     self.util.metrics[metric][5] = self.pmfg_items_to_indom(items)
+                    self._fg_specs[metric] = (mtype, scale, self.insts[i][1], max_insts)
+                elif mtype == pmapi.c_api.PM_TYPE_DOUBLE:
+                    self.util.metrics[metric][5] = \
+                        self.util.pmfg.extend_vector(metric, scale, max_insts)
                 else:
                     self.util.metrics[metric][5] = \
                         self.util.pmfg.extend_indom(metric, mtype, scale, max_insts)
+                if metric not in self._fg_specs:
+                    self._fg_specs[metric] = (mtype, scale, None, max_insts)
 
                 # Populate per-metric regex cache for live filtering
                 if self.do_live_filtering():
@@ -1067,6 +1078,7 @@ class pmConfig(object):
             if self.provide_labels():
                 del self.labels[incompat_metrics[metric]]
             del self.util.metrics[metric]
+            self._fg_specs.pop(metric, None)
         del incompat_metrics
 
         # Verify that we have valid metrics
@@ -1080,6 +1092,69 @@ class pmConfig(object):
         if hasattr(self.util, 'predicate') and self.util.predicate:
             self.validate_predicate()
 
+        self.extend_hosts()
+
+    def connect_hosts(self):
+        """ Connect to any additional hosts, one fetchgroup per host """
+        if self._hosts or self.util.context.type != pmapi.c_api.PM_CONTEXT_HOST:
+            return
+        hosts = self.util.opts.pmGetOptionHosts() or []
+        if len(hosts) < 2:
+            return
+        names = [self.get_host_name()]
+        for host in hosts[1:]:
+            if host in self._hosts or host == hosts[0]:
+                continue
+            try:
+                pmfg = pmapi.fetchgroup(pmapi.c_api.PM_CONTEXT_HOST, host)
+                name = pmfg.get_context().pmGetContextHostName()
+            except pmapi.pmErr as error:
+                sys.stderr.write("Cannot connect to host %s: %s, skipping.\n" % (host, error.message()))
+                continue
+            # Label by host spec if pmcd hostnames are not unique
+            if name in names:
+                name = host
+            names.append(name)
+            self._hosts[host] = [name, pmfg, OrderedDict()]
+
+    def get_host_name(self):
+        """ Get the host name of the primary context """
+        if self._host_name is None:
+            self._host_name = self.util.context.pmGetContextHostName()
+        return self._host_name
+
+    def extend_host_metric(self, pmfg, metric, spec):
+        """ Extend an additional host fetchgroup as the primary one """
+        mtype, scale, names, max_insts = spec
+        if names is None:
+            if mtype == pmapi.c_api.PM_TYPE_DOUBLE:
+                return pmfg.extend_vector(metric, scale, max_insts)
+            return pmfg.extend_indom(metric, mtype, scale, max_insts)
+        # Instance numbers are host specific, instance names are not
+        ctx = pmfg.get_context()
+        desc = ctx.pmLookupDescs(ctx.pmLookupName(metric))[0]
+        items = []
+        for name in names:
+            try:
+                inst = ctx.pmLookupInDom(desc, name)
+                items.append((inst, name, pmfg.extend_item(metric, mtype, scale, name)))
+            except pmapi.pmErr:
+                pass
+        return self.pmfg_items_to_indom(items)
+
+    def extend_hosts(self):
+        """ Extend additional host fetchgroups with the current metricset """
+        self.connect_hosts()
+        for host in self._hosts:
+            pmfg = self._hosts[host][1]
+            pmfg.clear()
+            items = self._hosts[host][2] = OrderedDict()
+            for metric in self._fg_specs:
+                try:
+                    items[metric] = self.extend_host_metric(pmfg, metric, self._fg_specs[metric])
+                except pmapi.pmErr:
+                    pass # Not available on this host
+
     def finalize_options(self):
         """ Finalize util options """
         # Runtime overrides samples/interval
@@ -1120,6 +1195,7 @@ class pmConfig(object):
         self.texts = []
         self.labels = []
         self.res_labels = OrderedDict()
+        self._fg_specs = OrderedDict()
         self.util.pmfg.clear()
         self.util.pmfg_ts = None
 
@@ -1139,7 +1215,14 @@ class pmConfig(object):
     def fetch(self):
         """ Sample using fetchgroup and handle special cases """
         try:
-            state = self.util.pmfg.fetch()
+            if self._hosts:
+                # Errors with additional hosts show up as missing values
+                groups = [self.util.pmfg] + [self._hosts[h][1] for h in self._hosts]
+                state = pmapi.fetchgroup.fetch_groups(groups)[0]
+                if state < 0:
+                    raise pmapi.pmErr(state)
+            else:
+                state = self.util.pmfg.fetch()
         except pmapi.pmErr as error:
             if error.args[0] == pmapi.c_api.PM_ERR_EOL:
                 return -1
@@ -1228,8 +1311,32 @@ class pmConfig(object):
         """ Deprecated, use get_ranked_results() instead """
         return self.get_ranked_results(valid_only)
 
-    def get_ranked_results(self, valid_only=False):
-        """ Get filtered and ranked results """
+    def get_metric_values(self, metric, host=None):
+        """ Get (instance, name, value) tuples of a metric from the fetchgroup """
+        if host is None:
+            item = self.util.metrics[metric][5]
+        elif metric in self._hosts[host][2]:
+            item = self._hosts[host][2][metric]
+        else:
+            return []
+        if not isinstance(item, pmapi.fetchgroup.fetchgroup_vector):
+            return item() # values are functions decoding each value
+        insts, values = item()
+        return [(inst, name, value) for inst, name, value, sts in
+                zip(insts.tolist(), item.names(), values.tolist(),
+                    item.status().tolist()) if sts >= 0]
+
+    def get_host_results(self, valid_only=False):
+        """ Get filtered and ranked results of each host, keyed by host name,
+            all for the timestamp of the primary host """
+        results = OrderedDict()
+        results[self.get_host_name()] = self.get_ranked_results(valid_only)
+        for host in self._hosts:
+            results[self._hosts[host][0]] = self.get_ranked_results(valid_only, host)
+        return results
+
+    def get_ranked_results(self, valid_only=False, host=None):
+        """ Get filtered and ranked results, of the primary host by default """
         results = OrderedDict()
         if hasattr(self.util, 'predicate') and self.util.predicate:
             predicates = self.util.predicate.split(",")
@@ -1239,7 +1346,7 @@ class pmConfig(object):
         for i, metric in enumerate(self.util.metrics):
             results[metric] = []
             try:
-                for inst, name, val in self.util.metrics[metric][5]():
+                for inst, name, val in self.get_metric_values(metric, host):
                     try:
                         # Ignore transient instances
                         if inst != pmapi.c_api.PM_IN_NULL and not name:
@@ -1247,7 +1354,7 @@ class pmConfig(object):
                         if early_live_filter and inst != pmapi.c_api.PM_IN_NULL and \
                            not self.filter_instance(metric, name):
                             continue
-                        value = val()
+                        value = val() if callable(val) else val
                         if self.util.metrics[metric][7]:
                             if metric not in predicates:
                                 limit = self.util.metrics[metric][7]
@@ -1264,7 +1371,7 @@ class pmConfig(object):
             if valid_only and not results[metric]:
                 del results[metric]
 
-        if self.provide_labels():
+        if self.provide_labels() and host is None:
             insts = [(metric, list(zip(*results[metric]))[0]) for metric in results if results[metric]]
             if self._prev_insts != insts:
                 prev_labels = self.res_labels
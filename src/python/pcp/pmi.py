@@ -50,8 +50,10 @@
         del log
 """
 
-from pcp.pmapi import pmID, pmInDom, pmUnits, pmResult
-from cpmi import pmiErrSymDict, PMI_MAXERRMSGLEN
+from pcp.pmapi import pmID, pmInDom, pmUnits, pmResult, pmAtomValue, timeval
+from cpmi import pmiErrSymDict, PMI_MAXERRMSGLEN, PMI_ERR_BADHANDLE
+from cpmapi import PM_TYPE_32, PM_TYPE_U32, PM_TYPE_64, PM_TYPE_U64
+from cpmapi import PM_TYPE_FLOAT, PM_TYPE_DOUBLE, PM_TYPE_STRING
 
 import ctypes
 from ctypes import cast, c_int, c_uint, c_char_p, POINTER
@@ -119,6 +121,10 @@ LIBPCP_IMPORT.pmiWrite.argtypes = [c_int, c_int]
 LIBPCP_IMPORT.pmiPutResult.restype = c_int
 LIBPCP_IMPORT.pmiPutResult.argtypes = [POINTER(pmResult)]
 
+LIBPCP_IMPORT.pmiPutBatch.restype = c_int
+LIBPCP_IMPORT.pmiPutBatch.argtypes = [
+        c_int, POINTER(timeval), c_int, POINTER(c_int), POINTER(pmAtomValue)]
+
 LIBPCP_IMPORT.pmiPutMark.restype = c_int
 LIBPCP_IMPORT.pmiPutMark.argtypes = None
 
@@ -192,6 +198,8 @@ class pmiLogImport(object):
         if not isinstance(path, bytes):
             path = path.encode('utf-8')
         self._path = path        # the archive path (file name)
+        self._types = {}         # metric name to type, for pmiPutBatch
+        self._handles = {}       # handle to pmAtomValue field
         self._ctx = LIBPCP_IMPORT.pmiStart(c_char_p(path), inherit)
         if self._ctx < 0:
             raise pmiErr(self._ctx)
@@ -265,6 +273,7 @@ class pmiLogImport(object):
                                             pmid, typed, indom, sem, units)
         if status < 0:
             raise pmiErr(status)
+        self._types[name] = typed
         return status
 
     def pmiAddInstance(self, indom, instance, instid):
@@ -314,6 +323,7 @@ class pmiLogImport(object):
         status = LIBPCP_IMPORT.pmiGetHandle(c_char_p(name), instance)
         if status < 0:
             raise pmiErr(status)
+        self._handles[status] = self._atomfield.get(self._types.get(name))
         return status
 
     def pmiPutValueHandle(self, handle, value):
@@ -338,6 +348,47 @@ class pmiLogImport(object):
             raise pmiErr(status)
         return status
 
+    _atomfield = {PM_TYPE_32: "l", PM_TYPE_U32: "ul",
+                  PM_TYPE_64: "ll", PM_TYPE_U64: "ull",
+                  PM_TYPE_FLOAT: "f", PM_TYPE_DOUBLE: "d",
+                  PM_TYPE_STRING: "cp"}
+
+    def pmiPutBatch(self, stamps, handles, values):
+        """PMI - write values for many timestamps to a Log Import archive
+
+        stamps is a sequence of (seconds, microseconds) timestamps and
+        values a matching sequence of rows, each with one value for each
+        of the handles (from pmiGetHandle) in the order given
+        """
+        status = LIBPCP_IMPORT.pmiUseContext(self._ctx)
+        if status < 0:
+            raise pmiErr(status)
+        nstamp = len(stamps)
+        nhandle = len(handles)
+        fields = []
+        for handle in handles:
+            if self._handles.get(handle) is None:
+                raise pmiErr(PMI_ERR_BADHANDLE)
+            fields.append(self._handles[handle])
+        c_stamps = (timeval * nstamp)()
+        c_values = (pmAtomValue * (nstamp * nhandle))()
+        for i, stamp in enumerate(stamps):
+            c_stamps[i].tv_sec = stamp[0]
+            c_stamps[i].tv_usec = stamp[1]
+            row = values[i]
+            base = i * nhandle
+            for j, field in enumerate(fields):
+                value = row[j]
+                if field == "cp" and not isinstance(value, bytes):
+                    value = str(value).encode('utf-8')
+                setattr(c_values[base + j], field, value)
+        c_handles = (c_int * nhandle)(*handles)
+        status = LIBPCP_IMPORT.pmiPutBatch(nstamp, c_stamps, nhandle,
+                                           c_handles, c_values)
+        if status < 0:
+            raise pmiErr(status)
+        return status
+
     def pmiPutMark(self):
         """PMI - write a <mark> record to a Log Import archive """
         status = LIBPCP_IMPORT.pmiUseContext(self._ctx)